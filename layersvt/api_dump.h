@@ -32,6 +32,11 @@
 #include "vk_layer_table.h"
 #include "utils/vk_layer_extension_utils.h"
 #include "utils/vk_layer_utils.h"
+#include "api_dump_clock.h"
+#include "api_dump_frame_index.h"
+#include "api_dump_socket.h"
+#include "monitor_spike.h"
+#include "vk_layer_memory.h"
 #include <vulkan/utility/vul_dispatch_table.h>
 
 // Include the video headers so we can print types that come from them
@@ -44,17 +49,28 @@
 #include "vk_video/vulkan_video_codec_h265std_encode.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
 #include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <mutex>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <ostream>
 #include <sstream>
 #include <string.h>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <map>
+#include <memory>
 #include <thread>
 #include <unordered_map>
 #include <vector>
@@ -67,6 +83,7 @@
 
 #include <android/log.h>
 #include <sys/system_properties.h>
+#include <sys/stat.h>
 // Disable warning about bitshift precedence
 #pragma GCC diagnostic ignored "-Wshift-op-parentheses"
 
@@ -77,6 +94,27 @@
 #pragma warning(disable : 4554)
 #endif
 
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#if __has_include(<linux/io_uring.h>)
+#define API_DUMP_IO_URING
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#endif
+#endif
+
 #define MAX_STRING_LENGTH 1024
 
 // Defines for utilized environment variables.
@@ -87,11 +125,61 @@
 #define API_DUMP_ENV_VAR_FLUSH_FILE "VK_APIDUMP_FLUSH"
 #define API_DUMP_ENV_VAR_OUTPUT_RANGE "VK_APIDUMP_OUTPUT_RANGE"
 #define API_DUMP_ENV_VAR_TIMESTAMP "VK_APIDUMP_TIMESTAMP"
+#define API_DUMP_ENV_VAR_FUNCTION_FILTER "VK_APIDUMP_FUNCTION_FILTER"
+#define API_DUMP_ENV_VAR_SHADER_DIRECTORY "VK_APIDUMP_SHADER_DIRECTORY"
+#define API_DUMP_ENV_VAR_COMPRESSION "VK_APIDUMP_COMPRESSION"
+#define API_DUMP_ENV_VAR_SPLIT_OUTPUT "VK_APIDUMP_SPLIT_OUTPUT"
 
 enum class ApiDumpFormat {
     Text,
     Html,
     Json,
+    Binary,
+    Stats,
+    Trace,
+};
+
+// The call which ends a frame. Applications which never present, like compute services and headless renderers, pick one of
+// the others so that the output range, sampling, rotation and indexing of frames work for them too.
+enum class ApiDumpFrameDelimiter {
+    Present,
+    Submit,
+    Label,
+    WaitIdle,
+    FenceWait,
+};
+
+// A binary capture starts with this header, followed by one record per API call. A record is its uint32_t payload size
+// followed by the payload: the uint64_t thread, the uint64_t frame, the int64_t microseconds since the start of the
+// application, the uint64_t sequence number of the call, the uint32_t index of the function and then the return value and
+// parameters. Sequence numbers follow the order in which the calls were made across all threads, which is what split
+// captures are merged by. Everything is in host byte order. Function indices and structure layouts depend on the Vulkan
+// headers, so a capture can only be converted by a converter built against the same header version.
+struct ApiDumpBinaryFileHeader {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t header_version;
+};
+
+static const char API_DUMP_BINARY_MAGIC[8] = {'V', 'K', 'A', 'P', 'I', 'D', 'M', 'P'};
+static const uint32_t API_DUMP_BINARY_FORMAT_VERSION = 2;
+
+// How an element of a pNext chain was recorded. Known structures are followed by their contents, opaque ones only by the
+// rest of the chain.
+static const uint8_t API_DUMP_BINARY_PNEXT_NULL = 0;
+static const uint8_t API_DUMP_BINARY_PNEXT_KNOWN = 1;
+static const uint8_t API_DUMP_BINARY_PNEXT_OPAQUE = 2;
+
+// An intercepted function along with the index the generator assigned to it.
+struct ApiDumpFunctionName {
+    uint32_t index;
+    const char *name;
+};
+
+// A handle type along with the index the generator assigned to it.
+struct ApiDumpObjectTypeName {
+    uint32_t index;
+    const char *name;
 };
 
 static const uint64_t OUTPUT_RANGE_UNLIMITED = 0;
@@ -244,6 +332,128 @@ class ConditionalFrameOutput {
     }
 };
 
+// The filter on the arguments of the calls set with lunarg_api_dump.filter. It is parsed once, and then tested on the
+// arguments of every call before the call is formatted. The expression is made of terms joined with "&&" and "||", "&&"
+// binding tighter, where a term is one of:
+//   handle == 0x1234      a handle the call takes or returns is the given one
+//   name == ShadowPass    a handle the call takes or returns was named so, '*' standing for any sequence of characters
+//   result == VK_SUCCESS  the call returned the value, given as VK_SUCCESS or as a number
+// and "!=" negates the term. A call which doesn't return a VkResult matches no result term.
+class ApiDumpCallFilter {
+   public:
+    enum class Subject { Handle, Name, Result };
+
+    struct Term {
+        Subject subject;
+        uint64_t handle;
+        std::string name;
+        int64_t result;
+    };
+
+    // Each term is one bit in the masks.
+    static constexpr size_t kMaxTerms = 64;
+
+    // An expression which can't be parsed leaves the filter empty, so that every call is dumped.
+    bool parse(const std::string &expression) {
+        for (const std::string &alternative : Split(expression, "||")) {
+            uint64_t conjunction = 0;
+            for (const std::string &term : Split(alternative, "&&")) {
+                if (!parseTerm(Trim(term))) {
+                    printErrorMsg(("Filter error: '" + Trim(term) + "' is not a valid term\n").c_str());
+                    *this = ApiDumpCallFilter();
+                    return false;
+                }
+                conjunction |= uint64_t(1) << (terms.size() - 1);
+            }
+            alternatives.push_back(conjunction);
+        }
+        return true;
+    }
+
+    bool enabled() const { return !alternatives.empty(); }
+
+    const std::vector<Term> &getTerms() const { return terms; }
+    bool hasNameTerms() const { return name_terms != 0; }
+
+    // found_terms has the bits of the terms whose comparison holds for the call, before they are negated.
+    bool matches(uint64_t found_terms, bool has_result) const {
+        const uint64_t true_terms = (found_terms ^ negated_terms) & (has_result ? ~uint64_t(0) : ~result_terms);
+        for (uint64_t conjunction : alternatives) {
+            if ((true_terms & conjunction) == conjunction) return true;
+        }
+        return false;
+    }
+
+   private:
+    static std::vector<std::string> Split(const std::string &text, const char *separator) {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        for (size_t found = text.find(separator); found != std::string::npos; found = text.find(separator, start)) {
+            parts.push_back(text.substr(start, found - start));
+            start = found + 2;
+        }
+        parts.push_back(text.substr(start));
+        return parts;
+    }
+
+    static std::string Trim(const std::string &text) {
+        const size_t first = text.find_first_not_of(" \t");
+        if (first == std::string::npos) return std::string();
+        return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+    }
+
+    bool parseTerm(const std::string &text) {
+        size_t op = text.find("==");
+        const bool negated = op == std::string::npos;
+        if (negated) op = text.find("!=");
+        if (op == std::string::npos || terms.size() >= kMaxTerms) return false;
+        const std::string subject = Trim(text.substr(0, op));
+        std::string value = Trim(text.substr(op + 2));
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') value = value.substr(1, value.size() - 2);
+        if (value.empty()) return false;
+
+        Term term = {Subject::Handle, 0, std::string(), 0};
+        char *end = nullptr;
+        if (subject == "handle") {
+            term.handle = std::strtoull(value.c_str(), &end, 0);
+            if (*end != '\0') return false;
+        } else if (subject == "name") {
+            term.subject = Subject::Name;
+            term.name = value;
+        } else if (subject == "result") {
+            term.subject = Subject::Result;
+            if (value != "VK_SUCCESS") {
+                term.result = std::strtoll(value.c_str(), &end, 0);
+                if (*end != '\0') return false;
+            }
+        } else {
+            return false;
+        }
+
+        const uint64_t bit = uint64_t(1) << terms.size();
+        if (negated) negated_terms |= bit;
+        if (term.subject == Subject::Name) name_terms |= bit;
+        if (term.subject == Subject::Result) result_terms |= bit;
+        terms.push_back(std::move(term));
+        return true;
+    }
+
+    void printErrorMsg(const char *msg) {
+#ifdef ANDROID
+        __android_log_print(ANDROID_LOG_DEBUG, "api_dump", "%s", msg);
+#else
+        fprintf(stderr, "%s", msg);
+#endif
+    }
+
+    std::vector<Term> terms;
+    // The terms of each alternative, one of which has to hold entirely for a call to match.
+    std::vector<uint64_t> alternatives;
+    uint64_t negated_terms = 0;
+    uint64_t name_terms = 0;
+    uint64_t result_terms = 0;
+};
+
 #ifdef __ANDROID__
 template <class char_type = char, class traits = std::char_traits<char_type>>
 class AndroidLogcatBuf final : public std::basic_streambuf<char_type, traits> {
@@ -325,13 +535,683 @@ class AndroidLogcatWriter final : public AndroidLogcatBuf<>::LogWriter {
     AndroidLogcatWriter() = default;
     void write(const std::string &content) override { __android_log_print(ANDROID_LOG_INFO, "api_dump", "%s", content.c_str()); }
 };
+
+// Coalesces the output into log entries as large as logd takes, broken at line ends, instead of one entry for every few
+// hundred bytes, so that logd neither throttles the application nor drops lines as soon. __android_log_write hands the
+// text over as it is, without the 1024 byte formatting buffer of __android_log_print.
+class AndroidLogcatBatchWriter final : public AndroidLogcatBuf<>::LogWriter {
+   public:
+    // LOGGER_ENTRY_MAX_PAYLOAD is 4068 bytes, which also holds the priority and the tag.
+    static const size_t max_payload = 4000;
+
+    AndroidLogcatBatchWriter() = default;
+    void write(const std::string &content) override {
+        size_t start = 0;
+        while (start < content.size()) {
+            size_t length = std::min(max_payload, content.size() - start);
+            if (start + length < content.size()) {
+                const size_t line_end = content.rfind('\n', start + length);
+                if (line_end != std::string::npos && line_end > start) length = line_end - start;
+            }
+            __android_log_write(ANDROID_LOG_INFO, "api_dump", content.substr(start, length).c_str());
+            start += length;
+            if (start < content.size() && content[start] == '\n') ++start;
+        }
+    }
+};
+#endif
+
+// Growable stream buffer used to stage the output of a single API call on the calling thread. Unlike std::stringbuf, reset()
+// keeps the allocation around, so once a thread has formatted its largest call no further allocations are made.
+class ApiDumpThreadBuf final : public std::streambuf {
+   public:
+    ApiDumpThreadBuf() : buffer_(initial_size) { reset(); }
+
+    const char *data() const { return pbase(); }
+    size_t size() const { return static_cast<size_t>(pptr() - pbase()); }
+    void reset() { setp(buffer_.data(), buffer_.data() + buffer_.size()); }
+
+    // Puts the staged output on a single line, dropping every line break along with the indentation which follows it.
+    void joinLines() {
+        char *out = pbase();
+        bool line_start = true;
+        for (const char *in = pbase(); in < pptr(); ++in) {
+            if (*in == '\n') {
+                line_start = true;
+            } else if (!line_start || (*in != ' ' && *in != '\t')) {
+                line_start = false;
+                *out++ = *in;
+            }
+        }
+        const size_t used = static_cast<size_t>(out - pbase());
+        reset();
+        pbump(static_cast<int>(used));
+    }
+
+    // Puts count bytes of data in front of the staged output.
+    void prepend(const char *data, size_t count) {
+        const size_t used = size();
+        if (used + count > buffer_.size()) buffer_.resize(std::max(buffer_.size() * 2, used + count));
+        memmove(buffer_.data() + count, buffer_.data(), used);
+        memcpy(buffer_.data(), data, count);
+        reset();
+        pbump(static_cast<int>(used + count));
+    }
+
+   protected:
+    int_type overflow(int_type ch) override {
+        const size_t used = size();
+        buffer_.resize(buffer_.size() * 2);
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+        pbump(static_cast<int>(used));
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+   private:
+    static const size_t initial_size = 4096;
+    std::vector<char> buffer_;
+};
+
+// Stream buffer which writes to the pipe of a compressor process. The FILE does the buffering.
+class ApiDumpPipeBuf final : public std::streambuf {
+   public:
+    explicit ApiDumpPipeBuf(FILE *pipe) : pipe_(pipe) {}
+
+   protected:
+    int_type overflow(int_type ch) override {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+        if (fputc(traits_type::to_char_type(ch), pipe_) == EOF) return traits_type::eof();
+        ++written_;
+        return ch;
+    }
+    std::streamsize xsputn(const char *s, std::streamsize count) override {
+        const size_t written = fwrite(s, 1, static_cast<size_t>(count), pipe_);
+        written_ += written;
+        return static_cast<std::streamsize>(written);
+    }
+    int sync() override { return fflush(pipe_) == 0 ? 0 : -1; }
+    // tellp() reports the number of bytes handed to the compressor, which is what output file rotation measures.
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+        if (off != 0 || dir != std::ios_base::cur) return pos_type(off_type(-1));
+        return pos_type(static_cast<off_type>(written_));
+    }
+
+   private:
+    FILE *pipe_;
+    uint64_t written_ = 0;
+};
+
+#if !defined(_WIN32)
+// Stream buffer which sends the output to a socket, for stream_output. Sending takes a system call, so the output is staged
+// in a buffer in between. Once the other end goes away, the output is dropped instead of failing the stream.
+class ApiDumpSocketBuf final : public std::streambuf {
+   public:
+    ApiDumpSocketBuf() : buffer_(buffer_size) { setp(buffer_.data(), buffer_.data() + buffer_.size()); }
+    ~ApiDumpSocketBuf() {
+        if (socket_ < 0) return;
+        sync();
+        close(socket_);
+    }
+
+    bool connect(const std::string &address) {
+        socket_ = ApiDumpOpenSocket(address, false);
+#if defined(SO_NOSIGPIPE)
+        const int no_sigpipe = 1;
+        if (socket_ >= 0) setsockopt(socket_, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+        return socket_ >= 0;
+    }
+
+   protected:
+    int_type overflow(int_type ch) override {
+        if (sync() != 0) return traits_type::eof();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override {
+        const char *data = pbase();
+        size_t remaining = static_cast<size_t>(pptr() - pbase());
+        while (remaining > 0 && connected_) {
+#if defined(MSG_NOSIGNAL)
+            const ssize_t sent = send(socket_, data, remaining, MSG_NOSIGNAL);
+#else
+            const ssize_t sent = send(socket_, data, remaining, 0);
+#endif
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent <= 0) {
+                connected_ = false;
+                break;
+            }
+            data += sent;
+            remaining -= static_cast<size_t>(sent);
+        }
+        sent_ += static_cast<uint64_t>(pptr() - pbase());
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+        return 0;
+    }
+
+    // tellp() reports the bytes written, which is what the frame boundaries are measured in.
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+        if (off != 0 || dir != std::ios_base::cur) return pos_type(off_type(-1));
+        return pos_type(static_cast<off_type>(sent_ + static_cast<uint64_t>(pptr() - pbase())));
+    }
+
+   private:
+    static const size_t buffer_size = 256 * 1024;
+    std::vector<char> buffer_;
+    int socket_ = -1;
+    bool connected_ = true;
+    uint64_t sent_ = 0;
+};
+#endif
+
+#if !defined(__ANDROID__)
+// Stream buffer which writes straight into a memory mapping of the output file. The file is grown and mapped one chunk at
+// a time, so writing a call is a copy into the mapping and the system writes the pages back whenever it likes. The pages
+// belong to the file as soon as they are written, so the output survives a crash of the application, up to the last byte
+// written. The file is cut to the length written when it is closed; after a crash it ends with the unwritten, zeroed part
+// of the last chunk instead.
+class ApiDumpMappedFileBuf final : public std::streambuf {
+   public:
+    ApiDumpMappedFileBuf() = default;
+    ~ApiDumpMappedFileBuf() { close(); }
+
+    bool open(const std::string &filename) {
+#ifdef _WIN32
+        file_ = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return false;
+#else
+        file_ = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (file_ < 0) return false;
+#endif
+        if (mapChunk(0)) return true;
+        close();
+        return false;
+    }
+
+    void close() {
+        if (!isOpen()) return;
+        const uint64_t written = chunk_offset_ + static_cast<uint64_t>(pptr() - pbase());
+        unmapChunk();
+        setp(nullptr, nullptr);
+        // If the file can't be cut, it keeps the zeroed tail of its last chunk, like after a crash.
+#ifdef _WIN32
+        LARGE_INTEGER length;
+        length.QuadPart = static_cast<LONGLONG>(written);
+        SetFilePointerEx(file_, length, nullptr, FILE_BEGIN);
+        SetEndOfFile(file_);
+        CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        const int truncated = ftruncate(file_, static_cast<off_t>(written));
+        (void)truncated;
+        ::close(file_);
+        file_ = -1;
+#endif
+    }
+
+   protected:
+    int_type overflow(int_type ch) override {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+        if (!isOpen() || !mapChunk(chunk_offset_ + chunk_size)) return traits_type::eof();
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+        return ch;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize count) override {
+        std::streamsize written = 0;
+        while (written < count) {
+            if (pptr() == epptr() && (!isOpen() || !mapChunk(chunk_offset_ + chunk_size))) break;
+            const std::streamsize room = static_cast<std::streamsize>(epptr() - pptr());
+            const std::streamsize part = std::min(room, count - written);
+            memcpy(pptr(), s + written, static_cast<size_t>(part));
+            pbump(static_cast<int>(part));
+            written += part;
+        }
+        return written;
+    }
+
+    // The mapping is the file, so there is nothing to flush.
+    int sync() override { return 0; }
+
+    // tellp() reports the bytes written, which is what output file rotation measures.
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+        if (off != 0 || dir != std::ios_base::cur) return pos_type(off_type(-1));
+        return pos_type(static_cast<off_type>(chunk_offset_ + static_cast<uint64_t>(pptr() - pbase())));
+    }
+
+   private:
+    // A multiple of the mapping granularity of every platform, and large enough that growing the file is rare.
+    static const size_t chunk_size = 16 * 1024 * 1024;
+
+#ifdef _WIN32
+    bool isOpen() const { return file_ != INVALID_HANDLE_VALUE; }
+#else
+    bool isOpen() const { return file_ >= 0; }
+#endif
+
+    // Grows the file to the end of the chunk at the given offset and maps that chunk in place of the current one, which
+    // is full by then. If that fails, everything before the offset has still been written.
+    bool mapChunk(uint64_t offset) {
+        unmapChunk();
+        setp(nullptr, nullptr);
+        chunk_offset_ = offset;
+        const uint64_t end = offset + chunk_size;
+#ifdef _WIN32
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(end >> 32), static_cast<DWORD>(end),
+                                      nullptr);
+        if (mapping_ == nullptr) return false;
+        void *view =
+            MapViewOfFile(mapping_, FILE_MAP_WRITE, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), chunk_size);
+        if (view == nullptr) {
+            CloseHandle(mapping_);
+            mapping_ = nullptr;
+            return false;
+        }
+#else
+        if (ftruncate(file_, static_cast<off_t>(end)) != 0) return false;
+        void *view = mmap(nullptr, chunk_size, PROT_READ | PROT_WRITE, MAP_SHARED, file_, static_cast<off_t>(offset));
+        if (view == MAP_FAILED) return false;
+#endif
+        view_ = static_cast<char *>(view);
+        setp(view_, view_ + chunk_size);
+        return true;
+    }
+
+    void unmapChunk() {
+        if (view_ == nullptr) return;
+#ifdef _WIN32
+        UnmapViewOfFile(view_);
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+#else
+        munmap(view_, chunk_size);
+#endif
+        view_ = nullptr;
+    }
+
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int file_ = -1;
+#endif
+    char *view_ = nullptr;
+    uint64_t chunk_offset_ = 0;
+};
+#endif
+
+#if defined(_WIN32) || defined(API_DUMP_IO_URING)
+// Stream buffer which writes the output file with asynchronous I/O: io_uring on Linux and overlapped I/O on Windows. The
+// output is gathered in a few large buffers, and each buffer is queued to the system once it is full while the next one is
+// filled, so that the writer only waits for the disk when every buffer is in flight. With direct I/O the writes bypass the
+// page cache, which needs the buffers, lengths and file offsets aligned: the last buffer is written padded with zeros, and
+// the file is cut to the length written when it is closed.
+class ApiDumpQueuedFileBuf final : public std::streambuf {
+   public:
+    ApiDumpQueuedFileBuf() = default;
+    ~ApiDumpQueuedFileBuf() { close(); }
+
+    bool open(const std::string &filename, uint32_t queue_depth, bool direct) {
+        direct_ = direct;
+        failed_ = false;
+        file_offset_ = 0;
+        current_ = 0;
+#ifdef _WIN32
+        DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED;
+        if (direct) flags |= FILE_FLAG_NO_BUFFERING;
+        file_ = CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, flags, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return false;
+#else
+        file_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | (direct ? O_DIRECT : 0), 0644);
+        if (file_ < 0) return false;
+        if (!setupRing(queue_depth)) {
+            close();
+            return false;
+        }
+#endif
+        buffers_ = std::vector<Buffer>(std::max(queue_depth, 2u));
+        for (Buffer &buffer : buffers_) {
+            buffer.storage.resize(buffer_size + alignment);
+            void *data = buffer.storage.data();
+            size_t space = buffer.storage.size();
+            buffer.data = static_cast<char *>(std::align(alignment, buffer_size, data, space));
+#ifdef _WIN32
+            buffer.overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+            if (buffer.overlapped.hEvent == nullptr) {
+                close();
+                return false;
+            }
+#endif
+        }
+        setp(buffers_[0].data, buffers_[0].data + buffer_size);
+        return true;
+    }
+
+    // Writes out what is left, waits for every write and cuts the padding off the end of the file.
+    void close() {
+        if (isOpen() && !buffers_.empty()) {
+            const uint64_t written = file_offset_ + static_cast<uint64_t>(pptr() - pbase());
+            if (pptr() > pbase()) submit(current_, static_cast<size_t>(pptr() - pbase()));
+            for (Buffer &buffer : buffers_) wait(buffer);
+            setp(nullptr, nullptr);
+            if (direct_) {
+#ifdef _WIN32
+                FILE_END_OF_FILE_INFO end_of_file = {};
+                end_of_file.EndOfFile.QuadPart = static_cast<LONGLONG>(written);
+                SetFileInformationByHandle(file_, FileEndOfFileInfo, &end_of_file, sizeof(end_of_file));
+#else
+                const int truncated = ftruncate(file_, static_cast<off_t>(written));
+                (void)truncated;
+#endif
+            }
+        }
+#ifdef _WIN32
+        for (Buffer &buffer : buffers_) {
+            if (buffer.overlapped.hEvent != nullptr) CloseHandle(buffer.overlapped.hEvent);
+        }
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        closeRing();
+        if (file_ >= 0) ::close(file_);
+        file_ = -1;
+#endif
+        buffers_.clear();
+    }
+
+   protected:
+    int_type overflow(int_type ch) override {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+        if (!isOpen() || !nextBuffer()) return traits_type::eof();
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+        return ch;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize count) override {
+        std::streamsize written = 0;
+        while (written < count) {
+            if (pptr() == epptr() && (!isOpen() || !nextBuffer())) break;
+            const std::streamsize room = static_cast<std::streamsize>(epptr() - pptr());
+            const std::streamsize part = std::min(room, count - written);
+            memcpy(pptr(), s + written, static_cast<size_t>(part));
+            pbump(static_cast<int>(part));
+            written += part;
+        }
+        return written;
+    }
+
+    // Writes the part of the current buffer filled so far and waits for every write, so that a flush puts everything in
+    // the file. The buffer then keeps being filled, and is written again from its start once it is full.
+    int sync() override {
+        if (!isOpen() || buffers_.empty()) return 0;
+        if (pptr() > pbase()) submit(current_, static_cast<size_t>(pptr() - pbase()));
+        for (Buffer &buffer : buffers_) wait(buffer);
+        return failed_ ? -1 : 0;
+    }
+
+    // tellp() reports the bytes written, which is what output file rotation measures.
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+        if (off != 0 || dir != std::ios_base::cur) return pos_type(off_type(-1));
+        return pos_type(static_cast<off_type>(file_offset_ + static_cast<uint64_t>(pptr() - pbase())));
+    }
+
+   private:
+    // The asynchronous writer hands over up to 1 MB at a time. Direct I/O needs the sector size of the disk, which 4096 is a
+    // multiple of.
+    static const size_t buffer_size = 1024 * 1024;
+    static const size_t alignment = 4096;
+
+    struct Buffer {
+        std::vector<char> storage;
+        char *data = nullptr;
+        uint64_t offset = 0;
+        size_t length = 0;
+        bool in_flight = false;
+#ifdef _WIN32
+        OVERLAPPED overlapped = {};
+#else
+        iovec iov = {};
+#endif
+    };
+
+#ifdef _WIN32
+    bool isOpen() const { return file_ != INVALID_HANDLE_VALUE; }
+#else
+    bool isOpen() const { return file_ >= 0; }
+#endif
+
+    // Queues the full current buffer and moves on to the next one, once the write it was last queued for is done.
+    bool nextBuffer() {
+        if (failed_) return false;
+        submit(current_, buffer_size);
+        file_offset_ += buffer_size;
+        current_ = (current_ + 1) % buffers_.size();
+        wait(buffers_[current_]);
+        if (failed_) return false;
+        setp(buffers_[current_].data, buffers_[current_].data + buffer_size);
+        return true;
+    }
+
+    // Queues a write of the start of a buffer at the offset the current buffer starts at.
+    void submit(size_t index, size_t length) {
+        Buffer &buffer = buffers_[index];
+        if (direct_ && length % alignment != 0) {
+            const size_t padded = (length + alignment - 1) / alignment * alignment;
+            memset(buffer.data + length, 0, padded - length);
+            length = padded;
+        }
+        buffer.offset = file_offset_;
+        buffer.length = length;
+        buffer.in_flight = true;
+#ifdef _WIN32
+        buffer.overlapped.Offset = static_cast<DWORD>(buffer.offset);
+        buffer.overlapped.OffsetHigh = static_cast<DWORD>(buffer.offset >> 32);
+        if (!WriteFile(file_, buffer.data, static_cast<DWORD>(length), nullptr, &buffer.overlapped) &&
+            GetLastError() != ERROR_IO_PENDING) {
+            buffer.in_flight = false;
+            failed_ = true;
+        }
+#else
+        buffer.iov.iov_base = buffer.data;
+        buffer.iov.iov_len = length;
+        // Only the writing thread adds entries, and there are never more in flight than buffers, so there is always room.
+        const unsigned tail = *sq_tail_;
+        const unsigned entry = tail & sq_mask_;
+        io_uring_sqe &sqe = sqes_[entry];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITEV;
+        sqe.fd = file_;
+        sqe.addr = reinterpret_cast<uint64_t>(&buffer.iov);
+        sqe.len = 1;
+        sqe.off = buffer.offset;
+        sqe.user_data = index;
+        sq_array_[entry] = entry;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        long result;
+        do {
+            result = syscall(__NR_io_uring_enter, ring_, 1, 0, 0, nullptr, 0);
+        } while (result < 0 && errno == EINTR);
+        if (result < 0) {
+            buffer.in_flight = false;
+            failed_ = true;
+        }
+#endif
+    }
+
+    void wait(Buffer &buffer) {
+#ifdef _WIN32
+        if (!buffer.in_flight) return;
+        buffer.in_flight = false;
+        DWORD written = 0;
+        if (!GetOverlappedResult(file_, &buffer.overlapped, &written, TRUE) || written != buffer.length) failed_ = true;
+#else
+        while (buffer.in_flight) {
+            const unsigned head = *cq_head_;
+            if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+                if (syscall(__NR_io_uring_enter, ring_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+                    // The ring can't be waited on any more, so whatever is in flight is given up for lost.
+                    for (Buffer &lost : buffers_) lost.in_flight = false;
+                    failed_ = true;
+                }
+                continue;
+            }
+            const io_uring_cqe &completion = cqes_[head & cq_mask_];
+            complete(buffers_[static_cast<size_t>(completion.user_data)], completion.res);
+            __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        }
+#endif
+    }
+
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+#else
+    // The rest of a short write is written synchronously, which only happens when the disk is full or on a signal.
+    void complete(Buffer &buffer, int result) {
+        buffer.in_flight = false;
+        if (result < 0) {
+            failed_ = true;
+            return;
+        }
+        size_t done = static_cast<size_t>(result);
+        while (done < buffer.length) {
+            const ssize_t written =
+                pwrite(file_, buffer.data + done, buffer.length - done, static_cast<off_t>(buffer.offset + done));
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) {
+                failed_ = true;
+                return;
+            }
+            done += static_cast<size_t>(written);
+        }
+    }
+
+    // Maps the queues of a new ring the way the kernel lays them out, which also works with kernels older than single mmap.
+    bool setupRing(uint32_t entries) {
+        io_uring_params params = {};
+        ring_ = static_cast<int>(syscall(__NR_io_uring_setup, std::max(entries, 2u), &params));
+        if (ring_ < 0) return false;
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+        single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+#endif
+        if (single_mmap) sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQ_RING);
+        if (sq_ring_ == MAP_FAILED) return false;
+        cq_ring_ = single_mmap ? sq_ring_
+                               : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_,
+                                      IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) return false;
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+        sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+        char *sq = static_cast<char *>(sq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        char *cq = static_cast<char *>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    void closeRing() {
+        if (sqes_ != nullptr) munmap(sqes_, sqes_size_);
+        if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_ != MAP_FAILED) munmap(sq_ring_, sq_ring_size_);
+        if (ring_ >= 0) ::close(ring_);
+        sqes_ = nullptr;
+        sq_ring_ = MAP_FAILED;
+        cq_ring_ = MAP_FAILED;
+        ring_ = -1;
+    }
+
+    int file_ = -1;
+    int ring_ = -1;
+    void *sq_ring_ = MAP_FAILED;
+    void *cq_ring_ = MAP_FAILED;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    size_t sqes_size_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    unsigned *sq_tail_ = nullptr;
+    unsigned *sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+#endif
+    std::vector<Buffer> buffers_;
+    size_t current_ = 0;
+    uint64_t file_offset_ = 0;
+    bool direct_ = false;
+    bool failed_ = false;
+};
+#endif
+
+// Moves the calling thread to a CPU of its own and changes its scheduling priority, for the asynchronous writer. Either is
+// skipped where the platform doesn't support it, or if the process isn't allowed to.
+inline void ApiDumpConfigureWriterThread(int cpu, int priority) {
+#if defined(_WIN32)
+    if (cpu >= 0 && cpu < 64) SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu);
+    if (priority > 0) SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+    if (priority < 0) SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__) && !defined(__ANDROID__)
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        sched_setaffinity(0, sizeof(cpus), &cpus);
+    }
+    // The nice value of a Linux thread is its own. Raising the priority needs CAP_SYS_NICE.
+    if (priority != 0) setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), priority > 0 ? -10 : 10);
+#else
+    (void)cpu;
+    (void)priority;
 #endif
+}
+
+// One file of split output, which the threads writing to it lock instead of the output mutex.
+struct ApiDumpSplitOutput {
+    std::mutex mutex;
+    std::ofstream file;
+};
+
+struct ApiDumpThreadOutput {
+    explicit ApiDumpThreadOutput(char fill) : stream(&buffer) { stream << std::setfill(fill); }
+
+    ApiDumpThreadBuf buffer;
+    std::ostream stream;
+};
 
 class ApiDumpSettings {
    public:
     ApiDumpSettings() : output_stream(std::cout.rdbuf()) {
 #ifdef __ANDROID__
-        android_logcat_buf = std::make_unique<AndroidLogcatBuf<>>(std::make_unique<AndroidLogcatWriter>());
+        if (readBoolOption("lunarg_api_dump.logcat_batching", false)) {
+            android_logcat_buf = std::make_unique<AndroidLogcatBuf<>>(std::make_unique<AndroidLogcatBatchWriter>(),
+                                                                      AndroidLogcatBatchWriter::max_payload);
+        } else {
+            android_logcat_buf = std::make_unique<AndroidLogcatBuf<>>(std::make_unique<AndroidLogcatWriter>());
+        }
         output_stream.rdbuf(android_logcat_buf.get());
 #endif
         std::string filename_string = "";
@@ -356,27 +1236,110 @@ class ApiDumpSettings {
         if (!env_value.empty()) {
             filename_string = env_value;
         }
-        // If one of the above has set a filename, open the file as an output stream.
-        if (!filename_string.empty()) {
-            output_file_stream.open(filename_string, std::ofstream::out | std::ostream::trunc);
-            output_stream.rdbuf(output_file_stream.rdbuf());
+#ifdef __ANDROID__
+        // The working directory of an application can't be written to, so a relative file name is put in the external
+        // files directory of the application instead, which needs no permission.
+        if (!filename_string.empty() && filename_string[0] != '/') {
+            filename_string = androidExternalFilesDirectory() + "/" + filename_string;
         }
+#endif
 
-        // Get the remaining settings (some we also want to provide the ability to override
-        // using environment variables).
-
+        // The format decides how the output file is opened, so get it before the remaining settings (some we also want
+        // to provide the ability to override using environment variables).
         output_format = readFormatOption("lunarg_api_dump.output_format", ApiDumpFormat::Text);
         env_value = GetPlatformEnvVar(API_DUMP_ENV_VAR_OUTPUT_FMT);
         if (!env_value.empty()) {
             if (ToLowerString(env_value) == "html") {
                 output_format = ApiDumpFormat::Html;
-            } else if (ToLowerString(env_value) == "json") {
+            } else if (ToLowerString(env_value) == "json" || ToLowerString(env_value) == "ndjson") {
                 output_format = ApiDumpFormat::Json;
+            } else if (ToLowerString(env_value) == "binary") {
+                output_format = ApiDumpFormat::Binary;
+            } else if (ToLowerString(env_value) == "stats") {
+                output_format = ApiDumpFormat::Stats;
+            } else if (ToLowerString(env_value) == "trace") {
+                output_format = ApiDumpFormat::Trace;
             } else {
                 output_format = ApiDumpFormat::Text;
             }
         }
 
+        // NDJSON is the JSON format with every call as a line of its own instead of inside an array of frames, so that the
+        // output can be read while it is written and stays readable up to the last call if the application crashes.
+        const char *format_option = getLayerOption("lunarg_api_dump.output_format");
+        const std::string format_string = !env_value.empty() ? env_value : (format_option != NULL ? format_option : "");
+        json_lines = ToLowerString(format_string) == "ndjson";
+
+        // The flight recorder keeps binary records, and writes them out as a binary capture.
+        flight_recorder_size = static_cast<size_t>(std::max(readIntOption("lunarg_api_dump.flight_recorder", 0), 0)) * 1024;
+        if (flight_recorder_size > 0) output_format = ApiDumpFormat::Binary;
+        flight_recorder_spikes = flight_recorder_size > 0 && readBoolOption("lunarg_api_dump.flight_recorder_spikes", false);
+
+        // The output can be streamed to a receiver on another machine instead of being written to a file, in which case
+        // nothing is written to the local file system. If the receiver can't be reached, the output goes where it would
+        // have gone otherwise.
+#if !defined(_WIN32)
+        const char *stream_option = getLayerOption("lunarg_api_dump.stream_output");
+        if (stream_option != NULL && stream_option[0] != '\0') {
+            socket_buf = std::make_unique<ApiDumpSocketBuf>();
+            if (socket_buf->connect(stream_option)) {
+                output_stream.rdbuf(socket_buf.get());
+                filename_string.clear();
+            } else {
+                socket_buf.reset();
+            }
+        }
+#endif
+
+        // A binary capture can't go through stdout or logcat without being mangled, so it always goes to a file.
+        if (output_format == ApiDumpFormat::Binary && filename_string.empty() && !streamsOutput()) {
+            filename_string = "vk_apidump.bin";
+        }
+
+        std::string compression_string;
+        env_value = GetPlatformEnvVar(API_DUMP_ENV_VAR_COMPRESSION);
+        if (!env_value.empty()) {
+            compression_string = env_value;
+        } else {
+            const char *compression_option = getLayerOption("lunarg_api_dump.compression");
+            if (compression_option != NULL) compression_string = compression_option;
+        }
+
+        // The output file is written through a memory mapping instead of a file stream, unless it is compressed.
+        mapped_output = readBoolOption("lunarg_api_dump.mapped_output", false);
+        // Or with asynchronous I/O, which keeps queue_depth buffers of 1 MB in flight, where the system has it.
+        queued_output = readBoolOption("lunarg_api_dump.queued_output", false) && !mapped_output;
+        queue_depth = static_cast<uint32_t>(std::max(readIntOption("lunarg_api_dump.queue_depth", 4), 2));
+        direct_io = queued_output && readBoolOption("lunarg_api_dump.direct_io", false);
+
+        // Rotation starts a new file at the first frame boundary after the current file grew past the size or the frame
+        // count, and deletes the oldest file once there are more than rotate_count of them.
+        rotate_size = static_cast<uint64_t>(std::max(readIntOption("lunarg_api_dump.rotate_size", 0), 0)) * 1024 * 1024;
+        rotate_frames = static_cast<uint64_t>(std::max(readIntOption("lunarg_api_dump.rotate_frames", 0), 0));
+        rotate_count = static_cast<uint64_t>(std::max(readIntOption("lunarg_api_dump.rotate_count", 4), 1));
+        if (filename_string.empty()) {
+            rotate_size = 0;
+            rotate_frames = 0;
+        }
+        // Html pages are rotated files which are all kept, with an index page linking to the frames in them.
+        html_page_frames = static_cast<uint64_t>(std::max(readIntOption("lunarg_api_dump.html_pages", 0), 0));
+        if (output_format != ApiDumpFormat::Html || filename_string.empty()) html_page_frames = 0;
+        if (html_page_frames > 0) {
+            rotate_size = 0;
+            rotate_frames = html_page_frames;
+            rotate_count = UINT64_MAX;
+        }
+
+        // If one of the above has set a filename, open the file as an output stream.
+        output_filename = filename_string;
+        output_compression = ToLowerString(compression_string);
+        // The frame index gives the offset of every frame in the output file, which a compressed file can't seek to.
+        frame_index = readBoolOption("lunarg_api_dump.frame_index", false);
+        if (!filename_string.empty()) {
+            openOutputFile(rotatesOutput() ? rotatedFileName(0) : filename_string);
+        }
+        if (html_page_frames > 0) openHtmlIndex();
+
         show_params = readBoolOption("lunarg_api_dump.detailed", true);
         env_value = GetPlatformEnvVar(API_DUMP_ENV_VAR_DETAILED_OUTPUT);
         if (!env_value.empty()) {
@@ -408,7 +1371,118 @@ class ApiDumpSettings {
         type_size = std::max(readIntOption("lunarg_api_dump.type_size", 0), 0);
         use_spaces = readBoolOption("lunarg_api_dump.use_spaces", true);
         show_shader = readBoolOption("lunarg_api_dump.show_shader", false);
+        max_array_elements = static_cast<size_t>(std::max(readIntOption("lunarg_api_dump.max_array_elements", 0), 0));
+        max_string_length = static_cast<size_t>(std::max(readIntOption("lunarg_api_dump.max_string_length", 0), 0));
+        env_value = GetPlatformEnvVar(API_DUMP_ENV_VAR_SHADER_DIRECTORY);
+        if (!env_value.empty()) {
+            shader_directory = env_value;
+        } else {
+            const char *shader_directory_option = getLayerOption("lunarg_api_dump.shader_directory");
+            if (shader_directory_option != NULL) shader_directory = shader_directory_option;
+        }
         show_thread_and_frame = readBoolOption("lunarg_api_dump.show_thread_and_frame", true);
+        thread_buffering = readBoolOption("lunarg_api_dump.thread_buffering", false);
+        async_output = readBoolOption("lunarg_api_dump.async_output", false);
+        writer_cpu = readIntOption("lunarg_api_dump.writer_cpu", -1);
+        const char *priority_option = getLayerOption("lunarg_api_dump.writer_priority");
+        const std::string priority_string = ToLowerString(priority_option != NULL ? priority_option : "");
+        writer_priority = priority_string == "high" ? 1 : (priority_string == "low" ? -1 : 0);
+        // Sending to the socket is left to the writer thread, so that the calls don't wait on the network.
+        if (streamsOutput()) async_output = true;
+        // The async writer consumes the per-thread buffers, so it implies thread buffering. Binary records are prefixed
+        // with their size, which is only known once the whole call has been staged.
+        if (async_output || output_format == ApiDumpFormat::Binary) thread_buffering = true;
+        // A call is only put on a single line once it is complete.
+        if (json_lines) thread_buffering = true;
+        if (flight_recorder_size > 0) async_output = false;
+
+        // Split output gives every thread and/or device a binary capture file of its own, which only its own calls lock.
+        std::string split_string;
+        env_value = GetPlatformEnvVar(API_DUMP_ENV_VAR_SPLIT_OUTPUT);
+        if (!env_value.empty()) {
+            split_string = ToLowerString(env_value);
+        } else {
+            const char *split_option = getLayerOption("lunarg_api_dump.split_output");
+            if (split_option != NULL) split_string = ToLowerString(split_option);
+        }
+        if (output_format == ApiDumpFormat::Binary && flight_recorder_size == 0 && !streamsOutput()) {
+            split_by_thread = split_string == "thread" || split_string == "device_thread";
+            split_by_device = split_string == "device" || split_string == "device_thread";
+        }
+        if (splitsOutput()) async_output = false;
+        // Statistics are written by the layer itself rather than by the calls, so there is nothing to hand to a writer
+        // thread, and buffering keeps the calls from taking the output lock.
+        stats_per_frame = readBoolOption("lunarg_api_dump.stats_per_frame", false);
+        stats_json = readBoolOption("lunarg_api_dump.stats_json", false);
+        object_stats = readBoolOption("lunarg_api_dump.object_stats", false) && output_format == ApiDumpFormat::Stats;
+        memory_stats = readBoolOption("lunarg_api_dump.memory_stats", false) &&
+                       (output_format == ApiDumpFormat::Stats || output_format == ApiDumpFormat::Trace);
+        pipeline_stats = readBoolOption("lunarg_api_dump.pipeline_stats", false) && output_format == ApiDumpFormat::Stats;
+        submit_latency = readBoolOption("lunarg_api_dump.submit_latency", false) && output_format == ApiDumpFormat::Stats;
+        overhead_stats = readBoolOption("lunarg_api_dump.overhead_stats", false);
+        redundant_state = readBoolOption("lunarg_api_dump.redundant_state", false);
+        // The Stats format dumps no calls, so there is no output to step down from.
+        if (output_format != ApiDumpFormat::Stats) {
+            max_overhead_percent = static_cast<uint32_t>(std::max(readIntOption("lunarg_api_dump.max_overhead_percent", 0), 0));
+        }
+        if (output_format == ApiDumpFormat::Stats) {
+            async_output = false;
+            thread_buffering = true;
+        }
+        // Deferred formatting leaves the text formats to the writer thread, so there has to be one.
+        deferred_formatting = readBoolOption("lunarg_api_dump.deferred_formatting", false) && async_output &&
+                              (output_format == ApiDumpFormat::Text || output_format == ApiDumpFormat::Html ||
+                               output_format == ApiDumpFormat::Json);
+        // Repeated calls are found by comparing the text of each call with the previous call of its thread, so the calls
+        // have to be formatted into the buffer of the thread which made them.
+        collapse_repeats = readBoolOption("lunarg_api_dump.collapse_repeats", false) && output_format == ApiDumpFormat::Text;
+        // The commands recorded into a command buffer are formatted by the thread which records them, and kept until the
+        // command buffer is submitted.
+        command_buffer_capture =
+            readBoolOption("lunarg_api_dump.command_buffer_capture", false) && output_format == ApiDumpFormat::Text;
+        // The vkCmd* calls are only counted, and each command buffer gets one summary when its recording ends, which is
+        // written with the live counts rather than replayed.
+        command_buffer_summary =
+            readBoolOption("lunarg_api_dump.command_buffer_summary", false) && output_format == ApiDumpFormat::Text;
+        if (command_buffer_summary) {
+            command_buffer_capture = false;
+            deferred_formatting = false;
+        }
+        // Queries are told apart by their text, which is formatted by the thread which made them.
+        memoize_queries = readBoolOption("lunarg_api_dump.memoize_queries", false) && output_format == ApiDumpFormat::Text;
+        if (collapse_repeats || command_buffer_capture || memoize_queries) {
+            thread_buffering = true;
+            deferred_formatting = false;
+        }
+
+        std::string function_filter_string;
+        env_value = GetPlatformEnvVar(API_DUMP_ENV_VAR_FUNCTION_FILTER);
+        if (!env_value.empty()) {
+            function_filter_string = env_value;
+        } else {
+            const char *function_filter_option = getLayerOption("lunarg_api_dump.function_filter");
+            if (function_filter_option != NULL) function_filter_string = function_filter_option;
+        }
+        parseFunctionFilter(function_filter_string);
+
+        // Label names are compared as they are begun, which is rare enough that the patterns are matched every time.
+        const char *label_scopes_option = getLayerOption("lunarg_api_dump.label_scopes");
+        if (label_scopes_option != NULL) {
+            std::stringstream stream(label_scopes_option);
+            std::string entry;
+            while (std::getline(stream, entry, ',')) {
+                const size_t first = entry.find_first_not_of(" \t");
+                if (first == std::string::npos) continue;
+                label_scopes.push_back(entry.substr(first, entry.find_last_not_of(" \t") - first + 1));
+            }
+        }
+
+        // The head of a call is formatted before the call is made, so it has to be staged until the filter is tested on the
+        // arguments the call returned.
+        const char *call_filter_option = getLayerOption("lunarg_api_dump.filter");
+        if (call_filter_option != NULL && call_filter_option[0] != '\0' && call_filter.parse(call_filter_option)) {
+            thread_buffering = true;
+        }
 
         std::string cond_range_string;
         env_value = GetPlatformEnvVar(API_DUMP_ENV_VAR_OUTPUT_RANGE);
@@ -427,6 +1501,23 @@ class ApiDumpSettings {
             }
         }
 
+        // Sampling only keeps one of every sample_calls calls of each function, and one frame out of every sample_frames
+        // frames of the output range. A value of 0 or 1 keeps everything.
+        sample_calls = static_cast<uint32_t>(std::max(readIntOption("lunarg_api_dump.sample_calls", 0), 0));
+        sample_frames = static_cast<uint64_t>(std::max(readIntOption("lunarg_api_dump.sample_frames", 0), 0));
+
+        frame_delimiter = readFrameDelimiterOption("lunarg_api_dump.frame_delimiter", ApiDumpFrameDelimiter::Present);
+        frame_delimiter_submits = static_cast<uint32_t>(std::max(readIntOption("lunarg_api_dump.frame_delimiter_submits", 1), 1));
+        const char *frame_delimiter_label_option = getLayerOption("lunarg_api_dump.frame_delimiter_label");
+        if (frame_delimiter_label_option != NULL) frame_delimiter_label = frame_delimiter_label_option;
+        if (frame_delimiter == ApiDumpFrameDelimiter::Label && frame_delimiter_label.empty()) {
+            frame_delimiter = ApiDumpFrameDelimiter::Present;
+        }
+
+        // Disarmed, nothing is dumped until the layer is armed at a frame boundary, which is what ApiDumpSetArmed() and,
+        // outside of Windows, SIGUSR2 ask for.
+        start_disarmed = readBoolOption("lunarg_api_dump.disarmed", false);
+
         // Setfill stays active for the duration of the stream. Setting it during construction
         // means it doesn't have to be set again whenever setw() is called.
         output_stream << std::setfill(use_spaces ? ' ' : '\t');
@@ -434,113 +1525,9 @@ class ApiDumpSettings {
         if (!use_spaces) {
             indent_size = 1;  // setting this allows indentation to not need a branch on use_spaces
         }
+        padding.assign(256, use_spaces ? ' ' : '\t');
 
-        // Generate HTML heading if specified
-        if (output_format == ApiDumpFormat::Html) {
-            // clang-format off
-            // Insert html heading
-            output_stream <<
-                "<!doctype html>"
-                "<html>"
-                    "<head>"
-                        "<title>Vulkan API Dump</title>"
-                        "<style type='text/css'>"
-                        "html {"
-                            "background-color: #0b1e48;"
-                            "background-image: url('https://vulkan.lunarg.com/img/bg-starfield.jpg');"
-                            "background-position: center;"
-                            "-webkit-background-size: cover;"
-                            "-moz-background-size: cover;"
-                            "-o-background-size: cover;"
-                            "background-size: cover;"
-                            "background-attachment: fixed;"
-                            "background-repeat: no-repeat;"
-                            "height: 100%;"
-                        "}"
-                        "#header {"
-                            "z-index: -1;"
-                        "}"
-                        "#header>img {"
-                            "position: absolute;"
-                            "width: 160px;"
-                            "margin-left: -280px;"
-                            "top: -10px;"
-                            "left: 50%;"
-                        "}"
-                        "#header>h1 {"
-                            "font-family: Arial, 'Helvetica Neue', Helvetica, sans-serif;"
-                            "font-size: 44px;"
-                            "font-weight: 200;"
-                            "text-shadow: 4px 4px 5px #000;"
-                            "color: #eee;"
-                            "position: absolute;"
-                            "width: 400px;"
-                            "margin-left: -80px;"
-                            "top: 8px;"
-                            "left: 50%;"
-                        "}"
-                        "body {"
-                            "font-family: Consolas, monaco, monospace;"
-                            "font-size: 14px;"
-                            "line-height: 20px;"
-                            "color: #eee;"
-                            "height: 100%;"
-                            "margin: 0;"
-                            "overflow: hidden;"
-                        "}"
-                        "#wrapper {"
-                            "background-color: rgba(0, 0, 0, 0.7);"
-                            "border: 1px solid #446;"
-                            "box-shadow: 0px 0px 10px #000;"
-                            "padding: 8px 12px;"
-                            "display: inline-block;"
-                            "position: absolute;"
-                            "top: 80px;"
-                            "bottom: 25px;"
-                            "left: 50px;"
-                            "right: 50px;"
-                            "overflow: auto;"
-                        "}"
-                        "details>*:not(summary) {"
-                            "margin-left: 22px;"
-                        "}"
-                        "summary:only-child {"
-                          "display: block;"
-                          "padding-left: 15px;"
-                        "}"
-                        "details>summary:only-child::-webkit-details-marker {"
-                            "display: none;"
-                            "padding-left: 15px;"
-                        "}"
-                        ".var, .type, .val {"
-                            "display: inline;"
-                            "margin: 0 6px;"
-                        "}"
-                        ".type {"
-                            "color: #acf;"
-                        "}"
-                        ".val {"
-                            "color: #afa;"
-                            "text-align: right;"
-                        "}"
-                        ".thd {"
-                            "color: #888;"
-                        "}"
-                        ".time {"
-                            "color: #888;"
-                        "}"
-                        "</style>"
-                    "</head>"
-                    "<body>"
-                        "<div id='header'>"
-                            "<img src='https://lunarg.com/wp-content/uploads/2016/02/LunarG-wReg-150.png' />"
-                            "<h1>Vulkan API Dump</h1>"
-                        "</div>"
-                        "<div id='wrapper'>";
-            // clang-format on
-        } else if (output_format == ApiDumpFormat::Json) {
-            output_stream << "[\n";
-        }
+        writeFileHeader();
 
         if (isFrameInRange(0)) {
             setupInterFrameOutputFormatting(0);
@@ -548,24 +1535,22 @@ class ApiDumpSettings {
     }
 
     ~ApiDumpSettings() {
-        if (output_format == ApiDumpFormat::Html) {
-            // Close off html
-            output_stream << "</div></body></html>";
-        } else if (output_format == ApiDumpFormat::Json) {
-            // Close off json
-            output_stream << "\n]" << std::endl;
-        }
+        writeFileFooter();
+        closeOutputFile();
+        closeHtmlIndex();
     }
 
     void setupInterFrameOutputFormatting(uint64_t frame_count) const /*name change? */
     {
-        static bool hasPrintedAFrame = false;
+        if (frame_count > 0 && isFrameInRange(frame_count - 1)) {
+            closeFrameOutput();
+            indexFrame(frame_count - 1);
+        }
+        if (frame_count > 0 && shouldRotateOutput(frame_count)) rotateOutputFile(frame_count);
+        if (isFrameInRange(frame_count)) startFrameIndex();
         switch (format()) {
             case (ApiDumpFormat::Html):
-                if (frame_count > 0) {
-                    if (condFrameOutput.isFrameInRange(frame_count - 1)) output_stream << "</details>";
-                }
-                if (condFrameOutput.isFrameInRange(frame_count)) {
+                if (isFrameInRange(frame_count)) {
                     output_stream << "<details class='frm'><summary>Frame ";
                     if (show_thread_and_frame) {
                         output_stream << frame_count;
@@ -575,22 +1560,19 @@ class ApiDumpSettings {
                 break;
 
             case (ApiDumpFormat::Json):
-
-                if (frame_count > 0) {
-                    if (condFrameOutput.isFrameInRange(frame_count - 1)) output_stream << "\n" << indentation(1) << "]\n}";
-                }
-                if (condFrameOutput.isFrameInRange(frame_count)) {
-                    if (!hasPrintedAFrame) {
-                        hasPrintedAFrame = true;
+                if (json_lines) break;
+                if (isFrameInRange(frame_count)) {
+                    if (!json_frame_written) {
+                        json_frame_written = true;
                     } else {
                         output_stream << ",\n";
                     }
                     output_stream << "{\n";
                     if (show_thread_and_frame) {
-                        output_stream << indentation(1) << "\"frameNumber\" : \"" << frame_count << "\",\n";
+                        output_stream << std::setw(indent_size) << "" << "\"frameNumber\" : \"" << frame_count << "\",\n";
                     }
-                    output_stream << indentation(1) << "\"apiCalls\" :\n";
-                    output_stream << indentation(1) << "[\n";
+                    output_stream << std::setw(indent_size) << "" << "\"apiCalls\" :\n";
+                    output_stream << std::setw(indent_size) << "" << "[\n";
                 }
                 break;
             case (ApiDumpFormat::Text):
@@ -598,6 +1580,9 @@ class ApiDumpSettings {
             default:
                 break;
         }
+        // Everything up to the frame boundary reaches the compressor, which completes the file even if the application
+        // then crashes.
+        if (compression_pipe != nullptr) output_stream.flush();
     }
 
     void closeFrameOutput() const {
@@ -606,7 +1591,7 @@ class ApiDumpSettings {
                 output_stream << "</details>";
                 break;
             case (ApiDumpFormat::Json):
-                output_stream << "\n" << indentation(1) << "]\n}";
+                if (!json_lines) output_stream << "\n" << std::setw(indent_size) << "" << "]\n}";
                 break;
             case (ApiDumpFormat::Text):
                 break;
@@ -615,180 +1600,3306 @@ class ApiDumpSettings {
         }
     }
 
+    // Adds the frame which was just closed to the frame index and the html index page, as everything written since it
+    // started.
+    void indexFrame(uint64_t frame) const {
+        if (!frame_index_stream.is_open() && !html_index_stream.is_open()) return;
+        const std::streampos end = output_stream.tellp();
+        if (end == std::streampos(-1) || static_cast<uint64_t>(end) < frame_start_offset) return;
+        const ApiDumpFrameIndexEntry entry = {frame, frame_start_offset, static_cast<uint64_t>(end) - frame_start_offset};
+        if (frame_index_stream.is_open()) {
+            frame_index_stream.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+            if (should_flush) frame_index_stream.flush();
+        }
+        if (html_index_stream.is_open()) writeHtmlIndexRow(entry);
+    }
+
+    bool htmlPages() const { return html_page_frames > 0; }
+
+    // Counts a call dumped in the given frame, for the html index page.
+    void countHtmlPageCall(uint64_t frame) const {
+        std::lock_guard<std::mutex> lg(html_frame_calls_mutex);
+        ++html_frame_calls[frame];
+    }
+
     ApiDumpFormat format() const { return output_format; }
 
+    // Writes the indentation, the name and the type of a member padded to their columns. This is done for every member
+    // that is dumped, so everything is appended to the stream buffer directly rather than through stream manipulators.
     void formatNameType(int indents, const char *name, const char *type) const {
-        output_stream << indentation(indents) << name << ": ";
-        // We have to 'print' an empty string for the setw to actually add the desired padding.
-        if (use_spaces)
-            output_stream << std::setw(name_size - (int)strlen(name) - 2) << "";
-        else
-            output_stream << std::setw((name_size - (int)strlen(name) - 3 + tab_size) / tab_size) << "";
+        formatNameType(*stream().rdbuf(), indents, name, type);
+    }
+
+    void formatNameType(std::streambuf &out, int indents, const char *name, const char *type) const {
+        writePadding(out, indents * indent_size);
+        const int name_length = static_cast<int>(strlen(name));
+        out.sputn(name, name_length);
+        out.sputn(": ", 2);
+        writePadding(out, use_spaces ? name_size - name_length - 2 : tabColumns(name_size - name_length - 3));
 
         if (show_type) {
-            if (use_spaces)
-                output_stream << std::left << std::setw(type_size) << type << " = ";
-            else
-                output_stream << type << std::setw((type_size - (int)strlen(type) - 1 + tab_size) / tab_size) << ""
-                              << " = ";
-        } else {
-            output_stream << " = ";
+            const int type_length = static_cast<int>(strlen(type));
+            out.sputn(type, type_length);
+            writePadding(out, use_spaces ? type_size - type_length : tabColumns(type_size - type_length - 1));
         }
+        out.sputn(" = ", 3);
     }
 
     inline const char *indentation(int indents) const {
-        // We have to 'print' an empty string for the setw to actually add the desired padding.
-        output_stream << std::setw(indents * indent_size) << "";
+        writePadding(*stream().rdbuf(), indents * indent_size);
         return "";
     }
 
+    void writeIndentation(std::streambuf &out, int indents) const { writePadding(out, indents * indent_size); }
+
     bool shouldFlush() const { return should_flush; }
 
     bool showAddress() const { return show_address; }
 
-    bool showParams() const { return show_params; }
+    bool showParams() const { return show_params && !params_dropped.load(std::memory_order_relaxed); }
+
+    // Stops dumping the parameters of the calls while the layer takes more than max_overhead_percent of the frame time.
+    void dropParams(bool drop) { params_dropped.store(drop, std::memory_order_relaxed); }
 
     bool showShader() const { return show_shader; }
 
+    // The number of elements dumped of an array of len elements, the rest are only counted.
+    size_t shownArrayElements(size_t len) const {
+        return max_array_elements > 0 && len > max_array_elements ? max_array_elements : len;
+    }
+
+    // 0 if strings are dumped in full.
+    size_t maxStringLength() const { return max_string_length; }
+
+    size_t flightRecorderSize() const { return flight_recorder_size; }
+    bool flightRecorderSpikes() const { return flight_recorder_spikes; }
+    bool splitsOutput() const { return split_by_thread || split_by_device; }
+#if !defined(_WIN32)
+    bool streamsOutput() const { return socket_buf != nullptr; }
+#else
+    bool streamsOutput() const { return false; }
+#endif
+    bool jsonLines() const { return json_lines; }
+    bool splitsOutputByDevice() const { return split_by_device; }
+    const std::string &shaderDirectory() const { return shader_directory; }
+
     bool showType() const { return show_type; }
 
     bool showTimestamp() const { return show_timestamp; }
 
     bool showThreadAndFrame() const { return show_thread_and_frame; }
 
-    // The const cast is necessary because everyone who 'writes' to the stream necessarily must be able to modify it.
-    // Since basically every function in this struct is const, we have to work around that.
-    std::ostream &stream() const { return output_stream; }
+    bool threadBuffering() const { return thread_buffering; }
 
-    bool isFrameInRange(uint64_t frame) const { return condFrameOutput.isFrameInRange(frame); }
+    bool asyncOutput() const { return async_output; }
+    // The CPU the asynchronous writer runs on, or -1 for any.
+    int writerCpu() const { return writer_cpu; }
+    // 1 if the asynchronous writer runs at a higher priority than the application threads, -1 if at a lower one.
+    int writerPriority() const { return writer_priority; }
+    bool deferredFormatting() const { return deferred_formatting; }
 
-   private:
-    // Utility member to enable easier comparison by forcing a string to all lower-case
-    static std::string ToLowerString(const std::string &value) {
-        std::string lower_value = value;
-        std::transform(lower_value.begin(), lower_value.end(), lower_value.begin(), ::tolower);
-        return lower_value;
-    }
+    bool statsPerFrame() const { return stats_per_frame; }
 
-    // Utility member for getting a platform environment variable on various platforms.
-    std::string GetPlatformEnvVar(const std::string &var) {
-        std::string ret_string = "";
-#ifdef _WIN32
-        char temp[MAX_STRING_LENGTH];
-        int bytes = GetEnvironmentVariableA(var.c_str(), temp, MAX_STRING_LENGTH - 1);
-        if (0 < bytes) {
-            ret_string = temp;
-        }
-#elif defined(__ANDROID__)
-        std::string command = "getprop debug.";
-        std::string lower_var = ToLowerString(var);
+    bool statsJson() const { return stats_json; }
 
-        // Remove any prefix "VK_" for Android properties
-        if (lower_var.rfind("vk_", 0) == 0) {
-            lower_var = lower_var.substr(3);
-        }
-        command += lower_var;
+    bool objectStats() const { return object_stats; }
 
-        FILE *pipe = popen(command.c_str(), "r");
-        if (pipe != nullptr) {
-            char result[255];
-            result[0] = '\0';
-            fgets(result, 255, pipe);
-            pclose(pipe);
-            size_t count = strcspn(result, "\r\n");
-            if (count > 0) {
-                ret_string = std::string(result, count);
-            }
-        }
-#else
-        const char *ret_value = getenv(var.c_str());
-        if (nullptr != ret_value) {
-            ret_string = ret_value;
-        }
-#endif
-        return ret_string;
-    }
+    bool memoryStats() const { return memory_stats; }
 
-    // Utility member to convert from string to a boolean
-    bool GetStringBooleanValue(const std::string &value) {
-        auto lower_str = ToLowerString(value);
-        if (lower_str == "true") {
-            return true;
-        }
-        if (lower_str == "on") {
-            return true;
-        }
-        if (lower_str == "1") {
-            return true;
+    bool pipelineStats() const { return pipeline_stats; }
+
+    bool submitLatency() const { return submit_latency; }
+
+    bool overheadStats() const { return overhead_stats; }
+    uint32_t maxOverheadPercent() const { return max_overhead_percent; }
+
+    // Whether the wrappers measure their time, which max_overhead_percent needs as well.
+    bool measuresOverhead() const { return overhead_stats || max_overhead_percent > 0; }
+
+    // Where the overhead is written at exit by the formats other than Stats, next to the output file. Empty when the output
+    // goes to stdout, in which case the overhead goes to stderr.
+    std::string overheadFileName() const { return output_filename.empty() ? "" : suffixedFileName(".overhead"); }
+
+    bool redundantState() const { return redundant_state; }
+    // Where the redundant state changes are written at exit, next to the output file, or to stderr if it is empty.
+    std::string redundantStateFileName() const { return output_filename.empty() ? "" : suffixedFileName(".redundant"); }
+
+    bool collapseRepeats() const { return collapse_repeats; }
+
+    bool commandBufferCapture() const { return command_buffer_capture; }
+
+    bool commandBufferSummary() const { return command_buffer_summary; }
+
+    bool memoizeQueries() const { return memoize_queries; }
+
+    const ApiDumpCallFilter &callFilter() const { return call_filter; }
+
+    bool hasLabelScopes() const { return !label_scopes.empty(); }
+
+    bool isLabelScope(const char *label_name) const {
+        if (label_name == nullptr) return false;
+        for (const std::string &pattern : label_scopes) {
+            if (MatchesWildcard(pattern.c_str(), label_name)) return true;
         }
         return false;
     }
 
-    static bool readBoolOption(const char *option, bool default_value) {
-        const char *string_option = getLayerOption(option);
-        if (string_option == NULL) return default_value;
-        std::string lowered_option = ToLowerString(std::string(string_option));
-        if (lowered_option == "true")
-            return true;
-        else if (lowered_option == "false")
-            return false;
-        else
-            return default_value;
+    static uint64_t processID() {
+#ifdef _WIN32
+        return static_cast<uint64_t>(_getpid());
+#else
+        return static_cast<uint64_t>(getpid());
+#endif
     }
 
-    static int readIntOption(const char *option, int default_value) {
-        const char *string_option = getLayerOption(option);
-        int value;
-        if (sscanf(string_option, "%d", &value) != 1) {
-            return default_value;
-        } else {
-            return value;
+    // The const cast is necessary because everyone who 'writes' to the stream necessarily must be able to modify it.
+    // Since basically every function in this struct is const, we have to work around that.
+    // With thread buffering enabled, each thread formats into its own staging stream which is later handed to
+    // commitThreadOutput().
+    std::ostream &stream() const { return thread_buffering ? threadOutput().stream : output_stream; }
+
+    // The stream the output finally ends up in, regardless of buffering.
+    std::ostream &outputStream() const { return output_stream; }
+
+    bool hasThreadOutput() const { return threadOutput().buffer.size() > 0; }
+
+    uint32_t threadOutputSize() const { return static_cast<uint32_t>(threadOutput().buffer.size()); }
+
+    const char *threadOutputData() const { return threadOutput().buffer.data(); }
+
+    void clearThreadOutput() const { threadOutput().buffer.reset(); }
+
+    void prependThreadOutput(const char *data, size_t size) const { threadOutput().buffer.prepend(data, size); }
+
+    // Turns the staged output of a JSON call into an NDJSON line.
+    void finishThreadOutputLine() const {
+        ApiDumpThreadBuf &buffer = threadOutput().buffer;
+        buffer.joinLines();
+        buffer.sputc('\n');
+    }
+
+    // Moves the calling thread's staged output into data, leaving the staging buffer empty.
+    void takeThreadOutput(std::string &data) const {
+        ApiDumpThreadBuf &buffer = threadOutput().buffer;
+        data.assign(buffer.data(), buffer.size());
+        buffer.reset();
+    }
+
+    // Appends prefix_size bytes of prefix and then the calling thread's staged output to the output stream. The caller must
+    // hold the output mutex.
+    void commitThreadOutput(const char *prefix, size_t prefix_size) const {
+        ApiDumpThreadBuf &buffer = threadOutput().buffer;
+        if (prefix_size > 0) output_stream.write(prefix, static_cast<std::streamsize>(prefix_size));
+        output_stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (should_flush) output_stream.flush();
+        buffer.reset();
+    }
+
+    // Appends the calling thread's staged binary record to the split output file of the device and thread, without
+    // holding the output mutex. The device key is ignored unless the output is split by device.
+    void commitSplitThreadOutput(const void *device_key, uint64_t thread_id) const {
+        ApiDumpThreadBuf &buffer = threadOutput().buffer;
+        ApiDumpSplitOutput &split_output = splitOutput(split_by_device ? device_key : nullptr, thread_id);
+        const uint32_t record_size = static_cast<uint32_t>(buffer.size());
+        std::lock_guard<std::mutex> lg(split_output.mutex);
+        split_output.file.write(reinterpret_cast<const char *>(&record_size), sizeof(record_size));
+        split_output.file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (should_flush) split_output.file.flush();
+        buffer.reset();
+    }
+
+    bool isFrameInRange(uint64_t frame) const {
+        return condFrameOutput.isFrameInRange(frame) && isFrameSampled(frame) && isFrameArmed(frame);
+    }
+
+    bool startDisarmed() const { return start_disarmed; }
+
+    // Whether dumping is armed during the given frame. The frames at which the layer was armed or disarmed are all kept,
+    // since the asynchronous writer can be a few frames behind the application.
+    bool isFrameArmed(uint64_t frame) const {
+        if (!start_disarmed && arm_toggle_count.load(std::memory_order_acquire) == 0) return true;
+        std::lock_guard<std::mutex> lg(arm_toggles_mutex);
+        const size_t toggles = std::upper_bound(arm_toggles.begin(), arm_toggles.end(), frame) - arm_toggles.begin();
+        return start_disarmed == (toggles % 2 == 1);
+    }
+
+    // Arms or disarms dumping from the given frame on, which must not be before any frame it was toggled at before.
+    void toggleArmed(uint64_t frame) const {
+        std::lock_guard<std::mutex> lg(arm_toggles_mutex);
+        arm_toggles.push_back(frame);
+        arm_toggle_count.store(arm_toggles.size(), std::memory_order_release);
+    }
+
+    // Each group of sample_frames frames has one sampled frame, picked by hashing the number of the group so that the
+    // choice doesn't line up with a pattern in the application and is the same every time a frame is checked.
+    bool isFrameSampled(uint64_t frame) const {
+        if (sample_frames <= 1) return true;
+        uint64_t hash = frame / sample_frames + 0x9e3779b97f4a7c15ULL;
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+        hash ^= hash >> 31;
+        return frame % sample_frames == hash % sample_frames;
+    }
+
+    uint32_t sampleCalls() const { return sample_calls; }
+
+    ApiDumpFrameDelimiter frameDelimiter() const { return frame_delimiter; }
+
+    // The number of vkQueueSubmit calls in a frame with the Submit delimiter, at least 1.
+    uint32_t frameDelimiterSubmits() const { return frame_delimiter_submits; }
+
+    bool isFrameDelimiterLabel(const char *label_name) const {
+        return label_name != nullptr && MatchesWildcard(frame_delimiter_label.c_str(), label_name);
+    }
+
+    // Whether the function filter selects the function with the given name.
+    bool matchesFunctionFilter(const char *name) const {
+        bool included = function_filter_includes.empty();
+        for (const auto &pattern : function_filter_includes) {
+            if (MatchesWildcard(pattern.c_str(), name)) {
+                included = true;
+                break;
+            }
         }
+        if (!included) return false;
+        for (const auto &pattern : function_filter_excludes) {
+            if (MatchesWildcard(pattern.c_str(), name)) return false;
+        }
+        return true;
     }
 
-    static ApiDumpFormat readFormatOption(const char *option, ApiDumpFormat default_value) {
+    // Matches the function filter against every intercepted function once, so that the check done by each call is a
+    // single bit test. Only the first call has an effect.
+    void resolveFunctionFilter(const ApiDumpFunctionName *functions, size_t count) {
+        if (function_filter_includes.empty() && function_filter_excludes.empty()) return;
+        std::call_once(function_filter_resolved, [&]() {
+            uint32_t max_index = 0;
+            for (size_t i = 0; i < count; ++i) max_index = std::max(max_index, functions[i].index);
+            std::vector<uint64_t> bitmap(max_index / 64 + 1, 0);
+            for (size_t i = 0; i < count; ++i) {
+                if (matchesFunctionFilter(functions[i].name)) {
+                    bitmap[functions[i].index / 64] |= uint64_t(1) << (functions[i].index % 64);
+                }
+            }
+            function_filter_bitmap = std::move(bitmap);
+        });
+    }
+
+    // Every function is dumped until the filter has been resolved, or if there is no filter at all.
+    bool shouldDumpFunction(uint32_t index) const {
+        if (function_filter_bitmap.empty()) return true;
+        return index / 64 < function_filter_bitmap.size() && (function_filter_bitmap[index / 64] >> (index % 64)) & 1;
+    }
+
+    // Matches name against a pattern in which '*' stands for any sequence of characters.
+    static bool MatchesWildcard(const char *pattern, const char *name) {
+        const char *star = nullptr;
+        const char *resume = nullptr;
+        while (*name != '\0') {
+            if (*pattern == '*') {
+                star = pattern++;
+                resume = name;
+            } else if (*pattern == *name) {
+                ++pattern;
+                ++name;
+            } else if (star != nullptr) {
+                pattern = star + 1;
+                name = ++resume;
+            } else {
+                return false;
+            }
+        }
+        while (*pattern == '*') ++pattern;
+        return *pattern == '\0';
+    }
+
+   private:
+    ApiDumpThreadOutput &threadOutput() const {
+        static thread_local ApiDumpThreadOutput thread_output(use_spaces ? ' ' : '\t');
+        return thread_output;
+    }
+
+    // Each thread remembers the split output files it wrote to, so the table of files is only locked the first time a
+    // thread writes to one of them. A device which is destroyed and whose handle is reused keeps writing to the same file.
+    ApiDumpSplitOutput &splitOutput(const void *device_key, uint64_t thread_id) const {
+        static thread_local std::vector<std::pair<const void *, ApiDumpSplitOutput *>> thread_split_outputs;
+        for (const auto &entry : thread_split_outputs) {
+            if (entry.first == device_key) return *entry.second;
+        }
+
+        std::lock_guard<std::mutex> lg(split_outputs_mutex);
+        std::string suffix;
+        if (split_by_device) {
+            const auto device_index = split_device_indices.emplace(device_key, split_device_indices.size()).first->second;
+            suffix += ".device" + std::to_string(device_index);
+        }
+        if (split_by_thread) suffix += ".thread" + std::to_string(thread_id);
+        std::unique_ptr<ApiDumpSplitOutput> &split_output = split_outputs[suffix];
+        if (!split_output) {
+            split_output = std::make_unique<ApiDumpSplitOutput>();
+            split_output->file.open(suffixedFileName(suffix), std::ofstream::out | std::ostream::trunc | std::ofstream::binary);
+            writeBinaryFileHeader(split_output->file);
+        }
+        thread_split_outputs.emplace_back(device_key, split_output.get());
+        return *split_output;
+    }
+
+    // Appends count padding characters, nothing if count isn't positive.
+    void writePadding(std::streambuf &out, int count) const {
+        while (count > 0) {
+            const int chunk = std::min(count, static_cast<int>(padding.size()));
+            out.sputn(padding.data(), chunk);
+            count -= chunk;
+        }
+    }
+
+    // The number of tabs which pad the given number of columns.
+    int tabColumns(int columns) const { return tab_size > 0 ? (columns + tab_size) / tab_size : 0; }
+
+    // Utility member to enable easier comparison by forcing a string to all lower-case
+    static std::string ToLowerString(const std::string &value) {
+        std::string lower_value = value;
+        std::transform(lower_value.begin(), lower_value.end(), lower_value.begin(), ::tolower);
+        return lower_value;
+    }
+
+    // Utility member for getting a platform environment variable on various platforms.
+    std::string GetPlatformEnvVar(const std::string &var) {
+        std::string ret_string = "";
+#ifdef _WIN32
+        char temp[MAX_STRING_LENGTH];
+        int bytes = GetEnvironmentVariableA(var.c_str(), temp, MAX_STRING_LENGTH - 1);
+        if (0 < bytes) {
+            ret_string = temp;
+        }
+#elif defined(__ANDROID__)
+        std::string command = "getprop debug.";
+        std::string lower_var = ToLowerString(var);
+
+        // Remove any prefix "VK_" for Android properties
+        if (lower_var.rfind("vk_", 0) == 0) {
+            lower_var = lower_var.substr(3);
+        }
+        command += lower_var;
+
+        FILE *pipe = popen(command.c_str(), "r");
+        if (pipe != nullptr) {
+            char result[255];
+            result[0] = '\0';
+            fgets(result, 255, pipe);
+            pclose(pipe);
+            size_t count = strcspn(result, "\r\n");
+            if (count > 0) {
+                ret_string = std::string(result, count);
+            }
+        }
+#else
+        const char *ret_value = getenv(var.c_str());
+        if (nullptr != ret_value) {
+            ret_string = ret_value;
+        }
+#endif
+        return ret_string;
+    }
+
+    // Utility member to convert from string to a boolean
+    bool GetStringBooleanValue(const std::string &value) {
+        auto lower_str = ToLowerString(value);
+        if (lower_str == "true") {
+            return true;
+        }
+        if (lower_str == "on") {
+            return true;
+        }
+        if (lower_str == "1") {
+            return true;
+        }
+        return false;
+    }
+
+#ifdef __ANDROID__
+    // /sdcard/Android/data/<package>/files, which is only created once the application asks for it, so it is created here
+    // too. The package is the process name, without the suffix of a secondary process.
+    static std::string androidExternalFilesDirectory() {
+        std::string package;
+        std::ifstream cmdline("/proc/self/cmdline");
+        std::getline(cmdline, package, '\0');
+        package = package.substr(0, package.find(':'));
+        std::string directory = "/sdcard/Android/data/" + package;
+        mkdir(directory.c_str(), 0770);
+        directory += "/files";
+        mkdir(directory.c_str(), 0770);
+        return directory;
+    }
+#endif
+
+    static bool readBoolOption(const char *option, bool default_value) {
         const char *string_option = getLayerOption(option);
+        if (string_option == NULL) return default_value;
         std::string lowered_option = ToLowerString(std::string(string_option));
-        if (lowered_option == "text")
-            return ApiDumpFormat::Text;
-        else if (lowered_option == "html")
-            return ApiDumpFormat::Html;
-        else if (lowered_option == "json")
-            return ApiDumpFormat::Json;
+        if (lowered_option == "true")
+            return true;
+        else if (lowered_option == "false")
+            return false;
         else
             return default_value;
     }
 
-    // The mutable is necessary because everyone who 'writes' to the stream necessarily must be able to modify it.
-    // Since basically every function in this struct is const, we have to work around that.
-    mutable std::ostream output_stream;
-    std::ofstream output_file_stream;
-#ifdef __ANDROID__
-    std::unique_ptr<AndroidLogcatBuf<>> android_logcat_buf = nullptr;
-#endif
-    ApiDumpFormat output_format;
-    bool show_params;
-    bool show_address;
-    bool should_flush;
-    bool show_timestamp;
+    static int readIntOption(const char *option, int default_value) {
+        const char *string_option = getLayerOption(option);
+        int value;
+        if (sscanf(string_option, "%d", &value) != 1) {
+            return default_value;
+        } else {
+            return value;
+        }
+    }
 
-    bool show_type;
-    int indent_size;  // how many indent levels to use - also sets the tab_size
-    int name_size;
-    int type_size;
-    bool use_spaces;
-    bool show_shader;
-    bool show_thread_and_frame;
+    // Splits a comma separated list of function names into the included and the excluded ('!' prefixed) patterns.
+    void parseFunctionFilter(const std::string &filter) {
+        std::stringstream stream(filter);
+        std::string entry;
+        while (std::getline(stream, entry, ',')) {
+            const size_t first = entry.find_first_not_of(" \t");
+            if (first == std::string::npos) continue;
+            entry = entry.substr(first, entry.find_last_not_of(" \t") - first + 1);
+            if (entry[0] == '!') {
+                if (entry.size() > 1) function_filter_excludes.push_back(entry.substr(1));
+            } else {
+                function_filter_includes.push_back(entry);
+            }
+        }
+    }
+
+    // Writes what comes before the first frame of an output file.
+    void writeFileHeader() const {
+        json_frame_written = false;
+        if (output_format == ApiDumpFormat::Html) {
+            // clang-format off
+            // Insert html heading
+            output_stream <<
+                "<!doctype html>"
+                "<html>"
+                    "<head>"
+                        "<title>Vulkan API Dump</title>"
+                        "<style type='text/css'>"
+                        "html {"
+                            "background-color: #0b1e48;"
+                            "background-image: url('https://vulkan.lunarg.com/img/bg-starfield.jpg');"
+                            "background-position: center;"
+                            "-webkit-background-size: cover;"
+                            "-moz-background-size: cover;"
+                            "-o-background-size: cover;"
+                            "background-size: cover;"
+                            "background-attachment: fixed;"
+                            "background-repeat: no-repeat;"
+                            "height: 100%;"
+                        "}"
+                        "#header {"
+                            "z-index: -1;"
+                        "}"
+                        "#header>img {"
+                            "position: absolute;"
+                            "width: 160px;"
+                            "margin-left: -280px;"
+                            "top: -10px;"
+                            "left: 50%;"
+                        "}"
+                        "#header>h1 {"
+                            "font-family: Arial, 'Helvetica Neue', Helvetica, sans-serif;"
+                            "font-size: 44px;"
+                            "font-weight: 200;"
+                            "text-shadow: 4px 4px 5px #000;"
+                            "color: #eee;"
+                            "position: absolute;"
+                            "width: 400px;"
+                            "margin-left: -80px;"
+                            "top: 8px;"
+                            "left: 50%;"
+                        "}"
+                        "body {"
+                            "font-family: Consolas, monaco, monospace;"
+                            "font-size: 14px;"
+                            "line-height: 20px;"
+                            "color: #eee;"
+                            "height: 100%;"
+                            "margin: 0;"
+                            "overflow: hidden;"
+                        "}"
+                        "#wrapper {"
+                            "background-color: rgba(0, 0, 0, 0.7);"
+                            "border: 1px solid #446;"
+                            "box-shadow: 0px 0px 10px #000;"
+                            "padding: 8px 12px;"
+                            "display: inline-block;"
+                            "position: absolute;"
+                            "top: 80px;"
+                            "bottom: 25px;"
+                            "left: 50px;"
+                            "right: 50px;"
+                            "overflow: auto;"
+                        "}"
+                        "details>*:not(summary) {"
+                            "margin-left: 22px;"
+                        "}"
+                        "summary:only-child {"
+                          "display: block;"
+                          "padding-left: 15px;"
+                        "}"
+                        "details>summary:only-child::-webkit-details-marker {"
+                            "display: none;"
+                            "padding-left: 15px;"
+                        "}"
+                        ".var, .type, .val {"
+                            "display: inline;"
+                            "margin: 0 6px;"
+                        "}"
+                        ".type {"
+                            "color: #acf;"
+                        "}"
+                        ".val {"
+                            "color: #afa;"
+                            "text-align: right;"
+                        "}"
+                        ".thd {"
+                            "color: #888;"
+                        "}"
+                        ".time {"
+                            "color: #888;"
+                        "}"
+                        "</style>"
+                    "</head>"
+                    "<body>"
+                        "<div id='header'>"
+                            "<img src='https://lunarg.com/wp-content/uploads/2016/02/LunarG-wReg-150.png' />"
+                            "<h1>Vulkan API Dump</h1>"
+                        "</div>"
+                        "<div id='wrapper'>";
+            // clang-format on
+        } else if (output_format == ApiDumpFormat::Json && !json_lines) {
+            output_stream << "[\n";
+        } else if (output_format == ApiDumpFormat::Trace) {
+            // Every event after this one starts with its separator, so events can be written in any order.
+            output_stream << "[\n{\"name\" : \"process_name\", \"ph\" : \"M\", \"pid\" : " << processID()
+                          << ", \"tid\" : 0, \"args\" : {\"name\" : \"Vulkan API\"}}";
+        } else if (output_format == ApiDumpFormat::Binary) {
+            writeBinaryFileHeader(output_stream);
+        }
+    }
+
+    static void writeBinaryFileHeader(std::ostream &stream) {
+        ApiDumpBinaryFileHeader header = {};
+        memcpy(header.magic, API_DUMP_BINARY_MAGIC, sizeof(header.magic));
+        header.format_version = API_DUMP_BINARY_FORMAT_VERSION;
+        header.header_version = VK_HEADER_VERSION;
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    // Closes off the output file, after the last frame in it was closed.
+    void writeFileFooter() const {
+        if (output_format == ApiDumpFormat::Html) {
+            // Close off html
+            output_stream << "</div></body></html>";
+        } else if (output_format == ApiDumpFormat::Json && !json_lines) {
+            // Close off json
+            output_stream << "\n]" << std::endl;
+        } else if (output_format == ApiDumpFormat::Trace) {
+            output_stream << "\n]" << std::endl;
+        }
+    }
+
+    void openOutputFile(const std::string &filename) const {
+        openCompressionPipe(output_compression, filename);
+        if (frame_index && compression_pipe == nullptr) openFrameIndex(filename);
+        if (compression_pipe != nullptr) {
+            compression_buf = std::make_unique<ApiDumpPipeBuf>(compression_pipe);
+            output_stream.rdbuf(compression_buf.get());
+            return;
+        }
+#if defined(_WIN32) || defined(API_DUMP_IO_URING)
+        if (queued_output) {
+            queued_file_buf = std::make_unique<ApiDumpQueuedFileBuf>();
+            // A file system which doesn't do direct I/O is still written asynchronously, and a kernel without io_uring
+            // through a file stream.
+            if (queued_file_buf->open(filename, queue_depth, direct_io) ||
+                (direct_io && queued_file_buf->open(filename, queue_depth, false))) {
+                output_stream.rdbuf(queued_file_buf.get());
+                return;
+            }
+            queued_file_buf.reset();
+        }
+#endif
+#if !defined(__ANDROID__)
+        if (mapped_output) {
+            mapped_file_buf = std::make_unique<ApiDumpMappedFileBuf>();
+            if (mapped_file_buf->open(filename)) {
+                output_stream.rdbuf(mapped_file_buf.get());
+                return;
+            }
+            // A file which can't be mapped is still written, through a file stream.
+            mapped_file_buf.reset();
+        }
+#endif
+        std::ios_base::openmode mode = std::ofstream::out | std::ostream::trunc;
+        if (output_format == ApiDumpFormat::Binary) mode |= std::ofstream::binary;
+        output_file_stream.open(filename, mode);
+        output_stream.rdbuf(output_file_stream.rdbuf());
+    }
+
+    // The index page only links to the pages, which are loaded into its frame when they are picked. Rows are appended as the
+    // frames are closed, and browsers show the page as it is even if the layer never gets to close it off.
+    void openHtmlIndex() const {
+        html_index_stream.open(suffixedFileName(".index"), std::ofstream::out | std::ofstream::trunc);
+        if (!html_index_stream.is_open()) return;
+        // clang-format off
+        html_index_stream <<
+            "<!doctype html>"
+            "<html>"
+                "<head>"
+                    "<title>Vulkan API Dump</title>"
+                    "<style type='text/css'>"
+                    "body { margin: 0; font-family: monospace; background-color: #0b1e48; color: #fff; }"
+                    "#frames { position: fixed; left: 0; top: 0; bottom: 0; width: 24em; overflow-y: auto; }"
+                    "#page { position: fixed; left: 24em; top: 0; width: calc(100% - 24em); height: 100%; border: none; }"
+                    "table { border-collapse: collapse; width: 100%; }"
+                    "td, th { padding: 2px 6px; text-align: right; }"
+                    "a { color: #aaf; }"
+                    "</style>"
+                "</head>"
+                "<body>"
+                    "<iframe id='page' name='page'></iframe>"
+                    "<div id='frames'>"
+                        "<table>"
+                            "<tr><th>Frame</th><th>Calls</th><th>Size</th></tr>\n";
+        // clang-format on
+    }
+
+    void writeHtmlIndexRow(const ApiDumpFrameIndexEntry &entry) const {
+        uint64_t calls = 0;
+        {
+            std::lock_guard<std::mutex> lg(html_frame_calls_mutex);
+            const auto calls_iter = html_frame_calls.find(entry.frame);
+            if (calls_iter != html_frame_calls.end()) {
+                calls = calls_iter->second;
+                html_frame_calls.erase(calls_iter);
+            }
+        }
+        const std::string page = rotatedFileName(output_file_index);
+        const size_t separator = page.find_last_of("/\\");
+        html_index_stream << "<tr><td><a href='" << (separator == std::string::npos ? page : page.substr(separator + 1))
+                          << "' target='page'>" << entry.frame << "</a></td><td>" << calls << "</td><td>"
+                          << (entry.size + 1023) / 1024 << " KB</td></tr>\n";
+        if (should_flush) html_index_stream.flush();
+    }
+
+    void closeHtmlIndex() const {
+        if (!html_index_stream.is_open()) return;
+        html_index_stream << "</table></div></body></html>";
+        html_index_stream.close();
+    }
+
+    void closeOutputFile() const {
+        output_stream.flush();
+#if !defined(_WIN32) && !defined(__ANDROID__)
+        // The compressor finishes the file once it reads the end of its input.
+        if (compression_pipe != nullptr) {
+            pclose(compression_pipe);
+            compression_pipe = nullptr;
+        }
+#endif
+        if (output_file_stream.is_open()) output_file_stream.close();
+#if !defined(__ANDROID__)
+        if (mapped_file_buf != nullptr) mapped_file_buf->close();
+#endif
+#if defined(_WIN32) || defined(API_DUMP_IO_URING)
+        if (queued_file_buf != nullptr) queued_file_buf->close();
+#endif
+        if (frame_index_stream.is_open()) frame_index_stream.close();
+    }
+
+    void openFrameIndex(const std::string &filename) const {
+        const std::ios_base::openmode mode = std::ofstream::out | std::ofstream::trunc | std::ofstream::binary;
+        frame_index_stream.open(ApiDumpFrameIndexFileName(filename), mode);
+        if (!frame_index_stream.is_open()) return;
+        ApiDumpFrameIndexHeader header = {};
+        memcpy(header.magic, API_DUMP_FRAME_INDEX_MAGIC, sizeof(header.magic));
+        header.format_version = API_DUMP_FRAME_INDEX_FORMAT_VERSION;
+        header.entry_size = sizeof(ApiDumpFrameIndexEntry);
+        frame_index_stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    void startFrameIndex() const {
+        if (!frame_index_stream.is_open() && !html_index_stream.is_open()) return;
+        const std::streampos start = output_stream.tellp();
+        frame_start_offset = start != std::streampos(-1) ? static_cast<uint64_t>(start) : 0;
+    }
+
+    bool rotatesOutput() const { return rotate_size > 0 || rotate_frames > 0; }
+
+    bool shouldRotateOutput(uint64_t frame_count) const {
+        if (!rotatesOutput()) return false;
+        if (rotate_frames > 0 && frame_count - output_file_first_frame >= rotate_frames) return true;
+        if (rotate_size > 0) {
+            const std::streampos written = output_stream.tellp();
+            if (written != std::streampos(-1) && static_cast<uint64_t>(written) >= rotate_size) return true;
+        }
+        return false;
+    }
+
+    // The rotated files are numbered in the order they are written, before the extension: vk_apidump.3.json.
+    std::string rotatedFileName(uint64_t index) const { return suffixedFileName("." + std::to_string(index)); }
+
+    // The output file name with the suffix inserted before its extension.
+    std::string suffixedFileName(const std::string &suffix) const {
+        const size_t separator = output_filename.find_last_of("/\\");
+        const size_t dot = output_filename.find_last_of('.');
+        if (dot == std::string::npos || (separator != std::string::npos && dot < separator)) return output_filename + suffix;
+        return output_filename.substr(0, dot) + suffix + output_filename.substr(dot);
+    }
+
+    void rotateOutputFile(uint64_t frame_count) const {
+        writeFileFooter();
+        closeOutputFile();
+        ++output_file_index;
+        if (output_file_index >= rotate_count) {
+            remove(rotatedFileName(output_file_index - rotate_count).c_str());
+            if (frame_index) remove(ApiDumpFrameIndexFileName(rotatedFileName(output_file_index - rotate_count)).c_str());
+        }
+        openOutputFile(rotatedFileName(output_file_index));
+        writeFileHeader();
+        output_file_first_frame = frame_count;
+    }
+
+    // Pipes the output through the compressor named by the compression setting, which writes it to the file. If the
+    // compressor can't be run, the shell falls back to writing the output uncompressed. Popen is only available on
+    // desktop POSIX systems, everywhere else the output is never compressed.
+    void openCompressionPipe(const std::string &compression, const std::string &filename) const {
+        const char *compressor = nullptr;
+        if (compression == "gzip")
+            compressor = "gzip -c";
+        else if (compression == "zstd")
+            compressor = "zstd -q -c";
+        else if (compression == "lz4")
+            compressor = "lz4 -q -c";
+        if (compressor == nullptr) return;
+#if !defined(_WIN32) && !defined(__ANDROID__)
+        std::string quoted_filename = "'";
+        for (char c : filename) {
+            if (c == '\'')
+                quoted_filename += "'\\''";
+            else
+                quoted_filename += c;
+        }
+        quoted_filename += "'";
+        const std::string command = std::string("(") + compressor + " || cat) > " + quoted_filename;
+        compression_pipe = popen(command.c_str(), "w");
+#else
+        (void)filename;
+#endif
+    }
+
+    static ApiDumpFormat readFormatOption(const char *option, ApiDumpFormat default_value) {
+        const char *string_option = getLayerOption(option);
+        std::string lowered_option = ToLowerString(std::string(string_option));
+        if (lowered_option == "text")
+            return ApiDumpFormat::Text;
+        else if (lowered_option == "html")
+            return ApiDumpFormat::Html;
+        else if (lowered_option == "json" || lowered_option == "ndjson")
+            return ApiDumpFormat::Json;
+        else if (lowered_option == "binary")
+            return ApiDumpFormat::Binary;
+        else if (lowered_option == "stats")
+            return ApiDumpFormat::Stats;
+        else if (lowered_option == "trace")
+            return ApiDumpFormat::Trace;
+        else
+            return default_value;
+    }
+
+    static ApiDumpFrameDelimiter readFrameDelimiterOption(const char *option, ApiDumpFrameDelimiter default_value) {
+        const char *string_option = getLayerOption(option);
+        if (string_option == NULL) return default_value;
+        std::string lowered_option = ToLowerString(std::string(string_option));
+        if (lowered_option == "present")
+            return ApiDumpFrameDelimiter::Present;
+        else if (lowered_option == "submit")
+            return ApiDumpFrameDelimiter::Submit;
+        else if (lowered_option == "label")
+            return ApiDumpFrameDelimiter::Label;
+        else if (lowered_option == "wait_idle")
+            return ApiDumpFrameDelimiter::WaitIdle;
+        else if (lowered_option == "fence_wait")
+            return ApiDumpFrameDelimiter::FenceWait;
+        else
+            return default_value;
+    }
+
+    // The mutable is necessary because everyone who 'writes' to the stream necessarily must be able to modify it.
+    // Since basically every function in this struct is const, we have to work around that.
+    mutable std::ostream output_stream;
+    // Rotation reopens the output file from the const formatting functions, like they write to output_stream, so everything
+    // about the current output file is mutable too.
+    mutable std::ofstream output_file_stream;
+    mutable FILE *compression_pipe = nullptr;
+    mutable std::unique_ptr<ApiDumpPipeBuf> compression_buf;
+#if !defined(__ANDROID__)
+    mutable std::unique_ptr<ApiDumpMappedFileBuf> mapped_file_buf;
+#endif
+#if defined(_WIN32) || defined(API_DUMP_IO_URING)
+    mutable std::unique_ptr<ApiDumpQueuedFileBuf> queued_file_buf;
+#endif
+#if !defined(_WIN32)
+    std::unique_ptr<ApiDumpSocketBuf> socket_buf;
+#endif
+    mutable uint64_t output_file_index = 0;
+    mutable uint64_t output_file_first_frame = 0;
+    bool frame_index = false;
+    mutable std::ofstream frame_index_stream;
+    mutable uint64_t frame_start_offset = 0;
+    uint64_t html_page_frames = 0;
+    mutable std::ofstream html_index_stream;
+    mutable std::mutex html_frame_calls_mutex;
+    mutable std::unordered_map<uint64_t, uint64_t> html_frame_calls;
+    mutable bool json_frame_written = false;
+    std::string output_filename;
+    std::string output_compression;
+    uint64_t rotate_size;
+    uint64_t rotate_frames;
+    uint64_t rotate_count;
+    // The split output files, by their suffix, and the number of each device in their names.
+    mutable std::mutex split_outputs_mutex;
+    mutable std::map<std::string, std::unique_ptr<ApiDumpSplitOutput>> split_outputs;
+    mutable std::unordered_map<const void *, uint64_t> split_device_indices;
+#ifdef __ANDROID__
+    std::unique_ptr<AndroidLogcatBuf<>> android_logcat_buf = nullptr;
+#endif
+    ApiDumpFormat output_format;
+    bool show_params;
+    bool show_address;
+    bool should_flush;
+    bool show_timestamp;
+
+    bool show_type;
+    int indent_size;  // how many indent levels to use - also sets the tab_size
+    int name_size;
+    size_t max_array_elements = 0;
+    size_t max_string_length = 0;
+    int type_size;
+    bool use_spaces;
+    bool show_shader;
+    size_t flight_recorder_size;
+    bool flight_recorder_spikes = false;
+    bool json_lines = false;
+    bool mapped_output = false;
+    bool queued_output = false;
+    uint32_t queue_depth = 4;
+    bool direct_io = false;
+    bool split_by_thread = false;
+    bool split_by_device = false;
+    std::string shader_directory;
+    bool show_thread_and_frame;
+    bool thread_buffering;
+    bool async_output;
+    int writer_cpu = -1;
+    int writer_priority = 0;
+    bool deferred_formatting;
+    bool stats_per_frame;
+    bool stats_json;
+    bool object_stats = false;
+    bool memory_stats = false;
+    bool pipeline_stats = false;
+    bool submit_latency = false;
+    bool overhead_stats = false;
+    bool redundant_state = false;
+    uint32_t max_overhead_percent = 0;
+    std::atomic<bool> params_dropped{false};
+    bool collapse_repeats = false;
+    bool memoize_queries = false;
+    ApiDumpCallFilter call_filter;
+    // The names of the debug labels inside of which calls are dumped, which may use '*' wildcards.
+    std::vector<std::string> label_scopes;
+    bool command_buffer_capture = false;
+    bool command_buffer_summary = false;
+
+    std::vector<std::string> function_filter_includes;
+    std::vector<std::string> function_filter_excludes;
+    std::once_flag function_filter_resolved;
+    // One bit per function index, empty if every function is dumped.
+    std::vector<uint64_t> function_filter_bitmap;
+
+    bool use_conditional_output = false;
+    ConditionalFrameOutput condFrameOutput;
+    uint32_t sample_calls = 0;
+    uint64_t sample_frames = 0;
+    ApiDumpFrameDelimiter frame_delimiter = ApiDumpFrameDelimiter::Present;
+    uint32_t frame_delimiter_submits = 1;
+    // The name of the queue debug label which begins a new frame with the Label delimiter, which may use '*' wildcards.
+    std::string frame_delimiter_label;
+    bool start_disarmed = false;
+    mutable std::mutex arm_toggles_mutex;
+    mutable std::vector<uint64_t> arm_toggles;
+    mutable std::atomic<size_t> arm_toggle_count{0};
+
+    int tab_size;  // equal to the indent size if using spaces, otherwise is equal to 1
+    // A run of the fill character, which indentation and column padding are cut from.
+    std::string padding;
+};
+
+// A unit of work for the asynchronous writer: either the formatted output of one API call, or a frame boundary.
+struct ApiDumpOutputBlock {
+    ApiDumpOutputBlock *next = nullptr;
+    bool frame_marker = false;
+    uint64_t frame = 0;
+    std::string data;
+};
+
+// Owns the output stream when asynchronous output is enabled, so application threads never wait for output I/O. Producers
+// push finished blocks onto a lock-free list; the writer thread takes the whole list at once, restores submission order and
+// writes it out in large chunks.
+class ApiDumpAsyncWriter {
+   public:
+    // Formats the binary record of a call into the output format, leaving output empty if the record can't be read.
+    using CallFormatter = void (*)(const std::string &record, std::string &output);
+
+    explicit ApiDumpAsyncWriter(const ApiDumpSettings &settings) : settings(settings) {}
+    ApiDumpAsyncWriter(const ApiDumpAsyncWriter &) = delete;
+    ApiDumpAsyncWriter &operator=(const ApiDumpAsyncWriter &) = delete;
+
+    ~ApiDumpAsyncWriter() { stop(); }
+
+    void start() { writer_thread = std::thread(&ApiDumpAsyncWriter::run, this); }
+
+    // Writes out everything that was pushed before the call and joins the writer thread.
+    void stop() {
+        if (!writer_thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lg(wake_mutex);
+            stopping = true;
+        }
+        wake_cv.notify_one();
+        writer_thread.join();
+    }
+
+    void pushCall(std::string &&data) {
+        ApiDumpOutputBlock *block = new ApiDumpOutputBlock;
+        block->data = std::move(data);
+        push(block);
+    }
+
+    void pushFrame(uint64_t frame) {
+        ApiDumpOutputBlock *block = new ApiDumpOutputBlock;
+        block->frame_marker = true;
+        block->frame = frame;
+        push(block);
+    }
+
+    // With a call formatter, the pushed calls are binary records which the writer thread formats before writing them out.
+    // Must be set before the first call is pushed.
+    void setCallFormatter(CallFormatter formatter) { call_formatter.store(formatter, std::memory_order_relaxed); }
+    bool formatsCalls() const { return call_formatter.load(std::memory_order_relaxed) != nullptr; }
+
+   private:
+    static const size_t write_chunk_size = 1024 * 1024;
+
+    void push(ApiDumpOutputBlock *block) {
+        block->next = pending.load(std::memory_order_relaxed);
+        while (!pending.compare_exchange_weak(block->next, block)) {
+        }
+        // Pairs with the store to waiting in run(): either the writer sees the new block before sleeping, or the block
+        // sees that the writer is asleep and wakes it up.
+        if (waiting.load()) {
+            std::lock_guard<std::mutex> lg(wake_mutex);
+            wake_cv.notify_one();
+        }
+    }
+
+    void run() {
+        ApiDumpConfigureWriterThread(settings.writerCpu(), settings.writerPriority());
+        std::string chunk;
+        chunk.reserve(write_chunk_size);
+        std::string formatted;
+        while (true) {
+            ApiDumpOutputBlock *blocks = pending.exchange(nullptr);
+            if (blocks == nullptr) {
+                std::unique_lock<std::mutex> lock(wake_mutex);
+                if (stopping) break;
+                waiting.store(true);
+                wake_cv.wait(lock, [this] { return stopping || pending.load() != nullptr; });
+                waiting.store(false);
+                continue;
+            }
+
+            // The list is in reverse push order.
+            ApiDumpOutputBlock *ordered = nullptr;
+            while (blocks != nullptr) {
+                ApiDumpOutputBlock *next = blocks->next;
+                blocks->next = ordered;
+                ordered = blocks;
+                blocks = next;
+            }
+
+            while (ordered != nullptr) {
+                ApiDumpOutputBlock *block = ordered;
+                ordered = block->next;
+                if (block->frame_marker) {
+                    writeChunk(chunk);
+                    settings.setupInterFrameOutputFormatting(block->frame);
+                    first_func_call_on_frame = true;
+                } else {
+                    const CallFormatter formatter = call_formatter.load(std::memory_order_relaxed);
+                    if (formatter != nullptr) formatter(block->data, formatted);
+                    const std::string &data = formatter != nullptr ? formatted : block->data;
+                    if (!data.empty()) {
+                        if (settings.format() == ApiDumpFormat::Json && !settings.jsonLines()) {
+                            if (!first_func_call_on_frame) chunk += ",\n";
+                            first_func_call_on_frame = false;
+                        } else if (settings.format() == ApiDumpFormat::Binary) {
+                            const uint32_t record_size = static_cast<uint32_t>(data.size());
+                            chunk.append(reinterpret_cast<const char *>(&record_size), sizeof(record_size));
+                        }
+                        chunk += data;
+                        if (chunk.size() >= write_chunk_size) writeChunk(chunk);
+                    }
+                }
+                delete block;
+            }
+            writeChunk(chunk);
+            if (settings.shouldFlush()) settings.outputStream().flush();
+        }
+    }
+
+    void writeChunk(std::string &chunk) {
+        if (chunk.empty()) return;
+        settings.outputStream().write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        chunk.clear();
+    }
+
+    const ApiDumpSettings &settings;
+    std::atomic<CallFormatter> call_formatter{nullptr};
+    std::atomic<ApiDumpOutputBlock *> pending{nullptr};
+    std::atomic<bool> waiting{false};
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+    bool stopping = false;
+    std::thread writer_thread;
+
+    // Only touched by the writer thread, until it is joined.
+    bool first_func_call_on_frame = true;
+};
+
+// Call counts and driver latencies collected by the stats output format. Each thread updates its own counters, which are
+// only summed up when a report is written, so collecting them doesn't add any contention between threads.
+// The device memory allocated from every heap of every device, for memory_stats. The sizes of the allocations are counted
+// in buckets of powers of two, so that the small allocations which would better be suballocated stand out.
+class ApiDumpMemoryStats {
+   public:
+    // Bucket 0 holds allocations smaller than 4 KiB, bucket i those from 2^(i+11) up to 2^(i+12) bytes, and the last one
+    // everything larger.
+    static const uint32_t bucket_count = 20;
+
+    void addDevice(const void *device, const VkPhysicalDeviceMemoryProperties &properties) {
+        std::lock_guard<std::mutex> lg(mutex);
+        devices.emplace_back();
+        Device &added = devices.back();
+        added.key = device;
+        added.number = next_device_number++;
+        for (uint32_t i = 0; i < properties.memoryTypeCount && i < VK_MAX_MEMORY_TYPES; ++i) {
+            added.heap_of_type[i] = properties.memoryTypes[i].heapIndex;
+        }
+        added.heaps.resize(std::min<uint32_t>(properties.memoryHeapCount, VK_MAX_MEMORY_HEAPS));
+    }
+
+    // The memory which was never freed goes away with the device.
+    void removeDevice(const void *device) {
+        std::lock_guard<std::mutex> lg(mutex);
+        for (auto allocation = allocations.begin(); allocation != allocations.end();) {
+            allocation = allocation->second.device == device ? allocations.erase(allocation) : std::next(allocation);
+        }
+        devices.erase(std::remove_if(devices.begin(), devices.end(), [device](const Device &d) { return d.key == device; }),
+                      devices.end());
+    }
+
+    void allocate(const void *device, uint64_t memory, uint32_t memory_type, uint64_t size) {
+        std::lock_guard<std::mutex> lg(mutex);
+        Device *allocating = findDevice(device);
+        if (allocating == nullptr || memory_type >= VK_MAX_MEMORY_TYPES) return;
+        const uint32_t heap_index = allocating->heap_of_type[memory_type];
+        if (heap_index >= allocating->heaps.size()) return;
+        Heap &heap = allocating->heaps[heap_index];
+        heap.live_bytes += size;
+        heap.peak_bytes = std::max(heap.peak_bytes, heap.live_bytes);
+        ++heap.live_allocations;
+        ++heap.allocations;
+        ++heap.histogram[bucket(size)];
+        allocations[memory] = Allocation{device, heap_index, size};
+    }
+
+    void free(uint64_t memory) {
+        std::lock_guard<std::mutex> lg(mutex);
+        const auto allocation = allocations.find(memory);
+        if (allocation == allocations.end()) return;
+        Device *owner = findDevice(allocation->second.device);
+        if (owner != nullptr) {
+            Heap &heap = owner->heaps[allocation->second.heap];
+            heap.live_bytes -= allocation->second.size;
+            --heap.live_allocations;
+            ++heap.frees;
+        }
+        allocations.erase(allocation);
+    }
+
+    // Writes the heaps as a table, with the allocations and frees since the previous report, and starts over.
+    void writeTable(std::ostream &out) {
+        std::lock_guard<std::mutex> lg(mutex);
+        if (devices.empty()) return;
+        out << std::left << std::setw(48) << "Memory Heap" << std::right << std::setw(14) << "Live (KiB)" << std::setw(14)
+            << "Peak (KiB)" << std::setw(10) << "Live" << std::setw(12) << "Allocated" << std::setw(10) << "Freed"
+            << "\n";
+        for (Device &device : devices) {
+            for (size_t h = 0; h < device.heaps.size(); ++h) {
+                Heap &heap = device.heaps[h];
+                const std::string name = "Device " + std::to_string(device.number) + " heap " + std::to_string(h);
+                out << std::left << std::setw(48) << name << std::right << std::setw(14) << heap.live_bytes / 1024
+                    << std::setw(14) << heap.peak_bytes / 1024 << std::setw(10) << heap.live_allocations << std::setw(12)
+                    << heap.allocations << std::setw(10) << heap.frees << "\n";
+                if (heap.allocations > 0) {
+                    out << "    Allocation sizes:";
+                    for (uint32_t i = 0; i < bucket_count; ++i) {
+                        if (heap.histogram[i] == 0) continue;
+                        out << (i + 1 < bucket_count ? " <" : " >=") << bucketLimitKiB(i + 1 < bucket_count ? i : i - 1)
+                            << "KiB:" << heap.histogram[i];
+                    }
+                    out << "\n";
+                }
+                startOver(heap);
+            }
+        }
+        out << "\n";
+    }
+
+    // Writes the heaps as the members of a JSON array, and starts over.
+    void writeJson(std::ostream &out) {
+        std::lock_guard<std::mutex> lg(mutex);
+        bool first = true;
+        for (Device &device : devices) {
+            for (size_t h = 0; h < device.heaps.size(); ++h) {
+                Heap &heap = device.heaps[h];
+                out << (first ? "\n" : ",\n") << "        { \"device\" : " << device.number << ", \"heap\" : " << h
+                    << ", \"liveBytes\" : " << heap.live_bytes << ", \"peakBytes\" : " << heap.peak_bytes
+                    << ", \"liveAllocations\" : " << heap.live_allocations << ", \"allocations\" : " << heap.allocations
+                    << ", \"frees\" : " << heap.frees << ", \"histogram\" : [";
+                for (uint32_t i = 0; i < bucket_count; ++i) out << (i == 0 ? "" : ", ") << heap.histogram[i];
+                out << "] }";
+                first = false;
+                startOver(heap);
+            }
+        }
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> lg(mutex);
+        return devices.empty();
+    }
+
+    // Writes a counter event of the trace event format for every heap, so that their usage shows up as a timeline.
+    void writeTraceCounters(std::ostream &out, uint64_t process_id, uint64_t time_us) {
+        std::lock_guard<std::mutex> lg(mutex);
+        for (const Device &device : devices) {
+            for (size_t h = 0; h < device.heaps.size(); ++h) {
+                out << ",\n{\"name\" : \"Device " << device.number << " heap " << h
+                    << "\", \"cat\" : \"vulkan\", \"ph\" : \"C\", \"pid\" : " << process_id << ", \"ts\" : " << time_us
+                    << ", \"args\" : {\"liveBytes\" : " << device.heaps[h].live_bytes
+                    << ", \"liveAllocations\" : " << device.heaps[h].live_allocations << "}}";
+            }
+        }
+    }
+
+   private:
+    struct Heap {
+        uint64_t live_bytes = 0;
+        uint64_t peak_bytes = 0;
+        uint64_t live_allocations = 0;
+        // Counted since the previous report.
+        uint64_t allocations = 0;
+        uint64_t frees = 0;
+        uint64_t histogram[bucket_count] = {};
+    };
+
+    struct Device {
+        const void *key = nullptr;
+        uint64_t number = 0;
+        uint32_t heap_of_type[VK_MAX_MEMORY_TYPES] = {};
+        std::vector<Heap> heaps;
+    };
+
+    struct Allocation {
+        const void *device;
+        uint32_t heap;
+        uint64_t size;
+    };
+
+    static uint32_t bucket(uint64_t size) {
+        uint32_t index = 0;
+        for (uint64_t limit = 4096; index + 1 < bucket_count && size >= limit; limit <<= 1) ++index;
+        return index;
+    }
+
+    static uint64_t bucketLimitKiB(uint32_t index) { return uint64_t(4) << index; }
+
+    static void startOver(Heap &heap) {
+        heap.peak_bytes = heap.live_bytes;
+        heap.allocations = 0;
+        heap.frees = 0;
+        std::fill(std::begin(heap.histogram), std::end(heap.histogram), 0);
+    }
+
+    Device *findDevice(const void *device) {
+        for (Device &d : devices) {
+            if (d.key == device) return &d;
+        }
+        return nullptr;
+    }
+
+    std::mutex mutex;
+    // Devices are few, so they are looked up in order.
+    std::vector<Device> devices;
+    uint64_t next_device_number = 0;
+    std::unordered_map<uint64_t, Allocation> allocations;
+};
+
+// Looks up the debug name of an object for the statistics, which name the objects when a report is written since they are
+// usually named after they are created.
+typedef std::function<const char *(uint64_t)> ApiDumpNameLookup;
+
+// The debug name of the object, or else its handle.
+inline std::string ApiDumpStatsObjectName(const ApiDumpNameLookup &lookup, uint64_t object) {
+    const char *name = lookup ? lookup(object) : nullptr;
+    if (name != nullptr) return name;
+    std::stringstream handle;
+    handle << "0x" << std::hex << object;
+    return handle.str();
+}
+
+// The pipelines which took the longest to create, for pipeline_stats. Only the slowest are kept between reports.
+class ApiDumpPipelineStats {
+   public:
+    // How many of the slowest pipelines each report lists.
+    static const size_t reported_count = 20;
+
+    struct Stage {
+        VkShaderStageFlagBits stage;
+        uint64_t duration_ns;
+    };
+
+    struct Pipeline {
+        uint64_t handle = 0;
+        const char *kind = "";
+        // Taken from the creation feedback when there is one, or else the duration of the call shared out evenly between the
+        // pipelines it created.
+        uint64_t duration_ns = 0;
+        bool has_feedback = false;
+        bool cache_given = false;
+        bool cache_hit = false;
+        std::vector<Stage> stages;
+    };
+
+    void setNameLookup(ApiDumpNameLookup lookup) { name_lookup = std::move(lookup); }
+
+    // The devices which VkPipelineCreationFeedbackCreateInfo can be chained for, which have VK_EXT_pipeline_creation_feedback
+    // enabled or are Vulkan 1.3 devices created by a Vulkan 1.3 application.
+    void addFeedbackDevice(const void *device) {
+        std::lock_guard<std::mutex> lg(mutex);
+        feedback_devices.insert(device);
+    }
+
+    void removeDevice(const void *device) {
+        std::lock_guard<std::mutex> lg(mutex);
+        feedback_devices.erase(device);
+    }
+
+    bool hasFeedback(const void *device) {
+        std::lock_guard<std::mutex> lg(mutex);
+        return feedback_devices.count(device) > 0;
+    }
+
+    void add(std::vector<Pipeline> &created) {
+        std::lock_guard<std::mutex> lg(mutex);
+        for (Pipeline &pipeline : created) {
+            ++pipeline_count;
+            total_ns += pipeline.duration_ns;
+            if (pipeline.has_feedback && pipeline.cache_given) {
+                if (pipeline.cache_hit) {
+                    ++cache_hits;
+                } else {
+                    ++cache_misses;
+                }
+            }
+            slowest.push_back(std::move(pipeline));
+        }
+        if (slowest.size() > 2 * reported_count) keepSlowest();
+    }
+
+    // Writes the slowest pipelines created since the previous report as a table, and starts over.
+    void writeTable(std::ostream &out) {
+        std::lock_guard<std::mutex> lg(mutex);
+        if (pipeline_count == 0) return;
+        keepSlowest();
+        const std::ios_base::fmtflags flags = out.flags();
+        out << std::fixed << std::setprecision(3);
+        out << "Pipelines created: " << pipeline_count << ", total " << total_ns / 1000000.0 << " ms, pipeline cache hits "
+            << cache_hits << ", misses " << cache_misses << "\n";
+        out << std::left << std::setw(48) << "Pipeline" << std::setw(12) << "Kind" << std::right << std::setw(12) << "Time (ms)"
+            << std::setw(10) << "Cache" << "  Stages (ms)\n";
+        for (const Pipeline &pipeline : slowest) {
+            out << std::left << std::setw(48) << ApiDumpStatsObjectName(name_lookup, pipeline.handle) << std::setw(12)
+                << pipeline.kind << std::right << std::setw(12) << pipeline.duration_ns / 1000000.0 << std::setw(10)
+                << cacheResult(pipeline) << " ";
+            for (const Stage &stage : pipeline.stages) {
+                out << " " << StageName(stage.stage) << ":" << stage.duration_ns / 1000000.0;
+            }
+            out << "\n";
+        }
+        out.flags(flags);
+        out << "\n";
+        startOver();
+    }
+
+    // Writes the members of a JSON object with the slowest pipelines, and starts over.
+    void writeJson(std::ostream &out) {
+        std::lock_guard<std::mutex> lg(mutex);
+        keepSlowest();
+        out << "\"created\" : " << pipeline_count << ", \"totalNs\" : " << total_ns << ", \"cacheHits\" : " << cache_hits
+            << ", \"cacheMisses\" : " << cache_misses << ", \"slowest\" : [";
+        for (size_t p = 0; p < slowest.size(); ++p) {
+            const Pipeline &pipeline = slowest[p];
+            out << (p == 0 ? "\n" : ",\n") << "            { \"name\" : \"" << ApiDumpStatsObjectName(name_lookup, pipeline.handle)
+                << "\", \"kind\" : \"" << pipeline.kind << "\", \"durationNs\" : " << pipeline.duration_ns << ", \"cache\" : \""
+                << cacheResult(pipeline) << "\", \"stages\" : [";
+            for (size_t s = 0; s < pipeline.stages.size(); ++s) {
+                out << (s == 0 ? "" : ", ") << "{ \"stage\" : \"" << StageName(pipeline.stages[s].stage)
+                    << "\", \"durationNs\" : " << pipeline.stages[s].duration_ns << " }";
+            }
+            out << "] }";
+        }
+        out << (slowest.empty() ? "]" : "\n        ]");
+        startOver();
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> lg(mutex);
+        return pipeline_count == 0;
+    }
+
+   private:
+    static const char *StageName(VkShaderStageFlagBits stage) {
+        switch (stage) {
+            case VK_SHADER_STAGE_VERTEX_BIT:
+                return "vert";
+            case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT:
+                return "tesc";
+            case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT:
+                return "tese";
+            case VK_SHADER_STAGE_GEOMETRY_BIT:
+                return "geom";
+            case VK_SHADER_STAGE_FRAGMENT_BIT:
+                return "frag";
+            case VK_SHADER_STAGE_COMPUTE_BIT:
+                return "comp";
+            case VK_SHADER_STAGE_TASK_BIT_EXT:
+                return "task";
+            case VK_SHADER_STAGE_MESH_BIT_EXT:
+                return "mesh";
+            case VK_SHADER_STAGE_RAYGEN_BIT_KHR:
+                return "rgen";
+            case VK_SHADER_STAGE_ANY_HIT_BIT_KHR:
+                return "rahit";
+            case VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR:
+                return "rchit";
+            case VK_SHADER_STAGE_MISS_BIT_KHR:
+                return "rmiss";
+            case VK_SHADER_STAGE_INTERSECTION_BIT_KHR:
+                return "rint";
+            case VK_SHADER_STAGE_CALLABLE_BIT_KHR:
+                return "rcall";
+            default:
+                return "stage";
+        }
+    }
+
+    static const char *cacheResult(const Pipeline &pipeline) {
+        if (!pipeline.cache_given) return "none";
+        if (!pipeline.has_feedback) return "unknown";
+        return pipeline.cache_hit ? "hit" : "miss";
+    }
+
+    // Sorts the slowest pipelines first, and drops the ones which won't be reported.
+    void keepSlowest() {
+        const auto slower = [](const Pipeline &a, const Pipeline &b) { return a.duration_ns > b.duration_ns; };
+        if (slowest.size() > reported_count) {
+            std::nth_element(slowest.begin(), slowest.begin() + reported_count, slowest.end(), slower);
+            slowest.resize(reported_count);
+        }
+        std::sort(slowest.begin(), slowest.end(), slower);
+    }
+
+    void startOver() {
+        slowest.clear();
+        pipeline_count = 0;
+        total_ns = 0;
+        cache_hits = 0;
+        cache_misses = 0;
+    }
+
+    std::mutex mutex;
+    ApiDumpNameLookup name_lookup;
+    std::unordered_set<const void *> feedback_devices;
+    std::vector<Pipeline> slowest;
+    uint64_t pipeline_count = 0;
+    uint64_t total_ns = 0;
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+};
+
+// The time from the submission of batches of work to a queue until the application sees them complete, for submit_latency.
+// A batch is complete once its fence or one of its timeline semaphore signals is seen signaled by a call of the application
+// which waits for or checks on them, or once its queue or device is waited idle, so the latency is the one seen by the
+// application rather than the one of the GPU.
+class ApiDumpSubmitLatency {
+   public:
+    // Latencies are counted in buckets of powers of two microseconds: bucket 0 holds batches completed within 64us, bucket i
+    // those from 2^(i+5) up to 2^(i+6) microseconds, and the last one everything longer.
+    static const uint32_t bucket_count = 16;
+    // Batches whose completion is never seen, such as the ones submitted while the layer is disarmed and waited on after,
+    // are dropped oldest first past this many.
+    static const size_t max_pending = 4096;
+
+    struct Signal {
+        uint64_t semaphore;
+        uint64_t value;
+    };
+
+    void setNameLookup(ApiDumpNameLookup lookup) { name_lookup = std::move(lookup); }
+
+    // Only the signals of timeline semaphores tell when a batch completes.
+    void addTimelineSemaphore(uint64_t semaphore) {
+        std::lock_guard<std::mutex> lg(mutex);
+        timeline_semaphores.insert(semaphore);
+    }
+
+    void removeSemaphore(uint64_t semaphore) {
+        std::lock_guard<std::mutex> lg(mutex);
+        timeline_semaphores.erase(semaphore);
+    }
+
+    bool isTimelineSemaphore(uint64_t semaphore) {
+        std::lock_guard<std::mutex> lg(mutex);
+        return timeline_semaphores.count(semaphore) > 0;
+    }
+
+    // A batch without a fence nor any timeline semaphore signal can only be seen complete when its queue is waited idle.
+    void submit(const void *device, uint64_t queue, uint64_t fence, std::vector<Signal> signals, uint64_t time_ns) {
+        std::lock_guard<std::mutex> lg(mutex);
+        if (pending.size() >= max_pending) pending.erase(pending.begin());
+        pending.push_back(Batch{device, queue, fence, std::move(signals), time_ns});
+        queues[queue].device = device;
+    }
+
+    void completeFence(uint64_t fence, uint64_t time_ns) {
+        completeIf([fence](const Batch &batch) { return batch.fence == fence; }, time_ns);
+    }
+
+    // A fence which is reset or destroyed before it is seen signaled no longer tells when its batch completes.
+    void forgetFence(uint64_t fence) {
+        std::lock_guard<std::mutex> lg(mutex);
+        for (Batch &batch : pending) {
+            if (batch.fence == fence) batch.fence = 0;
+        }
+    }
+
+    void completeSemaphore(uint64_t semaphore, uint64_t value, uint64_t time_ns) {
+        completeIf(
+            [semaphore, value](const Batch &batch) {
+                return std::any_of(batch.signals.begin(), batch.signals.end(),
+                                   [&](const Signal &signal) { return signal.semaphore == semaphore && signal.value <= value; });
+            },
+            time_ns);
+    }
+
+    void completeQueue(uint64_t queue, uint64_t time_ns) {
+        completeIf([queue](const Batch &batch) { return batch.queue == queue; }, time_ns);
+    }
+
+    void completeDevice(const void *device, uint64_t time_ns) {
+        completeIf([device](const Batch &batch) { return batch.device == device; }, time_ns);
+    }
+
+    // The batches which were never seen complete go away with their device.
+    void removeDevice(const void *device) {
+        std::lock_guard<std::mutex> lg(mutex);
+        const auto on_device = [device](const Batch &batch) { return batch.device == device; };
+        pending.erase(std::remove_if(pending.begin(), pending.end(), on_device), pending.end());
+        for (auto queue = queues.begin(); queue != queues.end();) {
+            queue = queue->second.device == device ? queues.erase(queue) : std::next(queue);
+        }
+    }
+
+    // Writes the latencies of every queue completed since the previous report as a table, and starts over.
+    void writeTable(std::ostream &out) {
+        std::lock_guard<std::mutex> lg(mutex);
+        if (queues.empty()) return;
+        out << std::left << std::setw(48) << "Queue" << std::right << std::setw(12) << "Completed" << std::setw(12) << "Mean (ms)"
+            << std::setw(12) << "Max (ms)" << std::setw(12) << "p50 (ms)" << std::setw(12) << "p99 (ms)" << std::setw(10)
+            << "Pending"
+            << "\n";
+        const std::ios_base::fmtflags flags = out.flags();
+        out << std::fixed << std::setprecision(3);
+        for (auto &queue : queues) {
+            Latencies &latencies = queue.second;
+            const double mean_ms =
+                latencies.completed > 0 ? latencies.total_ns / 1000000.0 / static_cast<double>(latencies.completed) : 0.0;
+            out << std::left << std::setw(48) << ApiDumpStatsObjectName(name_lookup, queue.first) << std::right << std::setw(12)
+                << latencies.completed << std::setw(12) << mean_ms << std::setw(12) << latencies.max_ns / 1000000.0
+                << std::setw(12) << percentileMs(latencies, 0.5) << std::setw(12) << percentileMs(latencies, 0.99)
+                << std::setw(10) << pendingCount(queue.first) << "\n";
+            latencies = Latencies{latencies.device};
+        }
+        out.flags(flags);
+        out << "\n";
+    }
+
+    // Writes the queues as the members of a JSON array, and starts over.
+    void writeJson(std::ostream &out) {
+        std::lock_guard<std::mutex> lg(mutex);
+        bool first = true;
+        for (auto &queue : queues) {
+            Latencies &latencies = queue.second;
+            out << (first ? "\n" : ",\n") << "        { \"queue\" : \"" << ApiDumpStatsObjectName(name_lookup, queue.first)
+                << "\", \"completed\" : " << latencies.completed << ", \"totalNs\" : " << latencies.total_ns
+                << ", \"maxNs\" : " << latencies.max_ns << ", \"pending\" : " << pendingCount(queue.first)
+                << ", \"histogram\" : [";
+            for (uint32_t i = 0; i < bucket_count; ++i) out << (i == 0 ? "" : ", ") << latencies.histogram[i];
+            out << "] }";
+            first = false;
+            latencies = Latencies{latencies.device};
+        }
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> lg(mutex);
+        return queues.empty();
+    }
+
+   private:
+    struct Batch {
+        const void *device;
+        uint64_t queue;
+        uint64_t fence;
+        std::vector<Signal> signals;
+        uint64_t submit_time_ns;
+    };
+
+    // Counted since the previous report.
+    struct Latencies {
+        const void *device = nullptr;
+        uint64_t completed = 0;
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+        uint64_t histogram[bucket_count] = {};
+    };
+
+    static uint32_t bucket(uint64_t latency_ns) {
+        uint32_t index = 0;
+        for (uint64_t limit = 64000; index + 1 < bucket_count && latency_ns >= limit; limit <<= 1) ++index;
+        return index;
+    }
+
+    // The upper bound of the bucket under which at least the given fraction of the batches fall, capped to the longest.
+    static double percentileMs(const Latencies &latencies, double fraction) {
+        if (latencies.completed == 0) return 0.0;
+        uint64_t count = 0;
+        uint32_t i = 0;
+        for (; i + 1 < bucket_count; ++i) {
+            count += latencies.histogram[i];
+            if (static_cast<double>(count) >= fraction * static_cast<double>(latencies.completed)) break;
+        }
+        const uint64_t bound_ns = i + 1 == bucket_count ? latencies.max_ns : std::min(latencies.max_ns, uint64_t(64000) << i);
+        return static_cast<double>(bound_ns) / 1000000.0;
+    }
+
+    size_t pendingCount(uint64_t queue) const {
+        return std::count_if(pending.begin(), pending.end(), [queue](const Batch &batch) { return batch.queue == queue; });
+    }
+
+    template <typename Predicate>
+    void completeIf(Predicate completed, uint64_t time_ns) {
+        std::lock_guard<std::mutex> lg(mutex);
+        for (auto batch = pending.begin(); batch != pending.end();) {
+            if (!completed(*batch)) {
+                ++batch;
+                continue;
+            }
+            const uint64_t latency_ns = time_ns > batch->submit_time_ns ? time_ns - batch->submit_time_ns : 0;
+            Latencies &latencies = queues[batch->queue];
+            ++latencies.completed;
+            latencies.total_ns += latency_ns;
+            latencies.max_ns = std::max(latencies.max_ns, latency_ns);
+            ++latencies.histogram[bucket(latency_ns)];
+            batch = pending.erase(batch);
+        }
+    }
+
+    std::mutex mutex;
+    ApiDumpNameLookup name_lookup;
+    std::unordered_set<uint64_t> timeline_semaphores;
+    // In submission order. Only a few batches are in flight at a time, so they are looked up in order.
+    std::vector<Batch> pending;
+    std::map<uint64_t, Latencies> queues;
+};
+
+// Brackets the call down the chain of a pipeline creation function for pipeline_stats. When the device supports it, the
+// create infos are copied with a VkPipelineCreationFeedbackCreateInfo chained to the ones the application didn't chain
+// one to, so that the driver reports whether the pipeline cache was hit and how long each stage took.
+template <typename CreateInfo>
+class ApiDumpPipelineCreation {
+   public:
+    ApiDumpPipelineCreation(bool enabled, bool chain_feedback, const char *kind, VkPipelineCache cache, uint32_t count,
+                            const CreateInfo *create_infos)
+        : enabled(enabled && create_infos != nullptr), kind(kind), cache(cache), count(count), app_create_infos(create_infos) {
+        if (!this->enabled) return;
+        feedbacks.resize(count);
+        if (chain_feedback) {
+            copied_create_infos.assign(create_infos, create_infos + count);
+            added_feedbacks.resize(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                feedbacks[i] = FindFeedback(create_infos[i].pNext);
+                if (feedbacks[i] != nullptr) continue;
+                Feedback &added = added_feedbacks[i];
+                added.stages.resize(StageCount(create_infos[i]));
+                added.info.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+                added.info.pNext = create_infos[i].pNext;
+                added.info.pPipelineCreationFeedback = &added.pipeline;
+                added.info.pipelineStageCreationFeedbackCount = static_cast<uint32_t>(added.stages.size());
+                added.info.pPipelineStageCreationFeedbacks = added.stages.data();
+                copied_create_infos[i].pNext = &added.info;
+                feedbacks[i] = &added.info;
+            }
+        }
+        start_time = steadyTimeNs();
+    }
+
+    // The create infos to pass down the chain.
+    const CreateInfo *createInfos() const { return copied_create_infos.empty() ? app_create_infos : copied_create_infos.data(); }
+
+    // Called right after the call down the chain, with the pipelines it returned.
+    std::vector<ApiDumpPipelineStats::Pipeline> end(const VkPipeline *pipelines) const {
+        std::vector<ApiDumpPipelineStats::Pipeline> created;
+        if (!enabled || pipelines == nullptr) return created;
+        const uint64_t call_ns = steadyTimeNs() - start_time;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (pipelines[i] == VK_NULL_HANDLE) continue;
+            created.emplace_back();
+            ApiDumpPipelineStats::Pipeline &pipeline = created.back();
+            pipeline.handle = (uint64_t)pipelines[i];
+            pipeline.kind = kind;
+            pipeline.duration_ns = call_ns / count;
+            pipeline.cache_given = cache != VK_NULL_HANDLE;
+            const VkPipelineCreationFeedbackCreateInfo *feedback = feedbacks[i];
+            if (feedback == nullptr || feedback->pPipelineCreationFeedback == nullptr ||
+                (feedback->pPipelineCreationFeedback->flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) == 0) {
+                continue;
+            }
+            const VkPipelineCreationFeedback &pipeline_feedback = *feedback->pPipelineCreationFeedback;
+            pipeline.has_feedback = true;
+            pipeline.duration_ns = pipeline_feedback.duration;
+            pipeline.cache_hit = (pipeline_feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) != 0;
+            const uint32_t stage_count = std::min(feedback->pipelineStageCreationFeedbackCount, StageCount(app_create_infos[i]));
+            for (uint32_t s = 0; s < stage_count; ++s) {
+                const VkPipelineCreationFeedback &stage = feedback->pPipelineStageCreationFeedbacks[s];
+                if ((stage.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) == 0) continue;
+                pipeline.stages.push_back({Stage(app_create_infos[i], s), stage.duration});
+            }
+        }
+        return created;
+    }
+
+   private:
+    struct Feedback {
+        VkPipelineCreationFeedbackCreateInfo info = {};
+        VkPipelineCreationFeedback pipeline = {};
+        std::vector<VkPipelineCreationFeedback> stages;
+    };
+
+    static const VkPipelineCreationFeedbackCreateInfo *FindFeedback(const void *next) {
+        for (auto *header = reinterpret_cast<const VkBaseInStructure *>(next); header != nullptr; header = header->pNext) {
+            if (header->sType == VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO) {
+                return reinterpret_cast<const VkPipelineCreationFeedbackCreateInfo *>(header);
+            }
+        }
+        return nullptr;
+    }
+
+    static uint32_t StageCount(const VkGraphicsPipelineCreateInfo &create_info) { return create_info.stageCount; }
+    static uint32_t StageCount(const VkComputePipelineCreateInfo &) { return 1; }
+    static uint32_t StageCount(const VkRayTracingPipelineCreateInfoKHR &create_info) { return create_info.stageCount; }
+
+    static VkShaderStageFlagBits Stage(const VkGraphicsPipelineCreateInfo &create_info, uint32_t index) {
+        return create_info.pStages[index].stage;
+    }
+    static VkShaderStageFlagBits Stage(const VkComputePipelineCreateInfo &create_info, uint32_t) {
+        return create_info.stage.stage;
+    }
+    static VkShaderStageFlagBits Stage(const VkRayTracingPipelineCreateInfoKHR &create_info, uint32_t index) {
+        return create_info.pStages[index].stage;
+    }
+
+    static uint64_t steadyTimeNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool enabled;
+    const char *kind;
+    VkPipelineCache cache;
+    uint32_t count;
+    const CreateInfo *app_create_infos;
+    std::vector<CreateInfo> copied_create_infos;
+    // Kept in a vector of their own so that the create infos can point into them.
+    std::vector<Feedback> added_feedbacks;
+    std::vector<const VkPipelineCreationFeedbackCreateInfo *> feedbacks;
+    uint64_t start_time = 0;
+};
+
+// The time the threads of the application spend in the layer, for overhead_stats: from entering a wrapper until returning
+// from it, except for the call down the chain, which is counted as the time of the driver. That covers the capture,
+// formatting, locking and writing the calls take on the threads which make them, but not the work left to the writer
+// thread of asynchronous output.
+class ApiDumpOverhead {
+   public:
+    struct ThreadTimes {
+        uint64_t thread_id = 0;
+        // In ticks of ApiDumpClock.
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> layer_ticks{0};
+        std::atomic<uint64_t> driver_ticks{0};
+        // Never reset by the reports, for max_overhead_percent.
+        std::atomic<uint64_t> total_layer_ticks{0};
+    };
+
+    ApiDumpOverhead() : interval_start(SteadyTimeNs()) {}
+
+    // Registers the calling thread the first time. The times stay registered after the thread exits so that they still
+    // show up in the next report.
+    ThreadTimes &threadTimes(uint64_t thread_id) {
+        static thread_local ThreadTimes *thread_times = nullptr;
+        if (thread_times == nullptr) {
+            std::lock_guard<std::mutex> lg(mutex);
+            threads.push_back(std::make_unique<ThreadTimes>());
+            thread_times = threads.back().get();
+            thread_times->thread_id = thread_id;
+        }
+        return *thread_times;
+    }
+
+    // Writes the times of every thread since the previous report, covering the given number of frames, as a table, and starts
+    // over.
+    void writeTable(std::ostream &out, uint64_t frames) {
+        const Interval interval = takeInterval();
+        const std::ios_base::fmtflags flags = out.flags();
+        out << std::fixed << std::setprecision(3);
+        out << "Layer overhead over " << frames << " frames, " << interval.wall_ns / 1000000.0 << " ms ("
+            << interval.wall_ns / 1000000.0 / static_cast<double>(std::max<uint64_t>(frames, 1)) << " ms per frame)\n";
+        out << std::left << std::setw(48) << "Thread" << std::right << std::setw(10) << "Calls" << std::setw(14) << "Layer (ms)"
+            << std::setw(14) << "Driver (ms)" << std::setw(12) << "Layer (%)"
+            << "\n";
+        for (const Row &row : interval.rows) {
+            out << std::left << std::setw(48) << ("Thread " + std::to_string(row.thread_id)) << std::right << std::setw(10)
+                << row.calls << std::setw(14) << row.layer_ns / 1000000.0 << std::setw(14) << row.driver_ns / 1000000.0
+                << std::setw(12) << percentOf(row.layer_ns, interval.wall_ns) << "\n";
+        }
+        out.flags(flags);
+        out << "\n";
+    }
+
+    // Writes the members of a JSON object with the times of every thread, and starts over.
+    void writeJson(std::ostream &out) {
+        const Interval interval = takeInterval();
+        out << "\"wallNs\" : " << interval.wall_ns << ", \"threads\" : [";
+        for (size_t t = 0; t < interval.rows.size(); ++t) {
+            const Row &row = interval.rows[t];
+            out << (t == 0 ? "\n" : ",\n") << "            { \"thread\" : " << row.thread_id << ", \"calls\" : " << row.calls
+                << ", \"layerNs\" : " << row.layer_ns << ", \"driverNs\" : " << row.driver_ns << " }";
+        }
+        out << (interval.rows.empty() ? "]" : "\n        ]");
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> lg(mutex);
+        return threads.empty();
+    }
+
+    // The time every thread has spent in the layer since the start.
+    uint64_t totalLayerNs() {
+        std::lock_guard<std::mutex> lg(mutex);
+        uint64_t total_ticks = 0;
+        for (auto &thread_times : threads) total_ticks += thread_times->total_layer_ticks.load(std::memory_order_relaxed);
+        return ApiDumpClock::DurationNs(total_ticks);
+    }
+
+    static uint64_t SteadyTimeNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+   private:
+    struct Row {
+        uint64_t thread_id;
+        uint64_t calls;
+        uint64_t layer_ns;
+        uint64_t driver_ns;
+    };
+
+    struct Interval {
+        uint64_t wall_ns;
+        std::vector<Row> rows;
+    };
+
+    static double percentOf(uint64_t part, uint64_t whole) {
+        return whole > 0 ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+    }
+
+    Interval takeInterval() {
+        Interval interval;
+        std::lock_guard<std::mutex> lg(mutex);
+        const uint64_t now = SteadyTimeNs();
+        interval.wall_ns = now - interval_start;
+        interval_start = now;
+        for (auto &thread_times : threads) {
+            Row row = {thread_times->thread_id, thread_times->calls.exchange(0, std::memory_order_relaxed),
+                       ApiDumpClock::DurationNs(thread_times->layer_ticks.exchange(0, std::memory_order_relaxed)),
+                       ApiDumpClock::DurationNs(thread_times->driver_ticks.exchange(0, std::memory_order_relaxed))};
+            if (row.calls > 0) interval.rows.push_back(row);
+        }
+        return interval;
+    }
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadTimes>> threads;
+    uint64_t interval_start;
+};
+
+// Measures the time of a wrapper for overhead_stats, from its construction at the start of the wrapper until its
+// destruction on return. Does nothing without thread times to add to.
+class ApiDumpOverheadScope {
+   public:
+    explicit ApiDumpOverheadScope(ApiDumpOverhead::ThreadTimes *times)
+        : times(times), start(times != nullptr ? ApiDumpClock::Now() : 0) {}
+    ApiDumpOverheadScope(const ApiDumpOverheadScope &) = delete;
+    ApiDumpOverheadScope &operator=(const ApiDumpOverheadScope &) = delete;
+    ~ApiDumpOverheadScope() {
+        if (times == nullptr) return;
+        const uint64_t total_ticks = ApiDumpClock::Now() - start;
+        const uint64_t layer_ticks = total_ticks - std::min(total_ticks, driver_ticks);
+        times->calls.fetch_add(1, std::memory_order_relaxed);
+        times->layer_ticks.fetch_add(layer_ticks, std::memory_order_relaxed);
+        times->total_layer_ticks.fetch_add(layer_ticks, std::memory_order_relaxed);
+        times->driver_ticks.fetch_add(driver_ticks, std::memory_order_relaxed);
+    }
+
+    // Bracket the call down the chain.
+    void beginDownCall() {
+        if (times != nullptr) down_call_start = ApiDumpClock::Now();
+    }
+    void endDownCall() {
+        if (times != nullptr) driver_ticks += ApiDumpClock::Now() - down_call_start;
+    }
+
+   private:
+    ApiDumpOverhead::ThreadTimes *times;
+    uint64_t start;
+    uint64_t down_call_start = 0;
+    uint64_t driver_ticks = 0;
+};
+
+// How much is dumped with max_overhead_percent, from every call in full, to only the names of the calls, to no calls at all
+// while the statistics of the run, like its overhead, are still gathered.
+enum class ApiDumpOutputLevel { Full, NamesOnly, StatsOnly };
+
+// Steps the output down a level at the end of every window of frames in which the layer took more than max_overhead_percent
+// of the wall time, and back up a level once it takes less than half of that. Stepping up again brings back the overhead
+// which was shed, so a level which is stepped down from right after stepping up to it is held for twice as many windows
+// the next time.
+class ApiDumpOverheadBudget {
+   public:
+    static const uint64_t WINDOW_FRAMES = 30;
+    static const uint64_t MAX_HOLD_WINDOWS = 64;
+
+    struct Change {
+        ApiDumpOutputLevel level;
+        double percent;
+    };
+
+    explicit ApiDumpOverheadBudget(uint32_t max_percent) : max_percent(max_percent) {}
+
+    bool enabled() const { return max_percent > 0; }
+
+    ApiDumpOutputLevel level() const { return current_level.load(std::memory_order_relaxed); }
+
+    // Called at the end of every frame. Returns whether a window ended with a change of level, which is then described by
+    // change.
+    bool endFrame(ApiDumpOverhead &overhead, Change &change) {
+        std::lock_guard<std::mutex> lg(mutex);
+        const uint64_t now = ApiDumpOverhead::SteadyTimeNs();
+        if (window_start == 0) {
+            window_start = now;
+            window_layer_ns = overhead.totalLayerNs();
+            return false;
+        }
+        if (++window_frames < WINDOW_FRAMES) return false;
+
+        const uint64_t layer_ns = overhead.totalLayerNs();
+        const uint64_t wall_ns = std::max<uint64_t>(now - window_start, 1);
+        const double percent = 100.0 * static_cast<double>(layer_ns - window_layer_ns) / static_cast<double>(wall_ns);
+        window_start = now;
+        window_layer_ns = layer_ns;
+        window_frames = 0;
+        ++windows_since_change;
+
+        const ApiDumpOutputLevel level = current_level.load(std::memory_order_relaxed);
+        if (percent > max_percent && level != ApiDumpOutputLevel::StatsOnly) {
+            if (stepped_up && windows_since_change == 1) hold_windows = std::min(hold_windows * 2, MAX_HOLD_WINDOWS);
+            setLevel(static_cast<ApiDumpOutputLevel>(static_cast<int>(level) + 1), false);
+        } else if (percent * 2 < max_percent && level != ApiDumpOutputLevel::Full && windows_since_change >= hold_windows) {
+            setLevel(static_cast<ApiDumpOutputLevel>(static_cast<int>(level) - 1), true);
+        } else {
+            return false;
+        }
+        change = Change{current_level.load(std::memory_order_relaxed), percent};
+        return true;
+    }
+
+   private:
+    void setLevel(ApiDumpOutputLevel level, bool up) {
+        current_level.store(level, std::memory_order_relaxed);
+        stepped_up = up;
+        windows_since_change = 0;
+    }
+
+    const uint32_t max_percent;
+    std::atomic<ApiDumpOutputLevel> current_level{ApiDumpOutputLevel::Full};
+    std::mutex mutex;
+    uint64_t window_start = 0;
+    uint64_t window_layer_ns = 0;
+    uint64_t window_frames = 0;
+    uint64_t windows_since_change = 0;
+    uint64_t hold_windows = 1;
+    bool stepped_up = false;
+};
+
+class ApiDumpStats {
+   public:
+    // Latencies are counted in buckets of powers of two nanoseconds: bucket 0 holds calls shorter than 64ns, bucket i
+    // those from 2^(i+5) up to 2^(i+6) nanoseconds, and the last one everything longer.
+    static const uint32_t bucket_count = 24;
+
+    ApiDumpStats() = default;
+    ApiDumpStats(const ApiDumpStats &) = delete;
+    ApiDumpStats &operator=(const ApiDumpStats &) = delete;
+
+    // Must be called before the first call is recorded. Only the first call has an effect.
+    void setFunctions(const ApiDumpFunctionName *functions, size_t count) {
+        std::call_once(functions_set, [&]() {
+            for (size_t i = 0; i < count; ++i) function_slot_count = std::max(function_slot_count, functions[i].index + 1);
+            function_names.assign(function_slot_count, nullptr);
+            for (size_t i = 0; i < count; ++i) function_names[functions[i].index] = functions[i].name;
+        });
+    }
+
+    // Only the first call has an effect. Objects are only counted once their types are set.
+    void setObjectTypes(const ApiDumpObjectTypeName *types, size_t count) {
+        std::lock_guard<std::mutex> lg(objects_mutex);
+        if (!object_type_names.empty()) return;
+        uint32_t type_count = 0;
+        for (size_t i = 0; i < count; ++i) type_count = std::max(type_count, types[i].index + 1);
+        object_type_names.assign(type_count, nullptr);
+        for (size_t i = 0; i < count; ++i) object_type_names[types[i].index] = types[i].name;
+        object_totals.assign(type_count, ObjectTotals());
+    }
+
+    // The objects are counted by the instance or device they belong to, so that the ones still alive when it is destroyed
+    // can be reported as leaked.
+    void addObjects(const void *owner, uint32_t type, uint64_t count) {
+        std::lock_guard<std::mutex> lg(objects_mutex);
+        if (type >= object_totals.size() || count == 0) return;
+        std::vector<uint64_t> &owned = owner_objects[owner];
+        owned.resize(object_totals.size());
+        owned[type] += count;
+        ObjectTotals &totals = object_totals[type];
+        totals.created += count;
+        totals.live += count;
+        totals.peak = std::max(totals.peak, totals.live);
+    }
+
+    // Objects which were created before the statistics started counting are not taken off.
+    void removeObjects(const void *owner, uint32_t type, uint64_t count) {
+        std::lock_guard<std::mutex> lg(objects_mutex);
+        if (type >= object_totals.size() || count == 0) return;
+        const auto owned = owner_objects.find(owner);
+        if (owned == owner_objects.end()) return;
+        count = std::min(count, owned->second[type]);
+        owned->second[type] -= count;
+        object_totals[type].destroyed += count;
+        object_totals[type].live -= count;
+    }
+
+    void removeOwner(const void *owner) {
+        std::lock_guard<std::mutex> lg(objects_mutex);
+        const auto owned = owner_objects.find(owner);
+        if (owned == owner_objects.end()) return;
+        for (size_t type = 0; type < owned->second.size(); ++type) {
+            object_totals[type].leaked += owned->second[type];
+            object_totals[type].live -= owned->second[type];
+        }
+        owner_objects.erase(owned);
+    }
+
+    void record(uint32_t index, uint64_t duration_ns) {
+        ThreadStats &stats = threadStats();
+        if (index >= stats.function_count) return;
+        FunctionStats &function = stats.functions[index];
+        function.calls.fetch_add(1, std::memory_order_relaxed);
+        function.total_ns.fetch_add(duration_ns, std::memory_order_relaxed);
+        function.histogram[bucket(duration_ns)].fetch_add(1, std::memory_order_relaxed);
+        // Only the owning thread raises the maximum, so a plain compare is enough.
+        if (duration_ns > function.max_ns.load(std::memory_order_relaxed)) {
+            function.max_ns.store(duration_ns, std::memory_order_relaxed);
+        }
+    }
+
+    // Writes everything recorded since the previous report, covering frames first_frame to last_frame, and starts over.
+    void writeReport(std::ostream &out, bool json, uint64_t first_frame, uint64_t last_frame) {
+        std::vector<Totals> totals = takeTotals();
+        std::sort(totals.begin(), totals.end(), [](const Totals &a, const Totals &b) { return a.total_ns > b.total_ns; });
+        const std::vector<ObjectReport> objects = takeObjectReports();
+        if (json) {
+            writeJsonReport(out, totals, objects, first_frame, last_frame);
+        } else {
+            writeTableReport(out, totals, objects, first_frame, last_frame);
+        }
+    }
+
+    ApiDumpMemoryStats &memory() { return memory_stats; }
+    ApiDumpPipelineStats &pipelines() { return pipeline_stats; }
+    ApiDumpSubmitLatency &submits() { return submit_latency; }
+    ApiDumpOverhead &overhead() { return overhead_times; }
+
+    void setNameLookup(const ApiDumpNameLookup &lookup) {
+        pipeline_stats.setNameLookup(lookup);
+        submit_latency.setNameLookup(lookup);
+    }
+
+    // Closes the JSON array of reports.
+    void finish(std::ostream &out, bool json) {
+        if (json) out << (reports_written ? "\n]\n" : "[\n]\n");
+        out.flush();
+    }
+
+   private:
+    struct FunctionStats {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> total_ns{0};
+        std::atomic<uint64_t> max_ns{0};
+        std::atomic<uint64_t> histogram[bucket_count] = {};
+    };
+
+    struct ThreadStats {
+        std::unique_ptr<FunctionStats[]> functions;
+        uint32_t function_count = 0;
+    };
+
+    struct Totals {
+        const char *name;
+        uint64_t calls;
+        uint64_t total_ns;
+        uint64_t max_ns;
+        uint64_t histogram[bucket_count];
+    };
+
+    // The churn counts start over with every report, the peak starts over from the objects alive at the time.
+    struct ObjectTotals {
+        uint64_t live = 0;
+        uint64_t peak = 0;
+        uint64_t created = 0;
+        uint64_t destroyed = 0;
+        uint64_t leaked = 0;
+    };
+
+    struct ObjectReport {
+        const char *name;
+        ObjectTotals totals;
+    };
+
+    static uint32_t bucket(uint64_t duration_ns) {
+        uint32_t index = 0;
+        for (uint64_t limit = 64; index + 1 < bucket_count && duration_ns >= limit; limit <<= 1) ++index;
+        return index;
+    }
+
+    // The upper bound of the bucket under which at least the given fraction of the calls fall.
+    static double percentileUs(const Totals &totals, double fraction) {
+        uint64_t count = 0;
+        uint32_t i = 0;
+        for (; i + 1 < bucket_count; ++i) {
+            count += totals.histogram[i];
+            if (static_cast<double>(count) >= fraction * static_cast<double>(totals.calls)) break;
+        }
+        if (i + 1 == bucket_count) return static_cast<double>(totals.max_ns) / 1000.0;
+        return static_cast<double>(uint64_t(64) << i) / 1000.0;
+    }
+
+    // Registers the calling thread the first time it records a call. The counters stay registered after the thread exits
+    // so that its calls still show up in the next report.
+    ThreadStats &threadStats() {
+        static thread_local ThreadStats *thread_stats = nullptr;
+        if (thread_stats == nullptr) {
+            std::lock_guard<std::mutex> lg(threads_mutex);
+            threads.push_back(std::make_unique<ThreadStats>());
+            thread_stats = threads.back().get();
+            thread_stats->function_count = function_slot_count;
+            thread_stats->functions = std::make_unique<FunctionStats[]>(function_slot_count);
+        }
+        return *thread_stats;
+    }
+
+    std::vector<Totals> takeTotals() {
+        std::vector<Totals> totals;
+        std::lock_guard<std::mutex> lg(threads_mutex);
+        for (uint32_t index = 0; index < function_slot_count; ++index) {
+            Totals function_totals = {function_names[index], 0, 0, 0, {}};
+            for (auto &thread_stats : threads) {
+                if (index >= thread_stats->function_count) continue;
+                FunctionStats &function = thread_stats->functions[index];
+                function_totals.calls += function.calls.exchange(0, std::memory_order_relaxed);
+                function_totals.total_ns += function.total_ns.exchange(0, std::memory_order_relaxed);
+                function_totals.max_ns = std::max(function_totals.max_ns, function.max_ns.exchange(0, std::memory_order_relaxed));
+                for (uint32_t i = 0; i < bucket_count; ++i) {
+                    function_totals.histogram[i] += function.histogram[i].exchange(0, std::memory_order_relaxed);
+                }
+            }
+            if (function_totals.calls > 0 && function_totals.name != nullptr) totals.push_back(function_totals);
+        }
+        return totals;
+    }
+
+    // The handle types which had objects alive or counted since the previous report.
+    std::vector<ObjectReport> takeObjectReports() {
+        std::vector<ObjectReport> reports;
+        std::lock_guard<std::mutex> lg(objects_mutex);
+        for (size_t type = 0; type < object_totals.size(); ++type) {
+            ObjectTotals &totals = object_totals[type];
+            if (totals.peak == 0 && totals.destroyed == 0 && totals.leaked == 0) continue;
+            if (object_type_names[type] != nullptr) reports.push_back(ObjectReport{object_type_names[type], totals});
+            totals.peak = totals.live;
+            totals.created = 0;
+            totals.destroyed = 0;
+            totals.leaked = 0;
+        }
+        return reports;
+    }
+
+    void writeTableReport(std::ostream &out, const std::vector<Totals> &totals, const std::vector<ObjectReport> &objects,
+                          uint64_t first_frame, uint64_t last_frame) {
+        out << "Frames " << first_frame << "-" << last_frame << ":\n";
+        out << std::left << std::setw(48) << "Function" << std::right << std::setw(10) << "Calls" << std::setw(14)
+            << "Total (us)" << std::setw(12) << "Mean (us)" << std::setw(12) << "Max (us)" << std::setw(12) << "p50 (us)"
+            << std::setw(12) << "p99 (us)"
+            << "\n";
+        const std::ios_base::fmtflags flags = out.flags();
+        out << std::fixed << std::setprecision(3);
+        for (const Totals &function : totals) {
+            out << std::left << std::setw(48) << function.name << std::right << std::setw(10) << function.calls
+                << std::setw(14) << function.total_ns / 1000.0 << std::setw(12)
+                << function.total_ns / 1000.0 / static_cast<double>(function.calls) << std::setw(12) << function.max_ns / 1000.0
+                << std::setw(12) << percentileUs(function, 0.5) << std::setw(12) << percentileUs(function, 0.99) << "\n";
+        }
+        out.flags(flags);
+        out << "\n";
+        if (!objects.empty()) {
+            out << std::left << std::setw(48) << "Object Type" << std::right << std::setw(10) << "Live" << std::setw(10)
+                << "Peak" << std::setw(10) << "Created" << std::setw(10) << "Destroyed" << std::setw(10) << "Leaked"
+                << "\n";
+            for (const ObjectReport &object : objects) {
+                out << std::left << std::setw(48) << object.name << std::right << std::setw(10) << object.totals.live
+                    << std::setw(10) << object.totals.peak << std::setw(10) << object.totals.created << std::setw(10)
+                    << object.totals.destroyed << std::setw(10) << object.totals.leaked << "\n";
+            }
+            out.flags(flags);
+            out << "\n";
+        }
+        memory_stats.writeTable(out);
+        if (!memory_stats.empty()) writeLayerMemoryTable(out);
+        pipeline_stats.writeTable(out);
+        submit_latency.writeTable(out);
+        if (!overhead_times.empty()) overhead_times.writeTable(out, last_frame - first_frame + 1);
+        out.flags(flags);
+    }
+
+    // The host memory the layer holds for its own bookkeeping, reported along with the device memory.
+    static void writeLayerMemoryTable(std::ostream &out) {
+        out << std::left << std::setw(48) << "Layer Memory" << std::right << std::setw(14) << "Live (KiB)" << std::setw(14)
+            << "Peak (KiB)"
+            << "\n";
+        LayerMemoryAccount::for_each([&out](const LayerMemoryAccount &account) {
+            out << std::left << std::setw(48) << account.name() << std::right << std::setw(14) << account.live() / 1024
+                << std::setw(14) << account.peak() / 1024 << "\n";
+        });
+        out << "\n";
+    }
+
+    static void writeLayerMemoryJson(std::ostream &out) {
+        bool first = true;
+        LayerMemoryAccount::for_each([&out, &first](const LayerMemoryAccount &account) {
+            out << (first ? "\n" : ",\n") << "        { \"name\" : \"" << account.name() << "\", \"liveBytes\" : " << account.live()
+                << ", \"peakBytes\" : " << account.peak() << " }";
+            first = false;
+        });
+    }
+
+    void writeJsonReport(std::ostream &out, const std::vector<Totals> &totals, const std::vector<ObjectReport> &objects,
+                         uint64_t first_frame, uint64_t last_frame) {
+        out << (reports_written ? ",\n" : "[\n");
+        reports_written = true;
+        out << "{\n    \"firstFrame\" : " << first_frame << ",\n    \"lastFrame\" : " << last_frame
+            << ",\n    \"histogramBucketsNs\" : [0";
+        for (uint32_t i = 1; i < bucket_count; ++i) out << ", " << (uint64_t(64) << (i - 1));
+        out << "],\n    \"functions\" :\n    [";
+        for (size_t f = 0; f < totals.size(); ++f) {
+            const Totals &function = totals[f];
+            out << (f == 0 ? "\n" : ",\n") << "        { \"name\" : \"" << function.name << "\", \"calls\" : " << function.calls
+                << ", \"totalNs\" : " << function.total_ns << ", \"maxNs\" : " << function.max_ns << ", \"histogram\" : [";
+            for (uint32_t i = 0; i < bucket_count; ++i) out << (i == 0 ? "" : ", ") << function.histogram[i];
+            out << "] }";
+        }
+        out << "\n    ]";
+        if (!objects.empty()) {
+            out << ",\n    \"objects\" :\n    [";
+            for (size_t o = 0; o < objects.size(); ++o) {
+                const ObjectReport &object = objects[o];
+                out << (o == 0 ? "\n" : ",\n") << "        { \"type\" : \"" << object.name << "\", \"live\" : "
+                    << object.totals.live << ", \"peak\" : " << object.totals.peak << ", \"created\" : " << object.totals.created
+                    << ", \"destroyed\" : " << object.totals.destroyed << ", \"leaked\" : " << object.totals.leaked << " }";
+            }
+            out << "\n    ]";
+        }
+        if (!memory_stats.empty()) {
+            out << ",\n    \"memoryHeaps\" :\n    [";
+            memory_stats.writeJson(out);
+            out << "\n    ],\n    \"layerMemory\" :\n    [";
+            writeLayerMemoryJson(out);
+            out << "\n    ]";
+        }
+        if (!pipeline_stats.empty()) {
+            out << ",\n    \"pipelines\" :\n    {\n        ";
+            pipeline_stats.writeJson(out);
+            out << "\n    }";
+        }
+        if (!submit_latency.empty()) {
+            out << ",\n    \"submitLatency\" :\n    [";
+            submit_latency.writeJson(out);
+            out << "\n    ]";
+        }
+        if (!overhead_times.empty()) {
+            out << ",\n    \"overhead\" :\n    {\n        ";
+            overhead_times.writeJson(out);
+            out << "\n    }";
+        }
+        out << "\n}";
+    }
+
+    std::once_flag functions_set;
+    uint32_t function_slot_count = 0;
+    std::vector<const char *> function_names;
+
+    std::mutex threads_mutex;
+    std::vector<std::unique_ptr<ThreadStats>> threads;
+
+    ApiDumpMemoryStats memory_stats;
+    ApiDumpPipelineStats pipeline_stats;
+    ApiDumpSubmitLatency submit_latency;
+    ApiDumpOverhead overhead_times;
+
+    std::mutex objects_mutex;
+    std::vector<const char *> object_type_names;
+    std::vector<ObjectTotals> object_totals;
+    // The objects alive of every instance and device, by handle type.
+    std::unordered_map<const void *, std::vector<uint64_t>> owner_objects;
+
+    // Only touched while the output mutex is held.
+    bool reports_written = false;
+};
+
+// Keeps the most recent binary records of every thread in memory instead of writing them, so that the calls leading up
+// to a device loss or a crash can be captured without paying for the output of every call. Each thread appends to its
+// own ring, which drops its oldest records to make room.
+class ApiDumpFlightRecorder {
+   public:
+    ApiDumpFlightRecorder() = default;
+    ApiDumpFlightRecorder(const ApiDumpFlightRecorder &) = delete;
+    ApiDumpFlightRecorder &operator=(const ApiDumpFlightRecorder &) = delete;
+
+    // Must be called before the first record. A capacity of 0 leaves the recorder disabled.
+    void setCapacity(size_t capacity) { ring_capacity = capacity; }
+    bool enabled() const { return ring_capacity > 0; }
+
+    void record(const char *payload, uint32_t size) {
+        Ring &ring = threadRing();
+        std::lock_guard<std::mutex> lg(ring.mutex);
+        ring.push(payload, size);
+    }
+
+    // Writes the records of every thread in the order of their sequence numbers, each prefixed with its size like in a
+    // binary capture, and empties the rings. With try_lock, rings which are in use are skipped rather than waited for,
+    // which is what a fatal signal handler needs.
+    void write(std::ostream &out, bool try_lock) {
+        const auto acquire = [try_lock](std::unique_lock<std::mutex> &lock) {
+            if (try_lock) return lock.try_lock();
+            lock.lock();
+            return true;
+        };
+        std::vector<std::string> records;
+        std::unique_lock<std::mutex> threads_lock(threads_mutex, std::defer_lock);
+        if (!acquire(threads_lock)) return;
+        for (auto &ring : threads) {
+            std::unique_lock<std::mutex> ring_lock(ring->mutex, std::defer_lock);
+            if (acquire(ring_lock)) ring->take(records);
+        }
+        threads_lock.unlock();
+
+        // The payload starts with the thread, the frame, the time and the sequence number of the call.
+        const auto sequence = [](const std::string &record) {
+            uint64_t value = 0;
+            memcpy(&value, record.data() + sizeof(uint32_t) + 3 * sizeof(uint64_t), sizeof(value));
+            return value;
+        };
+        std::sort(records.begin(), records.end(),
+                  [&sequence](const std::string &a, const std::string &b) { return sequence(a) < sequence(b); });
+        for (const std::string &record : records) out.write(record.data(), static_cast<std::streamsize>(record.size()));
+        out.flush();
+    }
+
+   private:
+    // Records are stored as their uint32_t size followed by the payload, wrapping around the end of the buffer.
+    struct Ring {
+        explicit Ring(size_t capacity) : data(capacity) {}
+
+        void push(const char *payload, uint32_t size) {
+            const size_t needed = sizeof(size) + size;
+            // Every record carries at least its head, so a ring too small for a record drops it rather than the history.
+            if (needed > data.size()) return;
+            while (data.size() - used < needed) {
+                uint32_t oldest_size = 0;
+                copyOut(head, &oldest_size, sizeof(oldest_size));
+                head = (head + sizeof(oldest_size) + oldest_size) % data.size();
+                used -= sizeof(oldest_size) + oldest_size;
+            }
+            copyIn(&size, sizeof(size));
+            copyIn(payload, size);
+        }
+
+        void take(std::vector<std::string> &records) {
+            while (used > 0) {
+                uint32_t size = 0;
+                copyOut(head, &size, sizeof(size));
+                std::string record(sizeof(size) + size, '\0');
+                copyOut(head, &record[0], record.size());
+                records.push_back(std::move(record));
+                head = (head + sizeof(size) + size) % data.size();
+                used -= sizeof(size) + size;
+            }
+            head = 0;
+        }
+
+        void copyIn(const void *source, size_t size) {
+            const size_t tail = (head + used) % data.size();
+            const size_t first = std::min(size, data.size() - tail);
+            memcpy(&data[tail], source, first);
+            memcpy(&data[0], static_cast<const char *>(source) + first, size - first);
+            used += size;
+        }
+
+        void copyOut(size_t offset, void *destination, size_t size) const {
+            const size_t first = std::min(size, data.size() - offset);
+            memcpy(destination, &data[offset], first);
+            memcpy(static_cast<char *>(destination) + first, &data[0], size - first);
+        }
+
+        std::mutex mutex;
+        std::vector<char> data;
+        size_t head = 0;
+        size_t used = 0;
+    };
+
+    // Registers the calling thread the first time it records a call. The ring stays registered after the thread exits so
+    // that its calls are still written out.
+    Ring &threadRing() {
+        static thread_local Ring *thread_ring = nullptr;
+        if (thread_ring == nullptr) {
+            std::lock_guard<std::mutex> lg(threads_mutex);
+            threads.push_back(std::make_unique<Ring>(ring_capacity));
+            thread_ring = threads.back().get();
+        }
+        return *thread_ring;
+    }
+
+    size_t ring_capacity = 0;
+
+    std::mutex threads_mutex;
+    std::vector<std::unique_ptr<Ring>> threads;
+};
+
+// Maps object handles to the debug names given to them. Looking a name up never blocks: the table is an open addressed array
+// of atomic slots, and naming an object only ever adds slots or swaps the name of one, under a mutex which lookups don't
+// take. Growing the table publishes a new array, and the old ones are kept until destruction since a lookup may still be
+// probing them. Names are interned, so naming many objects alike allocates the name once, and a name returned by a lookup
+// stays valid for the lifetime of the map.
+inline LayerMemoryAccount api_dump_object_name_memory("object names");
+
+class ApiDumpObjectNameMap {
+   public:
+    ApiDumpObjectNameMap() { table.store(growTable(nullptr, 0), std::memory_order_relaxed); }
+    ApiDumpObjectNameMap(const ApiDumpObjectNameMap &) = delete;
+    ApiDumpObjectNameMap &operator=(const ApiDumpObjectNameMap &) = delete;
+
+    // A null name removes the name of the object.
+    void setName(uint64_t object, const char *name) {
+        if (object == 0) return;
+        std::lock_guard<std::mutex> lg(write_mutex);
+        const char *interned = name != nullptr ? intern(name) : nullptr;
+        Table *current = table.load(std::memory_order_relaxed);
+
+        // A slot whose name was removed is reused by the next object which lands on it, once the object turns out not to
+        // have a slot of its own further on.
+        Slot *reusable = nullptr;
+        for (size_t i = slotIndex(current, object), probes = 0; probes <= current->mask; i = (i + 1) & current->mask, ++probes) {
+            Slot &slot = current->slots[i];
+            const uint64_t slot_object = slot.object.load(std::memory_order_relaxed);
+            if (slot_object == object) {
+                slot.name.store(interned, std::memory_order_release);
+                return;
+            }
+            if (slot_object == 0) break;
+            if (reusable == nullptr && slot.name.load(std::memory_order_relaxed) == nullptr) reusable = &slot;
+        }
+        if (interned == nullptr) return;
+        if (reusable != nullptr) {
+            // A concurrent lookup of the object sees it as unnamed until the name is stored, as if it looked first.
+            reusable->name.store(nullptr, std::memory_order_relaxed);
+            reusable->object.store(object, std::memory_order_release);
+            reusable->name.store(interned, std::memory_order_release);
+            return;
+        }
+
+        if ((current->used + 1) * 4 > (current->mask + 1) * 3) {
+            current = growTable(current, current->used + 1);
+            table.store(current, std::memory_order_release);
+        }
+        insert(*current, object, interned);
+    }
+
+    // Returns the name of the object, or null if it has not been named. Wait-free.
+    const char *name(uint64_t object) const {
+        const Table *current = table.load(std::memory_order_acquire);
+        for (size_t i = slotIndex(current, object), probes = 0; probes <= current->mask; i = (i + 1) & current->mask, ++probes) {
+            const Slot &slot = current->slots[i];
+            const uint64_t slot_object = slot.object.load(std::memory_order_acquire);
+            if (slot_object == object) return slot.name.load(std::memory_order_acquire);
+            if (slot_object == 0) return nullptr;
+        }
+        return nullptr;
+    }
+
+   private:
+    struct Slot {
+        std::atomic<uint64_t> object{0};
+        std::atomic<const char *> name{nullptr};
+    };
+
+    struct Table {
+        explicit Table(size_t capacity) : slots(new Slot[capacity]), mask(capacity - 1) {
+            api_dump_object_name_memory.allocated(capacity * sizeof(Slot));
+        }
+        ~Table() { api_dump_object_name_memory.freed((mask + 1) * sizeof(Slot)); }
+        std::unique_ptr<Slot[]> slots;
+        size_t mask;
+        // Slots holding an object, named or not.
+        size_t used = 0;
+    };
+
+    static size_t slotIndex(const Table *current, uint64_t object) {
+        object ^= object >> 33;
+        object *= 0xff51afd7ed558ccdULL;
+        object ^= object >> 33;
+        return static_cast<size_t>(object) & current->mask;
+    }
+
+    // The name is stored before the object, so a lookup which finds the object also finds its name.
+    static void insert(Table &current, uint64_t object, const char *name) {
+        size_t i = slotIndex(&current, object);
+        while (current.slots[i].object.load(std::memory_order_relaxed) != 0) i = (i + 1) & current.mask;
+        current.slots[i].name.store(name, std::memory_order_relaxed);
+        current.slots[i].object.store(object, std::memory_order_release);
+        ++current.used;
+    }
+
+    // Makes a table with room for at least the given number of objects, holding the named objects of the old table.
+    Table *growTable(const Table *old, size_t count) {
+        size_t capacity = 64;
+        while (capacity * 3 < count * 4 * 2) capacity *= 2;
+        tables.push_back(std::make_unique<Table>(capacity));
+        Table *grown = tables.back().get();
+        if (old != nullptr) {
+            for (size_t i = 0; i <= old->mask; ++i) {
+                const char *name = old->slots[i].name.load(std::memory_order_relaxed);
+                if (name != nullptr) insert(*grown, old->slots[i].object.load(std::memory_order_relaxed), name);
+            }
+        }
+        return grown;
+    }
+
+    const char *intern(const char *name) {
+        const auto it = interned_names.find(std::string_view(name));
+        if (it != interned_names.end()) return it->data();
+        names.emplace_back(name);
+        interned_names.insert(std::string_view(names.back()));
+        return names.back().c_str();
+    }
+
+    std::atomic<Table *> table{nullptr};
+    std::mutex write_mutex;
+    // Every table ever published, the last one being the current one.
+    std::vector<std::unique_ptr<Table>> tables;
+    template <typename T>
+    using Allocator = LayerAllocator<T, api_dump_object_name_memory>;
+    using Name = std::basic_string<char, std::char_traits<char>, Allocator<char>>;
+
+    // A deque never moves its strings, so the views and the names handed out stay valid.
+    std::deque<Name, Allocator<Name>> names;
+    std::unordered_set<std::string_view, std::hash<std::string_view>, std::equal_to<std::string_view>, Allocator<std::string_view>>
+        interned_names;
+};
+
+// The arguments of one call, which the generated functions hand over once the call returned, to be tested against the
+// filter.
+class ApiDumpFilteredCall {
+   public:
+    ApiDumpFilteredCall(const ApiDumpCallFilter &filter, const ApiDumpObjectNameMap &names) : filter(filter), names(names) {}
+
+    template <typename T>
+    void addHandle(T handle) {
+        addHandleValue((uint64_t)handle);
+    }
+
+    template <typename T>
+    void addHandles(const T *handles, size_t count) {
+        if (handles == nullptr) return;
+        for (size_t i = 0; i < count; ++i) addHandle(handles[i]);
+    }
+
+    void setResult(VkResult result) {
+        has_result = true;
+        const std::vector<ApiDumpCallFilter::Term> &terms = filter.getTerms();
+        for (size_t i = 0; i < terms.size(); ++i) {
+            if (terms[i].subject == ApiDumpCallFilter::Subject::Result && terms[i].result == result) {
+                found_terms |= uint64_t(1) << i;
+            }
+        }
+    }
+
+    bool matches() const { return filter.matches(found_terms, has_result); }
+
+   private:
+    void addHandleValue(uint64_t handle) {
+        if (handle == 0) return;
+        const char *name = filter.hasNameTerms() ? names.name(handle) : nullptr;
+        const std::vector<ApiDumpCallFilter::Term> &terms = filter.getTerms();
+        for (size_t i = 0; i < terms.size(); ++i) {
+            const bool found = terms[i].subject == ApiDumpCallFilter::Subject::Handle
+                                   ? terms[i].handle == handle
+                                   : terms[i].subject == ApiDumpCallFilter::Subject::Name && name != nullptr &&
+                                         ApiDumpSettings::MatchesWildcard(terms[i].name.c_str(), name);
+            if (found) found_terms |= uint64_t(1) << i;
+        }
+    }
+
+    const ApiDumpCallFilter &filter;
+    const ApiDumpObjectNameMap &names;
+    uint64_t found_terms = 0;
+    bool has_result = false;
+};
+
+// Tracks the level of every allocated command buffer and the command buffers of every pool, so that destroying a pool
+// forgets its command buffers. Both are split into shards with a mutex each, hashed by the command buffer or the pool, so
+// that threads working on different pools rarely meet. Vulkan requires a pool and its command buffers to be externally
+// synchronized, so the two shards one change touches never have to be locked together.
+// Handles are mostly aligned addresses, so their low bits have to be mixed in with the rest before picking a shard.
+inline size_t ApiDumpShardHash(uint64_t handle) {
+    handle ^= handle >> 33;
+    handle *= 0xff51afd7ed558ccdULL;
+    handle ^= handle >> 33;
+    return static_cast<size_t>(handle);
+}
+
+inline LayerMemoryAccount api_dump_cmd_buffer_memory("command buffers");
+
+using ApiDumpCmdBufferSet = std::unordered_set<VkCommandBuffer, std::hash<VkCommandBuffer>, std::equal_to<VkCommandBuffer>,
+                                               LayerAllocator<VkCommandBuffer, api_dump_cmd_buffer_memory>>;
+
+class ApiDumpCmdBufferTracker {
+   public:
+    void add(VkDevice device, VkCommandPool pool, const VkCommandBuffer *cmd_buffers, uint32_t count, VkCommandBufferLevel level,
+             bool replaying) {
+        if (cmd_buffers == nullptr || count == 0) return;
+        {
+            PoolShard &shard = poolShard(pool);
+            std::lock_guard<std::mutex> lg(shard.mutex);
+            shard.pools[PoolKey{device, pool}].insert(cmd_buffers, cmd_buffers + count);
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            CmdBufferShard &shard = cmdBufferShard(cmd_buffers[i]);
+            std::lock_guard<std::mutex> lg(shard.mutex);
+            const bool inserted = shard.levels.insert_or_assign(cmd_buffers[i], level).second;
+            assert(inserted || replaying);
+            (void)inserted;
+            (void)replaying;
+        }
+    }
+
+    void erase(VkDevice device, VkCommandPool pool, const VkCommandBuffer *cmd_buffers, uint32_t count, bool replaying) {
+        if (cmd_buffers == nullptr || count == 0) return;
+        {
+            PoolShard &shard = poolShard(pool);
+            std::lock_guard<std::mutex> lg(shard.mutex);
+            const auto pool_iter = shard.pools.find(PoolKey{device, pool});
+            assert(pool_iter != shard.pools.end() || replaying);
+            if (pool_iter == shard.pools.end()) return;
+            for (uint32_t i = 0; i < count; ++i) pool_iter->second.erase(cmd_buffers[i]);
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            if (cmd_buffers[i] == VK_NULL_HANDLE) continue;
+            CmdBufferShard &shard = cmdBufferShard(cmd_buffers[i]);
+            std::lock_guard<std::mutex> lg(shard.mutex);
+            const size_t erased = shard.levels.erase(cmd_buffers[i]);
+            assert(erased > 0 || replaying);
+            (void)erased;
+        }
+    }
+
+    // Returns the command buffers of the pool, which are erased along with it.
+    ApiDumpCmdBufferSet erasePool(VkDevice device, VkCommandPool pool) {
+        ApiDumpCmdBufferSet cmd_buffers;
+        if (pool == VK_NULL_HANDLE) return cmd_buffers;
+        {
+            PoolShard &shard = poolShard(pool);
+            std::lock_guard<std::mutex> lg(shard.mutex);
+            const auto pool_iter = shard.pools.find(PoolKey{device, pool});
+            if (pool_iter == shard.pools.end()) return cmd_buffers;
+            cmd_buffers.swap(pool_iter->second);
+            shard.pools.erase(pool_iter);
+        }
+        for (const VkCommandBuffer cmd_buffer : cmd_buffers) {
+            CmdBufferShard &shard = cmdBufferShard(cmd_buffer);
+            std::lock_guard<std::mutex> lg(shard.mutex);
+            shard.levels.erase(cmd_buffer);
+        }
+        return cmd_buffers;
+    }
+
+    // Returns false if the command buffer is not tracked.
+    bool level(VkCommandBuffer cmd_buffer, VkCommandBufferLevel &level) {
+        CmdBufferShard &shard = cmdBufferShard(cmd_buffer);
+        std::lock_guard<std::mutex> lg(shard.mutex);
+        const auto level_iter = shard.levels.find(cmd_buffer);
+        if (level_iter == shard.levels.end()) return false;
+        level = level_iter->second;
+        return true;
+    }
+
+   private:
+    static constexpr size_t shard_count = 16;
+
+    struct PoolKey {
+        VkDevice device;
+        VkCommandPool pool;
+        bool operator==(const PoolKey &other) const { return device == other.device && pool == other.pool; }
+    };
+    struct PoolKeyHash {
+        size_t operator()(const PoolKey &key) const { return ApiDumpShardHash(reinterpret_cast<uint64_t>(key.pool)); }
+    };
+
+    template <typename T>
+    using Allocator = LayerAllocator<T, api_dump_cmd_buffer_memory>;
+
+    struct PoolShard {
+        std::mutex mutex;
+        std::unordered_map<PoolKey, ApiDumpCmdBufferSet, PoolKeyHash, std::equal_to<PoolKey>,
+                           Allocator<std::pair<const PoolKey, ApiDumpCmdBufferSet>>>
+            pools;
+    };
+    struct CmdBufferShard {
+        std::mutex mutex;
+        std::unordered_map<VkCommandBuffer, VkCommandBufferLevel, std::hash<VkCommandBuffer>, std::equal_to<VkCommandBuffer>,
+                           Allocator<std::pair<const VkCommandBuffer, VkCommandBufferLevel>>>
+            levels;
+    };
+
+    PoolShard &poolShard(VkCommandPool pool) {
+        return pool_shards[ApiDumpShardHash(reinterpret_cast<uint64_t>(pool)) % shard_count];
+    }
+    CmdBufferShard &cmdBufferShard(VkCommandBuffer cmd_buffer) {
+        return cmd_buffer_shards[ApiDumpShardHash(reinterpret_cast<uint64_t>(cmd_buffer)) % shard_count];
+    }
+
+    PoolShard pool_shards[shard_count];
+    CmdBufferShard cmd_buffer_shards[shard_count];
+};
+
+// The debug label scopes of every command buffer and queue, for label_scopes. Only the depth of the labels is kept, with the
+// depth of the outermost label which is dumped, since everything is dumped until that label ends. The number of command
+// buffers and queues inside a dumped label is counted, so that the calls made outside of every label take no lock.
+inline LayerMemoryAccount api_dump_label_scope_memory("label scopes");
+
+class ApiDumpLabelScopes {
+   public:
+    void begin(const void *object, bool dumped) {
+        Shard &shard = objectShard(object);
+        std::lock_guard<std::mutex> lg(shard.mutex);
+        Labels &labels = shard.labels[object];
+        ++labels.depth;
+        if (dumped && labels.dumped_depth == 0) {
+            labels.dumped_depth = labels.depth;
+            open_scopes.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void end(const void *object) {
+        Shard &shard = objectShard(object);
+        std::lock_guard<std::mutex> lg(shard.mutex);
+        const auto labels_iter = shard.labels.find(object);
+        if (labels_iter == shard.labels.end()) return;
+        Labels &labels = labels_iter->second;
+        if (labels.depth == labels.dumped_depth) {
+            labels.dumped_depth = 0;
+            open_scopes.fetch_sub(1, std::memory_order_relaxed);
+        }
+        if (--labels.depth == 0) shard.labels.erase(labels_iter);
+    }
+
+    // Drops the labels of a command buffer which is recorded again or freed.
+    void erase(const void *object) {
+        Shard &shard = objectShard(object);
+        std::lock_guard<std::mutex> lg(shard.mutex);
+        const auto labels_iter = shard.labels.find(object);
+        if (labels_iter == shard.labels.end()) return;
+        if (labels_iter->second.dumped_depth != 0) open_scopes.fetch_sub(1, std::memory_order_relaxed);
+        shard.labels.erase(labels_iter);
+    }
+
+    bool inScope(const void *object) {
+        if (open_scopes.load(std::memory_order_relaxed) == 0) return false;
+        Shard &shard = objectShard(object);
+        std::lock_guard<std::mutex> lg(shard.mutex);
+        const auto labels_iter = shard.labels.find(object);
+        return labels_iter != shard.labels.end() && labels_iter->second.dumped_depth != 0;
+    }
+
+   private:
+    static constexpr size_t shard_count = 16;
+
+    struct Labels {
+        uint32_t depth = 0;
+        // 0 while no label the object is in is dumped.
+        uint32_t dumped_depth = 0;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<const void *, Labels, std::hash<const void *>, std::equal_to<const void *>,
+                           LayerAllocator<std::pair<const void *const, Labels>, api_dump_label_scope_memory>>
+            labels;
+    };
+
+    Shard &objectShard(const void *object) {
+        return shards[ApiDumpShardHash(reinterpret_cast<uint64_t>(object)) % shard_count];
+    }
+
+    Shard shards[shard_count];
+    std::atomic<int64_t> open_scopes{0};
+};
+
+// The formatted vkCmd* calls of every command buffer, kept from recording until the command buffer is submitted so that
+// the dump of a frame shows the commands it executes. Each recording is written out as a block the first time it is
+// submitted, and submitting it again only refers back to that block. Command buffers which are never submitted are never
+// written out.
+inline LayerMemoryAccount api_dump_cmd_buffer_capture_memory("command buffer captures");
+
+class ApiDumpCmdBufferCapture {
+   public:
+    // Starts a new recording of the command buffer, which drops the commands of the previous one.
+    void begin(VkCommandBuffer cmd_buffer) {
+        std::lock_guard<std::mutex> lg(mutex);
+        Recording &recording = recordings[cmd_buffer];
+        recording.commands.clear();
+        recording.generation++;
+        recording.block = 0;
+    }
+
+    void append(VkCommandBuffer cmd_buffer, const char *data, size_t size) {
+        std::lock_guard<std::mutex> lg(mutex);
+        recordings[cmd_buffer].commands.append(data, size);
+    }
+
+    template <typename Iterator>
+    void erase(Iterator first, Iterator last) {
+        std::lock_guard<std::mutex> lg(mutex);
+        for (; first != last; ++first) recordings.erase(*first);
+    }
+
+    void writeSubmitted(std::ostream &stream, VkCommandBuffer cmd_buffer) {
+        std::lock_guard<std::mutex> lg(mutex);
+        const auto recording_iter = recordings.find(cmd_buffer);
+        if (recording_iter == recordings.end()) {
+            stream << "Command buffer " << cmd_buffer << " was not recorded since the layer was loaded\n\n";
+            return;
+        }
+        Recording &recording = recording_iter->second;
+        stream << "Command buffer " << cmd_buffer << ", recording " << recording.generation;
+        if (recording.block != 0) {
+            stream << ": same commands as block " << recording.block << "\n\n";
+            return;
+        }
+        recording.block = ++block_count;
+        stream << ", block " << recording.block << ":\n\n" << recording.commands << "End of block " << recording.block << "\n\n";
+        // Only ever referred to from now on.
+        Commands().swap(recording.commands);
+    }
+
+   private:
+    template <typename T>
+    using Allocator = LayerAllocator<T, api_dump_cmd_buffer_capture_memory>;
+    using Commands = std::basic_string<char, std::char_traits<char>, Allocator<char>>;
+
+    struct Recording {
+        Commands commands;
+        uint64_t generation = 0;
+        // The block the commands were written in, 0 until the command buffer is submitted.
+        uint64_t block = 0;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<VkCommandBuffer, Recording, std::hash<VkCommandBuffer>, std::equal_to<VkCommandBuffer>,
+                       Allocator<std::pair<const VkCommandBuffer, Recording>>>
+        recordings;
+    uint64_t block_count = 0;
+};
+
+// The kinds of vkCmd* calls the command buffer summary counts, which the generator assigns to each command by its name.
+enum class ApiDumpCommandKind : uint32_t {
+    Draw,
+    DrawIndexed,
+    DrawIndirect,
+    Dispatch,
+    TraceRays,
+    Barrier,
+    Bind,
+    PushConstants,
+    RenderPass,
+    Copy,
+    Clear,
+    Query,
+    Other,
+    Count
+};
+
+// The number of each kind of vkCmd* call recorded into every command buffer, along with the vertices and instances of
+// its direct draws, for the command_buffer_summary setting. The counts are written as one record when the recording
+// ends, so the output shows what each command buffer does without every command in it.
+inline LayerMemoryAccount api_dump_cmd_buffer_summary_memory("command buffer summaries");
+
+class ApiDumpCmdBufferSummary {
+   public:
+    void begin(VkCommandBuffer cmd_buffer) {
+        std::lock_guard<std::mutex> lg(mutex);
+        Counts &counts = summaries[cmd_buffer];
+        counts = Counts();
+    }
+
+    void count(VkCommandBuffer cmd_buffer, ApiDumpCommandKind kind, uint64_t vertices = 0, uint64_t instances = 0) {
+        std::lock_guard<std::mutex> lg(mutex);
+        Counts &counts = summaries[cmd_buffer];
+        counts.commands[static_cast<uint32_t>(kind)]++;
+        counts.vertices += vertices;
+        counts.instances += instances;
+    }
+
+    template <typename Iterator>
+    void erase(Iterator first, Iterator last) {
+        std::lock_guard<std::mutex> lg(mutex);
+        for (; first != last; ++first) summaries.erase(*first);
+    }
+
+    // One line per command buffer, leaving out the kinds of command it has none of.
+    void write(std::ostream &stream, VkCommandBuffer cmd_buffer) {
+        static constexpr const char *kind_names[] = {
+            "draws", "indexed draws", "indirect draws", "dispatches", "trace rays", "barriers", "binds",
+            "push constants", "render passes", "copies", "clears", "queries", "other"};
+        static_assert(std::size(kind_names) == static_cast<size_t>(ApiDumpCommandKind::Count));
+
+        std::lock_guard<std::mutex> lg(mutex);
+        const auto counts_iter = summaries.find(cmd_buffer);
+        if (counts_iter == summaries.end()) {
+            stream << "Command buffer " << cmd_buffer << " summary: not recorded since the layer was loaded\n\n";
+            return;
+        }
+        const Counts &counts = counts_iter->second;
+        uint64_t total = 0;
+        for (const uint64_t count : counts.commands) total += count;
+        stream << "Command buffer " << cmd_buffer << " summary: " << total << " commands";
+        for (size_t i = 0; i < std::size(kind_names); ++i) {
+            if (counts.commands[i] != 0) stream << ", " << counts.commands[i] << " " << kind_names[i];
+        }
+        if (counts.vertices != 0 || counts.instances != 0) {
+            stream << ", " << counts.vertices << " vertices, " << counts.instances << " instances";
+        }
+        stream << "\n\n";
+    }
+
+   private:
+    template <typename T>
+    using Allocator = LayerAllocator<T, api_dump_cmd_buffer_summary_memory>;
+
+    struct Counts {
+        std::array<uint64_t, static_cast<size_t>(ApiDumpCommandKind::Count)> commands{};
+        // Of the draws which give them directly; indirect draws read theirs from a buffer.
+        uint64_t vertices = 0;
+        uint64_t instances = 0;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<VkCommandBuffer, Counts, std::hash<VkCommandBuffer>, std::equal_to<VkCommandBuffer>,
+                       Allocator<std::pair<const VkCommandBuffer, Counts>>>
+        summaries;
+};
+
+// 64 bit FNV-1a over the words of a SPIR-V module, followed by the MurmurHash3 finalizer so that modules which only
+// differ in their last words still get hashes far apart.
+inline uint64_t HashShaderCode(const uint32_t *code, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL ^ size;
+    for (size_t i = 0; i < size / sizeof(uint32_t); ++i) {
+        hash ^= code[i];
+        hash *= 0x100000001b3ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// The binds and dynamic state of every command buffer, for the redundant_state setting, which counts the calls that set
+// what is already set. Only the state of the calls it checks is tracked, and anything else which may change it, such as
+// binding another pipeline or executing secondary command buffers, forgets it rather than risk counting a call wrongly.
+inline LayerMemoryAccount api_dump_redundant_state_memory("redundant state tracking");
+
+class ApiDumpRedundantState {
+   public:
+    enum Kind : uint32_t { Pipeline, DescriptorSets, VertexBuffers, IndexBuffer, Viewport, Scissor, KindCount };
+
+    // How many of the objects with the most redundant calls the report lists.
+    static constexpr size_t reported_count = 20;
+
+    void setNameLookup(ApiDumpNameLookup lookup) { name_lookup = std::move(lookup); }
+
+    void reset(VkCommandBuffer cmd_buffer) {
+        std::lock_guard<std::mutex> lg(mutex);
+        states.erase(cmd_buffer);
+    }
+
+    template <typename Iterator>
+    void erase(Iterator first, Iterator last) {
+        std::lock_guard<std::mutex> lg(mutex);
+        for (; first != last; ++first) states.erase(*first);
+    }
+
+    void bindPipeline(uint64_t frame, VkCommandBuffer cmd_buffer, VkPipelineBindPoint bind_point, VkPipeline pipeline) {
+        std::lock_guard<std::mutex> lg(mutex);
+        State &state = states[cmd_buffer];
+        auto bound = std::find_if(state.pipelines.begin(), state.pipelines.end(),
+                                  [&](const BoundPipeline &entry) { return entry.bind_point == bind_point; });
+        const bool redundant = bound != state.pipelines.end() && bound->pipeline == pipeline;
+        count(frame, Pipeline, redundant, (uint64_t)pipeline);
+        if (redundant) return;
+        if (bound == state.pipelines.end()) bound = state.pipelines.insert(state.pipelines.end(), BoundPipeline());
+        *bound = {bind_point, pipeline};
+        // The static state of the pipeline may replace the viewports and scissors set before it.
+        state.viewports.clear();
+        state.scissors.clear();
+    }
+
+    void bindDescriptorSets(uint64_t frame, VkCommandBuffer cmd_buffer, VkPipelineBindPoint bind_point,
+                            VkPipelineLayout layout, uint32_t first_set, uint32_t set_count, const VkDescriptorSet *sets,
+                            uint32_t dynamic_offset_count, const uint32_t *dynamic_offsets) {
+        if (set_count == 0 || sets == nullptr) return;
+        // The dynamic offsets are spread over the sets, so each set compares all of them.
+        uint64_t offsets_hash = 0;
+        if (dynamic_offset_count != 0 && dynamic_offsets != nullptr) {
+            offsets_hash = HashShaderCode(dynamic_offsets, dynamic_offset_count * sizeof(uint32_t)) ^ first_set ^
+                           (uint64_t(set_count) << 32);
+        }
+        std::lock_guard<std::mutex> lg(mutex);
+        State &state = states[cmd_buffer];
+        bool redundant = true;
+        for (uint32_t i = 0; i < set_count; ++i) {
+            const BoundSet set = {bind_point, first_set + i, layout, sets[i], offsets_hash};
+            auto bound = std::find_if(state.descriptor_sets.begin(), state.descriptor_sets.end(), [&](const BoundSet &entry) {
+                return entry.bind_point == bind_point && entry.index == set.index;
+            });
+            if (bound == state.descriptor_sets.end()) {
+                state.descriptor_sets.push_back(set);
+                redundant = false;
+            } else if (!(*bound == set)) {
+                *bound = set;
+                redundant = false;
+            }
+        }
+        count(frame, DescriptorSets, redundant, (uint64_t)sets[0]);
+    }
+
+    // Push descriptors and the other ways of binding descriptors replace what is bound without being tracked.
+    void forgetDescriptorSets(VkCommandBuffer cmd_buffer) {
+        std::lock_guard<std::mutex> lg(mutex);
+        const auto state = states.find(cmd_buffer);
+        if (state != states.end()) state->second.descriptor_sets.clear();
+    }
+
+    void bindVertexBuffers(uint64_t frame, VkCommandBuffer cmd_buffer, uint32_t first_binding, uint32_t binding_count,
+                           const VkBuffer *buffers, const VkDeviceSize *offsets, const VkDeviceSize *sizes = nullptr,
+                           const VkDeviceSize *strides = nullptr) {
+        if (binding_count == 0 || buffers == nullptr || offsets == nullptr) return;
+        std::lock_guard<std::mutex> lg(mutex);
+        State &state = states[cmd_buffer];
+        if (state.vertex_buffers.size() < first_binding + binding_count) state.vertex_buffers.resize(first_binding + binding_count);
+        bool redundant = true;
+        for (uint32_t i = 0; i < binding_count; ++i) {
+            const BoundBuffer buffer = {true, buffers[i], offsets[i], sizes != nullptr ? sizes[i] : VK_WHOLE_SIZE,
+                                        strides != nullptr ? strides[i] : 0};
+            BoundBuffer &bound = state.vertex_buffers[first_binding + i];
+            if (!(bound == buffer)) {
+                bound = buffer;
+                redundant = false;
+            }
+        }
+        count(frame, VertexBuffers, redundant, (uint64_t)buffers[0]);
+    }
+
+    void bindIndexBuffer(uint64_t frame, VkCommandBuffer cmd_buffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+                         VkIndexType index_type) {
+        std::lock_guard<std::mutex> lg(mutex);
+        State &state = states[cmd_buffer];
+        const BoundBuffer index_buffer = {true, buffer, offset, size, static_cast<VkDeviceSize>(index_type)};
+        const bool redundant = state.index_buffer == index_buffer;
+        count(frame, IndexBuffer, redundant, (uint64_t)buffer);
+        state.index_buffer = index_buffer;
+    }
+
+    // With a count, the viewports after the last one set become undefined.
+    void setViewports(uint64_t frame, VkCommandBuffer cmd_buffer, uint32_t first, uint32_t viewport_count,
+                      const VkViewport *viewports, bool with_count = false) {
+        if (viewport_count == 0 || viewports == nullptr) return;
+        std::lock_guard<std::mutex> lg(mutex);
+        State &state = states[cmd_buffer];
+        const bool redundant = setValues(state.viewports, first, viewport_count, viewports, with_count);
+        count(frame, Viewport, redundant, (uint64_t)cmd_buffer);
+    }
+
+    void setScissors(uint64_t frame, VkCommandBuffer cmd_buffer, uint32_t first, uint32_t scissor_count,
+                     const VkRect2D *scissors, bool with_count = false) {
+        if (scissor_count == 0 || scissors == nullptr) return;
+        std::lock_guard<std::mutex> lg(mutex);
+        State &state = states[cmd_buffer];
+        const bool redundant = setValues(state.scissors, first, scissor_count, scissors, with_count);
+        count(frame, Scissor, redundant, (uint64_t)cmd_buffer);
+    }
+
+    void writeReport(std::ostream &out) {
+        static constexpr const char *kind_names[] = {"vkCmdBindPipeline",   "vkCmdBindDescriptorSets", "vkCmdBindVertexBuffers",
+                                                     "vkCmdBindIndexBuffer", "vkCmdSetViewport",        "vkCmdSetScissor"};
+        static_assert(std::size(kind_names) == KindCount);
+
+        std::lock_guard<std::mutex> lg(mutex);
+        uint64_t total_calls = 0;
+        uint64_t total_redundant = 0;
+        for (uint32_t kind = 0; kind < KindCount; ++kind) {
+            total_calls += calls[kind];
+            total_redundant += redundant_calls[kind];
+        }
+        out << "Redundant state changes: " << total_redundant << " of " << total_calls << " calls\n";
+        out << std::left << std::setw(32) << "Call" << std::right << std::setw(12) << "Calls" << std::setw(12) << "Redundant"
+            << "\n";
+        for (uint32_t kind = 0; kind < KindCount; ++kind) {
+            out << std::left << std::setw(32) << kind_names[kind] << std::right << std::setw(12) << calls[kind]
+                << std::setw(12) << redundant_calls[kind] << "\n";
+        }
+        out << "\n";
+
+        if (!frames.empty()) {
+            out << std::left << std::setw(12) << "Frame" << std::right;
+            for (uint32_t kind = 0; kind < KindCount; ++kind) out << std::setw(26) << kind_names[kind];
+            out << "\n";
+            for (const auto &frame : frames) {
+                out << std::left << std::setw(12) << frame.first << std::right;
+                for (const uint64_t redundant : frame.second) out << std::setw(26) << redundant;
+                out << "\n";
+            }
+            out << "\n";
+        }
+
+        // Pipelines, descriptor sets and buffers are named after the object they bind again, and the dynamic state after
+        // the command buffer it is set in.
+        std::vector<std::pair<Offender, uint64_t>> worst(offenders.begin(), offenders.end());
+        const size_t listed = std::min(worst.size(), reported_count);
+        std::partial_sort(worst.begin(), worst.begin() + listed, worst.end(),
+                          [](const auto &a, const auto &b) { return a.second > b.second; });
+        if (listed != 0) {
+            out << std::left << std::setw(48) << "Object" << std::setw(32) << "Call" << std::right << std::setw(12)
+                << "Redundant" << "\n";
+            for (size_t i = 0; i < listed; ++i) {
+                out << std::left << std::setw(48) << ApiDumpStatsObjectName(name_lookup, worst[i].first.object)
+                    << std::setw(32) << kind_names[worst[i].first.kind] << std::right << std::setw(12) << worst[i].second
+                    << "\n";
+            }
+            out << "\n";
+        }
+    }
+
+   private:
+    template <typename T>
+    using Allocator = LayerAllocator<T, api_dump_redundant_state_memory>;
+    template <typename T>
+    using Vector = std::vector<T, Allocator<T>>;
+
+    struct BoundPipeline {
+        VkPipelineBindPoint bind_point;
+        VkPipeline pipeline;
+    };
+
+    struct BoundSet {
+        VkPipelineBindPoint bind_point;
+        uint32_t index;
+        VkPipelineLayout layout;
+        VkDescriptorSet set;
+        uint64_t offsets_hash;
+
+        bool operator==(const BoundSet &other) const {
+            return bind_point == other.bind_point && index == other.index && layout == other.layout && set == other.set &&
+                   offsets_hash == other.offsets_hash;
+        }
+    };
+
+    // A vertex buffer binding or the index buffer, whose index type is kept as its stride.
+    struct BoundBuffer {
+        bool bound = false;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        VkDeviceSize stride = 0;
+
+        bool operator==(const BoundBuffer &other) const {
+            return bound && other.bound && buffer == other.buffer && offset == other.offset && size == other.size &&
+                   stride == other.stride;
+        }
+    };
+
+    struct State {
+        Vector<BoundPipeline> pipelines;
+        Vector<BoundSet> descriptor_sets;
+        Vector<BoundBuffer> vertex_buffers;
+        BoundBuffer index_buffer;
+        // Which values are set, followed by the values themselves.
+        Vector<std::pair<bool, VkViewport>> viewports;
+        Vector<std::pair<bool, VkRect2D>> scissors;
+    };
+
+    struct Offender {
+        uint32_t kind;
+        uint64_t object;
+
+        bool operator==(const Offender &other) const { return kind == other.kind && object == other.object; }
+    };
 
-    bool use_conditional_output = false;
-    ConditionalFrameOutput condFrameOutput;
+    struct OffenderHash {
+        size_t operator()(const Offender &offender) const { return std::hash<uint64_t>()(offender.object) ^ offender.kind; }
+    };
 
-    int tab_size;  // equal to the indent size if using spaces, otherwise is equal to 1
+    // Whether the values were all set already. The values are compared byte for byte, as they are plain structures.
+    template <typename T>
+    static bool setValues(Vector<std::pair<bool, T>> &set, uint32_t first, uint32_t count, const T *values,
+                          bool with_count) {
+        bool redundant = !with_count || set.size() == count;
+        if (set.size() < first + count) set.resize(first + count, std::make_pair(false, T()));
+        for (uint32_t i = 0; i < count; ++i) {
+            std::pair<bool, T> &value = set[first + i];
+            if (value.first && memcmp(&value.second, &values[i], sizeof(T)) == 0) continue;
+            value = std::make_pair(true, values[i]);
+            redundant = false;
+        }
+        if (with_count) set.resize(count);
+        return redundant;
+    }
+
+    void count(uint64_t frame, Kind kind, bool redundant, uint64_t object) {
+        calls[kind]++;
+        if (!redundant) return;
+        redundant_calls[kind]++;
+        frames[frame][kind]++;
+        offenders[{kind, object}]++;
+    }
+
+    std::mutex mutex;
+    std::unordered_map<VkCommandBuffer, State, std::hash<VkCommandBuffer>, std::equal_to<VkCommandBuffer>,
+                       Allocator<std::pair<const VkCommandBuffer, State>>>
+        states;
+    std::array<uint64_t, KindCount> calls{};
+    std::array<uint64_t, KindCount> redundant_calls{};
+    // Only the frames with redundant calls are kept.
+    std::map<uint64_t, std::array<uint64_t, KindCount>, std::less<uint64_t>,
+             Allocator<std::pair<const uint64_t, std::array<uint64_t, KindCount>>>>
+        frames;
+    std::unordered_map<Offender, uint64_t, OffenderHash, std::equal_to<Offender>, Allocator<std::pair<const Offender, uint64_t>>>
+        offenders;
+    ApiDumpNameLookup name_lookup;
 };
 
+// Generated into api_dump.cpp, with one function per intercepted function
+struct ApiDumpFormatFunctions;
+
 class ApiDumpInstance {
    public:
-    ApiDumpInstance() noexcept : frame_count(0) { program_start = std::chrono::system_clock::now(); }
+    ApiDumpInstance() noexcept
+        : async_writer(dump_settings),
+          frame_count(0),
+          should_dump_output(dump_settings.isFrameInRange(0)),
+          overhead_budget(dump_settings.maxOverheadPercent()) {
+        program_start_ns = ApiDumpClock::NowNs();
+        if (dump_settings.asyncOutput()) async_writer.start();
+        flight_recorder.setCapacity(dump_settings.flightRecorderSize());
+        if (flight_recorder.enabled()) installFlightRecorderHandlers();
+        armedFlag().store(!dump_settings.startDisarmed(), std::memory_order_relaxed);
+        if (dump_settings.pipelineStats() || dump_settings.submitLatency()) {
+            call_stats.setNameLookup([this](uint64_t object) { return object_name_map.name(object); });
+        }
+        if (dump_settings.redundantState()) {
+            redundant_state.setNameLookup([this](uint64_t object) { return object_name_map.name(object); });
+        }
+#ifndef _WIN32
+        if (dump_settings.startDisarmed()) installArmRequestHandler();
+#endif
+    }
     // Can't copy or move this type
     ApiDumpInstance(const ApiDumpInstance &) = delete;
     ApiDumpInstance &operator=(const ApiDumpInstance &) = delete;
@@ -796,30 +4907,451 @@ class ApiDumpInstance {
     ApiDumpInstance &operator=(ApiDumpInstance &&) = delete;
 
     ~ApiDumpInstance() {
-        if (!first_func_call_on_frame) settings().closeFrameOutput();
+        if (settings().asyncOutput()) async_writer.stop();
+        if (settings().collapseRepeats()) writePendingRepeats();
+        if (settings().format() == ApiDumpFormat::Stats) {
+            if (!settings().statsPerFrame()) {
+                call_stats.writeReport(settings().outputStream(), settings().statsJson(), 0, frameCount());
+            } else if (settings().isFrameInRange(frameCount())) {
+                call_stats.writeReport(settings().outputStream(), settings().statsJson(), frameCount(), frameCount());
+            }
+            call_stats.finish(settings().outputStream(), settings().statsJson());
+        } else if (settings().overheadStats()) {
+            writeOverhead();
+        }
+        if (settings().redundantState()) writeRedundantState();
+        // Every frame in range is opened when it starts, even if none of its calls end up being dumped.
+        if (settings().isFrameInRange(frameCount())) {
+            settings().closeFrameOutput();
+            settings().indexFrame(frameCount());
+        }
     }
 
-    uint64_t frameCount() {
-        std::lock_guard<std::recursive_mutex> lg(frame_mutex);
-        uint64_t count = frame_count;
-        return count;
-    }
+    uint64_t frameCount() { return frame_count.load(std::memory_order_relaxed); }
 
     void nextFrame() {
-        std::lock_guard<std::recursive_mutex> lg(frame_mutex);
-        ++frame_count;
+        if (flight_recorder_requested.load(std::memory_order_relaxed)) {
+            flight_recorder_requested.store(false, std::memory_order_relaxed);
+            writeFlightRecorder(false);
+        }
+        if (overhead_budget.enabled()) updateOverheadBudget();
+
+        // A frame which is disarmed and followed by another one costs nothing more than counting it.
+        const bool was_armed = armed();
+        if (arm_request.load(std::memory_order_relaxed) >= 0) applyArmRequest();
+        if (!was_armed && !armed()) {
+            frame_count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        ApiDumpClock::Recalibrate();
+
+        // Moving between two frames outside of the output range writes nothing, so there is nothing to serialize.
+        const uint64_t next_frame = frameCount() + 1;
+        if (!settings().isFrameInRange(next_frame - 1) && !settings().isFrameInRange(next_frame)) {
+            const uint64_t frame = frame_count.fetch_add(1, std::memory_order_relaxed) + 1;
+            should_dump_output.store(dumpsFrame(frame), std::memory_order_relaxed);
+            return;
+        }
 
-        should_dump_output = settings().isFrameInRange(frame_count);
-        settings().setupInterFrameOutputFormatting(frame_count);
+        std::lock_guard<std::recursive_mutex> output_lg(output_mutex);
+        const uint64_t frame = frame_count.fetch_add(1, std::memory_order_relaxed) + 1;
+        should_dump_output.store(dumpsFrame(frame), std::memory_order_relaxed);
+        if (settings().format() == ApiDumpFormat::Trace) {
+            if (settings().isFrameInRange(frame)) writeTraceFrameMarker(frame);
+            return;
+        }
+        if (settings().format() == ApiDumpFormat::Stats) {
+            if (settings().statsPerFrame() && settings().isFrameInRange(frame - 1)) {
+                call_stats.writeReport(settings().outputStream(), settings().statsJson(), frame - 1, frame - 1);
+            }
+            return;
+        }
+        if (settings().asyncOutput()) {
+            async_writer.pushFrame(frame);
+            return;
+        }
+        settings().setupInterFrameOutputFormatting(frame);
         first_func_call_on_frame = true;
     }
 
-    bool shouldDumpOutput() {
-        if (!conditional_initialized) {
-            should_dump_output = settings().isFrameInRange(frame_count);
-            conditional_initialized = true;
+    // Called after each call which may end a frame, which only moves to the next frame if it is the configured delimiter.
+    // The submits are counted across every queue and thread.
+    void delimitFrame(ApiDumpFrameDelimiter delimiter) {
+        if (dump_settings.frameDelimiter() != delimiter) return;
+        const uint32_t submits = dump_settings.frameDelimiterSubmits();
+        if (delimiter == ApiDumpFrameDelimiter::Submit && submits > 1 &&
+            (frame_submit_count.fetch_add(1, std::memory_order_relaxed) + 1) % submits != 0) {
+            return;
+        }
+        nextFrame();
+    }
+
+    // Called before vkQueueBeginDebugUtilsLabelEXT and vkQueueInsertDebugUtilsLabelEXT are dumped, so that the queue label
+    // named by the frame_delimiter_label setting is the first call of the frame it begins.
+    void delimitFrame(const VkDebugUtilsLabelEXT *label_info) {
+        if (dump_settings.frameDelimiter() != ApiDumpFrameDelimiter::Label) return;
+        if (label_info != nullptr && dump_settings.isFrameDelimiterLabel(label_info->pLabelName)) nextFrame();
+    }
+
+    bool shouldDumpOutput() const { return should_dump_output.load(std::memory_order_relaxed); }
+
+    // Whether the current frame is armed. The intercepted functions check this before anything else, and go straight to
+    // the next layer while the layer is disarmed, so that api_dump can be left enabled at next to no cost.
+    static bool armed() { return armedFlag().load(std::memory_order_relaxed); }
+
+    // Arms or disarms dumping from the next frame on.
+    void requestArmed(bool armed) { arm_request.store(armed ? 1 : 0, std::memory_order_relaxed); }
+
+    // Whether a call to the function with the given index is dumped at all. This is checked before anything else is done
+    // for the call, so that calls outside the output range or the function filter cost a single relaxed load.
+    // With label scopes, only the calls made on a command buffer or a queue inside of a dumped debug label are dumped.
+    bool shouldDumpFunction(uint32_t index) const { return !dump_settings.hasLabelScopes() && shouldDumpCall(index); }
+
+    // Whether a vkCmd* call is dumped. With command buffer capture, the commands are dumped when the command buffer is
+    // submitted, so the frame they are recorded in doesn't matter.
+    bool shouldDumpCommand(uint32_t index, VkCommandBuffer cmd_buffer) {
+        if (dump_settings.hasLabelScopes() && !label_scopes.inScope(cmd_buffer)) return false;
+        if (dump_settings.commandBufferCapture()) return dump_settings.shouldDumpFunction(index);
+        if (dump_settings.commandBufferSummary()) return false;
+        return shouldDumpCall(index);
+    }
+
+    // Counts a vkCmd* call for the command buffer summary, in place of dumping it.
+    void countCommand(VkCommandBuffer cmd_buffer, ApiDumpCommandKind kind, uint64_t vertices = 0, uint64_t instances = 0) {
+        if (dump_settings.hasLabelScopes() && !label_scopes.inScope(cmd_buffer)) return;
+        cmd_buffer_summary.count(cmd_buffer, kind, vertices, instances);
+    }
+
+    // Whether a vkQueue* call is dumped.
+    bool shouldDumpQueueCall(uint32_t index, VkQueue queue) {
+        if (dump_settings.hasLabelScopes() && !label_scopes.inScope(queue)) return false;
+        return shouldDumpCall(index);
+    }
+
+    bool shouldDumpCall(uint32_t index) const {
+        return shouldDumpOutput() && dump_settings.shouldDumpFunction(index) && isCallSampled(index);
+    }
+
+    // Called before vkCmdBeginDebugUtilsLabelEXT and vkQueueBeginDebugUtilsLabelEXT are dumped, so that the call opening
+    // a dumped label is part of it.
+    void beginLabelScope(const void *object, const VkDebugUtilsLabelEXT *label_info) {
+        if (!dump_settings.hasLabelScopes()) return;
+        label_scopes.begin(object, label_info != nullptr && dump_settings.isLabelScope(label_info->pLabelName));
+    }
+
+    void endLabelScope(const void *object) {
+        if (dump_settings.hasLabelScopes()) label_scopes.end(object);
+    }
+
+    // Whether the function filter excludes the function for good, in which case vkGetDeviceProcAddr returns the next
+    // layer's function instead of the wrapper. The wrappers are kept while the flight recorder needs to see
+    // VK_ERROR_DEVICE_LOST returned by any function.
+    bool isFunctionFilteredOut(uint32_t index) const {
+        return !flight_recorder.enabled() && !dump_settings.shouldDumpFunction(index);
+    }
+
+    // Every thread counts the calls it makes to each function, so sampling takes neither a lock nor a shared counter. The
+    // first call of each function on a thread is always dumped.
+    bool isCallSampled(uint32_t index) const {
+        const uint32_t interval = dump_settings.sampleCalls();
+        if (interval <= 1) return true;
+        static thread_local std::vector<uint32_t> call_counts;
+        if (index >= call_counts.size()) call_counts.resize(index + 1, 0);
+        uint32_t &count = call_counts[index];
+        const bool sampled = count == 0;
+        count = count + 1 == interval ? 0 : count + 1;
+        return sampled;
+    }
+
+    // Called by vkCreateInstance with the table of every intercepted function. Only the first call has an effect.
+    void registerFunctions(const ApiDumpFunctionName *functions, size_t count) {
+        dump_settings.resolveFunctionFilter(functions, count);
+        call_stats.setFunctions(functions, count);
+    }
+
+    // The times of the calling thread which the wrappers add their time in the layer to, or null without overhead_stats or
+    // max_overhead_percent.
+    ApiDumpOverhead::ThreadTimes *overheadTimes() {
+        return settings().measuresOverhead() ? &call_stats.overhead().threadTimes(threadID()) : nullptr;
+    }
+
+    // Called by vkCreateInstance with every handle type, which the object statistics are counted by.
+    void registerObjectTypes(const ApiDumpObjectTypeName *types, size_t count) {
+        if (settings().objectStats()) call_stats.setObjectTypes(types, count);
+    }
+
+    // Called by the create and destroy functions with the objects they return or take, for the object statistics. The
+    // owner is the dispatch key of the instance or device the objects belong to.
+    template <typename T>
+    void countCreatedObjects(const void *owner, uint32_t type, const T *objects, uint64_t count) {
+        if (settings().objectStats() && objects != nullptr) call_stats.addObjects(owner, type, countObjects(objects, count));
+    }
+
+    template <typename T>
+    void countDestroyedObjects(const void *owner, uint32_t type, const T *objects, uint64_t count) {
+        if (settings().objectStats() && objects != nullptr) call_stats.removeObjects(owner, type, countObjects(objects, count));
+    }
+
+    // The objects of the instance or device which are still alive when it is destroyed are counted as leaked.
+    void countDestroyedOwner(const void *owner) {
+        if (settings().objectStats()) call_stats.removeOwner(owner);
+    }
+
+    // Called by vkCreateDevice with the memory properties of its physical device, which tell the heap of every memory type.
+    void addMemoryDevice(VkDevice device, const VkPhysicalDeviceMemoryProperties &properties) {
+        if (settings().memoryStats()) call_stats.memory().addDevice(get_dispatch_key(device), properties);
+    }
+
+    void removeMemoryDevice(VkDevice device) {
+        if (settings().memoryStats()) call_stats.memory().removeDevice(get_dispatch_key(device));
+    }
+
+    void countAllocatedMemory(VkDevice device, const VkMemoryAllocateInfo *allocate_info, VkDeviceMemory memory) {
+        if (!settings().memoryStats() || allocate_info == nullptr) return;
+        call_stats.memory().allocate(get_dispatch_key(device), (uint64_t)memory, allocate_info->memoryTypeIndex,
+                                     allocate_info->allocationSize);
+    }
+
+    void countFreedMemory(VkDeviceMemory memory) {
+        if (settings().memoryStats() && memory != VK_NULL_HANDLE) call_stats.memory().free((uint64_t)memory);
+    }
+
+    // Called by vkCreateInstance, the version of Vulkan the application uses decides whether the pipeline creation feedback
+    // of Vulkan 1.3 can be used.
+    void setApplicationApiVersion(const VkInstanceCreateInfo *create_info) {
+        if (create_info != nullptr && create_info->pApplicationInfo != nullptr && create_info->pApplicationInfo->apiVersion != 0) {
+            application_api_version.store(create_info->pApplicationInfo->apiVersion, std::memory_order_relaxed);
+        }
+    }
+
+    // Called by vkCreateDevice with the version of Vulkan of its physical device.
+    void addPipelineDevice(VkDevice device, const VkDeviceCreateInfo *create_info, uint32_t device_api_version) {
+        if (!settings().pipelineStats()) return;
+        bool feedback = std::min(device_api_version, application_api_version.load(std::memory_order_relaxed)) >= VK_API_VERSION_1_3;
+        for (uint32_t i = 0; i < create_info->enabledExtensionCount && !feedback; ++i) {
+            feedback = strcmp(create_info->ppEnabledExtensionNames[i], VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME) == 0;
+        }
+        if (feedback) call_stats.pipelines().addFeedbackDevice(get_dispatch_key(device));
+    }
+
+    void removePipelineDevice(VkDevice device) {
+        if (settings().pipelineStats()) call_stats.pipelines().removeDevice(get_dispatch_key(device));
+    }
+
+    // Bracket the call down the chain of the pipeline creation functions, the create infos of the returned object are the
+    // ones to pass down.
+    template <typename CreateInfo>
+    ApiDumpPipelineCreation<CreateInfo> beginPipelineCreation(VkDevice device, const char *kind, VkPipelineCache cache,
+                                                              uint32_t count, const CreateInfo *create_infos) {
+        const bool enabled = settings().pipelineStats();
+        const bool chain_feedback = enabled && call_stats.pipelines().hasFeedback(get_dispatch_key(device));
+        return ApiDumpPipelineCreation<CreateInfo>(enabled, chain_feedback, kind, cache, count, create_infos);
+    }
+
+    template <typename CreateInfo>
+    void endPipelineCreation(const ApiDumpPipelineCreation<CreateInfo> &creation, const VkPipeline *pipelines) {
+        if (!settings().pipelineStats()) return;
+        std::vector<ApiDumpPipelineStats::Pipeline> created = creation.end(pipelines);
+        if (!created.empty()) call_stats.pipelines().add(created);
+    }
+
+    // Called by the queue submission functions after the call down the chain, for submit_latency.
+    void recordSubmits(VkQueue queue, uint32_t count, const VkSubmitInfo *submits, VkFence fence) {
+        if (!settings().submitLatency()) return;
+        const uint64_t time_ns = steadyTimeNs();
+        for (uint32_t i = 0; i < count; ++i) {
+            const VkTimelineSemaphoreSubmitInfo *timeline_info = nullptr;
+            for (auto *header = reinterpret_cast<const VkBaseInStructure *>(submits[i].pNext); header != nullptr;
+                 header = header->pNext) {
+                if (header->sType == VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO) {
+                    timeline_info = reinterpret_cast<const VkTimelineSemaphoreSubmitInfo *>(header);
+                }
+            }
+            std::vector<ApiDumpSubmitLatency::Signal> signals;
+            for (uint32_t s = 0; timeline_info != nullptr && s < submits[i].signalSemaphoreCount; ++s) {
+                const uint64_t semaphore = (uint64_t)submits[i].pSignalSemaphores[s];
+                if (s < timeline_info->signalSemaphoreValueCount && call_stats.submits().isTimelineSemaphore(semaphore)) {
+                    signals.push_back({semaphore, timeline_info->pSignalSemaphoreValues[s]});
+                }
+            }
+            // The fence signals once every batch of the submission completes, so it goes with the last one.
+            call_stats.submits().submit(get_dispatch_key(queue), (uint64_t)queue, i + 1 == count ? (uint64_t)fence : 0,
+                                        std::move(signals), time_ns);
+        }
+        if (count == 0 && fence != VK_NULL_HANDLE) {
+            call_stats.submits().submit(get_dispatch_key(queue), (uint64_t)queue, (uint64_t)fence, {}, time_ns);
+        }
+    }
+
+    void recordSubmits(VkQueue queue, uint32_t count, const VkSubmitInfo2 *submits, VkFence fence) {
+        if (!settings().submitLatency()) return;
+        const uint64_t time_ns = steadyTimeNs();
+        for (uint32_t i = 0; i < count; ++i) {
+            std::vector<ApiDumpSubmitLatency::Signal> signals;
+            for (uint32_t s = 0; s < submits[i].signalSemaphoreInfoCount; ++s) {
+                const VkSemaphoreSubmitInfo &signal = submits[i].pSignalSemaphoreInfos[s];
+                if (call_stats.submits().isTimelineSemaphore((uint64_t)signal.semaphore)) {
+                    signals.push_back({(uint64_t)signal.semaphore, signal.value});
+                }
+            }
+            call_stats.submits().submit(get_dispatch_key(queue), (uint64_t)queue, i + 1 == count ? (uint64_t)fence : 0,
+                                        std::move(signals), time_ns);
+        }
+        if (count == 0 && fence != VK_NULL_HANDLE) {
+            call_stats.submits().submit(get_dispatch_key(queue), (uint64_t)queue, (uint64_t)fence, {}, time_ns);
+        }
+    }
+
+    // Called when vkWaitForFences or vkGetFenceStatus return VK_SUCCESS. When waiting for any of several fences, it is not
+    // known which are signaled. The state tracking is replayed by api_dump_convert, so the fences can't be asked for.
+    void recordFencesSignaled(uint32_t count, const VkFence *fences, bool all_signaled) {
+        if (!settings().submitLatency() || !all_signaled) return;
+        const uint64_t time_ns = steadyTimeNs();
+        for (uint32_t i = 0; i < count; ++i) call_stats.submits().completeFence((uint64_t)fences[i], time_ns);
+    }
+
+    void forgetFences(uint32_t count, const VkFence *fences) {
+        if (!settings().submitLatency()) return;
+        for (uint32_t i = 0; i < count; ++i) call_stats.submits().forgetFence((uint64_t)fences[i]);
+    }
+
+    // Called when vkWaitSemaphores returns VK_SUCCESS. When waiting for any of several semaphores, it is not known which
+    // reached its value.
+    void recordSemaphoresSignaled(const VkSemaphoreWaitInfo *wait_info) {
+        if (!settings().submitLatency()) return;
+        if ((wait_info->flags & VK_SEMAPHORE_WAIT_ANY_BIT) != 0 && wait_info->semaphoreCount > 1) return;
+        const uint64_t time_ns = steadyTimeNs();
+        for (uint32_t i = 0; i < wait_info->semaphoreCount; ++i) {
+            call_stats.submits().completeSemaphore((uint64_t)wait_info->pSemaphores[i], wait_info->pValues[i], time_ns);
+        }
+    }
+
+    // Called when vkGetSemaphoreCounterValue returns VK_SUCCESS.
+    void recordSemaphoreValue(VkSemaphore semaphore, uint64_t value) {
+        if (settings().submitLatency()) call_stats.submits().completeSemaphore((uint64_t)semaphore, value, steadyTimeNs());
+    }
+
+    void recordQueueIdle(VkQueue queue) {
+        if (settings().submitLatency()) call_stats.submits().completeQueue((uint64_t)queue, steadyTimeNs());
+    }
+
+    void recordDeviceIdle(VkDevice device) {
+        if (settings().submitLatency()) call_stats.submits().completeDevice(get_dispatch_key(device), steadyTimeNs());
+    }
+
+    void addSemaphore(const VkSemaphoreCreateInfo *create_info, VkSemaphore semaphore) {
+        if (!settings().submitLatency() || create_info == nullptr) return;
+        for (auto *header = reinterpret_cast<const VkBaseInStructure *>(create_info->pNext); header != nullptr;
+             header = header->pNext) {
+            if (header->sType == VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO &&
+                reinterpret_cast<const VkSemaphoreTypeCreateInfo *>(header)->semaphoreType == VK_SEMAPHORE_TYPE_TIMELINE) {
+                call_stats.submits().addTimelineSemaphore((uint64_t)semaphore);
+            }
+        }
+    }
+
+    void removeSemaphore(VkSemaphore semaphore) {
+        if (settings().submitLatency() && semaphore != VK_NULL_HANDLE) call_stats.submits().removeSemaphore((uint64_t)semaphore);
+    }
+
+    void removeSubmitDevice(VkDevice device) {
+        if (settings().submitLatency()) call_stats.submits().removeDevice(get_dispatch_key(device));
+    }
+
+    template <typename T>
+    static uint64_t countObjects(const T *objects, uint64_t count) {
+        uint64_t non_null = 0;
+        for (uint64_t i = 0; i < count; ++i) non_null += objects[i] != VK_NULL_HANDLE;
+        return non_null;
+    }
+
+    // Called by vkCreateInstance with the functions which dump the intercepted functions in the output format.
+    void setFormatFunctions(const ApiDumpFormatFunctions *functions) {
+        format_functions.store(functions, std::memory_order_relaxed);
+    }
+    const ApiDumpFormatFunctions *formatFunctions() const { return format_functions.load(std::memory_order_relaxed); }
+
+    // Called by vkCreateInstance when formatting is deferred, before any call is dumped. The calls are then captured into
+    // binary records by the threads which make them, and only formatted by the writer thread.
+    void setCallFormatter(ApiDumpAsyncWriter::CallFormatter formatter) { async_writer.setCallFormatter(formatter); }
+    bool defersFormatting() const { return async_writer.formatsCalls(); }
+
+    // The format the calls are dumped in by the threads which make them.
+    ApiDumpFormat captureFormat() const { return defersFormatting() ? ApiDumpFormat::Binary : dump_settings.format(); }
+
+    // Bracket the call down the chain of a dumped function, for the formats which measure how long the call takes. The
+    // times are in ticks of ApiDumpClock.
+    uint64_t callStartTime() const {
+        if (!measuresCalls()) return 0;
+        return ApiDumpClock::Now();
+    }
+
+    void recordCallTime(uint32_t index, uint64_t start_time) {
+        if (!measuresCalls()) return;
+        const uint64_t end_time = ApiDumpClock::Now();
+        if (dump_settings.format() == ApiDumpFormat::Stats) {
+            call_stats.record(index, ApiDumpClock::DurationNs(end_time - start_time));
+        } else {
+            formattingState().call_start_time = start_time;
+            formattingState().call_end_time = end_time;
+        }
+    }
+
+    // Writes the shader code to the shader directory, unless a shader with the same hash was already written, and returns
+    // the reference to it which is dumped in place of the code.
+    std::string storeShader(const uint32_t *code, size_t size) {
+        const uint64_t hash = HashShaderCode(code, size);
+        char file_name[32];
+        snprintf(file_name, sizeof(file_name), "%016" PRIx64 ".spv", hash);
+        {
+            std::lock_guard<std::mutex> lg(stored_shaders_mutex);
+            if (stored_shaders.count(hash) == 0) {
+                std::ofstream file(settings().shaderDirectory() + "/" + file_name, std::ofstream::out | std::ofstream::binary);
+                file.write(reinterpret_cast<const char *>(code), size);
+                if (file.good()) stored_shaders.insert(hash);
+            }
+        }
+        return std::string(file_name) + " (" + std::to_string(size) + " bytes)";
+    }
+
+    // Writes the calls held by the flight recorder to the output file. This happens when a call returns
+    // VK_ERROR_DEVICE_LOST, on a fatal signal or unhandled exception, and at the next frame after SIGUSR1 was received.
+    // From a fatal signal, locks which are held are skipped over instead of waited for.
+    void writeFlightRecorder(bool from_signal) {
+        if (!flight_recorder.enabled()) return;
+        std::unique_lock<std::recursive_mutex> lock(output_mutex, std::defer_lock);
+        if (!from_signal) {
+            lock.lock();
+        } else if (!lock.try_lock()) {
+            return;
         }
-        return should_dump_output;
+        flight_recorder.write(settings().outputStream(), from_signal);
+    }
+
+    // The flight recorder is subscribed to the spikes of the monitor layer with the first instance, and unsubscribed from
+    // them with the last one, with which the monitor layer may be unloaded. A spike is written at the next frame, like
+    // SIGUSR1.
+    void instanceCreated() {
+        if (instance_count++ > 0 || !flight_recorder.enabled() || !settings().flightRecorderSpikes()) return;
+        auto subscribe = reinterpret_cast<monitor_subscribe_spikes_function>(find_monitor_spike_function(MONITOR_SUBSCRIBE_SPIKES));
+        subscribed_to_spikes = subscribe != nullptr && subscribe(onSpike, this);
+        if (!subscribed_to_spikes) std::cerr << "api_dump: The monitor layer is not loaded, its spikes are not recorded\n";
+    }
+
+    void instanceDestroyed() {
+        if (--instance_count > 0 || !subscribed_to_spikes) return;
+        auto unsubscribe =
+            reinterpret_cast<monitor_unsubscribe_spikes_function>(find_monitor_spike_function(MONITOR_UNSUBSCRIBE_SPIKES));
+        if (unsubscribe != nullptr) unsubscribe(onSpike, this);
+        subscribed_to_spikes = false;
+    }
+
+    // The times of the last call recorded by this thread, in ticks of ApiDumpClock.
+    uint64_t callStartTicks() const { return formattingState().call_start_time; }
+    uint64_t callEndTicks() const { return formattingState().call_end_time; }
+
+    static uint64_t steadyTimeNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
     }
 
     bool firstFunctionCallOnFrame() {
@@ -827,165 +5359,620 @@ class ApiDumpInstance {
             first_func_call_on_frame = false;
             return true;
         }
-        return false;
+        return false;
+    }
+
+    std::recursive_mutex *outputMutex() { return &output_mutex; }
+
+    // Bracket the dumping of a single API call. Without thread buffering the output mutex is held from the function head
+    // until the body is written, which includes the call down the chain. With thread buffering the call is formatted into
+    // a per-thread buffer without holding any lock, and only appending that buffer to the output stream is serialized.
+    // Device level calls pass the dispatch key of their device, which is read before the call can destroy it.
+    void beginOutput(const void *device_key = nullptr) {
+        formattingState().device_key = device_key;
+        formattingState().captured_cmd_buffer = VK_NULL_HANDLE;
+        if (!settings().threadBuffering()) output_mutex.lock();
+    }
+
+    // Brackets the dumping of a vkCmd* call, which goes to the recording of the command buffer with command buffer capture.
+    void beginCommandOutput(const void *device_key, VkCommandBuffer cmd_buffer) {
+        beginOutput(device_key);
+        if (settings().commandBufferCapture()) formattingState().captured_cmd_buffer = cmd_buffer;
+    }
+
+    void endOutput() {
+        if (settings().htmlPages()) settings().countHtmlPageCall(callFrame());
+        if (!settings().threadBuffering()) {
+            output_mutex.unlock();
+            return;
+        }
+        if (!settings().hasThreadOutput()) return;
+        if (settings().jsonLines() && !defersFormatting()) settings().finishThreadOutputLine();
+        if (formattingState().captured_cmd_buffer != VK_NULL_HANDLE) {
+            cmd_buffer_capture.append(formattingState().captured_cmd_buffer, settings().threadOutputData(),
+                                      settings().threadOutputSize());
+            settings().clearThreadOutput();
+            return;
+        }
+        if (formattingState().query_output) memoizeQueryOutput();
+        if (settings().collapseRepeats() && collapseRepeatedCall()) return;
+
+        if (flight_recorder.enabled()) {
+            flight_recorder.record(settings().threadOutputData(), settings().threadOutputSize());
+            settings().clearThreadOutput();
+            return;
+        }
+
+        // Instance level calls have no device file, so they go to the output file when the output is only split by device.
+        if (settings().splitsOutput() && (formattingState().device_key != nullptr || !settings().splitsOutputByDevice())) {
+            settings().commitSplitThreadOutput(formattingState().device_key, threadID());
+            return;
+        }
+
+        if (settings().asyncOutput()) {
+            std::string data;
+            settings().takeThreadOutput(data);
+            async_writer.pushCall(std::move(data));
+            return;
+        }
+
+        std::lock_guard<std::recursive_mutex> lg(output_mutex);
+        if (settings().format() == ApiDumpFormat::Binary) {
+            const uint32_t record_size = settings().threadOutputSize();
+            settings().commitThreadOutput(reinterpret_cast<const char *>(&record_size), sizeof(record_size));
+            return;
+        }
+        // The head of a JSON call can't know whether it is the first of its frame until it is actually written out.
+        const bool needs_separator =
+            settings().format() == ApiDumpFormat::Json && !settings().jsonLines() && !firstFunctionCallOnFrame();
+        settings().commitThreadOutput(",\n", needs_separator ? 2 : 0);
+    }
+
+    ApiDumpSettings &settings() { return dump_settings; }
+
+    // Called by the function head once the thread, frame and time of the call are written, so that only what follows is
+    // compared when collapsing repeated calls.
+    void markCallBody() { formattingState().call_body_offset = settings().threadBuffering() ? settings().threadOutputSize() : 0; }
+
+    // Drops the staged output of a call which doesn't match the filter, instead of ending it.
+    void cancelOutput() { settings().clearThreadOutput(); }
+
+    ApiDumpFilteredCall filteredCall() const { return ApiDumpFilteredCall(dump_settings.callFilter(), object_name_map); }
+
+    // Called before endOutput() by the queries whose result is only written in full the first time, with memoize_queries.
+    void markQueryOutput() {
+        if (settings().memoizeQueries()) formattingState().query_output = true;
+    }
+
+    uint64_t threadID() {
+        if (formattingState().replaying) return formattingState().recorded_thread_id;
+        // A thread is registered the first time it asks for its ID, after which the ID is read from thread local storage.
+        static thread_local const uint64_t thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+        return thread_id;
+    }
+
+    // The position of the call being dumped in the order of all calls, across threads.
+    uint64_t nextSequence() { return next_sequence.fetch_add(1, std::memory_order_relaxed); }
+
+    void setCmdBuffer(VkCommandBuffer cmd_buffer) { formattingState().cmd_buffer = cmd_buffer; }
+
+    VkCommandBufferLevel getCmdBufferLevel() {
+        VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        const bool tracked = cmd_buffer_tracker.level(formattingState().cmd_buffer, level);
+        // A binary capture may start after the command buffer was allocated, in which case the converter never saw it.
+        // With deferred formatting, the command buffer may also have been freed in the meantime.
+        assert(tracked || formattingState().replaying);
+        (void)tracked;
+        return level;
+    }
+
+    void eraseCmdBuffers(VkDevice device, VkCommandPool cmd_pool, const VkCommandBuffer *cmd_buffers, uint32_t count) {
+        cmd_buffer_tracker.erase(device, cmd_pool, cmd_buffers, count, formattingState().replaying);
+        if (settings().commandBufferCapture() && cmd_buffers != nullptr) cmd_buffer_capture.erase(cmd_buffers, cmd_buffers + count);
+        if (settings().commandBufferSummary() && cmd_buffers != nullptr) cmd_buffer_summary.erase(cmd_buffers, cmd_buffers + count);
+        if (settings().redundantState() && cmd_buffers != nullptr) redundant_state.erase(cmd_buffers, cmd_buffers + count);
+        if (settings().hasLabelScopes() && cmd_buffers != nullptr) {
+            for (uint32_t i = 0; i < count; ++i) label_scopes.erase(cmd_buffers[i]);
+        }
+    }
+
+    void addCmdBuffers(VkDevice device, VkCommandPool cmd_pool, const VkCommandBuffer *cmd_buffers, uint32_t count,
+                       VkCommandBufferLevel level) {
+        cmd_buffer_tracker.add(device, cmd_pool, cmd_buffers, count, level, formattingState().replaying);
+    }
+
+    void eraseCmdBufferPool(VkDevice device, VkCommandPool cmd_pool) {
+        const ApiDumpCmdBufferSet cmd_buffers = cmd_buffer_tracker.erasePool(device, cmd_pool);
+        if (settings().commandBufferCapture()) cmd_buffer_capture.erase(cmd_buffers.begin(), cmd_buffers.end());
+        if (settings().commandBufferSummary()) cmd_buffer_summary.erase(cmd_buffers.begin(), cmd_buffers.end());
+        if (settings().redundantState()) redundant_state.erase(cmd_buffers.begin(), cmd_buffers.end());
+        if (settings().hasLabelScopes()) {
+            for (const VkCommandBuffer cmd_buffer : cmd_buffers) label_scopes.erase(cmd_buffer);
+        }
+    }
+
+    // Recording a command buffer again resets it, along with the debug labels it was left in.
+    void beginCmdBufferRecording(VkCommandBuffer cmd_buffer) {
+        if (settings().commandBufferCapture()) cmd_buffer_capture.begin(cmd_buffer);
+        if (settings().commandBufferSummary()) cmd_buffer_summary.begin(cmd_buffer);
+        if (settings().redundantState()) redundant_state.reset(cmd_buffer);
+        if (settings().hasLabelScopes()) label_scopes.erase(cmd_buffer);
+    }
+
+    // Called by the submit functions once they are formatted, to write the commands of the command buffers they submit.
+    void dumpSubmittedCmdBuffers(uint32_t submit_count, const VkSubmitInfo *submits) {
+        if (!settings().commandBufferCapture() || submits == nullptr) return;
+        for (uint32_t i = 0; i < submit_count; ++i) {
+            for (uint32_t j = 0; j < submits[i].commandBufferCount; ++j) {
+                cmd_buffer_capture.writeSubmitted(settings().stream(), submits[i].pCommandBuffers[j]);
+            }
+        }
+    }
+
+    void dumpSubmittedCmdBuffers(uint32_t submit_count, const VkSubmitInfo2 *submits) {
+        if (!settings().commandBufferCapture() || submits == nullptr) return;
+        for (uint32_t i = 0; i < submit_count; ++i) {
+            for (uint32_t j = 0; j < submits[i].commandBufferInfoCount; ++j) {
+                cmd_buffer_capture.writeSubmitted(settings().stream(), submits[i].pCommandBufferInfos[j].commandBuffer);
+            }
+        }
+    }
+
+    // The calls redundant_state checks, which are tracked whether they are dumped or not.
+    void trackBindPipeline(VkCommandBuffer cmd_buffer, VkPipelineBindPoint bind_point, VkPipeline pipeline) {
+        if (settings().redundantState()) redundant_state.bindPipeline(frameCount(), cmd_buffer, bind_point, pipeline);
+    }
+
+    void trackBindDescriptorSets(VkCommandBuffer cmd_buffer, VkPipelineBindPoint bind_point, VkPipelineLayout layout,
+                                 uint32_t first_set, uint32_t set_count, const VkDescriptorSet *sets,
+                                 uint32_t dynamic_offset_count, const uint32_t *dynamic_offsets) {
+        if (!settings().redundantState()) return;
+        redundant_state.bindDescriptorSets(frameCount(), cmd_buffer, bind_point, layout, first_set, set_count, sets,
+                                           dynamic_offset_count, dynamic_offsets);
+    }
+
+    void forgetDescriptorSets(VkCommandBuffer cmd_buffer) {
+        if (settings().redundantState()) redundant_state.forgetDescriptorSets(cmd_buffer);
+    }
+
+    void trackBindVertexBuffers(VkCommandBuffer cmd_buffer, uint32_t first_binding, uint32_t binding_count,
+                                const VkBuffer *buffers, const VkDeviceSize *offsets, const VkDeviceSize *sizes = nullptr,
+                                const VkDeviceSize *strides = nullptr) {
+        if (!settings().redundantState()) return;
+        redundant_state.bindVertexBuffers(frameCount(), cmd_buffer, first_binding, binding_count, buffers, offsets, sizes,
+                                          strides);
+    }
+
+    void trackBindIndexBuffer(VkCommandBuffer cmd_buffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+                              VkIndexType index_type) {
+        if (!settings().redundantState()) return;
+        redundant_state.bindIndexBuffer(frameCount(), cmd_buffer, buffer, offset, size, index_type);
+    }
+
+    void trackSetViewports(VkCommandBuffer cmd_buffer, uint32_t first, uint32_t count, const VkViewport *viewports,
+                           bool with_count = false) {
+        if (!settings().redundantState()) return;
+        redundant_state.setViewports(frameCount(), cmd_buffer, first, count, viewports, with_count);
+    }
+
+    void trackSetScissors(VkCommandBuffer cmd_buffer, uint32_t first, uint32_t count, const VkRect2D *scissors,
+                          bool with_count = false) {
+        if (!settings().redundantState()) return;
+        redundant_state.setScissors(frameCount(), cmd_buffer, first, count, scissors, with_count);
+    }
+
+    // Executing secondary command buffers leaves the state of the primary one undefined.
+    void forgetCmdBufferState(VkCommandBuffer cmd_buffer) {
+        if (settings().redundantState()) redundant_state.reset(cmd_buffer);
+    }
+
+    // Called by vkEndCommandBuffer once it is formatted, to write what the recording it ends holds.
+    void dumpCmdBufferSummary(VkCommandBuffer cmd_buffer) {
+        if (settings().commandBufferSummary()) cmd_buffer_summary.write(settings().stream(), cmd_buffer);
+    }
+
+    void setIsDynamicScissor(bool is_dynamic_scissor) { formattingState().is_dynamic_scissor = is_dynamic_scissor; }
+    void setIsDynamicViewport(bool is_dynamic_viewport) { formattingState().is_dynamic_viewport = is_dynamic_viewport; }
+    bool getIsDynamicScissor() const { return formattingState().is_dynamic_scissor; }
+    bool getIsDynamicViewport() const { return formattingState().is_dynamic_viewport; }
+    void setMemoryHeapCount(uint32_t memory_heap_count) { formattingState().memory_heap_count = memory_heap_count; }
+    uint32_t getMemoryHeapCount() { return formattingState().memory_heap_count; }
+    void setDescriptorType(VkDescriptorType type) { formattingState().descriptor_type = type; }
+    VkDescriptorType getDescriptorType() { return formattingState().descriptor_type; }
+
+    std::chrono::microseconds current_time_since_start() {
+        if (formattingState().replaying) return formattingState().recorded_time;
+        const uint64_t now_ns = ApiDumpClock::NowNs();
+        return std::chrono::microseconds(now_ns > program_start_ns ? (now_ns - program_start_ns) / 1000 : 0);
+    }
+
+    // The frame the call being dumped was made in.
+    uint64_t callFrame() { return formattingState().replaying ? formattingState().recorded_frame : frameCount(); }
+
+    // Used by the binary capture converter and the deferred formatting of the writer thread, which format calls after they
+    // were made, to report the thread, frame and time that were recorded with them instead of their own. Only applies to
+    // the calling thread.
+    void setRecordedCallInfo(uint64_t thread_id, uint64_t frame, std::chrono::microseconds time) {
+        FormattingState &state = formattingState();
+        state.replaying = true;
+        state.recorded_thread_id = thread_id;
+        state.recorded_frame = frame;
+        state.recorded_time = time;
+    }
+
+    // Called by the monitor layer from the present of the spike, so it only sets the flag SIGUSR1 does.
+    static void onSpike(void *instance, uint64_t, float) {
+        static_cast<ApiDumpInstance *>(instance)->flight_recorder_requested.store(true, std::memory_order_relaxed);
+    }
+
+#ifdef _WIN32
+    static LONG WINAPI flightRecorderExceptionFilter(EXCEPTION_POINTERS *exception) {
+        current().writeFlightRecorder(true);
+        return previousExceptionFilter() != nullptr ? previousExceptionFilter()(exception) : EXCEPTION_CONTINUE_SEARCH;
+    }
+
+    static LPTOP_LEVEL_EXCEPTION_FILTER &previousExceptionFilter() {
+        static LPTOP_LEVEL_EXCEPTION_FILTER filter = nullptr;
+        return filter;
+    }
+
+    static void installFlightRecorderHandlers() {
+        previousExceptionFilter() = SetUnhandledExceptionFilter(flightRecorderExceptionFilter);
+    }
+#else
+    static constexpr int flight_recorder_signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+
+    static struct sigaction *previousSignalActions() {
+        static struct sigaction actions[sizeof(flight_recorder_signals) / sizeof(flight_recorder_signals[0])] = {};
+        return actions;
+    }
+
+    // Writes out the flight recorder, then restores the handler of the application and raises the signal again.
+    static void flightRecorderSignalHandler(int signal_number) {
+        current().writeFlightRecorder(true);
+        for (size_t i = 0; i < sizeof(flight_recorder_signals) / sizeof(flight_recorder_signals[0]); ++i) {
+            if (flight_recorder_signals[i] == signal_number) sigaction(signal_number, &previousSignalActions()[i], nullptr);
+        }
+        raise(signal_number);
+    }
+
+    // Only sets a flag, since the signal may interrupt a call which is in the middle of recording.
+    static void flightRecorderRequestHandler(int) { current().flight_recorder_requested.store(true, std::memory_order_relaxed); }
+
+    // SIGUSR2 arms a disarmed layer, or disarms an armed one, at the next frame.
+    static void armRequestHandler(int) { current().requestArmed(!armed()); }
+
+    static void installArmRequestHandler() {
+        struct sigaction action = {};
+        action.sa_handler = armRequestHandler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGUSR2, &action, nullptr);
+    }
+
+    static void installFlightRecorderHandlers() {
+        struct sigaction action = {};
+        action.sa_handler = flightRecorderSignalHandler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESETHAND;
+        for (size_t i = 0; i < sizeof(flight_recorder_signals) / sizeof(flight_recorder_signals[0]); ++i) {
+            sigaction(flight_recorder_signals[i], &action, &previousSignalActions()[i]);
+        }
+        action.sa_handler = flightRecorderRequestHandler;
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &action, nullptr);
     }
+#endif
 
-    std::recursive_mutex *outputMutex() { return &output_mutex; }
+    static ApiDumpInstance &current() {
+        // Because ApiDumpInstance is a static variable in a static function, there will only be one instance of it.
+        // Additionally, the object will be constructed on the *first* call to current(), rather than at process startup time.
+        static ApiDumpInstance current_instance;
+        return current_instance;
+    }
 
-    ApiDumpSettings &settings() { return dump_settings; }
+    void set_vk_instance(VkPhysicalDevice phys_dev, VkInstance instance) {
+        std::lock_guard<std::mutex> lg(vk_instance_mutex);
+        vk_instance_map.insert({phys_dev, instance});
+    }
+    VkInstance get_vk_instance(VkPhysicalDevice phys_dev) {
+        std::lock_guard<std::mutex> lg(vk_instance_mutex);
+        const auto it = vk_instance_map.find(phys_dev);
+        if (it == vk_instance_map.end()) return VK_NULL_HANDLE;
+        return it->second;
+    }
 
-    uint64_t threadID() {
-        std::thread::id this_id = std::this_thread::get_id();
-        std::lock_guard<std::recursive_mutex> lg(thread_mutex);
+    void update_object_name_map(const VkDebugMarkerObjectNameInfoEXT *pNameInfo) {
+        object_name_map.setName(pNameInfo->object, pNameInfo->pObjectName);
+    }
+    void update_object_name_map(const VkDebugUtilsObjectNameInfoEXT *pNameInfo) {
+        object_name_map.setName(pNameInfo->objectHandle, pNameInfo->pObjectName);
+    }
 
-        auto it = thread_map.find(this_id);
-        if (it != thread_map.end()) {
-            return it->second;
-        }
+    // Returns the debug name of an object, or null if it has not been named. The name stays valid until the instance is
+    // destroyed.
+    const char *get_object_name(uint64_t object) const { return object_name_map.name(object); }
 
-        thread_map.insert({this_id, thread_map.size()});
-        return thread_map.size() - 1;
+   private:
+    // Constant initialized, so that checking it takes no guard, and set up when the instance is constructed.
+    static std::atomic<bool> &armedFlag() {
+        static std::atomic<bool> flag{true};
+        return flag;
     }
 
-    void setCmdBuffer(VkCommandBuffer cmd_buffer) { this->cmd_buffer = cmd_buffer; }
-
-    VkCommandBufferLevel getCmdBufferLevel() {
-        std::lock_guard<std::recursive_mutex> lg(cmd_buffer_state_mutex);
-        const auto level_iter = cmd_buffer_level.find(cmd_buffer);
-        assert(level_iter != cmd_buffer_level.end());
-        const auto level = level_iter->second;
-        return level;
+    // Arming and disarming take effect at a frame boundary, so that no frame is only partly dumped.
+    void applyArmRequest() {
+        std::lock_guard<std::recursive_mutex> output_lg(output_mutex);
+        const int request = arm_request.exchange(-1, std::memory_order_relaxed);
+        if (request < 0 || (request == 1) == armed()) return;
+        dump_settings.toggleArmed(frameCount() + 1);
+        armedFlag().store(request == 1, std::memory_order_relaxed);
     }
 
-    void eraseCmdBuffers(VkDevice device, VkCommandPool cmd_pool, std::vector<VkCommandBuffer> cmd_buffers) {
-        cmd_buffers.erase(std::remove(cmd_buffers.begin(), cmd_buffers.end(), nullptr), cmd_buffers.end());
-        if (!cmd_buffers.empty()) {
-            std::lock_guard<std::recursive_mutex> lg(cmd_buffer_state_mutex);
+    // Whether the calls of a frame are dumped, unless max_overhead_percent has stepped the output down to no calls at all.
+    bool dumpsFrame(uint64_t frame) const {
+        return dump_settings.isFrameInRange(frame) && overhead_budget.level() != ApiDumpOutputLevel::StatsOnly;
+    }
 
-            const auto pool_cmd_buffers_iter = cmd_buffer_pools.find(std::make_pair(device, cmd_pool));
-            assert(pool_cmd_buffers_iter != cmd_buffer_pools.end());
+    // Applies and logs the changes of level of max_overhead_percent, which take effect from the next frame on.
+    void updateOverheadBudget() {
+        ApiDumpOverheadBudget::Change change;
+        if (!overhead_budget.endFrame(call_stats.overhead(), change)) return;
+        dump_settings.dropParams(change.level != ApiDumpOutputLevel::Full);
+        static const char *const level_descriptions[] = {"every call in full", "only the names of the calls", "no calls"};
+        std::stringstream message;
+        message << std::fixed << std::setprecision(1) << "api_dump: The layer took " << change.percent
+                << "% of the time of the last " << ApiDumpOverheadBudget::WINDOW_FRAMES << " frames, with max_overhead_percent at "
+                << settings().maxOverheadPercent() << ", so " << level_descriptions[static_cast<int>(change.level)]
+                << " will be dumped from frame " << frameCount() + 1 << " on.\n";
+#ifdef ANDROID
+        __android_log_print(ANDROID_LOG_INFO, "api_dump", "%s", message.str().c_str());
+#else
+        std::cerr << message.str();
+#endif
+    }
 
-            for (const auto cmd_buffer : cmd_buffers) {
-                pool_cmd_buffers_iter->second.erase(cmd_buffer);
+    bool measuresCalls() const {
+        return dump_settings.format() == ApiDumpFormat::Stats || dump_settings.format() == ApiDumpFormat::Trace;
+    }
 
-                assert(cmd_buffer_level.count(cmd_buffer) > 0);
-                cmd_buffer_level.erase(cmd_buffer);
-            }
+    // The formats other than Stats write the overhead of the whole run at exit, next to the output rather than into it.
+    void writeOverhead() {
+        const std::string file_name = settings().overheadFileName();
+        if (file_name.empty()) {
+            call_stats.overhead().writeTable(std::cerr, frameCount() + 1);
+            return;
         }
+        std::ofstream file(file_name, std::ofstream::out | std::ofstream::trunc);
+        call_stats.overhead().writeTable(file, frameCount() + 1);
     }
 
-    void addCmdBuffers(VkDevice device, VkCommandPool cmd_pool, std::vector<VkCommandBuffer> cmd_buffers,
-                       VkCommandBufferLevel level) {
-        std::lock_guard<std::recursive_mutex> lg(cmd_buffer_state_mutex);
-        auto &pool_cmd_buffers = cmd_buffer_pools[std::make_pair(device, cmd_pool)];
-        pool_cmd_buffers.insert(cmd_buffers.begin(), cmd_buffers.end());
-
-        for (const auto cmd_buffer : cmd_buffers) {
-            assert(cmd_buffer_level.count(cmd_buffer) == 0);
-            cmd_buffer_level[cmd_buffer] = level;
+    void writeRedundantState() {
+        const std::string file_name = settings().redundantStateFileName();
+        if (file_name.empty()) {
+            redundant_state.writeReport(std::cerr);
+            return;
         }
+        std::ofstream file(file_name, std::ofstream::out | std::ofstream::trunc);
+        redundant_state.writeReport(file);
     }
 
-    void eraseCmdBufferPool(VkDevice device, VkCommandPool cmd_pool) {
-        if (cmd_pool != VK_NULL_HANDLE) {
-            std::lock_guard<std::recursive_mutex> lg(cmd_buffer_state_mutex);
-
-            const auto cmd_buffers_iter = cmd_buffer_pools.find(std::make_pair(device, cmd_pool));
-            if (cmd_buffers_iter != cmd_buffer_pools.end()) {
-                for (const auto cmd_buffer : cmd_buffers_iter->second) {
-                    assert(cmd_buffer_level.count(cmd_buffer) > 0);
-                    cmd_buffer_level.erase(cmd_buffer);
-                }
-                cmd_buffers_iter->second.clear();
-            }
+    // A global instant event, so that frames show up as lines across every thread of the trace.
+    void writeTraceFrameMarker(uint64_t frame) {
+        std::stringstream marker;
+        const uint64_t time_us = ApiDumpClock::NowNs() / 1000;
+        marker << ",\n{\"name\" : \"Frame " << frame << "\", \"cat\" : \"vulkan\", \"ph\" : \"i\", \"s\" : \"g\", \"pid\" : "
+               << ApiDumpSettings::processID() << ", \"tid\" : " << threadID() << ", \"ts\" : " << time_us << "}";
+        if (settings().memoryStats()) call_stats.memory().writeTraceCounters(marker, ApiDumpSettings::processID(), time_us);
+        if (settings().asyncOutput()) {
+            async_writer.pushCall(marker.str());
+            return;
         }
+        settings().outputStream() << marker.str();
+        if (settings().shouldFlush()) settings().outputStream().flush();
     }
 
-    void setIsDynamicScissor(bool is_dynamic_scissor) { this->is_dynamic_scissor = is_dynamic_scissor; }
-    void setIsDynamicViewport(bool is_dynamic_viewport) { this->is_dynamic_viewport = is_dynamic_viewport; }
-    bool getIsDynamicScissor() const { return is_dynamic_scissor; }
-    bool getIsDynamicViewport() const { return is_dynamic_viewport; }
-    void setMemoryHeapCount(uint32_t memory_heap_count) { this->memory_heap_count = memory_heap_count; }
-    uint32_t getMemoryHeapCount() { return memory_heap_count; }
-    void setDescriptorType(VkDescriptorType type) { this->descriptor_type = type; }
-    VkDescriptorType getDescriptorType() { return this->descriptor_type; }
+    ApiDumpSettings dump_settings;
+    // Declared after dump_settings so that it is stopped before the settings close off the output.
+    ApiDumpAsyncWriter async_writer;
+    std::recursive_mutex output_mutex;
+    std::atomic<uint64_t> frame_count;
+    std::atomic<uint64_t> frame_submit_count{0};
+
+    std::atomic<uint64_t> next_thread_id{0};
+    std::atomic<uint64_t> next_sequence{0};
+
+    ApiDumpCmdBufferTracker cmd_buffer_tracker;
+    ApiDumpCmdBufferCapture cmd_buffer_capture;
+    ApiDumpCmdBufferSummary cmd_buffer_summary;
+    ApiDumpRedundantState redundant_state;
+    ApiDumpLabelScopes label_scopes;
+
+    std::atomic<bool> should_dump_output;
+    ApiDumpStats call_stats;
+    ApiDumpOverheadBudget overhead_budget;
+    std::atomic<uint32_t> application_api_version{VK_API_VERSION_1_0};
+    std::atomic<const ApiDumpFormatFunctions *> format_functions{nullptr};
+
+    std::mutex stored_shaders_mutex;
+    std::unordered_set<uint64_t> stored_shaders;
+
+    // The last call dumped by a thread and the number of identical calls which followed it, for collapse_repeats.
+    struct RepeatedCall {
+        uint64_t thread_id = 0;
+        uint64_t frame = 0;
+        std::string body;
+        uint64_t repeats = 0;
+    };
 
-    std::chrono::microseconds current_time_since_start() {
-        std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-        return std::chrono::duration_cast<std::chrono::microseconds>(now - program_start);
+    RepeatedCall &repeatedCall() {
+        static thread_local RepeatedCall *repeated_call = nullptr;
+        if (repeated_call == nullptr) {
+            std::lock_guard<std::mutex> lg(repeated_calls_mutex);
+            repeated_calls.push_back(std::make_unique<RepeatedCall>());
+            repeated_call = repeated_calls.back().get();
+        }
+        return *repeated_call;
     }
 
-    static ApiDumpInstance &current() {
-        // Because ApiDumpInstance is a static variable in a static function, there will only be one instance of it.
-        // Additionally, the object will be constructed on the *first* call to current(), rather than at process startup time.
-        static ApiDumpInstance current_instance;
-        return current_instance;
+    static std::string repeatNote(const RepeatedCall &call) {
+        return "Thread " + std::to_string(call.thread_id) + ": previous call repeated " + std::to_string(call.repeats) +
+               " more times\n\n";
     }
 
-    std::unordered_map<uint64_t, std::string> object_name_map;
+    // Drops the staged call when it is the same as the previous call of the thread in the same frame, other than the time
+    // it was made at. The next call which differs is preceded by the number of calls which were dropped. The text is
+    // compared rather than a hash of it, so that no call can be lost to a collision.
+    bool collapseRepeatedCall() {
+        RepeatedCall &previous = repeatedCall();
+        const size_t size = settings().threadOutputSize();
+        const size_t body_offset = std::min(formattingState().call_body_offset, size);
+        const char *body = settings().threadOutputData() + body_offset;
+        const size_t body_size = size - body_offset;
+        const uint64_t frame = callFrame();
+        if (!previous.body.empty() && previous.frame == frame && previous.body.size() == body_size &&
+            memcmp(previous.body.data(), body, body_size) == 0) {
+            ++previous.repeats;
+            settings().clearThreadOutput();
+            return true;
+        }
 
-    void set_vk_instance(VkPhysicalDevice phys_dev, VkInstance instance) { vk_instance_map.insert({phys_dev, instance}); }
-    VkInstance get_vk_instance(VkPhysicalDevice phys_dev) const {
-        if (vk_instance_map.count(phys_dev) == 0) return VK_NULL_HANDLE;
-        return vk_instance_map.at(phys_dev);
+        const std::string note = previous.repeats > 0 ? repeatNote(previous) : std::string();
+        previous.thread_id = threadID();
+        previous.frame = frame;
+        previous.body.assign(body, body_size);
+        previous.repeats = 0;
+        if (!note.empty()) settings().prependThreadOutput(note.data(), note.size());
+        return false;
     }
 
-    void update_object_name_map(const VkDebugMarkerObjectNameInfoEXT *pNameInfo) {
-        if (pNameInfo->pObjectName)
-            object_name_map[pNameInfo->object] = pNameInfo->pObjectName;
-        else
-            object_name_map.erase(pNameInfo->object);
-    }
-    void update_object_name_map(const VkDebugUtilsObjectNameInfoEXT *pNameInfo) {
-        if (pNameInfo->pObjectName)
-            object_name_map[pNameInfo->objectHandle] = pNameInfo->pObjectName;
-        else
-            object_name_map.erase(pNameInfo->objectHandle);
+    // The repeats still pending when the layer is unloaded have no next call to be written with.
+    void writePendingRepeats() {
+        std::lock_guard<std::mutex> lg(repeated_calls_mutex);
+        std::lock_guard<std::recursive_mutex> output_lg(output_mutex);
+        for (const auto &call : repeated_calls) {
+            if (call->repeats > 0) settings().outputStream() << repeatNote(*call);
+        }
+        settings().outputStream().flush();
     }
 
-   private:
-    ApiDumpSettings dump_settings;
-    std::recursive_mutex output_mutex;
-    std::recursive_mutex frame_mutex;
-    uint64_t frame_count;
+    std::mutex repeated_calls_mutex;
+    std::vector<std::unique_ptr<RepeatedCall>> repeated_calls;
+
+    // Replaces the staged query with a reference to the first query which was dumped with the same text, or numbers it so
+    // that later queries can refer to it. The text includes the handles the query was made on and everything it returned.
+    void memoizeQueryOutput() {
+        formattingState().query_output = false;
+        std::string call;
+        settings().takeThreadOutput(call);
+        const size_t body_offset = std::min(formattingState().call_body_offset, call.size());
+        const size_t head_end = call.find(":\n", body_offset);
+        if (head_end == std::string::npos) {
+            settings().stream().write(call.data(), static_cast<std::streamsize>(call.size()));
+            return;
+        }
 
-    std::recursive_mutex thread_mutex;
-    std::unordered_map<std::thread::id, uint64_t> thread_map;
+        uint64_t number = 0;
+        bool repeated = false;
+        {
+            std::lock_guard<std::mutex> lg(query_results_mutex);
+            std::string body = call.substr(body_offset);
+            auto found = query_results.find(body);
+            if (found != query_results.end()) {
+                number = found->second;
+                repeated = true;
+            } else {
+                // The results of objects which are created over and over would pile up, so they are forgotten past a limit.
+                if (query_results.size() >= kMaxQueryResults) query_results.clear();
+                number = ++query_result_count;
+                query_results.emplace(std::move(body), number);
+            }
+        }
 
-    std::recursive_mutex cmd_buffer_state_mutex;
-    std::map<std::pair<VkDevice, VkCommandPool>, std::unordered_set<VkCommandBuffer>> cmd_buffer_pools;
-    std::unordered_map<VkCommandBuffer, VkCommandBufferLevel> cmd_buffer_level;
+        settings().stream().write(call.data(), static_cast<std::streamsize>(head_end));
+        if (repeated) {
+            settings().stream() << ": same as query #" << number << "\n\n";
+        } else {
+            settings().stream() << " (query #" << number << ")";
+            settings().stream().write(call.data() + head_end, static_cast<std::streamsize>(call.size() - head_end));
+        }
+    }
 
-    bool conditional_initialized = false;
-    bool should_dump_output = true;
+    static constexpr size_t kMaxQueryResults = 4096;
+    std::mutex query_results_mutex;
+    std::unordered_map<std::string, uint64_t> query_results;
+    uint64_t query_result_count = 0;
+
+    ApiDumpFlightRecorder flight_recorder;
+    std::atomic<bool> flight_recorder_requested{false};
+    uint32_t instance_count = 0;
+    bool subscribed_to_spikes = false;
+    // 1 to arm at the next frame, 0 to disarm, and -1 once applied.
+    std::atomic<int> arm_request{-1};
     bool first_func_call_on_frame = true;
 
-    std::chrono::system_clock::time_point program_start;
+    uint64_t program_start_ns;
 
     // Store the VkInstance handle so we don't use null in the call to
     // vkGetInstanceProcAddr(instance_handle, "vkCreateDevice");
+    std::mutex vk_instance_mutex;
     std::unordered_map<VkPhysicalDevice, VkInstance> vk_instance_map;
 
-    // Storage for getCmdBufferLevel() which is called in a place where it needs access to the cmd_buffer but it isn't present in
-    // the current structure.
-    VkCommandBuffer cmd_buffer;
+    ApiDumpObjectNameMap object_name_map;
+
+    // State which is set while formatting one part of a call and read back while formatting a later part of the same call.
+    // It is kept per thread so that calls being formatted concurrently don't see each other's state.
+    struct FormattingState {
+        // Storage for getCmdBufferLevel() which is called in a place where it needs access to the cmd_buffer but it isn't
+        // present in the current structure.
+        VkCommandBuffer cmd_buffer = VK_NULL_HANDLE;
+
+        // Storage for VkPipelineViewportStateCreateInfo which needs to ignore the scissor and viewport pipeline state if their
+        // respective dynamic state is set.
+        bool is_dynamic_scissor = false;
+        bool is_dynamic_viewport = false;
+
+        // Storage for VkPhysicalDeviceMemoryBudgetPropertiesEXT which needs the number of heaps from
+        // VkPhysicalDeviceMemoryProperties
+        uint32_t memory_heap_count = 0;
+
+        // Storage for the VkDescriptorDataEXT union to know what is the active element
+        VkDescriptorType descriptor_type = VK_DESCRIPTOR_TYPE_SAMPLER;
+
+        // Storage for the trace event of a call, which is written after the call with the time it took
+        uint64_t call_start_time = 0;
+        uint64_t call_end_time = 0;
 
-    // Storage for VkPipelineViewportStateCreateInfo which needs to ignore the scissor and viewport pipeline state if their
-    // respective dynamic state is set.
-    bool is_dynamic_scissor;
-    bool is_dynamic_viewport;
+        // The dispatch key of the device the call being dumped belongs to, which picks its file when output is split by
+        // device. Null for instance level calls.
+        const void *device_key = nullptr;
 
-    // Storage for VkPhysicalDeviceMemoryBudgetPropertiesEXT which needs the number of heaps from VkPhysicalDeviceMemoryProperties
-    uint32_t memory_heap_count;
+        // Where the staged output of the call starts to be compared with the previous call, for collapse_repeats.
+        size_t call_body_offset = 0;
 
-    // Storage for the VkDescriptorDataEXT union to know what is the active element
-    VkDescriptorType descriptor_type;
+        // The command buffer the vkCmd* call being dumped is recorded into, with command buffer capture.
+        VkCommandBuffer captured_cmd_buffer = VK_NULL_HANDLE;
+
+        // Whether the call being dumped is a query whose result is memoized, with memoize_queries.
+        bool query_output = false;
+
+        // Set by setRecordedCallInfo() on the threads which format calls that were made earlier.
+        bool replaying = false;
+        uint64_t recorded_thread_id = 0;
+        uint64_t recorded_frame = 0;
+        std::chrono::microseconds recorded_time{0};
+    };
+
+    static FormattingState &formattingState() {
+        static thread_local FormattingState state;
+        return state;
+    }
 };
 
 // Utility to output an address.
 // If the quotes arg is true, the address is encloded in quotes.
 // Used for text, html, and json output.
-void OutputAddress(const ApiDumpSettings &settings, const void *addr) {
+inline void OutputAddress(const ApiDumpSettings &settings, const void *addr) {
     if (settings.showAddress())
         if (addr == NULL)
             settings.stream() << "NULL";
@@ -995,19 +5982,149 @@ void OutputAddress(const ApiDumpSettings &settings, const void *addr) {
         settings.stream() << "address";
 }
 
-void OutputAddressJSON(const ApiDumpSettings &settings, const void *addr) {
+inline void OutputAddressJSON(const ApiDumpSettings &settings, const void *addr) {
     settings.stream() << "\"";
     OutputAddress(settings, addr);
     settings.stream() << "\"";
 }
 
+// Utility to output a string in quotes, cut to max_string_length characters followed by the number of characters left out.
+// The number is kept inside the quotes for json output.
+inline void OutputString(const ApiDumpSettings &settings, const char *object, bool json) {
+    const size_t max_length = settings.maxStringLength();
+    const size_t length = max_length > 0 ? strlen(object) : 0;
+    if (length <= max_length) {
+        settings.stream() << "\"" << object << "\"";
+        return;
+    }
+    settings.stream() << "\"";
+    settings.stream().write(object, static_cast<std::streamsize>(max_length));
+    settings.stream() << (json ? "" : "\"") << "... (" << length - max_length << " more)" << (json ? "\"" : "");
+}
+
+// Name tables emitted by the generator for every enum and bitmask, shared by the text, html and json output.
+// Enum tables are sorted by value, bitmask tables keep the order of the registry.
+struct ApiDumpEnumName {
+    int64_t value;
+    const char *name;
+    size_t length;
+};
+
+struct ApiDumpBitmaskName {
+    uint64_t value;
+    const char *name;
+    size_t length;
+    bool exact;  // Bits declared with a value instead of a bitpos only match the whole mask
+};
+
+inline const ApiDumpEnumName *FindEnumName(const ApiDumpEnumName *names, size_t count, int64_t value) {
+    const ApiDumpEnumName *end = names + count;
+    const ApiDumpEnumName *found =
+        std::lower_bound(names, end, value, [](const ApiDumpEnumName &entry, int64_t key) { return entry.value < key; });
+    return (found != end && found->value == value) ? found : nullptr;
+}
+
+// Writes the enum name, or "UNKNOWN" if the value has none, in a single append.
+inline void OutputEnumName(const ApiDumpSettings &settings, const ApiDumpEnumName *names, size_t count, int64_t value) {
+    const ApiDumpEnumName *found = FindEnumName(names, count, value);
+    if (found != nullptr)
+        settings.stream().write(found->name, found->length);
+    else
+        settings.stream().write("UNKNOWN", 7);
+}
+
+// Writes " (NAME_A | NAME_B)" for the bits set in the mask, or nothing if none of them have a name.
+inline void OutputBitmaskNames(const ApiDumpSettings &settings, const ApiDumpBitmaskName *names, size_t count, uint64_t mask) {
+    bool is_first = true;
+    for (size_t i = 0; i < count; ++i) {
+        if (names[i].exact ? mask != names[i].value : (mask & names[i].value) == 0) continue;
+        settings.stream().write(is_first ? " (" : " | ", is_first ? 2 : 3);
+        settings.stream().write(names[i].name, names[i].length);
+        is_first = false;
+    }
+    if (!is_first) settings.stream().put(')');
+}
+
+// Formats the "name[i]" labels of array elements without a heap allocation per element. The prefix is written once
+// and only the index is rewritten for each element. Names too long for the inline buffer fall back to a std::string.
+class ApiDumpIndexName {
+   public:
+    ApiDumpIndexName(const char *name) {
+        const size_t name_length = strlen(name);
+        if (name_length + sizeof("[]") + kMaxIndexDigits > sizeof(inline_buffer)) {
+            fallback.resize(name_length + sizeof("[]") + kMaxIndexDigits);
+            buffer = &fallback[0];
+        }
+        memcpy(buffer, name, name_length);
+        buffer[name_length] = '[';
+        prefix_length = name_length + 1;
+    }
+    ApiDumpIndexName(const ApiDumpIndexName &) = delete;
+    ApiDumpIndexName &operator=(const ApiDumpIndexName &) = delete;
+
+    const char *operator()(size_t index) {
+        char *end = std::to_chars(buffer + prefix_length, buffer + prefix_length + kMaxIndexDigits, index).ptr;
+        end[0] = ']';
+        end[1] = '\0';
+        return buffer;
+    }
+
+   private:
+    static constexpr size_t kMaxIndexDigits = 20;
+
+    char inline_buffer[64];
+    char *buffer = inline_buffer;
+    size_t prefix_length = 0;
+    std::string fallback;
+};
+
+// Buffers the elements of arrays of integers, like the SPIR-V of shader modules with show_shader, to write them to the
+// output in large pieces instead of one at a time, with the integers formatted by std::to_chars instead of the locale aware
+// operator<< of the output stream.
+class ApiDumpArrayBuf : public std::streambuf {
+   public:
+    explicit ApiDumpArrayBuf(std::ostream &stream) : target(*stream.rdbuf()) { setp(buffer, buffer + sizeof(buffer)); }
+    ApiDumpArrayBuf(const ApiDumpArrayBuf &) = delete;
+    ApiDumpArrayBuf &operator=(const ApiDumpArrayBuf &) = delete;
+    ~ApiDumpArrayBuf() override { sync(); }
+
+    template <typename T>
+    void putInteger(T value) {
+        if (epptr() - pptr() < kMaxIntegerChars) sync();
+        pbump(static_cast<int>(std::to_chars(pptr(), epptr(), value).ptr - pptr()));
+    }
+
+    void putString(const char *text) { sputn(text, static_cast<std::streamsize>(strlen(text))); }
+
+   protected:
+    int sync() override {
+        target.sputn(pbase(), pptr() - pbase());
+        setp(buffer, buffer + sizeof(buffer));
+        return 0;
+    }
+
+    int_type overflow(int_type ch) override {
+        sync();
+        if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+        return ch;
+    }
+
+   private:
+    static constexpr std::ptrdiff_t kMaxIntegerChars = 24;
+
+    std::streambuf &target;
+    char buffer[4096];
+};
+
 //==================================== Text Backend Helpers ======================================//
 
-void dump_text_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcNamedParams,
-                             const char *funcReturn) {
+inline void dump_text_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcNamedParams,
+                                    const char *funcReturn) {
     const ApiDumpSettings &settings(dump_inst.settings());
     if (settings.showThreadAndFrame()) {
-        settings.stream() << "Thread " << dump_inst.threadID() << ", Frame " << dump_inst.frameCount();
+        settings.stream() << "Thread " << dump_inst.threadID() << ", Frame " << dump_inst.callFrame();
     }
     if (settings.showTimestamp() && settings.showThreadAndFrame()) {
         settings.stream() << ", ";
@@ -1018,6 +6135,7 @@ void dump_text_function_head(ApiDumpInstance &dump_inst, const char *funcName, c
     if (settings.showTimestamp() || settings.showThreadAndFrame()) {
         settings.stream() << ":\n";
     }
+    dump_inst.markCallBody();
     settings.stream() << funcName << "(" << funcNamedParams << ") returns " << funcReturn;
 
     settings.shouldFlush() ? settings.stream() << std::flush : settings.stream();
@@ -1033,12 +6151,12 @@ void dump_text_array(const T *array, size_t len, const ApiDumpSettings &settings
     }
     OutputAddress(settings, array);
     settings.stream() << "\n";
-    for (size_t i = 0; i < len && array != NULL; ++i) {
-        std::stringstream stream;
-        stream << name << '[' << i << ']';
-        std::string indexName = stream.str();
-        dump_text_value(array[i], settings, child_type, indexName.c_str(), indents + 1, dump);
+    ApiDumpIndexName index_name(name);
+    const size_t shown = settings.shownArrayElements(len);
+    for (size_t i = 0; i < shown; ++i) {
+        dump_text_value(array[i], settings, child_type, index_name(i), indents + 1, dump);
     }
+    if (shown < len) settings.stream() << settings.indentation(indents + 1) << "... (" << len - shown << " more)\n";
 }
 
 template <typename T>
@@ -1051,11 +6169,39 @@ void dump_text_array(const T *array, size_t len, const ApiDumpSettings &settings
     }
     OutputAddress(settings, array);
     settings.stream() << "\n";
-    for (size_t i = 0; i < len && array != NULL; ++i) {
-        std::stringstream stream;
-        stream << name << '[' << i << ']';
-        std::string indexName = stream.str();
-        dump_text_value(array[i], settings, child_type, indexName.c_str(), indents + 1, dump);
+    ApiDumpIndexName index_name(name);
+    const size_t shown = settings.shownArrayElements(len);
+    for (size_t i = 0; i < shown; ++i) {
+        dump_text_value(array[i], settings, child_type, index_name(i), indents + 1, dump);
+    }
+    if (shown < len) settings.stream() << settings.indentation(indents + 1) << "... (" << len - shown << " more)\n";
+}
+
+// The generator picks this over dump_text_array for arrays of integer types, the output is the same.
+template <typename T>
+void dump_text_integer_array(const T *array, size_t len, const ApiDumpSettings &settings, const char *type_string,
+                             const char *child_type, const char *name, int indents,
+                             void (*)(const T, const ApiDumpSettings &, int)) {
+    settings.formatNameType(indents, name, type_string);
+    if (array == NULL) {
+        settings.stream() << "NULL\n";
+        return;
+    }
+    OutputAddress(settings, array);
+    settings.stream() << "\n";
+    ApiDumpArrayBuf out(settings.stream());
+    ApiDumpIndexName index_name(name);
+    const size_t shown = settings.shownArrayElements(len);
+    for (size_t i = 0; i < shown; ++i) {
+        settings.formatNameType(out, indents + 1, index_name(i), child_type);
+        out.putInteger(array[i]);
+        out.sputc('\n');
+    }
+    if (shown < len) {
+        settings.writeIndentation(out, indents + 1);
+        out.putString("... (");
+        out.putInteger(len - shown);
+        out.putString(" more)\n");
     }
 }
 
@@ -1096,19 +6242,20 @@ void dump_text_value(const T &object, const ApiDumpSettings &settings, const cha
     dump(object, settings, indents);
 }
 
-void dump_text_special(const char *text, const ApiDumpSettings &settings, const char *type_string, const char *name, int indents) {
+inline void dump_text_special(const char *text, const ApiDumpSettings &settings, const char *type_string, const char *name,
+                              int indents) {
     settings.formatNameType(indents, name, type_string);
     settings.stream() << text << "\n";
 }
 
-void dump_text_cstring(const char *object, const ApiDumpSettings &settings, int indents) {
+inline void dump_text_cstring(const char *object, const ApiDumpSettings &settings, int indents) {
     if (object == NULL)
         settings.stream() << "NULL";
     else
-        settings.stream() << "\"" << object << "\"";
+        OutputString(settings, object, false);
 }
 
-void dump_text_void(const void *object, const ApiDumpSettings &settings, int indents) {
+inline void dump_text_void(const void *object, const ApiDumpSettings &settings, int indents) {
     if (object == NULL) {
         settings.stream() << "NULL";
         return;
@@ -1116,7 +6263,7 @@ void dump_text_void(const void *object, const ApiDumpSettings &settings, int ind
     OutputAddress(settings, object);
 }
 
-void dump_text_int(int object, const ApiDumpSettings &settings, int indents) { settings.stream() << object; }
+inline void dump_text_int(int object, const ApiDumpSettings &settings, int indents) { settings.stream() << object; }
 
 template <typename T>
 void dump_text_pNext(const T *object, const ApiDumpSettings &settings, const char *type_string, int indents,
@@ -1131,15 +6278,15 @@ void dump_text_pNext(const T *object, const ApiDumpSettings &settings, const cha
 
 //==================================== Html Backend Helpers ======================================//
 
-void dump_html_nametype(std::ostream &stream, bool showType, const char *name, const char *type) {
+inline void dump_html_nametype(std::ostream &stream, bool showType, const char *name, const char *type) {
     stream << "<div class='var'>" << name << "</div>";
     if (showType) {
         stream << "<div class='type'>" << type << "</div>";
     }
 }
 
-void dump_html_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcNamedParams,
-                             const char *funcReturn) {
+inline void dump_html_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcNamedParams,
+                                    const char *funcReturn) {
     const ApiDumpSettings &settings(dump_inst.settings());
     if (settings.showThreadAndFrame()) {
         settings.stream() << "<div class='thd'>Thread: " << dump_inst.threadID() << "</div>";
@@ -1169,11 +6316,14 @@ void dump_html_array(const T *array, size_t len, const ApiDumpSettings &settings
     OutputAddress(settings, array);
     settings.stream() << "\n";
     settings.stream() << "</div></summary>";
-    for (size_t i = 0; i < len && array != NULL; ++i) {
-        std::stringstream stream;
-        stream << name << '[' << i << ']';
-        std::string indexName = stream.str();
-        dump_html_value(array[i], settings, child_type, indexName.c_str(), indents + 1, dump);
+    ApiDumpIndexName index_name(name);
+    const size_t shown = settings.shownArrayElements(len);
+    for (size_t i = 0; i < shown; ++i) {
+        dump_html_value(array[i], settings, child_type, index_name(i), indents + 1, dump);
+    }
+    if (shown < len) {
+        settings.stream() << "<details class='data'><summary><div class='val'>... (" << len - shown
+                          << " more)</div></summary></details>";
     }
     settings.stream() << "</details>";
 }
@@ -1193,11 +6343,55 @@ void dump_html_array(const T *array, size_t len, const ApiDumpSettings &settings
     OutputAddress(settings, array);
     settings.stream() << "\n";
     settings.stream() << "</div></summary>";
-    for (size_t i = 0; i < len && array != NULL; ++i) {
-        std::stringstream stream;
-        stream << name << '[' << i << ']';
-        std::string indexName = stream.str();
-        dump_html_value(array[i], settings, child_type, indexName.c_str(), indents + 1, dump);
+    ApiDumpIndexName index_name(name);
+    const size_t shown = settings.shownArrayElements(len);
+    for (size_t i = 0; i < shown; ++i) {
+        dump_html_value(array[i], settings, child_type, index_name(i), indents + 1, dump);
+    }
+    if (shown < len) {
+        settings.stream() << "<details class='data'><summary><div class='val'>... (" << len - shown
+                          << " more)</div></summary></details>";
+    }
+    settings.stream() << "</details>";
+}
+
+// The generator picks this over dump_html_array for arrays of integer types, the output is the same.
+template <typename T>
+void dump_html_integer_array(const T *array, size_t len, const ApiDumpSettings &settings, const char *type_string,
+                             const char *child_type, const char *name, int indents,
+                             void (*)(const T, const ApiDumpSettings &, int)) {
+    settings.stream() << "<details class='data'><summary>";
+    dump_html_nametype(settings.stream(), settings.showType(), name, type_string);
+    if (array == NULL) {
+        settings.stream() << "<div class='val'>NULL</div></summary></details>";
+        return;
+    }
+    settings.stream() << "<div class='val'>";
+    OutputAddress(settings, array);
+    settings.stream() << "\n";
+    settings.stream() << "</div></summary>";
+    {
+        ApiDumpArrayBuf out(settings.stream());
+        ApiDumpIndexName index_name(name);
+        const size_t shown = settings.shownArrayElements(len);
+        for (size_t i = 0; i < shown; ++i) {
+            out.putString("<details class='data'><summary><div class='var'>");
+            out.putString(index_name(i));
+            out.putString("</div>");
+            if (settings.showType()) {
+                out.putString("<div class='type'>");
+                out.putString(child_type);
+                out.putString("</div>");
+            }
+            out.putString("<div class='val'>");
+            out.putInteger(array[i]);
+            out.putString("</div></summary></details>");
+        }
+        if (shown < len) {
+            out.putString("<details class='data'><summary><div class='val'>... (");
+            out.putInteger(len - shown);
+            out.putString(" more)</div></summary></details>");
+        }
     }
     settings.stream() << "</details>";
 }
@@ -1244,28 +6438,29 @@ void dump_html_value(const T &object, const ApiDumpSettings &settings, const cha
     settings.stream() << "</details>";
 }
 
-void dump_html_special(const char *text, const ApiDumpSettings &settings, const char *type_string, const char *name, int indents) {
+inline void dump_html_special(const char *text, const ApiDumpSettings &settings, const char *type_string, const char *name,
+                              int indents) {
     settings.stream() << "<details class='data'><summary>";
     dump_html_nametype(settings.stream(), settings.showType(), name, type_string);
     settings.stream() << "<div class='val'>" << text << "</div></summary></details>";
 }
 
-void dump_html_cstring(const char *object, const ApiDumpSettings &settings, int indents) {
+inline void dump_html_cstring(const char *object, const ApiDumpSettings &settings, int indents) {
     settings.stream() << "<div class='val'>";
     if (object == NULL)
         settings.stream() << "NULL";
     else
-        settings.stream() << "\"" << object << "\"";
+        OutputString(settings, object, false);
     settings.stream() << "</div>";
 }
 
-void dump_html_void(const void *object, const ApiDumpSettings &settings, int indents) {
+inline void dump_html_void(const void *object, const ApiDumpSettings &settings, int indents) {
     settings.stream() << "<div class='val'>";
     OutputAddress(settings, object);
     settings.stream() << "</div>";
 }
 
-void dump_html_int(int object, const ApiDumpSettings &settings, int indents) {
+inline void dump_html_int(int object, const ApiDumpSettings &settings, int indents) {
     settings.stream() << "<div class='val'>";
     settings.stream() << object;
     settings.stream() << "</div>";
@@ -1285,17 +6480,22 @@ void dump_html_pNext(const T *object, const ApiDumpSettings &settings, const cha
 
 //==================================== Json Backend Helpers ======================================//
 
-void dump_json_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcReturn) {
+inline void dump_json_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcReturn) {
     const ApiDumpSettings &settings(dump_inst.settings());
 
-    if (!dump_inst.firstFunctionCallOnFrame()) settings.stream() << ",\n";
+    // With thread buffering the separator is written when the call is committed to the output stream instead.
+    if (!settings.threadBuffering() && !dump_inst.firstFunctionCallOnFrame()) settings.stream() << ",\n";
 
     // Display api call name
     settings.stream() << settings.indentation(2) << "{\n";
+    // An NDJSON line is not inside its frame, so it always says which frame and thread it belongs to
+    if (settings.jsonLines()) {
+        settings.stream() << settings.indentation(3) << "\"frameNumber\" : \"" << dump_inst.callFrame() << "\",\n";
+    }
     settings.stream() << settings.indentation(3) << "\"name\" : \"" << funcName << "\",\n";
 
     // Display thread info
-    if (settings.showThreadAndFrame()) {
+    if (settings.showThreadAndFrame() || settings.jsonLines()) {
         settings.stream() << settings.indentation(3) << "\"thread\" : \"Thread " << dump_inst.threadID() << "\",\n";
     }
 
@@ -1340,15 +6540,15 @@ void dump_json_array(const T *array, size_t len, const ApiDumpSettings &settings
         settings.stream() << ",\n";
         settings.stream() << settings.indentation(indents + 1) << "\"elements\" :\n";
         settings.stream() << settings.indentation(indents + 1) << "[\n";
-        for (size_t i = 0; i < len && array != NULL; ++i) {
-            std::stringstream stream;
-            stream << "[" << i << "]";
-            std::string indexName = stream.str();
-            dump_json_value(array[i], &array[i], settings, child_type, indexName.c_str(), is_struct, is_union, indents + 2, dump);
-            if (i < len - 1) settings.stream() << ',';
+        ApiDumpIndexName index_name("");
+        const size_t shown = settings.shownArrayElements(len);
+        for (size_t i = 0; i < shown; ++i) {
+            dump_json_value(array[i], &array[i], settings, child_type, index_name(i), is_struct, is_union, indents + 2, dump);
+            if (i < shown - 1) settings.stream() << ',';
             settings.stream() << "\n";
         }
         settings.stream() << settings.indentation(indents + 1) << "]";
+        if (shown < len) settings.stream() << ",\n" << settings.indentation(indents + 1) << "\"omittedElements\" : " << len - shown;
     }
     settings.stream() << "\n" << settings.indentation(indents) << "}";
 }
@@ -1376,16 +6576,62 @@ void dump_json_array(const T *array, size_t len, const ApiDumpSettings &settings
         settings.stream() << ",\n";
         settings.stream() << settings.indentation(indents + 1) << "\"elements\" :\n";
         settings.stream() << settings.indentation(indents + 1) << "[\n";
-        for (size_t i = 0; i < len && array != NULL; ++i) {
-            std::stringstream stream;
-            stream << "[" << i << "]";
-            std::string indexName = stream.str();
-            dump_json_value(array[i], &array[i], settings, child_type, indexName.c_str(), is_struct, is_union, indents + 2, dump);
-            if (i < len - 1) settings.stream() << ',';
+        ApiDumpIndexName index_name("");
+        const size_t shown = settings.shownArrayElements(len);
+        for (size_t i = 0; i < shown; ++i) {
+            dump_json_value(array[i], &array[i], settings, child_type, index_name(i), is_struct, is_union, indents + 2, dump);
+            if (i < shown - 1) settings.stream() << ',';
             settings.stream() << "\n";
         }
         settings.stream() << settings.indentation(indents + 1) << "]";
+        if (shown < len) settings.stream() << ",\n" << settings.indentation(indents + 1) << "\"omittedElements\" : " << len - shown;
+    }
+    settings.stream() << "\n" << settings.indentation(indents) << "}";
+}
+
+// The generator picks this over dump_json_array for arrays of integer types, the output is the same.
+template <typename T>
+void dump_json_integer_array(const T *array, size_t len, const ApiDumpSettings &settings, const char *type_string,
+                             const char *child_type, const char *name, bool is_struct, bool is_union, int indents,
+                             void (*dump)(const T, const ApiDumpSettings &, int)) {
+    // dump_json_value gives the elements an address if their type is a pointer.
+    if (len == 0 || array == NULL || strchr(child_type, '*') != NULL) {
+        dump_json_array(array, len, settings, type_string, child_type, name, is_struct, is_union, indents, dump);
+        return;
+    }
+    settings.stream() << settings.indentation(indents) << "{\n";
+    settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "\",\n";
+    settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\",\n";
+    settings.stream() << settings.indentation(indents + 1) << "\"address\" : ";
+    OutputAddressJSON(settings, array);
+    settings.stream() << ",\n";
+    settings.stream() << settings.indentation(indents + 1) << "\"elements\" :\n";
+    settings.stream() << settings.indentation(indents + 1) << "[\n";
+    const size_t shown = settings.shownArrayElements(len);
+    {
+        ApiDumpArrayBuf out(settings.stream());
+        ApiDumpIndexName index_name("");
+        for (size_t i = 0; i < shown; ++i) {
+            settings.writeIndentation(out, indents + 2);
+            out.putString("{\n");
+            settings.writeIndentation(out, indents + 3);
+            out.putString("\"type\" : \"");
+            out.putString(child_type);
+            out.putString("\",\n");
+            settings.writeIndentation(out, indents + 3);
+            out.putString("\"name\" : \"");
+            out.putString(index_name(i));
+            out.putString("\",\n");
+            settings.writeIndentation(out, indents + 3);
+            out.putString("\"value\" : \"");
+            out.putInteger(array[i]);
+            out.putString("\"\n");
+            settings.writeIndentation(out, indents + 2);
+            out.putString(i < shown - 1 ? "},\n" : "}\n");
+        }
     }
+    settings.stream() << settings.indentation(indents + 1) << "]";
+    if (shown < len) settings.stream() << ",\n" << settings.indentation(indents + 1) << "\"omittedElements\" : " << len - shown;
     settings.stream() << "\n" << settings.indentation(indents) << "}";
 }
 
@@ -1477,7 +6723,8 @@ void dump_json_value(const T &object, const void *pObject, const ApiDumpSettings
     settings.stream() << settings.indentation(indents) << "}";
 }
 
-void dump_json_special(const char *text, const ApiDumpSettings &settings, const char *type_string, const char *name, int indents) {
+inline void dump_json_special(const char *text, const ApiDumpSettings &settings, const char *type_string, const char *name,
+                              int indents) {
     settings.stream() << settings.indentation(indents) << "{\n";
     settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "\",\n";
     settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\",\n";
@@ -1489,7 +6736,7 @@ void dump_json_special(const char *text, const ApiDumpSettings &settings, const
     settings.stream() << settings.indentation(indents) << "}";
 }
 
-void dump_json_UNUSED(const ApiDumpSettings &settings, const char *type_string, const char *name, int indents) {
+inline void dump_json_UNUSED(const ApiDumpSettings &settings, const char *type_string, const char *name, int indents) {
     settings.stream() << settings.indentation(indents) << "{\n";
     settings.stream() << settings.indentation(indents + 1) << "\"type\" : \"" << type_string << "\",\n";
     settings.stream() << settings.indentation(indents + 1) << "\"name\" : \"" << name << "\",\n";
@@ -1498,19 +6745,19 @@ void dump_json_UNUSED(const ApiDumpSettings &settings, const char *type_string,
     settings.stream() << settings.indentation(indents) << "}";
 }
 
-void dump_json_cstring(const char *object, const ApiDumpSettings &settings, int indents) {
+inline void dump_json_cstring(const char *object, const ApiDumpSettings &settings, int indents) {
     if (object == NULL)
         settings.stream() << "\"\"";
     else
-        settings.stream() << "\"" << object << "\"";
+        OutputString(settings, object, true);
 }
 
-void dump_json_void(const void *object, const ApiDumpSettings &settings, int indents) {
+inline void dump_json_void(const void *object, const ApiDumpSettings &settings, int indents) {
     OutputAddressJSON(settings, object);
     settings.stream() << "\n";
 }
 
-void dump_json_int(int object, const ApiDumpSettings &settings, int indents) {
+inline void dump_json_int(int object, const ApiDumpSettings &settings, int indents) {
     settings.stream() << settings.indentation(indents) << "\"value\" : " << '"' << object << "\"";
     settings.stream() << '"' << object << "\"";
 }
@@ -1543,20 +6790,267 @@ void dump_json_pNext(const T *object, const ApiDumpSettings &settings, const cha
     }
 }
 
-//==================================== Common Helpers ======================================//
+//==================================== Trace Backend Helpers =====================================//
 
-void dump_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcNamedParams, const char *funcReturn) {
-    if (dump_inst.shouldDumpOutput()) {
-        switch (dump_inst.settings().format()) {
-            case ApiDumpFormat::Text:
-                dump_text_function_head(dump_inst, funcName, funcNamedParams, funcReturn);
-                break;
-            case ApiDumpFormat::Html:
-                dump_html_function_head(dump_inst, funcName, funcNamedParams, funcReturn);
-                break;
-            case ApiDumpFormat::Json:
-                dump_json_function_head(dump_inst, funcName, funcReturn);
-                break;
+// Writes a steady clock time in the microseconds the trace event format uses, keeping the nanoseconds as decimals.
+inline void dump_trace_time(std::ostream &out, uint64_t time_ns) {
+    out << time_ns / 1000 << '.' << static_cast<char>('0' + time_ns / 100 % 10) << static_cast<char>('0' + time_ns / 10 % 10)
+        << static_cast<char>('0' + time_ns % 10);
+}
+
+inline void dump_trace_function_head(ApiDumpInstance &dump_inst, const char *funcName) {
+    const ApiDumpSettings &settings(dump_inst.settings());
+    settings.stream() << ",\n{\"name\" : \"" << funcName << "\", \"cat\" : \"vulkan\", \"ph\" : \"X\", \"pid\" : "
+                      << ApiDumpSettings::processID() << ", \"tid\" : " << dump_inst.threadID()
+                      << ", \"args\" : {\"frame\" : " << dump_inst.frameCount();
+}
+
+// Arguments are summarized as their top level value: numbers for scalars and enums, addresses for pointers and handles.
+template <typename T>
+void dump_trace_arg(const ApiDumpSettings &settings, const char *name, const T &value) {
+    settings.stream() << ", \"" << name << "\" : ";
+    if constexpr (std::is_pointer_v<T>) {
+        OutputAddressJSON(settings, reinterpret_cast<const void *>(value));
+    } else if constexpr (std::is_enum_v<T>) {
+        settings.stream() << static_cast<int64_t>(value);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        if (std::isfinite(value)) {
+            settings.stream() << value;
+        } else {
+            settings.stream() << "\"" << value << "\"";
+        }
+    } else if constexpr (std::is_integral_v<T>) {
+        settings.stream() << +value;
+    } else {
+        settings.stream() << "\"...\"";
+    }
+}
+
+inline void dump_trace_function_tail(ApiDumpInstance &dump_inst) {
+    const ApiDumpSettings &settings(dump_inst.settings());
+    const uint64_t start_ticks = dump_inst.callStartTicks();
+    const uint64_t end_ticks = dump_inst.callEndTicks();
+    settings.stream() << "}, \"ts\" : ";
+    dump_trace_time(settings.stream(), ApiDumpClock::ToNs(start_ticks));
+    settings.stream() << ", \"dur\" : ";
+    dump_trace_time(settings.stream(), ApiDumpClock::DurationNs(end_ticks - start_ticks));
+    settings.stream() << "}";
+    if (settings.shouldFlush()) settings.stream().flush();
+}
+
+//=================================== Binary Backend Helpers =====================================//
+
+inline void dump_binary_function_head(ApiDumpInstance &dump_inst) {
+    std::streambuf &out = *dump_inst.settings().stream().rdbuf();
+    const uint64_t thread_id = dump_inst.threadID();
+    const uint64_t frame = dump_inst.frameCount();
+    const int64_t time = static_cast<int64_t>(dump_inst.current_time_since_start().count());
+    const uint64_t sequence = dump_inst.nextSequence();
+    out.sputn(reinterpret_cast<const char *>(&thread_id), sizeof(thread_id));
+    out.sputn(reinterpret_cast<const char *>(&frame), sizeof(frame));
+    out.sputn(reinterpret_cast<const char *>(&time), sizeof(time));
+    out.sputn(reinterpret_cast<const char *>(&sequence), sizeof(sequence));
+}
+
+template <typename T>
+void dump_binary_raw(const T &object, const ApiDumpSettings &settings) {
+    settings.stream().rdbuf()->sputn(reinterpret_cast<const char *>(&object), sizeof(T));
+}
+
+// Writes a flag telling the reader whether the value which follows is present, and returns it.
+inline bool dump_binary_flag(bool flag, const ApiDumpSettings &settings) {
+    dump_binary_raw<uint8_t>(flag ? 1 : 0, settings);
+    return flag;
+}
+
+template <typename T>
+void dump_binary_array(const T *array, size_t len, const ApiDumpSettings &settings,
+                       void (*dump)(const T, const ApiDumpSettings &)) {
+    if (!dump_binary_flag(array != NULL, settings)) return;
+    dump_binary_raw<uint64_t>(len, settings);
+    for (size_t i = 0; i < len; ++i) dump(array[i], settings);
+}
+
+template <typename T>
+void dump_binary_array(const T *array, size_t len, const ApiDumpSettings &settings,
+                       void (*dump)(const T &, const ApiDumpSettings &)) {
+    if (!dump_binary_flag(array != NULL, settings)) return;
+    dump_binary_raw<uint64_t>(len, settings);
+    for (size_t i = 0; i < len; ++i) dump(array[i], settings);
+}
+
+template <typename T>
+void dump_binary_pointer(const T *pointer, const ApiDumpSettings &settings, void (*dump)(const T, const ApiDumpSettings &)) {
+    if (dump_binary_flag(pointer != NULL, settings)) dump(*pointer, settings);
+}
+
+template <typename T>
+void dump_binary_pointer(const T *pointer, const ApiDumpSettings &settings, void (*dump)(const T &, const ApiDumpSettings &)) {
+    if (dump_binary_flag(pointer != NULL, settings)) dump(*pointer, settings);
+}
+
+inline void dump_binary_cstring(const char *object, const ApiDumpSettings &settings) {
+    if (object == NULL) {
+        dump_binary_raw<uint32_t>(UINT32_MAX, settings);
+        return;
+    }
+    const uint32_t length = static_cast<uint32_t>(strlen(object));
+    dump_binary_raw(length, settings);
+    settings.stream().rdbuf()->sputn(object, length);
+}
+
+// Opaque pointers are only ever printed as addresses, so only the address is recorded.
+inline void dump_binary_void(const void *object, const ApiDumpSettings &settings) { dump_binary_raw(object, settings); }
+
+// Reads back the payload of one record of a binary capture. Memory for the pointers of the reconstructed parameters
+// lives as long as the reader. A truncated or corrupt record makes the reader fail, after which it only returns zeroes.
+class ApiDumpBinaryReader {
+   public:
+    ApiDumpBinaryReader(const char *data, size_t size) : cursor(data), end(data + size) {}
+    ApiDumpBinaryReader(const ApiDumpBinaryReader &) = delete;
+    ApiDumpBinaryReader &operator=(const ApiDumpBinaryReader &) = delete;
+
+    bool failed() const { return has_failed; }
+
+    void fail() {
+        has_failed = true;
+        cursor = end;
+    }
+
+    bool atEnd() const { return cursor == end; }
+
+    template <typename T>
+    void raw(T &object) {
+        if (!consume(sizeof(T))) {
+            memset(&object, 0, sizeof(T));
+            return;
+        }
+        memcpy(&object, cursor - sizeof(T), sizeof(T));
+    }
+
+    bool flag() {
+        uint8_t value = 0;
+        raw(value);
+        return value != 0;
+    }
+
+    // Returns size bytes of the record, or NULL if there aren't that many left.
+    const char *bytes(size_t size) { return consume(size) ? cursor - size : NULL; }
+
+    size_t remaining() const { return static_cast<size_t>(end - cursor); }
+
+    // Returns zeroed storage for count objects, or NULL once the reader has failed.
+    template <typename T>
+    T *allocate(size_t count) {
+        if (has_failed) return NULL;
+        const size_t size = sizeof(T) * std::max<size_t>(count, 1);
+        storage.emplace_back(new char[size]());
+        return reinterpret_cast<T *>(storage.back().get());
+    }
+
+   private:
+    bool consume(size_t size) {
+        if (has_failed || size > static_cast<size_t>(end - cursor)) {
+            fail();
+            return false;
         }
+        cursor += size;
+        return true;
+    }
+
+    const char *cursor;
+    const char *end;
+    bool has_failed = false;
+    std::vector<std::unique_ptr<char[]>> storage;
+};
+
+template <typename T>
+void read_binary_array(ApiDumpBinaryReader &reader, T *&array, void (*read)(ApiDumpBinaryReader &, std::remove_const_t<T> &)) {
+    array = NULL;
+    if (!reader.flag()) return;
+    uint64_t len = 0;
+    reader.raw(len);
+    // Every element takes at least one byte, so a longer array can only come from a corrupt record.
+    if (len > reader.remaining()) reader.fail();
+    std::remove_const_t<T> *objects = reader.allocate<std::remove_const_t<T>>(static_cast<size_t>(len));
+    if (objects == NULL) return;
+    for (uint64_t i = 0; i < len; ++i) read(reader, objects[i]);
+    array = objects;
+}
+
+// Arrays which are embedded in a structure record the number of elements in use, at most N.
+template <typename T, size_t N>
+void read_binary_fixed_array(ApiDumpBinaryReader &reader, T (&array)[N], void (*read)(ApiDumpBinaryReader &, T &)) {
+    if (!reader.flag()) return;
+    uint64_t len = 0;
+    reader.raw(len);
+    if (len > N) {
+        reader.fail();
+        return;
+    }
+    for (uint64_t i = 0; i < len; ++i) read(reader, array[i]);
+}
+
+template <typename T>
+void read_binary_pointer(ApiDumpBinaryReader &reader, T *&pointer, void (*read)(ApiDumpBinaryReader &, std::remove_const_t<T> &)) {
+    pointer = NULL;
+    if (!reader.flag()) return;
+    std::remove_const_t<T> *object = reader.allocate<std::remove_const_t<T>>(1);
+    if (object == NULL) return;
+    read(reader, *object);
+    pointer = object;
+}
+
+inline void read_binary_cstring(ApiDumpBinaryReader &reader, const char *&object) {
+    object = NULL;
+    uint32_t length = 0;
+    reader.raw(length);
+    if (length == UINT32_MAX) return;
+    const char *data = reader.bytes(length);
+    char *string = reader.allocate<char>(static_cast<size_t>(length) + 1);
+    if (data == NULL || string == NULL) return;
+    memcpy(string, data, length);
+    object = string;
+}
+
+// Strings which are embedded in a structure are truncated to the size of the array.
+inline void read_binary_fixed_cstring(ApiDumpBinaryReader &reader, char *object, size_t size) {
+    const char *string = NULL;
+    read_binary_cstring(reader, string);
+    if (string == NULL || size == 0) return;
+    strncpy(object, string, size - 1);
+    object[size - 1] = '\0';
+}
+
+// Also used for the pointers to system types, which are only ever printed as addresses too.
+template <typename T>
+void read_binary_void(ApiDumpBinaryReader &reader, T *&object) {
+    reader.raw(object);
+}
+
+//==================================== Common Helpers ======================================//
+
+// Callers check shouldDumpOutput() once for both the head and the body of a call, so that a frame change in between
+// can't split them.
+inline void dump_function_head(ApiDumpInstance &dump_inst, const char *funcName, const char *funcNamedParams,
+                               const char *funcReturn) {
+    switch (dump_inst.captureFormat()) {
+        case ApiDumpFormat::Text:
+            dump_text_function_head(dump_inst, funcName, funcNamedParams, funcReturn);
+            break;
+        case ApiDumpFormat::Html:
+            dump_html_function_head(dump_inst, funcName, funcNamedParams, funcReturn);
+            break;
+        case ApiDumpFormat::Json:
+            dump_json_function_head(dump_inst, funcName, funcReturn);
+            break;
+        case ApiDumpFormat::Binary:
+            dump_binary_function_head(dump_inst);
+            break;
+        case ApiDumpFormat::Trace:
+            dump_trace_function_head(dump_inst, funcName);
+            break;
+        case ApiDumpFormat::Stats:
+            break;
     }
 }
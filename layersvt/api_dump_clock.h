@@ -0,0 +1,166 @@
+/* Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// The clock of the timestamps of the api_dump layer. Where the CPU has a counter running at a constant rate, the invariant
+// time stamp counter of x86 or the generic timer of AArch64, reading the clock is a single instruction instead of a call to
+// std::chrono::steady_clock, which goes through clock_gettime and traps on some virtual machines. The ticks of the counter
+// are only converted to the nanoseconds of std::chrono::steady_clock when they are written out, so that times from both
+// clocks can be compared.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define API_DUMP_CLOCK_X86_COUNTER 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <x86intrin.h>
+#define API_DUMP_CLOCK_X86_COUNTER 1
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+#define API_DUMP_CLOCK_ARM_COUNTER 1
+#endif
+
+class ApiDumpClock {
+   public:
+    // The current time in ticks, which only mean something as a difference or through ToNs.
+    static uint64_t Now() { return Get().uses_counter ? ReadCounter() : SteadyNs(); }
+
+    // The time of std::chrono::steady_clock in nanoseconds at the given ticks.
+    static uint64_t ToNs(uint64_t ticks) { return Get().toNs(ticks); }
+
+    // The number of nanoseconds in the given number of ticks.
+    static uint64_t DurationNs(uint64_t ticks) { return Get().durationNs(ticks); }
+
+    static uint64_t NowNs() { return ToNs(Now()); }
+
+    // The rate of the time stamp counter of x86 is measured against std::chrono::steady_clock, over twice as long every
+    // time so that the measure keeps getting more precise. Called at every frame boundary, where it costs a read of
+    // std::chrono::steady_clock unless the measure is due.
+    static void Recalibrate() { Get().recalibrate(); }
+
+    static uint64_t SteadyNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+   private:
+    // Ticks convert to nanoseconds from the point of a calibration. Calibrations are never changed once they are made, so
+    // that they are read without a lock.
+    struct Calibration {
+        uint64_t ticks;
+        uint64_t ns;
+        double ns_per_tick;
+    };
+
+    static constexpr uint32_t kMaxCalibrations = 64;
+    static constexpr uint64_t kFirstCalibrationNs = 1000000;
+
+    ApiDumpClock() : uses_counter(HasConstantRateCounter()) {
+        if (!uses_counter) return;
+#if defined(API_DUMP_CLOCK_ARM_COUNTER)
+        // The frequency of the generic timer is known, so it needs no measure.
+        uint64_t frequency = 0;
+        asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+        calibrations[0] = Calibration{ReadCounter(), SteadyNs(), 1e9 / static_cast<double>(frequency)};
+        next_calibration_ns.store(UINT64_MAX, std::memory_order_relaxed);
+#else
+        origin_ticks = ReadCounter();
+        origin_ns = SteadyNs();
+        uint64_t ns = origin_ns;
+        while (ns - origin_ns < kFirstCalibrationNs) ns = SteadyNs();
+        const uint64_t ticks = ReadCounter();
+        calibrations[0] = Calibration{ticks, ns, static_cast<double>(ns - origin_ns) / static_cast<double>(ticks - origin_ticks)};
+        next_calibration_ns.store(ns + 2 * (ns - origin_ns), std::memory_order_relaxed);
+#endif
+    }
+
+    static ApiDumpClock &Get() {
+        static ApiDumpClock clock;
+        return clock;
+    }
+
+    static bool HasConstantRateCounter() {
+#if defined(API_DUMP_CLOCK_X86_COUNTER) && defined(_MSC_VER)
+        int registers[4] = {};
+        __cpuid(registers, 0x80000000);
+        if (static_cast<unsigned>(registers[0]) < 0x80000007u) return false;
+        __cpuid(registers, 0x80000007);
+        return (registers[3] & (1 << 8)) != 0;
+#elif defined(API_DUMP_CLOCK_X86_COUNTER)
+        unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) return false;
+        return (edx & (1u << 8)) != 0;
+#elif defined(API_DUMP_CLOCK_ARM_COUNTER)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static uint64_t ReadCounter() {
+#if defined(API_DUMP_CLOCK_X86_COUNTER)
+        return __rdtsc();
+#elif defined(API_DUMP_CLOCK_ARM_COUNTER)
+        uint64_t ticks = 0;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+#else
+        return SteadyNs();
+#endif
+    }
+
+    uint64_t toNs(uint64_t ticks) const {
+        if (!uses_counter) return ticks;
+        const Calibration &calibration = calibrations[current.load(std::memory_order_acquire)];
+        const double delta = static_cast<double>(static_cast<int64_t>(ticks - calibration.ticks)) * calibration.ns_per_tick;
+        return calibration.ns + static_cast<int64_t>(std::llround(delta));
+    }
+
+    uint64_t durationNs(uint64_t ticks) const {
+        if (!uses_counter) return ticks;
+        const Calibration &calibration = calibrations[current.load(std::memory_order_acquire)];
+        return static_cast<uint64_t>(std::llround(static_cast<double>(ticks) * calibration.ns_per_tick));
+    }
+
+    void recalibrate() {
+        if (!uses_counter) return;
+        const uint64_t ns = SteadyNs();
+        if (ns < next_calibration_ns.load(std::memory_order_relaxed)) return;
+        std::lock_guard<std::mutex> lg(mutex);
+        if (ns < next_calibration_ns.load(std::memory_order_relaxed)) return;
+        const uint32_t index = current.load(std::memory_order_relaxed) + 1;
+        if (index == kMaxCalibrations) {
+            next_calibration_ns.store(UINT64_MAX, std::memory_order_relaxed);
+            return;
+        }
+        const uint64_t ticks = ReadCounter();
+        calibrations[index] = Calibration{ticks, ns, static_cast<double>(ns - origin_ns) / static_cast<double>(ticks - origin_ticks)};
+        current.store(index, std::memory_order_release);
+        next_calibration_ns.store(ns + 2 * (ns - origin_ns), std::memory_order_relaxed);
+    }
+
+    const bool uses_counter;
+    Calibration calibrations[kMaxCalibrations] = {};
+    std::atomic<uint32_t> current{0};
+    std::atomic<uint64_t> next_calibration_ns{UINT64_MAX};
+    std::mutex mutex;
+    uint64_t origin_ticks = 0;
+    uint64_t origin_ns = 0;
+};
@@ -0,0 +1,193 @@
+/* Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Converts a binary capture made by the api_dump layer into its text, html, json or ndjson output, as if the layer had
+// been run with that output format. The remaining layer settings apply as usual.
+
+#include "api_dump_text.h"
+#include "api_dump_html.h"
+#include "api_dump_json.h"
+#include "api_dump_binary_reader.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <utility>
+
+static void SetEnvVar(const char *name, const char *value) {
+#ifdef _WIN32
+    _putenv_s(name, value);
+#else
+    if (value[0] == '\0')
+        unsetenv(name);
+    else
+        setenv(name, value, 1);
+#endif
+}
+
+// Reads the records of a capture file one at a time, so that only the record being converted is held in memory however
+// large the capture is.
+class CaptureReader {
+   public:
+    // Returns false if the file isn't a capture this converter can read.
+    bool open(const char *filename) {
+        file.rdbuf()->pubsetbuf(file_buffer.data(), static_cast<std::streamsize>(file_buffer.size()));
+        file.open(filename, std::ifstream::in | std::ifstream::binary);
+        if (!file.is_open()) {
+            std::cerr << "Could not read '" << filename << "'\n";
+            return false;
+        }
+
+        ApiDumpBinaryFileHeader header = {};
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+            memcmp(header.magic, API_DUMP_BINARY_MAGIC, sizeof(header.magic)) != 0) {
+            std::cerr << "'" << filename << "' is not an api_dump binary capture\n";
+            return false;
+        }
+        if (header.format_version != API_DUMP_BINARY_FORMAT_VERSION || header.header_version != VK_HEADER_VERSION) {
+            std::cerr << "'" << filename << "' was made with format version " << header.format_version
+                      << " and Vulkan header version " << header.header_version << ", but this converter reads format version "
+                      << API_DUMP_BINARY_FORMAT_VERSION << " with Vulkan header version " << VK_HEADER_VERSION << "\n";
+            return false;
+        }
+        remaining = FileSize(filename) - sizeof(header);
+        return true;
+    }
+
+    // Reads the next record, returning false at the end of the file.
+    bool next() {
+        uint32_t record_size = 0;
+        if (!file.read(reinterpret_cast<char *>(&record_size), sizeof(record_size))) {
+            truncated = file.gcount() > 0;
+            return false;
+        }
+        // Every record has a head, so a zero size is the zeroed tail which a mapped output file keeps after a crash.
+        if (record_size == 0) return false;
+        remaining -= std::min<uint64_t>(remaining, sizeof(record_size));
+        if (record_size > remaining) {
+            truncated = true;
+            return false;
+        }
+        remaining -= record_size;
+        record.resize(record_size);
+        if (!file.read(record.data(), record_size)) {
+            truncated = true;
+            return false;
+        }
+
+        // The sequence number follows the thread, the frame and the time. Records too short to have one are rejected by the
+        // reader later on.
+        sequence = 0;
+        if (record_size >= 4 * sizeof(uint64_t)) memcpy(&sequence, record.data() + 3 * sizeof(uint64_t), sizeof(uint64_t));
+        return true;
+    }
+
+    const std::vector<char> &data() const { return record; }
+    uint64_t recordSequence() const { return sequence; }
+    bool wasTruncated() const { return truncated; }
+
+   private:
+    static uint64_t FileSize(const char *filename) {
+        std::ifstream file(filename, std::ifstream::in | std::ifstream::binary | std::ifstream::ate);
+        return static_cast<uint64_t>(std::max<std::streamoff>(file.tellg(), 0));
+    }
+
+    std::vector<char> file_buffer = std::vector<char>(1024 * 1024);
+    std::ifstream file;
+    // The bytes of the file after the records read so far, so that a damaged record size isn't read past the end.
+    uint64_t remaining = 0;
+    std::vector<char> record;
+    uint64_t sequence = 0;
+    bool truncated = false;
+};
+
+// Returns false if the record could not be read.
+static bool ConvertRecord(ApiDumpInstance &dump_inst, const std::vector<char> &record) {
+    ApiDumpBinaryReader reader(record.data(), record.size());
+
+    uint64_t thread_id = 0;
+    uint64_t frame = 0;
+    int64_t time = 0;
+    uint64_t sequence = 0;
+    uint32_t function_index = 0;
+    reader.raw(thread_id);
+    reader.raw(frame);
+    reader.raw(time);
+    reader.raw(sequence);
+    // Calls which failed before reaching the driver only have a head.
+    if (reader.atEnd()) return true;
+    reader.raw(function_index);
+    // The frame counter is replayed one frame at a time, so a damaged frame number must not be followed.
+    if (reader.failed() || frame > UINT32_MAX) return false;
+
+    while (dump_inst.frameCount() < frame) dump_inst.nextFrame();
+    dump_inst.setRecordedCallInfo(thread_id, frame, std::chrono::microseconds(time));
+    return convert_binary_call(dump_inst, function_index, reader, false);
+}
+
+static bool IsFormat(const std::string &argument) {
+    return argument == "text" || argument == "html" || argument == "json" || argument == "ndjson";
+}
+
+int main(int argc, char **argv) {
+    // Every argument before the format is a capture file, so that the files of a split capture can be merged.
+    int format_arg = 1;
+    while (format_arg < argc && !IsFormat(argv[format_arg])) ++format_arg;
+    if (format_arg == 1 || argc - format_arg > 2) {
+        std::cerr << "Usage: " << argv[0] << " <capture file>... [text|html|json|ndjson] [output file]\n"
+                  << "Converts a capture made with the binary output format of VK_LAYER_LUNARG_api_dump.\n"
+                  << "The files of a split capture are merged in the order the calls were made.\n"
+                  << "The output is written to stdout if no output file is given.\n";
+        return 1;
+    }
+    const std::string format = format_arg < argc ? argv[format_arg] : "text";
+    const char *output_file = format_arg + 1 < argc ? argv[format_arg + 1] : "";
+
+    std::vector<std::unique_ptr<CaptureReader>> captures;
+    for (int i = 1; i < format_arg; ++i) {
+        captures.push_back(std::make_unique<CaptureReader>());
+        if (!captures.back()->open(argv[i])) return 1;
+    }
+
+    // The files of a split capture are merged by the sequence numbers of their records, each file being in order already,
+    // with a heap holding the next record of every file. Records with the same sequence number keep the order of the files.
+    typedef std::pair<uint64_t, size_t> NextRecord;
+    std::priority_queue<NextRecord, std::vector<NextRecord>, std::greater<NextRecord>> next_records;
+    for (size_t i = 0; i < captures.size(); ++i) {
+        if (captures[i]->next()) next_records.push(NextRecord(captures[i]->recordSequence(), i));
+    }
+
+    // The settings are read when the instance is first used, so the overrides have to be in place before that.
+    SetEnvVar(API_DUMP_ENV_VAR_OUTPUT_FMT, format.c_str());
+    SetEnvVar(API_DUMP_ENV_VAR_LOG_FILE, output_file);
+    ApiDumpInstance &dump_inst = ApiDumpInstance::current();
+
+    uint64_t skipped_records = 0;
+    while (!next_records.empty()) {
+        const size_t capture_index = next_records.top().second;
+        CaptureReader &capture = *captures[capture_index];
+        next_records.pop();
+        if (!ConvertRecord(dump_inst, capture.data())) ++skipped_records;
+        if (capture.next()) next_records.push(NextRecord(capture.recordSequence(), capture_index));
+    }
+
+    for (size_t i = 0; i < captures.size(); ++i) {
+        if (captures[i]->wasTruncated()) std::cerr << "'" << argv[i + 1] << "' is truncated, its last record was skipped\n";
+    }
+    if (skipped_records > 0) std::cerr << skipped_records << " records could not be read and were skipped\n";
+    return 0;
+}
@@ -0,0 +1,140 @@
+/* Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Extracts frames from an output file of the api_dump layer made with the frame_index setting, by seeking to them with the
+// help of the frame index written next to it instead of reading the whole file.
+
+#include "api_dump_frame_index.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Binary captures start with a header which the converter needs, so it is copied in front of the extracted frames. See
+// ApiDumpBinaryFileHeader in api_dump.h.
+static const char BINARY_CAPTURE_MAGIC[8] = {'V', 'K', 'A', 'P', 'I', 'D', 'M', 'P'};
+static const size_t BINARY_CAPTURE_HEADER_SIZE = 16;
+
+static bool ParseFrameRange(const char *argument, uint64_t &first, uint64_t &last) {
+    char *end = nullptr;
+    first = std::strtoull(argument, &end, 10);
+    if (end == argument) return false;
+    last = first;
+    if (*end == '-') {
+        const char *last_argument = end + 1;
+        last = std::strtoull(last_argument, &end, 10);
+        if (end == last_argument) return false;
+    }
+    return *end == '\0' && first <= last;
+}
+
+// The first entry of the index for a frame at or after the given one, which is a binary search over the entries in the file.
+static uint64_t FindEntry(std::ifstream &index, uint64_t entry_count, uint64_t frame) {
+    uint64_t low = 0;
+    uint64_t high = entry_count;
+    while (low < high) {
+        const uint64_t middle = low + (high - low) / 2;
+        ApiDumpFrameIndexEntry entry = {};
+        index.seekg(static_cast<std::streamoff>(sizeof(ApiDumpFrameIndexHeader) + middle * sizeof(entry)));
+        index.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+        if (entry.frame < frame)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+static bool CopyBytes(std::ifstream &input, uint64_t offset, uint64_t size, std::ostream &output) {
+    std::vector<char> buffer(1024 * 1024);
+    input.seekg(static_cast<std::streamoff>(offset));
+    while (size > 0 && input) {
+        const size_t part = static_cast<size_t>(std::min<uint64_t>(size, buffer.size()));
+        input.read(buffer.data(), static_cast<std::streamsize>(part));
+        output.write(buffer.data(), input.gcount());
+        size -= static_cast<uint64_t>(input.gcount());
+    }
+    return size == 0;
+}
+
+int main(int argc, char **argv) {
+    uint64_t first_frame = 0;
+    uint64_t last_frame = 0;
+    if (argc < 3 || argc > 4 || !ParseFrameRange(argv[2], first_frame, last_frame)) {
+        std::cerr << "Usage: " << argv[0] << " <output file> <frame>[-<last frame>] [extracted file]\n"
+                  << "Extracts frames from an output file of VK_LAYER_LUNARG_api_dump made with the frame_index setting.\n"
+                  << "The frames are written to stdout if no extracted file is given.\n";
+        return 1;
+    }
+    const std::string output_filename = argv[1];
+
+    std::ifstream index(ApiDumpFrameIndexFileName(output_filename), std::ifstream::in | std::ifstream::binary);
+    ApiDumpFrameIndexHeader header = {};
+    if (!index.is_open() || !index.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        memcmp(header.magic, API_DUMP_FRAME_INDEX_MAGIC, sizeof(header.magic)) != 0) {
+        std::cerr << "Could not read the frame index '" << ApiDumpFrameIndexFileName(output_filename) << "'\n";
+        return 1;
+    }
+    if (header.format_version != API_DUMP_FRAME_INDEX_FORMAT_VERSION || header.entry_size != sizeof(ApiDumpFrameIndexEntry)) {
+        std::cerr << "The frame index was made with format version " << header.format_version
+                  << ", but this tool reads format version " << API_DUMP_FRAME_INDEX_FORMAT_VERSION << "\n";
+        return 1;
+    }
+    index.seekg(0, std::ifstream::end);
+    const uint64_t entry_count = (static_cast<uint64_t>(index.tellg()) - sizeof(header)) / sizeof(ApiDumpFrameIndexEntry);
+
+    std::ifstream input(output_filename, std::ifstream::in | std::ifstream::binary);
+    if (!input.is_open()) {
+        std::cerr << "Could not read '" << output_filename << "'\n";
+        return 1;
+    }
+    std::ofstream output_file;
+    if (argc == 4) {
+        output_file.open(argv[3], std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+        if (!output_file.is_open()) {
+            std::cerr << "Could not write '" << argv[3] << "'\n";
+            return 1;
+        }
+    }
+    std::ostream &output = argc == 4 ? output_file : std::cout;
+
+    char magic[sizeof(BINARY_CAPTURE_MAGIC)] = {};
+    if (input.read(magic, sizeof(magic)) && memcmp(magic, BINARY_CAPTURE_MAGIC, sizeof(magic)) == 0) {
+        CopyBytes(input, 0, BINARY_CAPTURE_HEADER_SIZE, output);
+    }
+    input.clear();
+
+    uint64_t extracted_frames = 0;
+    index.clear();
+    for (uint64_t i = FindEntry(index, entry_count, first_frame); i < entry_count; ++i) {
+        ApiDumpFrameIndexEntry entry = {};
+        index.seekg(static_cast<std::streamoff>(sizeof(header) + i * sizeof(entry)));
+        if (!index.read(reinterpret_cast<char *>(&entry), sizeof(entry)) || entry.frame > last_frame) break;
+        if (!CopyBytes(input, entry.offset, entry.size, output)) {
+            std::cerr << "'" << output_filename << "' ends in the middle of frame " << entry.frame << "\n";
+            return 1;
+        }
+        ++extracted_frames;
+    }
+
+    if (extracted_frames == 0) {
+        std::cerr << "No frame from " << first_frame << " to " << last_frame << " is in '" << output_filename << "'\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+/* Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// With the frame_index setting, every output file of the api_dump layer gets a sidecar file with the same name followed by
+// API_DUMP_FRAME_INDEX_EXTENSION. It starts with this header, followed by one entry per frame written to the output file,
+// in increasing frame order. Everything is in host byte order, and the entries have a fixed size so that the entry of a
+// frame can be found by a binary search over the file without reading it all.
+struct ApiDumpFrameIndexHeader {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t entry_size;
+};
+
+// The bytes of the output file the frame was written to, from the start of the frame to its end.
+struct ApiDumpFrameIndexEntry {
+    uint64_t frame;
+    uint64_t offset;
+    uint64_t size;
+};
+
+static const char API_DUMP_FRAME_INDEX_MAGIC[8] = {'V', 'K', 'A', 'P', 'I', 'I', 'D', 'X'};
+static const uint32_t API_DUMP_FRAME_INDEX_FORMAT_VERSION = 1;
+static const char API_DUMP_FRAME_INDEX_EXTENSION[] = ".idx";
+
+inline std::string ApiDumpFrameIndexFileName(const std::string &output_filename) {
+    return output_filename + API_DUMP_FRAME_INDEX_EXTENSION;
+}
@@ -0,0 +1,74 @@
+/* Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Receives the output which the api_dump layer streams with the stream_output setting, and writes it to a file as the
+// layer would have. A binary capture received this way is converted with api_dump_convert like any other.
+
+#include "api_dump_socket.h"
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " <address> [output file]\n"
+                  << "Receives the output of VK_LAYER_LUNARG_api_dump made with the stream_output setting.\n"
+                  << "The address is unix:<path> or [host]:<port>, and is listened on for a single run of the application.\n"
+                  << "The output is written to stdout if no output file is given.\n";
+        return 1;
+    }
+
+    const int listening = ApiDumpOpenSocket(argv[1], true);
+    if (listening < 0) {
+        std::cerr << "Could not listen on '" << argv[1] << "'\n";
+        return 1;
+    }
+    const int connection = accept(listening, nullptr, nullptr);
+    close(listening);
+    if (connection < 0) {
+        std::cerr << "Could not accept a connection on '" << argv[1] << "'\n";
+        return 1;
+    }
+
+    std::ofstream output_file;
+    if (argc == 3) {
+        output_file.open(argv[2], std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+        if (!output_file.is_open()) {
+            std::cerr << "Could not write '" << argv[2] << "'\n";
+            close(connection);
+            return 1;
+        }
+    }
+    std::ostream &output = argc == 3 ? output_file : std::cout;
+
+    std::vector<char> buffer(1024 * 1024);
+    uint64_t received = 0;
+    for (;;) {
+        const ssize_t count = recv(connection, buffer.data(), buffer.size(), 0);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) break;
+        output.write(buffer.data(), count);
+        received += static_cast<uint64_t>(count);
+    }
+    close(connection);
+    output.flush();
+
+    if (!output) {
+        std::cerr << "Could not write all of the " << received << " bytes received\n";
+        return 1;
+    }
+    return 0;
+}
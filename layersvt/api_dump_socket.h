@@ -0,0 +1,85 @@
+/* Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// With the stream_output setting, the api_dump layer writes its output to a socket instead of a file, and api_dump_receive
+// writes what it receives from the other end to a file. The address is "unix:<path>" for a Unix domain socket, or
+// "<host>:<port>" for a TCP connection, where the host is left empty to listen on every interface.
+
+#if !defined(_WIN32)
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+// Returns the socket connected to the address, or listening on it, or -1 if that fails.
+inline int ApiDumpOpenSocket(const std::string &address, bool listen) {
+    static const char unix_prefix[] = "unix:";
+    if (address.compare(0, sizeof(unix_prefix) - 1, unix_prefix) == 0) {
+        const std::string path = address.substr(sizeof(unix_prefix) - 1);
+        sockaddr_un unix_address = {};
+        if (path.empty() || path.size() >= sizeof(unix_address.sun_path)) return -1;
+        unix_address.sun_family = AF_UNIX;
+        memcpy(unix_address.sun_path, path.c_str(), path.size() + 1);
+        const int unix_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (unix_socket < 0) return -1;
+        const sockaddr *socket_address = reinterpret_cast<const sockaddr *>(&unix_address);
+        if (listen) unlink(path.c_str());
+        if (listen ? bind(unix_socket, socket_address, sizeof(unix_address)) == 0 && ::listen(unix_socket, 1) == 0
+                   : connect(unix_socket, socket_address, sizeof(unix_address)) == 0) {
+            return unix_socket;
+        }
+        close(unix_socket);
+        return -1;
+    }
+
+    const size_t colon = address.rfind(':');
+    if (colon == std::string::npos) return -1;
+    const std::string host = address.substr(0, colon);
+    const std::string port = address.substr(colon + 1);
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listen ? AI_PASSIVE : 0;
+    addrinfo *addresses = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &addresses) != 0) return -1;
+    int tcp_socket = -1;
+    for (addrinfo *info = addresses; info != nullptr && tcp_socket < 0; info = info->ai_next) {
+        tcp_socket = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+        if (tcp_socket < 0) continue;
+        if (listen) {
+            const int reuse = 1;
+            setsockopt(tcp_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        }
+        if (listen ? bind(tcp_socket, info->ai_addr, info->ai_addrlen) == 0 && ::listen(tcp_socket, 1) == 0
+                   : connect(tcp_socket, info->ai_addr, info->ai_addrlen) == 0) {
+            break;
+        }
+        close(tcp_socket);
+        tcp_socket = -1;
+    }
+    freeaddrinfo(addresses);
+    return tcp_socket;
+}
+
+#endif
@@ -21,13 +21,32 @@
  * Author: Tony Barbour <tony@lunarg.com>
  */
 #include "containers/custom_containers.h"
+#include "monitor_memory.h"
+#include "monitor_overlay.h"
+#include "monitor_spike.h"
+#include "monitor_telemetry.h"
+#include "monitor_threads.h"
 #include "utils/vk_layer_extension_utils.h"
+#include "vk_layer_config.h"
+#include "vk_layer_handle_map.h"
 #include "vk_layer_table.h"
 #include <assert.h>
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 
@@ -35,12 +54,345 @@
 #include <dlfcn.h>
 #endif
 
-#if (!defined(VK_USE_PLATFORM_XCB_KHR) && !defined(VK_USE_PLATFORM_WIN32_KHR))
-#warning "Monitor layer only has code for XCB and Windows at this time"
-#endif
-
 #define TITLE_LENGTH 1000
-#define FPS_LENGTH 24
+#define FPS_LENGTH 160
+#define OVERLAY_LENGTH 48
+
+// The frame times of the last FRAME_TIME_HISTORY presents of a swapchain, in
+// a circular buffer, enough for the 0.1% lows to mean something.
+#define FRAME_TIME_HISTORY 10000
+struct frame_time_history {
+    std::chrono::steady_clock::time_point last_present{};
+    bool presented = false;
+    std::vector<float> frame_times_ms;
+    size_t next = 0;
+};
+
+// The statistics of the frame times of a swapchain. The lows are the FPS of
+// the frames slower than 99% and 99.9% of the others.
+struct frame_time_stats {
+    size_t frames;
+    float min_fps;
+    float max_fps;
+    float low_1_percent_fps;
+    float low_0_1_percent_fps;
+    float median_ms;
+    float p99_ms;
+    float p99_9_ms;
+};
+
+// A record of the present of a swapchain, logged to the frame log.
+struct frame_record {
+    uint64_t frame;
+    uint64_t timestamp_ns;  // of the present, on the steady clock
+    float frame_time_ms;    // since the previous present of the swapchain, 0 for the first
+    uint64_t swapchain;
+    int64_t gpu_frame;  // the frame whose GPU time was read back last since the previous record, or -1
+    float gpu_time_ms;
+    float memory_usage_mb;  // of the device local heaps at the last sample, or -1 if there is none
+    float memory_budget_mb;
+    // Over the last interval of the thread CPU sampler, or -1 if there is none.
+    float cpu_process_percent;
+    float cpu_busiest_thread_percent;
+    uint64_t cpu_busiest_thread;
+};
+
+// Writes the records of the presents to a file, as CSV, or as JSON, one object
+// per line, if its name ends with ".json". The presents push their records to
+// a lock-free ring, which a background thread empties to the file, so that
+// they never do any I/O. The presents are expected to be made from one
+// thread at a time, as the rest of the layer does. Records that do not fit in
+// the ring are dropped, and their number is written when the log is closed.
+// The GPU frame times are logged when they are measured, and the memory
+// budget and the CPU time of the threads when they are sampled.
+#define FRAME_LOG_RING_SIZE 4096
+class frame_log {
+   public:
+    ~frame_log() { close(); }
+
+    bool is_open() const { return file != nullptr; }
+
+    void open(const char *file_name, bool gpu_times, bool memory_budget, bool thread_cpu) {
+        if (file) return;
+        file = fopen(file_name, "w");
+        if (!file) {
+            fprintf(stderr, "monitor: Failed to open log file: %s\n", file_name);
+            return;
+        }
+        size_t const length = strlen(file_name);
+        json = length >= 5 && strcmp(file_name + length - 5, ".json") == 0;
+        gpu_columns = gpu_times;
+        memory_columns = memory_budget;
+        cpu_columns = thread_cpu;
+        if (!json) {
+            fprintf(file, "frame,timestamp_ns,frame_time_ms,swapchain%s%s%s\n", gpu_columns ? ",gpu_frame,gpu_time_ms" : "",
+                    memory_columns ? ",memory_usage_mb,memory_budget_mb" : "",
+                    cpu_columns ? ",cpu_process_percent,cpu_busiest_thread_percent,cpu_busiest_thread" : "");
+        }
+        stopping = false;
+        writer = std::thread(&frame_log::run, this);
+    }
+
+    void close() {
+        if (!file) return;
+        stopping = true;
+        writer.join();
+        uint64_t const dropped_records = dropped.load();
+        if (dropped_records > 0) {
+            fprintf(stderr, "monitor: %llu frame log records dropped\n", static_cast<unsigned long long>(dropped_records));
+        }
+        fclose(file);
+        file = nullptr;
+    }
+
+    void push(const frame_record &record) {
+        uint64_t const h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= FRAME_LOG_RING_SIZE) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        ring[h % FRAME_LOG_RING_SIZE] = record;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+   private:
+    void write_records() {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t const h = head.load(std::memory_order_acquire);
+        for (; t != h; t++) {
+            const frame_record &record = ring[t % FRAME_LOG_RING_SIZE];
+            if (json) {
+                fprintf(file, "{\"frame\": %llu, \"timestamp_ns\": %llu, \"frame_time_ms\": %.3f, \"swapchain\": \"0x%llx\"",
+                        static_cast<unsigned long long>(record.frame), static_cast<unsigned long long>(record.timestamp_ns),
+                        record.frame_time_ms, static_cast<unsigned long long>(record.swapchain));
+                if (gpu_columns && record.gpu_frame >= 0) {
+                    fprintf(file, ", \"gpu_frame\": %lld, \"gpu_time_ms\": %.3f", static_cast<long long>(record.gpu_frame),
+                            record.gpu_time_ms);
+                }
+                if (memory_columns && record.memory_usage_mb >= 0.0f) {
+                    fprintf(file, ", \"memory_usage_mb\": %.1f, \"memory_budget_mb\": %.1f", record.memory_usage_mb,
+                            record.memory_budget_mb);
+                }
+                if (cpu_columns && record.cpu_process_percent >= 0.0f) {
+                    fprintf(file,
+                            ", \"cpu_process_percent\": %.1f, \"cpu_busiest_thread_percent\": %.1f, \"cpu_busiest_thread\": %llu",
+                            record.cpu_process_percent, record.cpu_busiest_thread_percent,
+                            static_cast<unsigned long long>(record.cpu_busiest_thread));
+                }
+                fprintf(file, "}\n");
+            } else {
+                fprintf(file, "%llu,%llu,%.3f,0x%llx", static_cast<unsigned long long>(record.frame),
+                        static_cast<unsigned long long>(record.timestamp_ns), record.frame_time_ms,
+                        static_cast<unsigned long long>(record.swapchain));
+                if (gpu_columns) {
+                    if (record.gpu_frame >= 0) {
+                        fprintf(file, ",%lld,%.3f", static_cast<long long>(record.gpu_frame), record.gpu_time_ms);
+                    } else {
+                        fprintf(file, ",,");
+                    }
+                }
+                if (memory_columns) {
+                    if (record.memory_usage_mb >= 0.0f) {
+                        fprintf(file, ",%.1f,%.1f", record.memory_usage_mb, record.memory_budget_mb);
+                    } else {
+                        fprintf(file, ",,");
+                    }
+                }
+                if (cpu_columns) {
+                    if (record.cpu_process_percent >= 0.0f) {
+                        fprintf(file, ",%.1f,%.1f,%llu", record.cpu_process_percent, record.cpu_busiest_thread_percent,
+                                static_cast<unsigned long long>(record.cpu_busiest_thread));
+                    } else {
+                        fprintf(file, ",,,");
+                    }
+                }
+                fprintf(file, "\n");
+            }
+        }
+        tail.store(t, std::memory_order_release);
+    }
+
+    void run() {
+        while (!stopping.load()) {
+            write_records();
+            fflush(file);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        write_records();
+    }
+
+    FILE *file = nullptr;
+    bool json = false;
+    bool gpu_columns = false;
+    bool memory_columns = false;
+    bool cpu_columns = false;
+    std::thread writer;
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> head{0};  // written by the presents
+    std::atomic<uint64_t> tail{0};  // written by the writer thread
+    std::atomic<uint64_t> dropped{0};
+    frame_record ring[FRAME_LOG_RING_SIZE];
+};
+
+static frame_log frame_logger;
+
+// Publishes the statistics of the swapchains to shared memory, if enabled.
+static telemetry_exporter telemetry;
+
+// Samples the CPU time of the threads of the process, if enabled.
+static thread_cpu_sampler thread_cpu;
+
+// The instances created and not destroyed yet. The frame log is closed with
+// the last one.
+static int instance_count = 0;
+
+// Whether the GPU time of the frames is measured, whether the text overlay is
+// drawn, and whether the display times are collected, set with the first
+// instance.
+static bool gpu_timing_enabled = false;
+static bool overlay_enabled = false;
+static bool display_timing_enabled = false;
+
+// The frames slower than spike_threshold_ms, or than spike_factor times the
+// median of the frames before them, are spikes, broadcast to the layers
+// subscribed to them, if either is set, with the first instance.
+static float spike_threshold_ms = 0.0f;
+static float spike_factor = 0.0f;
+
+// Whether the submits to the queues are counted and timed, set with the first
+// instance.
+static bool submit_stats_enabled = false;
+
+// The memory budget of the devices is sampled every memory_budget_frames
+// presents, if it is not 0, set with the first instance.
+static uint32_t memory_budget_frames = 0;
+
+// The layers subscribed to the spikes, through the functions the layer
+// exports for it.
+struct spike_subscriber {
+    monitor_spike_callback callback;
+    void *user_data;
+};
+static std::mutex spike_subscribers_mutex;
+static spike_subscriber spike_subscribers[MONITOR_SPIKE_SUBSCRIBERS];
+static uint32_t spike_subscriber_count = 0;
+
+// The GPU time of a frame is measured with two timestamps, written to a pair
+// of queries of a slot of the query pool of its device: one at the start of
+// the first submit of the frame, and one once the work submitted to the same
+// queue before its present is done. The slots are used in turn, and their
+// queries are read back without waiting for the GPU, at the following
+// presents, so that measuring never stalls the application.
+#define GPU_TIMING_SLOTS 8
+enum gpu_timing_slot_state { GPU_TIMING_SLOT_FREE, GPU_TIMING_SLOT_BEGUN, GPU_TIMING_SLOT_ENDED };
+struct gpu_timing_slot {
+    gpu_timing_slot_state state = GPU_TIMING_SLOT_FREE;
+    VkQueue queue{};  // of the first submit of the frame
+    uint64_t valid_mask = 0;  // of the timestamps of its family
+    uint64_t frame = 0;
+};
+
+// The command buffers that write the timestamps of each slot, recorded once
+// for the queues of a family. The pool is null if the queues of the family
+// do not support timestamps.
+struct gpu_timing_commands {
+    VkCommandPool pool{};
+    uint64_t valid_mask = 0;
+    VkCommandBuffer begin[GPU_TIMING_SLOTS]{};
+    VkCommandBuffer end[GPU_TIMING_SLOTS]{};
+};
+
+// The text overlay of a swapchain, copied to the top left corner of its
+// images before they are presented, for the platforms whose window titles the
+// layer cannot set, or no window at all. Each image has a strip of pixels of
+// its own in the buffer, a command buffer recorded once that copies it, and a
+// fence and semaphore, so that the strip of an image is only drawn again once
+// its previous copy is done.
+struct swapchain_overlay {
+    uint32_t width = 0;  // of the strips, in pixels
+    uint32_t height = 0;
+    uint32_t scale = 1;
+    std::vector<VkImage> images;
+    VkBuffer buffer{};
+    VkDeviceMemory memory{};
+    uint32_t *pixels{};
+    uint32_t family = UINT32_MAX;  // of the queue the command buffers are recorded for, once presented
+    VkCommandPool pool{};
+    std::vector<VkCommandBuffer> command_buffers;
+    std::vector<VkFence> fences;
+    std::vector<VkSemaphore> semaphores;
+    std::vector<uint64_t> text_versions;  // of the text drawn in the strip of each image
+};
+
+// The times the presents of a swapchain were displayed, from
+// VK_GOOGLE_display_timing. The presents are given IDs, and the time of each
+// is kept in a ring until its display time is reported, at a later present.
+// The display times are on the clock of the presentation engine, which is the
+// monotonic clock of the steady clock on Linux and Android.
+#define DISPLAY_TIMING_RING 64
+struct display_timing_history {
+    uint64_t refresh_duration_ns = 0;
+    uint32_t next_present_id = 1;
+    uint32_t present_ids[DISPLAY_TIMING_RING] = {};
+    uint64_t present_times_ns[DISPLAY_TIMING_RING] = {};  // when the presents were made, on the steady clock
+    uint64_t last_display_ns = 0;
+    uint64_t frames = 0;  // displayed
+    uint64_t latency_frames = 0;  // displayed, whose present time was still in the ring
+    double latency_sum_ms = 0.0;  // from the presents to their display
+    double latency_max_ms = 0.0;
+    uint64_t missed_vblanks = 0;  // the refresh cycles between two frames displayed in a row
+    // The mean and sum of the squared deviations of the intervals between
+    // the frames displayed, for their standard deviation, the jitter.
+    uint64_t intervals = 0;
+    double interval_mean_ms = 0.0;
+    double interval_m2 = 0.0;
+};
+
+// The last frame times of a swapchain, over which the median the spikes are
+// compared to is taken, in a circular buffer. After a spike, the next
+// SPIKE_COOLDOWN_FRAMES frames are not broadcast, so that a slow stretch does
+// not have the subscribers save their captures every frame.
+#define SPIKE_MEDIAN_FRAMES 64
+#define SPIKE_COOLDOWN_FRAMES 60
+struct spike_history {
+    float frame_times_ms[SPIKE_MEDIAN_FRAMES] = {};
+    uint32_t count = 0;
+    uint32_t next = 0;
+    uint32_t cooldown = 0;
+};
+
+// The state of a swapchain, created with it, which the presents find through
+// the swapchain table.
+struct swapchain_data {
+    frame_time_history frame_times;
+    spike_history spikes;  // if the spikes are detected
+    std::unique_ptr<swapchain_overlay> overlay;  // if it has one
+    std::unique_ptr<display_timing_history> display_timing;  // if the display times are collected
+    telemetry_counters counters;  // published if the telemetry is
+};
+
+// The submits made to a queue, if they are counted, created with the queue,
+// which the submits find through the queue statistics table. A queue is
+// submitted to by one thread at a time, so the counters are only atomic for
+// the presents to read them.
+struct queue_submit_stats {
+    uint32_t family = 0;
+    std::atomic<uint64_t> submits{};  // the calls, of any number of batches
+    std::atomic<uint64_t> batches{};
+    std::atomic<uint64_t> command_buffers{};
+    std::atomic<uint64_t> semaphore_waits{};
+    std::atomic<uint64_t> cpu_ns{};  // in the submit calls, below the layer
+    std::atomic<uint64_t> max_cpu_ns{};
+};
+
+// The totals of the submit statistics of the queues of a device.
+struct submit_totals {
+    uint64_t submits = 0;
+    uint64_t command_buffers = 0;
+    uint64_t semaphore_waits = 0;
+    uint64_t cpu_ns = 0;
+};
+
 struct monitor_layer_data {
     VulDeviceDispatchTable *device_dispatch_table{};
     VulInstanceDispatchTable *instance_dispatch_table{};
@@ -54,17 +406,67 @@ struct monitor_layer_data {
     bool xcb_fps{};
 #endif
     char base_title[TITLE_LENGTH]{};
-    bool got_title = false;
     VkPhysicalDevice gpu{};
     VkDevice device{};
 
     PFN_vkSetDeviceLoaderData pfn_dev_init{};
     int lastFrame{};
-    time_t lastTime{};
+    std::chrono::steady_clock::time_point lastTime{};
     float fps{};
     int frame{};
+    monitor_layer_data *instance_data{};  // of the instance of the device
+
+    // The swapchains of the device. They are created and destroyed with the
+    // mutex held, and found by the presents through the swapchain table.
+    std::mutex swapchains_mutex;
+    std::unordered_map<VkSwapchainKHR, std::unique_ptr<swapchain_data>> swapchains;
+
+    // The GPU frame timing, if enabled. The submits can be made from several
+    // threads, so its state is guarded by the mutex.
+    bool gpu_timing{};
+    std::mutex gpu_timing_mutex;
+    float timestamp_period{};  // in nanoseconds per tick
+    VkQueryPool timestamp_pool{};
+    std::unordered_map<VkQueue, uint32_t> queue_families;
+    std::unordered_map<uint32_t, gpu_timing_commands> gpu_commands;
+    gpu_timing_slot gpu_slots[GPU_TIMING_SLOTS];
+    uint32_t next_gpu_slot{};
+    int current_gpu_slot = -1;  // of the frame being submitted, if it is timed
+    float gpu_time_ms{};        // the average over the last title update
+    double gpu_time_sum_ms{};   // since the last title update
+    uint32_t gpu_frames{};
+    double gpu_time_total_ms{};
+    uint64_t gpu_frames_total{};
+    float gpu_time_max_ms{};
+
+    // The submit statistics of the queues, if they are collected, guarded by
+    // gpu_timing_mutex like the queue families. The totals are of the last
+    // title update, for the submits per frame since.
+    bool submit_stats{};
+    std::unordered_map<VkQueue, std::unique_ptr<queue_submit_stats>> queue_stats;
+    submit_totals title_submit_totals;
+
+    // Samples the memory budget, if enabled and the device supports
+    // VK_EXT_memory_budget.
+    std::unique_ptr<memory_budget_sampler> memory_budget;
+
+    // The text overlay, if enabled.
+    bool overlay{};
+    std::string overlay_text;
+    uint64_t overlay_text_version{};
+
+    // Whether VK_GOOGLE_display_timing is enabled, for the display times of
+    // the presents to be collected.
+    bool display_timing{};
 };
 
+// The data of the queues and swapchains, for the submits and presents to find
+// it without a lock, and without racing with the devices created on other
+// threads.
+static HandleMap<VkQueue, monitor_layer_data> queue_table;
+static HandleMap<VkSwapchainKHR, swapchain_data> swapchain_table;
+static HandleMap<VkQueue, queue_submit_stats> queue_stats_table;
+
 #if defined(VK_USE_PLATFORM_XCB_KHR)
 static struct {
     void *xcbLib{};
@@ -77,11 +479,608 @@ static struct {
 } xcb = {NULL};
 #endif
 
-static std::unordered_map<VkPhysicalDevice, VkInstance> layer_instances;
-static std::unordered_map<void *, monitor_layer_data *> layer_data_map;
+#if defined(VK_USE_PLATFORM_WIN32_KHR) || defined(VK_USE_PLATFORM_XCB_KHR)
+// A title to set to a window: its base title, followed by the frame rate.
+struct window_title {
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+    HWND hwnd{};  // whose base title is its title when it is first set
+#elif defined(VK_USE_PLATFORM_XCB_KHR)
+    xcb_connection_t *connection{};
+    xcb_window_t window{};
+    std::string base_title;
+#endif
+    std::string text;
+};
+
+// Sets the titles of the windows on a thread of its own, started with the
+// first title, so that the presents never wait for it: SetWindowText sends a
+// message to the window and waits for its message loop to handle it, and XCB
+// flushes its connection. Only the latest title of each window is set.
+class title_updater {
+   public:
+    ~title_updater() { stop(); }
+
+    void set(window_title &&title) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto same_window = std::find_if(pending.begin(), pending.end(), [&title](const window_title &other) {
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+            return other.hwnd == title.hwnd;
+#elif defined(VK_USE_PLATFORM_XCB_KHR)
+            return other.connection == title.connection && other.window == title.window;
+#endif
+        });
+        if (same_window != pending.end()) {
+            *same_window = std::move(title);
+        } else {
+            pending.push_back(std::move(title));
+        }
+        if (!thread.joinable()) thread = std::thread(&title_updater::run, this);
+        changed.notify_one();
+    }
+
+    // Wait for the titles set so far to be applied, before their windows or
+    // connections can go away.
+    void wait_idle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return pending.empty() && !applying; });
+    }
+
+    void stop() {
+        if (!thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            changed.notify_one();
+        }
+        thread.join();
+        stopping = false;
+    }
+
+   private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) break;
+            std::vector<window_title> titles;
+            titles.swap(pending);
+            applying = true;
+            lock.unlock();
+            for (window_title &title : titles) apply(title);
+            lock.lock();
+            applying = false;
+            idle.notify_all();
+        }
+    }
+
+    void apply(window_title &title) {
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+        if (!IsWindow(title.hwnd)) return;
+        auto base_title = base_titles.find(title.hwnd);
+        if (base_title == base_titles.end()) {
+            char text[TITLE_LENGTH];
+            GetWindowText(title.hwnd, text, TITLE_LENGTH);
+            base_title = base_titles.emplace(title.hwnd, text).first;
+        }
+        SetWindowText(title.hwnd, (base_title->second + title.text).c_str());
+#elif defined(VK_USE_PLATFORM_XCB_KHR)
+        std::string const text = title.base_title + title.text;
+        xcb.change_property(title.connection, XCB_PROP_MODE_REPLACE, title.window, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8,
+                            text.size(), text.c_str());
+        xcb.flush(title.connection);
+#endif
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;  // a title was set, or the thread is stopping
+    std::condition_variable idle;     // the titles taken by the thread were applied
+    std::vector<window_title> pending;
+    bool applying = false;
+    bool stopping = false;
+    std::thread thread;
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+    std::unordered_map<HWND, std::string> base_titles;  // used by the thread only
+#endif
+};
+
+static title_updater window_titles;
+#endif
+
+// The instances of the physical devices, and the data of the instances and
+// devices, by dispatch key.
+static HandleMap<VkPhysicalDevice, std::remove_pointer<VkInstance>::type> layer_instances;
+static HandleMap<void *, monitor_layer_data> layer_data_map;
+
+// The data of a dispatch key, created if it has none yet.
+static monitor_layer_data *get_layer_data(void *key) {
+    monitor_layer_data *my_data = layer_data_map.find(key);
+    if (my_data) return my_data;
+    std::unique_ptr<monitor_layer_data> created(new monitor_layer_data);
+    my_data = layer_data_map.insert(key, created.get());
+    if (my_data == created.get()) created.release();
+    return my_data;
+}
+
+// The data of the device of a queue, from the queue table, or from its
+// dispatch key for the queues not got through the layer.
+static monitor_layer_data *get_queue_device_data(VkQueue queue) {
+    monitor_layer_data *my_data = queue_table.find(queue);
+    return my_data ? my_data : get_layer_data(get_dispatch_key(queue));
+}
+
+// Record the time since the previous present of a swapchain, and return it,
+// 0 for the first present.
+static float record_frame_time(frame_time_history &history, std::chrono::steady_clock::time_point now) {
+    float frame_time_ms = 0.0f;
+    if (history.presented) {
+        frame_time_ms = std::chrono::duration<float, std::milli>(now - history.last_present).count();
+        if (history.frame_times_ms.size() < FRAME_TIME_HISTORY) {
+            history.frame_times_ms.push_back(frame_time_ms);
+        } else {
+            history.frame_times_ms[history.next] = frame_time_ms;
+            history.next = (history.next + 1) % FRAME_TIME_HISTORY;
+        }
+    }
+    history.last_present = now;
+    history.presented = true;
+    return frame_time_ms;
+}
+
+// Whether a frame time of a swapchain is a spike, then add it to the frame
+// times the median is taken over. The median is only compared to once there
+// are SPIKE_MEDIAN_FRAMES frame times.
+static bool is_spike(spike_history &history, float frame_time_ms) {
+    bool spike = false;
+    if (history.cooldown > 0) {
+        history.cooldown--;
+    } else {
+        spike = spike_threshold_ms > 0.0f && frame_time_ms > spike_threshold_ms;
+        if (!spike && spike_factor > 0.0f && history.count == SPIKE_MEDIAN_FRAMES) {
+            float sorted_times[SPIKE_MEDIAN_FRAMES];
+            std::copy(history.frame_times_ms, history.frame_times_ms + SPIKE_MEDIAN_FRAMES, sorted_times);
+            std::nth_element(sorted_times, sorted_times + SPIKE_MEDIAN_FRAMES / 2, sorted_times + SPIKE_MEDIAN_FRAMES);
+            spike = frame_time_ms > spike_factor * sorted_times[SPIKE_MEDIAN_FRAMES / 2];
+        }
+        if (spike) history.cooldown = SPIKE_COOLDOWN_FRAMES;
+    }
+    history.frame_times_ms[history.next] = frame_time_ms;
+    history.next = (history.next + 1) % SPIKE_MEDIAN_FRAMES;
+    if (history.count < SPIKE_MEDIAN_FRAMES) history.count++;
+    return spike;
+}
+
+// Call the subscribers with a spike.
+static void broadcast_spike(uint64_t frame, float frame_time_ms, VkSwapchainKHR swapchain) {
+    std::lock_guard<std::mutex> lock(spike_subscribers_mutex);
+    fprintf(stderr, "monitor: Frame %llu of swapchain %p took %.2f ms, broadcast as a spike to %u layers\n",
+            static_cast<unsigned long long>(frame), (void *)swapchain, frame_time_ms, spike_subscriber_count);
+    for (uint32_t i = 0; i < spike_subscriber_count; i++) {
+        spike_subscribers[i].callback(spike_subscribers[i].user_data, frame, frame_time_ms);
+    }
+}
+
+// The frame time below which a fraction of the frame times are.
+static float frame_time_percentile(std::vector<float> &sorted_times, float fraction) {
+    size_t const index = std::min(static_cast<size_t>(fraction * sorted_times.size()), sorted_times.size() - 1);
+    return sorted_times[index];
+}
+
+// Compute the statistics of the frame times of a swapchain. Returns false if
+// it has none yet.
+static bool compute_frame_time_stats(const frame_time_history &history, frame_time_stats &stats) {
+    if (history.frame_times_ms.empty()) return false;
+    std::vector<float> sorted_times = history.frame_times_ms;
+    std::sort(sorted_times.begin(), sorted_times.end());
+    auto fps = [](float frame_time_ms) { return frame_time_ms > 0.0f ? 1000.0f / frame_time_ms : 0.0f; };
+    stats.frames = sorted_times.size();
+    stats.min_fps = fps(sorted_times.back());
+    stats.max_fps = fps(sorted_times.front());
+    stats.median_ms = frame_time_percentile(sorted_times, 0.5f);
+    stats.p99_ms = frame_time_percentile(sorted_times, 0.99f);
+    stats.p99_9_ms = frame_time_percentile(sorted_times, 0.999f);
+    stats.low_1_percent_fps = fps(stats.p99_ms);
+    stats.low_0_1_percent_fps = fps(stats.p99_9_ms);
+    return true;
+}
+
+// The command buffers that write the timestamps on a queue, created with the
+// first frame submitted to a queue of its family. Returns null if the queue
+// cannot write timestamps. Called with the GPU timing mutex held.
+static gpu_timing_commands *get_gpu_timing_commands(monitor_layer_data *my_data, VkQueue queue) {
+    auto family = my_data->queue_families.find(queue);
+    if (family == my_data->queue_families.end()) return nullptr;
+    auto found = my_data->gpu_commands.find(family->second);
+    if (found != my_data->gpu_commands.end()) return found->second.pool ? &found->second : nullptr;
+
+    gpu_timing_commands &commands = my_data->gpu_commands[family->second];
+    VulDeviceDispatchTable *pTable = my_data->device_dispatch_table;
+    VulInstanceDispatchTable *pInstanceTable = my_data->instance_data->instance_dispatch_table;
+    uint32_t family_count = 0;
+    pInstanceTable->GetPhysicalDeviceQueueFamilyProperties(my_data->gpu, &family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> families(family_count);
+    pInstanceTable->GetPhysicalDeviceQueueFamilyProperties(my_data->gpu, &family_count, families.data());
+    if (family->second >= family_count || families[family->second].timestampValidBits == 0) {
+        fprintf(stderr, "monitor: Queue family %u does not support timestamps, its frames are not timed on the GPU\n",
+                family->second);
+        return nullptr;
+    }
+    uint32_t const valid_bits = families[family->second].timestampValidBits;
+    commands.valid_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+    VkCommandPoolCreateInfo pool_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    pool_info.queueFamilyIndex = family->second;
+    VkCommandPool pool = VK_NULL_HANDLE;
+    if (pTable->CreateCommandPool(my_data->device, &pool_info, nullptr, &pool) != VK_SUCCESS) return nullptr;
+
+    VkCommandBufferAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    allocate_info.commandPool = pool;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandBufferCount = GPU_TIMING_SLOTS;
+    if (pTable->AllocateCommandBuffers(my_data->device, &allocate_info, commands.begin) != VK_SUCCESS ||
+        pTable->AllocateCommandBuffers(my_data->device, &allocate_info, commands.end) != VK_SUCCESS) {
+        pTable->DestroyCommandPool(my_data->device, pool, nullptr);
+        return nullptr;
+    }
+
+    VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    for (uint32_t slot = 0; slot < GPU_TIMING_SLOTS; slot++) {
+        for (VkCommandBuffer command_buffer : {commands.begin[slot], commands.end[slot]}) {
+            // The command buffers are dispatchable objects created by the layer.
+            if (my_data->pfn_dev_init) {
+                my_data->pfn_dev_init(my_data->device, (void *)command_buffer);
+            } else {
+                *((const void **)command_buffer) = *(void **)my_data->device;
+            }
+        }
+        pTable->BeginCommandBuffer(commands.begin[slot], &begin_info);
+        pTable->CmdResetQueryPool(commands.begin[slot], my_data->timestamp_pool, 2 * slot, 2);
+        pTable->CmdWriteTimestamp(commands.begin[slot], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, my_data->timestamp_pool, 2 * slot);
+        pTable->EndCommandBuffer(commands.begin[slot]);
+        pTable->BeginCommandBuffer(commands.end[slot], &begin_info);
+        pTable->CmdWriteTimestamp(commands.end[slot], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, my_data->timestamp_pool, 2 * slot + 1);
+        pTable->EndCommandBuffer(commands.end[slot]);
+    }
+    commands.pool = pool;
+    return &commands;
+}
+
+// Submit the first batches of a frame, with the command buffer that writes
+// the timestamp of its start prepended to those of the first batch. The slot
+// of the frame is taken before the submit, so that the mutex is not held
+// during it.
+static VkResult submit_gpu_frame_begin(monitor_layer_data *my_data, VkQueue queue, uint32_t submitCount,
+                                       const VkSubmitInfo *pSubmits, VkFence fence) {
+    VulDeviceDispatchTable *pTable = my_data->device_dispatch_table;
+    std::unique_lock<std::mutex> lock(my_data->gpu_timing_mutex);
+    uint32_t const slot = my_data->next_gpu_slot;
+    gpu_timing_commands *commands = nullptr;
+    bool timed = my_data->current_gpu_slot < 0 && my_data->gpu_slots[slot].state == GPU_TIMING_SLOT_FREE;
+    // The device masks of a device group submit are per command buffer.
+    for (auto next = reinterpret_cast<const VkBaseInStructure *>(pSubmits[0].pNext); timed && next; next = next->pNext) {
+        if (next->sType == VK_STRUCTURE_TYPE_DEVICE_GROUP_SUBMIT_INFO) timed = false;
+    }
+    if (timed) commands = get_gpu_timing_commands(my_data, queue);
+    if (!commands) {
+        lock.unlock();
+        return pTable->QueueSubmit(queue, submitCount, pSubmits, fence);
+    }
+    gpu_timing_slot &timing_slot = my_data->gpu_slots[slot];
+    timing_slot.state = GPU_TIMING_SLOT_BEGUN;
+    timing_slot.queue = queue;
+    timing_slot.valid_mask = commands->valid_mask;
+    timing_slot.frame = static_cast<uint64_t>(my_data->frame);
+    my_data->current_gpu_slot = static_cast<int>(slot);
+    my_data->next_gpu_slot = (slot + 1) % GPU_TIMING_SLOTS;
+    VkCommandBuffer const begin_command_buffer = commands->begin[slot];
+    lock.unlock();
+
+    std::vector<VkCommandBuffer> command_buffers;
+    command_buffers.reserve(pSubmits[0].commandBufferCount + 1);
+    command_buffers.push_back(begin_command_buffer);
+    command_buffers.insert(command_buffers.end(), pSubmits[0].pCommandBuffers,
+                           pSubmits[0].pCommandBuffers + pSubmits[0].commandBufferCount);
+    std::vector<VkSubmitInfo> submits(pSubmits, pSubmits + submitCount);
+    submits[0].commandBufferCount = static_cast<uint32_t>(command_buffers.size());
+    submits[0].pCommandBuffers = command_buffers.data();
+    VkResult result = pTable->QueueSubmit(queue, submitCount, submits.data(), fence);
+    if (result != VK_SUCCESS) {
+        lock.lock();
+        if (my_data->current_gpu_slot == static_cast<int>(slot)) my_data->current_gpu_slot = -1;
+        timing_slot.state = GPU_TIMING_SLOT_FREE;
+    }
+    return result;
+}
+
+// Submit the command buffer that writes the timestamp of the end of the frame
+// presented on a queue. A frame whose first submit was to another queue is not
+// timed, as the order of the work of different queues is unknown.
+static void submit_gpu_frame_end(monitor_layer_data *my_data, VkQueue queue) {
+    std::lock_guard<std::mutex> lock(my_data->gpu_timing_mutex);
+    if (my_data->current_gpu_slot < 0) return;
+    uint32_t const slot = static_cast<uint32_t>(my_data->current_gpu_slot);
+    gpu_timing_slot &timing_slot = my_data->gpu_slots[slot];
+    my_data->current_gpu_slot = -1;
+    timing_slot.state = GPU_TIMING_SLOT_FREE;
+    if (timing_slot.queue != queue) return;
+
+    VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &my_data->gpu_commands[my_data->queue_families[queue]].end[slot];
+    if (my_data->device_dispatch_table->QueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE) == VK_SUCCESS) {
+        timing_slot.state = GPU_TIMING_SLOT_ENDED;
+    }
+}
+
+// Read back the timestamps of the frames whose work is done, without waiting
+// for the others. Returns the number of the last frame read back and sets its
+// GPU time, or returns -1 if none was.
+static int64_t read_gpu_frame_times(monitor_layer_data *my_data, float &gpu_time_ms) {
+    std::lock_guard<std::mutex> lock(my_data->gpu_timing_mutex);
+    int64_t last_frame = -1;
+    for (uint32_t i = 0; i < GPU_TIMING_SLOTS; i++) {
+        // From the oldest slot, the one used next, so that the last frame
+        // read back is the latest.
+        uint32_t const slot = (my_data->next_gpu_slot + i) % GPU_TIMING_SLOTS;
+        gpu_timing_slot &timing_slot = my_data->gpu_slots[slot];
+        if (timing_slot.state != GPU_TIMING_SLOT_ENDED) continue;
+        uint64_t timestamps[2];
+        VkResult result = my_data->device_dispatch_table->GetQueryPoolResults(
+            my_data->device, my_data->timestamp_pool, 2 * slot, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT);
+        if (result == VK_NOT_READY) continue;
+        timing_slot.state = GPU_TIMING_SLOT_FREE;
+        if (result != VK_SUCCESS) continue;
+        uint64_t const ticks = (timestamps[1] - timestamps[0]) & timing_slot.valid_mask;
+        gpu_time_ms = static_cast<float>(ticks * static_cast<double>(my_data->timestamp_period) / 1.0e6);
+        last_frame = static_cast<int64_t>(timing_slot.frame);
+        my_data->gpu_time_sum_ms += gpu_time_ms;
+        my_data->gpu_frames++;
+        my_data->gpu_time_total_ms += gpu_time_ms;
+        my_data->gpu_frames_total++;
+        my_data->gpu_time_max_ms = std::max(my_data->gpu_time_max_ms, gpu_time_ms);
+    }
+    return last_frame;
+}
+
+// Whether the swapchain images of a format can have the overlay copied to
+// them: those of 8-bit RGBA or BGRA, in which its black and white are the
+// same.
+static bool overlay_supports_format(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+        case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Create the overlay of a swapchain created with the transfer destination
+// usage. Its command buffers are recorded once it is presented, for the
+// family of the queue it is presented on.
+static void create_swapchain_overlay(monitor_layer_data *my_data, VkSwapchainKHR swapchain, swapchain_data &data,
+                                     const VkSwapchainCreateInfoKHR *pCreateInfo) {
+    VulDeviceDispatchTable *pTable = my_data->device_dispatch_table;
+    VkDevice device = my_data->device;
+    swapchain_overlay overlay;
+    uint32_t image_count = 0;
+    pTable->GetSwapchainImagesKHR(device, swapchain, &image_count, nullptr);
+    overlay.images.resize(image_count);
+    pTable->GetSwapchainImagesKHR(device, swapchain, &image_count, overlay.images.data());
+
+    // Scaled up on large swapchains, cut down to small ones.
+    overlay.scale = pCreateInfo->imageExtent.height >= 1440 ? 3 : pCreateInfo->imageExtent.height >= 720 ? 2 : 1;
+    overlay.width = std::min(overlay_width(OVERLAY_LENGTH, overlay.scale), pCreateInfo->imageExtent.width);
+    overlay.height = std::min(overlay_height(overlay.scale), pCreateInfo->imageExtent.height);
+    VkDeviceSize const strip_size = static_cast<VkDeviceSize>(overlay.width) * overlay.height * sizeof(uint32_t);
+
+    VkBufferCreateInfo buffer_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    buffer_info.size = strip_size * image_count;
+    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (pTable->CreateBuffer(device, &buffer_info, nullptr, &overlay.buffer) != VK_SUCCESS) return;
+    VkMemoryRequirements requirements;
+    pTable->GetBufferMemoryRequirements(device, overlay.buffer, &requirements);
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    my_data->instance_data->instance_dispatch_table->GetPhysicalDeviceMemoryProperties(my_data->gpu, &memory_properties);
+    VkMemoryPropertyFlags const host_coherent = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkMemoryAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = UINT32_MAX;
+    for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+        if ((requirements.memoryTypeBits & (1u << i)) &&
+            (memory_properties.memoryTypes[i].propertyFlags & host_coherent) == host_coherent) {
+            allocate_info.memoryTypeIndex = i;
+            break;
+        }
+    }
+    void *mapped = nullptr;
+    if (allocate_info.memoryTypeIndex == UINT32_MAX ||
+        pTable->AllocateMemory(device, &allocate_info, nullptr, &overlay.memory) != VK_SUCCESS) {
+        pTable->DestroyBuffer(device, overlay.buffer, nullptr);
+        return;
+    }
+    if (pTable->BindBufferMemory(device, overlay.buffer, overlay.memory, 0) != VK_SUCCESS ||
+        pTable->MapMemory(device, overlay.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+        pTable->DestroyBuffer(device, overlay.buffer, nullptr);
+        pTable->FreeMemory(device, overlay.memory, nullptr);
+        return;
+    }
+    overlay.pixels = static_cast<uint32_t *>(mapped);
+
+    // The fences are created signaled, as if the images had been copied to.
+    VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    VkSemaphoreCreateInfo semaphore_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    overlay.fences.resize(image_count);
+    overlay.semaphores.resize(image_count);
+    overlay.text_versions.resize(image_count);
+    for (uint32_t i = 0; i < image_count; i++) {
+        pTable->CreateFence(device, &fence_info, nullptr, &overlay.fences[i]);
+        pTable->CreateSemaphore(device, &semaphore_info, nullptr, &overlay.semaphores[i]);
+    }
+    data.overlay.reset(new swapchain_overlay(std::move(overlay)));
+}
 
-template monitor_layer_data *GetLayerDataPtr<monitor_layer_data>(void *data_key,
-                                                                 std::unordered_map<void *, monitor_layer_data *> &data_map);
+static void destroy_swapchain_overlay(monitor_layer_data *my_data, swapchain_overlay &overlay) {
+    VulDeviceDispatchTable *pTable = my_data->device_dispatch_table;
+    VkDevice device = my_data->device;
+    pTable->WaitForFences(device, static_cast<uint32_t>(overlay.fences.size()), overlay.fences.data(), VK_TRUE, UINT64_MAX);
+    for (size_t i = 0; i < overlay.images.size(); i++) {
+        pTable->DestroyFence(device, overlay.fences[i], nullptr);
+        pTable->DestroySemaphore(device, overlay.semaphores[i], nullptr);
+    }
+    if (overlay.pool) pTable->DestroyCommandPool(device, overlay.pool, nullptr);
+    pTable->DestroyBuffer(device, overlay.buffer, nullptr);
+    pTable->FreeMemory(device, overlay.memory, nullptr);
+}
+
+// Record the command buffers that copy the strips of the overlay to the
+// images, for the queues of a family. Returns false if they cannot copy.
+static bool record_swapchain_overlay(monitor_layer_data *my_data, swapchain_overlay &overlay, uint32_t family) {
+    VulDeviceDispatchTable *pTable = my_data->device_dispatch_table;
+    VkDevice device = my_data->device;
+    uint32_t family_count = 0;
+    VulInstanceDispatchTable *pInstanceTable = my_data->instance_data->instance_dispatch_table;
+    pInstanceTable->GetPhysicalDeviceQueueFamilyProperties(my_data->gpu, &family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> families(family_count);
+    pInstanceTable->GetPhysicalDeviceQueueFamilyProperties(my_data->gpu, &family_count, families.data());
+    VkQueueFlags const copy_queue_flags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+    if (family >= family_count || !(families[family].queueFlags & copy_queue_flags)) return false;
+
+    VkCommandPoolCreateInfo pool_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    pool_info.queueFamilyIndex = family;
+    if (pTable->CreateCommandPool(device, &pool_info, nullptr, &overlay.pool) != VK_SUCCESS) return false;
+    overlay.command_buffers.resize(overlay.images.size());
+    VkCommandBufferAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    allocate_info.commandPool = overlay.pool;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandBufferCount = static_cast<uint32_t>(overlay.command_buffers.size());
+    if (pTable->AllocateCommandBuffers(device, &allocate_info, overlay.command_buffers.data()) != VK_SUCCESS) {
+        pTable->DestroyCommandPool(device, overlay.pool, nullptr);
+        overlay.pool = VK_NULL_HANDLE;
+        return false;
+    }
+
+    VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    VkBufferImageCopy region = {};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {overlay.width, overlay.height, 1};
+    for (size_t i = 0; i < overlay.images.size(); i++) {
+        VkCommandBuffer command_buffer = overlay.command_buffers[i];
+        // The command buffers are dispatchable objects created by the layer.
+        if (my_data->pfn_dev_init) {
+            my_data->pfn_dev_init(device, (void *)command_buffer);
+        } else {
+            *((const void **)command_buffer) = *(void **)device;
+        }
+        pTable->BeginCommandBuffer(command_buffer, &begin_info);
+        // The writes of the application are made available by the semaphores
+        // the copy waits for.
+        barrier.image = overlay.images[i];
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        pTable->CmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                                   0, nullptr, 1, &barrier);
+        region.bufferOffset = static_cast<VkDeviceSize>(i) * overlay.width * overlay.height * sizeof(uint32_t);
+        pTable->CmdCopyBufferToImage(command_buffer, overlay.buffer, overlay.images[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
+                                     &region);
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        pTable->CmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+                                   nullptr, 0, nullptr, 1, &barrier);
+        pTable->EndCommandBuffer(command_buffer);
+    }
+    overlay.family = family;
+    return true;
+}
+
+// Copy the overlay to the image presented of the first swapchain of a present
+// that has one, once the semaphores of the present are signaled. Returns the
+// semaphore the present must wait for instead, or null if the overlay is not
+// copied.
+static VkSemaphore submit_overlay(monitor_layer_data *my_data, VkQueue queue, const VkPresentInfoKHR *pPresentInfo) {
+    if (my_data->overlay_text.empty()) return VK_NULL_HANDLE;
+    for (uint32_t i = 0; i < pPresentInfo->swapchainCount; i++) {
+        swapchain_data *data = swapchain_table.find(pPresentInfo->pSwapchains[i]);
+        if (!data || !data->overlay) continue;
+        swapchain_overlay &overlay = *data->overlay;
+
+        uint32_t family;
+        {
+            std::lock_guard<std::mutex> lock(my_data->gpu_timing_mutex);
+            auto queue_family = my_data->queue_families.find(queue);
+            if (queue_family == my_data->queue_families.end()) return VK_NULL_HANDLE;
+            family = queue_family->second;
+        }
+        if (!overlay.pool && !record_swapchain_overlay(my_data, overlay, family)) {
+            destroy_swapchain_overlay(my_data, overlay);
+            data->overlay.reset();
+            return VK_NULL_HANDLE;
+        }
+        if (overlay.family != family) return VK_NULL_HANDLE;
+
+        VulDeviceDispatchTable *pTable = my_data->device_dispatch_table;
+        uint32_t const index = pPresentInfo->pImageIndices[i];
+        if (index >= overlay.images.size()) return VK_NULL_HANDLE;
+        pTable->WaitForFences(my_data->device, 1, &overlay.fences[index], VK_TRUE, UINT64_MAX);
+        if (overlay.text_versions[index] != my_data->overlay_text_version) {
+            draw_overlay_text(overlay.pixels + static_cast<size_t>(index) * overlay.width * overlay.height, overlay.width,
+                              overlay.height, overlay.width, my_data->overlay_text.c_str(), overlay.scale);
+            overlay.text_versions[index] = my_data->overlay_text_version;
+        }
+
+        std::vector<VkPipelineStageFlags> wait_stages(pPresentInfo->waitSemaphoreCount, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submit_info.waitSemaphoreCount = pPresentInfo->waitSemaphoreCount;
+        submit_info.pWaitSemaphores = pPresentInfo->pWaitSemaphores;
+        submit_info.pWaitDstStageMask = wait_stages.data();
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &overlay.command_buffers[index];
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores = &overlay.semaphores[index];
+        pTable->ResetFences(my_data->device, 1, &overlay.fences[index]);
+        if (pTable->QueueSubmit(queue, 1, &submit_info, overlay.fences[index]) != VK_SUCCESS) {
+            // Signal the fence for the next wait.
+            pTable->QueueSubmit(queue, 0, nullptr, overlay.fences[index]);
+            return VK_NULL_HANDLE;
+        }
+        return overlay.semaphores[index];
+    }
+    return VK_NULL_HANDLE;
+}
+
+// Add an extension to those a device is created with, if it is not there
+// already. Returns false if the device does not support it.
+static bool enable_device_extension(VulInstanceDispatchTable *pInstanceTable, VkPhysicalDevice gpu,
+                                    std::vector<const char *> &extensions, const char *name) {
+    if (std::any_of(extensions.begin(), extensions.end(), [name](const char *extension) { return strcmp(extension, name) == 0; })) {
+        return true;
+    }
+    uint32_t count = 0;
+    pInstanceTable->EnumerateDeviceExtensionProperties(gpu, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> properties(count);
+    pInstanceTable->EnumerateDeviceExtensionProperties(gpu, nullptr, &count, properties.data());
+    for (const VkExtensionProperties &extension : properties) {
+        if (strcmp(extension.extensionName, name) == 0) {
+            extensions.push_back(name);
+            return true;
+        }
+    }
+    return false;
+}
 
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice gpu, const VkDeviceCreateInfo *pCreateInfo,
                                               const VkAllocationCallbacks *pAllocator, VkDevice *pDevice) {
@@ -90,7 +1089,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice gpu, const VkDevi
     assert(chain_info->u.pLayerInfo);
     PFN_vkGetInstanceProcAddr fpGetInstanceProcAddr = chain_info->u.pLayerInfo->pfnNextGetInstanceProcAddr;
     PFN_vkGetDeviceProcAddr fpGetDeviceProcAddr = chain_info->u.pLayerInfo->pfnNextGetDeviceProcAddr;
-    PFN_vkCreateDevice fpCreateDevice = (PFN_vkCreateDevice)fpGetInstanceProcAddr(layer_instances.at(gpu), "vkCreateDevice");
+    PFN_vkCreateDevice fpCreateDevice = (PFN_vkCreateDevice)fpGetInstanceProcAddr(layer_instances.find(gpu), "vkCreateDevice");
     if (fpCreateDevice == NULL) {
         return VK_ERROR_INITIALIZATION_FAILED;
     }
@@ -98,12 +1097,42 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice gpu, const VkDevi
     // Advance the link info for the next element on the chain
     chain_info->u.pLayerInfo = chain_info->u.pLayerInfo->pNext;
 
-    VkResult result = fpCreateDevice(gpu, pCreateInfo, pAllocator, pDevice);
+    // The display times are collected with VK_GOOGLE_display_timing, and the
+    // memory budget sampled with VK_EXT_memory_budget, which are enabled if
+    // the device supports them.
+    VulInstanceDispatchTable *pInstanceTable = get_layer_data(get_dispatch_key(gpu))->instance_dispatch_table;
+    VkDeviceCreateInfo create_info = *pCreateInfo;
+    std::vector<const char *> extensions(pCreateInfo->ppEnabledExtensionNames,
+                                         pCreateInfo->ppEnabledExtensionNames + pCreateInfo->enabledExtensionCount);
+    bool display_timing = false;
+    if (display_timing_enabled) {
+        display_timing = enable_device_extension(pInstanceTable, gpu, extensions, VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+        if (!display_timing) {
+            fprintf(stderr, "monitor: VK_GOOGLE_display_timing is not supported, the display times are not collected\n");
+        }
+    }
+    // The budget is read with vkGetPhysicalDeviceMemoryProperties2, of Vulkan
+    // 1.1 or VK_KHR_get_physical_device_properties2.
+    PFN_vkGetPhysicalDeviceMemoryProperties2 get_memory_properties = nullptr;
+    if (memory_budget_frames > 0) {
+        get_memory_properties = pInstanceTable->GetPhysicalDeviceMemoryProperties2
+                                    ? pInstanceTable->GetPhysicalDeviceMemoryProperties2
+                                    : pInstanceTable->GetPhysicalDeviceMemoryProperties2KHR;
+        if (!get_memory_properties ||
+            !enable_device_extension(pInstanceTable, gpu, extensions, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+            fprintf(stderr, "monitor: VK_EXT_memory_budget is not supported, the memory budget is not sampled\n");
+            get_memory_properties = nullptr;
+        }
+    }
+    create_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    create_info.ppEnabledExtensionNames = extensions.data();
+
+    VkResult result = fpCreateDevice(gpu, &create_info, pAllocator, pDevice);
     if (result != VK_SUCCESS) {
         return result;
     }
 
-    monitor_layer_data *my_device_data = GetLayerDataPtr(get_dispatch_key(*pDevice), layer_data_map);
+    monitor_layer_data *my_device_data = get_layer_data(get_dispatch_key(*pDevice));
 
     // Setup device dispatch table
     my_device_data->device_dispatch_table = new VulDeviceDispatchTable;
@@ -118,11 +1147,33 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice gpu, const VkDevi
     }
 
     my_device_data->gpu = gpu;
+    my_device_data->instance_data = get_layer_data(get_dispatch_key(gpu));
     my_device_data->device = *pDevice;
     my_device_data->frame = 0;
     my_device_data->lastFrame = 0;
     my_device_data->fps = 0.0;
-    time(&my_device_data->lastTime);
+    my_device_data->lastTime = std::chrono::steady_clock::now();
+    my_device_data->overlay = overlay_enabled;
+    my_device_data->display_timing = display_timing;
+    my_device_data->submit_stats = submit_stats_enabled;
+
+    if (get_memory_properties) {
+        my_device_data->memory_budget = std::make_unique<memory_budget_sampler>();
+        my_device_data->memory_budget->start(gpu, get_memory_properties);
+        my_device_data->memory_budget->request();
+    }
+
+    if (gpu_timing_enabled) {
+        VkPhysicalDeviceProperties properties;
+        pInstanceTable->GetPhysicalDeviceProperties(gpu, &properties);
+        my_device_data->timestamp_period = properties.limits.timestampPeriod;
+        VkQueryPoolCreateInfo query_pool_info = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        query_pool_info.queryCount = 2 * GPU_TIMING_SLOTS;
+        VkResult pool_result = my_device_data->device_dispatch_table->CreateQueryPool(*pDevice, &query_pool_info, nullptr,
+                                                                                      &my_device_data->timestamp_pool);
+        my_device_data->gpu_timing = pool_result == VK_SUCCESS;
+    }
 
     // Get our WSI hooks in
     VulDeviceDispatchTable *pTable = my_device_data->device_dispatch_table;
@@ -134,16 +1185,14 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice gpu, const VkDevi
 VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(VkInstance instance, uint32_t *pPhysicalDeviceCount,
                                                           VkPhysicalDevice *pPhysicalDevices) {
     dispatch_key key = get_dispatch_key(instance);
-    monitor_layer_data *my_data = GetLayerDataPtr(key, layer_data_map);
+    monitor_layer_data *my_data = get_layer_data(key);
     VulInstanceDispatchTable *pTable = my_data->instance_dispatch_table;
 
     VkResult result = pTable->EnumeratePhysicalDevices(instance, pPhysicalDeviceCount, pPhysicalDevices);
 
     if (pPhysicalDevices != nullptr) {
         for (int i = 0; i < *pPhysicalDeviceCount; ++i) {
-            if (layer_instances.count(pPhysicalDevices[i]) == 0) {
-                layer_instances.insert({pPhysicalDevices[i], instance});
-            }
+            layer_instances.insert(pPhysicalDevices[i], instance);
         }
     }
 
@@ -153,7 +1202,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(VkInstance instance, u
 VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroups(VkInstance instance, uint32_t *pPhysicalDeviceGroupCount,
                                                                VkPhysicalDeviceGroupProperties *pPhysicalDeviceGroupProperties) {
     dispatch_key key = get_dispatch_key(instance);
-    monitor_layer_data *my_data = GetLayerDataPtr(key, layer_data_map);
+    monitor_layer_data *my_data = get_layer_data(key);
     VulInstanceDispatchTable *pTable = my_data->instance_dispatch_table;
 
     VkResult result = pTable->EnumeratePhysicalDeviceGroups(instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
@@ -161,9 +1210,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroups(VkInstance instan
     if (pPhysicalDeviceGroupProperties != nullptr) {
         for (int i = 0; i < *pPhysicalDeviceGroupCount; ++i) {
             for (int j = 0; j < pPhysicalDeviceGroupProperties[i].physicalDeviceCount; ++j) {
-                if (layer_instances.count(pPhysicalDeviceGroupProperties[i].physicalDevices[j]) == 0) {
-                    layer_instances.insert({pPhysicalDeviceGroupProperties[i].physicalDevices[j], instance});
-                }
+                layer_instances.insert(pPhysicalDeviceGroupProperties[i].physicalDevices[j], instance);
             }
         }
     }
@@ -171,14 +1218,151 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroups(VkInstance instan
     return result;
 }
 
+// Add the submit statistics of a queue got, if it has none yet, with the
+// mutex held.
+static void add_queue_submit_stats(monitor_layer_data *my_data, VkQueue queue, uint32_t family) {
+    std::unique_ptr<queue_submit_stats> &stats = my_data->queue_stats[queue];
+    if (stats) return;
+    stats = std::make_unique<queue_submit_stats>();
+    stats->family = family;
+    queue_stats_table.insert(queue, stats.get());
+}
+
+// Add a submit call to the statistics of its queue, with the time it took
+// below the layer.
+static void record_submit(queue_submit_stats &stats, uint32_t batches, uint64_t command_buffers, uint64_t semaphore_waits,
+                          std::chrono::steady_clock::duration cpu_time) {
+    // Only the thread submitting to the queue writes the counters.
+    auto add = [](std::atomic<uint64_t> &counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    };
+    uint64_t const cpu_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(cpu_time).count());
+    add(stats.submits, 1);
+    add(stats.batches, batches);
+    add(stats.command_buffers, command_buffers);
+    add(stats.semaphore_waits, semaphore_waits);
+    add(stats.cpu_ns, cpu_ns);
+    if (cpu_ns > stats.max_cpu_ns.load(std::memory_order_relaxed)) stats.max_cpu_ns.store(cpu_ns, std::memory_order_relaxed);
+}
+
+// The totals of the submit statistics of the queues of a device.
+static submit_totals sum_submit_totals(monitor_layer_data *my_data) {
+    submit_totals totals;
+    std::lock_guard<std::mutex> lock(my_data->gpu_timing_mutex);
+    for (auto &queue : my_data->queue_stats) {
+        totals.submits += queue.second->submits.load(std::memory_order_relaxed);
+        totals.command_buffers += queue.second->command_buffers.load(std::memory_order_relaxed);
+        totals.semaphore_waits += queue.second->semaphore_waits.load(std::memory_order_relaxed);
+        totals.cpu_ns += queue.second->cpu_ns.load(std::memory_order_relaxed);
+    }
+    return totals;
+}
+
+// Print the submit statistics of a queue of a device that is destroyed, over
+// the frames of the device.
+static void print_submit_stats(VkQueue queue, const queue_submit_stats &stats, int frames) {
+    uint64_t const submits = stats.submits.load();
+    if (submits == 0) return;
+    double const per_frame = frames > 0 ? 1.0 / frames : 0.0;
+    double const cpu_us = stats.cpu_ns.load() / 1000.0 / submits;
+    printf(
+        "monitor: Queue %p (family %u), %llu submits of %llu batches over %d frames: %.2f submits, %.2f command buffers, "
+        "%.2f semaphore waits per frame; CPU %.1f us per submit average, %.1f us max\n",
+        reinterpret_cast<void *>(queue), stats.family, static_cast<unsigned long long>(submits),
+        static_cast<unsigned long long>(stats.batches.load()), frames, submits * per_frame,
+        stats.command_buffers.load() * per_frame, stats.semaphore_waits.load() * per_frame, cpu_us,
+        stats.max_cpu_ns.load() / 1000.0);
+}
+
+// Print the most each memory heap of a device that is destroyed was seen to
+// use, and its last budget.
+static void print_memory_budget_stats(memory_budget_sampler &sampler) {
+    std::vector<memory_heap_budget> heaps;
+    sampler.heaps(heaps);
+    for (size_t i = 0; i < heaps.size(); i++) {
+        printf("monitor: Memory heap %zu%s: peak usage %.1f MB, budget %.1f MB\n", i,
+               heaps[i].device_local ? " (device local)" : "", heaps[i].peak_usage / (1024.0 * 1024.0),
+               heaps[i].budget / (1024.0 * 1024.0));
+    }
+}
+
+// Print the statistics of the frame times of a swapchain that is destroyed.
+static void print_frame_time_stats(VkSwapchainKHR swapchain, const frame_time_history &history) {
+    frame_time_stats stats;
+    if (!compute_frame_time_stats(history, stats)) return;
+    printf(
+        "monitor: Swapchain %p, last %zu frames: FPS min %.2f max %.2f, 1%% low %.2f, 0.1%% low %.2f; frame time median %.2f ms, "
+        "99%% %.2f ms, 99.9%% %.2f ms\n",
+        reinterpret_cast<void *>(swapchain), stats.frames, stats.min_fps, stats.max_fps, stats.low_1_percent_fps,
+        stats.low_0_1_percent_fps, stats.median_ms, stats.p99_ms, stats.p99_9_ms);
+}
+
+// Print the present to display latency, missed refresh cycles and pacing
+// jitter of a swapchain that is destroyed.
+static void print_display_timing_stats(VkSwapchainKHR swapchain, const display_timing_history &history) {
+    if (history.frames == 0) return;
+    double const latency_ms = history.latency_frames > 0 ? history.latency_sum_ms / history.latency_frames : 0.0;
+    double const jitter_ms = history.intervals > 1 ? sqrt(history.interval_m2 / (history.intervals - 1)) : 0.0;
+    printf(
+        "monitor: Swapchain %p, %llu frames displayed: latency average %.2f ms, max %.2f ms; %llu missed refresh cycles; "
+        "display interval %.2f ms, jitter %.2f ms\n",
+        reinterpret_cast<void *>(swapchain), static_cast<unsigned long long>(history.frames), latency_ms, history.latency_max_ms,
+        static_cast<unsigned long long>(history.missed_vblanks), history.interval_mean_ms, jitter_ms);
+}
+
 VKAPI_ATTR void VKAPI_CALL vkDestroyDevice(VkDevice device, const VkAllocationCallbacks *pAllocator) {
     dispatch_key key = get_dispatch_key(device);
-    monitor_layer_data *my_data = GetLayerDataPtr(key, layer_data_map);
+    monitor_layer_data *my_data = get_layer_data(key);
     VulDeviceDispatchTable *pTable = my_data->device_dispatch_table;
     pTable->DeviceWaitIdle(device);
+    for (auto &swapchain : my_data->swapchains) {
+        swapchain_table.erase(swapchain.first);
+        telemetry.remove(&swapchain.second->counters);
+        print_frame_time_stats(swapchain.first, swapchain.second->frame_times);
+        if (swapchain.second->display_timing) print_display_timing_stats(swapchain.first, *swapchain.second->display_timing);
+        if (swapchain.second->overlay) destroy_swapchain_overlay(my_data, *swapchain.second->overlay);
+    }
+    for (auto &queue : my_data->queue_families) queue_table.erase(queue.first);
+    if (my_data->memory_budget) {
+        my_data->memory_budget->stop();
+        print_memory_budget_stats(*my_data->memory_budget);
+    }
+    for (auto &queue : my_data->queue_stats) {
+        queue_stats_table.erase(queue.first);
+        print_submit_stats(queue.first, *queue.second, my_data->frame);
+    }
+    if (my_data->gpu_timing) {
+        float gpu_time_ms;
+        read_gpu_frame_times(my_data, gpu_time_ms);
+        if (my_data->gpu_frames_total > 0) {
+            printf("monitor: GPU frame time over %llu frames: average %.2f ms, max %.2f ms\n",
+                   static_cast<unsigned long long>(my_data->gpu_frames_total),
+                   my_data->gpu_time_total_ms / my_data->gpu_frames_total, my_data->gpu_time_max_ms);
+        }
+        for (auto &family_commands : my_data->gpu_commands) {
+            if (family_commands.second.pool) pTable->DestroyCommandPool(device, family_commands.second.pool, nullptr);
+        }
+        pTable->DestroyQueryPool(device, my_data->timestamp_pool, nullptr);
+    }
     pTable->DestroyDevice(device, pAllocator);
     delete pTable;
-    layer_data_map.erase(key);
+    delete layer_data_map.erase(key);
+}
+
+// Whether a boolean setting is true, from its environment variable, or else
+// from the layer settings.
+static bool setting_is_true(const char *env_var, const char *option) {
+    const char *value = getenv(env_var);
+    if (!value || !*value) value = getLayerOption(option);
+    return value && (strcmp(value, "true") == 0 || strcmp(value, "TRUE") == 0 || strcmp(value, "1") == 0);
+}
+
+// The value of a float setting, from its environment variable, or else from
+// the layer settings, 0 if it is not set.
+static float float_setting(const char *env_var, const char *option) {
+    const char *value = getenv(env_var);
+    if (!value || !*value) value = getLayerOption(option);
+    return value && *value ? static_cast<float>(atof(value)) : 0.0f;
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator,
@@ -198,10 +1382,56 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo *pCre
     VkResult result = fpCreateInstance(pCreateInfo, pAllocator, pInstance);
     if (result != VK_SUCCESS) return result;
 
-    monitor_layer_data *my_data = GetLayerDataPtr(get_dispatch_key(*pInstance), layer_data_map);
+    monitor_layer_data *my_data = get_layer_data(get_dispatch_key(*pInstance));
     my_data->instance_dispatch_table = new VulInstanceDispatchTable;
     vulInitInstanceDispatchTable(*pInstance, my_data->instance_dispatch_table, fpGetInstanceProcAddr);
 
+    // The frame log file is set by VK_MONITOR_LOG_FILE, or else by the
+    // lunarg_monitor.log_file setting.
+    instance_count++;
+    const char *log_file = getenv("VK_MONITOR_LOG_FILE");
+    if (!log_file || !*log_file) log_file = getLayerOption("lunarg_monitor.log_file");
+
+    // The GPU time of the frames is measured, the text overlay drawn, and the
+    // display times collected if VK_MONITOR_GPU_TIMING, VK_MONITOR_OVERLAY and
+    // VK_MONITOR_DISPLAY_TIMING, or else the gpu_timing, overlay and
+    // display_timing settings, are true.
+    if (instance_count == 1) {
+        gpu_timing_enabled = setting_is_true("VK_MONITOR_GPU_TIMING", "lunarg_monitor.gpu_timing");
+        overlay_enabled = setting_is_true("VK_MONITOR_OVERLAY", "lunarg_monitor.overlay");
+        display_timing_enabled = setting_is_true("VK_MONITOR_DISPLAY_TIMING", "lunarg_monitor.display_timing");
+        spike_threshold_ms = float_setting("VK_MONITOR_SPIKE_THRESHOLD", "lunarg_monitor.spike_threshold");
+        spike_factor = float_setting("VK_MONITOR_SPIKE_FACTOR", "lunarg_monitor.spike_factor");
+        submit_stats_enabled = setting_is_true("VK_MONITOR_SUBMIT_STATS", "lunarg_monitor.submit_stats");
+        const char *memory_budget = getenv("VK_MONITOR_MEMORY_BUDGET_FRAMES");
+        if (!memory_budget || !*memory_budget) memory_budget = getLayerOption("lunarg_monitor.memory_budget_frames");
+        int const frames = memory_budget && *memory_budget ? atoi(memory_budget) : 0;
+        memory_budget_frames = frames > 0 ? static_cast<uint32_t>(frames) : 0;
+
+        // The CPU time of the threads is sampled every
+        // VK_MONITOR_THREAD_CPU_INTERVAL, or else thread_cpu_interval,
+        // milliseconds, if it is set.
+        const char *cpu_interval = getenv("VK_MONITOR_THREAD_CPU_INTERVAL");
+        if (!cpu_interval || !*cpu_interval) cpu_interval = getLayerOption("lunarg_monitor.thread_cpu_interval");
+        int const interval_ms = cpu_interval && *cpu_interval ? atoi(cpu_interval) : 0;
+        if (interval_ms > 0) thread_cpu.start(static_cast<uint32_t>(interval_ms));
+    }
+    if (log_file && *log_file) {
+        frame_logger.open(log_file, gpu_timing_enabled, memory_budget_frames > 0, thread_cpu.is_running());
+    }
+
+    // The statistics are published to the shared memory named by
+    // VK_MONITOR_TELEMETRY, or else by the lunarg_monitor.telemetry setting,
+    // every lunarg_monitor.telemetry_interval milliseconds.
+    const char *telemetry_name = getenv("VK_MONITOR_TELEMETRY");
+    if (!telemetry_name || !*telemetry_name) telemetry_name = getLayerOption("lunarg_monitor.telemetry");
+    if (telemetry_name && *telemetry_name) {
+        const char *interval = getenv("VK_MONITOR_TELEMETRY_INTERVAL");
+        if (!interval || !*interval) interval = getLayerOption("lunarg_monitor.telemetry_interval");
+        int interval_ms = interval && *interval ? atoi(interval) : 1000;
+        telemetry.open(telemetry_name, interval_ms > 0 ? static_cast<uint32_t>(interval_ms) : 1000);
+    }
+
 #if defined(VK_USE_PLATFORM_XCB_KHR)
     // Initialize connection to null in case vkCreateXcbSurfaceKHR is never called
     my_data->connection = nullptr;
@@ -233,54 +1463,381 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo *pCre
 
 VKAPI_ATTR void VKAPI_CALL vkDestroyInstance(VkInstance instance, const VkAllocationCallbacks *pAllocator) {
     dispatch_key key = get_dispatch_key(instance);
-    monitor_layer_data *my_data = GetLayerDataPtr(key, layer_data_map);
+    monitor_layer_data *my_data = get_layer_data(key);
     VulInstanceDispatchTable *pTable = my_data->instance_dispatch_table;
     pTable->DestroyInstance(instance, pAllocator);
     delete pTable;
-    layer_data_map.erase(key);
+    delete layer_data_map.erase(key);
+    if (--instance_count == 0) {
+        frame_logger.close();
+        telemetry.close();
+        thread_cpu.stop();
+#if defined(VK_USE_PLATFORM_WIN32_KHR) || defined(VK_USE_PLATFORM_XCB_KHR)
+        window_titles.stop();
+#endif
+    }
+}
+
+// Collect the display times of the past presents of a swapchain, and record
+// their latency and pacing.
+static void collect_display_times(monitor_layer_data *my_data, VkSwapchainKHR swapchain, display_timing_history &history) {
+    VkPastPresentationTimingGOOGLE timings[DISPLAY_TIMING_RING];
+    VkResult result = VK_INCOMPLETE;
+    while (result == VK_INCOMPLETE) {
+        uint32_t count = DISPLAY_TIMING_RING;
+        result = my_data->device_dispatch_table->GetPastPresentationTimingGOOGLE(my_data->device, swapchain, &count, timings);
+        if (result != VK_SUCCESS && result != VK_INCOMPLETE) return;
+        for (uint32_t i = 0; i < count; i++) {
+            const VkPastPresentationTimingGOOGLE &timing = timings[i];
+            uint32_t const slot = timing.presentID % DISPLAY_TIMING_RING;
+            if (history.present_ids[slot] == timing.presentID) {
+                double const latency_ms =
+                    (static_cast<int64_t>(timing.actualPresentTime) - static_cast<int64_t>(history.present_times_ns[slot])) / 1.0e6;
+                history.latency_frames++;
+                history.latency_sum_ms += latency_ms;
+                history.latency_max_ms = std::max(history.latency_max_ms, latency_ms);
+            }
+            history.frames++;
+            if (history.last_display_ns != 0 && timing.actualPresentTime > history.last_display_ns) {
+                uint64_t const interval_ns = timing.actualPresentTime - history.last_display_ns;
+                if (history.refresh_duration_ns > 0) {
+                    uint64_t const cycles = (interval_ns + history.refresh_duration_ns / 2) / history.refresh_duration_ns;
+                    if (cycles > 1) history.missed_vblanks += cycles - 1;
+                }
+                double const interval_ms = interval_ns / 1.0e6;
+                history.intervals++;
+                double const delta = interval_ms - history.interval_mean_ms;
+                history.interval_mean_ms += delta / history.intervals;
+                history.interval_m2 += delta * (interval_ms - history.interval_mean_ms);
+            }
+            history.last_display_ns = timing.actualPresentTime;
+        }
+    }
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL vkQueuePresentKHR(VkQueue queue, const VkPresentInfoKHR *pPresentInfo) {
-    monitor_layer_data *my_data = GetLayerDataPtr(get_dispatch_key(queue), layer_data_map);
+    monitor_layer_data *my_data = get_queue_device_data(queue);
+
+    float gpu_time_ms = 0.0f;
+    int64_t gpu_frame = -1;
+    if (my_data->gpu_timing) {
+        submit_gpu_frame_end(my_data, queue);
+        gpu_frame = read_gpu_frame_times(my_data, gpu_time_ms);
+    }
+
+    // The memory budget of the last sample, which the sampler is asked to
+    // update every memory_budget_frames presents.
+    float memory_usage_mb = -1.0f;
+    float memory_budget_mb = -1.0f;
+    if (my_data->memory_budget) {
+        if (my_data->frame % memory_budget_frames == 0) my_data->memory_budget->request();
+        memory_usage_mb = my_data->memory_budget->device_local_usage_mb();
+        memory_budget_mb = my_data->memory_budget->device_local_budget_mb();
+    }
 
-    time_t now;
-    time(&now);
-    float seconds = (float)difftime(now, my_data->lastTime);
+    auto now = std::chrono::steady_clock::now();
+    swapchain_data *first_swapchain = nullptr;
+    bool const detect_spikes = spike_threshold_ms > 0.0f || spike_factor > 0.0f;
+    bool spike_broadcast = false;
+    for (uint32_t i = 0; i < pPresentInfo->swapchainCount; i++) {
+        swapchain_data *data = swapchain_table.find(pPresentInfo->pSwapchains[i]);
+        if (!data) continue;
+        if (!first_swapchain) first_swapchain = data;
+        float const frame_time_ms = record_frame_time(data->frame_times, now);
+        // A present with several swapchains is broadcast once.
+        if (detect_spikes && frame_time_ms > 0.0f && is_spike(data->spikes, frame_time_ms) && !spike_broadcast) {
+            broadcast_spike(static_cast<uint64_t>(my_data->frame), frame_time_ms, pPresentInfo->pSwapchains[i]);
+            spike_broadcast = true;
+        }
+        if (telemetry.is_open()) {
+            if (frame_time_ms > 0.0f) data->counters.record_frame_time(frame_time_ms);
+            if (gpu_frame >= 0) data->counters.gpu_time_ms.store(gpu_time_ms, std::memory_order_relaxed);
+            data->counters.memory_usage_mb.store(memory_usage_mb, std::memory_order_relaxed);
+            data->counters.memory_budget_mb.store(memory_budget_mb, std::memory_order_relaxed);
+        }
+        if (frame_logger.is_open()) {
+            frame_record record;
+            record.frame = static_cast<uint64_t>(my_data->frame);
+            record.timestamp_ns =
+                static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+            record.frame_time_ms = frame_time_ms;
+            record.swapchain = (uint64_t)(pPresentInfo->pSwapchains[i]);
+            record.gpu_frame = gpu_frame;
+            record.gpu_time_ms = gpu_time_ms;
+            record.memory_usage_mb = memory_usage_mb;
+            record.memory_budget_mb = memory_budget_mb;
+            record.cpu_process_percent = thread_cpu.process_busy_percent();
+            record.cpu_busiest_thread_percent = thread_cpu.busiest_thread_percent();
+            record.cpu_busiest_thread = thread_cpu.busiest_thread_id();
+            frame_logger.push(record);
+        }
+    }
+    float seconds = std::chrono::duration<float>(now - my_data->lastTime).count();
 
     if (seconds > 0.5) {
-        char str[TITLE_LENGTH + FPS_LENGTH];
         char fpsstr[FPS_LENGTH];
-        monitor_layer_data *my_instance_data = GetLayerDataPtr(get_dispatch_key(my_data->gpu), layer_data_map);
-        my_data->fps = (my_data->frame - my_data->lastFrame) / seconds;
+        int const frames = my_data->frame - my_data->lastFrame;
+        my_data->fps = frames / seconds;
         my_data->lastFrame = my_data->frame;
         my_data->lastTime = now;
-#if defined(VK_USE_PLATFORM_WIN32_KHR)
-        if (IsWindow(my_instance_data->hwnd) && !my_instance_data->got_title) {
-            GetWindowText(my_instance_data->hwnd, my_instance_data->base_title, TITLE_LENGTH);
-            my_instance_data->got_title = true;
+        // The statistics are of the first swapchain presented.
+        frame_time_stats stats;
+        bool const have_stats = first_swapchain && compute_frame_time_stats(first_swapchain->frame_times, stats);
+        if (have_stats) {
+            snprintf(fpsstr, FPS_LENGTH,
+                     "   FPS = %.2f (min %.2f, max %.2f, 1%% low %.2f, 0.1%% low %.2f)   %.2f ms (99%% %.2f ms)", my_data->fps,
+                     stats.min_fps, stats.max_fps, stats.low_1_percent_fps, stats.low_0_1_percent_fps, stats.median_ms,
+                     stats.p99_ms);
+        } else {
+            snprintf(fpsstr, FPS_LENGTH, "   FPS = %.2f", my_data->fps);
         }
+        std::string text = fpsstr;
+        if (my_data->gpu_timing) {
+            {
+                std::lock_guard<std::mutex> lock(my_data->gpu_timing_mutex);
+                if (my_data->gpu_frames > 0) my_data->gpu_time_ms = my_data->gpu_time_sum_ms / my_data->gpu_frames;
+                my_data->gpu_time_sum_ms = 0.0;
+                my_data->gpu_frames = 0;
+            }
+            snprintf(fpsstr, FPS_LENGTH, "   GPU %.2f ms", my_data->gpu_time_ms);
+            text += fpsstr;
+        }
+        if (my_data->submit_stats && frames > 0) {
+            // The submits of all the queues of the device since the last
+            // update, per frame.
+            submit_totals const totals = sum_submit_totals(my_data);
+            submit_totals &last = my_data->title_submit_totals;
+            uint64_t const submits = totals.submits - last.submits;
+            snprintf(fpsstr, FPS_LENGTH, "   Submits %.1f/frame (%.1f CBs, %.1f waits), %.1f us each",
+                     static_cast<double>(submits) / frames,
+                     static_cast<double>(totals.command_buffers - last.command_buffers) / frames,
+                     static_cast<double>(totals.semaphore_waits - last.semaphore_waits) / frames,
+                     submits > 0 ? (totals.cpu_ns - last.cpu_ns) / 1000.0 / submits : 0.0);
+            text += fpsstr;
+            last = totals;
+        }
+        std::vector<memory_heap_budget> heaps;
+        if (my_data->memory_budget && my_data->memory_budget->heaps(heaps)) {
+            // The usage and budget of each heap, the video memory first.
+            text += "   Memory";
+            for (int device_local = 1; device_local >= 0; device_local--) {
+                for (const memory_heap_budget &heap : heaps) {
+                    if (heap.device_local != (device_local == 1)) continue;
+                    snprintf(fpsstr, FPS_LENGTH, " %.0f/%.0f MB%s", heap.usage / (1024.0 * 1024.0),
+                             heap.budget / (1024.0 * 1024.0), heap.device_local ? " VRAM" : "");
+                    text += fpsstr;
+                }
+            }
+        }
+        if (my_data->overlay) {
+            // The overlay is shorter, to fit small swapchains.
+            char overlay_text[OVERLAY_LENGTH + 1];
+            int length = have_stats ? snprintf(overlay_text, sizeof(overlay_text), "FPS %.1f %.2f MS 1%% %.1f", my_data->fps,
+                                               stats.median_ms, stats.low_1_percent_fps)
+                                    : snprintf(overlay_text, sizeof(overlay_text), "FPS %.1f", my_data->fps);
+            if (my_data->gpu_timing && length >= 0 && length < OVERLAY_LENGTH) {
+                length += snprintf(overlay_text + length, sizeof(overlay_text) - length, " GPU %.2f MS", my_data->gpu_time_ms);
+            }
+            // The video memory only if it fits whole.
+            char memory_text[OVERLAY_LENGTH + 1];
+            if (memory_usage_mb >= 0.0f && length >= 0 &&
+                length + snprintf(memory_text, sizeof(memory_text), " MEM %.0f/%.0f", memory_usage_mb, memory_budget_mb) <=
+                    OVERLAY_LENGTH) {
+                strcat(overlay_text, memory_text);
+            }
+            my_data->overlay_text = overlay_text;
+            my_data->overlay_text_version++;
+        }
+#if defined(VK_USE_PLATFORM_WIN32_KHR) || defined(VK_USE_PLATFORM_XCB_KHR)
+        monitor_layer_data *my_instance_data = my_data->instance_data;
 #endif
-        sprintf(fpsstr, "   FPS = %.2f", my_data->fps);
-        strcpy(str, my_instance_data->base_title);
-        strcat(str, fpsstr);
 #if defined(VK_USE_PLATFORM_WIN32_KHR)
-        if (IsWindow(my_instance_data->hwnd)) {
-            SetWindowText(my_instance_data->hwnd, str);
-        }
+        window_title title;
+        title.hwnd = my_instance_data->hwnd;
+        title.text = std::move(text);
+        window_titles.set(std::move(title));
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
         if (xcb.xcbLib && my_instance_data->xcb_fps && my_instance_data->connection) {
-            xcb.change_property(my_instance_data->connection, XCB_PROP_MODE_REPLACE, my_instance_data->xcb_window, XCB_ATOM_WM_NAME,
-                                XCB_ATOM_STRING, 8, strlen(str), str);
-            xcb.flush(my_instance_data->connection);
+            window_title title;
+            title.connection = my_instance_data->connection;
+            title.window = my_instance_data->xcb_window;
+            title.base_title = my_instance_data->base_title;
+            title.text = std::move(text);
+            window_titles.set(std::move(title));
         }
 #endif
     }
     my_data->frame++;
 
-    VkResult result = my_data->pfnQueuePresentKHR(queue, pPresentInfo);
+    VkPresentInfoKHR present_info = *pPresentInfo;
+    VkSemaphore overlay_semaphore = my_data->overlay ? submit_overlay(my_data, queue, pPresentInfo) : VK_NULL_HANDLE;
+    if (overlay_semaphore != VK_NULL_HANDLE) {
+        present_info.waitSemaphoreCount = 1;
+        present_info.pWaitSemaphores = &overlay_semaphore;
+    }
+
+    // The presents are given IDs for their display times to be reported,
+    // unless the application gives them its own.
+    std::vector<VkPresentTimeGOOGLE> present_times;
+    VkPresentTimesInfoGOOGLE present_times_info = {VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE};
+    bool has_present_times = false;
+    for (auto next = reinterpret_cast<const VkBaseInStructure *>(pPresentInfo->pNext); next; next = next->pNext) {
+        if (next->sType == VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE) has_present_times = true;
+    }
+    if (my_data->display_timing && !has_present_times) {
+        uint64_t const now_ns =
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+        present_times.resize(pPresentInfo->swapchainCount);
+        for (uint32_t i = 0; i < pPresentInfo->swapchainCount; i++) {
+            swapchain_data *data = swapchain_table.find(pPresentInfo->pSwapchains[i]);
+            if (!data || !data->display_timing) continue;
+            display_timing_history &history = *data->display_timing;
+            collect_display_times(my_data, pPresentInfo->pSwapchains[i], history);
+            uint32_t const present_id = history.next_present_id++;
+            history.present_ids[present_id % DISPLAY_TIMING_RING] = present_id;
+            history.present_times_ns[present_id % DISPLAY_TIMING_RING] = now_ns;
+            present_times[i].presentID = present_id;
+        }
+        present_times_info.swapchainCount = pPresentInfo->swapchainCount;
+        present_times_info.pTimes = present_times.data();
+        present_times_info.pNext = present_info.pNext;
+        present_info.pNext = &present_times_info;
+    }
+
+    VkResult result = my_data->pfnQueuePresentKHR(queue, &present_info);
+    return result;
+}
+
+// Whether the overlay can be copied to the images of a swapchain, which the
+// surface must allow.
+static bool swapchain_can_have_overlay(monitor_layer_data *my_data, const VkSwapchainCreateInfoKHR *pCreateInfo) {
+    if (!my_data->overlay || !overlay_supports_format(pCreateInfo->imageFormat)) return false;
+    VkSurfaceCapabilitiesKHR capabilities;
+    VulInstanceDispatchTable *pInstanceTable = my_data->instance_data->instance_dispatch_table;
+    return pInstanceTable->GetPhysicalDeviceSurfaceCapabilitiesKHR(my_data->gpu, pCreateInfo->surface, &capabilities) ==
+               VK_SUCCESS &&
+           (capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateSwapchainKHR(VkDevice device, const VkSwapchainCreateInfoKHR *pCreateInfo,
+                                                    const VkAllocationCallbacks *pAllocator, VkSwapchainKHR *pSwapchain) {
+    monitor_layer_data *my_data = get_layer_data(get_dispatch_key(device));
+    VkSwapchainCreateInfoKHR create_info = *pCreateInfo;
+    bool const overlay = swapchain_can_have_overlay(my_data, pCreateInfo);
+    if (overlay) create_info.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    VkResult result = my_data->device_dispatch_table->CreateSwapchainKHR(device, &create_info, pAllocator, pSwapchain);
+    if (result != VK_SUCCESS) return result;
+
+    std::unique_ptr<swapchain_data> data(new swapchain_data);
+    if (overlay) create_swapchain_overlay(my_data, *pSwapchain, *data, &create_info);
+    if (my_data->display_timing) {
+        data->display_timing.reset(new display_timing_history);
+        VkRefreshCycleDurationGOOGLE refresh_cycle = {};
+        if (my_data->device_dispatch_table->GetRefreshCycleDurationGOOGLE(device, *pSwapchain, &refresh_cycle) == VK_SUCCESS) {
+            data->display_timing->refresh_duration_ns = refresh_cycle.refreshDuration;
+        }
+    }
+    data->counters.swapchain = (uint64_t)(*pSwapchain);
+    telemetry.add(&data->counters);
+    swapchain_table.insert(*pSwapchain, data.get());
+    std::lock_guard<std::mutex> lock(my_data->swapchains_mutex);
+    my_data->swapchains[*pSwapchain] = std::move(data);
     return result;
 }
 
+VKAPI_ATTR void VKAPI_CALL vkDestroySwapchainKHR(VkDevice device, VkSwapchainKHR swapchain,
+                                                 const VkAllocationCallbacks *pAllocator) {
+    monitor_layer_data *my_data = get_layer_data(get_dispatch_key(device));
+#if defined(VK_USE_PLATFORM_WIN32_KHR) || defined(VK_USE_PLATFORM_XCB_KHR)
+    // The window of the swapchain may be destroyed next.
+    window_titles.wait_idle();
+#endif
+    std::unique_ptr<swapchain_data> data;
+    {
+        std::lock_guard<std::mutex> lock(my_data->swapchains_mutex);
+        auto it = my_data->swapchains.find(swapchain);
+        if (it != my_data->swapchains.end()) {
+            data = std::move(it->second);
+            my_data->swapchains.erase(it);
+        }
+    }
+    if (data) {
+        swapchain_table.erase(swapchain);
+        telemetry.remove(&data->counters);
+        print_frame_time_stats(swapchain, data->frame_times);
+        if (data->display_timing) print_display_timing_stats(swapchain, *data->display_timing);
+        if (data->overlay) destroy_swapchain_overlay(my_data, *data->overlay);
+    }
+    my_data->device_dispatch_table->DestroySwapchainKHR(device, swapchain, pAllocator);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue(VkDevice device, uint32_t queueFamilyIndex, uint32_t queueIndex, VkQueue *pQueue) {
+    monitor_layer_data *my_data = get_layer_data(get_dispatch_key(device));
+    my_data->device_dispatch_table->GetDeviceQueue(device, queueFamilyIndex, queueIndex, pQueue);
+    queue_table.insert(*pQueue, my_data);
+    std::lock_guard<std::mutex> lock(my_data->gpu_timing_mutex);
+    my_data->queue_families[*pQueue] = queueFamilyIndex;
+    if (my_data->submit_stats) add_queue_submit_stats(my_data, *pQueue, queueFamilyIndex);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue2(VkDevice device, const VkDeviceQueueInfo2 *pQueueInfo, VkQueue *pQueue) {
+    monitor_layer_data *my_data = get_layer_data(get_dispatch_key(device));
+    my_data->device_dispatch_table->GetDeviceQueue2(device, pQueueInfo, pQueue);
+    queue_table.insert(*pQueue, my_data);
+    std::lock_guard<std::mutex> lock(my_data->gpu_timing_mutex);
+    my_data->queue_families[*pQueue] = pQueueInfo->queueFamilyIndex;
+    if (my_data->submit_stats) add_queue_submit_stats(my_data, *pQueue, pQueueInfo->queueFamilyIndex);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueueSubmit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo *pSubmits, VkFence fence) {
+    monitor_layer_data *my_data = get_queue_device_data(queue);
+    queue_submit_stats *stats = my_data->submit_stats ? queue_stats_table.find(queue) : nullptr;
+    if (!stats) {
+        if (my_data->gpu_timing && submitCount > 0) return submit_gpu_frame_begin(my_data, queue, submitCount, pSubmits, fence);
+        return my_data->device_dispatch_table->QueueSubmit(queue, submitCount, pSubmits, fence);
+    }
+    uint64_t command_buffers = 0;
+    uint64_t semaphore_waits = 0;
+    for (uint32_t i = 0; i < submitCount; i++) {
+        command_buffers += pSubmits[i].commandBufferCount;
+        semaphore_waits += pSubmits[i].waitSemaphoreCount;
+    }
+    auto const start = std::chrono::steady_clock::now();
+    VkResult result = my_data->gpu_timing && submitCount > 0
+                          ? submit_gpu_frame_begin(my_data, queue, submitCount, pSubmits, fence)
+                          : my_data->device_dispatch_table->QueueSubmit(queue, submitCount, pSubmits, fence);
+    record_submit(*stats, submitCount, command_buffers, semaphore_waits, std::chrono::steady_clock::now() - start);
+    return result;
+}
+
+// The submits of VkSubmitInfo2 are counted, but not timed on the GPU.
+static VkResult queue_submit2(VkQueue queue, uint32_t submitCount, const VkSubmitInfo2 *pSubmits, VkFence fence,
+                              PFN_vkQueueSubmit2 next) {
+    monitor_layer_data *my_data = get_queue_device_data(queue);
+    queue_submit_stats *stats = my_data->submit_stats ? queue_stats_table.find(queue) : nullptr;
+    if (!stats) return next(queue, submitCount, pSubmits, fence);
+    uint64_t command_buffers = 0;
+    uint64_t semaphore_waits = 0;
+    for (uint32_t i = 0; i < submitCount; i++) {
+        command_buffers += pSubmits[i].commandBufferInfoCount;
+        semaphore_waits += pSubmits[i].waitSemaphoreInfoCount;
+    }
+    auto const start = std::chrono::steady_clock::now();
+    VkResult result = next(queue, submitCount, pSubmits, fence);
+    record_submit(*stats, submitCount, command_buffers, semaphore_waits, std::chrono::steady_clock::now() - start);
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueueSubmit2(VkQueue queue, uint32_t submitCount, const VkSubmitInfo2 *pSubmits, VkFence fence) {
+    return queue_submit2(queue, submitCount, pSubmits, fence, get_queue_device_data(queue)->device_dispatch_table->QueueSubmit2);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueueSubmit2KHR(VkQueue queue, uint32_t submitCount, const VkSubmitInfo2 *pSubmits,
+                                                 VkFence fence) {
+    return queue_submit2(queue, submitCount, pSubmits, fence,
+                         get_queue_device_data(queue)->device_dispatch_table->QueueSubmit2KHR);
+}
+
 VKAPI_ATTR VkResult VKAPI_CALL vkGetPhysicalDeviceToolPropertiesEXT(VkPhysicalDevice physicalDevice, uint32_t *pToolCount,
                                                                     VkPhysicalDeviceToolPropertiesEXT *pToolProperties) {
     static const VkPhysicalDeviceToolPropertiesEXT monitor_layer_tool_props = {
@@ -299,7 +1856,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkGetPhysicalDeviceToolPropertiesEXT(VkPhysicalDe
         (*pToolCount)--;
     }
 
-    monitor_layer_data *my_data = GetLayerDataPtr(get_dispatch_key(physicalDevice), layer_data_map);
+    monitor_layer_data *my_data = get_layer_data(get_dispatch_key(physicalDevice));
     VkResult result =
         my_data->instance_dispatch_table->GetPhysicalDeviceToolPropertiesEXT(physicalDevice, pToolCount, pToolProperties);
 
@@ -315,7 +1872,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkGetPhysicalDeviceToolPropertiesEXT(VkPhysicalDe
 #if defined(VK_USE_PLATFORM_WIN32_KHR)
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateWin32SurfaceKHR(VkInstance instance, const VkWin32SurfaceCreateInfoKHR *pCreateInfo,
                                                        const VkAllocationCallbacks *pAllocator, VkSurfaceKHR *pSurface) {
-    monitor_layer_data *my_data = GetLayerDataPtr(get_dispatch_key(instance), layer_data_map);
+    monitor_layer_data *my_data = get_layer_data(get_dispatch_key(instance));
     my_data->hwnd = pCreateInfo->hwnd;
 
     VkResult result = my_data->instance_dispatch_table->CreateWin32SurfaceKHR(instance, pCreateInfo, pAllocator, pSurface);
@@ -330,7 +1887,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateXcbSurfaceKHR(VkInstance instance, const
     xcb_atom_t property = XCB_ATOM_WM_NAME;
     xcb_atom_t type = XCB_ATOM_STRING;
 
-    monitor_layer_data *my_data = GetLayerDataPtr(get_dispatch_key(instance), layer_data_map);
+    monitor_layer_data *my_data = get_layer_data(get_dispatch_key(instance));
 
     if (!xcb.xcbLib and !xcbErrorPrinted) {
         fprintf(stderr, "Monitor layer libxcb.so load failure, will not be able to display frame rate\n");
@@ -367,20 +1924,64 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateXcbSurfaceKHR(VkInstance instance, const
 #define EXPORT_FUNCTION
 #endif
 
+// The functions the other layers subscribe to the spikes with, described in
+// monitor_spike.h.
+extern "C" EXPORT_FUNCTION bool vkLayerMonitorSubscribeSpikes(monitor_spike_callback callback, void *user_data) {
+    std::lock_guard<std::mutex> lock(spike_subscribers_mutex);
+    if (spike_subscriber_count == MONITOR_SPIKE_SUBSCRIBERS) return false;
+    spike_subscribers[spike_subscriber_count++] = {callback, user_data};
+    return true;
+}
+
+extern "C" EXPORT_FUNCTION void vkLayerMonitorUnsubscribeSpikes(monitor_spike_callback callback, void *user_data) {
+    std::lock_guard<std::mutex> lock(spike_subscribers_mutex);
+    for (uint32_t i = 0; i < spike_subscriber_count; i++) {
+        if (spike_subscribers[i].callback == callback && spike_subscribers[i].user_data == user_data) {
+            spike_subscribers[i] = spike_subscribers[--spike_subscriber_count];
+            return;
+        }
+    }
+}
+
 EXPORT_FUNCTION VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkDevice dev, const char *funcName) {
-#define ADD_HOOK(fn) \
-    if (!strncmp(#fn, funcName, sizeof(#fn))) return (PFN_vkVoidFunction)fn
+#define ADD_HOOK(fn) {#fn, (PFN_vkVoidFunction)fn}
 
-    ADD_HOOK(vkGetDeviceProcAddr);
-    ADD_HOOK(vkDestroyDevice);
-    ADD_HOOK(vkQueuePresentKHR);
+    // Hashed once, loaders such as volk call vkGetDeviceProcAddr for every device entrypoint
+    static const std::unordered_map<std::string_view, PFN_vkVoidFunction> hooks = {
+        ADD_HOOK(vkGetDeviceProcAddr),
+        ADD_HOOK(vkDestroyDevice),
+        ADD_HOOK(vkQueuePresentKHR),
+        ADD_HOOK(vkCreateSwapchainKHR),
+        ADD_HOOK(vkDestroySwapchainKHR),
+        ADD_HOOK(vkGetDeviceQueue),
+        ADD_HOOK(vkGetDeviceQueue2),
+        ADD_HOOK(vkQueueSubmit),
+        ADD_HOOK(vkQueueSubmit2),
+        ADD_HOOK(vkQueueSubmit2KHR),
+    };
 #undef ADD_HOOK
 
+    // The submits are only hooked for the devices that count or time them,
+    // so that the submits of the other devices go to the next layer without
+    // passing through this one. Those of VkSubmitInfo2 are only hooked if the
+    // device has them.
+    std::string_view const name = funcName;
+    bool const submit = name == "vkQueueSubmit";
+    bool const submit2 = name == "vkQueueSubmit2" || name == "vkQueueSubmit2KHR";
+    auto hook = hooks.find(name);
+    if (hook != hooks.end() && !((submit || submit2) && dev)) return hook->second;
+
     if (dev == NULL) return NULL;
 
     monitor_layer_data *dev_data;
-    dev_data = GetLayerDataPtr(get_dispatch_key(dev), layer_data_map);
+    dev_data = get_layer_data(get_dispatch_key(dev));
     VulDeviceDispatchTable *pTable = dev_data->device_dispatch_table;
+    if (submit && (dev_data->submit_stats || dev_data->gpu_timing)) return hook->second;
+    if (submit2) {
+        bool const supported = name == "vkQueueSubmit2" ? pTable->QueueSubmit2 != NULL : pTable->QueueSubmit2KHR != NULL;
+        if (!supported) return NULL;
+        if (dev_data->submit_stats) return hook->second;
+    }
 
     if (pTable->GetDeviceProcAddr == NULL) return NULL;
     return pTable->GetDeviceProcAddr(dev, funcName);
@@ -407,7 +2008,7 @@ EXPORT_FUNCTION VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(V
     if (instance == NULL) return NULL;
 
     monitor_layer_data *instance_data;
-    instance_data = GetLayerDataPtr(get_dispatch_key(instance), layer_data_map);
+    instance_data = get_layer_data(get_dispatch_key(instance));
     VulInstanceDispatchTable *pTable = instance_data->instance_dispatch_table;
 
     if (pTable->GetInstanceProcAddr == NULL) return NULL;
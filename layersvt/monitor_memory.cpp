@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2016-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "monitor_memory.h"
+
+#include <algorithm>
+
+void memory_budget_sampler::start(VkPhysicalDevice physical_device, PFN_vkGetPhysicalDeviceMemoryProperties2 get_properties) {
+    if (thread.joinable()) return;
+    gpu = physical_device;
+    get_memory_properties = get_properties;
+    stopping = false;
+    thread = std::thread(&memory_budget_sampler::run, this);
+}
+
+void memory_budget_sampler::stop() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        wake.notify_one();
+    }
+    thread.join();
+}
+
+void memory_budget_sampler::request() {
+    std::lock_guard<std::mutex> lock(mutex);
+    requested = true;
+    wake.notify_one();
+}
+
+bool memory_budget_sampler::heaps(std::vector<memory_heap_budget> &heaps) {
+    std::lock_guard<std::mutex> lock(mutex);
+    heaps = last_heaps;
+    return !heaps.empty();
+}
+
+void memory_budget_sampler::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return requested || stopping; });
+        if (stopping) return;
+        requested = false;
+        // The driver is queried without the mutex, for the presents not to
+        // wait on it.
+        lock.unlock();
+        sample();
+        lock.lock();
+    }
+}
+
+void memory_budget_sampler::sample() {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT};
+    VkPhysicalDeviceMemoryProperties2 properties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2, &budget};
+    get_memory_properties(gpu, &properties);
+
+    uint32_t const count = std::min(properties.memoryProperties.memoryHeapCount, static_cast<uint32_t>(VK_MAX_MEMORY_HEAPS));
+    VkDeviceSize local_usage = 0;
+    VkDeviceSize local_budget = 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    last_heaps.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        memory_heap_budget &heap = last_heaps[i];
+        heap.usage = budget.heapUsage[i];
+        heap.budget = budget.heapBudget[i];
+        heap.peak_usage = std::max(heap.peak_usage, heap.usage);
+        heap.device_local = (properties.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        if (heap.device_local) {
+            local_usage += heap.usage;
+            local_budget += heap.budget;
+        }
+    }
+    local_usage_mb.store(static_cast<float>(local_usage / (1024.0 * 1024.0)), std::memory_order_relaxed);
+    local_budget_mb.store(static_cast<float>(local_budget / (1024.0 * 1024.0)), std::memory_order_relaxed);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// The usage and budget of a memory heap of a device, as reported by
+// VK_EXT_memory_budget, and the most it was seen to use, in bytes.
+struct memory_heap_budget {
+    VkDeviceSize usage = 0;
+    VkDeviceSize budget = 0;
+    VkDeviceSize peak_usage = 0;
+    bool device_local = false;
+};
+
+// Samples the memory budget of a device on a thread of its own when the
+// presents request it, so that the presents never wait on the driver for it.
+// The totals of the device local heaps, the video memory, are also kept in
+// atomics, for the presents to read each frame.
+class memory_budget_sampler {
+   public:
+    ~memory_budget_sampler() { stop(); }
+
+    void start(VkPhysicalDevice gpu, PFN_vkGetPhysicalDeviceMemoryProperties2 get_memory_properties);
+    void stop();
+
+    // Wake the thread to take a sample.
+    void request();
+
+    // The heaps of the last sample. Returns false if there is none yet.
+    bool heaps(std::vector<memory_heap_budget> &heaps);
+
+    // In megabytes, or -1 before the first sample.
+    float device_local_usage_mb() const { return local_usage_mb.load(std::memory_order_relaxed); }
+    float device_local_budget_mb() const { return local_budget_mb.load(std::memory_order_relaxed); }
+
+   private:
+    void run();
+    void sample();
+
+    VkPhysicalDevice gpu = VK_NULL_HANDLE;
+    PFN_vkGetPhysicalDeviceMemoryProperties2 get_memory_properties = nullptr;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool requested = false;
+    bool stopping = false;
+    std::thread thread;
+    std::vector<memory_heap_budget> last_heaps;  // guarded by the mutex
+    std::atomic<float> local_usage_mb{-1.0f};
+    std::atomic<float> local_budget_mb{-1.0f};
+};
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// The text overlay drawn in the swapchain images, a strip of pixels in which
+// the text is drawn on the CPU with a 5x7 pixel font, then copied to the top
+// left corner of the images. The pixels are 32-bit, of the 8-bit RGBA or BGRA
+// formats, in which opaque white and black are the same.
+
+// The size of the cells of the characters, in pixels before scaling.
+#define OVERLAY_CELL_WIDTH 6
+#define OVERLAY_CELL_HEIGHT 9
+#define OVERLAY_MARGIN 4
+
+// The width and height of the strip of a line of text of length characters,
+// scaled up by scale.
+inline uint32_t overlay_width(uint32_t length, uint32_t scale) {
+    return (length * OVERLAY_CELL_WIDTH + 2 * OVERLAY_MARGIN) * scale;
+}
+inline uint32_t overlay_height(uint32_t scale) { return (OVERLAY_CELL_HEIGHT + 2 * OVERLAY_MARGIN) * scale; }
+
+// Fill a strip of width by height pixels, rows of stride pixels apart, with
+// black, and draw a line of text on it in white. Lowercase letters are drawn
+// in uppercase, and characters the font does not have as spaces. The text
+// is cut at the right edge of the strip.
+void draw_overlay_text(uint32_t *pixels, uint32_t width, uint32_t height, uint32_t stride, const char *text, uint32_t scale);
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif !defined(__APPLE__)
+#include <dlfcn.h>
+#endif
+
+// The frames the monitor layer detects as spikes, slower than its
+// spike_threshold setting or than spike_factor times the median of the frames
+// before them, are broadcast to the other layers of the process that
+// subscribe to them, so that they can save what they hold of the spike.
+//
+// The monitor layer exports the functions a layer subscribes and
+// unsubscribes with, which the layer finds with find_monitor_spike_function
+// once the monitor layer is loaded, which it is by the time any layer's
+// vkCreateInstance is called. A subscriber must unsubscribe before it is
+// unloaded, from its vkDestroyInstance, since the monitor layer may outlive
+// it.
+//
+// The callbacks are called from the present of the spike, by the thread
+// making it, before the monitor layer passes the present down. The layers
+// below the monitor layer see the present of the spike after their callback
+// was called, the layers above it before. The callbacks must return quickly,
+// and leave any I/O to later.
+
+// The frame is the number of presents of the device of the spike before it.
+typedef void (*monitor_spike_callback)(void *user_data, uint64_t frame, float frame_time_ms);
+typedef bool (*monitor_subscribe_spikes_function)(monitor_spike_callback callback, void *user_data);
+typedef void (*monitor_unsubscribe_spikes_function)(monitor_spike_callback callback, void *user_data);
+
+#define MONITOR_SUBSCRIBE_SPIKES "vkLayerMonitorSubscribeSpikes"
+#define MONITOR_UNSUBSCRIBE_SPIKES "vkLayerMonitorUnsubscribeSpikes"
+
+// The most subscribers at a time.
+#define MONITOR_SPIKE_SUBSCRIBERS 8
+
+// A function exported by the monitor layer, or null if it is not loaded. It
+// is looked up without loading the layer.
+static inline void *find_monitor_spike_function(const char *name) {
+#if defined(_WIN32)
+    HMODULE const library = GetModuleHandleA("VkLayer_monitor.dll");
+    return library ? reinterpret_cast<void *>(GetProcAddress(library, name)) : nullptr;
+#elif defined(__APPLE__)
+    (void)name;
+    return nullptr;
+#else
+    void *const library = dlopen("libVkLayer_monitor.so", RTLD_NOW | RTLD_NOLOAD);
+    if (!library) return nullptr;
+    void *const function = dlsym(library, name);
+    // Only drops the reference taken by the dlopen above.
+    dlclose(library);
+    return function;
+#endif
+}
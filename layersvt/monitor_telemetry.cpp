@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2016-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "monitor_telemetry.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <new>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif !defined(ANDROID)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static uint32_t bucket_of(float frame_time_ms) {
+    if (!(frame_time_ms >= 0.0f)) return 0;
+    if (frame_time_ms < 100.0f) return static_cast<uint32_t>(frame_time_ms * 10.0f);
+    return std::min(1000u + static_cast<uint32_t>((frame_time_ms - 100.0f) / 100.0f), TELEMETRY_BUCKETS - 1u);
+}
+
+// The frame time in the middle of a bucket.
+static float bucket_frame_time(uint32_t bucket) {
+    if (bucket < 1000) return (bucket + 0.5f) * 0.1f;
+    return 100.0f + (bucket - 1000 + 0.5f) * 100.0f;
+}
+
+void telemetry_counters::record_frame_time(float frame_time_ms) {
+    frame_time_buckets[bucket_of(frame_time_ms)].fetch_add(1, std::memory_order_relaxed);
+    frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+// The name of the shared memory object. POSIX names start with a slash,
+// which is added if the name given has none.
+static std::string shared_memory_name(const char *name) {
+#if defined(_WIN32) || defined(ANDROID)
+    return name;
+#else
+    return name[0] == '/' ? std::string(name) : "/" + std::string(name);
+#endif
+}
+
+void telemetry_exporter::open(const char *name, uint32_t interval) {
+    if (mapping) return;
+    object_name = shared_memory_name(name);
+    interval_ms = std::max(interval, 1u);
+    mapping_size = MONITOR_TELEMETRY_HEADER_SIZE + MONITOR_TELEMETRY_SLOT_SIZE * MONITOR_TELEMETRY_SLOTS;
+    uint32_t process_id = 0;
+
+#if defined(ANDROID)
+    fprintf(stderr, "monitor: Shared memory telemetry is not supported on Android: %s\n", name);
+    return;
+#elif defined(_WIN32)
+    mapping_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, static_cast<DWORD>(mapping_size),
+                                        object_name.c_str());
+    if (!mapping_handle) {
+        fprintf(stderr, "monitor: Failed to create shared memory: %s\n", name);
+        return;
+    }
+    mapping = static_cast<uint8_t *>(MapViewOfFile(mapping_handle, FILE_MAP_ALL_ACCESS, 0, 0, mapping_size));
+    if (!mapping) {
+        CloseHandle(mapping_handle);
+        mapping_handle = nullptr;
+        fprintf(stderr, "monitor: Failed to map shared memory: %s\n", name);
+        return;
+    }
+    process_id = static_cast<uint32_t>(GetCurrentProcessId());
+#else
+    int fd = shm_open(object_name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "monitor: Failed to create shared memory: %s\n", object_name.c_str());
+        return;
+    }
+    if (ftruncate(fd, mapping_size) != 0) {
+        ::close(fd);
+        fprintf(stderr, "monitor: Failed to size shared memory: %s\n", object_name.c_str());
+        return;
+    }
+    void *address = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        fprintf(stderr, "monitor: Failed to map shared memory: %s\n", object_name.c_str());
+        return;
+    }
+    mapping = static_cast<uint8_t *>(address);
+    process_id = static_cast<uint32_t>(getpid());
+#endif
+
+    // The magic is written last, so that a reader finding it finds the rest.
+    auto header = new (mapping) monitor_telemetry_header;
+    header->version = MONITOR_TELEMETRY_VERSION;
+    header->slot_count = MONITOR_TELEMETRY_SLOTS;
+    header->slot_size = MONITOR_TELEMETRY_SLOT_SIZE;
+    header->process_id = process_id;
+    header->interval_ms = interval_ms;
+    header->updates.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < MONITOR_TELEMETRY_SLOTS; i++) {
+        uint8_t *address = mapping + MONITOR_TELEMETRY_HEADER_SIZE + MONITOR_TELEMETRY_SLOT_SIZE * i;
+        auto telemetry_slot = new (address) monitor_telemetry_slot;
+        telemetry_slot->sequence.store(0, std::memory_order_relaxed);
+        telemetry_slot->swapchain = 0;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = MONITOR_TELEMETRY_MAGIC;
+    printf("monitor: Publishing telemetry to shared memory: %s\n", object_name.c_str());
+
+    stopping = false;
+    last_time = std::chrono::steady_clock::now();
+    thread = std::thread(&telemetry_exporter::run, this);
+}
+
+void telemetry_exporter::close() {
+    if (!mapping) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        stopped.notify_one();
+    }
+    thread.join();
+#if defined(_WIN32)
+    UnmapViewOfFile(mapping);
+    CloseHandle(mapping_handle);
+    mapping_handle = nullptr;
+#elif !defined(ANDROID)
+    munmap(mapping, mapping_size);
+    shm_unlink(object_name.c_str());
+#endif
+    mapping = nullptr;
+}
+
+monitor_telemetry_slot *telemetry_exporter::slot(int index) const {
+    uint8_t *address = mapping + MONITOR_TELEMETRY_HEADER_SIZE + MONITOR_TELEMETRY_SLOT_SIZE * index;
+    return reinterpret_cast<monitor_telemetry_slot *>(address);
+}
+
+void telemetry_exporter::add(telemetry_counters *counters) {
+    if (!mapping) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    bool used[MONITOR_TELEMETRY_SLOTS] = {};
+    for (telemetry_counters *other : swapchains) {
+        if (other->slot >= 0) used[other->slot] = true;
+    }
+    counters->slot = -1;
+    for (int i = 0; i < MONITOR_TELEMETRY_SLOTS; i++) {
+        if (!used[i]) {
+            counters->slot = i;
+            break;
+        }
+    }
+    if (counters->slot < 0) {
+        fprintf(stderr, "monitor: Too many swapchains for the telemetry, swapchain 0x%llx is not published\n",
+                static_cast<unsigned long long>(counters->swapchain));
+    }
+    swapchains.push_back(counters);
+}
+
+void telemetry_exporter::remove(telemetry_counters *counters) {
+    if (!mapping) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = std::find(swapchains.begin(), swapchains.end(), counters);
+    if (found == swapchains.end()) return;
+    swapchains.erase(found);
+    if (counters->slot < 0) return;
+    monitor_telemetry_slot *telemetry_slot = slot(counters->slot);
+    uint64_t const sequence = telemetry_slot->sequence.load(std::memory_order_relaxed);
+    telemetry_slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    telemetry_slot->swapchain = 0;
+    telemetry_slot->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Write the statistics of the frames of a swapchain presented since the last
+// interval to its slot. Called with the mutex held.
+void telemetry_exporter::publish(telemetry_counters &counters, float seconds, uint64_t now_ns) {
+    uint32_t deltas[TELEMETRY_BUCKETS];
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < TELEMETRY_BUCKETS; i++) {
+        uint32_t const count = counters.frame_time_buckets[i].load(std::memory_order_relaxed);
+        deltas[i] = count - counters.last_buckets[i];
+        counters.last_buckets[i] = count;
+        total += deltas[i];
+    }
+    uint64_t const frames = counters.frames.load(std::memory_order_relaxed);
+    float const fps = seconds > 0.0f ? (frames - counters.last_frames) / seconds : 0.0f;
+    counters.last_frames = frames;
+
+    // The frame times below which half, 99% and 99.9% of those of the
+    // interval are.
+    float percentiles[3] = {};
+    double const fractions[3] = {0.5, 0.99, 0.999};
+    uint64_t below = 0;
+    int found = 0;
+    for (uint32_t i = 0; i < TELEMETRY_BUCKETS && found < 3 && total > 0; i++) {
+        below += deltas[i];
+        while (found < 3 && below >= fractions[found] * total) percentiles[found++] = bucket_frame_time(i);
+    }
+
+    monitor_telemetry_slot *telemetry_slot = slot(counters.slot);
+    uint64_t const sequence = telemetry_slot->sequence.load(std::memory_order_relaxed);
+    telemetry_slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    telemetry_slot->swapchain = counters.swapchain;
+    telemetry_slot->frames = frames;
+    telemetry_slot->timestamp_ns = now_ns;
+    telemetry_slot->fps = fps;
+    telemetry_slot->median_ms = percentiles[0];
+    telemetry_slot->p99_ms = percentiles[1];
+    telemetry_slot->p99_9_ms = percentiles[2];
+    telemetry_slot->gpu_time_ms = counters.gpu_time_ms.load(std::memory_order_relaxed);
+    telemetry_slot->memory_usage_mb = counters.memory_usage_mb.load(std::memory_order_relaxed);
+    telemetry_slot->memory_budget_mb = counters.memory_budget_mb.load(std::memory_order_relaxed);
+    telemetry_slot->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void telemetry_exporter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopped.wait_for(lock, std::chrono::milliseconds(interval_ms), [this] { return stopping; })) {
+        auto const now = std::chrono::steady_clock::now();
+        float const seconds = std::chrono::duration<float>(now - last_time).count();
+        uint64_t const now_ns =
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+        last_time = now;
+        for (telemetry_counters *counters : swapchains) {
+            if (counters->slot >= 0) publish(*counters, seconds, now_ns);
+        }
+        auto header = reinterpret_cast<monitor_telemetry_header *>(mapping);
+        header->updates.fetch_add(1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2016-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The layout of the shared memory block the statistics of the swapchains are
+// published to, for dashboards and other processes to read them live.
+//
+// The block starts with a monitor_telemetry_header, followed by slot_count
+// slots of slot_size bytes, each a monitor_telemetry_slot. A slot holds the
+// statistics of one swapchain, or none if its swapchain is 0. The slots are
+// rewritten every interval_ms milliseconds by a thread of the layer.
+//
+// To read a slot, a reader loads its sequence, which is even once the slot is
+// written, reads the slot, then loads the sequence again. If it changed, the
+// slot was rewritten while it was read, and must be read again.
+
+#define MONITOR_TELEMETRY_MAGIC 0x4D4C4554  // "TELM"
+#define MONITOR_TELEMETRY_VERSION 2
+#define MONITOR_TELEMETRY_HEADER_SIZE 64
+#define MONITOR_TELEMETRY_SLOT_SIZE 64
+#define MONITOR_TELEMETRY_SLOTS 16
+
+struct monitor_telemetry_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint32_t process_id;
+    uint32_t interval_ms;
+    std::atomic<uint64_t> updates;  // the number of times the slots were rewritten
+};
+
+struct monitor_telemetry_slot {
+    std::atomic<uint64_t> sequence;
+    uint64_t swapchain;
+    uint64_t frames;        // presented since the swapchain was created
+    uint64_t timestamp_ns;  // when the slot was written, on the steady clock
+    // Over the last interval.
+    float fps;
+    float median_ms;
+    float p99_ms;
+    float p99_9_ms;
+    float gpu_time_ms;  // the last measured, or -1 if the GPU time is not measured
+    // Of the device local heaps of the device, at the last sample, or -1 if
+    // the memory budget is not sampled.
+    float memory_usage_mb;
+    float memory_budget_mb;
+};
+
+static_assert(sizeof(monitor_telemetry_header) <= MONITOR_TELEMETRY_HEADER_SIZE, "telemetry header too large");
+static_assert(sizeof(monitor_telemetry_slot) <= MONITOR_TELEMETRY_SLOT_SIZE, "telemetry slot too large");
+
+// The frame times of a swapchain are counted in buckets of 0.1 ms up to
+// 100 ms, then of 100 ms up to 2.5 s, enough for the percentiles of an
+// interval to be read from them.
+#define TELEMETRY_BUCKETS 1024
+
+// The counters of a swapchain, updated by its presents with a few atomic
+// operations, and read by the thread of the telemetry.
+struct telemetry_counters {
+    uint64_t swapchain = 0;
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint32_t> frame_time_buckets[TELEMETRY_BUCKETS] = {};
+    std::atomic<float> gpu_time_ms{-1.0f};
+    std::atomic<float> memory_usage_mb{-1.0f};
+    std::atomic<float> memory_budget_mb{-1.0f};
+
+    void record_frame_time(float frame_time_ms);
+
+    // Used by the thread only: the buckets and frames of the last interval.
+    uint32_t last_buckets[TELEMETRY_BUCKETS] = {};
+    uint64_t last_frames = 0;
+    int slot = -1;
+};
+
+// Publishes the counters of the swapchains to a shared memory block, created
+// by open(), on a thread of its own.
+class telemetry_exporter {
+   public:
+    ~telemetry_exporter() { close(); }
+
+    bool is_open() const { return mapping != nullptr; }
+    void open(const char *name, uint32_t interval_ms);
+    void close();
+
+    // Publish the counters of a swapchain, until they are removed. Only the
+    // first MONITOR_TELEMETRY_SLOTS swapchains at a time are published.
+    void add(telemetry_counters *counters);
+    void remove(telemetry_counters *counters);
+
+   private:
+    void run();
+    void publish(telemetry_counters &counters, float seconds, uint64_t now_ns);
+    monitor_telemetry_slot *slot(int index) const;
+
+    std::string object_name;
+    uint8_t *mapping = nullptr;
+    size_t mapping_size = 0;
+#ifdef _WIN32
+    void *mapping_handle = nullptr;
+#endif
+    uint32_t interval_ms = 1000;
+    std::mutex mutex;
+    std::condition_variable stopped;
+    bool stopping = false;
+    std::thread thread;
+    std::vector<telemetry_counters *> swapchains;
+    std::chrono::steady_clock::time_point last_time;
+};
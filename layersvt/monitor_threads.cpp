@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2016-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "monitor_threads.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <tlhelp32.h>
+#elif !defined(__APPLE__)
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+// The threads printed when the sampler is stopped.
+#define THREAD_SUMMARY_LENGTH 8
+
+// Read the CPU time of the threads of the process. Returns false if it is not
+// supported.
+static bool read_thread_cpu_times(std::vector<thread_cpu_time> &times) {
+    times.clear();
+#if defined(_WIN32)
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) return false;
+    DWORD const process_id = GetCurrentProcessId();
+    THREADENTRY32 entry = {};
+    entry.dwSize = sizeof(entry);
+    for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry)) {
+        if (entry.th32OwnerProcessID != process_id) continue;
+        HANDLE handle = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, entry.th32ThreadID);
+        if (!handle) continue;
+        FILETIME creation, exit, kernel, user;
+        if (GetThreadTimes(handle, &creation, &exit, &kernel, &user)) {
+            // In units of 100 nanoseconds.
+            uint64_t const kernel_time = (static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+            uint64_t const user_time = (static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+            thread_cpu_time time;
+            time.id = entry.th32ThreadID;
+            time.cpu_ns = (kernel_time + user_time) * 100;
+            times.push_back(time);
+        }
+        CloseHandle(handle);
+    }
+    CloseHandle(snapshot);
+    return true;
+#elif defined(__APPLE__)
+    return false;
+#else
+    DIR *tasks = opendir("/proc/self/task");
+    if (!tasks) return false;
+    double const ns_per_tick = 1.0e9 / sysconf(_SC_CLK_TCK);
+    while (dirent *task = readdir(tasks)) {
+        if (task->d_name[0] == '.') continue;
+        std::string const path = std::string("/proc/self/task/") + task->d_name + "/stat";
+        // The thread may have exited since the directory was read.
+        FILE *file = fopen(path.c_str(), "r");
+        if (!file) continue;
+        char line[512];
+        size_t const length = fread(line, 1, sizeof(line) - 1, file);
+        fclose(file);
+        line[length] = '\0';
+        // The name is in parentheses, and may have spaces and parentheses of
+        // its own. The user and system times are the 14th and 15th fields.
+        char *name_begin = strchr(line, '(');
+        char *name_end = strrchr(line, ')');
+        unsigned long long user_ticks = 0;
+        unsigned long long system_ticks = 0;
+        if (!name_begin || !name_end || name_end < name_begin ||
+            sscanf(name_end + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &user_ticks, &system_ticks) != 2) {
+            continue;
+        }
+        thread_cpu_time time;
+        time.id = strtoull(task->d_name, nullptr, 10);
+        time.name.assign(name_begin + 1, name_end);
+        time.cpu_ns = static_cast<uint64_t>((user_ticks + system_ticks) * ns_per_tick);
+        times.push_back(time);
+    }
+    closedir(tasks);
+    return true;
+#endif
+}
+
+void thread_cpu_sampler::start(uint32_t interval) {
+    if (thread.joinable()) return;
+    if (!read_thread_cpu_times(times)) {
+        fprintf(stderr, "monitor: The CPU time of the threads cannot be read on this platform\n");
+        return;
+    }
+    interval_ms = std::max(interval, 1u);
+    stopping = false;
+    threads.clear();
+    samples = 0;
+    process_percent.store(-1.0f, std::memory_order_relaxed);
+    busiest_percent.store(-1.0f, std::memory_order_relaxed);
+    sample(0.0);
+    running.store(true, std::memory_order_relaxed);
+    thread = std::thread(&thread_cpu_sampler::run, this);
+}
+
+void thread_cpu_sampler::stop() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        stopped.notify_one();
+    }
+    thread.join();
+    running.store(false, std::memory_order_relaxed);
+    process_percent.store(-1.0f, std::memory_order_relaxed);
+    busiest_percent.store(-1.0f, std::memory_order_relaxed);
+    print_summary();
+}
+
+void thread_cpu_sampler::run() {
+    auto last_time = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopped.wait_for(lock, std::chrono::milliseconds(interval_ms), [this] { return stopping; })) {
+        auto const now = std::chrono::steady_clock::now();
+        double const seconds = std::chrono::duration<double>(now - last_time).count();
+        last_time = now;
+        if (read_thread_cpu_times(times)) sample(seconds);
+    }
+}
+
+// Update the threads from the times read, over the seconds since the last
+// sample, 0 for the first.
+void thread_cpu_sampler::sample(double seconds) {
+    samples++;
+    double process_ns = 0.0;
+    float busiest = 0.0f;
+    uint64_t busiest_thread = 0;
+    for (const thread_cpu_time &time : times) {
+        auto found = threads.find(time.id);
+        if (found == threads.end() || time.cpu_ns < found->second.last_cpu_ns) {
+            // A new thread, or one whose id was reused.
+            thread_state &state = threads[time.id];
+            state = thread_state();
+            state.name = time.name;
+            state.first_cpu_ns = samples == 1 ? time.cpu_ns : 0;
+            state.last_cpu_ns = state.first_cpu_ns;
+            found = threads.find(time.id);
+        }
+        thread_state &state = found->second;
+        uint64_t const busy_ns = time.cpu_ns - state.last_cpu_ns;
+        state.last_cpu_ns = time.cpu_ns;
+        if (seconds <= 0.0) continue;
+        process_ns += static_cast<double>(busy_ns);
+        float const busy_percent = static_cast<float>(busy_ns / (seconds * 1.0e7));
+        state.max_busy_percent = std::max(state.max_busy_percent, busy_percent);
+        if (busy_percent > busiest) {
+            busiest = busy_percent;
+            busiest_thread = time.id;
+        }
+    }
+    if (seconds <= 0.0) return;
+    process_percent.store(static_cast<float>(process_ns / (seconds * 1.0e7)), std::memory_order_relaxed);
+    busiest_percent.store(busiest, std::memory_order_relaxed);
+    busiest_id.store(busiest_thread, std::memory_order_relaxed);
+}
+
+void thread_cpu_sampler::print_summary() const {
+    std::vector<std::pair<uint64_t, const thread_state *>> sorted;
+    auto const cpu_ns = [](const thread_state *state) { return state->last_cpu_ns - state->first_cpu_ns; };
+    for (const auto &entry : threads) {
+        if (cpu_ns(&entry.second) > 0) sorted.emplace_back(entry.first, &entry.second);
+    }
+    std::sort(sorted.begin(), sorted.end(), [&](const std::pair<uint64_t, const thread_state *> &a,
+                                               const std::pair<uint64_t, const thread_state *> &b) {
+        return cpu_ns(a.second) > cpu_ns(b.second);
+    });
+    if (sorted.size() > THREAD_SUMMARY_LENGTH) sorted.resize(THREAD_SUMMARY_LENGTH);
+    for (const auto &entry : sorted) {
+        printf("monitor: Thread %llu%s%s%s: %.2f s of CPU time, %.0f%% busy at most\n",
+               static_cast<unsigned long long>(entry.first), entry.second->name.empty() ? "" : " (",
+               entry.second->name.c_str(), entry.second->name.empty() ? "" : ")", cpu_ns(entry.second) / 1.0e9,
+               entry.second->max_busy_percent);
+    }
+}
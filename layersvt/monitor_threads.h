@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2016-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// The CPU time of a thread of the process, read from /proc/self/task on
+// Linux and Android, or with GetThreadTimes on Windows.
+struct thread_cpu_time {
+    uint64_t id = 0;
+    std::string name;  // empty where the threads have none
+    uint64_t cpu_ns = 0;
+};
+
+// Samples the CPU time of the threads of the process every interval_ms
+// milliseconds on a thread of its own, so that the presents only load the
+// busy percentages of the last interval, of one CPU: those of the whole
+// process, which may be above 100, and of its busiest thread. When it is
+// stopped, the threads that took the most CPU time are printed.
+class thread_cpu_sampler {
+   public:
+    ~thread_cpu_sampler() { stop(); }
+
+    bool is_running() const { return running.load(std::memory_order_relaxed); }
+    void start(uint32_t interval_ms);
+    void stop();
+
+    // Over the last interval, or -1 before the second sample.
+    float process_busy_percent() const { return process_percent.load(std::memory_order_relaxed); }
+    float busiest_thread_percent() const { return busiest_percent.load(std::memory_order_relaxed); }
+    uint64_t busiest_thread_id() const { return busiest_id.load(std::memory_order_relaxed); }
+
+   private:
+    // The state of a thread since it was first seen.
+    struct thread_state {
+        std::string name;
+        uint64_t first_cpu_ns = 0;
+        uint64_t last_cpu_ns = 0;
+        float max_busy_percent = 0.0f;
+    };
+
+    void run();
+    void sample(double seconds);
+    void print_summary() const;
+
+    uint32_t interval_ms = 0;
+    std::mutex mutex;
+    std::condition_variable stopped;
+    bool stopping = false;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<float> process_percent{-1.0f};
+    std::atomic<float> busiest_percent{-1.0f};
+    std::atomic<uint64_t> busiest_id{0};
+
+    // Used by the thread only: the times of the last sample, and the threads
+    // seen, including those that exited since.
+    std::vector<thread_cpu_time> times;
+    std::unordered_map<uint64_t, thread_state> threads;
+    uint64_t samples = 0;
+};
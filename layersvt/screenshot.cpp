@@ -31,15 +31,23 @@
 #include <set>
 #include <vector>
 #include <mutex>
-#include <fstream>
+#include <atomic>
+#include <climits>
+#include <deque>
+#include <memory>
+#include <string_view>
 
 using namespace std;
 
 #include <vulkan/vk_enum_string_helper.h>
 #include "vk_layer_config.h"
 #include "vk_layer_table.h"
+#include "vk_layer_handle_map.h"
+#include "vk_layer_memory.h"
 
 #include "screenshot_parsing.h"
+#include "screenshot_encode.h"
+#include "screenshot_trigger.h"
 
 #ifdef ANDROID
 
@@ -50,16 +58,67 @@ const char *env_var_frames = "debug.vulkan.screenshot";
 const char *env_var_old = env_var_frames;
 const char *env_var_format = "debug.vulkan.screenshot.format";
 const char *env_var_dir = "debug.vulkan.screenshot.dir";
+const char *env_var_file_format = "debug.vulkan.screenshot.file_format";
+const char *env_var_downscale = "debug.vulkan.screenshot.downscale";
+const char *env_var_region = "debug.vulkan.screenshot.region";
+const char *env_var_thumbnail = "debug.vulkan.screenshot.thumbnail";
+const char *env_var_skip_duplicates = "debug.vulkan.screenshot.skip_duplicates";
+const char *env_var_timing = "debug.vulkan.screenshot.timing";
+const char *env_var_shared_memory = "debug.vulkan.screenshot.shared_memory";
+const char *env_var_queue_frames = "debug.vulkan.screenshot.queue_frames";
+const char *env_var_queue_size = "debug.vulkan.screenshot.queue_size";
+const char *env_var_backpressure = "debug.vulkan.screenshot.backpressure";
+const char *env_var_reference_dir = "debug.vulkan.screenshot.reference_dir";
+const char *env_var_reference_threshold = "debug.vulkan.screenshot.reference_threshold";
+const char *env_var_trigger_file = "debug.vulkan.screenshot.trigger_file";
+const char *env_var_trigger_signal = "debug.vulkan.screenshot.trigger_signal";
+const char *env_var_trigger_socket = "debug.vulkan.screenshot.trigger_socket";
+const char *env_var_images = "debug.vulkan.screenshot.images";
+const char *env_var_monitor_spikes = "debug.vulkan.screenshot.monitor_spikes";
 #else  // Linux or Windows
 const char *env_var_old = "_VK_SCREENSHOT";
 const char *env_var_frames = "VK_SCREENSHOT_FRAMES";
 const char *env_var_format = "VK_SCREENSHOT_FORMAT";
 const char *env_var_dir = "VK_SCREENSHOT_DIR";
+const char *env_var_file_format = "VK_SCREENSHOT_FILE_FORMAT";
+const char *env_var_downscale = "VK_SCREENSHOT_DOWNSCALE";
+const char *env_var_region = "VK_SCREENSHOT_REGION";
+const char *env_var_thumbnail = "VK_SCREENSHOT_THUMBNAIL";
+const char *env_var_skip_duplicates = "VK_SCREENSHOT_SKIP_DUPLICATES";
+const char *env_var_timing = "VK_SCREENSHOT_TIMING";
+const char *env_var_shared_memory = "VK_SCREENSHOT_SHARED_MEMORY";
+const char *env_var_queue_frames = "VK_SCREENSHOT_QUEUE_FRAMES";
+const char *env_var_queue_size = "VK_SCREENSHOT_QUEUE_SIZE";
+const char *env_var_backpressure = "VK_SCREENSHOT_BACKPRESSURE";
+const char *env_var_reference_dir = "VK_SCREENSHOT_REFERENCE_DIR";
+const char *env_var_reference_threshold = "VK_SCREENSHOT_REFERENCE_THRESHOLD";
+const char *env_var_trigger_file = "VK_SCREENSHOT_TRIGGER_FILE";
+const char *env_var_trigger_signal = "VK_SCREENSHOT_TRIGGER_SIGNAL";
+const char *env_var_trigger_socket = "VK_SCREENSHOT_TRIGGER_SOCKET";
+const char *env_var_images = "VK_SCREENSHOT_IMAGES";
+const char *env_var_monitor_spikes = "VK_SCREENSHOT_MONITOR_SPIKES";
 #endif
 
 const char *settings_option_frames = "lunarg_screenshot.frames";
 const char *settings_option_format = "lunarg_screenshot.format";
 const char *settings_option_dir = "lunarg_screenshot.dir";
+const char *settings_option_file_format = "lunarg_screenshot.file_format";
+const char *settings_option_downscale = "lunarg_screenshot.downscale";
+const char *settings_option_region = "lunarg_screenshot.region";
+const char *settings_option_thumbnail = "lunarg_screenshot.thumbnail";
+const char *settings_option_skip_duplicates = "lunarg_screenshot.skip_duplicates";
+const char *settings_option_timing = "lunarg_screenshot.timing";
+const char *settings_option_shared_memory = "lunarg_screenshot.shared_memory";
+const char *settings_option_queue_frames = "lunarg_screenshot.queue_frames";
+const char *settings_option_queue_size = "lunarg_screenshot.queue_size";
+const char *settings_option_backpressure = "lunarg_screenshot.backpressure";
+const char *settings_option_reference_dir = "lunarg_screenshot.reference_dir";
+const char *settings_option_reference_threshold = "lunarg_screenshot.reference_threshold";
+const char *settings_option_trigger_file = "lunarg_screenshot.trigger_file";
+const char *settings_option_trigger_signal = "lunarg_screenshot.trigger_signal";
+const char *settings_option_trigger_socket = "lunarg_screenshot.trigger_socket";
+const char *settings_option_images = "lunarg_screenshot.images";
+const char *settings_option_monitor_spikes = "lunarg_screenshot.monitor_spikes";
 
 #ifdef ANDROID
 
@@ -132,12 +191,43 @@ typedef enum colorSpaceFormat {
 
 colorSpaceFormat userColorSpaceFormat = UNDEFINED;
 
-// unordered map: associates Vulkan dispatchable objects to a dispatch table
+ScreenshotFileFormat screenshotFileFormat = SCREENSHOT_FILE_FORMAT_PPM;
+
+// The regions of the swapchain images to capture, each to a file of its own,
+// the whole images if there are none, and the factor by which they are scaled
+// down on the GPU before they are read back. The whole images can also be
+// captured as a thumbnail, scaled down by another factor, 0 for none.
+vector<VkRect2D> screenshotRegions;
+uint32_t screenshotDownscale = 1;
+uint32_t screenshotThumbnailDownscale = 0;
+
+// The names, given with vkSetDebugUtilsObjectNameEXT, of the images captured
+// at the end of the submits that write them, and whether the swapchain images
+// are captured too, which they are unless images are named, other than
+// "swapchain".
+set<string> screenshotImageNames;
+bool captureSwapchainImages = true;
+
+// Threads that encode and write the screenshot files, and the most frames
+// waiting for them, by default.
+static ScreenshotEncoder screenshotEncoder(2, 4);
+
+// The most frames, and megabytes of them, waiting for the encoder threads, 0
+// megabytes for no bound, and what a capture does when there are that many.
+uint32_t screenshotQueueFrames = 4;
+uint32_t screenshotQueueMegabytes = 0;
+ScreenshotBackpressure screenshotBackpressure = SCREENSHOT_BACKPRESSURE_BLOCK;
+
+// handle map: associates Vulkan dispatchable objects to a dispatch table. It
+// is read without the global lock by every intercepted call.
 typedef struct {
     VulDeviceDispatchTable *device_dispatch_table;
     PFN_vkSetDeviceLoaderData pfn_dev_init;
 } DispatchMapStruct;
-static unordered_map<VkDevice, DispatchMapStruct *> dispatchMap;
+static HandleMap<VkDevice, DispatchMapStruct> dispatchMap;
+
+// The lists of the images of the swapchains.
+static LayerMemoryAccount swapchainImageMemory("swapchain images");
 
 // unordered map: associates a swap chain with a device, image extent, format,
 // and list of images
@@ -145,7 +235,7 @@ typedef struct {
     VkDevice device;
     VkExtent2D imageExtent;
     VkFormat format;
-    VkImage *imageList;
+    vector<VkImage, LayerAllocator<VkImage, swapchainImageMemory>> imageList;
 } SwapchainMapStruct;
 static unordered_map<VkSwapchainKHR, SwapchainMapStruct *> swapchainMap;
 
@@ -157,24 +247,27 @@ typedef struct {
 } ImageMapStruct;
 static unordered_map<VkImage, ImageMapStruct *> imageMap;
 
-// unordered map: associates a device with per device info -
+// handle map: associates a device with per device info, whose queues are
+// guarded by the global lock -
 //   wsi capability
 //   set of queues created for this device
 //   queue to queueFamilyIndex map
 //   physical device
+//   number of physical devices of the device group, 1 without one
 typedef struct {
     bool wsi_enabled;
     set<VkQueue> queues;
     unordered_map<VkQueue, uint32_t> queueIndexMap;
     VkPhysicalDevice physicalDevice;
+    uint32_t physicalDeviceCount;
 } DeviceMapStruct;
-static unordered_map<VkDevice, DeviceMapStruct *> deviceMap;
+static HandleMap<VkDevice, DeviceMapStruct> deviceMap;
 
-// unordered map: associates a physical device with an instance
+// handle map: associates a physical device with an instance
 typedef struct {
     VkInstance instance;
 } PhysDeviceMapStruct;
-static unordered_map<VkPhysicalDevice, PhysDeviceMapStruct *> physDeviceMap;
+static HandleMap<VkPhysicalDevice, PhysDeviceMapStruct> physDeviceMap;
 
 // set: list of frames to take screenshots without duplication.
 static set<int> screenshotFrames;
@@ -185,6 +278,23 @@ static bool screenshotFramesReceived = false;
 // Screenshots will be generated from screenShotFrameRange's startFrame to startFrame+count-1 with skipped Interval in between.
 static FrameRange screenShotFrameRange = {false, 0, SCREEN_SHOT_FRAMES_UNLIMITED, SCREEN_SHOT_FRAMES_INTERVAL_DEFAULT};
 
+// The number of the next frame to be presented.
+static std::atomic<int> presentFrameNumber(0);
+
+// The first frame whose present has to take globalLock, either to capture it
+// or to retire captures in flight. The presents of the frames before it
+// neither take the lock nor look at the frame lists.
+static std::atomic<int> nextLockedFrameNumber(0);
+
+// Requests to capture the next frames while the application runs, which
+// reset nextLockedFrameNumber, and the frame up to which, not included, the
+// frames requested so far are captured.
+static ScreenshotTrigger screenshotTrigger(nextLockedFrameNumber);
+static int triggeredFramesEnd = 0;
+
+// The instances created and not destroyed yet.
+static int instanceCount = 0;
+
 // Get maximum frame number of the frame range
 // FrameRange* pFrameRange, the specified frame rang
 // return:
@@ -296,6 +406,515 @@ void readScreenShotDir(void) {
 #endif
 }
 
+// Get the format in which to write the screenshot files
+void readScreenShotFileFormat(void) {
+    const char *vk_screenshot_file_format = getLayerOption(settings_option_file_format);
+    const char *env_var = local_getenv(env_var_file_format);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_file_format = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+
+    if (vk_screenshot_file_format && *vk_screenshot_file_format) {
+        if (strcmp(vk_screenshot_file_format, "PNG") == 0) {
+            screenshotFileFormat = SCREENSHOT_FILE_FORMAT_PNG;
+        } else if (strcmp(vk_screenshot_file_format, "QOI") == 0) {
+            screenshotFileFormat = SCREENSHOT_FILE_FORMAT_QOI;
+        } else if (strcmp(vk_screenshot_file_format, "Y4M") == 0) {
+            screenshotFileFormat = SCREENSHOT_FILE_FORMAT_Y4M;
+        } else if (strcmp(vk_screenshot_file_format, "PPM16") == 0) {
+            screenshotFileFormat = SCREENSHOT_FILE_FORMAT_PPM16;
+        } else if (strcmp(vk_screenshot_file_format, "PFM") == 0) {
+            screenshotFileFormat = SCREENSHOT_FILE_FORMAT_PFM;
+        } else if (strcmp(vk_screenshot_file_format, "RAW") == 0) {
+            screenshotFileFormat = SCREENSHOT_FILE_FORMAT_RAW;
+        } else if (strcmp(vk_screenshot_file_format, "PPM") != 0) {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_INFO, "screenshot",
+                                "Selected file format:%s\nIs NOT in the list:\nPPM, PNG, QOI, Y4M, PPM16, PFM, RAW\n"
+                                "PPM will be used instead\n",
+                                vk_screenshot_file_format);
+#else
+            fprintf(stderr,
+                    "screenshot: Selected file format:%s\nIs NOT in the list:\nPPM, PNG, QOI, Y4M, PPM16, PFM, RAW\n"
+                    "PPM will be used instead\n",
+                    vk_screenshot_file_format);
+#endif
+        }
+    }
+
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_file_format);
+    }
+}
+
+// Get the factor by which to scale down the captured frames
+void readScreenShotDownscale(void) {
+    const char *vk_screenshot_downscale = getLayerOption(settings_option_downscale);
+    const char *env_var = local_getenv(env_var_downscale);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_downscale = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+
+    if (vk_screenshot_downscale && *vk_screenshot_downscale) {
+        int const downscale = atoi(vk_screenshot_downscale);
+        if (downscale >= 1) {
+            screenshotDownscale = static_cast<uint32_t>(downscale);
+        } else {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_INFO, "screenshot", "Downscale:%s\nIs NOT a positive integer, 1 will be used instead\n",
+                                vk_screenshot_downscale);
+#else
+            fprintf(stderr, "screenshot: Downscale:%s\nIs NOT a positive integer, 1 will be used instead\n",
+                    vk_screenshot_downscale);
+#endif
+        }
+    }
+
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_downscale);
+    }
+}
+
+// Get the regions of the swapchain images to capture, as "x,y,width,height",
+// separated by semicolons
+void readScreenShotRegion(void) {
+    const char *vk_screenshot_region = getLayerOption(settings_option_region);
+    const char *env_var = local_getenv(env_var_region);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_region = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+
+    if (vk_screenshot_region && *vk_screenshot_region) {
+        string spec(vk_screenshot_region);
+        size_t start = 0;
+        while (start < spec.size()) {
+            size_t end = spec.find(';', start);
+            if (end == string::npos) end = spec.size();
+            string word(spec, start, end - start);
+            start = end + 1;
+
+            int x, y, width, height;
+            if (sscanf(word.c_str(), "%d,%d,%d,%d", &x, &y, &width, &height) == 4 && x >= 0 && y >= 0 && width > 0 &&
+                height > 0) {
+                screenshotRegions.push_back({{x, y}, {static_cast<uint32_t>(width), static_cast<uint32_t>(height)}});
+            } else {
+#ifdef ANDROID
+                __android_log_print(ANDROID_LOG_INFO, "screenshot", "Region:%s\nIs NOT x,y,width,height\nIt will be ignored\n",
+                                    word.c_str());
+#else
+                fprintf(stderr, "screenshot: Region:%s\nIs NOT x,y,width,height\nIt will be ignored\n", word.c_str());
+#endif
+            }
+        }
+    }
+
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_region);
+    }
+}
+
+// Get the names of the images to capture at the end of the submits that
+// write them, as a comma-separated list
+void readScreenShotImages(void) {
+    const char *vk_screenshot_images = getLayerOption(settings_option_images);
+    const char *env_var = local_getenv(env_var_images);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_images = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+
+    if (vk_screenshot_images && *vk_screenshot_images) {
+        string spec(vk_screenshot_images);
+        size_t start = 0;
+        while (start < spec.size()) {
+            size_t end = spec.find(',', start);
+            if (end == string::npos) end = spec.size();
+            string const name(spec, start, end - start);
+            start = end + 1;
+            if (!name.empty()) screenshotImageNames.insert(name);
+        }
+        captureSwapchainImages = screenshotImageNames.erase("swapchain") > 0 || screenshotImageNames.empty();
+    }
+
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_images);
+    }
+}
+
+// Get whether to skip the frames that are the same as the previous capture,
+// which the encoder threads then record to a manifest file in the screenshot
+// directory. Read after the directory.
+void readScreenShotSkipDuplicates(void) {
+    const char *vk_screenshot_skip_duplicates = getLayerOption(settings_option_skip_duplicates);
+    const char *env_var = local_getenv(env_var_skip_duplicates);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_skip_duplicates = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+
+    if (vk_screenshot_skip_duplicates &&
+        (strcmp(vk_screenshot_skip_duplicates, "true") == 0 || strcmp(vk_screenshot_skip_duplicates, "TRUE") == 0 ||
+         strcmp(vk_screenshot_skip_duplicates, "1") == 0)) {
+        string manifestFileName = "manifest.txt";
+        if (vk_screenshot_dir != NULL && strlen(vk_screenshot_dir) > 0) {
+            manifestFileName = string(vk_screenshot_dir) + "/" + manifestFileName;
+        }
+        screenshotEncoder.skipDuplicates(manifestFileName);
+    }
+
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_skip_duplicates);
+    }
+}
+
+// Get the directory of the reference images to compare the captures with,
+// and the error of a tile above which a capture differs from its reference.
+// The results of the comparisons are written to a file in the screenshot
+// directory. Read after the directory.
+void readScreenShotReferences(void) {
+    const char *vk_screenshot_reference_dir = getLayerOption(settings_option_reference_dir);
+    const char *env_var = local_getenv(env_var_reference_dir);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_reference_dir = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+    if (vk_screenshot_reference_dir == NULL || strlen(vk_screenshot_reference_dir) == 0) return;
+    string const referenceDir = vk_screenshot_reference_dir;
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_reference_dir);
+    }
+
+    double threshold = 2.0;
+    const char *vk_screenshot_reference_threshold = getLayerOption(settings_option_reference_threshold);
+    env_var = local_getenv(env_var_reference_threshold);
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_reference_threshold = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+    if (vk_screenshot_reference_threshold && *vk_screenshot_reference_threshold) {
+        char *end = NULL;
+        double const value = strtod(vk_screenshot_reference_threshold, &end);
+        if (*end == '\0' && value >= 0.0) {
+            threshold = value;
+        } else {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_INFO, "screenshot",
+                                "Reference threshold:%s\nIs NOT a non-negative number, 2 will be used instead\n",
+                                vk_screenshot_reference_threshold);
+#else
+            fprintf(stderr, "screenshot: Reference threshold:%s\nIs NOT a non-negative number, 2 will be used instead\n",
+                    vk_screenshot_reference_threshold);
+#endif
+        }
+    }
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_reference_threshold);
+    }
+
+    string resultsFileName = "results.txt";
+    if (vk_screenshot_dir != NULL && strlen(vk_screenshot_dir) > 0) {
+        resultsFileName = string(vk_screenshot_dir) + "/" + resultsFileName;
+    }
+    screenshotEncoder.compareWithReferences(referenceDir, threshold, resultsFileName);
+}
+
+// Get the triggers that request to capture the next frames while the
+// application runs: a file that is looked for, SIGUSR2, or a socket
+void readScreenShotTriggers(void) {
+    const char *vk_screenshot_trigger_file = getLayerOption(settings_option_trigger_file);
+    const char *env_var = local_getenv(env_var_trigger_file);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_trigger_file = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+    if (vk_screenshot_trigger_file && strlen(vk_screenshot_trigger_file) > 0) {
+        screenshotTrigger.watchFile(vk_screenshot_trigger_file);
+    }
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_trigger_file);
+    }
+
+    const char *vk_screenshot_trigger_signal = getLayerOption(settings_option_trigger_signal);
+    env_var = local_getenv(env_var_trigger_signal);
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_trigger_signal = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+    if (vk_screenshot_trigger_signal &&
+        (strcmp(vk_screenshot_trigger_signal, "true") == 0 || strcmp(vk_screenshot_trigger_signal, "TRUE") == 0 ||
+         strcmp(vk_screenshot_trigger_signal, "1") == 0)) {
+        screenshotTrigger.catchSignal();
+    }
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_trigger_signal);
+    }
+
+    const char *vk_screenshot_trigger_socket = getLayerOption(settings_option_trigger_socket);
+    env_var = local_getenv(env_var_trigger_socket);
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_trigger_socket = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+    if (vk_screenshot_trigger_socket && strlen(vk_screenshot_trigger_socket) > 0) {
+        screenshotTrigger.listenOn(vk_screenshot_trigger_socket);
+    }
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_trigger_socket);
+    }
+
+    const char *vk_screenshot_monitor_spikes = getLayerOption(settings_option_monitor_spikes);
+    env_var = local_getenv(env_var_monitor_spikes);
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_monitor_spikes = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+    if (vk_screenshot_monitor_spikes &&
+        (strcmp(vk_screenshot_monitor_spikes, "true") == 0 || strcmp(vk_screenshot_monitor_spikes, "TRUE") == 0 ||
+         strcmp(vk_screenshot_monitor_spikes, "1") == 0)) {
+        screenshotTrigger.subscribeToSpikes();
+    }
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_monitor_spikes);
+    }
+
+    screenshotTrigger.start();
+}
+
+// Get whether to time the stages of the captures
+void readScreenShotTiming(void) {
+    const char *vk_screenshot_timing = getLayerOption(settings_option_timing);
+    const char *env_var = local_getenv(env_var_timing);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_timing = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+
+    if (vk_screenshot_timing && (strcmp(vk_screenshot_timing, "true") == 0 || strcmp(vk_screenshot_timing, "TRUE") == 0 ||
+                                 strcmp(vk_screenshot_timing, "1") == 0)) {
+        screenshotEncoder.enableTiming();
+    }
+
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_timing);
+    }
+}
+
+// Get the name of the shared memory to publish the captures to, instead of
+// writing them to files
+void readScreenShotSharedMemory(void) {
+    const char *vk_screenshot_shared_memory = getLayerOption(settings_option_shared_memory);
+    const char *env_var = local_getenv(env_var_shared_memory);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_shared_memory = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+
+    if (vk_screenshot_shared_memory && strlen(vk_screenshot_shared_memory) > 0) {
+        screenshotEncoder.publishTo(vk_screenshot_shared_memory);
+    }
+
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_shared_memory);
+    }
+}
+
+// Get the most frames waiting for the encoder threads
+void readScreenShotQueueFrames(void) {
+    const char *vk_screenshot_queue_frames = getLayerOption(settings_option_queue_frames);
+    const char *env_var = local_getenv(env_var_queue_frames);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_queue_frames = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+
+    if (vk_screenshot_queue_frames && *vk_screenshot_queue_frames) {
+        int const queueFrames = atoi(vk_screenshot_queue_frames);
+        if (queueFrames >= 1) {
+            screenshotQueueFrames = static_cast<uint32_t>(queueFrames);
+        } else {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_INFO, "screenshot",
+                                "Queue frames:%s\nIs NOT a positive integer, 4 will be used instead\n", vk_screenshot_queue_frames);
+#else
+            fprintf(stderr, "screenshot: Queue frames:%s\nIs NOT a positive integer, 4 will be used instead\n",
+                    vk_screenshot_queue_frames);
+#endif
+        }
+    }
+
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_queue_frames);
+    }
+}
+
+// Get the most megabytes of frames waiting for the encoder threads
+void readScreenShotQueueSize(void) {
+    const char *vk_screenshot_queue_size = getLayerOption(settings_option_queue_size);
+    const char *env_var = local_getenv(env_var_queue_size);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_queue_size = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+
+    if (vk_screenshot_queue_size && *vk_screenshot_queue_size) {
+        int const queueSize = atoi(vk_screenshot_queue_size);
+        if (queueSize >= 0) {
+            screenshotQueueMegabytes = static_cast<uint32_t>(queueSize);
+        } else {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_INFO, "screenshot",
+                                "Queue size:%s\nIs NOT a number of megabytes, 0 will be used instead\n", vk_screenshot_queue_size);
+#else
+            fprintf(stderr, "screenshot: Queue size:%s\nIs NOT a number of megabytes, 0 will be used instead\n",
+                    vk_screenshot_queue_size);
+#endif
+        }
+    }
+
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_queue_size);
+    }
+}
+
+// Get what a capture does when the queue of the encoder threads is full
+void readScreenShotBackpressure(void) {
+    const char *vk_screenshot_backpressure = getLayerOption(settings_option_backpressure);
+    const char *env_var = local_getenv(env_var_backpressure);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_backpressure = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+
+    if (vk_screenshot_backpressure && *vk_screenshot_backpressure) {
+        if (strcmp(vk_screenshot_backpressure, "DROP_NEWEST") == 0) {
+            screenshotBackpressure = SCREENSHOT_BACKPRESSURE_DROP_NEWEST;
+        } else if (strcmp(vk_screenshot_backpressure, "DROP_OLDEST") == 0) {
+            screenshotBackpressure = SCREENSHOT_BACKPRESSURE_DROP_OLDEST;
+        } else if (strcmp(vk_screenshot_backpressure, "BLOCK") != 0) {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_INFO, "screenshot",
+                                "Selected backpressure:%s\nIs NOT in the list:\nBLOCK, DROP_NEWEST, DROP_OLDEST\n"
+                                "BLOCK will be used instead\n",
+                                vk_screenshot_backpressure);
+#else
+            fprintf(stderr,
+                    "screenshot: Selected backpressure:%s\nIs NOT in the list:\nBLOCK, DROP_NEWEST, DROP_OLDEST\n"
+                    "BLOCK will be used instead\n",
+                    vk_screenshot_backpressure);
+#endif
+        }
+    }
+
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_backpressure);
+    }
+}
+
+// Get the factor by which to scale down the thumbnail of the whole images
+void readScreenShotThumbnail(void) {
+    const char *vk_screenshot_thumbnail = getLayerOption(settings_option_thumbnail);
+    const char *env_var = local_getenv(env_var_thumbnail);
+
+    if (env_var != NULL) {
+        if (strlen(env_var) > 0) {
+            vk_screenshot_thumbnail = env_var;
+        } else if (strlen(env_var) == 0) {
+            local_free_getenv(env_var);
+            env_var = NULL;
+        }
+    }
+
+    if (vk_screenshot_thumbnail && *vk_screenshot_thumbnail) {
+        int const thumbnail = atoi(vk_screenshot_thumbnail);
+        if (thumbnail >= 0) {
+            screenshotThumbnailDownscale = static_cast<uint32_t>(thumbnail);
+        }
+    }
+
+    if (env_var != NULL) {
+        local_free_getenv(vk_screenshot_thumbnail);
+    }
+}
+
 // detect if frameNumber reach or beyond the right edge for screenshot in the range.
 // return:
 //       if frameNumber is already the last screenshot frame of the range(mean no another screenshot frame number >frameNumber and
@@ -318,6 +937,35 @@ static bool isEndOfScreenShotFrameRange(int frameNumber, FrameRange *pFrameRange
     return endOfScreenShotFrameRange;
 }
 
+// Whether no frame is left to capture, in which case the swapchains and
+// their images are no longer tracked. Frames can always be requested while
+// there are triggers.
+static bool noScreenShotFramesLeft() {
+    return screenshotFramesReceived && screenshotFrames.empty() && !screenShotFrameRange.valid && !screenshotTrigger.enabled();
+}
+
+// Get the first frame from frameNumber on that is in the frame list or range,
+// or requested by a trigger, INT_MAX if there is none.
+static int findNextScreenShotFrame(int frameNumber) {
+    int nextFrame = frameNumber < triggeredFramesEnd ? frameNumber : INT_MAX;
+    auto it = screenshotFrames.lower_bound(frameNumber);
+    if (it != screenshotFrames.end()) {
+        nextFrame = *it;
+    }
+    if (screenShotFrameRange.valid) {
+        int rangeFrame = screenShotFrameRange.startFrame;
+        if (frameNumber > rangeFrame) {
+            int const interval = screenShotFrameRange.interval;
+            rangeFrame += (frameNumber - rangeFrame + interval - 1) / interval * interval;
+        }
+        int const endFrame = getEndFrameOfRange(&screenShotFrameRange);
+        if (endFrame == SCREEN_SHOT_FRAMES_UNLIMITED || rangeFrame <= endFrame) {
+            nextFrame = std::min(nextFrame, rangeFrame);
+        }
+    }
+    return nextFrame;
+}
+
 // Parse comma-separated frame list string into the set
 static void populate_frame_list(const char *vk_screenshot_frames) {
     string spec(vk_screenshot_frames), word;
@@ -353,6 +1001,9 @@ static void populate_frame_list(const char *vk_screenshot_frames) {
     }
 
     screenshotFramesReceived = true;
+
+    // Have the next present look at the new frames.
+    nextLockedFrameNumber.store(0);
 }
 
 void readScreenShotFrames(void) {
@@ -397,26 +1048,74 @@ static bool memory_type_from_properties(VkPhysicalDeviceMemoryProperties *memory
     return false;
 }
 
-static DispatchMapStruct *get_dispatch_info(VkDevice dev) {
-    auto it = dispatchMap.find(dev);
-    if (it == dispatchMap.end())
-        return NULL;
-    else
-        return it->second;
+// Find the memory type to read captures back from. The rows of a capture
+// are read several times faster from host-cached memory than from the
+// write-combined memory most other host-visible types are, on discrete and
+// mobile GPUs alike, so cached memory ranks first, then memory that is not
+// device-local, which would be read across the bus, then coherent memory,
+// which needs no invalidate.
+static bool readback_memory_type_from_properties(VkPhysicalDeviceMemoryProperties *memory_properties, uint32_t typeBits,
+                                                 uint32_t *typeIndex) {
+    int bestRank = -1;
+    for (uint32_t i = 0; i < memory_properties->memoryTypeCount; i++) {
+        if ((typeBits & (1u << i)) == 0) continue;
+        VkMemoryPropertyFlags const flags = memory_properties->memoryTypes[i].propertyFlags;
+        if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0) continue;
+        int const rank = ((flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) ? 4 : 0) +
+                         ((flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ? 0 : 2) +
+                         ((flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) ? 1 : 0);
+        if (rank > bestRank) {
+            bestRank = rank;
+            *typeIndex = i;
+        }
+    }
+    return bestRank >= 0;
 }
 
-static DeviceMapStruct *get_device_info(VkDevice dev) {
-    auto it = deviceMap.find(dev);
-    if (it == deviceMap.end())
-        return NULL;
-    else
-        return it->second;
+static DispatchMapStruct *get_dispatch_info(VkDevice dev) { return dispatchMap.find(dev); }
+
+static DeviceMapStruct *get_device_info(VkDevice dev) { return deviceMap.find(dev); }
+
+static VkInstance get_instance(VkPhysicalDevice physicalDevice) { return physDeviceMap.find(physicalDevice)->instance; }
+
+// Maps a physical device to the instance it was last enumerated from.
+static void addPhysicalDevice(VkPhysicalDevice physicalDevice, VkInstance instance) {
+    PhysDeviceMapStruct *physDeviceMapElem = physDeviceMap.find(physicalDevice);
+    if (physDeviceMapElem == NULL) {
+        std::unique_ptr<PhysDeviceMapStruct> created(new PhysDeviceMapStruct{instance});
+        physDeviceMapElem = physDeviceMap.insert(physicalDevice, created.get());
+        if (physDeviceMapElem == created.get()) created.release();
+    }
+    physDeviceMapElem->instance = instance;
+}
+
+// Maps a dispatchable object created from a device to the device's dispatch
+// table, replacing the mapping of a destroyed object with the same handle.
+static void addDispatchableObject(void *object, DispatchMapStruct *dispMap) {
+    VkDevice key = static_cast<VkDevice>(object);
+    dispatchMap.erase(key);
+    dispatchMap.insert(key, dispMap);
 }
 
 static void init_screenshot() {
     readScreenShotFormatENV();
+    readScreenShotFileFormat();
+    readScreenShotDownscale();
+    readScreenShotRegion();
+    readScreenShotThumbnail();
+    readScreenShotImages();
     readScreenShotDir();
+    readScreenShotSkipDuplicates();
+    readScreenShotReferences();
+    readScreenShotTiming();
+    readScreenShotSharedMemory();
+    readScreenShotQueueFrames();
+    readScreenShotQueueSize();
+    readScreenShotBackpressure();
+    screenshotEncoder.limitQueue(screenshotQueueFrames, static_cast<size_t>(screenshotQueueMegabytes) * 1024 * 1024,
+                                 screenshotBackpressure);
     readScreenShotFrames();
+    readScreenShotTriggers();
 }
 
 VkQueue getQueueForScreenshot(VkDevice device) {
@@ -432,7 +1131,7 @@ VkQueue getQueueForScreenshot(VkDevice device) {
         return queue;
     }
 
-    pInstanceTable = instance_dispatch_table(physDeviceMap[devMap->physicalDevice]->instance);
+    pInstanceTable = instance_dispatch_table(get_instance(devMap->physicalDevice));
     assert(pInstanceTable);
     pInstanceTable->GetPhysicalDeviceQueueFamilyProperties(devMap->physicalDevice, &count, NULL);
 
@@ -447,14 +1146,13 @@ VkQueue getQueueForScreenshot(VkDevice device) {
         pInstanceTable->GetPhysicalDeviceQueueFamilyProperties(devMap->physicalDevice, &count, queueProps.data());
 
         // Iterate over all queues for this device, searching for a queue that is graphics and present capable
-        deviceMap[device]->queues.begin();
-        for (auto it = deviceMap[device]->queues.begin(); it != deviceMap[device]->queues.end(); it++) {
+        for (auto it = devMap->queues.begin(); it != devMap->queues.end(); it++) {
             queue = *it;
-            graphicsCapable = ((queueProps[deviceMap[device]->queueIndexMap[queue]].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0);
+            graphicsCapable = ((queueProps[devMap->queueIndexMap[queue]].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0);
 #if defined(_WIN32)
             presentCapable =
                 instance_dispatch_table(devMap->physicalDevice)
-                    ->GetPhysicalDeviceWin32PresentationSupportKHR(devMap->physicalDevice, deviceMap[device]->queueIndexMap[queue]);
+                    ->GetPhysicalDeviceWin32PresentationSupportKHR(devMap->physicalDevice, devMap->queueIndexMap[queue]);
 #elif not defined(__ANDROID__)
             // Everthing else not Windows or Android
             // TODO: Make a function call to get present support from vkGetPhysicalDeviceXlibPresentationSupportKHR,
@@ -467,94 +1165,243 @@ VkQueue getQueueForScreenshot(VkDevice device) {
     return queue;
 }
 
-// Track allocated resources in writePPM()
-// and clean them up when they go out of scope.
-struct WritePPMCleanupData {
+struct ScreenshotPool;
+
+// A part of the swapchain images that is captured to a file of its own: its
+// region, and where it is copied to, scaled down, in the image the views are
+// blitted to and in the capture buffer. The views are stacked in the image,
+// and follow each other in the buffer, each packed tightly, so that they are
+// all copied at once.
+struct ScreenshotView {
+    VkRect2D region;
+    VkRect2D output;
+    VkDeviceSize bufferOffset;
+};
+
+// The resources to capture a frame of a swapchain: the image the swapchain
+// image is blitted to if it is converted, the buffer it is then copied to,
+// which stays mapped, and the command buffer, fence and semaphore of the
+// copy. A capture is reused for the later frames
+// of its swapchain once its file has been written.
+//
+// While it is in flight, the fence tells when the copy is done and the file
+// can be written, and the semaphore holds the present back until the copy
+// has read the image.
+struct ScreenshotCapture {
+    ScreenshotPool *pool;
+    std::string fileName;
+    int frameNumber;
+    bool inFlight;
     VkDevice device;
     VulDeviceDispatchTable *pTableDevice;
     VkImage image2;
-    VkImage image3;
     VkDeviceMemory mem2;
-    VkDeviceMemory mem3;
-    bool mem2mapped;
-    bool mem3mapped;
+    VkBuffer buffer;
+    VkDeviceMemory bufferMem;
+    bool bufferMapped;
+    bool bufferCoherent;  // the mapped memory need not be invalidated
+    bool bufferCached;
+    uint32_t bufferMemoryType;
+    const char *mappedData;
     VkCommandBuffer commandBuffer;
     VkCommandPool commandPool;
-    ~WritePPMCleanupData();
+    VkFence fence;
+    VkSemaphore semaphore;
+    std::chrono::steady_clock::time_point submitTime;
+    ScreenshotTiming timing;
+    ~ScreenshotCapture();
 };
 
-WritePPMCleanupData::~WritePPMCleanupData() {
-    if (mem2mapped) pTableDevice->UnmapMemory(device, mem2);
+ScreenshotCapture::~ScreenshotCapture() {
     if (mem2) pTableDevice->FreeMemory(device, mem2, NULL);
     if (image2) pTableDevice->DestroyImage(device, image2, NULL);
 
-    if (mem3mapped) pTableDevice->UnmapMemory(device, mem3);
-    if (mem3) pTableDevice->FreeMemory(device, mem3, NULL);
-    if (image3) pTableDevice->DestroyImage(device, image3, NULL);
+    if (bufferMapped) pTableDevice->UnmapMemory(device, bufferMem);
+    if (bufferMem) pTableDevice->FreeMemory(device, bufferMem, NULL);
+    if (buffer) pTableDevice->DestroyBuffer(device, buffer, NULL);
+
+    if (commandBuffer) {
+        dispatchMap.erase(static_cast<VkDevice>(static_cast<void *>(commandBuffer)));
+        pTableDevice->FreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+    }
+
+    if (fence) pTableDevice->DestroyFence(device, fence, NULL);
+    if (semaphore) pTableDevice->DestroySemaphore(device, semaphore, NULL);
+}
+
+// The capture resources of a swapchain. They only depend on the extent and
+// format of the swapchain images, so they are created with the swapchain and
+// handed over to a swapchain re-created with the same extent and format. The
+// captures are created the first time they are needed, up to
+// maxPendingScreenshots of them, and then reused.
+struct ScreenshotPool {
+    VkDevice device;
+    VkExtent2D extent;
+    vector<ScreenshotView> views;
+    VkExtent2D outputExtent;  // of the image the views are blitted to, which holds them all
+    VkDeviceSize bufferSize;  // of the capture buffers, which hold all the views
+    VkFilter filter;
+    VkFormat format;
+    VkFormat destformat;
+    uint32_t numChannels;
+    uint32_t texelSize;  // of destformat, in bytes
+    bool floatReadback;  // destformat is VK_FORMAT_R32G32B32A32_SFLOAT, for the high bit depth file formats
+    bool copyOnly;
+    VkQueue queue;
+    uint32_t queueFamilyIndex;  // of queue, and of the command pool
+    uint32_t streamIndex;       // numbers the file of the swapchain in the Y4M format
+    DispatchMapStruct *dispMap;
+    VkCommandPool commandPool;
+    vector<unique_ptr<ScreenshotCapture>> captures;
+    ~ScreenshotPool();
+};
 
-    if (commandBuffer) pTableDevice->FreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-    if (commandPool) pTableDevice->DestroyCommandPool(device, commandPool, NULL);
+ScreenshotPool::~ScreenshotPool() {
+    captures.clear();
+    if (commandPool) dispMap->device_dispatch_table->DestroyCommandPool(device, commandPool, NULL);
 }
 
-// Save an image to a PPM image file.
+// unordered map: associates a swapchain with its capture resources
+static unordered_map<VkSwapchainKHR, ScreenshotPool *> screenshotPoolMap;
+
+// The images captured by name. Their layout is only known from the command
+// buffers of the application, so each command buffer records the layouts it
+// leaves the named images in, with its barriers and the final layouts of its
+// render passes, and a submit applies them in order. The extents and formats
+// of the images, their views and the attachments of the framebuffers and
+// render passes are tracked to that end while images are named.
+// Guarded by namedImageLock, which is never held with globalLock.
+typedef struct {
+    VkDevice device;
+    VkExtent2D imageExtent;
+    VkFormat format;
+    string name;
+    VkImageLayout layout;  // once the submits so far have executed
+} NamedImageStruct;
+static unordered_map<VkImage, NamedImageStruct> namedImageMap;
+static unordered_map<VkImage, ImageMapStruct> createdImageMap;
+static unordered_map<VkImageView, VkImage> imageViewMap;
+static unordered_map<VkFramebuffer, vector<VkImageView>> framebufferMap;
+static unordered_map<VkRenderPass, vector<VkImageLayout>> renderPassMap;  // final layouts of the attachments
+
+typedef struct {
+    VulDeviceDispatchTable *device_dispatch_table;
+    VkCommandPool commandPool;
+    unordered_map<VkImage, VkImageLayout> layouts;  // of the named images, once the command buffer has executed
+} CommandBufferMapStruct;
+static unordered_map<VkCommandBuffer, CommandBufferMapStruct> commandBufferMap;
+static std::mutex namedImageLock;
+
+// The capture resources of the named images, and the frame each was last
+// captured in, so that an image written by several submits of a frame is
+// captured after the first one. Guarded by globalLock.
+typedef struct {
+    ScreenshotPool *pool;
+    int capturedFrame;
+    bool warnedLayout;
+} NamedImagePoolStruct;
+static unordered_map<VkImage, NamedImagePoolStruct> namedImagePoolMap;
+
+// Captures whose copy is in flight, in the order they were submitted.
+static deque<ScreenshotCapture *> pendingScreenshots;
+
+// Most captures that can be in flight at a time. Once there are this many,
+// the present waits for the oldest one before submitting a new one.
+static const size_t maxPendingScreenshots = 4;
+
+// The present of a captured frame waits on the semaphore of its capture. The
+// capture is only reused once this many later frames have been presented, by
+// which time the presentation engine is done waiting on the semaphore.
+static const int screenshotRetireFrames = 2;
+
+// Whether red and blue are swapped in a format, so that the layer swaps them
+// back when the file is written.
+static bool formatIsBGR(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_B8G8R8_UNORM:
+        case VK_FORMAT_B8G8R8_SNORM:
+        case VK_FORMAT_B8G8R8_USCALED:
+        case VK_FORMAT_B8G8R8_SSCALED:
+        case VK_FORMAT_B8G8R8_UINT:
+        case VK_FORMAT_B8G8R8_SINT:
+        case VK_FORMAT_B8G8R8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SNORM:
+        case VK_FORMAT_B8G8R8A8_USCALED:
+        case VK_FORMAT_B8G8R8A8_SSCALED:
+        case VK_FORMAT_B8G8R8A8_UINT:
+        case VK_FORMAT_B8G8R8A8_SINT:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// The format of a BGR format with red and blue in RGB order, the format
+// itself for other formats.
+static VkFormat formatAsRGB(VkFormat format) {
+    if (!formatIsBGR(format)) return format;
+    // The R8G8B8 and R8G8B8A8 formats are in the same order as their B8G8R8
+    // and B8G8R8A8 counterparts, right before them.
+    static_assert(VK_FORMAT_B8G8R8A8_UNORM - VK_FORMAT_R8G8B8A8_UNORM == VK_FORMAT_B8G8R8_UNORM - VK_FORMAT_R8G8B8_UNORM,
+                  "BGR formats are not as far from their RGB counterparts");
+    return static_cast<VkFormat>(format - (VK_FORMAT_B8G8R8_UNORM - VK_FORMAT_R8G8B8_UNORM));
+}
+
+// Create the capture resources for the images of a swapchain.
 //
-// This function issues commands to copy/convert the swapchain image
-// from whatever compatible format the swapchain image uses
-// to a single format (VK_FORMAT_R8G8B8A8_UNORM) so that the converted
-// result can be easily written to a PPM file.
+// The swapchain images are copied/converted from whatever compatible format
+// the swapchain image uses to a single format (VK_FORMAT_R8G8B8A8_UNORM) so
+// that the converted result can be easily written to an image file. This picks
+// that format and how to convert to it, and creates the command pool of the
+// copies for the family of the given queue, the queue that presents the
+// swapchain if it is known. Without one, a graphics and present capable queue
+// is picked.
 //
 // Error handling: If there is a problem, this function should silently
 // fail without affecting the Present operation going on in the caller.
 // The numerous debug asserts are to catch programming errors and are not
-// expected to assert.  Recovery and clean up are implemented for image memory
-// allocation failures.
+// expected to assert.
 // (TODO) It would be nice to pass any failure info to DebugReport or something.
 //
-// Returns true if file is successfully written, false otherwise.
+// Returns the pool, nullptr if the swapchain cannot be captured.
 //
-static bool writePPM(const char *filename, VkImage image1) {
+static ScreenshotPool *createScreenshotPool(VkDevice device, VkExtent2D extent, VkFormat format, VkQueue queue) {
     VkResult err;
-    bool pass;
-
-    // Bail immediately if we can't find the image.
-    if (imageMap.empty() || imageMap.find(image1) == imageMap.end()) return false;
 
     // Collect object info from maps.  This info is generally recorded
     // by the other functions hooked in this layer.
-    VkDevice device = imageMap[image1]->device;
-    VkPhysicalDevice physicalDevice = deviceMap[device]->physicalDevice;
-    VkInstance instance = physDeviceMap[physicalDevice]->instance;
+    DeviceMapStruct *devMap = get_device_info(device);
+    VkPhysicalDevice physicalDevice = devMap->physicalDevice;
+    VkInstance instance = get_instance(physicalDevice);
     DispatchMapStruct *dispMap = get_dispatch_info(device);
     if (NULL == dispMap) {
         assert(0);
-        return false;
+        return nullptr;
+    }
+    if (queue == VK_NULL_HANDLE || devMap->queueIndexMap.count(queue) == 0) {
+        queue = getQueueForScreenshot(device);
     }
-    VkQueue queue = getQueueForScreenshot(device);
     if (!queue) {
 #ifdef ANDROID
         __android_log_print(ANDROID_LOG_ERROR, "screenshot", "Failure - capable queue not found\n");
 #else
         fprintf(stderr, "screenshot: Could not find a capable queue\n");
 #endif
-        return false;
+        return nullptr;
     }
     VulDeviceDispatchTable *pTableDevice = dispMap->device_dispatch_table;
-    VulDeviceDispatchTable *pTableQueue =
-        get_dispatch_info(static_cast<VkDevice>(static_cast<void *>(queue)))->device_dispatch_table;
     VulInstanceDispatchTable *pInstanceTable;
     pInstanceTable = instance_dispatch_table(instance);
 
-    // Gather incoming image info and check image format for compatibility with
-    // the target format.
+    // Check image format for compatibility with the target format.
     // This function supports both 24-bit and 32-bit swapchain images.
-    uint32_t const width = imageMap[image1]->imageExtent.width;
-    uint32_t const height = imageMap[image1]->imageExtent.height;
-    VkFormat const format = imageMap[image1]->format;
     uint32_t const numChannels = FormatComponentCount(format);
 
     if ((3 != numChannels) && (4 != numChannels)) {
         assert(0);
-        return false;
+        return nullptr;
     }
 
     // Initial dest format is undefined as we will look for one
@@ -674,6 +1521,40 @@ static bool writePPM(const char *filename, VkImage image1) {
             destformat = VK_FORMAT_R8G8B8_UNORM;
     }
 
+    // A swapchain format that only differs from the target format in the
+    // order of red and blue is copied as is, and red and blue are swapped
+    // when the file is written, which saves the blit.
+    if (formatAsRGB(format) == destformat) {
+        destformat = format;
+    }
+
+    // The high bit depth file formats are read back as 32-bit floats, which
+    // any color format is blitted to without losing bits, except for PPM16 of
+    // the sRGB formats, which all have 8 bits per channel and are read back as
+    // they are, so that they are not made linear. RAW is read back in the
+    // format of the swapchain itself.
+    bool const floatReadback = screenshotFileFormat == SCREENSHOT_FILE_FORMAT_PFM ||
+                               (screenshotFileFormat == SCREENSHOT_FILE_FORMAT_PPM16 && !FormatIsSRGB(format));
+    if (screenshotFileFormat == SCREENSHOT_FILE_FORMAT_RAW) {
+        destformat = format;
+#ifdef ANDROID
+        __android_log_print(ANDROID_LOG_INFO, "screenshot", "Raw captures are in %s\n", string_VkFormat(format));
+#else
+        printf("screenshot: Raw captures are in %s\n", string_VkFormat(format));
+#endif
+    } else if (floatReadback) {
+        if (FormatIsUINT(format) || FormatIsSINT(format)) {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_DEBUG, "screenshot",
+                                "Integer formats cannot be captured as floats, screen capture failed");
+#else
+            fprintf(stderr, "screenshot: Integer formats cannot be captured as floats, screen capture failed\n");
+#endif
+            return nullptr;
+        }
+        destformat = VK_FORMAT_R32G32B32A32_SFLOAT;
+    }
+
     // From vulkan spec:
     //   VUID-vkCmdBlitImage-srcImage-00229
     //     If either of srcImage or dstImage was created with a signed integer VkFormat,
@@ -699,103 +1580,170 @@ static bool writePPM(const char *filename, VkImage image1) {
         }
     }
 
-    if ((FormatCompatibilityClass(destformat) != FormatCompatibilityClass(format))) {
+    if (!floatReadback && (FormatCompatibilityClass(destformat) != FormatCompatibilityClass(format))) {
         assert(0);
-        return false;
+        return nullptr;
     }
 
     // General Approach
     //
-    // The idea here is to copy/convert the swapchain image into another image
-    // that can be mapped and read by the CPU to produce a PPM file.
-    // The image must be untiled and converted to a specific format for easy
-    // parsing.  The memory for the final image must be host-visible.
+    // The idea here is to copy/convert the swapchain image into a buffer that
+    // stays mapped, so that the CPU reads the pixels of each view packed
+    // tightly, in a specific format for easy parsing. The memory of the
+    // buffer must be host-visible, and is host-cached where the device has
+    // such memory, as it is only read by the CPU.
     // Note that in Vulkan, a BLIT operation must be used to perform a format
-    // conversion.
-    //
-    // Devices vary in their ability to blit to/from linear and optimal tiling.
-    // So we must query the device properties to get this information.
+    // conversion, and that a BLIT cannot write to a buffer.
     //
-    // If the device cannot BLIT to a LINEAR image, then the operation must be
-    // done in two steps:
-    // 1) BLIT the swapchain image (image1) to a temp image (image2) that is
-    // created with TILING_OPTIMAL.
-    // 2) COPY image2 to another temp image (image3) that is created with
-    // TILING_LINEAR.
-    // 3) Map image 3 and write the PPM file.
+    // If the incoming and target formats are the same, the swapchain image
+    // (image1) is just COPIED to the buffer.
     //
-    // If the device can BLIT to a LINEAR image, then:
-    // 1) BLIT the swapchain image (image1) to a temp image (image2) that is
-    // created with TILING_LINEAR.
-    // 2) Map image 2 and write the PPM file.
+    // Otherwise, the operation is done in two steps:
+    // 1) BLIT image1 to a temp image (image2) that is created with
+    // TILING_OPTIMAL.
+    // 2) COPY image2 to the buffer.
     //
     // There seems to be no way to tell if the swapchain image (image1) is tiled
     // or not.  We therefore assume that the BLIT operation can always read from
     // both linear and optimal tiled (swapchain) images.
     // There is therefore no point in looking at the BLIT_SRC properties.
     //
-    // There is also the optimization where the incoming and target formats are
-    // the same.  In this case, just do a COPY.
+    // The BLIT also crops and scales down the image to the regions and
+    // downscale the user asked for, so that less is read back. A COPY can
+    // crop, but downscaled views are always BLITted.
+
+    // The offsets of the views in the buffer are aligned to both their texels
+    // and 4 bytes, as copies to buffers need on some queues.
+    vector<ScreenshotView> views;
+    VkExtent2D outputExtent = {0, 0};
+    VkDeviceSize bufferSize = 0;
+    uint32_t const texelSize = FormatElementSize(destformat);
+    VkDeviceSize const bufferAlignment = 4 * texelSize;
+    auto addView = [&views, &outputExtent, &bufferSize, bufferAlignment, texelSize](VkRect2D region, uint32_t downscale) {
+        ScreenshotView view;
+        view.region = region;
+        view.output.offset = {0, static_cast<int32_t>(outputExtent.height)};
+        view.output.extent = {std::max(region.extent.width / downscale, 1u), std::max(region.extent.height / downscale, 1u)};
+        view.bufferOffset = (bufferSize + bufferAlignment - 1) / bufferAlignment * bufferAlignment;
+        outputExtent.width = std::max(outputExtent.width, view.output.extent.width);
+        outputExtent.height += view.output.extent.height;
+        bufferSize = view.bufferOffset + VkDeviceSize(view.output.extent.width) * view.output.extent.height * texelSize;
+        views.push_back(view);
+    };
+    for (const VkRect2D &userRegion : screenshotRegions) {
+        if (static_cast<uint32_t>(userRegion.offset.x) >= extent.width ||
+            static_cast<uint32_t>(userRegion.offset.y) >= extent.height) {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_INFO, "screenshot", "Region is outside of the swapchain images, it will be ignored\n");
+#else
+            fprintf(stderr, "screenshot: Region is outside of the swapchain images, it will be ignored\n");
+#endif
+            continue;
+        }
+        VkRect2D region;
+        region.offset = userRegion.offset;
+        region.extent.width = std::min(userRegion.extent.width, extent.width - region.offset.x);
+        region.extent.height = std::min(userRegion.extent.height, extent.height - region.offset.y);
+        addView(region, screenshotDownscale);
+    }
+    if (views.empty()) {
+        addView({{0, 0}, extent}, screenshotDownscale);
+    }
+    if (screenshotThumbnailDownscale > 0) {
+        addView({{0, 0}, extent}, screenshotThumbnailDownscale);
+    }
+    bool scaled = false;
+    for (const ScreenshotView &view : views) {
+        scaled |= view.output.extent.width != view.region.extent.width || view.output.extent.height != view.region.extent.height;
+    }
+
+    // Average the pixels when scaling down, if the swapchain format can be
+    // filtered.
+    VkFormatProperties sourceFormatProps;
+    pInstanceTable->GetPhysicalDeviceFormatProperties(physicalDevice, format, &sourceFormatProps);
+    VkFilter const filter =
+        scaled && (sourceFormatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR
+                                                                                                               : VK_FILTER_NEAREST;
 
     VkFormatProperties targetFormatProps;
     pInstanceTable->GetPhysicalDeviceFormatProperties(physicalDevice, destformat, &targetFormatProps);
-    bool need2steps = false;
-    bool copyOnly = false;
-    if (destformat == format) {
-        copyOnly = true;
-    } else {
-        bool const bltLinear = targetFormatProps.linearTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT;
-        bool const bltOptimal = targetFormatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT;
-        if (!bltLinear && !bltOptimal) {
-            // Cannot blit to either target tiling type.  It should be pretty
-            // unlikely to have a device that cannot blit to either type.
-            // This should be quite rare. Punt.
+    bool const copyOnly = destformat == format && !scaled;
+    if (!copyOnly && !(targetFormatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT)) {
+        // Cannot blit to the target format.  It should be pretty unlikely to
+        // have a device that cannot.  This should be quite rare. Punt.
 #ifdef ANDROID
-            __android_log_print(ANDROID_LOG_DEBUG, "screenshot", "Output format not supported, screen capture failed");
+        __android_log_print(ANDROID_LOG_DEBUG, "screenshot", "Output format not supported, screen capture failed");
 #else
-            fprintf(stderr, "screenshot: Output format not supported, screen capture failed\n");
+        fprintf(stderr, "screenshot: Output format not supported, screen capture failed\n");
 #endif
-            return false;
-        } else if (!bltLinear && bltOptimal) {
-            // Cannot blit to a linear target but can blt to optimal, so copy
-            // after blit is needed.
-            need2steps = true;
-        }
-        // Else bltLinear is available and only 1 step is needed.
+        return nullptr;
     }
 
     // Put resources that need to be cleaned up in a struct with a destructor
-    // so that things get cleaned up when this function is exited.
-    WritePPMCleanupData data = {};
-    data.device = device;
-    data.pTableDevice = pTableDevice;
+    // so that things get cleaned up if this function fails.
+    unique_ptr<ScreenshotPool> pool(new ScreenshotPool());
+    pool->device = device;
+    pool->extent = extent;
+    pool->views = views;
+    pool->outputExtent = outputExtent;
+    pool->bufferSize = bufferSize;
+    pool->filter = filter;
+    static uint32_t streamCount = 0;
+    pool->streamIndex = streamCount++;
+    pool->format = format;
+    pool->destformat = destformat;
+    pool->numChannels = numChannels;
+    pool->texelSize = texelSize;
+    pool->floatReadback = floatReadback;
+    pool->copyOnly = copyOnly;
+    pool->queue = queue;
+    pool->queueFamilyIndex = devMap->queueIndexMap[queue];
+    pool->dispMap = dispMap;
+
+    // We want to create our own command pool to be sure we can use it from this thread.
+    // The command buffer of a capture is recorded again for each of its frames.
+    VkCommandPoolCreateInfo cmd_pool_info = {};
+    cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cmd_pool_info.pNext = NULL;
+    cmd_pool_info.queueFamilyIndex = pool->queueFamilyIndex;
+    cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-    // Set up the image creation info for both the blit and copy images, in case
-    // both are needed.
-    VkImageCreateInfo imgCreateInfo2 = {
-        VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-        NULL,
-        0,
-        VK_IMAGE_TYPE_2D,
-        destformat,
-        {width, height, 1},
-        1,
-        1,
-        VK_SAMPLE_COUNT_1_BIT,
-        VK_IMAGE_TILING_LINEAR,
-        VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-        VK_SHARING_MODE_EXCLUSIVE,
-        0,
-        NULL,
-        VK_IMAGE_LAYOUT_UNDEFINED,
-    };
-    VkImageCreateInfo imgCreateInfo3 = imgCreateInfo2;
+    err = pTableDevice->CreateCommandPool(device, &cmd_pool_info, NULL, &pool->commandPool);
+    assert(!err);
+    if (VK_SUCCESS != err) return nullptr;
 
-    // If we need both images, set up image2 to be read/write and tiled.
-    if (need2steps) {
-        imgCreateInfo2.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imgCreateInfo2.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-    }
+    return pool.release();
+}
+
+// Create a capture of a pool, with the image and buffer the swapchain images
+// are copied to and the command buffer, fence and semaphore of the copy.
+//
+// Returns the capture, which is added to the pool, nullptr if it could not be
+// created.
+//
+static ScreenshotCapture *createScreenshotCapture(ScreenshotPool *pool) {
+    VkResult err;
+    bool pass;
+
+    VkDevice device = pool->device;
+    VkPhysicalDevice physicalDevice = get_device_info(device)->physicalDevice;
+    VulInstanceDispatchTable *pInstanceTable = instance_dispatch_table(get_instance(physicalDevice));
+    DispatchMapStruct *dispMap = pool->dispMap;
+    VulDeviceDispatchTable *pTableDevice = dispMap->device_dispatch_table;
+    VulDeviceDispatchTable *pTableQueue =
+        get_dispatch_info(static_cast<VkDevice>(static_cast<void *>(pool->queue)))->device_dispatch_table;
+    uint32_t const width = pool->outputExtent.width;
+    uint32_t const height = pool->outputExtent.height;
+    VkFormat const destformat = pool->destformat;
+
+    // Put resources that need to be cleaned up in a struct with a destructor
+    // so that things get cleaned up if this function fails.
+    unique_ptr<ScreenshotCapture> capture(new ScreenshotCapture());
+    ScreenshotCapture &data = *capture;
+    data.pool = pool;
+    data.device = device;
+    data.pTableDevice = pTableDevice;
+    data.commandPool = pool->commandPool;
 
     VkMemoryAllocateInfo memAllocInfo = {
         VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL,
@@ -804,74 +1752,85 @@ static bool writePPM(const char *filename, VkImage image1) {
     };
     VkMemoryRequirements memRequirements;
     VkPhysicalDeviceMemoryProperties memoryProperties;
-
-    // Create image2 and allocate its memory.  It could be the intermediate or
-    // final image.
-    err = pTableDevice->CreateImage(device, &imgCreateInfo2, NULL, &data.image2);
-    assert(!err);
-    if (VK_SUCCESS != err) return false;
-    pTableDevice->GetImageMemoryRequirements(device, data.image2, &memRequirements);
-    memAllocInfo.allocationSize = memRequirements.size;
     pInstanceTable->GetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
-    pass = memory_type_from_properties(&memoryProperties, memRequirements.memoryTypeBits,
-                                       need2steps ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-                                       &memAllocInfo.memoryTypeIndex);
-    assert(pass);
-    (void)pass;
-    err = pTableDevice->AllocateMemory(device, &memAllocInfo, NULL, &data.mem2);
-    assert(!err);
-    if (VK_SUCCESS != err) return false;
-    err = pTableQueue->BindImageMemory(device, data.image2, data.mem2, 0);
-    assert(!err);
-    if (VK_SUCCESS != err) return false;
 
-    // Create image3 and allocate its memory, if needed.
-    if (need2steps) {
-        err = pTableDevice->CreateImage(device, &imgCreateInfo3, NULL, &data.image3);
+    // Create image2, the views are blitted to, and allocate its memory, if
+    // needed.
+    if (!pool->copyOnly) {
+        const VkImageCreateInfo imgCreateInfo2 = {
+            VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            NULL,
+            0,
+            VK_IMAGE_TYPE_2D,
+            destformat,
+            {width, height, 1},
+            1,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_SHARING_MODE_EXCLUSIVE,
+            0,
+            NULL,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+        err = pTableDevice->CreateImage(device, &imgCreateInfo2, NULL, &data.image2);
         assert(!err);
-        if (VK_SUCCESS != err) return false;
-        pTableDevice->GetImageMemoryRequirements(device, data.image3, &memRequirements);
+        if (VK_SUCCESS != err) return nullptr;
+        pTableDevice->GetImageMemoryRequirements(device, data.image2, &memRequirements);
         memAllocInfo.allocationSize = memRequirements.size;
-        pInstanceTable->GetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
-        pass = memory_type_from_properties(&memoryProperties, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        pass = memory_type_from_properties(&memoryProperties, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                            &memAllocInfo.memoryTypeIndex);
         assert(pass);
         (void)pass;
-        err = pTableDevice->AllocateMemory(device, &memAllocInfo, NULL, &data.mem3);
+        err = pTableDevice->AllocateMemory(device, &memAllocInfo, NULL, &data.mem2);
         assert(!err);
-        if (VK_SUCCESS != err) return false;
-        err = pTableQueue->BindImageMemory(device, data.image3, data.mem3, 0);
+        if (VK_SUCCESS != err) return nullptr;
+        err = pTableQueue->BindImageMemory(device, data.image2, data.mem2, 0);
         assert(!err);
-        if (VK_SUCCESS != err) return false;
+        if (VK_SUCCESS != err) return nullptr;
     }
 
-    // We want to create our own command pool to be sure we can use it from this thread
-    VkCommandPoolCreateInfo cmd_pool_info = {};
-    cmd_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    cmd_pool_info.pNext = NULL;
-    auto it = deviceMap[device]->queueIndexMap.find(queue);
-    assert(it != deviceMap[device]->queueIndexMap.end());
-    cmd_pool_info.queueFamilyIndex = it->second;
-    cmd_pool_info.flags = 0;
-
-    err = pTableDevice->CreateCommandPool(device, &cmd_pool_info, NULL, &data.commandPool);
+    // Create the buffer the views are read from and allocate its memory,
+    // host-cached if possible, as reading uncached memory is slow. The type
+    // is reported with the timing of the captures.
+    const VkBufferCreateInfo bufferCreateInfo = {
+        VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        NULL,
+        0,
+        pool->bufferSize,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_SHARING_MODE_EXCLUSIVE,
+        0,
+        NULL,
+    };
+    err = pTableDevice->CreateBuffer(device, &bufferCreateInfo, NULL, &data.buffer);
+    assert(!err);
+    if (VK_SUCCESS != err) return nullptr;
+    pTableDevice->GetBufferMemoryRequirements(device, data.buffer, &memRequirements);
+    memAllocInfo.allocationSize = memRequirements.size;
+    pass = readback_memory_type_from_properties(&memoryProperties, memRequirements.memoryTypeBits, &memAllocInfo.memoryTypeIndex);
+    assert(pass);
+    if (!pass) return nullptr;
+    VkMemoryPropertyFlags const bufferMemoryFlags = memoryProperties.memoryTypes[memAllocInfo.memoryTypeIndex].propertyFlags;
+    data.bufferCoherent = bufferMemoryFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    data.bufferCached = bufferMemoryFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    data.bufferMemoryType = memAllocInfo.memoryTypeIndex;
+    err = pTableDevice->AllocateMemory(device, &memAllocInfo, NULL, &data.bufferMem);
     assert(!err);
+    if (VK_SUCCESS != err) return nullptr;
+    err = pTableDevice->BindBufferMemory(device, data.buffer, data.bufferMem, 0);
+    assert(!err);
+    if (VK_SUCCESS != err) return nullptr;
 
     // Set up the command buffer.
     const VkCommandBufferAllocateInfo allocCommandBufferInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, NULL,
                                                                 data.commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1};
     err = pTableDevice->AllocateCommandBuffers(device, &allocCommandBufferInfo, &data.commandBuffer);
     assert(!err);
-    if (VK_SUCCESS != err) return false;
+    if (VK_SUCCESS != err) return nullptr;
 
-    VkDevice cmdBuf = static_cast<VkDevice>(static_cast<void *>(data.commandBuffer));
-    if (deviceMap.find(cmdBuf) != deviceMap.end()) {
-        // Remove element with key cmdBuf from deviceMap so we can replace it
-        deviceMap.erase(cmdBuf);
-    }
-    dispatchMap.emplace(cmdBuf, dispMap);
-    VulDeviceDispatchTable *pTableCommandBuffer;
-    pTableCommandBuffer = get_dispatch_info(cmdBuf)->device_dispatch_table;
+    addDispatchableObject(data.commandBuffer, dispMap);
 
     // We have just created a dispatchable object, but the dispatch table has
     // not been placed in the object yet.  When a "normal" application creates
@@ -884,28 +1843,125 @@ static bool writePPM(const char *filename, VkImage image1) {
         assert(!err);
     }
 
+    const VkFenceCreateInfo fenceCreateInfo = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, NULL, 0};
+    err = pTableDevice->CreateFence(device, &fenceCreateInfo, NULL, &data.fence);
+    assert(!err);
+    if (VK_SUCCESS != err) return nullptr;
+    const VkSemaphoreCreateInfo semaphoreCreateInfo = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, NULL, 0};
+    err = pTableDevice->CreateSemaphore(device, &semaphoreCreateInfo, NULL, &data.semaphore);
+    assert(!err);
+    if (VK_SUCCESS != err) return nullptr;
+
+    // Map the buffer so that the CPU can read it. It stays mapped for as long
+    // as the capture is kept.
+    err = pTableDevice->MapMemory(device, data.bufferMem, 0, VK_WHOLE_SIZE, 0, (void **)&data.mappedData);
+    assert(!err);
+    if (VK_SUCCESS != err) return nullptr;
+    data.bufferMapped = true;
+
+    pool->captures.push_back(std::move(capture));
+    return &data;
+}
+
+// Get the capture resources of a swapchain, creating them for the queue if
+// needed.
+static ScreenshotPool *getScreenshotPool(VkSwapchainKHR swapchain, VkDevice device, VkExtent2D extent, VkFormat format,
+                                         VkQueue queue) {
+    auto it = screenshotPoolMap.find(swapchain);
+    if (it != screenshotPoolMap.end()) return it->second;
+
+    ScreenshotPool *pool = createScreenshotPool(device, extent, format, queue);
+    if (pool) screenshotPoolMap[swapchain] = pool;
+    return pool;
+}
+
+// Submit the copy of an image of a pool for an image file, from the given
+// layout, which the image is left in.
+//
+// In a device group, the copy only runs on the physical device of the given
+// index, from the instance of the image on that device, so that it neither
+// copies across devices nor waits for the other devices.
+//
+// The copy is submitted on the presenting queue, unless the command pool of
+// the swapchain is for another queue family, in which case it is submitted on
+// the queue of the pool. For a swapchain image, it waits on the given
+// semaphores, those the present waits on, and signals the semaphore of the
+// capture, which the present then waits on instead. For a named image, it
+// follows the submit that wrote the image on its queue, and waits for all of
+// it. It also signals the fence of the capture, and
+// retireCompletedScreenshots() writes the file once the fence has signaled, so
+// nothing here waits for the GPU.
+//
+// Returns the capture, which is added to pendingScreenshots, if the copy is
+// successfully submitted, nullptr otherwise.
+//
+static ScreenshotCapture *submitCapture(ScreenshotPool *pool, const char *filename, int frameNumber, VkQueue presentQueue,
+                                        uint32_t deviceIndex, VkImage image1, VkImageLayout layout, bool signalSemaphore,
+                                        uint32_t waitSemaphoreCount, const VkSemaphore *pWaitSemaphores,
+                                        std::chrono::steady_clock::time_point submitStart) {
+    VkResult err;
+
+    ScreenshotCapture *capture = nullptr;
+    for (auto &poolCapture : pool->captures) {
+        if (!poolCapture->inFlight) {
+            capture = poolCapture.get();
+            break;
+        }
+    }
+    if (!capture) {
+        if (pool->captures.size() >= maxPendingScreenshots) {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_ERROR, "screenshot", "Failure - too many captures in flight for %s\n", filename);
+#else
+            fprintf(stderr, "screenshot: Too many captures in flight for %s\n", filename);
+#endif
+            return nullptr;
+        }
+        capture = createScreenshotCapture(pool);
+        if (!capture) return nullptr;
+    }
+    ScreenshotCapture &data = *capture;
+
+    VkDevice device = pool->device;
+    DeviceMapStruct *devMap = get_device_info(device);
+    auto presentQueueFamily = devMap->queueIndexMap.find(presentQueue);
+    bool const onPresentQueue =
+        presentQueueFamily != devMap->queueIndexMap.end() && presentQueueFamily->second == pool->queueFamilyIndex;
+    VkQueue queue = onPresentQueue ? presentQueue : pool->queue;
+    VulDeviceDispatchTable *pTableDevice = pool->dispMap->device_dispatch_table;
+    VulDeviceDispatchTable *pTableQueue =
+        get_dispatch_info(static_cast<VkDevice>(static_cast<void *>(queue)))->device_dispatch_table;
+    VulDeviceDispatchTable *pTableCommandBuffer =
+        get_dispatch_info(static_cast<VkDevice>(static_cast<void *>(data.commandBuffer)))->device_dispatch_table;
+    bool const copyOnly = pool->copyOnly;
+
+    bool const deviceGroup = devMap->physicalDeviceCount > 1;
+    uint32_t const deviceMask = 1u << deviceIndex;
+    const VkDeviceGroupCommandBufferBeginInfo deviceGroupBeginInfo = {VK_STRUCTURE_TYPE_DEVICE_GROUP_COMMAND_BUFFER_BEGIN_INFO,
+                                                                      NULL, deviceMask};
     const VkCommandBufferBeginInfo commandBufferBeginInfo = {
         VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        NULL,
+        deviceGroup ? &deviceGroupBeginInfo : NULL,
         VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
     };
     err = pTableCommandBuffer->BeginCommandBuffer(data.commandBuffer, &commandBufferBeginInfo);
     assert(!err);
 
-    // This barrier is used to transition from/to present Layout
+    // This barrier is used to transition from/to present Layout, or the
+    // layout of a named image
     VkImageMemoryBarrier presentMemoryBarrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
                                                  NULL,
                                                  VK_ACCESS_MEMORY_WRITE_BIT,
                                                  VK_ACCESS_TRANSFER_READ_BIT,
-                                                 VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                                 layout,
                                                  VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
                                                  VK_QUEUE_FAMILY_IGNORED,
                                                  VK_QUEUE_FAMILY_IGNORED,
                                                  image1,
                                                  {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
 
-    // This barrier is used to transition from a newly-created layout to a blt
-    // or copy destination layout.
+    // This barrier is used to transition image2 from a newly-created layout
+    // to a blt destination layout, and then to a copy source layout.
     VkImageMemoryBarrier destMemoryBarrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
                                               NULL,
                                               0,
@@ -917,175 +1973,355 @@ static bool writePPM(const char *filename, VkImage image1) {
                                               data.image2,
                                               {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
 
-    // This barrier is used to transition a dest layout to general layout.
-    VkImageMemoryBarrier generalMemoryBarrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-                                                 NULL,
-                                                 VK_ACCESS_TRANSFER_WRITE_BIT,
-                                                 VK_ACCESS_MEMORY_READ_BIT,
-                                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                                 VK_IMAGE_LAYOUT_GENERAL,
-                                                 VK_QUEUE_FAMILY_IGNORED,
-                                                 VK_QUEUE_FAMILY_IGNORED,
-                                                 data.image2,
-                                                 {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+    // This barrier is used to make the copy to the buffer visible to the host
+    // once the fence signals.
+    const VkBufferMemoryBarrier hostMemoryBarrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                                                     NULL,
+                                                     VK_ACCESS_TRANSFER_WRITE_BIT,
+                                                     VK_ACCESS_HOST_READ_BIT,
+                                                     VK_QUEUE_FAMILY_IGNORED,
+                                                     VK_QUEUE_FAMILY_IGNORED,
+                                                     data.buffer,
+                                                     0,
+                                                     VK_WHOLE_SIZE};
 
     VkPipelineStageFlags srcStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
     VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
 
+    // A named image is not waited for with a semaphore, so the copy waits for
+    // all the work submitted before it, and the work submitted after it waits
+    // for the copy.
+    VkPipelineStageFlags const imageStages = signalSemaphore ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
     // The source image needs to be transitioned from present to transfer
     // source.
-    pTableCommandBuffer->CmdPipelineBarrier(data.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, dstStages, 0, 0, NULL, 0,
-                                            NULL, 1, &presentMemoryBarrier);
+    pTableCommandBuffer->CmdPipelineBarrier(data.commandBuffer, imageStages, dstStages, 0, 0, NULL, 0, NULL, 1,
+                                            &presentMemoryBarrier);
 
-    // image2 needs to be transitioned from its undefined state to transfer
-    // destination.
-    pTableCommandBuffer->CmdPipelineBarrier(data.commandBuffer, srcStages, dstStages, 0, 0, NULL, 0, NULL, 1, &destMemoryBarrier);
+    // Each view is copied to the buffer packed tightly, from where it is in
+    // the swapchain image, or in image2 once it is blitted there.
+    std::vector<VkBufferImageCopy> viewBufferRegions(pool->views.size());
+    for (size_t i = 0; i < pool->views.size(); i++) {
+        const ScreenshotView &view = pool->views[i];
+        const VkOffset2D offset = copyOnly ? view.region.offset : view.output.offset;
+        viewBufferRegions[i] = {view.bufferOffset,
+                                0,
+                                0,
+                                {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+                                {offset.x, offset.y, 0},
+                                {view.output.extent.width, view.output.extent.height, 1}};
+    }
+    VkImage copySource = image1;
+
+    if (!copyOnly) {
+        // image2 needs to be transitioned from its undefined state to transfer
+        // destination.
+        pTableCommandBuffer->CmdPipelineBarrier(data.commandBuffer, srcStages, dstStages, 0, 0, NULL, 0, NULL, 1,
+                                                &destMemoryBarrier);
+
+        std::vector<VkImageBlit> viewBlitRegions(pool->views.size());
+        for (size_t i = 0; i < pool->views.size(); i++) {
+            const ScreenshotView &view = pool->views[i];
+            VkImageBlit &imageBlitRegion = viewBlitRegions[i];
+            imageBlitRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            imageBlitRegion.srcSubresource.baseArrayLayer = 0;
+            imageBlitRegion.srcSubresource.layerCount = 1;
+            imageBlitRegion.srcSubresource.mipLevel = 0;
+            imageBlitRegion.srcOffsets[0].x = view.region.offset.x;
+            imageBlitRegion.srcOffsets[0].y = view.region.offset.y;
+            imageBlitRegion.srcOffsets[0].z = 0;
+            imageBlitRegion.srcOffsets[1].x = view.region.offset.x + view.region.extent.width;
+            imageBlitRegion.srcOffsets[1].y = view.region.offset.y + view.region.extent.height;
+            imageBlitRegion.srcOffsets[1].z = 1;
+            imageBlitRegion.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            imageBlitRegion.dstSubresource.baseArrayLayer = 0;
+            imageBlitRegion.dstSubresource.layerCount = 1;
+            imageBlitRegion.dstSubresource.mipLevel = 0;
+            imageBlitRegion.dstOffsets[0].x = view.output.offset.x;
+            imageBlitRegion.dstOffsets[0].y = view.output.offset.y;
+            imageBlitRegion.dstOffsets[0].z = 0;
+            imageBlitRegion.dstOffsets[1].x = view.output.offset.x + view.output.extent.width;
+            imageBlitRegion.dstOffsets[1].y = view.output.offset.y + view.output.extent.height;
+            imageBlitRegion.dstOffsets[1].z = 1;
+        }
 
-    const VkImageCopy imageCopyRegion = {
-        {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1}, {0, 0, 0}, {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1}, {0, 0, 0}, {width, height, 1}};
+        pTableCommandBuffer->CmdBlitImage(data.commandBuffer, image1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, data.image2,
+                                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(viewBlitRegions.size()),
+                                          viewBlitRegions.data(), pool->filter);
+
+        // Transition image2 so that it can be read for the upcoming copy to
+        // the buffer.
+        destMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        destMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        destMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        destMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        pTableCommandBuffer->CmdPipelineBarrier(data.commandBuffer, srcStages, dstStages, 0, 0, NULL, 0, NULL, 1,
+                                                &destMemoryBarrier);
+        copySource = data.image2;
+    }
 
-    if (copyOnly) {
-        pTableCommandBuffer->CmdCopyImage(data.commandBuffer, image1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, data.image2,
-                                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageCopyRegion);
-    } else {
-        VkImageBlit imageBlitRegion = {};
-        imageBlitRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        imageBlitRegion.srcSubresource.baseArrayLayer = 0;
-        imageBlitRegion.srcSubresource.layerCount = 1;
-        imageBlitRegion.srcSubresource.mipLevel = 0;
-        imageBlitRegion.srcOffsets[1].x = width;
-        imageBlitRegion.srcOffsets[1].y = height;
-        imageBlitRegion.srcOffsets[1].z = 1;
-        imageBlitRegion.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        imageBlitRegion.dstSubresource.baseArrayLayer = 0;
-        imageBlitRegion.dstSubresource.layerCount = 1;
-        imageBlitRegion.dstSubresource.mipLevel = 0;
-        imageBlitRegion.dstOffsets[1].x = width;
-        imageBlitRegion.dstOffsets[1].y = height;
-        imageBlitRegion.dstOffsets[1].z = 1;
+    // This step essentially untiles the image.
+    pTableCommandBuffer->CmdCopyImageToBuffer(data.commandBuffer, copySource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, data.buffer,
+                                              static_cast<uint32_t>(viewBufferRegions.size()), viewBufferRegions.data());
 
-        pTableCommandBuffer->CmdBlitImage(data.commandBuffer, image1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, data.image2,
-                                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlitRegion, VK_FILTER_NEAREST);
-        if (need2steps) {
-            // image 3 needs to be transitioned from its undefined state to a
-            // transfer destination.
-            destMemoryBarrier.image = data.image3;
-            pTableCommandBuffer->CmdPipelineBarrier(data.commandBuffer, srcStages, dstStages, 0, 0, NULL, 0, NULL, 1,
-                                                    &destMemoryBarrier);
-
-            // Transition image2 so that it can be read for the upcoming copy to
-            // image 3.
-            destMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            destMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            destMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            destMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            destMemoryBarrier.image = data.image2;
-            pTableCommandBuffer->CmdPipelineBarrier(data.commandBuffer, srcStages, dstStages, 0, 0, NULL, 0, NULL, 1,
-                                                    &destMemoryBarrier);
-
-            // This step essentially untiles the image.
-            pTableCommandBuffer->CmdCopyImage(data.commandBuffer, data.image2, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, data.image3,
-                                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageCopyRegion);
-            generalMemoryBarrier.image = data.image3;
-        }
-    }
-
-    // The destination needs to be transitioned from the optimal copy format to
-    // the format we can read with the CPU.
-    pTableCommandBuffer->CmdPipelineBarrier(data.commandBuffer, srcStages, dstStages, 0, 0, NULL, 0, NULL, 1,
-                                            &generalMemoryBarrier);
+    pTableCommandBuffer->CmdPipelineBarrier(data.commandBuffer, srcStages, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, NULL, 1,
+                                            &hostMemoryBarrier, 0, NULL);
 
     // Restore the swap chain image layout to what it was before.
     // This may not be strictly needed, but it is generally good to restore
     // things to original state.
     presentMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-    presentMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    presentMemoryBarrier.newLayout = layout;
     presentMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
     presentMemoryBarrier.dstAccessMask = 0;
-    pTableCommandBuffer->CmdPipelineBarrier(data.commandBuffer, srcStages, dstStages, 0, 0, NULL, 0, NULL, 1,
+    pTableCommandBuffer->CmdPipelineBarrier(data.commandBuffer, srcStages, imageStages, 0, 0, NULL, 0, NULL, 1,
                                             &presentMemoryBarrier);
 
     err = pTableCommandBuffer->EndCommandBuffer(data.commandBuffer);
     assert(!err);
 
-    VkFence nullFence = {VK_NULL_HANDLE};
+    err = pTableDevice->ResetFences(device, 1, &data.fence);
+    assert(!err);
+    if (VK_SUCCESS != err) return nullptr;
+
+    // The copy waits on the semaphores of the present rather than for the
+    // device to be idle, so it only waits for the rendering of this frame.
+    std::vector<VkPipelineStageFlags> waitDstStageMasks(waitSemaphoreCount, VK_PIPELINE_STAGE_TRANSFER_BIT);
     VkSubmitInfo submitInfo;
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.pNext = NULL;
-    submitInfo.waitSemaphoreCount = 0;
-    submitInfo.pWaitSemaphores = NULL;
-    submitInfo.pWaitDstStageMask = NULL;
+    submitInfo.waitSemaphoreCount = waitSemaphoreCount;
+    submitInfo.pWaitSemaphores = pWaitSemaphores;
+    submitInfo.pWaitDstStageMask = waitDstStageMasks.data();
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &data.commandBuffer;
-    submitInfo.signalSemaphoreCount = 0;
-    submitInfo.pSignalSemaphores = NULL;
-
-    // Wait for operations on all queues to complete before performing the image copy.
-    err = pTableDevice->DeviceWaitIdle(device);
+    submitInfo.signalSemaphoreCount = signalSemaphore ? 1 : 0;
+    submitInfo.pSignalSemaphores = signalSemaphore ? &data.semaphore : NULL;
+
+    // In a device group, the semaphores are waited on and signaled by the
+    // device that copies.
+    std::vector<uint32_t> waitSemaphoreDeviceIndices(waitSemaphoreCount, deviceIndex);
+    const VkDeviceGroupSubmitInfo deviceGroupSubmitInfo = {VK_STRUCTURE_TYPE_DEVICE_GROUP_SUBMIT_INFO,
+                                                           NULL,
+                                                           waitSemaphoreCount,
+                                                           waitSemaphoreDeviceIndices.data(),
+                                                           1,
+                                                           &deviceMask,
+                                                           submitInfo.signalSemaphoreCount,
+                                                           &deviceIndex};
+    if (deviceGroup) submitInfo.pNext = &deviceGroupSubmitInfo;
+
+    err = pTableQueue->QueueSubmit(queue, 1, &submitInfo, data.fence);
     assert(!err);
+    if (VK_SUCCESS != err) return nullptr;
+
+    data.fileName = filename;
+    data.frameNumber = frameNumber;
+    data.inFlight = true;
+    data.submitTime = std::chrono::steady_clock::now();
+    data.timing = ScreenshotTiming();
+    data.timing.microseconds[SCREENSHOT_STAGE_SUBMIT] = microsecondsSince(submitStart);
+    pendingScreenshots.push_back(capture);
+    return capture;
+}
 
-    err = pTableQueue->QueueSubmit(queue, 1, &submitInfo, nullFence);
-    assert(!err);
+// Submit the copy of a swapchain image for an image file, before it is
+// presented. See submitCapture().
+static ScreenshotCapture *submitScreenshot(const char *filename, int frameNumber, VkQueue presentQueue, uint32_t deviceIndex,
+                                           VkSwapchainKHR swapchain, VkImage image1, uint32_t waitSemaphoreCount,
+                                           const VkSemaphore *pWaitSemaphores) {
+    // Bail immediately if we can't find the image.
+    if (imageMap.empty() || imageMap.find(image1) == imageMap.end()) return nullptr;
+    auto submitStart = std::chrono::steady_clock::now();
+
+    // The resources are normally created with the swapchain, unless the
+    // application had not gotten a queue yet.
+    ImageMapStruct *imageInfo = imageMap[image1];
+    ScreenshotPool *pool =
+        getScreenshotPool(swapchain, imageInfo->device, imageInfo->imageExtent, imageInfo->format, presentQueue);
+    if (!pool) return nullptr;
+
+    return submitCapture(pool, filename, frameNumber, presentQueue, deviceIndex, image1, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, true,
+                         waitSemaphoreCount, pWaitSemaphores, submitStart);
+}
 
-    err = pTableQueue->QueueWaitIdle(queue);
-    assert(!err);
+// Insert a suffix in a file name, before its extension.
+static string insertFileNameSuffix(const string &fileName, const string &suffix) {
+    size_t const dot = fileName.rfind('.');
+    size_t const separator = fileName.find_last_of("/\\");
+    if (dot == string::npos || (separator != string::npos && dot < separator)) return fileName + suffix;
+    return fileName.substr(0, dot) + suffix + fileName.substr(dot);
+}
+
+// Copy the views a capture copied out of the mapped buffer, as packed RGB
+// pixels, and queue them to the encoder threads, which write their files.
+// With several views, the files are numbered after the name of the capture
+// by the index of the view. The copy of the capture must have completed.
+static void queueScreenshotFile(ScreenshotCapture *capture) {
+    VkResult err;
+    VkDevice device = capture->device;
+    VulDeviceDispatchTable *pTableDevice = capture->pTableDevice;
+    ScreenshotPool *pool = capture->pool;
+    uint32_t const numChannels = pool->numChannels;
+    auto readbackStart = std::chrono::steady_clock::now();
+
+    // Host-cached memory need not be coherent, so make the writes of the copy
+    // visible.
+    if (!capture->bufferCoherent) {
+        const VkMappedMemoryRange range = {VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, NULL, capture->bufferMem, 0, VK_WHOLE_SIZE};
+        err = pTableDevice->InvalidateMappedMemoryRanges(device, 1, &range);
+        assert(!err);
+        (void)err;
+    }
+
+    // Repack the rows to RGB, in the order of the file formats.
+    bool const swapRedBlue = formatIsBGR(pool->destformat);
+
+    for (size_t v = 0; v < pool->views.size(); v++) {
+        const ScreenshotView &view = pool->views[v];
+        uint32_t const width = view.output.extent.width;
+        uint32_t const height = view.output.extent.height;
+        string const viewSuffix = pool->views.size() > 1 ? "_" + to_string(v) : "";
+
+        ScreenshotImage image;
+        image.fileName = insertFileNameSuffix(capture->fileName, viewSuffix);
+        if (screenshotFileFormat == SCREENSHOT_FILE_FORMAT_Y4M) {
+            // The frames of the view of the swapchain are all appended to one
+            // file.
+            string streamName = "screenshots";
+            if (pool->streamIndex > 0) streamName += "_" + to_string(pool->streamIndex);
+            streamName += viewSuffix + screenshotFileExtension(SCREENSHOT_FILE_FORMAT_Y4M);
+            image.fileName = vk_screenshot_dir != NULL && strlen(vk_screenshot_dir) > 0
+                                 ? string(vk_screenshot_dir) + "/" + streamName
+                                 : streamName;
+        }
+        image.frameNumber = capture->frameNumber;
+        image.stream = reinterpret_cast<uintptr_t>(&view);
+        image.format = screenshotFileFormat;
+        image.width = width;
+        image.height = height;
+
+        // The rows of the view are packed tightly in the buffer, so they are
+        // repacked all at once, as one long row.
+        size_t const pixelCount = static_cast<size_t>(width) * height;
+        const uint8_t *src = reinterpret_cast<const uint8_t *>(capture->mappedData + view.bufferOffset);
+        if (screenshotFileFormat == SCREENSHOT_FILE_FORMAT_RAW) {
+            image.pixels.assign(src, src + pool->texelSize * pixelCount);
+        } else if (pool->floatReadback && screenshotFileFormat == SCREENSHOT_FILE_FORMAT_PFM) {
+            image.pixels.resize(3 * sizeof(float) * pixelCount);
+            repackRowRGB32F(reinterpret_cast<const float *>(src), reinterpret_cast<float *>(image.pixels.data()), width * height);
+        } else if (pool->floatReadback) {
+            image.pixels.resize(3 * sizeof(uint16_t) * pixelCount);
+            repackRowRGB16(reinterpret_cast<const float *>(src), reinterpret_cast<uint16_t *>(image.pixels.data()), width * height);
+        } else {
+            image.pixels.resize(3 * pixelCount);
+            repackRowRGB(src, image.pixels.data(), width * height, numChannels, swapRedBlue);
+            if (screenshotFileFormat == SCREENSHOT_FILE_FORMAT_PPM16) {
+                // Widen the 8-bit channels in place, from the last one, which
+                // maps 255 to 65535.
+                image.pixels.resize(3 * sizeof(uint16_t) * pixelCount);
+                uint16_t *wide = reinterpret_cast<uint16_t *>(image.pixels.data());
+                for (size_t i = 3 * pixelCount; i-- > 0;) wide[i] = image.pixels[i] * 257;
+            }
+        }
+
+        image.timing = capture->timing;
+        image.timing.microseconds[SCREENSHOT_STAGE_READBACK] = microsecondsSince(readbackStart);
+        image.readbackMemoryType = capture->bufferMemoryType;
+        image.readbackCached = capture->bufferCached;
+        screenshotEncoder.add(std::move(image));
+        readbackStart = std::chrono::steady_clock::now();
+    }
+}
+
+// Queue the file of a capture whose copy has completed, or drop the frame if
+// the copy failed, so that the capture can be reused.
+static void retireScreenshot(ScreenshotCapture *capture, VkResult status) {
+    capture->inFlight = false;
+    capture->timing.microseconds[SCREENSHOT_STAGE_GPU] = microsecondsSince(capture->submitTime);
+    if (status == VK_SUCCESS) {
+        queueScreenshotFile(capture);
+    } else {
+#ifdef ANDROID
+        __android_log_print(ANDROID_LOG_ERROR, "screenshot", "Failure - copy for %s failed with %s\n", capture->fileName.c_str(),
+                            string_VkResult(status));
+#else
+        fprintf(stderr, "screenshot: Copy for %s failed with %s\n", capture->fileName.c_str(), string_VkResult(status));
+#endif
+    }
+}
+
+// Retire the captures whose copy has completed, oldest first, so that the
+// files are written in frame order. A capture is retired no sooner than
+// screenshotRetireFrames after its frame, and if there are already
+// maxPendingScreenshots captures in flight, the oldest one is waited for.
+static void retireCompletedScreenshots(int frameNumber) {
+    while (!pendingScreenshots.empty()) {
+        ScreenshotCapture *capture = pendingScreenshots.front();
+        if (frameNumber - capture->frameNumber < screenshotRetireFrames) break;
+
+        VkResult status;
+        if (pendingScreenshots.size() >= maxPendingScreenshots) {
+            status = capture->pTableDevice->WaitForFences(capture->device, 1, &capture->fence, VK_TRUE, UINT64_MAX);
+        } else {
+            status = capture->pTableDevice->GetFenceStatus(capture->device, capture->fence);
+            if (status == VK_NOT_READY) break;
+        }
+
+        retireScreenshot(capture, status);
+        pendingScreenshots.pop_front();
+    }
+}
+
+// Wait for and retire the captures of a pool, then release its resources.
+static void destroyScreenshotPool(ScreenshotPool *pool) {
+    for (auto it = pendingScreenshots.begin(); it != pendingScreenshots.end();) {
+        ScreenshotCapture *capture = *it;
+        if (capture->pool != pool) {
+            ++it;
+            continue;
+        }
+        VkResult status = capture->pTableDevice->WaitForFences(capture->device, 1, &capture->fence, VK_TRUE, UINT64_MAX);
+        retireScreenshot(capture, status);
+        it = pendingScreenshots.erase(it);
+    }
+    delete pool;
+}
 
-    // Map the final image so that the CPU can read it.
-    const VkImageSubresource sr = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0};
-    VkSubresourceLayout srLayout;
-    const char *ptr;
-    if (!need2steps) {
-        pTableDevice->GetImageSubresourceLayout(device, data.image2, &sr, &srLayout);
-        err = pTableDevice->MapMemory(device, data.mem2, 0, VK_WHOLE_SIZE, 0, (void **)&ptr);
-        assert(!err);
-        if (VK_SUCCESS != err) return false;
-        data.mem2mapped = true;
-    } else {
-        pTableDevice->GetImageSubresourceLayout(device, data.image3, &sr, &srLayout);
-        err = pTableDevice->MapMemory(device, data.mem3, 0, VK_WHOLE_SIZE, 0, (void **)&ptr);
-        assert(!err);
-        if (VK_SUCCESS != err) return false;
-        data.mem3mapped = true;
+// Release the capture resources of all the swapchains of a device, before it
+// is destroyed.
+static void destroyDeviceScreenshotPools(VkDevice device) {
+    for (auto it = screenshotPoolMap.begin(); it != screenshotPoolMap.end();) {
+        if (it->second->device != device) {
+            ++it;
+            continue;
+        }
+        destroyScreenshotPool(it->second);
+        it = screenshotPoolMap.erase(it);
+    }
+    for (auto it = namedImagePoolMap.begin(); it != namedImagePoolMap.end();) {
+        if (!it->second.pool || it->second.pool->device != device) {
+            ++it;
+            continue;
+        }
+        destroyScreenshotPool(it->second.pool);
+        it = namedImagePoolMap.erase(it);
     }
+}
 
-    // Write the data to a PPM file.
-    ofstream file(filename, ios::binary);
-    if (!file.is_open()) {
+// Prints the host memory the layer holds, live and at its peak, for each of
+// its uses which held any.
+static void printLayerMemory() {
+    LayerMemoryAccount::for_each([](const LayerMemoryAccount &account) {
+        if (account.peak() == 0) return;
 #ifdef ANDROID
-        __android_log_print(ANDROID_LOG_DEBUG, "screenshot", "Failed to open output file: %s", filename);
+        __android_log_print(ANDROID_LOG_INFO, "screenshot", "Memory of %s: %.1f KiB live, %.1f KiB peak", account.name(),
+                            account.live() / 1024.0, account.peak() / 1024.0);
 #else
-        fprintf(stderr, "screenshot: Failed to open output file: %s\n", filename);
+        printf("screenshot: Memory of %s: %.1f KiB live, %.1f KiB peak\n", account.name(), account.live() / 1024.0,
+               account.peak() / 1024.0);
 #endif
-        return false;
-    }
-
-    file << "P6\n";
-    file << width << "\n";
-    file << height << "\n";
-    file << 255 << "\n";
-
-    ptr += srLayout.offset;
-    if (3 == numChannels) {
-        for (uint32_t y = 0; y < height; y++) {
-            file.write(ptr, 3 * width);
-            ptr += srLayout.rowPitch;
-        }
-    } else if (4 == numChannels) {
-        for (uint32_t y = 0; y < height; y++) {
-            const unsigned int *row = (const unsigned int *)ptr;
-            for (uint32_t x = 0; x < width; x++) {
-                file.write((char *)row, 3);
-                row++;
-            }
-            ptr += srLayout.rowPitch;
-        }
-    }
-    file.close();
-
-    // Clean up handled by ~WritePPMCleanupData()
-
-    // writePPM succeeded
-    return true;
+    });
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL CreateInstance(const VkInstanceCreateInfo *pCreateInfo, const VkAllocationCallbacks *pAllocator,
@@ -1109,11 +2345,28 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateInstance(const VkInstanceCreateInfo *pCreat
     initInstanceTable(*pInstance, fpGetInstanceProcAddr);
 
     init_screenshot();
+    instanceCount++;
 
     return result;
 }
 
-// TODO hook DestroyInstance to cleanup
+VKAPI_ATTR void VKAPI_CALL DestroyInstance(VkInstance instance, const VkAllocationCallbacks *pAllocator) {
+    dispatch_key key = get_dispatch_key(instance);
+    instance_dispatch_table(instance)->DestroyInstance(instance, pAllocator);
+    destroy_instance_dispatch_table(key);
+
+    vector<VkPhysicalDevice> physicalDevices;
+    physDeviceMap.for_each([&](VkPhysicalDevice physicalDevice, PhysDeviceMapStruct *physDeviceMapElem) {
+        if (physDeviceMapElem->instance == instance) physicalDevices.push_back(physicalDevice);
+    });
+    for (VkPhysicalDevice physicalDevice : physicalDevices) delete physDeviceMap.erase(physicalDevice);
+
+    // The other layers may be unloaded with the last instance.
+    if (--instanceCount == 0) {
+        screenshotTrigger.unsubscribeFromSpikes();
+        printLayerMemory();
+    }
+}
 
 static void createDeviceRegisterExtensions(const VkDeviceCreateInfo *pCreateInfo, VkDevice device) {
     uint32_t i;
@@ -1122,6 +2375,7 @@ static void createDeviceRegisterExtensions(const VkDeviceCreateInfo *pCreateInfo
     VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
     PFN_vkGetDeviceProcAddr gpa = pDisp->GetDeviceProcAddr;
     pDisp->CreateSwapchainKHR = (PFN_vkCreateSwapchainKHR)gpa(device, "vkCreateSwapchainKHR");
+    pDisp->DestroySwapchainKHR = (PFN_vkDestroySwapchainKHR)gpa(device, "vkDestroySwapchainKHR");
     pDisp->GetSwapchainImagesKHR = (PFN_vkGetSwapchainImagesKHR)gpa(device, "vkGetSwapchainImagesKHR");
     pDisp->AcquireNextImageKHR = (PFN_vkAcquireNextImageKHR)gpa(device, "vkAcquireNextImageKHR");
     pDisp->QueuePresentKHR = (PFN_vkQueuePresentKHR)gpa(device, "vkQueuePresentKHR");
@@ -1138,7 +2392,7 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateDevice(VkPhysicalDevice gpu, const VkDevice
     assert(chain_info->u.pLayerInfo);
     PFN_vkGetInstanceProcAddr fpGetInstanceProcAddr = chain_info->u.pLayerInfo->pfnNextGetInstanceProcAddr;
     PFN_vkGetDeviceProcAddr fpGetDeviceProcAddr = chain_info->u.pLayerInfo->pfnNextGetDeviceProcAddr;
-    VkInstance instance = physDeviceMap[gpu]->instance;
+    VkInstance instance = get_instance(gpu);
     PFN_vkCreateDevice fpCreateDevice = (PFN_vkCreateDevice)fpGetInstanceProcAddr(instance, "vkCreateDevice");
     if (fpCreateDevice == NULL) {
         return VK_ERROR_INITIALIZATION_FAILED;
@@ -1152,12 +2406,12 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateDevice(VkPhysicalDevice gpu, const VkDevice
         return result;
     }
 
-    assert(deviceMap.find(*pDevice) == deviceMap.end());
+    assert(deviceMap.find(*pDevice) == NULL);
     DeviceMapStruct *deviceMapElem = new DeviceMapStruct;
-    deviceMap[*pDevice] = deviceMapElem;
-    assert(dispatchMap.find(*pDevice) == dispatchMap.end());
+    deviceMap.insert(*pDevice, deviceMapElem);
+    assert(dispatchMap.find(*pDevice) == NULL);
     DispatchMapStruct *dispatchMapElem = new DispatchMapStruct;
-    dispatchMap[*pDevice] = dispatchMapElem;
+    dispatchMap.insert(*pDevice, dispatchMapElem);
 
     // Setup device dispatch table
     dispatchMapElem->device_dispatch_table = new VulDeviceDispatchTable;
@@ -1166,6 +2420,13 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateDevice(VkPhysicalDevice gpu, const VkDevice
     createDeviceRegisterExtensions(pCreateInfo, *pDevice);
     // Create a mapping from a device to a physicalDevice
     deviceMapElem->physicalDevice = gpu;
+    deviceMapElem->physicalDeviceCount = 1;
+    for (auto pNext = reinterpret_cast<const VkBaseInStructure *>(pCreateInfo->pNext); pNext; pNext = pNext->pNext) {
+        if (pNext->sType == VK_STRUCTURE_TYPE_DEVICE_GROUP_DEVICE_CREATE_INFO) {
+            auto groupCreateInfo = reinterpret_cast<const VkDeviceGroupDeviceCreateInfo *>(pNext);
+            deviceMapElem->physicalDeviceCount = std::max(groupCreateInfo->physicalDeviceCount, 1u);
+        }
+    }
 
     // store the loader callback for initializing created dispatchable objects
     chain_info = get_chain_info(pCreateInfo, VK_LOADER_DATA_CALLBACK);
@@ -1186,11 +2447,7 @@ VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDevices(VkInstance instance, uin
     if (result == VK_SUCCESS && *pPhysicalDeviceCount > 0 && pPhysicalDevices) {
         for (uint32_t i = 0; i < *pPhysicalDeviceCount; i++) {
             // Create a mapping from a physicalDevice to an instance
-            if (physDeviceMap[pPhysicalDevices[i]] == NULL) {
-                PhysDeviceMapStruct *physDeviceMapElem = new PhysDeviceMapStruct;
-                physDeviceMap[pPhysicalDevices[i]] = physDeviceMapElem;
-            }
-            physDeviceMap[pPhysicalDevices[i]]->instance = instance;
+            addPhysicalDevice(pPhysicalDevices[i], instance);
         }
     }
     return result;
@@ -1205,11 +2462,7 @@ VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDeviceGroups(VkInstance instance
         for (uint32_t i = 0; i < *pPhysicalDeviceGroupCount; i++) {
             for (uint32_t j = 0; j < pPhysicalDeviceGroupProperties[i].physicalDeviceCount; j++) {
                 // Create a mapping from each physicalDevice to an instance
-                if (physDeviceMap[pPhysicalDeviceGroupProperties[i].physicalDevices[j]] == NULL) {
-                    PhysDeviceMapStruct *physDeviceMapElem = new PhysDeviceMapStruct;
-                    physDeviceMap[pPhysicalDeviceGroupProperties[i].physicalDevices[j]] = physDeviceMapElem;
-                }
-                physDeviceMap[pPhysicalDeviceGroupProperties[i].physicalDevices[j]]->instance = instance;
+                addPhysicalDevice(pPhysicalDeviceGroupProperties[i].physicalDevices[j], instance);
             }
         }
     }
@@ -1222,18 +2475,37 @@ VKAPI_ATTR void VKAPI_CALL DestroyDevice(VkDevice device, const VkAllocationCall
     assert(dispMap);
     assert(devMap);
     VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
+
+    std::lock_guard<std::mutex> lg(globalLock);
+    // Write the captures still in flight while their resources can be used.
+    destroyDeviceScreenshotPools(device);
+    screenshotEncoder.finish();
+    screenshotEncoder.reportTiming();
+    uint64_t const droppedFrames = screenshotEncoder.droppedImages();
+    if (droppedFrames > 0) {
+#ifdef ANDROID
+        __android_log_print(ANDROID_LOG_INFO, "screenshot", "%llu frames dropped, the encoder queue was full",
+                            static_cast<unsigned long long>(droppedFrames));
+#else
+        printf("screenshot: %llu frames dropped, the encoder queue was full\n", static_cast<unsigned long long>(droppedFrames));
+#endif
+    }
+
     pDisp->DestroyDevice(device, pAllocator);
 
     if (vk_screenshot_dir_used_env_var) {
         local_free_getenv(vk_screenshot_dir);
     }
 
-    std::lock_guard<std::mutex> lg(globalLock);
+    // The queues keep the dispatch table of the device, and their handles may
+    // be those of the queues of a later device.
+    for (VkQueue queue : devMap->queues) dispatchMap.erase(static_cast<VkDevice>(static_cast<void *>(queue)));
+    dispatchMap.erase(device);
+    deviceMap.erase(device);
+
     delete pDisp;
     delete dispMap;
     delete devMap;
-
-    deviceMap.erase(device);
 }
 
 VKAPI_ATTR void VKAPI_CALL GetDeviceQueue(VkDevice device, uint32_t queueFamilyIndex, uint32_t queueIndex, VkQueue *pQueue) {
@@ -1242,28 +2514,21 @@ VKAPI_ATTR void VKAPI_CALL GetDeviceQueue(VkDevice device, uint32_t queueFamilyI
     VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
     pDisp->GetDeviceQueue(device, queueFamilyIndex, queueIndex, pQueue);
 
-    // Save the device queue in a map if we are taking screenshots.
+    // queues are dispatchable objects.
+    // Create dispatchMap entry with this queue as its key, which every queue
+    // needs since its submits and presents look it up, whether or not there
+    // are screenshots left to take.
+    addDispatchableObject(*pQueue, dispMap);
+
+    // Add this queue to the queues of the device, and queueFamilyIndex to its
+    // queueIndexMap. The screenshots requested by the trigger later may be
+    // taken on any of them.
     std::lock_guard<std::mutex> lg(globalLock);
-    if (screenshotFramesReceived && screenshotFrames.empty() && !screenShotFrameRange.valid) {
-        // No screenshots in the list to take
-        return;
-    }
-
-    // Add this queue to deviceMap[device].queues, and queueFamilyIndex to deviceMap[device].queueIndexMap
-    if (deviceMap.find(device) != deviceMap.end()) {
-        deviceMap[device]->queues.emplace(*pQueue);
-
-        if (deviceMap[device]->queueIndexMap.find(*pQueue) != deviceMap[device]->queueIndexMap.end())
-            deviceMap[device]->queueIndexMap.erase(*pQueue);
-        deviceMap[device]->queueIndexMap.emplace(*pQueue, queueFamilyIndex);
+    DeviceMapStruct *devMap = get_device_info(device);
+    if (devMap) {
+        devMap->queues.emplace(*pQueue);
+        devMap->queueIndexMap[*pQueue] = queueFamilyIndex;
     }
-
-    // queues are dispatchable objects.
-    // Create dispatchMap entry with this queue as its key.
-    // Copy the device dispatch table to the new dispatch table.
-    VkDevice que = static_cast<VkDevice>(static_cast<void *>(*pQueue));
-    if (dispatchMap.find(que) != dispatchMap.end()) dispatchMap.erase(que);
-    dispatchMap.emplace(que, dispMap);
 }
 
 VKAPI_ATTR void VKAPI_CALL GetDeviceQueue2(VkDevice device, const VkDeviceQueueInfo2 *pQueueInfo, VkQueue *pQueue) {
@@ -1284,7 +2549,7 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateSwapchainKHR(VkDevice device, const VkSwapc
 
     // Save the swapchain in a map of we are taking screenshots.
     std::lock_guard<std::mutex> lg(globalLock);
-    if (screenshotFramesReceived && screenshotFrames.empty() && !screenShotFrameRange.valid) {
+    if (noScreenShotFramesLeft()) {
         // No screenshots in the list to take
         return result;
     }
@@ -1303,6 +2568,20 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateSwapchainKHR(VkDevice device, const VkSwapc
         }
         swapchainMap.insert(make_pair(*pSwapchain, swapchainMapElem));
 
+        // Hand the capture resources of the old swapchain over if its images
+        // have the same extent and format, else create them for the new one.
+        // Without a queue yet, they are created for the first capture.
+        auto oldPool = screenshotPoolMap.find(pCreateInfo->oldSwapchain);
+        if (pCreateInfo->oldSwapchain != VK_NULL_HANDLE && oldPool != screenshotPoolMap.end() &&
+            oldPool->second->extent.width == pCreateInfo->imageExtent.width &&
+            oldPool->second->extent.height == pCreateInfo->imageExtent.height &&
+            oldPool->second->format == pCreateInfo->imageFormat) {
+            screenshotPoolMap[*pSwapchain] = oldPool->second;
+            screenshotPoolMap.erase(oldPool);
+        } else if (!get_device_info(device)->queues.empty()) {
+            getScreenshotPool(*pSwapchain, device, pCreateInfo->imageExtent, pCreateInfo->imageFormat, VK_NULL_HANDLE);
+        }
+
         // Create a mapping for the swapchain object into the dispatch table
         // TODO is this needed? screenshot_device_table_map.emplace((void
         // *)pSwapchain, pTable);
@@ -1311,6 +2590,25 @@ VKAPI_ATTR VkResult VKAPI_CALL CreateSwapchainKHR(VkDevice device, const VkSwapc
     return result;
 }
 
+VKAPI_ATTR void VKAPI_CALL DestroySwapchainKHR(VkDevice device, VkSwapchainKHR swapchain, const VkAllocationCallbacks *pAllocator) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
+
+    {
+        // Write the captures still in flight and release the capture
+        // resources, unless they were handed over to a new swapchain.
+        std::lock_guard<std::mutex> lg(globalLock);
+        auto it = screenshotPoolMap.find(swapchain);
+        if (it != screenshotPoolMap.end()) {
+            destroyScreenshotPool(it->second);
+            screenshotPoolMap.erase(it);
+        }
+    }
+
+    pDisp->DestroySwapchainKHR(device, swapchain, pAllocator);
+}
+
 VKAPI_ATTR VkResult VKAPI_CALL GetSwapchainImagesKHR(VkDevice device, VkSwapchainKHR swapchain, uint32_t *pCount,
                                                      VkImage *pSwapchainImages) {
     DispatchMapStruct *dispMap = get_dispatch_info(device);
@@ -1320,7 +2618,7 @@ VKAPI_ATTR VkResult VKAPI_CALL GetSwapchainImagesKHR(VkDevice device, VkSwapchai
 
     // Save the swapchain images in a map if we are taking screenshots
     std::lock_guard<std::mutex> lg(globalLock);
-    if (screenshotFramesReceived && screenshotFrames.empty() && !screenShotFrameRange.valid) {
+    if (noScreenShotFramesLeft()) {
         // No screenshots in the list to take
         return result;
     }
@@ -1342,53 +2640,110 @@ VKAPI_ATTR VkResult VKAPI_CALL GetSwapchainImagesKHR(VkDevice device, VkSwapchai
 
         // Add list of images to swapchain to image map
         SwapchainMapStruct *swapchainMapElem = swapchainMap[swapchain];
-        if (i >= 1 && swapchainMapElem) {
-            VkImage *imageList = new VkImage[i];
-            swapchainMapElem->imageList = imageList;
-            for (unsigned j = 0; j < i; j++) {
-                swapchainMapElem->imageList[j] = pSwapchainImages[j];
-            }
-        }
+        if (i >= 1 && swapchainMapElem) swapchainMapElem->imageList.assign(pSwapchainImages, pSwapchainImages + i);
     }
     return result;
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL QueuePresentKHR(VkQueue queue, const VkPresentInfoKHR *pPresentInfo) {
-    static int frameNumber = 0;
     DispatchMapStruct *dispMap = get_dispatch_info((VkDevice)queue);
     assert(dispMap);
+    VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
+
+    // Without a capture to take or retire, the frame is numbered and presented
+    // without the lock. The frame is only numbered if no locked present
+    // numbered one in the meantime, so that the first locked frame it was
+    // checked against is still up to date.
+    int frameNumber = presentFrameNumber.load();
+    while (frameNumber < nextLockedFrameNumber.load()) {
+        if (presentFrameNumber.compare_exchange_weak(frameNumber, frameNumber + 1)) {
+            return pDisp->QueuePresentKHR(queue, pPresentInfo);
+        }
+    }
+
     std::lock_guard<std::mutex> lg(globalLock);
+    frameNumber = presentFrameNumber.fetch_add(1);
+    VkPresentInfoKHR presentInfo;
+    VkSemaphore presentWaitSemaphore;
     {  // scope around the mutexed data
-        if (!screenshotFrames.empty() || screenShotFrameRange.valid) {
+        retireCompletedScreenshots(frameNumber);
+
+        // The frames requested by the triggers are captured from this one on.
+        int const triggeredFrames = screenshotTrigger.takeRequestedFrames();
+        if (triggeredFrames > 0) {
+            int const firstFrame = std::max(triggeredFramesEnd, frameNumber);
+            triggeredFramesEnd = firstFrame + std::min(triggeredFrames, INT_MAX - firstFrame);
+        }
+        bool const inTriggeredFrames = frameNumber < triggeredFramesEnd;
+
+        if (!screenshotFrames.empty() || screenShotFrameRange.valid || inTriggeredFrames) {
             set<int>::iterator it;
             bool inScreenShotFrames = false;
             bool inScreenShotFrameRange = false;
             it = screenshotFrames.find(frameNumber);
             inScreenShotFrames = (it != screenshotFrames.end());
             isInScreenShotFrameRange(frameNumber, &screenShotFrameRange, &inScreenShotFrameRange);
-            if ((inScreenShotFrames) || (inScreenShotFrameRange)) {
-                string fileName;
-
-                if (vk_screenshot_dir == NULL || strlen(vk_screenshot_dir) == 0) {
-                    fileName = to_string(frameNumber) + ".ppm";
-                } else {
-                    fileName = vk_screenshot_dir;
-                    fileName += "/" + to_string(frameNumber) + ".ppm";
-                }
-
-                VkImage image;
-                VkSwapchainKHR swapchain;
-                // We'll dump only one image: the first
+            if ((inScreenShotFrames) || (inScreenShotFrameRange) || (inTriggeredFrames)) {
+                // Every swapchain of the present is captured. With several,
+                // the files are numbered after the frame by the index of the
+                // swapchain in the present.
                 // If there are 0 swapchains, skip taking the snapshot
-                if (pPresentInfo && pPresentInfo->swapchainCount > 0) {
-                    swapchain = pPresentInfo->pSwapchains[0];
-                    image = swapchainMap[swapchain]->imageList[pPresentInfo->pImageIndices[0]];
-                    if (writePPM(fileName.c_str(), image)) {
-#ifdef ANDROID
-                        __android_log_print(ANDROID_LOG_INFO, "screenshot", "Screen capture file is: %s", fileName.c_str());
-#else
-                        printf("screenshot: Capture file is: %s \n", fileName.c_str());
-#endif
+                if (!captureSwapchainImages) {
+                    // Only the named images are captured.
+                } else if (pPresentInfo && pPresentInfo->swapchainCount > 0) {
+                    // The copies wait on each other in turn, the first on the
+                    // semaphores of the present, so that each semaphore is
+                    // waited on once. The present then waits on the last copy.
+                    uint32_t waitSemaphoreCount = pPresentInfo->waitSemaphoreCount;
+                    const VkSemaphore *pWaitSemaphores = pPresentInfo->pWaitSemaphores;
+
+                    // In a device group, each swapchain image is copied on
+                    // the physical devices that present it, the first one by
+                    // default. With several, as in split-frame rendering,
+                    // the instance of each device is captured to a file of
+                    // its own, numbered after the index of the device.
+                    const VkDeviceGroupPresentInfoKHR *deviceGroupPresentInfo = nullptr;
+                    auto pNext = reinterpret_cast<const VkBaseInStructure *>(pPresentInfo->pNext);
+                    for (; pNext; pNext = pNext->pNext) {
+                        if (pNext->sType == VK_STRUCTURE_TYPE_DEVICE_GROUP_PRESENT_INFO_KHR) {
+                            deviceGroupPresentInfo = reinterpret_cast<const VkDeviceGroupPresentInfoKHR *>(pNext);
+                        }
+                    }
+                    for (uint32_t i = 0; i < pPresentInfo->swapchainCount; i++) {
+                        VkSwapchainKHR swapchain = pPresentInfo->pSwapchains[i];
+                        auto swapchainInfo = swapchainMap.find(swapchain);
+                        if (swapchainInfo == swapchainMap.end() || swapchainInfo->second->imageList.empty()) continue;
+                        VkImage image = swapchainInfo->second->imageList[pPresentInfo->pImageIndices[i]];
+
+                        uint32_t deviceMask = 1;
+                        if (deviceGroupPresentInfo && deviceGroupPresentInfo->swapchainCount == pPresentInfo->swapchainCount &&
+                            deviceGroupPresentInfo->pDeviceMasks[i] != 0) {
+                            deviceMask = deviceGroupPresentInfo->pDeviceMasks[i];
+                        }
+                        for (uint32_t deviceIndex = 0; deviceIndex < 32; deviceIndex++) {
+                            if (!(deviceMask & (1u << deviceIndex))) continue;
+                            string fileName = to_string(frameNumber);
+                            if (pPresentInfo->swapchainCount > 1) fileName += "_" + to_string(i);
+                            if (deviceMask & (deviceMask - 1)) fileName += "_gpu" + to_string(deviceIndex);
+                            fileName += screenshotFileExtension(screenshotFileFormat);
+                            if (vk_screenshot_dir != NULL && strlen(vk_screenshot_dir) > 0) {
+                                fileName = string(vk_screenshot_dir) + "/" + fileName;
+                            }
+
+                            ScreenshotCapture *capture = submitScreenshot(fileName.c_str(), frameNumber, queue, deviceIndex,
+                                                                          swapchain, image, waitSemaphoreCount, pWaitSemaphores);
+                            if (capture) {
+                                presentWaitSemaphore = capture->semaphore;
+                                waitSemaphoreCount = 1;
+                                pWaitSemaphores = &presentWaitSemaphore;
+                            }
+                        }
+                    }
+                    if (pWaitSemaphores != pPresentInfo->pWaitSemaphores) {
+                        presentInfo = *pPresentInfo;
+                        presentInfo.waitSemaphoreCount = waitSemaphoreCount;
+                        presentInfo.pWaitSemaphores = pWaitSemaphores;
+                        pPresentInfo = &presentInfo;
                     }
                 } else {
 #ifdef ANDROID
@@ -1401,7 +2756,8 @@ VKAPI_ATTR VkResult VKAPI_CALL QueuePresentKHR(VkQueue queue, const VkPresentInf
                     screenshotFrames.erase(it);
                 }
 
-                if (screenshotFrames.empty() && isEndOfScreenShotFrameRange(frameNumber, &screenShotFrameRange)) {
+                if (screenshotFrames.empty() && isEndOfScreenShotFrameRange(frameNumber, &screenShotFrameRange) &&
+                    !screenshotTrigger.enabled()) {
                     // Free all our maps since we are done with them.
                     for (auto swapchainIter = swapchainMap.begin(); swapchainIter != swapchainMap.end(); swapchainIter++) {
                         SwapchainMapStruct *swapchainMapElem = swapchainIter->second;
@@ -1411,26 +2767,490 @@ VKAPI_ATTR VkResult VKAPI_CALL QueuePresentKHR(VkQueue queue, const VkPresentInf
                         ImageMapStruct *imageMapElem = imageIter->second;
                         delete imageMapElem;
                     }
-                    for (auto physDeviceIter = physDeviceMap.begin(); physDeviceIter != physDeviceMap.end(); physDeviceIter++) {
-                        PhysDeviceMapStruct *physDeviceMapElem = physDeviceIter->second;
-                        delete physDeviceMapElem;
-                    }
                     swapchainMap.clear();
                     imageMap.clear();
-                    physDeviceMap.clear();
                     screenShotFrameRange.valid = false;
                 }
             }
         }
-        frameNumber++;
+
+        // Every present takes the lock while captures are in flight, so that
+        // they are retired in time.
+        nextLockedFrameNumber.store(pendingScreenshots.empty() ? findNextScreenShotFrame(frameNumber + 1) : frameNumber + 1);
+        // A request made since the frames were taken may have reset the
+        // counter before it was stored.
+        screenshotTrigger.rewake();
     }  // scope around the mutexed data
-    VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
     VkResult result = pDisp->QueuePresentKHR(queue, pPresentInfo);
     return result;
 }
 
+// Whether a frame is one to capture, from the frame list or range, or
+// requested by a trigger. Called with globalLock held.
+static bool isScreenShotFrame(int frameNumber) {
+    bool inScreenShotFrameRange = false;
+    isInScreenShotFrameRange(frameNumber, &screenShotFrameRange, &inScreenShotFrameRange);
+    return screenshotFrames.count(frameNumber) > 0 || inScreenShotFrameRange || frameNumber < triggeredFramesEnd;
+}
+
+// The name of a named image in a file name, with the characters that are not
+// allowed in file names replaced.
+static string imageFileName(const string &name) {
+    string fileName = name;
+    for (char &c : fileName) {
+        if (c == '/' || c == '\\' || c == ':' || c == '*' || c == '?' || c == '"' || c == '<' || c == '>' || c == '|') c = '_';
+    }
+    return fileName;
+}
+
+// Capture the named images the command buffers of a submit wrote, after it,
+// if the frame is one to capture. In a device group, they are copied on the
+// first physical device of the device mask of the submit.
+static void captureNamedImages(VkQueue queue, uint32_t deviceMask, const vector<VkCommandBuffer> &commandBuffers) {
+    vector<pair<VkImage, NamedImageStruct>> writtenImages;
+    {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        for (VkCommandBuffer commandBuffer : commandBuffers) {
+            auto commandBufferInfo = commandBufferMap.find(commandBuffer);
+            if (commandBufferInfo == commandBufferMap.end()) continue;
+            for (const auto &imageLayout : commandBufferInfo->second.layouts) {
+                auto namedImage = namedImageMap.find(imageLayout.first);
+                if (namedImage == namedImageMap.end()) continue;
+                namedImage->second.layout = imageLayout.second;
+                auto written =
+                    std::find_if(writtenImages.begin(), writtenImages.end(),
+                                 [&](const pair<VkImage, NamedImageStruct> &image) { return image.first == namedImage->first; });
+                if (written == writtenImages.end()) {
+                    writtenImages.push_back(*namedImage);
+                } else {
+                    written->second.layout = imageLayout.second;
+                }
+            }
+        }
+    }
+    if (writtenImages.empty()) return;
+
+    std::lock_guard<std::mutex> lg(globalLock);
+    int const frameNumber = presentFrameNumber.load();
+    if (!isScreenShotFrame(frameNumber)) return;
+    for (const auto &writtenImage : writtenImages) {
+        VkImage image = writtenImage.first;
+        const NamedImageStruct &imageInfo = writtenImage.second;
+        auto submitStart = std::chrono::steady_clock::now();
+
+        auto it = namedImagePoolMap.find(image);
+        if (it == namedImagePoolMap.end()) {
+            ScreenshotPool *pool = createScreenshotPool(imageInfo.device, imageInfo.imageExtent, imageInfo.format, queue);
+            it = namedImagePoolMap.emplace(image, NamedImagePoolStruct{pool, -1, false}).first;
+        }
+        NamedImagePoolStruct &namedPool = it->second;
+        if (!namedPool.pool || namedPool.capturedFrame == frameNumber) continue;
+
+        // The copy has to follow the submit on its queue, and the layout of
+        // the image has to be known.
+        const unordered_map<VkQueue, uint32_t> &queueIndexMap = get_device_info(imageInfo.device)->queueIndexMap;
+        auto queueFamily = queueIndexMap.find(queue);
+        if (queueFamily == queueIndexMap.end() ||
+            queueFamily->second != namedPool.pool->queueFamilyIndex) {
+            continue;
+        }
+        if (imageInfo.layout == VK_IMAGE_LAYOUT_UNDEFINED || imageInfo.layout == VK_IMAGE_LAYOUT_PREINITIALIZED) {
+            if (!namedPool.warnedLayout) {
+#ifdef ANDROID
+                __android_log_print(ANDROID_LOG_INFO, "screenshot", "The layout of image %s is not known, it is not captured\n",
+                                    imageInfo.name.c_str());
+#else
+                fprintf(stderr, "screenshot: The layout of image %s is not known, it is not captured\n", imageInfo.name.c_str());
+#endif
+                namedPool.warnedLayout = true;
+            }
+            continue;
+        }
+
+        string fileName =
+            to_string(frameNumber) + "_" + imageFileName(imageInfo.name) + screenshotFileExtension(screenshotFileFormat);
+        if (vk_screenshot_dir != NULL && strlen(vk_screenshot_dir) > 0) {
+            fileName = string(vk_screenshot_dir) + "/" + fileName;
+        }
+        uint32_t deviceIndex = 0;
+        while (deviceMask != 0 && !(deviceMask & (1u << deviceIndex))) deviceIndex++;
+        if (submitCapture(namedPool.pool, fileName.c_str(), frameNumber, queue, deviceIndex, image, imageInfo.layout, false, 0,
+                          NULL, submitStart)) {
+            namedPool.capturedFrame = frameNumber;
+        }
+    }
+
+    // Have the presents retire the captures.
+    if (!pendingScreenshots.empty()) nextLockedFrameNumber.store(0);
+}
+
+// Record the layout a barrier leaves a named image in, for the first mip
+// level and array layer, which are captured.
+static void recordImageLayout(CommandBufferMapStruct &commandBufferInfo, VkImage image, const VkImageSubresourceRange &range,
+                              VkImageLayout newLayout) {
+    if (range.baseMipLevel != 0 || range.baseArrayLayer != 0 || namedImageMap.count(image) == 0) return;
+    commandBufferInfo.layouts[image] = newLayout;
+}
+
+// Record the final layouts of the attachments of a render pass.
+static void recordRenderPassLayouts(CommandBufferMapStruct &commandBufferInfo, const VkRenderPassBeginInfo *pRenderPassBegin) {
+    auto renderPass = renderPassMap.find(pRenderPassBegin->renderPass);
+    if (renderPass == renderPassMap.end()) return;
+    const VkImageView *pAttachments = nullptr;
+    uint32_t attachmentCount = 0;
+    auto framebuffer = framebufferMap.find(pRenderPassBegin->framebuffer);
+    if (framebuffer != framebufferMap.end() && !framebuffer->second.empty()) {
+        pAttachments = framebuffer->second.data();
+        attachmentCount = static_cast<uint32_t>(framebuffer->second.size());
+    }
+    // The attachments of imageless framebuffers are given when the render
+    // pass begins.
+    for (auto pNext = reinterpret_cast<const VkBaseInStructure *>(pRenderPassBegin->pNext); pNext; pNext = pNext->pNext) {
+        if (pNext->sType == VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO) {
+            auto attachmentBegin = reinterpret_cast<const VkRenderPassAttachmentBeginInfo *>(pNext);
+            pAttachments = attachmentBegin->pAttachments;
+            attachmentCount = attachmentBegin->attachmentCount;
+        }
+    }
+    for (uint32_t i = 0; i < attachmentCount && i < renderPass->second.size(); i++) {
+        auto view = imageViewMap.find(pAttachments[i]);
+        if (view == imageViewMap.end() || namedImageMap.count(view->second) == 0) continue;
+        commandBufferInfo.layouts[view->second] = renderPass->second[i];
+    }
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateImage(VkDevice device, const VkImageCreateInfo *pCreateInfo,
+                                           const VkAllocationCallbacks *pAllocator, VkImage *pImage) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
+
+    // The images that may be named are copied from, like the swapchain
+    // images. Transient attachments cannot be.
+    VkImageCreateInfo myCreateInfo = *pCreateInfo;
+    bool const capturable = pCreateInfo->imageType == VK_IMAGE_TYPE_2D &&
+                            !(pCreateInfo->usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) &&
+                            pCreateInfo->samples == VK_SAMPLE_COUNT_1_BIT;
+    if (capturable) myCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    VkResult result = pDisp->CreateImage(device, &myCreateInfo, pAllocator, pImage);
+
+    if (result == VK_SUCCESS && capturable) {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        createdImageMap[*pImage] =
+            ImageMapStruct{device, {pCreateInfo->extent.width, pCreateInfo->extent.height}, pCreateInfo->format};
+    }
+    return result;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyImage(VkDevice device, VkImage image, const VkAllocationCallbacks *pAllocator) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
+
+    {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        createdImageMap.erase(image);
+        namedImageMap.erase(image);
+    }
+    {
+        // Write the captures of the image still in flight.
+        std::lock_guard<std::mutex> lg(globalLock);
+        auto it = namedImagePoolMap.find(image);
+        if (it != namedImagePoolMap.end()) {
+            if (it->second.pool) destroyScreenshotPool(it->second.pool);
+            namedImagePoolMap.erase(it);
+        }
+    }
+
+    pDisp->DestroyImage(device, image, pAllocator);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL SetDebugUtilsObjectNameEXT(VkDevice device, const VkDebugUtilsObjectNameInfoEXT *pNameInfo) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
+
+    if (pNameInfo->objectType == VK_OBJECT_TYPE_IMAGE) {
+        VkImage image = (VkImage)pNameInfo->objectHandle;
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        auto createdImage = createdImageMap.find(image);
+        if (pNameInfo->pObjectName && screenshotImageNames.count(pNameInfo->pObjectName) > 0 &&
+            createdImage != createdImageMap.end()) {
+            uint32_t const numChannels = FormatComponentCount(createdImage->second.format);
+            if (numChannels == 3 || numChannels == 4) {
+                namedImageMap[image] = NamedImageStruct{device, createdImage->second.imageExtent, createdImage->second.format,
+                                                        pNameInfo->pObjectName, VK_IMAGE_LAYOUT_UNDEFINED};
+            } else {
+#ifdef ANDROID
+                __android_log_print(ANDROID_LOG_INFO, "screenshot", "Image %s is not an RGB or RGBA image, it is not captured\n",
+                                    pNameInfo->pObjectName);
+#else
+                fprintf(stderr, "screenshot: Image %s is not an RGB or RGBA image, it is not captured\n", pNameInfo->pObjectName);
+#endif
+            }
+        } else {
+            namedImageMap.erase(image);
+        }
+    }
+
+    if (pDisp->SetDebugUtilsObjectNameEXT == NULL) return VK_SUCCESS;
+    return pDisp->SetDebugUtilsObjectNameEXT(device, pNameInfo);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateImageView(VkDevice device, const VkImageViewCreateInfo *pCreateInfo,
+                                               const VkAllocationCallbacks *pAllocator, VkImageView *pView) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    VkResult result = dispMap->device_dispatch_table->CreateImageView(device, pCreateInfo, pAllocator, pView);
+    if (result == VK_SUCCESS) {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        imageViewMap[*pView] = pCreateInfo->image;
+    }
+    return result;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyImageView(VkDevice device, VkImageView imageView, const VkAllocationCallbacks *pAllocator) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        imageViewMap.erase(imageView);
+    }
+    dispMap->device_dispatch_table->DestroyImageView(device, imageView, pAllocator);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateFramebuffer(VkDevice device, const VkFramebufferCreateInfo *pCreateInfo,
+                                                 const VkAllocationCallbacks *pAllocator, VkFramebuffer *pFramebuffer) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    VkResult result = dispMap->device_dispatch_table->CreateFramebuffer(device, pCreateInfo, pAllocator, pFramebuffer);
+    if (result == VK_SUCCESS) {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        vector<VkImageView> &attachments = framebufferMap[*pFramebuffer];
+        attachments.clear();
+        if (!(pCreateInfo->flags & VK_FRAMEBUFFER_CREATE_IMAGELESS_BIT) && pCreateInfo->pAttachments) {
+            attachments.assign(pCreateInfo->pAttachments, pCreateInfo->pAttachments + pCreateInfo->attachmentCount);
+        }
+    }
+    return result;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyFramebuffer(VkDevice device, VkFramebuffer framebuffer, const VkAllocationCallbacks *pAllocator) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        framebufferMap.erase(framebuffer);
+    }
+    dispMap->device_dispatch_table->DestroyFramebuffer(device, framebuffer, pAllocator);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateRenderPass(VkDevice device, const VkRenderPassCreateInfo *pCreateInfo,
+                                                const VkAllocationCallbacks *pAllocator, VkRenderPass *pRenderPass) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    VkResult result = dispMap->device_dispatch_table->CreateRenderPass(device, pCreateInfo, pAllocator, pRenderPass);
+    if (result == VK_SUCCESS) {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        vector<VkImageLayout> &finalLayouts = renderPassMap[*pRenderPass];
+        finalLayouts.clear();
+        for (uint32_t i = 0; i < pCreateInfo->attachmentCount; i++) {
+            finalLayouts.push_back(pCreateInfo->pAttachments[i].finalLayout);
+        }
+    }
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateRenderPass2(VkDevice device, const VkRenderPassCreateInfo2 *pCreateInfo,
+                                                 const VkAllocationCallbacks *pAllocator, VkRenderPass *pRenderPass) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
+    PFN_vkCreateRenderPass2 createRenderPass2 = pDisp->CreateRenderPass2 ? pDisp->CreateRenderPass2 : pDisp->CreateRenderPass2KHR;
+    VkResult result = createRenderPass2(device, pCreateInfo, pAllocator, pRenderPass);
+    if (result == VK_SUCCESS) {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        vector<VkImageLayout> &finalLayouts = renderPassMap[*pRenderPass];
+        finalLayouts.clear();
+        for (uint32_t i = 0; i < pCreateInfo->attachmentCount; i++) {
+            finalLayouts.push_back(pCreateInfo->pAttachments[i].finalLayout);
+        }
+    }
+    return result;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyRenderPass(VkDevice device, VkRenderPass renderPass, const VkAllocationCallbacks *pAllocator) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        renderPassMap.erase(renderPass);
+    }
+    dispMap->device_dispatch_table->DestroyRenderPass(device, renderPass, pAllocator);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL AllocateCommandBuffers(VkDevice device, const VkCommandBufferAllocateInfo *pAllocateInfo,
+                                                      VkCommandBuffer *pCommandBuffers) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
+    VkResult result = pDisp->AllocateCommandBuffers(device, pAllocateInfo, pCommandBuffers);
+    if (result == VK_SUCCESS) {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        for (uint32_t i = 0; i < pAllocateInfo->commandBufferCount; i++) {
+            commandBufferMap[pCommandBuffers[i]] = CommandBufferMapStruct{pDisp, pAllocateInfo->commandPool, {}};
+        }
+    }
+    return result;
+}
+
+VKAPI_ATTR void VKAPI_CALL FreeCommandBuffers(VkDevice device, VkCommandPool commandPool, uint32_t commandBufferCount,
+                                              const VkCommandBuffer *pCommandBuffers) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        for (uint32_t i = 0; i < commandBufferCount; i++) commandBufferMap.erase(pCommandBuffers[i]);
+    }
+    dispMap->device_dispatch_table->FreeCommandBuffers(device, commandPool, commandBufferCount, pCommandBuffers);
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyCommandPool(VkDevice device, VkCommandPool commandPool, const VkAllocationCallbacks *pAllocator) {
+    DispatchMapStruct *dispMap = get_dispatch_info(device);
+    assert(dispMap);
+    {
+        // The command buffers of the pool are freed with it.
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        for (auto it = commandBufferMap.begin(); it != commandBufferMap.end();) {
+            if (it->second.commandPool == commandPool) {
+                it = commandBufferMap.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    dispMap->device_dispatch_table->DestroyCommandPool(device, commandPool, pAllocator);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL BeginCommandBuffer(VkCommandBuffer commandBuffer, const VkCommandBufferBeginInfo *pBeginInfo) {
+    VulDeviceDispatchTable *pDisp;
+    {
+        // The command buffer is recorded anew.
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        CommandBufferMapStruct &commandBufferInfo = commandBufferMap.at(commandBuffer);
+        commandBufferInfo.layouts.clear();
+        pDisp = commandBufferInfo.device_dispatch_table;
+    }
+    return pDisp->BeginCommandBuffer(commandBuffer, pBeginInfo);
+}
+
+VKAPI_ATTR void VKAPI_CALL CmdPipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask,
+                                              VkPipelineStageFlags dstStageMask, VkDependencyFlags dependencyFlags,
+                                              uint32_t memoryBarrierCount, const VkMemoryBarrier *pMemoryBarriers,
+                                              uint32_t bufferMemoryBarrierCount, const VkBufferMemoryBarrier *pBufferMemoryBarriers,
+                                              uint32_t imageMemoryBarrierCount, const VkImageMemoryBarrier *pImageMemoryBarriers) {
+    VulDeviceDispatchTable *pDisp;
+    {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        CommandBufferMapStruct &commandBufferInfo = commandBufferMap.at(commandBuffer);
+        for (uint32_t i = 0; i < imageMemoryBarrierCount; i++) {
+            recordImageLayout(commandBufferInfo, pImageMemoryBarriers[i].image, pImageMemoryBarriers[i].subresourceRange,
+                              pImageMemoryBarriers[i].newLayout);
+        }
+        pDisp = commandBufferInfo.device_dispatch_table;
+    }
+    pDisp->CmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, dependencyFlags, memoryBarrierCount, pMemoryBarriers,
+                              bufferMemoryBarrierCount, pBufferMemoryBarriers, imageMemoryBarrierCount, pImageMemoryBarriers);
+}
+
+VKAPI_ATTR void VKAPI_CALL CmdPipelineBarrier2(VkCommandBuffer commandBuffer, const VkDependencyInfo *pDependencyInfo) {
+    VulDeviceDispatchTable *pDisp;
+    {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        CommandBufferMapStruct &commandBufferInfo = commandBufferMap.at(commandBuffer);
+        for (uint32_t i = 0; i < pDependencyInfo->imageMemoryBarrierCount; i++) {
+            const VkImageMemoryBarrier2 &barrier = pDependencyInfo->pImageMemoryBarriers[i];
+            recordImageLayout(commandBufferInfo, barrier.image, barrier.subresourceRange, barrier.newLayout);
+        }
+        pDisp = commandBufferInfo.device_dispatch_table;
+    }
+    PFN_vkCmdPipelineBarrier2 cmdPipelineBarrier2 =
+        pDisp->CmdPipelineBarrier2 ? pDisp->CmdPipelineBarrier2 : pDisp->CmdPipelineBarrier2KHR;
+    cmdPipelineBarrier2(commandBuffer, pDependencyInfo);
+}
+
+VKAPI_ATTR void VKAPI_CALL CmdBeginRenderPass(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo *pRenderPassBegin,
+                                              VkSubpassContents contents) {
+    VulDeviceDispatchTable *pDisp;
+    {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        CommandBufferMapStruct &commandBufferInfo = commandBufferMap.at(commandBuffer);
+        recordRenderPassLayouts(commandBufferInfo, pRenderPassBegin);
+        pDisp = commandBufferInfo.device_dispatch_table;
+    }
+    pDisp->CmdBeginRenderPass(commandBuffer, pRenderPassBegin, contents);
+}
+
+VKAPI_ATTR void VKAPI_CALL CmdBeginRenderPass2(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo *pRenderPassBegin,
+                                               const VkSubpassBeginInfo *pSubpassBeginInfo) {
+    VulDeviceDispatchTable *pDisp;
+    {
+        std::lock_guard<std::mutex> lg(namedImageLock);
+        CommandBufferMapStruct &commandBufferInfo = commandBufferMap.at(commandBuffer);
+        recordRenderPassLayouts(commandBufferInfo, pRenderPassBegin);
+        pDisp = commandBufferInfo.device_dispatch_table;
+    }
+    PFN_vkCmdBeginRenderPass2 cmdBeginRenderPass2 =
+        pDisp->CmdBeginRenderPass2 ? pDisp->CmdBeginRenderPass2 : pDisp->CmdBeginRenderPass2KHR;
+    cmdBeginRenderPass2(commandBuffer, pRenderPassBegin, pSubpassBeginInfo);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL QueueSubmit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo *pSubmits, VkFence fence) {
+    DispatchMapStruct *dispMap = get_dispatch_info((VkDevice)queue);
+    assert(dispMap);
+    VkResult result = dispMap->device_dispatch_table->QueueSubmit(queue, submitCount, pSubmits, fence);
+    if (result != VK_SUCCESS) return result;
+
+    vector<VkCommandBuffer> commandBuffers;
+    uint32_t deviceMask = 0;
+    for (uint32_t i = 0; i < submitCount; i++) {
+        commandBuffers.insert(commandBuffers.end(), pSubmits[i].pCommandBuffers,
+                              pSubmits[i].pCommandBuffers + pSubmits[i].commandBufferCount);
+        for (auto pNext = reinterpret_cast<const VkBaseInStructure *>(pSubmits[i].pNext); pNext; pNext = pNext->pNext) {
+            if (pNext->sType != VK_STRUCTURE_TYPE_DEVICE_GROUP_SUBMIT_INFO) continue;
+            auto deviceGroupSubmitInfo = reinterpret_cast<const VkDeviceGroupSubmitInfo *>(pNext);
+            for (uint32_t j = 0; j < deviceGroupSubmitInfo->commandBufferCount; j++) {
+                deviceMask |= deviceGroupSubmitInfo->pCommandBufferDeviceMasks[j];
+            }
+        }
+    }
+    captureNamedImages(queue, deviceMask, commandBuffers);
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL QueueSubmit2(VkQueue queue, uint32_t submitCount, const VkSubmitInfo2 *pSubmits, VkFence fence) {
+    DispatchMapStruct *dispMap = get_dispatch_info((VkDevice)queue);
+    assert(dispMap);
+    VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
+    PFN_vkQueueSubmit2 queueSubmit2 = pDisp->QueueSubmit2 ? pDisp->QueueSubmit2 : pDisp->QueueSubmit2KHR;
+    VkResult result = queueSubmit2(queue, submitCount, pSubmits, fence);
+    if (result != VK_SUCCESS) return result;
+
+    vector<VkCommandBuffer> commandBuffers;
+    uint32_t deviceMask = 0;
+    for (uint32_t i = 0; i < submitCount; i++) {
+        for (uint32_t j = 0; j < pSubmits[i].commandBufferInfoCount; j++) {
+            commandBuffers.push_back(pSubmits[i].pCommandBufferInfos[j].commandBuffer);
+            deviceMask |= pSubmits[i].pCommandBufferInfos[j].deviceMask;
+        }
+    }
+    captureNamedImages(queue, deviceMask, commandBuffers);
+    return result;
+}
+
 // Unused, but this could be provided as an extension or utility to the
-// application in the future.
+// application in the future. The triggers request frames while the
+// application runs without it.
 VKAPI_ATTR VkResult VKAPI_CALL SpecifyScreenshotFrames(const char *frameList) {
     populate_frame_list(frameList);
     return VK_SUCCESS;
@@ -1539,6 +3359,8 @@ static PFN_vkVoidFunction intercept_core_device_command(const char *name);
 
 static PFN_vkVoidFunction intercept_khr_swapchain_command(const char *name, VkDevice dev);
 
+static PFN_vkVoidFunction intercept_named_image_command(const char *name);
+
 VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetDeviceProcAddr(VkDevice dev, const char *funcName) {
     PFN_vkVoidFunction proc = intercept_core_device_command(funcName);
     if (proc) return proc;
@@ -1550,6 +3372,9 @@ VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetDeviceProcAddr(VkDevice dev, const c
     proc = intercept_khr_swapchain_command(funcName, dev);
     if (proc) return proc;
 
+    proc = intercept_named_image_command(funcName);
+    if (proc) return proc;
+
     DispatchMapStruct *dispMap = get_dispatch_info(dev);
     assert(dispMap);
     VulDeviceDispatchTable *pDisp = dispMap->device_dispatch_table;
@@ -1566,6 +3391,7 @@ VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetInstanceProcAddr(VkInstance instance
 
     proc = intercept_core_device_command(funcName);
     if (!proc) proc = intercept_khr_swapchain_command(funcName, VK_NULL_HANDLE);
+    if (!proc) proc = intercept_named_image_command(funcName);
     if (proc) return proc;
 
     VulInstanceDispatchTable *pTable = instance_dispatch_table(instance);
@@ -1580,6 +3406,7 @@ static PFN_vkVoidFunction intercept_core_instance_command(const char *name) {
     } core_instance_commands[] = {
         {"vkGetInstanceProcAddr", reinterpret_cast<PFN_vkVoidFunction>(GetInstanceProcAddr)},
         {"vkCreateInstance", reinterpret_cast<PFN_vkVoidFunction>(CreateInstance)},
+        {"vkDestroyInstance", reinterpret_cast<PFN_vkVoidFunction>(DestroyInstance)},
         {"vkCreateDevice", reinterpret_cast<PFN_vkVoidFunction>(CreateDevice)},
         {"vkEnumeratePhysicalDevices", reinterpret_cast<PFN_vkVoidFunction>(EnumeratePhysicalDevices)},
         {"vkEnumeratePhysicalDeviceGroups", reinterpret_cast<PFN_vkVoidFunction>(EnumeratePhysicalDeviceGroups)},
@@ -1597,21 +3424,16 @@ static PFN_vkVoidFunction intercept_core_instance_command(const char *name) {
 }
 
 static PFN_vkVoidFunction intercept_core_device_command(const char *name) {
-    static const struct {
-        const char *name;
-        PFN_vkVoidFunction proc;
-    } core_device_commands[] = {
+    // Hashed once, vkGetDeviceProcAddr is called for every device entrypoint by loaders such as volk
+    static const std::unordered_map<std::string_view, PFN_vkVoidFunction> core_device_commands = {
         {"vkGetDeviceProcAddr", reinterpret_cast<PFN_vkVoidFunction>(GetDeviceProcAddr)},
         {"vkGetDeviceQueue", reinterpret_cast<PFN_vkVoidFunction>(GetDeviceQueue)},
         {"vkGetDeviceQueue2", reinterpret_cast<PFN_vkVoidFunction>(GetDeviceQueue2)},
         {"vkDestroyDevice", reinterpret_cast<PFN_vkVoidFunction>(DestroyDevice)},
     };
 
-    for (size_t i = 0; i < ARRAY_SIZE(core_device_commands); i++) {
-        if (!strcmp(core_device_commands[i].name, name)) return core_device_commands[i].proc;
-    }
-
-    return nullptr;
+    auto it = core_device_commands.find(name);
+    return it != core_device_commands.end() ? it->second : nullptr;
 }
 
 static PFN_vkVoidFunction intercept_khr_swapchain_command(const char *name, VkDevice dev) {
@@ -1620,6 +3442,7 @@ static PFN_vkVoidFunction intercept_khr_swapchain_command(const char *name, VkDe
         PFN_vkVoidFunction proc;
     } khr_swapchain_commands[] = {
         {"vkCreateSwapchainKHR", reinterpret_cast<PFN_vkVoidFunction>(CreateSwapchainKHR)},
+        {"vkDestroySwapchainKHR", reinterpret_cast<PFN_vkVoidFunction>(DestroySwapchainKHR)},
         {"vkGetSwapchainImagesKHR", reinterpret_cast<PFN_vkVoidFunction>(GetSwapchainImagesKHR)},
         {"vkQueuePresentKHR", reinterpret_cast<PFN_vkVoidFunction>(QueuePresentKHR)},
     };
@@ -1636,6 +3459,41 @@ static PFN_vkVoidFunction intercept_khr_swapchain_command(const char *name, VkDe
     return nullptr;
 }
 
+// The commands that track the named images are only intercepted when images
+// are named, so that they cost nothing otherwise.
+static PFN_vkVoidFunction intercept_named_image_command(const char *name) {
+    static const std::unordered_map<std::string_view, PFN_vkVoidFunction> named_image_commands = {
+        {"vkCreateImage", reinterpret_cast<PFN_vkVoidFunction>(CreateImage)},
+        {"vkDestroyImage", reinterpret_cast<PFN_vkVoidFunction>(DestroyImage)},
+        {"vkSetDebugUtilsObjectNameEXT", reinterpret_cast<PFN_vkVoidFunction>(SetDebugUtilsObjectNameEXT)},
+        {"vkCreateImageView", reinterpret_cast<PFN_vkVoidFunction>(CreateImageView)},
+        {"vkDestroyImageView", reinterpret_cast<PFN_vkVoidFunction>(DestroyImageView)},
+        {"vkCreateFramebuffer", reinterpret_cast<PFN_vkVoidFunction>(CreateFramebuffer)},
+        {"vkDestroyFramebuffer", reinterpret_cast<PFN_vkVoidFunction>(DestroyFramebuffer)},
+        {"vkCreateRenderPass", reinterpret_cast<PFN_vkVoidFunction>(CreateRenderPass)},
+        {"vkCreateRenderPass2", reinterpret_cast<PFN_vkVoidFunction>(CreateRenderPass2)},
+        {"vkCreateRenderPass2KHR", reinterpret_cast<PFN_vkVoidFunction>(CreateRenderPass2)},
+        {"vkDestroyRenderPass", reinterpret_cast<PFN_vkVoidFunction>(DestroyRenderPass)},
+        {"vkAllocateCommandBuffers", reinterpret_cast<PFN_vkVoidFunction>(AllocateCommandBuffers)},
+        {"vkFreeCommandBuffers", reinterpret_cast<PFN_vkVoidFunction>(FreeCommandBuffers)},
+        {"vkDestroyCommandPool", reinterpret_cast<PFN_vkVoidFunction>(DestroyCommandPool)},
+        {"vkBeginCommandBuffer", reinterpret_cast<PFN_vkVoidFunction>(BeginCommandBuffer)},
+        {"vkCmdPipelineBarrier", reinterpret_cast<PFN_vkVoidFunction>(CmdPipelineBarrier)},
+        {"vkCmdPipelineBarrier2", reinterpret_cast<PFN_vkVoidFunction>(CmdPipelineBarrier2)},
+        {"vkCmdPipelineBarrier2KHR", reinterpret_cast<PFN_vkVoidFunction>(CmdPipelineBarrier2)},
+        {"vkCmdBeginRenderPass", reinterpret_cast<PFN_vkVoidFunction>(CmdBeginRenderPass)},
+        {"vkCmdBeginRenderPass2", reinterpret_cast<PFN_vkVoidFunction>(CmdBeginRenderPass2)},
+        {"vkCmdBeginRenderPass2KHR", reinterpret_cast<PFN_vkVoidFunction>(CmdBeginRenderPass2)},
+        {"vkQueueSubmit", reinterpret_cast<PFN_vkVoidFunction>(QueueSubmit)},
+        {"vkQueueSubmit2", reinterpret_cast<PFN_vkVoidFunction>(QueueSubmit2)},
+        {"vkQueueSubmit2KHR", reinterpret_cast<PFN_vkVoidFunction>(QueueSubmit2)},
+    };
+
+    if (screenshotImageNames.empty()) return nullptr;
+    auto it = named_image_commands.find(name);
+    return it != named_image_commands.end() ? it->second : nullptr;
+}
+
 }  // namespace screenshot
 
 #if defined(__GNUC__) && __GNUC__ >= 4
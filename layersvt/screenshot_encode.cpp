@@ -0,0 +1,1076 @@
+/*
+ * Copyright (C) 2015-2021 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "screenshot_encode.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+
+#ifdef ANDROID
+#include <android/log.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SCREENSHOT_REPACK_SSSE3
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SCREENSHOT_REPACK_NEON
+#include <arm_neon.h>
+#endif
+
+namespace screenshot {
+
+const char *screenshotFileExtension(ScreenshotFileFormat format) {
+    switch (format) {
+        case SCREENSHOT_FILE_FORMAT_PNG:
+            return ".png";
+        case SCREENSHOT_FILE_FORMAT_QOI:
+            return ".qoi";
+        case SCREENSHOT_FILE_FORMAT_Y4M:
+            return ".y4m";
+        case SCREENSHOT_FILE_FORMAT_PFM:
+            return ".pfm";
+        case SCREENSHOT_FILE_FORMAT_RAW:
+            return ".raw";
+        case SCREENSHOT_FILE_FORMAT_PPM16:
+        case SCREENSHOT_FILE_FORMAT_PPM:
+        default:
+            return ".ppm";
+    }
+}
+
+// Y4M
+
+void encodeY4MHeader(uint32_t width, uint32_t height, std::vector<uint8_t> &output) {
+    // The frame rate is not known, so the usual one is written.
+    std::string header = "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height) + " F30:1 Ip A1:1 C420jpeg\n";
+    output.insert(output.end(), header.begin(), header.end());
+}
+
+void encodeY4MFrame(uint32_t width, uint32_t height, const uint8_t *pixels, std::vector<uint8_t> &output) {
+    static const char frameHeader[] = "FRAME\n";
+    uint32_t const chromaWidth = (width + 1) / 2;
+    uint32_t const chromaHeight = (height + 1) / 2;
+    size_t const lumaSize = static_cast<size_t>(width) * height;
+    size_t const chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+    size_t const start = output.size() + sizeof(frameHeader) - 1;
+    output.insert(output.end(), frameHeader, frameHeader + sizeof(frameHeader) - 1);
+    output.resize(start + lumaSize + 2 * chromaSize);
+    uint8_t *y = output.data() + start;
+    uint8_t *u = y + lumaSize;
+    uint8_t *v = u + chromaSize;
+
+    // The coefficients are scaled by 256, and the chroma offset by 128 keeps
+    // the sums positive before they are shifted.
+    for (size_t i = 0; i < lumaSize; i++) {
+        const uint8_t *rgb = pixels + 3 * i;
+        y[i] = static_cast<uint8_t>((77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2] + 128) >> 8);
+    }
+    size_t const rowSize = 3 * static_cast<size_t>(width);
+    for (uint32_t cy = 0; cy < chromaHeight; cy++) {
+        const uint8_t *row0 = pixels + 2 * cy * rowSize;
+        const uint8_t *row1 = 2 * cy + 1 < height ? row0 + rowSize : row0;
+        for (uint32_t cx = 0; cx < chromaWidth; cx++) {
+            size_t const x0 = 6 * static_cast<size_t>(cx);
+            size_t const x1 = 2 * cx + 1 < width ? x0 + 3 : x0;
+            int const r = row0[x0] + row0[x1] + row1[x0] + row1[x1];
+            int const g = row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1];
+            int const b = row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2];
+            // The sums of 4 pixels are scaled by 1024.
+            int const cb = (-43 * r - 85 * g + 128 * b + 128 * 1024 + 512) >> 10;
+            int const cr = (128 * r - 107 * g - 21 * b + 128 * 1024 + 512) >> 10;
+            u[static_cast<size_t>(cy) * chromaWidth + cx] = static_cast<uint8_t>(std::min(cb, 255));
+            v[static_cast<size_t>(cy) * chromaWidth + cx] = static_cast<uint8_t>(std::min(cr, 255));
+        }
+    }
+}
+
+// Row repacking
+//
+// The SSSE3 code is compiled for that instruction set whatever the target of
+// the build, and only used if the CPU has it. NEON is part of every target it
+// is compiled for.
+
+static void repackRowRGBScalar(const uint8_t *src, uint8_t *dst, uint32_t width, uint32_t numChannels, bool swapRedBlue) {
+    if (numChannels == 3 && !swapRedBlue) {
+        memcpy(dst, src, 3 * static_cast<size_t>(width));
+        return;
+    }
+    unsigned const red = swapRedBlue ? 2 : 0;
+    for (uint32_t x = 0; x < width; x++) {
+        dst[0] = src[red];
+        dst[1] = src[1];
+        dst[2] = src[2 - red];
+        src += numChannels;
+        dst += 3;
+    }
+}
+
+#if defined(SCREENSHOT_REPACK_SSSE3)
+
+static bool cpuHasSSSE3() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+#ifndef _MSC_VER
+__attribute__((target("ssse3")))
+#endif
+static uint32_t repackRowRGBA_SSSE3(const uint8_t *src, uint8_t *dst, uint32_t width, bool swapRedBlue) {
+    // Four pixels are repacked to the low 12 bytes of the register, which is
+    // stored whole, so the last 4 bytes must still be within the row.
+    __m128i const shuffle = swapRedBlue ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+                                        : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    uint32_t x = 0;
+    for (; x + 6 <= width; x += 4) {
+        __m128i const pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 3 * x), _mm_shuffle_epi8(pixels, shuffle));
+    }
+    return x;
+}
+
+#elif defined(SCREENSHOT_REPACK_NEON)
+
+static uint32_t repackRowRGBA_NEON(const uint8_t *src, uint8_t *dst, uint32_t width, bool swapRedBlue) {
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t const pixels = vld4q_u8(src + 4 * x);
+        uint8x16x3_t rgb;
+        rgb.val[0] = swapRedBlue ? pixels.val[2] : pixels.val[0];
+        rgb.val[1] = pixels.val[1];
+        rgb.val[2] = swapRedBlue ? pixels.val[0] : pixels.val[2];
+        vst3q_u8(dst + 3 * x, rgb);
+    }
+    return x;
+}
+
+#endif
+
+void repackRowRGB(const uint8_t *src, uint8_t *dst, uint32_t width, uint32_t numChannels, bool swapRedBlue) {
+    uint32_t done = 0;
+    if (numChannels == 4) {
+#if defined(SCREENSHOT_REPACK_SSSE3)
+        static const bool hasSSSE3 = cpuHasSSSE3();
+        if (hasSSSE3) done = repackRowRGBA_SSSE3(src, dst, width, swapRedBlue);
+#elif defined(SCREENSHOT_REPACK_NEON)
+        done = repackRowRGBA_NEON(src, dst, width, swapRedBlue);
+#endif
+    }
+    repackRowRGBScalar(src + numChannels * done, dst + 3 * done, width - done, numChannels, swapRedBlue);
+}
+
+void repackRowRGB16(const float *src, uint16_t *dst, uint32_t width) {
+    for (uint32_t x = 0; x < width; x++) {
+        for (uint32_t c = 0; c < 3; c++) {
+            float const value = src[4 * x + c];
+            // NaNs are taken as 0.
+            dst[3 * x + c] = !(value > 0.0f) ? 0 : value >= 1.0f ? 65535 : static_cast<uint16_t>(value * 65535.0f + 0.5f);
+        }
+    }
+}
+
+void repackRowRGB32F(const float *src, float *dst, uint32_t width) {
+    for (uint32_t x = 0; x < width; x++) {
+        dst[3 * x] = src[4 * x];
+        dst[3 * x + 1] = src[4 * x + 1];
+        dst[3 * x + 2] = src[4 * x + 2];
+    }
+}
+
+static void appendBigEndian32(std::vector<uint8_t> &output, uint32_t value) {
+    output.push_back(static_cast<uint8_t>(value >> 24));
+    output.push_back(static_cast<uint8_t>(value >> 16));
+    output.push_back(static_cast<uint8_t>(value >> 8));
+    output.push_back(static_cast<uint8_t>(value));
+}
+
+void encodePPM(uint32_t width, uint32_t height, const uint8_t *pixels, std::vector<uint8_t> &output) {
+    std::string header = "P6\n" + std::to_string(width) + "\n" + std::to_string(height) + "\n255\n";
+    output.reserve(header.size() + 3 * static_cast<size_t>(width) * height);
+    output.insert(output.end(), header.begin(), header.end());
+    output.insert(output.end(), pixels, pixels + 3 * static_cast<size_t>(width) * height);
+}
+
+// Read the next number of the header of a PPM file, skipping the whitespace
+// and the comments before it.
+static bool readPPMHeaderNumber(FILE *file, uint32_t &value) {
+    int c = fgetc(file);
+    while (c == '#' || isspace(c)) {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) c = fgetc(file);
+        }
+        c = fgetc(file);
+    }
+    if (!isdigit(c)) return false;
+    value = 0;
+    while (isdigit(c)) {
+        value = value * 10 + static_cast<uint32_t>(c - '0');
+        c = fgetc(file);
+    }
+    // The single whitespace character after the header is consumed here.
+    return isspace(c) != 0;
+}
+
+bool decodePPM(const std::string &fileName, uint32_t &width, uint32_t &height, std::vector<uint8_t> &pixels) {
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (!file) return false;
+    uint32_t maxValue = 0;
+    bool const valid = fgetc(file) == 'P' && fgetc(file) == '6' && readPPMHeaderNumber(file, width) &&
+                       readPPMHeaderNumber(file, height) && readPPMHeaderNumber(file, maxValue) && maxValue == 255;
+    if (valid) {
+        pixels.resize(3 * static_cast<size_t>(width) * height);
+    }
+    bool const read = valid && fread(pixels.data(), 1, pixels.size(), file) == pixels.size();
+    fclose(file);
+    return read;
+}
+
+// PPM with a maximum value of 65535, which has two bytes per channel, the
+// most significant first.
+void encodePPM16(uint32_t width, uint32_t height, const uint16_t *pixels, std::vector<uint8_t> &output) {
+    std::string header = "P6\n" + std::to_string(width) + "\n" + std::to_string(height) + "\n65535\n";
+    size_t const count = 3 * static_cast<size_t>(width) * height;
+    output.reserve(header.size() + 2 * count);
+    output.insert(output.end(), header.begin(), header.end());
+    size_t const start = output.size();
+    output.resize(start + 2 * count);
+    uint8_t *dst = output.data() + start;
+    for (size_t i = 0; i < count; i++) {
+        dst[2 * i] = static_cast<uint8_t>(pixels[i] >> 8);
+        dst[2 * i + 1] = static_cast<uint8_t>(pixels[i]);
+    }
+}
+
+// PFM, whose rows go from the bottom of the image up, and whose scale is
+// negative for little-endian floats.
+void encodePFM(uint32_t width, uint32_t height, const float *pixels, std::vector<uint8_t> &output) {
+    uint32_t const one = 1;
+    uint8_t littleEndian;
+    memcpy(&littleEndian, &one, 1);
+    std::string header = "PF\n" + std::to_string(width) + " " + std::to_string(height) + (littleEndian ? "\n-1.0\n" : "\n1.0\n");
+    size_t const rowSize = 3 * sizeof(float) * static_cast<size_t>(width);
+    output.reserve(header.size() + rowSize * height);
+    output.insert(output.end(), header.begin(), header.end());
+    for (uint32_t y = height; y-- > 0;) {
+        const uint8_t *row = reinterpret_cast<const uint8_t *>(pixels) + rowSize * y;
+        output.insert(output.end(), row, row + rowSize);
+    }
+}
+
+// PNG
+//
+// The image data is filtered row by row with the filter that gives the
+// smallest sum of absolute differences, then compressed as a single deflate
+// block with the fixed Huffman codes. Matches are found with hash chains over
+// the 32 KB window. That is not the best compression deflate can do, but is
+// far smaller than PPM for rendered frames and needs no dependency.
+
+// Writes the bits of deflate data, least significant bit first.
+class DeflateBitWriter {
+   public:
+    explicit DeflateBitWriter(std::vector<uint8_t> &output) : output(output) {}
+
+    void write(uint32_t bits, unsigned count) {
+        buffer |= static_cast<uint64_t>(bits) << bitCount;
+        bitCount += count;
+        while (bitCount >= 8) {
+            output.push_back(static_cast<uint8_t>(buffer));
+            buffer >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    // Huffman codes are written most significant bit first.
+    void writeCode(uint32_t code, unsigned length) {
+        uint32_t reversed = 0;
+        for (unsigned i = 0; i < length; i++) {
+            reversed |= ((code >> i) & 1) << (length - 1 - i);
+        }
+        write(reversed, length);
+    }
+
+    void flush() {
+        if (bitCount > 0) output.push_back(static_cast<uint8_t>(buffer));
+        buffer = 0;
+        bitCount = 0;
+    }
+
+   private:
+    std::vector<uint8_t> &output;
+    uint64_t buffer = 0;
+    unsigned bitCount = 0;
+};
+
+static const uint16_t deflateLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                               31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t deflateLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t deflateDistanceBase[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                                 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t deflateDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                                 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Write a literal/length symbol with the fixed Huffman code.
+static void writeFixedLiteral(DeflateBitWriter &writer, unsigned symbol) {
+    if (symbol < 144) {
+        writer.writeCode(0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        writer.writeCode(0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        writer.writeCode(symbol - 256, 7);
+    } else {
+        writer.writeCode(0xC0 + symbol - 280, 8);
+    }
+}
+
+static void writeFixedMatch(DeflateBitWriter &writer, unsigned length, unsigned distance) {
+    unsigned code = 28;
+    while (deflateLengthBase[code] > length) code--;
+    writeFixedLiteral(writer, 257 + code);
+    writer.write(length - deflateLengthBase[code], deflateLengthExtra[code]);
+
+    code = 29;
+    while (deflateDistanceBase[code] > distance) code--;
+    writer.writeCode(code, 5);
+    writer.write(distance - deflateDistanceBase[code], deflateDistanceExtra[code]);
+}
+
+static void deflateFixed(const uint8_t *data, size_t size, std::vector<uint8_t> &output) {
+    static const size_t minMatch = 3;
+    static const size_t maxMatch = 258;
+    static const size_t windowSize = 32768;
+    static const unsigned maxChain = 32;
+    static const uint32_t hashBits = 15;
+
+    std::vector<int64_t> head(static_cast<size_t>(1) << hashBits, -1);
+    std::vector<int64_t> prev(windowSize, -1);
+    auto hash = [data](size_t i) {
+        return ((static_cast<uint32_t>(data[i]) << 10) ^ (static_cast<uint32_t>(data[i + 1]) << 5) ^ data[i + 2]) &
+               ((1u << hashBits) - 1);
+    };
+    auto insert = [&](size_t i) {
+        if (i + minMatch > size) return;
+        uint32_t h = hash(i);
+        prev[i & (windowSize - 1)] = head[h];
+        head[h] = static_cast<int64_t>(i);
+    };
+
+    DeflateBitWriter writer(output);
+    writer.write(1, 1);  // BFINAL, the only block
+    writer.write(1, 2);  // BTYPE, fixed Huffman codes
+
+    size_t i = 0;
+    while (i < size) {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+        if (i + minMatch <= size) {
+            size_t const maxLength = std::min(maxMatch, size - i);
+            int64_t candidate = head[hash(i)];
+            for (unsigned chain = 0; chain < maxChain && candidate >= 0 && i - candidate <= windowSize; chain++) {
+                const uint8_t *match = data + candidate;
+                size_t length = 0;
+                while (length < maxLength && match[length] == data[i + length]) length++;
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDistance = i - candidate;
+                    if (length == maxLength) break;
+                }
+                candidate = prev[candidate & (windowSize - 1)];
+            }
+        }
+
+        if (bestLength >= minMatch) {
+            writeFixedMatch(writer, static_cast<unsigned>(bestLength), static_cast<unsigned>(bestDistance));
+            for (size_t end = i + bestLength; i < end; i++) insert(i);
+        } else {
+            writeFixedLiteral(writer, data[i]);
+            insert(i);
+            i++;
+        }
+    }
+
+    writeFixedLiteral(writer, 256);  // end of block
+    writer.flush();
+}
+
+static uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t adler32(const uint8_t *data, size_t size) {
+    uint32_t a = 1, b = 0;
+    while (size > 0) {
+        // 5552 is the most bytes that can be summed before b overflows.
+        size_t const count = std::min<size_t>(size, 5552);
+        for (size_t i = 0; i < count; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += count;
+        size -= count;
+    }
+    return (b << 16) | a;
+}
+
+static void appendPNGChunk(std::vector<uint8_t> &output, const char *type, const uint8_t *data, size_t size) {
+    appendBigEndian32(output, static_cast<uint32_t>(size));
+    size_t const start = output.size();
+    output.insert(output.end(), type, type + 4);
+    output.insert(output.end(), data, data + size);
+    appendBigEndian32(output, crc32(output.data() + start, output.size() - start));
+}
+
+static uint8_t paethPredictor(int a, int b, int c) {
+    int const p = a + b - c;
+    int const pa = abs(p - a);
+    int const pb = abs(p - b);
+    int const pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    if (pb <= pc) return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+}
+
+void encodePNG(uint32_t width, uint32_t height, const uint8_t *pixels, std::vector<uint8_t> &output) {
+    size_t const rowSize = 3 * static_cast<size_t>(width);
+
+    // Filter each row with the filter that gives the smallest sum of absolute
+    // differences, the usual heuristic.
+    std::vector<uint8_t> filtered;
+    filtered.reserve((rowSize + 1) * height);
+    std::vector<uint8_t> candidates[5];
+    for (auto &candidate : candidates) candidate.resize(rowSize);
+    std::vector<uint8_t> zeroRow(rowSize, 0);
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *row = pixels + y * rowSize;
+        const uint8_t *above = y > 0 ? row - rowSize : zeroRow.data();
+        for (size_t x = 0; x < rowSize; x++) {
+            int const left = x >= 3 ? row[x - 3] : 0;
+            int const up = above[x];
+            int const upLeft = x >= 3 ? above[x - 3] : 0;
+            candidates[0][x] = row[x];
+            candidates[1][x] = static_cast<uint8_t>(row[x] - left);
+            candidates[2][x] = static_cast<uint8_t>(row[x] - up);
+            candidates[3][x] = static_cast<uint8_t>(row[x] - ((left + up) >> 1));
+            candidates[4][x] = static_cast<uint8_t>(row[x] - paethPredictor(left, up, upLeft));
+        }
+        int bestFilter = 0;
+        uint64_t bestSum = UINT64_MAX;
+        for (int filter = 0; filter < 5; filter++) {
+            uint64_t sum = 0;
+            for (uint8_t value : candidates[filter]) sum += value < 128 ? value : 256 - value;
+            if (sum < bestSum) {
+                bestSum = sum;
+                bestFilter = filter;
+            }
+        }
+        filtered.push_back(static_cast<uint8_t>(bestFilter));
+        filtered.insert(filtered.end(), candidates[bestFilter].begin(), candidates[bestFilter].end());
+    }
+
+    // The zlib stream: header, deflate data and the Adler-32 of the data.
+    std::vector<uint8_t> compressed = {0x78, 0x01};
+    deflateFixed(filtered.data(), filtered.size(), compressed);
+    appendBigEndian32(compressed, adler32(filtered.data(), filtered.size()));
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    output.insert(output.end(), signature, signature + sizeof(signature));
+
+    std::vector<uint8_t> header;
+    appendBigEndian32(header, width);
+    appendBigEndian32(header, height);
+    header.push_back(8);  // bit depth
+    header.push_back(2);  // color type: RGB
+    header.push_back(0);  // compression method
+    header.push_back(0);  // filter method
+    header.push_back(0);  // interlace method
+    appendPNGChunk(output, "IHDR", header.data(), header.size());
+    appendPNGChunk(output, "IDAT", compressed.data(), compressed.size());
+    appendPNGChunk(output, "IEND", nullptr, 0);
+}
+
+// QOI, as specified at https://qoiformat.org/qoi-specification.pdf.
+
+void encodeQOI(uint32_t width, uint32_t height, const uint8_t *pixels, std::vector<uint8_t> &output) {
+    static const uint8_t QOI_OP_DIFF = 0x40;
+    static const uint8_t QOI_OP_LUMA = 0x80;
+    static const uint8_t QOI_OP_RUN = 0xC0;
+    static const uint8_t QOI_OP_RGB = 0xFE;
+
+    size_t const pixelCount = static_cast<size_t>(width) * height;
+    output.reserve(output.size() + 14 + pixelCount + 8);
+    output.push_back('q');
+    output.push_back('o');
+    output.push_back('i');
+    output.push_back('f');
+    appendBigEndian32(output, width);
+    appendBigEndian32(output, height);
+    output.push_back(3);  // channels
+    output.push_back(0);  // colorspace: sRGB with linear alpha
+
+    // Every pixel is opaque, so the alpha, always 255, is left out of the
+    // differences. The index keeps it, since its entries start out as
+    // transparent black.
+    uint8_t index[64][4] = {};
+    uint8_t prevR = 0, prevG = 0, prevB = 0;
+    unsigned run = 0;
+    for (size_t i = 0; i < pixelCount; i++) {
+        uint8_t const r = pixels[3 * i];
+        uint8_t const g = pixels[3 * i + 1];
+        uint8_t const b = pixels[3 * i + 2];
+
+        if (r == prevR && g == prevG && b == prevB) {
+            run++;
+            if (run == 62 || i == pixelCount - 1) {
+                output.push_back(static_cast<uint8_t>(QOI_OP_RUN | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run > 0) {
+            output.push_back(static_cast<uint8_t>(QOI_OP_RUN | (run - 1)));
+            run = 0;
+        }
+
+        unsigned const hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+        if (index[hash][0] == r && index[hash][1] == g && index[hash][2] == b && index[hash][3] == 255) {
+            output.push_back(static_cast<uint8_t>(hash));  // QOI_OP_INDEX
+        } else {
+            index[hash][0] = r;
+            index[hash][1] = g;
+            index[hash][2] = b;
+            index[hash][3] = 255;
+
+            int const dr = static_cast<int8_t>(r - prevR);
+            int const dg = static_cast<int8_t>(g - prevG);
+            int const db = static_cast<int8_t>(b - prevB);
+            int const drg = dr - dg;
+            int const dbg = db - dg;
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                output.push_back(static_cast<uint8_t>(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+            } else if (drg >= -8 && drg <= 7 && dg >= -32 && dg <= 31 && dbg >= -8 && dbg <= 7) {
+                output.push_back(static_cast<uint8_t>(QOI_OP_LUMA | (dg + 32)));
+                output.push_back(static_cast<uint8_t>((drg + 8) << 4 | (dbg + 8)));
+            } else {
+                output.push_back(QOI_OP_RGB);
+                output.push_back(r);
+                output.push_back(g);
+                output.push_back(b);
+            }
+        }
+
+        prevR = r;
+        prevG = g;
+        prevB = b;
+    }
+
+    static const uint8_t padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    output.insert(output.end(), padding, padding + sizeof(padding));
+}
+
+// A 64-bit multiply and rotate hash over 8 bytes at a time, which is enough to
+// tell frames apart and much faster than encoding them.
+uint64_t hashPixels(uint32_t width, uint32_t height, const uint8_t *pixels, size_t size) {
+    static const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+    static const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+    uint64_t hash = (static_cast<uint64_t>(width) << 32 | height) * prime1;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, pixels + i, sizeof(word));
+        hash ^= word * prime2;
+        hash = (hash << 31 | hash >> 33) * prime1;
+    }
+    for (; i < size; i++) {
+        hash ^= pixels[i] * prime2;
+        hash = (hash << 31 | hash >> 33) * prime1;
+    }
+    hash ^= hash >> 29;
+    hash *= prime2;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+ScreenshotComparison compareTiles(uint32_t width, uint32_t height, const uint8_t *pixels, const uint8_t *reference,
+                                  double threshold) {
+    ScreenshotComparison comparison;
+    uint32_t const tileSize = SCREENSHOT_COMPARE_TILE_SIZE;
+    for (uint32_t tileY = 0; tileY < height; tileY += tileSize) {
+        uint32_t const tileHeight = std::min(tileSize, height - tileY);
+        for (uint32_t tileX = 0; tileX < width; tileX += tileSize) {
+            uint32_t const tileWidth = std::min(tileSize, width - tileX);
+            uint64_t sum = 0;
+            for (uint32_t y = tileY; y < tileY + tileHeight; y++) {
+                size_t const start = 3 * (static_cast<size_t>(y) * width + tileX);
+                for (size_t i = start; i < start + 3 * tileWidth; i++) {
+                    sum += pixels[i] > reference[i] ? pixels[i] - reference[i] : reference[i] - pixels[i];
+                }
+            }
+            double const error = static_cast<double>(sum) / (3.0 * tileWidth * tileHeight);
+            comparison.worstTileError = std::max(comparison.worstTileError, error);
+            if (error > threshold) comparison.failedTiles++;
+            comparison.tileCount++;
+        }
+    }
+    return comparison;
+}
+
+void ScreenshotEncoder::skipDuplicates(const std::string &fileName) {
+    std::lock_guard<std::mutex> lock(mutex);
+    skippingDuplicates = true;
+    manifestFileName = fileName;
+}
+
+// Record the file of an image to the manifest, and tell whether the image is
+// the same as the last one written for its stream, so that it need not be
+// written. The images of a stream can be hashed out of order by the threads,
+// but an image is only ever matched with an earlier identical one.
+bool ScreenshotEncoder::isDuplicate(const ScreenshotImage &image) {
+    uint64_t const hash = hashPixels(image.width, image.height, image.pixels.data(), image.pixels.size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::string *fileName = &image.fileName;
+    auto last = lastImages.find(image.stream);
+    bool const duplicate = last != lastImages.end() && last->second.hash == hash;
+    if (duplicate) {
+        fileName = &last->second.fileName;
+    } else {
+        lastImages[image.stream] = {hash, image.fileName};
+    }
+
+    if (!manifest) {
+        // The manifest is created with the first image, and appended to if
+        // the threads are started again.
+        manifest = fopen(manifestFileName.c_str(), manifestCreated ? "a" : "w");
+        manifestCreated = true;
+    }
+    if (manifest) {
+        fprintf(manifest, "%d %s\n", image.frameNumber, fileName->c_str());
+    }
+    return duplicate;
+}
+
+void ScreenshotEncoder::compareWithReferences(const std::string &dir, double threshold, const std::string &fileName) {
+    std::lock_guard<std::mutex> lock(mutex);
+    comparing = true;
+    referenceDir = dir;
+    referenceThreshold = threshold;
+    resultsFileName = fileName;
+}
+
+// Compare an image with the reference of the same name, record the outcome
+// to the results file, and tell whether the image matches, so that it need
+// not be written. Only the reference of the image is read, when the image is
+// compared, so that the references of a long run are never all in memory.
+bool ScreenshotEncoder::matchesReference(const ScreenshotImage &image, const std::string &dir, double threshold) {
+    size_t const nameStart = image.fileName.find_last_of("/\\");
+    std::string name = nameStart == std::string::npos ? image.fileName : image.fileName.substr(nameStart + 1);
+    name = name.substr(0, name.find_last_of('.')) + screenshotFileExtension(SCREENSHOT_FILE_FORMAT_PPM);
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> reference;
+    bool const found = decodePPM(dir + "/" + name, width, height, reference) && width == image.width && height == image.height;
+    ScreenshotComparison comparison;
+    if (found) comparison = compareTiles(image.width, image.height, image.pixels.data(), reference.data(), threshold);
+    bool const matches = found && comparison.failedTiles == 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!results) {
+        // The results file is created with the first image, and appended to
+        // if the threads are started again.
+        results = fopen(resultsFileName.c_str(), resultsCreated ? "a" : "w");
+        resultsCreated = true;
+    }
+    if (results) {
+        fprintf(results, "%d %s %.3f %u/%u %s\n", image.frameNumber, matches ? "match" : (found ? "differ" : "missing"),
+                comparison.worstTileError, comparison.failedTiles, comparison.tileCount, image.fileName.c_str());
+    }
+    return matches;
+}
+
+// Append a frame to the file of its stream, once the frames added before it
+// have been, opening the file with the first frame.
+void ScreenshotEncoder::appendToStream(const ScreenshotImage &image, const std::vector<uint8_t> &encoded) {
+    StreamFile *stream;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stream = &streams[image.stream];
+        streamWritten.wait(lock, [stream, &image] { return stream->written == image.sequence; });
+    }
+
+    // The other threads wait for their turn, so the file is only used here.
+    if (!stream->opened) {
+        stream->opened = true;
+        // The file may also be a named pipe that an encoder reads from.
+        stream->file = fopen(image.fileName.c_str(), "wb");
+        if (stream->file) {
+            std::vector<uint8_t> header;
+            encodeY4MHeader(image.width, image.height, header);
+            fwrite(header.data(), 1, header.size(), stream->file);
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_INFO, "screenshot", "Screen capture stream is: %s", image.fileName.c_str());
+#else
+            printf("screenshot: Capture stream is: %s \n", image.fileName.c_str());
+#endif
+        } else {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_DEBUG, "screenshot", "Failed to open output file: %s", image.fileName.c_str());
+#else
+            fprintf(stderr, "screenshot: Failed to open output file: %s\n", image.fileName.c_str());
+#endif
+        }
+    }
+    if (stream->file) {
+        fwrite(encoded.data(), 1, encoded.size(), stream->file);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        passStreamTurn(*stream);
+    }
+    streamWritten.notify_all();
+}
+
+// Pass the turn of a stream on to its next frame that was not dropped. Called
+// with the mutex held.
+void ScreenshotEncoder::passStreamTurn(StreamFile &stream) {
+    stream.written++;
+    while (stream.dropped.erase(stream.written)) stream.written++;
+}
+
+static const char *const screenshotStageNames[SCREENSHOT_STAGE_COUNT] = {"submit", "gpu", "readback", "queued", "encode", "write"};
+
+// The pixel format of the images of a file format in a ring.
+static uint32_t ringPixelFormat(ScreenshotFileFormat format) {
+    switch (format) {
+        case SCREENSHOT_FILE_FORMAT_PPM16:
+            return SCREENSHOT_RING_PIXEL_FORMAT_RGB16;
+        case SCREENSHOT_FILE_FORMAT_PFM:
+            return SCREENSHOT_RING_PIXEL_FORMAT_RGB32F;
+        case SCREENSHOT_FILE_FORMAT_RAW:
+            return SCREENSHOT_RING_PIXEL_FORMAT_RAW;
+        default:
+            return SCREENSHOT_RING_PIXEL_FORMAT_RGB8;
+    }
+}
+
+void ScreenshotEncoder::publishTo(const std::string &ringName) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ring.reset(new ScreenshotRing(ringName, 4));
+}
+
+void ScreenshotEncoder::enableTiming() {
+    std::lock_guard<std::mutex> lock(mutex);
+    timing = true;
+}
+
+// Print the timing of a written capture and add it to the totals.
+void ScreenshotEncoder::recordTiming(const ScreenshotImage &image, size_t bytes) {
+    std::string line = "Frame " + std::to_string(image.frameNumber) + " timing (us):";
+    for (int stage = 0; stage < SCREENSHOT_STAGE_COUNT; stage++) {
+        line += std::string(" ") + screenshotStageNames[stage] + " " +
+                std::to_string(static_cast<uint64_t>(image.timing.microseconds[stage]));
+    }
+    line += ", " + std::to_string(bytes) + " bytes, read back from memory type " + std::to_string(image.readbackMemoryType) +
+            (image.readbackCached ? " (cached)" : " (uncached)");
+#ifdef ANDROID
+    __android_log_print(ANDROID_LOG_INFO, "screenshot", "%s", line.c_str());
+#else
+    printf("screenshot: %s\n", line.c_str());
+#endif
+
+    std::lock_guard<std::mutex> lock(mutex);
+    timedCaptures++;
+    bytesWritten += bytes;
+    if (!image.readbackCached) uncachedReadbacks++;
+    for (int stage = 0; stage < SCREENSHOT_STAGE_COUNT; stage++) {
+        totalTiming.microseconds[stage] += image.timing.microseconds[stage];
+        maxTiming.microseconds[stage] = std::max(maxTiming.microseconds[stage], image.timing.microseconds[stage]);
+    }
+}
+
+void ScreenshotEncoder::reportTiming() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!timing || timedCaptures == 0) return;
+
+    std::string line = "Timing of " + std::to_string(timedCaptures) + " captures (us, average/longest):";
+    for (int stage = 0; stage < SCREENSHOT_STAGE_COUNT; stage++) {
+        line += std::string(" ") + screenshotStageNames[stage] + " " +
+                std::to_string(static_cast<uint64_t>(totalTiming.microseconds[stage] / timedCaptures)) + "/" +
+                std::to_string(static_cast<uint64_t>(maxTiming.microseconds[stage]));
+    }
+    // The throughput is of the encoder threads, encoding and writing.
+    double const busySeconds =
+        (totalTiming.microseconds[SCREENSHOT_STAGE_ENCODE] + totalTiming.microseconds[SCREENSHOT_STAGE_WRITE]) / 1000000.0;
+    char throughput[64];
+    snprintf(throughput, sizeof(throughput), "%.1f MB/s", busySeconds > 0 ? bytesWritten / busySeconds / 1000000.0 : 0.0);
+    line += ", " + std::to_string(bytesWritten) + " bytes written, " + throughput;
+    if (uncachedReadbacks > 0) line += ", " + std::to_string(uncachedReadbacks) + " read back from uncached memory";
+#ifdef ANDROID
+    __android_log_print(ANDROID_LOG_INFO, "screenshot", "%s", line.c_str());
+#else
+    printf("screenshot: %s\n", line.c_str());
+#endif
+}
+
+void ScreenshotEncoder::limitQueue(size_t maxImages, size_t maxBytes, ScreenshotBackpressure policy) {
+    std::lock_guard<std::mutex> lock(mutex);
+    maxQueuedImages = std::max(maxImages, size_t(1));
+    maxQueuedBytes = maxBytes;
+    backpressure = policy;
+}
+
+uint64_t ScreenshotEncoder::droppedImages() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return dropped;
+}
+
+// Whether an image of addedBytes of pixels does not fit in the queue. Called
+// with the mutex held.
+bool ScreenshotEncoder::queueIsFull(size_t addedBytes) const {
+    if (images.empty()) return false;
+    return images.size() >= maxQueuedImages || (maxQueuedBytes > 0 && queuedBytes + addedBytes > maxQueuedBytes);
+}
+
+// Count an image that is not queued, or taken out of the queue. Called with
+// the mutex held.
+void ScreenshotEncoder::dropImage(const ScreenshotImage &image) {
+    dropped++;
+#ifdef ANDROID
+    __android_log_print(ANDROID_LOG_INFO, "screenshot", "Frame %d dropped, the encoder queue is full", image.frameNumber);
+#else
+    printf("screenshot: Frame %d dropped, the encoder queue is full\n", image.frameNumber);
+#endif
+}
+
+void ScreenshotEncoder::add(ScreenshotImage &&image) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (threads.empty()) {
+        for (unsigned i = 0; i < threadCount; i++) threads.emplace_back(&ScreenshotEncoder::run, this);
+    }
+    size_t const bytes = image.pixels.size();
+    switch (backpressure) {
+        case SCREENSHOT_BACKPRESSURE_DROP_NEWEST:
+            // The frame is dropped before it gets a turn in its stream.
+            if (queueIsFull(bytes)) {
+                dropImage(image);
+                return;
+            }
+            break;
+        case SCREENSHOT_BACKPRESSURE_DROP_OLDEST:
+            while (queueIsFull(bytes)) {
+                const ScreenshotImage &oldest = images.front();
+                if (oldest.format == SCREENSHOT_FILE_FORMAT_Y4M) {
+                    StreamFile &stream = streams[oldest.stream];
+                    if (stream.written == oldest.sequence) {
+                        passStreamTurn(stream);
+                        streamWritten.notify_all();
+                    } else {
+                        stream.dropped.insert(oldest.sequence);
+                    }
+                }
+                queuedBytes -= oldest.pixels.size();
+                dropImage(oldest);
+                images.pop_front();
+            }
+            break;
+        case SCREENSHOT_BACKPRESSURE_BLOCK:
+        default:
+            dequeued.wait(lock, [this, bytes] { return !queueIsFull(bytes); });
+            break;
+    }
+    if (image.format == SCREENSHOT_FILE_FORMAT_Y4M) {
+        image.sequence = streams[image.stream].added++;
+    }
+    image.queuedTime = std::chrono::steady_clock::now();
+    queuedBytes += bytes;
+    images.push_back(std::move(image));
+    queued.notify_one();
+}
+
+void ScreenshotEncoder::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (threads.empty()) return;
+        stopping = true;
+    }
+    queued.notify_all();
+    for (auto &thread : threads) thread.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.clear();
+    stopping = false;
+    if (manifest) {
+        fclose(manifest);
+        manifest = nullptr;
+    }
+    if (results) {
+        fclose(results);
+        results = nullptr;
+    }
+    for (auto &stream : streams) {
+        if (stream.second.file) fclose(stream.second.file);
+    }
+    streams.clear();
+}
+
+void ScreenshotEncoder::run() {
+    std::vector<uint8_t> encoded;
+    for (;;) {
+        ScreenshotImage image;
+        bool checkDuplicate;
+        bool compare;
+        std::string compareDir;
+        double compareThreshold;
+        bool timed;
+        ScreenshotRing *publishing;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queued.wait(lock, [this] { return !images.empty() || stopping; });
+            if (images.empty()) return;
+            image = std::move(images.front());
+            images.pop_front();
+            queuedBytes -= image.pixels.size();
+            checkDuplicate = skippingDuplicates;
+            compare = comparing;
+            compareDir = referenceDir;
+            compareThreshold = referenceThreshold;
+            timed = timing;
+            publishing = ring.get();
+        }
+        dequeued.notify_one();
+        image.timing.microseconds[SCREENSHOT_STAGE_QUEUED] = microsecondsSince(image.queuedTime);
+
+        // A published frame is left for the readers of the ring to compare
+        // and encode, if they need to.
+        if (publishing) {
+            auto publishStart = std::chrono::steady_clock::now();
+            bool const published = publishing->publish(image.frameNumber, image.stream, image.width, image.height,
+                                                       ringPixelFormat(image.format), image.pixels.data(), image.pixels.size());
+            image.timing.microseconds[SCREENSHOT_STAGE_WRITE] = microsecondsSince(publishStart);
+            if (timed) recordTiming(image, published ? image.pixels.size() : 0);
+            continue;
+        }
+
+        // The frames of a stream are all kept, so that it plays at the pace
+        // it was captured.
+        if (checkDuplicate && image.format != SCREENSHOT_FILE_FORMAT_Y4M && isDuplicate(image)) {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_INFO, "screenshot", "Frame %d is the same as the previous capture, not written",
+                                image.frameNumber);
+#else
+            printf("screenshot: Frame %d is the same as the previous capture, not written\n", image.frameNumber);
+#endif
+            if (timed) recordTiming(image, 0);
+            continue;
+        }
+
+        // Only the images of 8-bit RGB triplets are compared, and not the
+        // frames of a stream, which are all kept.
+        bool const rgb8 = image.format == SCREENSHOT_FILE_FORMAT_PPM || image.format == SCREENSHOT_FILE_FORMAT_PNG ||
+                          image.format == SCREENSHOT_FILE_FORMAT_QOI;
+        if (compare && rgb8 && matchesReference(image, compareDir, compareThreshold)) {
+            if (timed) recordTiming(image, 0);
+            continue;
+        }
+
+        auto encodeStart = std::chrono::steady_clock::now();
+        encoded.clear();
+        switch (image.format) {
+            case SCREENSHOT_FILE_FORMAT_PNG:
+                encodePNG(image.width, image.height, image.pixels.data(), encoded);
+                break;
+            case SCREENSHOT_FILE_FORMAT_QOI:
+                encodeQOI(image.width, image.height, image.pixels.data(), encoded);
+                break;
+            case SCREENSHOT_FILE_FORMAT_Y4M:
+                encodeY4MFrame(image.width, image.height, image.pixels.data(), encoded);
+                break;
+            case SCREENSHOT_FILE_FORMAT_PPM16:
+                encodePPM16(image.width, image.height, reinterpret_cast<const uint16_t *>(image.pixels.data()), encoded);
+                break;
+            case SCREENSHOT_FILE_FORMAT_PFM:
+                encodePFM(image.width, image.height, reinterpret_cast<const float *>(image.pixels.data()), encoded);
+                break;
+            case SCREENSHOT_FILE_FORMAT_RAW:
+                // The pixels are the file, written as they are.
+                break;
+            case SCREENSHOT_FILE_FORMAT_PPM:
+            default:
+                encodePPM(image.width, image.height, image.pixels.data(), encoded);
+                break;
+        }
+        image.timing.microseconds[SCREENSHOT_STAGE_ENCODE] = microsecondsSince(encodeStart);
+
+        auto writeStart = std::chrono::steady_clock::now();
+        if (image.format == SCREENSHOT_FILE_FORMAT_Y4M) {
+            // The write of a stream frame includes waiting for its turn.
+            appendToStream(image, encoded);
+            image.timing.microseconds[SCREENSHOT_STAGE_WRITE] = microsecondsSince(writeStart);
+            if (timed) recordTiming(image, encoded.size());
+            continue;
+        }
+
+        std::ofstream file(image.fileName, std::ios::binary);
+        if (!file.is_open()) {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_DEBUG, "screenshot", "Failed to open output file: %s", image.fileName.c_str());
+#else
+            fprintf(stderr, "screenshot: Failed to open output file: %s\n", image.fileName.c_str());
+#endif
+            continue;
+        }
+        bool const raw = image.format == SCREENSHOT_FILE_FORMAT_RAW;
+        size_t const fileSize = raw ? image.pixels.size() : encoded.size();
+        file.write(reinterpret_cast<const char *>(raw ? image.pixels.data() : encoded.data()), fileSize);
+        file.close();
+        image.timing.microseconds[SCREENSHOT_STAGE_WRITE] = microsecondsSince(writeStart);
+
+#ifdef ANDROID
+        __android_log_print(ANDROID_LOG_INFO, "screenshot", "Screen capture file is: %s", image.fileName.c_str());
+#else
+        printf("screenshot: Capture file is: %s \n", image.fileName.c_str());
+#endif
+        if (timed) recordTiming(image, fileSize);
+    }
+}
+
+}  // namespace screenshot
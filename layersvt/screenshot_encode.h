@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2015-2021 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "screenshot_ring.h"
+#include "vk_layer_memory.h"
+
+namespace screenshot {
+
+// The formats the screenshot files can be written in.
+typedef enum ScreenshotFileFormat {
+    SCREENSHOT_FILE_FORMAT_PPM = 0,  // uncompressed, binary (P6) PPM
+    SCREENSHOT_FILE_FORMAT_PNG = 1,  // compressed with deflate, readable by about anything
+    SCREENSHOT_FILE_FORMAT_QOI = 2,  // "Quite OK Image" format, compressed and fast to encode
+    SCREENSHOT_FILE_FORMAT_Y4M = 3,  // YUV 4:2:0 video, every frame of a swapchain appended to one file
+    SCREENSHOT_FILE_FORMAT_PPM16 = 4,  // binary PPM with 16 bits per channel
+    SCREENSHOT_FILE_FORMAT_PFM = 5,    // "Portable Float Map", linear 32-bit float RGB
+    SCREENSHOT_FILE_FORMAT_RAW = 6,    // the texels of the swapchain image as they are, with no header
+} ScreenshotFileFormat;
+
+// The extension of the files of a format, including the dot.
+const char *screenshotFileExtension(ScreenshotFileFormat format);
+
+// The pixels of the images in a format, packed tightly, with no padding
+// between rows. They are 8-bit RGB triplets, except for the formats that keep
+// more bits of the swapchain images:
+//   PPM16: 16-bit RGB triplets, in the byte order of the host
+//   PFM:   32-bit float RGB triplets, in the byte order of the host
+//   RAW:   texels in the format of the swapchain images
+
+// Repack a row of width pixels of numChannels (3 or 4) 8-bit channels to
+// packed RGB triplets, dropping the fourth channel and swapping the first and
+// third if swapRedBlue is set. Whole groups of pixels are converted with SIMD
+// instructions where the CPU has them.
+void repackRowRGB(const uint8_t *src, uint8_t *dst, uint32_t width, uint32_t numChannels, bool swapRedBlue);
+
+// Repack a row of width pixels of 32-bit float RGBA to 16-bit RGB, clamped to
+// [0, 1], or to 32-bit float RGB.
+void repackRowRGB16(const float *src, uint16_t *dst, uint32_t width);
+void repackRowRGB32F(const float *src, float *dst, uint32_t width);
+
+// Encode an image in a file format, from the pixels of the format.
+void encodePPM(uint32_t width, uint32_t height, const uint8_t *pixels, std::vector<uint8_t> &output);
+void encodePNG(uint32_t width, uint32_t height, const uint8_t *pixels, std::vector<uint8_t> &output);
+void encodeQOI(uint32_t width, uint32_t height, const uint8_t *pixels, std::vector<uint8_t> &output);
+void encodePPM16(uint32_t width, uint32_t height, const uint16_t *pixels, std::vector<uint8_t> &output);
+void encodePFM(uint32_t width, uint32_t height, const float *pixels, std::vector<uint8_t> &output);
+
+// Encode the header of a Y4M stream, and a frame of it, converted to YUV 4:2:0
+// with the full range BT.601 coefficients of JPEG.
+void encodeY4MHeader(uint32_t width, uint32_t height, std::vector<uint8_t> &output);
+void encodeY4MFrame(uint32_t width, uint32_t height, const uint8_t *pixels, std::vector<uint8_t> &output);
+
+// Hash the size bytes of the pixels of an image, to tell identical frames
+// apart.
+uint64_t hashPixels(uint32_t width, uint32_t height, const uint8_t *pixels, size_t size);
+
+// Read a binary PPM file of 8-bit channels to RGB triplets.
+bool decodePPM(const std::string &fileName, uint32_t &width, uint32_t &height, std::vector<uint8_t> &pixels);
+
+// The side of the square tiles two images are compared by.
+const uint32_t SCREENSHOT_COMPARE_TILE_SIZE = 16;
+
+// How an image compares with its reference. The error of a tile is the mean
+// absolute difference of its 8-bit channels.
+struct ScreenshotComparison {
+    double worstTileError = 0.0;
+    uint32_t failedTiles = 0;  // whose error is above the threshold
+    uint32_t tileCount = 0;
+};
+
+// Compare two images of 8-bit RGB triplets of the same size, tile by tile.
+ScreenshotComparison compareTiles(uint32_t width, uint32_t height, const uint8_t *pixels, const uint8_t *reference,
+                                  double threshold);
+
+// The stages of a capture that are timed.
+typedef enum ScreenshotStage {
+    SCREENSHOT_STAGE_SUBMIT = 0,    // recording and submitting the copy
+    SCREENSHOT_STAGE_GPU = 1,       // from the submit until the copy is found complete
+    SCREENSHOT_STAGE_READBACK = 2,  // reading the mapped buffer back and repacking it to RGB
+    SCREENSHOT_STAGE_QUEUED = 3,    // waiting for an encoder thread
+    SCREENSHOT_STAGE_ENCODE = 4,
+    SCREENSHOT_STAGE_WRITE = 5,
+    SCREENSHOT_STAGE_COUNT = 6
+} ScreenshotStage;
+
+// The time a capture spent in each stage, in microseconds.
+struct ScreenshotTiming {
+    double microseconds[SCREENSHOT_STAGE_COUNT] = {};
+};
+
+// The microseconds from a time until now.
+inline double microsecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// What adding an image to the full queue of a ScreenshotEncoder does.
+typedef enum ScreenshotBackpressure {
+    SCREENSHOT_BACKPRESSURE_BLOCK = 0,        // wait for an encoder thread to take an image, which holds the present back
+    SCREENSHOT_BACKPRESSURE_DROP_NEWEST = 1,  // drop the image added
+    SCREENSHOT_BACKPRESSURE_DROP_OLDEST = 2,  // drop the images queued first, until the image added fits
+} ScreenshotBackpressure;
+
+// The pixels of the frames waiting for the encoder threads, or being written
+// by them.
+inline LayerMemoryAccount screenshotFrameMemory("queued frames");
+typedef std::vector<uint8_t, LayerAllocator<uint8_t, screenshotFrameMemory>> ScreenshotPixels;
+
+// A frame to write to a screenshot file. The frames of a stream in the Y4M
+// format are all appended to the file of the first one.
+struct ScreenshotImage {
+    std::string fileName;
+    int frameNumber;
+    uintptr_t stream;  // identifies the swapchain, whose frames are compared to each other
+    uint64_t sequence;  // the order of the frame in its stream, set by ScreenshotEncoder::add()
+    ScreenshotTiming timing;  // of the stages before the encoder, filled in by it for the others
+    uint32_t readbackMemoryType = 0;  // the memory type the pixels were read back from
+    bool readbackCached = true;  // whether that memory type is host-cached
+    std::chrono::steady_clock::time_point queuedTime;
+    ScreenshotFileFormat format;
+    uint32_t width;
+    uint32_t height;
+    ScreenshotPixels pixels;  // as for the format
+};
+
+// Threads that encode and write screenshot files, so that the present thread
+// only has to copy the frame out of the mapped memory. The queue of images
+// is bounded, in images and in bytes, and what adding an image to the full
+// queue does is set by limitQueue(). The threads are started with the first
+// image and stopped by finish().
+class ScreenshotEncoder {
+   public:
+    ScreenshotEncoder(unsigned threadCount, size_t maxQueuedImages) : threadCount(threadCount), maxQueuedImages(maxQueuedImages) {}
+    ~ScreenshotEncoder() { finish(); }
+
+    // Skip the images that are the same as the last image written for their
+    // stream, and record the file of every image, written or not, to a
+    // manifest file, one "<frame number> <file name>" line per image.
+    void skipDuplicates(const std::string &manifestFileName);
+
+    // Bound the queue to maxImages images and maxBytes bytes of pixels, 0 for
+    // no bound in bytes, and set what adding an image to the full queue does.
+    // An image larger than maxBytes is queued alone.
+    void limitQueue(size_t maxImages, size_t maxBytes, ScreenshotBackpressure backpressure);
+
+    // The number of images dropped so far because the queue was full.
+    uint64_t droppedImages();
+
+    // Publish the images to a shared memory ring of the given name instead
+    // of encoding them to files.
+    void publishTo(const std::string &ringName);
+
+    // Compare the images of 8-bit RGB triplets with the PPM file of the same
+    // name in referenceDir, and only write the images that differ from it in
+    // some tile by more than threshold, or have no reference. The outcome for
+    // every image is recorded to a results file, one
+    // "<frame number> <match|differ|missing> <worst tile error> <failed tiles>/<tiles> <file name>"
+    // line per image.
+    void compareWithReferences(const std::string &referenceDir, double threshold, const std::string &resultsFileName);
+
+    // Time the stages of each capture, and print them once it is written.
+    void enableTiming();
+
+    // Print the average and longest time of each stage over the captures
+    // written so far, and the throughput of the writes.
+    void reportTiming();
+
+    // Queue an image to be encoded and written to its file.
+    void add(ScreenshotImage &&image);
+
+    // Wait for the queued images to be written and stop the threads.
+    void finish();
+
+   private:
+    void run();
+    bool isDuplicate(const ScreenshotImage &image);
+    bool matchesReference(const ScreenshotImage &image, const std::string &referenceDir, double threshold);
+    bool queueIsFull(size_t addedBytes) const;
+    void dropImage(const ScreenshotImage &image);
+    void appendToStream(const ScreenshotImage &image, const std::vector<uint8_t> &encoded);
+    void recordTiming(const ScreenshotImage &image, size_t bytes);
+
+    // The last image written for a stream.
+    struct WrittenImage {
+        uint64_t hash;
+        std::string fileName;
+    };
+
+    const unsigned threadCount;
+    size_t maxQueuedImages;
+    size_t maxQueuedBytes = 0;
+    ScreenshotBackpressure backpressure = SCREENSHOT_BACKPRESSURE_BLOCK;
+    std::mutex mutex;
+    std::condition_variable queued;   // an image was queued, or the threads are stopping
+    std::condition_variable dequeued;  // an image was taken from the queue
+    std::deque<ScreenshotImage> images;
+    size_t queuedBytes = 0;  // of the pixels of the images
+    uint64_t dropped = 0;
+    std::vector<std::thread> threads;
+    bool stopping = false;
+
+    // Used when duplicates are skipped, with the mutex held.
+    bool skippingDuplicates = false;
+    std::string manifestFileName;
+    FILE *manifest = nullptr;
+    bool manifestCreated = false;
+
+    // Used when the images are compared with references, with the mutex held.
+    bool comparing = false;
+    std::string referenceDir;
+    double referenceThreshold = 0.0;
+    std::string resultsFileName;
+    FILE *results = nullptr;
+    bool resultsCreated = false;
+    std::unordered_map<uintptr_t, WrittenImage> lastImages;
+
+    // The file of a Y4M stream. The frames are encoded in any order, and
+    // appended in the order they were added, by the thread of the frame
+    // whose turn it is. The turn of a frame dropped from the queue is passed
+    // on once it comes.
+    struct StreamFile {
+        FILE *file = nullptr;
+        bool opened = false;
+        uint64_t added = 0;
+        uint64_t written = 0;
+        std::set<uint64_t> dropped;
+    };
+    void passStreamTurn(StreamFile &stream);
+    std::unordered_map<uintptr_t, StreamFile> streams;
+    std::condition_variable streamWritten;  // a frame was appended to a stream
+
+    // The ring the images are published to, if any.
+    std::unique_ptr<ScreenshotRing> ring;
+
+    // The timing of the captures written so far.
+    bool timing = false;
+    uint64_t timedCaptures = 0;
+    uint64_t bytesWritten = 0;
+    uint64_t uncachedReadbacks = 0;
+    ScreenshotTiming totalTiming;
+    ScreenshotTiming maxTiming;
+};
+
+}  // namespace screenshot
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2015-2021 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "screenshot_ring.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <new>
+
+#ifdef ANDROID
+#include <android/log.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace screenshot {
+
+// The name of the shared memory object of a ring. POSIX names start with a
+// slash, which is added if the name given has none.
+static std::string sharedMemoryName(const std::string &name) {
+#if defined(_WIN32) || defined(ANDROID)
+    return name;
+#else
+    return name.empty() || name[0] == '/' ? name : "/" + name;
+#endif
+}
+
+ScreenshotRing::~ScreenshotRing() {
+    if (!mapping) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(mapping);
+    CloseHandle(mappingHandle);
+#elif !defined(ANDROID)
+    munmap(mapping, mappingSize);
+    shm_unlink(sharedMemoryName(name).c_str());
+#endif
+}
+
+// Create the shared memory and its header, with slots for frames of up to
+// frameSize bytes of pixels.
+bool ScreenshotRing::create(size_t frameSize) {
+    size_t const slotSize = (SCREENSHOT_RING_SLOT_HEADER_SIZE + frameSize + 63) & ~size_t(63);
+    if (slotSize > UINT32_MAX) return false;
+    mappingSize = SCREENSHOT_RING_HEADER_SIZE + slotSize * slotCount;
+    std::string const objectName = sharedMemoryName(name);
+
+#if defined(ANDROID)
+    (void)objectName;
+    __android_log_print(ANDROID_LOG_DEBUG, "screenshot", "Shared memory is not supported on Android: %s", name.c_str());
+    return false;
+#elif defined(_WIN32)
+    mappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, static_cast<DWORD>(uint64_t(mappingSize) >> 32),
+                                       static_cast<DWORD>(mappingSize), objectName.c_str());
+    if (!mappingHandle) {
+        fprintf(stderr, "screenshot: Failed to create shared memory: %s\n", name.c_str());
+        return false;
+    }
+    mapping = static_cast<uint8_t *>(MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, mappingSize));
+    if (!mapping) {
+        CloseHandle(mappingHandle);
+        mappingHandle = nullptr;
+        fprintf(stderr, "screenshot: Failed to map shared memory: %s\n", name.c_str());
+        return false;
+    }
+#else
+    int fd = shm_open(objectName.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "screenshot: Failed to create shared memory: %s\n", objectName.c_str());
+        return false;
+    }
+    if (ftruncate(fd, mappingSize) != 0) {
+        close(fd);
+        fprintf(stderr, "screenshot: Failed to size shared memory: %s\n", objectName.c_str());
+        return false;
+    }
+    void *address = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        fprintf(stderr, "screenshot: Failed to map shared memory: %s\n", objectName.c_str());
+        return false;
+    }
+    mapping = static_cast<uint8_t *>(address);
+#endif
+
+    // The magic is written last, so that a reader finding it finds the rest.
+    auto header = new (mapping) ScreenshotRingHeader;
+    header->version = SCREENSHOT_RING_VERSION;
+    header->slotCount = slotCount;
+    header->slotSize = static_cast<uint32_t>(slotSize);
+    header->published.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slotCount; i++) {
+        auto slot = new (mapping + SCREENSHOT_RING_HEADER_SIZE + slotSize * i) ScreenshotRingSlot;
+        slot->sequence.store(0, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SCREENSHOT_RING_MAGIC;
+
+#ifndef ANDROID
+    printf("screenshot: Publishing captures to shared memory: %s\n", objectName.c_str());
+#endif
+    return true;
+}
+
+bool ScreenshotRing::publish(int frameNumber, uint64_t stream, uint32_t width, uint32_t height, uint32_t pixelFormat,
+                             const uint8_t *pixels, size_t frameSize) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (failed) return false;
+    if (!mapping && !create(frameSize)) {
+        failed = true;
+        return false;
+    }
+
+    auto header = reinterpret_cast<ScreenshotRingHeader *>(mapping);
+    if (SCREENSHOT_RING_SLOT_HEADER_SIZE + frameSize > header->slotSize) {
+        if (!warnedTooLarge) {
+#ifdef ANDROID
+            __android_log_print(ANDROID_LOG_DEBUG, "screenshot", "Frame %d is too large for the shared memory, dropped",
+                                frameNumber);
+#else
+            fprintf(stderr, "screenshot: Frame %d is too large for the shared memory, dropped\n", frameNumber);
+#endif
+            warnedTooLarge = true;
+        }
+        return false;
+    }
+
+    // Only this thread writes, with the mutex held, so published is read
+    // without ordering. The odd sequence tells the readers the slot changes.
+    uint64_t const index = header->published.load(std::memory_order_relaxed);
+    auto slot = reinterpret_cast<ScreenshotRingSlot *>(mapping + SCREENSHOT_RING_HEADER_SIZE +
+                                                       size_t(header->slotSize) * (index % header->slotCount));
+    slot->sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->frameNumber = frameNumber;
+    slot->width = width;
+    slot->height = height;
+    slot->pixelFormat = pixelFormat;
+    slot->stream = stream;
+    slot->timestamp = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    memcpy(reinterpret_cast<uint8_t *>(slot) + SCREENSHOT_RING_SLOT_HEADER_SIZE, pixels, frameSize);
+
+    slot->sequence.store(2 * index + 2, std::memory_order_release);
+    header->published.store(index + 1, std::memory_order_release);
+    return true;
+}
+
+}  // namespace screenshot
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2015-2021 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+namespace screenshot {
+
+// The layout of the shared memory ring the captured frames can be published
+// to, for other processes to read them without going through files.
+//
+// The ring starts with a ScreenshotRingHeader, followed by slotCount slots of
+// slotSize bytes, each a ScreenshotRingSlot followed by the pixels of the
+// frame. The slots are written in turn, and the layer never waits for the
+// readers, so a reader that is too slow misses frames.
+//
+// To read the latest frame, a reader loads published, and if it is not 0,
+// the slot (published - 1) % slotCount. It loads the sequence of the slot,
+// which is even once the frame is written, reads the frame, then loads the
+// sequence again. If it changed, the frame was overwritten while it was read
+// and must be dropped.
+
+static const uint32_t SCREENSHOT_RING_MAGIC = 0x47525353;  // "SSRG"
+static const uint32_t SCREENSHOT_RING_VERSION = 1;
+static const uint32_t SCREENSHOT_RING_HEADER_SIZE = 64;
+static const uint32_t SCREENSHOT_RING_SLOT_HEADER_SIZE = 64;
+
+// The pixels of the frames, as in ScreenshotImage for the file formats with
+// the same pixels: 8-bit RGB, 16-bit RGB (PPM16), 32-bit float RGB (PFM), or
+// the texels of the swapchain images (RAW).
+static const uint32_t SCREENSHOT_RING_PIXEL_FORMAT_RGB8 = 0;
+static const uint32_t SCREENSHOT_RING_PIXEL_FORMAT_RGB16 = 1;
+static const uint32_t SCREENSHOT_RING_PIXEL_FORMAT_RGB32F = 2;
+static const uint32_t SCREENSHOT_RING_PIXEL_FORMAT_RAW = 3;
+
+struct ScreenshotRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotSize;                // in bytes, the slot header included
+    std::atomic<uint64_t> published;  // the number of frames published so far
+};
+
+struct ScreenshotRingSlot {
+    std::atomic<uint64_t> sequence;  // 2 * n + 1 while the nth frame is written, 2 * n + 2 once it is
+    int32_t frameNumber;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pixelFormat;
+    uint64_t stream;     // identifies the swapchain and region of the frame
+    uint64_t timestamp;  // when the frame was published, in nanoseconds of the steady clock
+};
+
+static_assert(sizeof(ScreenshotRingHeader) <= SCREENSHOT_RING_HEADER_SIZE, "ring header too large");
+static_assert(sizeof(ScreenshotRingSlot) <= SCREENSHOT_RING_SLOT_HEADER_SIZE, "ring slot header too large");
+
+// The writing end of a ring, created with the first frame published, whose
+// slots are sized for it. Larger frames are dropped.
+class ScreenshotRing {
+   public:
+    ScreenshotRing(const std::string &name, uint32_t slotCount) : name(name), slotCount(slotCount) {}
+    ~ScreenshotRing();
+
+    // Publish a frame of size bytes of pixels. Returns false if it was
+    // dropped.
+    bool publish(int frameNumber, uint64_t stream, uint32_t width, uint32_t height, uint32_t pixelFormat, const uint8_t *pixels,
+                 size_t size);
+
+   private:
+    bool create(size_t frameSize);
+
+    const std::string name;
+    const uint32_t slotCount;
+    std::mutex mutex;
+    bool failed = false;
+    bool warnedTooLarge = false;
+    size_t mappingSize = 0;
+    uint8_t *mapping = nullptr;
+#ifdef _WIN32
+    void *mappingHandle = nullptr;
+#endif
+};
+
+}  // namespace screenshot
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2015-2021 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "screenshot_trigger.h"
+#include "monitor_spike.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#ifdef ANDROID
+#include <android/log.h>
+#endif
+#ifndef _WIN32
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace screenshot {
+
+// How often the trigger file is looked for, and the socket checked for the
+// thread being stopped, in milliseconds.
+static const int TRIGGER_POLL_MS = 250;
+
+// The longest line the socket is sent.
+static const size_t TRIGGER_LINE_SIZE = 64;
+
+#if defined(MSG_NOSIGNAL)
+// A client that goes away before it is answered must not raise SIGPIPE.
+static const int TRIGGER_SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int TRIGGER_SEND_FLAGS = 0;
+#endif
+
+static void logTrigger(const char *message, const char *detail) {
+#ifdef ANDROID
+    __android_log_print(ANDROID_LOG_INFO, "screenshot", "%s: %s", message, detail);
+#else
+    fprintf(stderr, "screenshot: %s: %s\n", message, detail);
+#endif
+}
+
+#ifndef _WIN32
+// The trigger SIGUSR2 requests frames of, and the action it had before.
+static ScreenshotTrigger *signalTrigger = nullptr;
+static struct sigaction previousSignalAction;
+
+static void onTriggerSignal(int) {
+    if (signalTrigger) signalTrigger->request(1);
+}
+#endif
+
+static void onSpike(void *trigger, uint64_t, float) { static_cast<ScreenshotTrigger *>(trigger)->request(1); }
+
+void ScreenshotTrigger::watchFile(const std::string &fileName) { this->fileName = fileName; }
+
+bool ScreenshotTrigger::listenOn(const std::string &socketPath) {
+#ifdef _WIN32
+    logTrigger("Trigger sockets are not supported on Windows", socketPath.c_str());
+    return false;
+#else
+    if (listening >= 0) return true;
+    sockaddr_un address = {};
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        logTrigger("Trigger socket path is too long", socketPath.c_str());
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    listening = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listening < 0) return false;
+    unlink(socketPath.c_str());
+    if (bind(listening, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || listen(listening, 1) != 0) {
+        logTrigger("Failed to listen on trigger socket", socketPath.c_str());
+        close(listening);
+        listening = -1;
+        return false;
+    }
+    this->socketPath = socketPath;
+    return true;
+#endif
+}
+
+bool ScreenshotTrigger::catchSignal() {
+#ifdef _WIN32
+    logTrigger("Trigger signals are not supported on Windows", "SIGUSR2");
+    return false;
+#else
+    if (signalTrigger) return false;
+    signalTrigger = this;
+    struct sigaction action = {};
+    action.sa_handler = onTriggerSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGUSR2, &action, &previousSignalAction) != 0) {
+        signalTrigger = nullptr;
+        return false;
+    }
+    catchingSignal = true;
+    return true;
+#endif
+}
+
+bool ScreenshotTrigger::subscribeToSpikes() {
+    if (subscribedToSpikes) return true;
+    auto subscribe = reinterpret_cast<monitor_subscribe_spikes_function>(find_monitor_spike_function(MONITOR_SUBSCRIBE_SPIKES));
+    if (!subscribe) {
+        logTrigger("The monitor layer is not loaded, its spikes are not captured", "VK_LAYER_LUNARG_monitor");
+        return false;
+    }
+    subscribedToSpikes = subscribe(onSpike, this);
+    return subscribedToSpikes;
+}
+
+void ScreenshotTrigger::unsubscribeFromSpikes() {
+    if (!subscribedToSpikes) return;
+    auto unsubscribe =
+        reinterpret_cast<monitor_unsubscribe_spikes_function>(find_monitor_spike_function(MONITOR_UNSUBSCRIBE_SPIKES));
+    if (unsubscribe) unsubscribe(onSpike, this);
+    subscribedToSpikes = false;
+}
+
+// The settings are read again for each instance, so the thread may already
+// be running.
+void ScreenshotTrigger::start() {
+    if (thread.joinable() || (fileName.empty() && listening < 0)) return;
+    thread = std::thread(&ScreenshotTrigger::run, this);
+}
+
+void ScreenshotTrigger::stop() {
+    stopping.store(true);
+    if (thread.joinable()) thread.join();
+    unsubscribeFromSpikes();
+#ifndef _WIN32
+    if (listening >= 0) {
+        close(listening);
+        listening = -1;
+        unlink(socketPath.c_str());
+    }
+    if (catchingSignal) {
+        sigaction(SIGUSR2, &previousSignalAction, nullptr);
+        signalTrigger = nullptr;
+        catchingSignal = false;
+    }
+#endif
+}
+
+// Called from the signal handler, so it only touches lock-free atomics.
+void ScreenshotTrigger::request(int frames) {
+    requestedFrames.fetch_add(frames);
+    wake.store(0);
+}
+
+bool ScreenshotTrigger::rewake() {
+    if (requestedFrames.load() == 0) return false;
+    wake.store(0);
+    return true;
+}
+
+void ScreenshotTrigger::run() {
+    while (!stopping.load()) {
+#ifndef _WIN32
+        if (listening >= 0) {
+            pollfd listener = {listening, POLLIN, 0};
+            if (poll(&listener, 1, TRIGGER_POLL_MS) > 0) {
+                int const connection = accept(listening, nullptr, nullptr);
+                if (connection >= 0) {
+                    serve(connection);
+                    close(connection);
+                }
+            }
+        } else
+#endif
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(TRIGGER_POLL_MS));
+        }
+        checkFile();
+    }
+}
+
+// Request the frames of the trigger file, and remove it.
+void ScreenshotTrigger::checkFile() {
+    if (fileName.empty()) return;
+    FILE *file = fopen(fileName.c_str(), "r");
+    if (!file) return;
+    int frames = 0;
+    if (fscanf(file, "%d", &frames) != 1 || frames < 1) frames = 1;
+    fclose(file);
+    if (remove(fileName.c_str()) != 0) {
+        logTrigger("Failed to remove trigger file, it is ignored", fileName.c_str());
+        fileName.clear();
+        return;
+    }
+    request(frames);
+}
+
+// Answer the lines of a connection to the socket until it is closed.
+void ScreenshotTrigger::serve(int connection) {
+#ifndef _WIN32
+    std::string line;
+    char buffer[TRIGGER_LINE_SIZE];
+    while (!stopping.load()) {
+        pollfd client = {connection, POLLIN, 0};
+        if (poll(&client, 1, TRIGGER_POLL_MS) <= 0) {
+            checkFile();
+            continue;
+        }
+        ssize_t const count = recv(connection, buffer, sizeof(buffer), 0);
+        if (count <= 0) return;
+        for (ssize_t i = 0; i < count; i++) {
+            if (buffer[i] != '\n') {
+                if (line.size() < TRIGGER_LINE_SIZE) line += buffer[i];
+                continue;
+            }
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            int frames = 1;
+            char *end = nullptr;
+            bool valid = line.compare(0, 7, "capture") == 0;
+            if (valid && line.size() > 7) {
+                frames = static_cast<int>(strtol(line.c_str() + 7, &end, 10));
+                valid = line[7] == ' ' && end != line.c_str() + 7 && *end == '\0' && frames > 0;
+            }
+            if (valid) request(frames);
+            const char *answer = valid ? "ok\n" : "error\n";
+            if (send(connection, answer, strlen(answer), TRIGGER_SEND_FLAGS) < 0) return;
+            line.clear();
+        }
+    }
+#else
+    (void)connection;
+#endif
+}
+
+}  // namespace screenshot
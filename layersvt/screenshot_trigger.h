@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2015-2021 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace screenshot {
+
+// Requests to capture the next frames while the application runs, instead of
+// the frames chosen when it starts. A request comes from one of:
+//
+// - a trigger file, which is looked for a few times a second, and removed
+//   once it is seen. It holds the number of frames to capture, or nothing for
+//   one frame.
+// - SIGUSR2, which requests one frame per signal. Not supported on Windows.
+// - a Unix domain socket, which is sent lines of "capture [frames]", and
+//   answers each with "ok" or "error". Not supported on Windows.
+// - the monitor layer, which requests one frame per spike it detects in the
+//   frame times, if it is loaded. See monitor_spike.h.
+//
+// A request adds to the frames requested, and stores 0 to the wake counter
+// given, which is the first frame number whose present looks at the frames
+// to capture, so that the presents in between see no more than the load of
+// that counter they already do.
+class ScreenshotTrigger {
+   public:
+    explicit ScreenshotTrigger(std::atomic<int> &wake) : wake(wake) {}
+    ~ScreenshotTrigger() { stop(); }
+
+    void watchFile(const std::string &fileName);
+    bool listenOn(const std::string &socketPath);
+    bool catchSignal();
+    bool subscribeToSpikes();
+
+    // Unsubscribes from the monitor layer, which must be done before the
+    // last instance is destroyed, since the layer may be unloaded then.
+    void unsubscribeFromSpikes();
+
+    // Starts the thread that watches the file and the socket, if there are
+    // any.
+    void start();
+    void stop();
+
+    bool enabled() const { return !fileName.empty() || listening >= 0 || catchingSignal || subscribedToSpikes; }
+
+    void request(int frames);
+
+    // The frames requested since the last call, 0 if none.
+    int takeRequestedFrames() { return requestedFrames.exchange(0); }
+
+    // Whether frames were requested since the last call to
+    // takeRequestedFrames, in which case the wake counter is reset again.
+    bool rewake();
+
+   private:
+    void run();
+    void checkFile();
+    void serve(int connection);
+
+    std::atomic<int> &wake;
+    std::atomic<int> requestedFrames{0};
+    std::atomic<bool> stopping{false};
+    std::string fileName;
+    std::string socketPath;
+    int listening = -1;
+    bool catchingSignal = false;
+    bool subscribedToSpikes = false;
+    std::thread thread;
+};
+
+}  // namespace screenshot
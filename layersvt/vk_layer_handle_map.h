@@ -0,0 +1,147 @@
+/* Copyright (c) 2015-2021 The Khronos Group Inc.
+ * Copyright (c) 2015-2021 Valve Corporation
+ * Copyright (c) 2015-2021 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A map from the handles of Vulkan objects to the state a layer keeps for them, such as their dispatch tables, looked up
+// on every intercepted call. Lookups take no lock: the slots are probed linearly from the hash of the handle, and with the
+// few objects of a kind an application usually has, a lookup is a single probe. Inserting and erasing are serialized, and
+// an erased slot keeps its handle so that the probe sequences of the other handles stay intact. When the slots fill up,
+// they are replaced by a larger copy, and the old slots are kept until the map is destroyed since lookups may still be
+// reading them.
+//
+// The map holds pointers to the state, which it does not own: erase returns the state for the caller to delete. A state
+// found may be used until its object is destroyed, which the application does not do while it uses the object.
+template <typename Key, typename Value>
+class HandleMap {
+   public:
+    HandleMap() { grow(16); }
+
+    Value *find(Key key) const {
+        const Slots &slots = *current_slots.load(std::memory_order_acquire);
+        for (size_t i = hash(key) & slots.mask, probes = 0; probes <= slots.mask; i = (i + 1) & slots.mask, ++probes) {
+            const Key slot_key = slots.slots[i].key.load(std::memory_order_acquire);
+            if (slot_key == key) return slots.slots[i].value.load(std::memory_order_acquire);
+            if (slot_key == Key{}) break;
+        }
+        return nullptr;
+    }
+
+    // Returns the value which is already in the map for the key, if there is one, and adds the new value otherwise.
+    Value *insert(Key key, Value *value) {
+        std::lock_guard<std::mutex> lg(write_mutex);
+        Value *existing = find(key);
+        if (existing != nullptr) return existing;
+        if ((used_slots + 1) * 2 > current_slots.load(std::memory_order_relaxed)->mask + 1) grow(live_values * 4 + 16);
+
+        Slots &slots = *current_slots.load(std::memory_order_relaxed);
+        Slot *target = nullptr;
+        for (size_t i = hash(key) & slots.mask;; i = (i + 1) & slots.mask) {
+            const Key slot_key = slots.slots[i].key.load(std::memory_order_relaxed);
+            if (slot_key == key || slot_key == Key{}) {
+                if (target == nullptr) target = &slots.slots[i];
+                break;
+            }
+            if (target == nullptr && slots.slots[i].value.load(std::memory_order_relaxed) == nullptr) target = &slots.slots[i];
+        }
+        if (target->key.load(std::memory_order_relaxed) == Key{}) ++used_slots;
+        // The key is published first, so that a lookup of the erased key which used the slot never sees the new value.
+        target->key.store(key, std::memory_order_release);
+        target->value.store(value, std::memory_order_release);
+        ++live_values;
+        return value;
+    }
+
+    // Returns the value of the key, which the caller then owns, or null if there is none.
+    Value *erase(Key key) {
+        std::lock_guard<std::mutex> lg(write_mutex);
+        Slots &slots = *current_slots.load(std::memory_order_relaxed);
+        for (size_t i = hash(key) & slots.mask, probes = 0; probes <= slots.mask; i = (i + 1) & slots.mask, ++probes) {
+            const Key slot_key = slots.slots[i].key.load(std::memory_order_relaxed);
+            if (slot_key == key) {
+                Value *value = slots.slots[i].value.exchange(nullptr, std::memory_order_acq_rel);
+                if (value != nullptr) --live_values;
+                return value;
+            }
+            if (slot_key == Key{}) break;
+        }
+        return nullptr;
+    }
+
+    // Calls function(key, value) for each value in the map, with the writes held off.
+    template <typename Function>
+    void for_each(Function function) {
+        std::lock_guard<std::mutex> lg(write_mutex);
+        const Slots &slots = *current_slots.load(std::memory_order_relaxed);
+        for (size_t i = 0; i <= slots.mask; ++i) {
+            Value *value = slots.slots[i].value.load(std::memory_order_relaxed);
+            if (value != nullptr) function(slots.slots[i].key.load(std::memory_order_relaxed), value);
+        }
+    }
+
+   private:
+    struct Slot {
+        std::atomic<Key> key{Key{}};
+        std::atomic<Value *> value{nullptr};
+    };
+
+    struct Slots {
+        size_t mask;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    static size_t hash(Key key) {
+        // The handles are often aligned pointers, so their low bits carry nothing.
+        const uint64_t value = ((uint64_t)(key) >> 4) * 0x9e3779b97f4a7c15ULL;
+        return static_cast<size_t>(value >> 32);
+    }
+
+    // Rebuilds the slots with room for at least the given number of them, dropping the keys of erased values.
+    void grow(size_t min_slots) {
+        size_t slot_count = 16;
+        while (slot_count < min_slots) slot_count *= 2;
+        std::unique_ptr<Slots> grown(new Slots{slot_count - 1, std::unique_ptr<Slot[]>(new Slot[slot_count])});
+        used_slots = 0;
+        const Slots *old_slots = current_slots.load(std::memory_order_relaxed);
+        if (old_slots != nullptr) {
+            for (size_t i = 0; i <= old_slots->mask; ++i) {
+                Value *value = old_slots->slots[i].value.load(std::memory_order_relaxed);
+                if (value == nullptr) continue;
+                const Key key = old_slots->slots[i].key.load(std::memory_order_relaxed);
+                size_t j = hash(key) & grown->mask;
+                while (grown->slots[j].key.load(std::memory_order_relaxed) != Key{}) j = (j + 1) & grown->mask;
+                grown->slots[j].key.store(key, std::memory_order_relaxed);
+                grown->slots[j].value.store(value, std::memory_order_relaxed);
+                ++used_slots;
+            }
+        }
+        current_slots.store(grown.get(), std::memory_order_release);
+        all_slots.push_back(std::move(grown));
+    }
+
+    std::atomic<Slots *> current_slots{nullptr};
+    std::vector<std::unique_ptr<Slots>> all_slots;
+    std::mutex write_mutex;
+    size_t used_slots = 0;
+    size_t live_values = 0;
+};
@@ -0,0 +1,109 @@
+/* Copyright (c) 2015-2021 The Khronos Group Inc.
+ * Copyright (c) 2015-2021 Valve Corporation
+ * Copyright (c) 2015-2021 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+
+// The host memory held by one subsystem of a layer, such as the map of the objects it names, so that the layer can report
+// what it costs the application, live and at its peak. The containers of the subsystem allocate through a LayerAllocator of
+// the account, which counts the bytes of their allocations, not the overhead of the heap they come from.
+//
+// The accounts are objects of static storage duration, which register themselves when the layer is loaded, and for_each
+// lists them in the order they were constructed in. Each layer library has its own accounts.
+class LayerMemoryAccount {
+   public:
+    explicit LayerMemoryAccount(const char *name) : account_name(name) {
+        const size_t index = registered().fetch_add(1, std::memory_order_relaxed);
+        if (index < max_accounts) accounts()[index] = this;
+    }
+    LayerMemoryAccount(const LayerMemoryAccount &) = delete;
+    LayerMemoryAccount &operator=(const LayerMemoryAccount &) = delete;
+
+    void allocated(size_t bytes) {
+        const uint64_t live = live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        uint64_t peak = peak_bytes.load(std::memory_order_relaxed);
+        while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+    void freed(size_t bytes) { live_bytes.fetch_sub(bytes, std::memory_order_relaxed); }
+
+    const char *name() const { return account_name; }
+    uint64_t live() const { return live_bytes.load(std::memory_order_relaxed); }
+    uint64_t peak() const { return peak_bytes.load(std::memory_order_relaxed); }
+
+    // Calls function(account) for each account of the layer.
+    template <typename Function>
+    static void for_each(Function function) {
+        const size_t count = registered().load(std::memory_order_relaxed);
+        for (size_t i = 0; i < count && i < max_accounts; ++i) function(*accounts()[i]);
+    }
+
+   private:
+    static const size_t max_accounts = 32;
+
+    static std::atomic<size_t> &registered() {
+        static std::atomic<size_t> count{0};
+        return count;
+    }
+    static LayerMemoryAccount **accounts() {
+        static LayerMemoryAccount *list[max_accounts];
+        return list;
+    }
+
+    const char *account_name;
+    std::atomic<uint64_t> live_bytes{0};
+    std::atomic<uint64_t> peak_bytes{0};
+};
+
+// A standard allocator which counts its allocations in an account, for the containers of a layer. It holds no state, so
+// the containers which use it stay as large, and as cheap to move and swap, as with the default allocator.
+template <typename T, LayerMemoryAccount &account>
+class LayerAllocator {
+   public:
+    using value_type = T;
+    template <typename U>
+    struct rebind {
+        using other = LayerAllocator<U, account>;
+    };
+
+    LayerAllocator() = default;
+    template <typename U>
+    LayerAllocator(const LayerAllocator<U, account> &) {}
+
+    T *allocate(size_t count) {
+        T *allocation = std::allocator<T>().allocate(count);
+        account.allocated(count * sizeof(T));
+        return allocation;
+    }
+    void deallocate(T *allocation, size_t count) {
+        account.freed(count * sizeof(T));
+        std::allocator<T>().deallocate(allocation, count);
+    }
+
+    template <typename U>
+    bool operator==(const LayerAllocator<U, account> &) const {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const LayerAllocator<U, account> &) const {
+        return false;
+    }
+};
@@ -21,23 +21,22 @@
 #include <unordered_map>
 #include "vulkan/vk_layer.h"
 #include "vk_layer_table.h"
+#include "vk_layer_handle_map.h"
 
-static device_table_map tableMap;
-static instance_table_map tableInstanceMap;
+// The dispatch tables of the layer, by dispatch key.
+static HandleMap<dispatch_key, VulDeviceDispatchTable> tableMap;
+static HandleMap<dispatch_key, VulInstanceDispatchTable> tableInstanceMap;
 
-// Map lookup must be thread safe
 VulDeviceDispatchTable *device_dispatch_table(void *object) {
-    dispatch_key key = get_dispatch_key(object);
-    device_table_map::const_iterator it = tableMap.find((void *)key);
-    assert(it != tableMap.end() && "Not able to find device dispatch entry");
-    return it->second;
+    VulDeviceDispatchTable *table = tableMap.find(get_dispatch_key(object));
+    assert(table != nullptr && "Not able to find device dispatch entry");
+    return table;
 }
 
 VulInstanceDispatchTable *instance_dispatch_table(void *object) {
-    dispatch_key key = get_dispatch_key(object);
-    instance_table_map::const_iterator it = tableInstanceMap.find((void *)key);
-    assert(it != tableInstanceMap.end() && "Not able to find instance dispatch entry");
-    return it->second;
+    VulInstanceDispatchTable *table = tableInstanceMap.find(get_dispatch_key(object));
+    assert(table != nullptr && "Not able to find instance dispatch entry");
+    return table;
 }
 
 void destroy_dispatch_table(device_table_map &map, dispatch_key key) {
@@ -56,9 +55,9 @@ void destroy_dispatch_table(instance_table_map &map, dispatch_key key) {
     }
 }
 
-void destroy_device_dispatch_table(dispatch_key key) { destroy_dispatch_table(tableMap, key); }
+void destroy_device_dispatch_table(dispatch_key key) { delete tableMap.erase(key); }
 
-void destroy_instance_dispatch_table(dispatch_key key) { destroy_dispatch_table(tableInstanceMap, key); }
+void destroy_instance_dispatch_table(dispatch_key key) { delete tableInstanceMap.erase(key); }
 
 VulDeviceDispatchTable *get_dispatch_table(device_table_map &map, void *object) {
     dispatch_key key = get_dispatch_key(object);
@@ -121,7 +120,18 @@ VulInstanceDispatchTable *initInstanceTable(VkInstance instance, const PFN_vkGet
 }
 
 VulInstanceDispatchTable *initInstanceTable(VkInstance instance, const PFN_vkGetInstanceProcAddr gpa) {
-    return initInstanceTable(instance, gpa, tableInstanceMap);
+    dispatch_key key = get_dispatch_key(instance);
+    VulInstanceDispatchTable *pTable = tableInstanceMap.find(key);
+    if (pTable != nullptr) return pTable;
+
+    pTable = new VulInstanceDispatchTable;
+    vulInitInstanceDispatchTable(instance, pTable, gpa);
+    pTable->GetPhysicalDeviceProcAddr = (PFN_GetPhysicalDeviceProcAddr)gpa(instance, "vk_layerGetPhysicalDeviceProcAddr");
+
+    // The table is only published once it is complete, so that a lookup never sees it half filled in.
+    VulInstanceDispatchTable *inserted = tableInstanceMap.insert(key, pTable);
+    if (inserted != pTable) delete pTable;
+    return inserted;
 }
 
 VulDeviceDispatchTable *initDeviceTable(VkDevice device, const PFN_vkGetDeviceProcAddr gpa, device_table_map &map) {
@@ -142,5 +152,14 @@ VulDeviceDispatchTable *initDeviceTable(VkDevice device, const PFN_vkGetDevicePr
 }
 
 VulDeviceDispatchTable *initDeviceTable(VkDevice device, const PFN_vkGetDeviceProcAddr gpa) {
-    return initDeviceTable(device, gpa, tableMap);
+    dispatch_key key = get_dispatch_key(device);
+    VulDeviceDispatchTable *pTable = tableMap.find(key);
+    if (pTable != nullptr) return pTable;
+
+    pTable = new VulDeviceDispatchTable;
+    vulInitDeviceDispatchTable(device, pTable, gpa);
+
+    VulDeviceDispatchTable *inserted = tableMap.insert(key, pTable);
+    if (inserted != pTable) delete pTable;
+    return inserted;
 }
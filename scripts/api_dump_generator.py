@@ -39,8 +39,12 @@
 #   * api_dump_html.h: HTML_CODEGEN - Provides the back end for dumping to a html document
 #   * api_dump_json.h: JSON_CODEGEN - Provides the back end for dumping to a JSON file
 #
+# The back ends can be split into several translation units with the shardCount option. The header
+# then only declares the functions of the back end, and their definitions are spread over the files
+# api_dump_text_0.cpp, api_dump_text_1.cpp, ... so that they can be compiled in parallel.
+#
 
-import os,re,sys,string
+import copy,functools,hashlib,os,re,sys,string,zlib
 import xml.etree.ElementTree as etree
 import generator as gen
 from generator import *
@@ -52,6 +56,45 @@ BLOCKING_API_CALLS = [
     'vkQueueWaitIdle', 'vkAcquireNextImageKHR', 'vkGetQueryPoolResults',
 ]
 
+# The functions which keep track of state for the layer itself, so they take the full path even while the layer is
+# disarmed. The others call straight down the chain then.
+STATEFUL_API_CALLS = [
+    'vkEnumeratePhysicalDevices', 'vkDestroyInstance', 'vkDestroyDevice', 'vkGetPhysicalDeviceToolPropertiesEXT',
+    'vkQueuePresentKHR', 'vkDebugMarkerSetObjectNameEXT', 'vkSetDebugUtilsObjectNameEXT', 'vkAllocateCommandBuffers',
+    'vkDestroyCommandPool', 'vkFreeCommandBuffers', 'vkBeginCommandBuffer', 'vkCmdBeginDebugUtilsLabelEXT',
+    'vkCmdEndDebugUtilsLabelEXT', 'vkQueueBeginDebugUtilsLabelEXT', 'vkQueueEndDebugUtilsLabelEXT',
+]
+
+# The functions which may end a frame, with the value of the frame_delimiter setting which makes them do so. The ones which
+# aren't stateful are only intercepted while disarmed or filtered out if they are the configured delimiter.
+FRAME_DELIMITER_API_CALLS = {
+    'vkQueuePresentKHR': 'Present', 'vkQueueSubmit': 'Submit', 'vkQueueSubmit2': 'Submit', 'vkQueueSubmit2KHR': 'Submit',
+    'vkQueueBeginDebugUtilsLabelEXT': 'Label', 'vkQueueInsertDebugUtilsLabelEXT': 'Label', 'vkDeviceWaitIdle': 'WaitIdle',
+    'vkWaitForFences': 'FenceWait',
+}
+
+# The functions whose pipelines the pipeline_stats setting times, the create infos passed down the chain may have a
+# VkPipelineCreationFeedbackCreateInfo chained by the layer.
+PIPELINE_CREATION_CALLS = ['vkCreateGraphicsPipelines', 'vkCreateComputePipelines', 'vkCreateRayTracingPipelinesKHR']
+
+# The queries which tend to be made over and over with the same result, which the memoize_queries setting only writes in full
+# the first time.
+MEMOIZED_API_CALLS = [
+    'vkGetPhysicalDeviceProperties', 'vkGetPhysicalDeviceProperties2', 'vkGetPhysicalDeviceProperties2KHR',
+    'vkGetPhysicalDeviceFeatures', 'vkGetPhysicalDeviceFeatures2', 'vkGetPhysicalDeviceFeatures2KHR',
+    'vkGetPhysicalDeviceMemoryProperties', 'vkGetPhysicalDeviceMemoryProperties2', 'vkGetPhysicalDeviceMemoryProperties2KHR',
+    'vkGetPhysicalDeviceFormatProperties', 'vkGetPhysicalDeviceFormatProperties2', 'vkGetPhysicalDeviceFormatProperties2KHR',
+    'vkGetPhysicalDeviceImageFormatProperties', 'vkGetPhysicalDeviceImageFormatProperties2',
+    'vkGetPhysicalDeviceImageFormatProperties2KHR', 'vkGetPhysicalDeviceQueueFamilyProperties',
+    'vkGetPhysicalDeviceQueueFamilyProperties2', 'vkGetPhysicalDeviceQueueFamilyProperties2KHR',
+    'vkGetPhysicalDeviceSurfaceCapabilitiesKHR', 'vkGetPhysicalDeviceSurfaceCapabilities2KHR',
+    'vkGetPhysicalDeviceSurfaceFormatsKHR', 'vkGetPhysicalDeviceSurfacePresentModesKHR',
+    'vkGetBufferMemoryRequirements', 'vkGetBufferMemoryRequirements2', 'vkGetBufferMemoryRequirements2KHR',
+    'vkGetImageMemoryRequirements', 'vkGetImageMemoryRequirements2', 'vkGetImageMemoryRequirements2KHR',
+    'vkGetDeviceBufferMemoryRequirements', 'vkGetDeviceBufferMemoryRequirementsKHR', 'vkGetDeviceImageMemoryRequirements',
+    'vkGetDeviceImageMemoryRequirementsKHR', 'vkGetDescriptorSetLayoutSupport', 'vkGetDescriptorSetLayoutSupportKHR',
+]
+
 COMMON_CODEGEN = """
 /* Copyright (c) 2015-2016, 2021 Valve Corporation
  * Copyright (c) 2015-2016, 2021 LunarG, Inc.
@@ -81,6 +124,9 @@ COMMON_CODEGEN = """
 #include "api_dump_text.h"
 #include "api_dump_html.h"
 #include "api_dump_json.h"
+#include "api_dump_binary.h"
+#include "api_dump_binary_reader.h"
+#include "api_dump_trace.h"
 
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
 
@@ -94,10 +140,103 @@ COMMON_CODEGEN = """
 #define EXPORT_FUNCTION
 #endif
 
+// The functions the function filter is matched against
+static const ApiDumpFunctionName api_dump_function_names[] = {{
+@foreach function
+    {{ {funcIndex}, "{funcName}" }},
+@end function
+}};
+
+@foreach function where('{funcName}' in ['vkCreateInstance', 'vkCreateDevice'])
+static const uint32_t api_dump_index_{funcName} = {funcIndex};
+@end function
+
+// The handle types the object statistics are counted by
+static const ApiDumpObjectTypeName api_dump_object_type_names[] = {{
+@foreach handle
+    {{ {hdlIndex}, "{hdlName}" }},
+@end handle
+}};
+
+// The functions which dump every intercepted function in one output format. vkCreateInstance installs the table of the
+// output format, so that dumping a call is a single indirect call instead of a switch over the output formats.
+struct ApiDumpFormatFunctions {{
+@foreach function where('{funcName}' not in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+    decltype(&dump_text_{funcName}) {funcName};
+@end function
+}};
+
+// The stats format only records how long the calls take, so it has nothing to dump
+template <typename... Args>
+static void dump_stats_function(ApiDumpInstance& dump_inst, Args... args) {{}}
+
+static const ApiDumpFormatFunctions api_dump_text_functions = {{
+@foreach function where('{funcName}' not in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+    dump_text_{funcName},
+@end function
+}};
+
+static const ApiDumpFormatFunctions api_dump_html_functions = {{
+@foreach function where('{funcName}' not in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+    dump_html_{funcName},
+@end function
+}};
+
+static const ApiDumpFormatFunctions api_dump_json_functions = {{
+@foreach function where('{funcName}' not in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+    dump_json_{funcName},
+@end function
+}};
+
+static const ApiDumpFormatFunctions api_dump_binary_functions = {{
+@foreach function where('{funcName}' not in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+    dump_binary_{funcName},
+@end function
+}};
+
+static const ApiDumpFormatFunctions api_dump_trace_functions = {{
+@foreach function where('{funcName}' not in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+    dump_trace_{funcName},
+@end function
+}};
+
+static const ApiDumpFormatFunctions api_dump_stats_functions = {{
+@foreach function where('{funcName}' not in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+    dump_stats_function,
+@end function
+}};
+
+static const ApiDumpFormatFunctions* api_dump_format_functions(ApiDumpFormat format)
+{{
+    switch(format)
+    {{
+        case ApiDumpFormat::Text:
+            return &api_dump_text_functions;
+        case ApiDumpFormat::Html:
+            return &api_dump_html_functions;
+        case ApiDumpFormat::Json:
+            return &api_dump_json_functions;
+        case ApiDumpFormat::Binary:
+            return &api_dump_binary_functions;
+        case ApiDumpFormat::Trace:
+            return &api_dump_trace_functions;
+        case ApiDumpFormat::Stats:
+            break;
+    }}
+    return &api_dump_stats_functions;
+}}
+
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkInstance* pInstance)
 {{
-    ApiDumpInstance::current().outputMutex()->lock();
-    dump_function_head(ApiDumpInstance::current(), "vkCreateInstance", "pCreateInfo, pAllocator, pInstance", "VkResult");
+    ApiDumpInstance::current().registerFunctions(api_dump_function_names, ARRAY_SIZE(api_dump_function_names));
+    ApiDumpInstance::current().registerObjectTypes(api_dump_object_type_names, ARRAY_SIZE(api_dump_object_type_names));
+    if (ApiDumpInstance::current().settings().deferredFormatting()) ApiDumpInstance::current().setCallFormatter(format_binary_record);
+    ApiDumpInstance::current().setFormatFunctions(api_dump_format_functions(ApiDumpInstance::current().captureFormat()));
+    const bool dump_function = ApiDumpInstance::current().shouldDumpFunction(api_dump_index_vkCreateInstance);
+    if (dump_function) {{
+        ApiDumpInstance::current().beginOutput();
+        dump_function_head(ApiDumpInstance::current(), "vkCreateInstance", "pCreateInfo, pAllocator, pInstance", "VkResult");
+    }}
 
     // Get the function pointer
     VkLayerInstanceCreateInfo* chain_info = get_chain_info(pCreateInfo, VK_LAYER_LINK_INFO);
@@ -106,38 +245,35 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo* pCre
     assert(fpGetInstanceProcAddr != 0);
     PFN_vkCreateInstance fpCreateInstance = (PFN_vkCreateInstance) fpGetInstanceProcAddr(NULL, "vkCreateInstance");
     if(fpCreateInstance == NULL) {{
+        if (dump_function) ApiDumpInstance::current().endOutput();
         return VK_ERROR_INITIALIZATION_FAILED;
     }}
 
     // Call the function and create the dispatch table
     chain_info->u.pLayerInfo = chain_info->u.pLayerInfo->pNext;
+    const uint64_t call_start = dump_function ? ApiDumpInstance::current().callStartTime() : 0;
     VkResult result = fpCreateInstance(pCreateInfo, pAllocator, pInstance);
+    if (dump_function) ApiDumpInstance::current().recordCallTime(api_dump_index_vkCreateInstance, call_start);
     if(result == VK_SUCCESS) {{
         initInstanceTable(*pInstance, fpGetInstanceProcAddr);
+        ApiDumpInstance::current().setApplicationApiVersion(pCreateInfo);
+        ApiDumpInstance::current().instanceCreated();
     }}
     // Output the API dump
-    if (ApiDumpInstance::current().shouldDumpOutput()) {{
-        switch(ApiDumpInstance::current().settings().format())
-        {{
-            case ApiDumpFormat::Text:
-                dump_text_vkCreateInstance(ApiDumpInstance::current(), result, pCreateInfo, pAllocator, pInstance);
-                break;
-            case ApiDumpFormat::Html:
-                dump_html_vkCreateInstance(ApiDumpInstance::current(), result, pCreateInfo, pAllocator, pInstance);
-                break;
-            case ApiDumpFormat::Json:
-                dump_json_vkCreateInstance(ApiDumpInstance::current(), result, pCreateInfo, pAllocator, pInstance);
-                break;
-        }}
+    if (dump_function) {{
+        ApiDumpInstance::current().formatFunctions()->vkCreateInstance(ApiDumpInstance::current(), result, pCreateInfo, pAllocator, pInstance);
+        ApiDumpInstance::current().endOutput();
     }}
-    ApiDumpInstance::current().outputMutex()->unlock();
     return result;
 }}
 
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDevice* pDevice)
 {{
-    ApiDumpInstance::current().outputMutex()->lock();
-    dump_function_head(ApiDumpInstance::current(), "vkCreateDevice", "physicalDevice, pCreateInfo, pAllocator, pDevice", "VkResult");
+    const bool dump_function = ApiDumpInstance::current().shouldDumpFunction(api_dump_index_vkCreateDevice);
+    if (dump_function) {{
+        ApiDumpInstance::current().beginOutput();
+        dump_function_head(ApiDumpInstance::current(), "vkCreateDevice", "physicalDevice, pCreateInfo, pAllocator, pDevice", "VkResult");
+    }}
 
     // Get the function pointer
     VkLayerDeviceCreateInfo* chain_info = get_chain_info(pCreateInfo, VK_LAYER_LINK_INFO);
@@ -147,32 +283,34 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice physicalDevice, c
     VkInstance vk_instance = ApiDumpInstance::current().get_vk_instance(physicalDevice);
     PFN_vkCreateDevice fpCreateDevice = (PFN_vkCreateDevice) fpGetInstanceProcAddr(vk_instance, "vkCreateDevice");
     if(fpCreateDevice == NULL) {{
+        if (dump_function) ApiDumpInstance::current().endOutput();
         return VK_ERROR_INITIALIZATION_FAILED;
     }}
 
     // Call the function and create the dispatch table
     chain_info->u.pLayerInfo = chain_info->u.pLayerInfo->pNext;
+    const uint64_t call_start = dump_function ? ApiDumpInstance::current().callStartTime() : 0;
     VkResult result = fpCreateDevice(physicalDevice, pCreateInfo, pAllocator, pDevice);
+    if (dump_function) ApiDumpInstance::current().recordCallTime(api_dump_index_vkCreateDevice, call_start);
     if(result == VK_SUCCESS) {{
         initDeviceTable(*pDevice, fpGetDeviceProcAddr);
+        if (ApiDumpInstance::current().settings().memoryStats()) {{
+            VkPhysicalDeviceMemoryProperties memory_properties = {{}};
+            instance_dispatch_table(physicalDevice)->GetPhysicalDeviceMemoryProperties(physicalDevice, &memory_properties);
+            ApiDumpInstance::current().addMemoryDevice(*pDevice, memory_properties);
+        }}
+        if (ApiDumpInstance::current().settings().pipelineStats()) {{
+            VkPhysicalDeviceProperties properties = {{}};
+            instance_dispatch_table(physicalDevice)->GetPhysicalDeviceProperties(physicalDevice, &properties);
+            ApiDumpInstance::current().addPipelineDevice(*pDevice, pCreateInfo, properties.apiVersion);
+        }}
     }}
 
     // Output the API dump
-    if (ApiDumpInstance::current().shouldDumpOutput()) {{
-        switch(ApiDumpInstance::current().settings().format())
-        {{
-            case ApiDumpFormat::Text:
-                dump_text_vkCreateDevice(ApiDumpInstance::current(), result, physicalDevice, pCreateInfo, pAllocator, pDevice);
-                break;
-            case ApiDumpFormat::Html:
-                dump_html_vkCreateDevice(ApiDumpInstance::current(), result, physicalDevice, pCreateInfo, pAllocator, pDevice);
-                break;
-            case ApiDumpFormat::Json:
-                dump_json_vkCreateDevice(ApiDumpInstance::current(), result, physicalDevice, pCreateInfo, pAllocator, pDevice);
-                break;
-        }}
+    if (dump_function) {{
+        ApiDumpInstance::current().formatFunctions()->vkCreateDevice(ApiDumpInstance::current(), result, physicalDevice, pCreateInfo, pAllocator, pDevice);
+        ApiDumpInstance::current().endOutput();
     }}
-    ApiDumpInstance::current().outputMutex()->unlock();
     return result;
 }}
 
@@ -209,14 +347,28 @@ EXPORT_FUNCTION VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceLayerProperties(
     return util_GetLayerProperties(ARRAY_SIZE(layerProperties), layerProperties, pPropertyCount, pProperties);
 }}
 
+// Arms or disarms dumping from the next frame on, for tools which run with the layer disarmed until they get to what
+// they want dumped.
+extern "C" EXPORT_FUNCTION VKAPI_ATTR void VKAPI_CALL ApiDumpSetArmed(VkBool32 armed)
+{{
+    ApiDumpInstance::current().requestArmed(armed == VK_TRUE);
+}}
+
 // Autogen instance functions
 
 @foreach function where('{funcDispatchType}' == 'instance' and '{funcName}' not in ['vkCreateInstance', 'vkCreateDevice', 'vkGetInstanceProcAddr', 'vkEnumerateDeviceExtensionProperties', 'vkEnumerateDeviceLayerProperties'])
 VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
 {{
+    @if('{funcName}' not in STATEFUL_API_CALLS)
+    if (!ApiDumpInstance::armed()) return instance_dispatch_table({funcDispatchParam})->{funcShortName}({funcNamedParams});
+    @end if
+    ApiDumpOverheadScope overhead_scope(ApiDumpInstance::current().overheadTimes());
+    bool dump_function = ApiDumpInstance::current().shouldDumpFunction({funcIndex});
     @if('{funcName}' not in BLOCKING_API_CALLS)
-    ApiDumpInstance::current().outputMutex()->lock();
-    dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
+    if (dump_function) {{
+        ApiDumpInstance::current().beginOutput();
+        dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
+    }}
     @end if
 
     @if('{funcName}' == 'vkGetPhysicalDeviceToolPropertiesEXT')
@@ -237,17 +389,45 @@ VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
     }}
     @end if
 
+    const uint64_t call_start = dump_function ? ApiDumpInstance::current().callStartTime() : 0;
+    overhead_scope.beginDownCall();
     @if('{funcReturn}' != 'void')
     {funcReturn} result = instance_dispatch_table({funcDispatchParam})->{funcShortName}({funcNamedParams});
     @end if
     @if('{funcReturn}' == 'void')
     instance_dispatch_table({funcDispatchParam})->{funcShortName}({funcNamedParams});
     @end if
+    overhead_scope.endDownCall();
+    if (dump_function && ApiDumpInstance::current().settings().callFilter().enabled()) {{
+        ApiDumpFilteredCall filtered_call = ApiDumpInstance::current().filteredCall();
+        @foreach parameter
+        @if('{prmIsHandle}' == 'true' and {prmPtrLevel} == 0)
+        filtered_call.addHandle({prmName});
+        @end if
+        @if('{prmIsHandle}' == 'true' and {prmPtrLevel} == 1 and '{prmLength}' == 'None')
+        if ({prmName} != nullptr) filtered_call.addHandle(*{prmName});
+        @end if
+        @if('{prmIsHandle}' == 'true' and {prmPtrLevel} == 1 and '{prmLength}' != 'None')
+        filtered_call.addHandles({prmName}, {prmLength});
+        @end if
+        @end parameter
+        @if('{funcReturn}' == 'VkResult')
+        filtered_call.setResult(result);
+        @end if
+        if (!filtered_call.matches()) {{
+            ApiDumpInstance::current().cancelOutput();
+            dump_function = false;
+        }}
+    }}
+    if (dump_function) ApiDumpInstance::current().recordCallTime({funcIndex}, call_start);
     @if('{funcName}' in BLOCKING_API_CALLS)
-    ApiDumpInstance::current().outputMutex()->lock();
-    dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
+    if (dump_function) {{
+        ApiDumpInstance::current().beginOutput();
+        dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
+    }}
     @end if
     {funcStateTrackingCode}
+    {funcObjectTrackingCode}
     @if('{funcName}' == 'vkEnumeratePhysicalDevices')
     if (pPhysicalDeviceCount != nullptr && pPhysicalDevices != nullptr) {{
         for (uint32_t i = 0; i < *pPhysicalDeviceCount; i++) {{
@@ -257,6 +437,7 @@ VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
     @end if
     @if('{funcName}' == 'vkDestroyInstance')
     destroy_instance_dispatch_table(get_dispatch_key(instance));
+    ApiDumpInstance::current().instanceDestroyed();
     @end if
 
     @if('{funcName}' == 'vkGetPhysicalDeviceToolPropertiesEXT')
@@ -267,34 +448,21 @@ VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
     (*pToolCount)++;
     @end if
 
-    if (ApiDumpInstance::current().shouldDumpOutput()) {{
-        switch(ApiDumpInstance::current().settings().format())
-        {{
-            @if('{funcReturn}' != 'void')
-            case ApiDumpFormat::Text:
-                dump_text_{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
-                break;
-            case ApiDumpFormat::Html:
-                dump_html_{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
-                break;
-            case ApiDumpFormat::Json:
-                dump_json_{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
-                break;
-            @end if
-            @if('{funcReturn}' == 'void')
-            case ApiDumpFormat::Text:
-                dump_text_{funcName}(ApiDumpInstance::current(), {funcNamedParams});
-                break;
-            case ApiDumpFormat::Html:
-                dump_html_{funcName}(ApiDumpInstance::current(), {funcNamedParams});
-                break;
-            case ApiDumpFormat::Json:
-                dump_json_{funcName}(ApiDumpInstance::current(), {funcNamedParams});
-                break;
-            @end if
-        }}
+    if (dump_function) {{
+        @if('{funcReturn}' != 'void')
+        ApiDumpInstance::current().formatFunctions()->{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
+        @end if
+        @if('{funcReturn}' == 'void')
+        ApiDumpInstance::current().formatFunctions()->{funcName}(ApiDumpInstance::current(), {funcNamedParams});
+        @end if
+        @if('{funcName}' in MEMOIZED_API_CALLS)
+        ApiDumpInstance::current().markQueryOutput();
+        @end if
+        ApiDumpInstance::current().endOutput();
     }}
-    ApiDumpInstance::current().outputMutex()->unlock();
+    @if('{funcReturn}' == 'VkResult')
+    if (result == VK_ERROR_DEVICE_LOST) ApiDumpInstance::current().writeFlightRecorder(false);
+    @end if
     @if('{funcReturn}' != 'void')
     return result;
     @end if
@@ -306,59 +474,134 @@ VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
 @foreach function where('{funcDispatchType}' == 'device' and '{funcName}' not in ['vkGetDeviceProcAddr'])
 VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
 {{
-    @if('{funcName}' not in BLOCKING_API_CALLS)
-    ApiDumpInstance::current().outputMutex()->lock();
+    @if('{funcName}' not in STATEFUL_API_CALLS and '{funcName}' not in FRAME_DELIMITER_API_CALLS)
+    if (!ApiDumpInstance::armed()) return device_dispatch_table({funcDispatchParam})->{funcShortName}({funcNamedParams});
+    @end if
+    @if('{funcName}' not in STATEFUL_API_CALLS and '{funcName}' in FRAME_DELIMITER_API_CALLS)
+    if (!ApiDumpInstance::armed() && ApiDumpInstance::current().settings().frameDelimiter() != ApiDumpFrameDelimiter::{funcFrameDelimiter})
+        return device_dispatch_table({funcDispatchParam})->{funcShortName}({funcNamedParams});
+    @end if
+    ApiDumpOverheadScope overhead_scope(ApiDumpInstance::current().overheadTimes());
+    @if('{funcFrameDelimiter}' == 'Label')
+    ApiDumpInstance::current().delimitFrame(pLabelInfo);
+    @end if
+    @if('{funcName}' in ['vkCmdBeginDebugUtilsLabelEXT', 'vkQueueBeginDebugUtilsLabelEXT'])
+    ApiDumpInstance::current().beginLabelScope({funcDispatchParam}, pLabelInfo);
+    @end if
+    @if('{funcName}'.startswith('vkCmd'))
+    bool dump_function = ApiDumpInstance::current().shouldDumpCommand({funcIndex}, {funcDispatchParam});
+    @end if
+    @if('{funcName}'.startswith('vkQueue'))
+    bool dump_function = ApiDumpInstance::current().shouldDumpQueueCall({funcIndex}, {funcDispatchParam});
+    @end if
+    @if(not '{funcName}'.startswith('vkCmd') and not '{funcName}'.startswith('vkQueue'))
+    bool dump_function = ApiDumpInstance::current().shouldDumpFunction({funcIndex});
+    @end if
     @if('{funcName}' in ['vkDebugMarkerSetObjectNameEXT', 'vkSetDebugUtilsObjectNameEXT'])
     ApiDumpInstance::current().update_object_name_map(pNameInfo);
     @end if
-    dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
+    @if('{funcName}' not in BLOCKING_API_CALLS and '{funcName}'.startswith('vkCmd'))
+    if (dump_function) {{
+        ApiDumpInstance::current().beginCommandOutput(get_dispatch_key({funcDispatchParam}), {funcDispatchParam});
+        dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
+    }}
+    @end if
+    @if('{funcName}' not in BLOCKING_API_CALLS and not '{funcName}'.startswith('vkCmd'))
+    if (dump_function) {{
+        ApiDumpInstance::current().beginOutput(get_dispatch_key({funcDispatchParam}));
+        dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
+    }}
     @end if
 
+    @if('{funcName}' == 'vkCreateGraphicsPipelines')
+    auto pipeline_creation = ApiDumpInstance::current().beginPipelineCreation(device, "graphics", pipelineCache, createInfoCount, pCreateInfos);
+    @end if
+    @if('{funcName}' == 'vkCreateComputePipelines')
+    auto pipeline_creation = ApiDumpInstance::current().beginPipelineCreation(device, "compute", pipelineCache, createInfoCount, pCreateInfos);
+    @end if
+    @if('{funcName}' == 'vkCreateRayTracingPipelinesKHR')
+    // The pipelines of a deferred operation are only created once it is joined, so they aren't timed.
+    auto pipeline_creation = ApiDumpInstance::current().beginPipelineCreation(device, "ray tracing", pipelineCache, deferredOperation == VK_NULL_HANDLE ? createInfoCount : 0, pCreateInfos);
+    @end if
+    @if('{funcName}' in PIPELINE_CREATION_CALLS)
+    const auto app_create_infos = pCreateInfos;
+    pCreateInfos = pipeline_creation.createInfos();
+    @end if
+    const uint64_t call_start = dump_function ? ApiDumpInstance::current().callStartTime() : 0;
+    overhead_scope.beginDownCall();
     @if('{funcReturn}' != 'void')
     {funcReturn} result = device_dispatch_table({funcDispatchParam})->{funcShortName}({funcNamedParams});
     @end if
     @if('{funcReturn}' == 'void')
     device_dispatch_table({funcDispatchParam})->{funcShortName}({funcNamedParams});
     @end if
+    overhead_scope.endDownCall();
+    @if('{funcName}' in PIPELINE_CREATION_CALLS)
+    pCreateInfos = app_create_infos;
+    ApiDumpInstance::current().endPipelineCreation(pipeline_creation, pPipelines);
+    @end if
+    if (dump_function && ApiDumpInstance::current().settings().callFilter().enabled()) {{
+        ApiDumpFilteredCall filtered_call = ApiDumpInstance::current().filteredCall();
+        @foreach parameter
+        @if('{prmIsHandle}' == 'true' and {prmPtrLevel} == 0)
+        filtered_call.addHandle({prmName});
+        @end if
+        @if('{prmIsHandle}' == 'true' and {prmPtrLevel} == 1 and '{prmLength}' == 'None')
+        if ({prmName} != nullptr) filtered_call.addHandle(*{prmName});
+        @end if
+        @if('{prmIsHandle}' == 'true' and {prmPtrLevel} == 1 and '{prmLength}' != 'None')
+        filtered_call.addHandles({prmName}, {prmLength});
+        @end if
+        @end parameter
+        @if('{funcReturn}' == 'VkResult')
+        filtered_call.setResult(result);
+        @end if
+        if (!filtered_call.matches()) {{
+            ApiDumpInstance::current().cancelOutput();
+            dump_function = false;
+        }}
+    }}
+    if (dump_function) ApiDumpInstance::current().recordCallTime({funcIndex}, call_start);
     @if('{funcName}' in BLOCKING_API_CALLS)
-    ApiDumpInstance::current().outputMutex()->lock();
-    dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
+    if (dump_function) {{
+        ApiDumpInstance::current().beginOutput(get_dispatch_key({funcDispatchParam}));
+        dump_function_head(ApiDumpInstance::current(), "{funcName}", "{funcNamedParams}", "{funcReturn}");
+    }}
     @end if
     {funcStateTrackingCode}
+    {funcObjectTrackingCode}
+    {funcCommandSummaryCode}
     @if('{funcName}' == 'vkDestroyDevice')
     destroy_device_dispatch_table(get_dispatch_key(device));
     @end if
 
-    if (ApiDumpInstance::current().shouldDumpOutput()) {{
-        switch(ApiDumpInstance::current().settings().format())
-        {{
-            @if('{funcReturn}' != 'void')
-            case ApiDumpFormat::Text:
-                dump_text_{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
-                break;
-            case ApiDumpFormat::Html:
-                dump_html_{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
-                break;
-            case ApiDumpFormat::Json:
-                dump_json_{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
-                break;
-            @end if
-            @if('{funcReturn}' == 'void')
-            case ApiDumpFormat::Text:
-                dump_text_{funcName}(ApiDumpInstance::current(), {funcNamedParams});
-                break;
-            case ApiDumpFormat::Html:
-                dump_html_{funcName}(ApiDumpInstance::current(), {funcNamedParams});
-                break;
-            case ApiDumpFormat::Json:
-                dump_json_{funcName}(ApiDumpInstance::current(), {funcNamedParams});
-                break;
-            @end if
-        }}
+    if (dump_function) {{
+        @if('{funcReturn}' != 'void')
+        ApiDumpInstance::current().formatFunctions()->{funcName}(ApiDumpInstance::current(), result, {funcNamedParams});
+        @end if
+        @if('{funcReturn}' == 'void')
+        ApiDumpInstance::current().formatFunctions()->{funcName}(ApiDumpInstance::current(), {funcNamedParams});
+        @end if
+        @if('{funcName}' in ['vkQueueSubmit', 'vkQueueSubmit2', 'vkQueueSubmit2KHR'])
+        ApiDumpInstance::current().dumpSubmittedCmdBuffers(submitCount, pSubmits);
+        @end if
+        @if('{funcName}' == 'vkEndCommandBuffer')
+        ApiDumpInstance::current().dumpCmdBufferSummary(commandBuffer);
+        @end if
+        @if('{funcName}' in MEMOIZED_API_CALLS)
+        ApiDumpInstance::current().markQueryOutput();
+        @end if
+        ApiDumpInstance::current().endOutput();
     }}
-    ApiDumpInstance::current().outputMutex()->unlock();
-    @if('{funcName}' == 'vkQueuePresentKHR')
-    ApiDumpInstance::current().nextFrame();
+    @if('{funcReturn}' == 'VkResult')
+    if (result == VK_ERROR_DEVICE_LOST) ApiDumpInstance::current().writeFlightRecorder(false);
+    @end if
+    @if('{funcFrameDelimiter}' in ['Present', 'Submit', 'WaitIdle'])
+    ApiDumpInstance::current().delimitFrame(ApiDumpFrameDelimiter::{funcFrameDelimiter});
+    @end if
+    @if('{funcFrameDelimiter}' == 'FenceWait')
+    // A wait which times out doesn't end anything, and polling with a timeout of 0 would otherwise count many frames.
+    if (result == VK_SUCCESS) ApiDumpInstance::current().delimitFrame(ApiDumpFrameDelimiter::FenceWait);
     @end if
     @if('{funcReturn}' != 'void')
     return result;
@@ -366,34 +609,74 @@ VKAPI_ATTR {funcReturn} VKAPI_CALL {funcName}({funcTypedParams})
 }}
 @end function
 
-VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL api_dump_known_instance_functions(const char* pName)
+struct ApiDumpKnownFunction {{
+    const char* name;
+    PFN_vkVoidFunction function;
+    uint32_t index;
+    // Whether the layer must intercept the function even when it isn't dumped, for the state it tracks or because it is the
+    // frame delimiter
+    bool stateful;
+}};
+
+// Hashes the names once, so that loaders resolving every entrypoint don't go through hundreds of string compares per lookup
+using ApiDumpKnownFunctionMap = std::unordered_map<std::string_view, const ApiDumpKnownFunction*>;
+
+template <std::size_t N>
+static ApiDumpKnownFunctionMap api_dump_build_known_functions(const ApiDumpKnownFunction (&functions)[N])
+{{
+    ApiDumpKnownFunctionMap map(N);
+    for (const ApiDumpKnownFunction& function : functions)
+        map.emplace(function.name, &function);
+    return map;
+}}
+
+static const ApiDumpKnownFunction* api_dump_find_known_function(const ApiDumpKnownFunctionMap& map, const char* pName)
+{{
+    if (pName == nullptr) return nullptr;
+    auto it = map.find(std::string_view(pName));
+    return it != map.end() ? it->second : nullptr;
+}}
+
+static const ApiDumpKnownFunction* api_dump_known_instance_functions(const char* pName)
 {{
+    static const ApiDumpKnownFunction known_functions[] = {{
     @foreach function where('{funcType}' in ['global', 'instance'] and '{funcName}' not in [ 'vkEnumerateDeviceExtensionProperties' ])
-    if(strcmp(pName, "{funcName}") == 0)
-        return reinterpret_cast<PFN_vkVoidFunction>({funcName});
+        {{ "{funcName}", reinterpret_cast<PFN_vkVoidFunction>({funcName}), {funcIndex}, true }},
     @end function
+    }};
+    static const ApiDumpKnownFunctionMap known_function_map = api_dump_build_known_functions(known_functions);
 
-    return nullptr;
+    return api_dump_find_known_function(known_function_map, pName);
 }}
 
-VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL api_dump_known_device_functions(const char* pName)
+static const ApiDumpKnownFunction* api_dump_known_device_functions(const char* pName)
 {{
+    static const ApiDumpKnownFunction known_functions[] = {{
     @foreach function where('{funcType}' == 'device')
-    if(strcmp(pName, "{funcName}") == 0)
-        return reinterpret_cast<PFN_vkVoidFunction>({funcName});
+        @if('{funcName}' in STATEFUL_API_CALLS or '{funcName}' == 'vkGetDeviceProcAddr')
+        {{ "{funcName}", reinterpret_cast<PFN_vkVoidFunction>({funcName}), {funcIndex}, true }},
+        @end if
+        @if('{funcName}' not in STATEFUL_API_CALLS and '{funcName}' != 'vkGetDeviceProcAddr' and '{funcName}' not in FRAME_DELIMITER_API_CALLS)
+        {{ "{funcName}", reinterpret_cast<PFN_vkVoidFunction>({funcName}), {funcIndex}, false }},
+        @end if
+        @if('{funcName}' not in STATEFUL_API_CALLS and '{funcName}' in FRAME_DELIMITER_API_CALLS)
+        {{ "{funcName}", reinterpret_cast<PFN_vkVoidFunction>({funcName}), {funcIndex}, ApiDumpInstance::current().settings().frameDelimiter() == ApiDumpFrameDelimiter::{funcFrameDelimiter} }},
+        @end if
     @end function
+    }};
+    static const ApiDumpKnownFunctionMap known_function_map = api_dump_build_known_functions(known_functions);
 
-    return nullptr;
+    return api_dump_find_known_function(known_function_map, pName);
 }}
 
 EXPORT_FUNCTION VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(VkInstance instance, const char* pName)
 {{
     auto instance_func = api_dump_known_instance_functions(pName);
-    if (instance_func) return instance_func;
+    if (instance_func) return instance_func->function;
 
     // Make sure that device functions queried through GIPA works
     auto device_func = api_dump_known_device_functions(pName);
-    if (device_func) return device_func;
+    if (device_func) return device_func->function;
 
     // Haven't created an instance yet, exit now since there is no instance_dispatch_table
     if(instance_dispatch_table(instance)->GetInstanceProcAddr == NULL)
@@ -404,7 +687,11 @@ EXPORT_FUNCTION VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(V
 EXPORT_FUNCTION VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkDevice device, const char* pName)
 {{
     auto device_func = api_dump_known_device_functions(pName);
-    if (device_func) return device_func;
+    // The functions the function filter excludes would only ever go through the wrapper to the next layer, so they are
+    // not intercepted at all and cost nothing
+    const bool bypass = device_func != nullptr && device != VK_NULL_HANDLE && !device_func->stateful &&
+                        ApiDumpInstance::current().isFunctionFilteredOut(device_func->index);
+    if (device_func && !bypass) return device_func->function;
 
     // Haven't created a device yet, exit now since there is no device_dispatch_table
     if(device_dispatch_table(device)->GetDeviceProcAddr == NULL)
@@ -522,9 +809,9 @@ void dump_text_{hdlName}(const {hdlName} object, const ApiDumpSettings& settings
     if(settings.showAddress()) {{
         settings.stream() << object;
 
-        std::unordered_map<uint64_t, std::string>::const_iterator it = ApiDumpInstance::current().object_name_map.find((uint64_t) object);
-        if (it != ApiDumpInstance::current().object_name_map.end()) {{
-            settings.stream() << " [" << it->second << "]";
+        const char* object_name = ApiDumpInstance::current().get_object_name((uint64_t) object);
+        if (object_name != nullptr) {{
+            settings.stream() << " [" << object_name << "]";
         }}
     }} else {{
         settings.stream() << "address";
@@ -532,22 +819,42 @@ void dump_text_{hdlName}(const {hdlName} object, const ApiDumpSettings& settings
 }}
 @end handle
 
+//========================== Enum and Bitmask Names =========================//
+
+// NOTE: Because the other api_dump_*.h files include api_dump_text.h, these tables only need to
+// be generated by it.
+@foreach enum
+@if({enumOptionCount} > 0)
+static constexpr ApiDumpEnumName {enumName}_names[] = {{
+    @foreach option
+    {{{optValue}, "{optName}", {optLength}}},
+    @end option
+}};
+@end if
+@if({enumOptionCount} == 0)
+static constexpr const ApiDumpEnumName* {enumName}_names = nullptr;
+@end if
+@end enum
+@foreach bitmask
+@if({bitOptionCount} > 0)
+static constexpr ApiDumpBitmaskName {bitName}_names[] = {{
+    @foreach option
+    {{{optValue}, "{optName}", {optLength}, {optExact}}},
+    @end option
+}};
+@end if
+@if({bitOptionCount} == 0)
+static constexpr const ApiDumpBitmaskName* {bitName}_names = nullptr;
+@end if
+@end bitmask
+
 //=========================== Enum Implementations ==========================//
 
 @foreach enum
 void dump_text_{enumName}({enumName} object, const ApiDumpSettings& settings, int indents)
 {{
-    switch((int64_t) object)
-    {{
-    @foreach option
-    case {optValue}:
-        settings.stream() << "{optName} (";
-        break;
-    @end option
-    default:
-        settings.stream() << "UNKNOWN (";
-    }}
-    settings.stream() << object << ")";
+    OutputEnumName(settings, {enumName}_names, {enumOptionCount}, (int64_t) object);
+    settings.stream() << " (" << object << ")";
 }}
 @end enum
 
@@ -556,26 +863,14 @@ void dump_text_{enumName}({enumName} object, const ApiDumpSettings& settings, in
 @foreach bitmask
 @if('{bitWidth}' == '64')
 // 64 bit bitmasks don't have an enum of bit values.
-// NOTE: Because all of the api_dump_*.h files are only included in api_dump.cpp, this typedef
-// only needs to be generated by the first .h file.
+// NOTE: Because the other api_dump_*.h files include api_dump_text.h, this typedef only needs to
+// be generated by it.
 typedef VkFlags64 {bitName};
 @end if
 void dump_text_{bitName}({bitName} object, const ApiDumpSettings& settings, int indents)
 {{
-    bool is_first = true;
     settings.stream() << object;
-    @foreach option
-        @if('{optMultiValue}' != 'None')
-    if(object == {optValue}) {{
-        @end if
-        @if('{optMultiValue}' == 'None')
-    if(object & {optValue}) {{
-        @end if
-        settings.stream() << (is_first ? \" (\" : \" | \") << "{optName}"; is_first = false;
-    }}
-    @end option
-    if(!is_first)
-        settings.stream() << ")";
+    OutputBitmaskNames(settings, {bitName}_names, {bitOptionCount}, (uint64_t) object);
 }}
 @end bitmask
 
@@ -642,26 +937,28 @@ void dump_text_{sctName}(const {sctName}& object, const ApiDumpSettings& setting
     dump_text_pointer<const {memBaseType}>(object.{memName}, settings, "{memType}", "{memName}", indents + 1, dump_text_{memTypeID});
         @end if
         @if({memPtrLevel} == 1 and '{memLength}' != 'None' and not {memLengthIsMember})
-    dump_text_array<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_text_{memTypeID}); // AQA
+    dump_text_{memArrayKind}<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_text_{memTypeID}); // AQA
         @end if
         @if({memPtrLevel} == 1 and '{memLength}' != 'None' and {memLengthIsMember} and '{memName}' != 'pCode')
             @if('{memLength}'[0].isdigit() or '{memLength}'[0].isupper())
-    dump_text_array<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_text_{memTypeID}); // BQA
+    dump_text_{memArrayKind}<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_text_{memTypeID}); // BQA
             @end if
             @if(not ('{memLength}'[0].isdigit() or '{memLength}'[0].isupper()))
                 @if('{memLength}' == 'rasterizationSamples')
-    dump_text_array<const {memBaseType}>(object.{memName}, (object.{memLength} + 31) / 32, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_text_{memTypeID}); // BQB
+    dump_text_{memArrayKind}<const {memBaseType}>(object.{memName}, (object.{memLength} + 31) / 32, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_text_{memTypeID}); // BQB
                 @end if
                 @if('{memLength}' != 'rasterizationSamples')
-    dump_text_array<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_text_{memTypeID}); // BQB
+    dump_text_{memArrayKind}<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_text_{memTypeID}); // BQB
                 @end if
             @end if
         @end if
 
         @if('{sctName}' == 'VkShaderModuleCreateInfo')
             @if('{memName}' == 'pCode')
-    if(settings.showShader())
-        dump_text_array<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_text_{memTypeID}); // CQA
+    if(settings.showShader() && !settings.shaderDirectory().empty())
+        dump_text_special(ApiDumpInstance::current().storeShader(object.{memName}, object.codeSize).c_str(), settings, "{memType}", "{memName}", indents + 1);
+    else if(settings.showShader())
+        dump_text_{memArrayKind}<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_text_{memTypeID}); // CQA
     else
         dump_text_special("SHADER DATA", settings, "{memType}", "{memName}", indents + 1);
             @end if
@@ -706,7 +1003,7 @@ void dump_text_{unName}(const {unName}& object, const ApiDumpSettings& settings,
     dump_text_pointer<const {chcBaseType}>(object.{chcName}, settings, "{chcType}", "{chcName}", indents + 1, dump_text_{chcTypeID});
     @end if
     @if({chcPtrLevel} == 1 and '{chcLength}' != 'None')
-    dump_text_array<const {chcBaseType}>(object.{chcName}, {chcLength}, settings, "{chcType}", "{chcChildType}", "{chcName}", indents + 1, dump_text_{chcTypeID}); // GQA
+    dump_text_{chcArrayKind}<const {chcBaseType}>(object.{chcName}, {chcLength}, settings, "{chcType}", "{chcChildType}", "{chcName}", indents + 1, dump_text_{chcTypeID}); // GQA
     @end if
     @end choice
 }}
@@ -795,7 +1092,7 @@ void dump_text_{funcName}(ApiDumpInstance& dump_inst, {funcTypedParams})
         dump_text_pointer<const {prmBaseType}>({prmName}, settings, "{prmType}", "{prmName}", 1, dump_text_{prmTypeID});
         @end if
         @if({prmPtrLevel} == 1 and '{prmLength}' != 'None')
-        dump_text_array<const {prmBaseType}>({prmName}, {prmLength}, settings, "{prmType}", "{prmChildType}", "{prmName}", 1, dump_text_{prmTypeID}); // HQA
+        dump_text_{prmArrayKind}<const {prmBaseType}>({prmName}, {prmLength}, settings, "{prmType}", "{prmChildType}", "{prmName}", 1, dump_text_{prmTypeID}); // HQA
         @end if
         @end parameter
     }}
@@ -839,6 +1136,10 @@ HTML_CODEGEN = """
 #pragma once
 
 #include "api_dump.h"
+#include "api_dump_video_text.h"
+@if(not {isVideoGeneration})
+#include "api_dump_text.h"
+@end if
 #include "api_dump_video_html.h"
 @if(not {isVideoGeneration})
 void dump_html_pNext_trampoline(const void* object, const ApiDumpSettings& settings, int indents);
@@ -919,9 +1220,9 @@ void dump_html_{hdlName}(const {hdlName} object, const ApiDumpSettings& settings
     if(settings.showAddress()) {{
         settings.stream() << object;
 
-        std::unordered_map<uint64_t, std::string>::const_iterator it = ApiDumpInstance::current().object_name_map.find((uint64_t) object);
-        if (it != ApiDumpInstance::current().object_name_map.end()) {{
-            settings.stream() << "</div><div class='val'>[" << it->second << "]";
+        const char* object_name = ApiDumpInstance::current().get_object_name((uint64_t) object);
+        if (object_name != nullptr) {{
+            settings.stream() << "</div><div class='val'>[" << object_name << "]";
         }}
     }} else {{
         settings.stream() << "address";
@@ -936,17 +1237,8 @@ void dump_html_{hdlName}(const {hdlName} object, const ApiDumpSettings& settings
 void dump_html_{enumName}({enumName} object, const ApiDumpSettings& settings, int indents)
 {{
     settings.stream() << "<div class='val'>";
-    switch((int64_t) object)
-    {{
-    @foreach option
-    case {optValue}:
-        settings.stream() << "{optName} (";
-        break;
-    @end option
-    default:
-        settings.stream() << "UNKNOWN (";
-    }}
-    settings.stream() << object << ")</div></summary>";
+    OutputEnumName(settings, {enumName}_names, {enumOptionCount}, (int64_t) object);
+    settings.stream() << " (" << object << ")</div></summary>";
 }}
 @end enum
 
@@ -955,21 +1247,8 @@ void dump_html_{enumName}({enumName} object, const ApiDumpSettings& settings, in
 @foreach bitmask
 void dump_html_{bitName}({bitName} object, const ApiDumpSettings& settings, int indents)
 {{
-    settings.stream() << "<div class=\'val\'>";
-    bool is_first = true;
-    settings.stream() << object;
-    @foreach option
-        @if('{optMultiValue}' != 'None')
-    if(object == {optValue}) {{
-        @end if
-        @if('{optMultiValue}' == 'None')
-    if(object & {optValue}) {{
-        @end if
-        settings.stream() << (is_first ? \" (\" : \" | \") << "{optName}"; is_first = false;
-    }}
-    @end option
-    if(!is_first)
-        settings.stream() << ")";
+    settings.stream() << "<div class=\'val\'>" << object;
+    OutputBitmaskNames(settings, {bitName}_names, {bitOptionCount}, (uint64_t) object);
     settings.stream() << "</div></summary>";
 }}
 @end bitmask
@@ -1046,25 +1325,27 @@ void dump_html_{sctName}(const {sctName}& object, const ApiDumpSettings& setting
     dump_html_pointer<const {memBaseType}>(object.{memName}, settings, "{memType}", "{memName}", indents + 1, dump_html_{memTypeID});
         @end if
         @if({memPtrLevel} == 1 and '{memLength}' != 'None' and not {memLengthIsMember})
-    dump_html_array<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_html_{memTypeID}); // ZRR
+    dump_html_{memArrayKind}<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_html_{memTypeID}); // ZRR
         @end if
         @if({memPtrLevel} == 1 and '{memLength}' != 'None' and {memLengthIsMember} and '{memName}' != 'pCode')
             @if('{memLength}'[0].isdigit() or '{memLength}'[0].isupper())
-    dump_html_array<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_html_{memTypeID}); // ZRS
+    dump_html_{memArrayKind}<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_html_{memTypeID}); // ZRS
             @end if
             @if(not ('{memLength}'[0].isdigit() or '{memLength}'[0].isupper()))
                 @if('{memLength}' == 'rasterizationSamples')
-    dump_html_array<const {memBaseType}>(object.{memName}, (object.{memLength} + 31) / 32, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_html_{memTypeID}); // ZRT
+    dump_html_{memArrayKind}<const {memBaseType}>(object.{memName}, (object.{memLength} + 31) / 32, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_html_{memTypeID}); // ZRT
                 @end if
                 @if('{memLength}' != 'rasterizationSamples')
-    dump_html_array<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_html_{memTypeID}); // ZRT
+    dump_html_{memArrayKind}<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_html_{memTypeID}); // ZRT
                 @end if
             @end if
         @end if
         @if('{sctName}' == 'VkShaderModuleCreateInfo')
             @if('{memName}' == 'pCode')
-    if(settings.showShader())
-        dump_html_array<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_html_{memTypeID}); // ZRU
+    if(settings.showShader() && !settings.shaderDirectory().empty())
+        dump_html_special(ApiDumpInstance::current().storeShader(object.{memName}, object.codeSize).c_str(), settings, "{memType}", "{memName}", indents + 1);
+    else if(settings.showShader())
+        dump_html_{memArrayKind}<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", indents + 1, dump_html_{memTypeID}); // ZRU
     else
         dump_html_special("SHADER DATA", settings, "{memType}", "{memName}", indents + 1);
             @end if
@@ -1101,7 +1382,7 @@ void dump_html_{unName}(const {unName}& object, const ApiDumpSettings& settings,
     dump_html_pointer<const {chcBaseType}>(object.{chcName}, settings, "{chcType}", "{chcName}", indents + 1, dump_html_{chcTypeID});
     @end if
     @if({chcPtrLevel} == 1 and '{chcLength}' != 'None')
-    dump_html_array<const {chcBaseType}>(object.{chcName}, {chcLength}, settings, "{chcType}", "{chcChildType}", "{chcName}", indents + 1, dump_html_{chcTypeID}); // ZRY
+    dump_html_{chcArrayKind}<const {chcBaseType}>(object.{chcName}, {chcLength}, settings, "{chcType}", "{chcChildType}", "{chcName}", indents + 1, dump_html_{chcTypeID}); // ZRY
     @end if
     @end choice
 }}
@@ -1167,7 +1448,7 @@ void dump_html_{funcName}(ApiDumpInstance& dump_inst, {funcTypedParams})
         dump_html_pointer<const {prmBaseType}>({prmName}, settings, "{prmType}", "{prmName}", 1, dump_html_{prmTypeID});
         @end if
         @if({prmPtrLevel} == 1 and '{prmLength}' != 'None')
-        dump_html_array<const {prmBaseType}>({prmName}, {prmLength}, settings, "{prmType}", "{prmChildType}", "{prmName}", 1, dump_html_{prmTypeID}); // ZRZ
+        dump_html_{prmArrayKind}<const {prmBaseType}>({prmName}, {prmLength}, settings, "{prmType}", "{prmChildType}", "{prmName}", 1, dump_html_{prmTypeID}); // ZRZ
         @end if
         @end parameter
     }}
@@ -1211,6 +1492,10 @@ JSON_CODEGEN = """
 #pragma once
 
 #include "api_dump.h"
+#include "api_dump_video_text.h"
+@if(not {isVideoGeneration})
+#include "api_dump_text.h"
+@end if
 #include "api_dump_video_json.h"
 @if(not {isVideoGeneration})
 void dump_json_pNext_trampoline(const void* object, const ApiDumpSettings& settings, int indents);
@@ -1298,16 +1583,13 @@ void dump_json_{hdlName}(const {hdlName} object, const ApiDumpSettings& settings
 @foreach enum
 void dump_json_{enumName}({enumName} object, const ApiDumpSettings& settings, int indents)
 {{
-    switch((int64_t) object)
-    {{
-    @foreach option
-    case {optValue}:
-        settings.stream() << "\\"{optName}\\"";
-        break;
-    @end option
-    default:
-        settings.stream() << "\\"UNKNOWN (" << object << ")\\"";
-    }}
+    const ApiDumpEnumName* found = FindEnumName({enumName}_names, {enumOptionCount}, (int64_t) object);
+    settings.stream() << '"';
+    if (found != nullptr)
+        settings.stream().write(found->name, found->length);
+    else
+        settings.stream() << "UNKNOWN (" << object << ")";
+    settings.stream() << '"';
 }}
 @end enum
 
@@ -1316,21 +1598,9 @@ void dump_json_{enumName}({enumName} object, const ApiDumpSettings& settings, in
 @foreach bitmask
 void dump_json_{bitName}({bitName} object, const ApiDumpSettings& settings, int indents)
 {{
-    bool is_first = true;
     settings.stream() << '"' << object;
-    @foreach option
-        @if('{optMultiValue}' != 'None')
-    if(object == {optValue}) {{
-        @end if
-        @if('{optMultiValue}' == 'None')
-    if(object & {optValue}) {{
-        @end if
-        settings.stream() << (is_first ? \" (\" : \" | \") << "{optName}"; is_first = false;
-    }}
-    @end option
-    if(!is_first)
-        settings.stream() << ')';
-    settings.stream() << "\\"";
+    OutputBitmaskNames(settings, {bitName}_names, {bitOptionCount}, (uint64_t) object);
+    settings.stream() << '"';
 }}
 @end bitmask
 
@@ -1401,25 +1671,27 @@ void dump_json_{sctName}(const {sctName}& object, const ApiDumpSettings& setting
     dump_json_pointer<const {memBaseType}>(object.{memName}, settings, "{memType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID});
         @end if
         @if({memPtrLevel} == 1 and '{memLength}' != 'None' and not {memLengthIsMember})
-    dump_json_array<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // IQA
+    dump_json_{memArrayKind}<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // IQA
         @end if
         @if({memPtrLevel} == 1 and '{memLength}' != 'None' and {memLengthIsMember} and '{memName}' != 'pCode')
             @if('{memLength}'[0].isdigit() or '{memLength}'[0].isupper())
-    dump_json_array<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // JQA
+    dump_json_{memArrayKind}<const {memBaseType}>(object.{memName}, {memLength}, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // JQA
             @end if
             @if(not ('{memLength}'[0].isdigit() or '{memLength}'[0].isupper()))
                 @if('{memLength}' == 'rasterizationSamples')
-    dump_json_array<const {memBaseType}>(object.{memName}, (object.{memLength} + 31) / 32, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // JQA
+    dump_json_{memArrayKind}<const {memBaseType}>(object.{memName}, (object.{memLength} + 31) / 32, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // JQA
                 @end if
                 @if('{memLength}' != 'rasterizationSamples')
-    dump_json_array<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // JQA
+    dump_json_{memArrayKind}<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // JQA
                 @end if
             @end if
         @end if
         @if('{sctName}' == 'VkShaderModuleCreateInfo')
             @if('{memName}' == 'pCode')
-    if(settings.showShader())
-        dump_json_array<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // KQA
+    if(settings.showShader() && !settings.shaderDirectory().empty())
+        dump_json_special(ApiDumpInstance::current().storeShader(object.{memName}, object.codeSize).c_str(), settings, "{memType}", "{memName}", indents + 1);
+    else if(settings.showShader())
+        dump_json_{memArrayKind}<const {memBaseType}>(object.{memName}, object.{memLength}, settings, "{memType}", "{memChildType}", "{memName}", {memIsStruct}, {memIsUnion}, indents + 1, dump_json_{memTypeID}); // KQA
     else
         dump_json_special("SHADER DATA", settings, "{memType}", "{memName}", indents + 1);
             @end if
@@ -1454,7 +1726,7 @@ void dump_json_{unName}(const {unName}& object, const ApiDumpSettings& settings,
     dump_json_pointer<const {chcBaseType}>(object.{chcName}, settings, "{chcType}", "{chcName}", {chcIsStruct}, {chcIsUnion}, indents + 2, dump_json_{chcTypeID});
     @end if
     @if({chcPtrLevel} == 1 and '{chcLength}' != 'None')
-    dump_json_array<const {chcBaseType}>(object.{chcName}, {chcLength}, settings, "{chcType}", "{chcChildType}", "{chcName}", {chcIsStruct}, {chcIsUnion}, indents + 2, dump_json_{chcTypeID}); // OQA
+    dump_json_{chcArrayKind}<const {chcBaseType}>(object.{chcName}, {chcLength}, settings, "{chcType}", "{chcChildType}", "{chcName}", {chcIsStruct}, {chcIsUnion}, indents + 2, dump_json_{chcTypeID}); // OQA
     @end if
     @end choice
 
@@ -1507,17 +1779,19 @@ void dump_json_{funcName}(ApiDumpInstance& dump_inst, {funcTypedParams})
 @end if
 {{
     const ApiDumpSettings& settings(dump_inst.settings());
+    // Read once, as max_overhead_percent can stop the parameters from being dumped at any time.
+    const bool show_params = settings.showParams();
 
     @if('{funcReturn}' != 'void')
     settings.stream() << settings.indentation(3) << "\\\"returnValue\\\" : ";
     dump_json_{funcReturn}(result, settings, 0);
-    if(settings.showParams())
+    if(show_params)
         settings.stream() << ",";
     settings.stream() << "\\n";
     @end if
 
     // Display parameter values
-    if(settings.showParams())
+    if(show_params)
     {{
         settings.stream() << settings.indentation(3) << "\\\"args\\\" :\\n";
         settings.stream() << settings.indentation(3) << "[\\n";
@@ -1536,7 +1810,7 @@ void dump_json_{funcName}(ApiDumpInstance& dump_inst, {funcTypedParams})
         dump_json_pointer<const {prmBaseType}>({prmName}, settings, "{prmType}", "{prmName}", {prmIsStruct}, {prmIsUnion}, 4, dump_json_{prmTypeID});
         @end if
         @if({prmPtrLevel} == 1 and '{prmLength}' != 'None')
-        dump_json_array<const {prmBaseType}>({prmName}, {prmLength}, settings, "{prmType}", "{prmChildType}", "{prmName}", {prmIsStruct}, {prmIsUnion}, 4, dump_json_{prmTypeID}); // PQA
+        dump_json_{prmArrayKind}<const {prmBaseType}>({prmName}, {prmLength}, settings, "{prmType}", "{prmChildType}", "{prmName}", {prmIsStruct}, {prmIsUnion}, 4, dump_json_{prmTypeID}); // PQA
         @end if
         @end parameter
 
@@ -1548,70 +1822,920 @@ void dump_json_{funcName}(ApiDumpInstance& dump_inst, {funcTypedParams})
 @end function
 """
 
-POINTER_TYPES = ['void', 'xcb_connection_t', 'Display', 'SECURITY_ATTRIBUTES', 'ANativeWindow', 'AHardwareBuffer', 'wl_display', '_screen_context', '_screen_window', '_screen_buffer']
+# The binary codegen writes the values of each call as they are in memory, following pointers and pNext chains, so that a
+# capture can be formatted later by the api_dump_convert tool. Every statement it emits for a member has a counterpart in
+# BINARY_READER_CODEGEN which reads the same bytes back, so the two must be kept in sync.
 
-TRACKED_STATE = {
-    'vkAllocateCommandBuffers':
-        'if(result == VK_SUCCESS)\n' +
-            'ApiDumpInstance::current().addCmdBuffers(\n' +
-                'device,\n' +
-                'pAllocateInfo->commandPool,\n' +
-                'std::vector<VkCommandBuffer>(pCommandBuffers, pCommandBuffers + pAllocateInfo->commandBufferCount),\n' +
-                'pAllocateInfo->level\n'
-            ');',
-    'vkDestroyCommandPool':
-        'ApiDumpInstance::current().eraseCmdBufferPool(device, commandPool);'
-    ,
-    'vkFreeCommandBuffers':
-        'ApiDumpInstance::current().eraseCmdBuffers(device, commandPool, std::vector<VkCommandBuffer>(pCommandBuffers, pCommandBuffers + commandBufferCount));'
-    ,
-}
+BINARY_CODEGEN = """
+/* Copyright (c) 2015-2023 Valve Corporation
+ * Copyright (c) 2015-2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
 
-PARAMETER_STATE = {
-    'VkPipelineViewportStateCreateInfo': {
-        'VkGraphicsPipelineCreateInfo': [
-            {
-                'name': 'is_dynamic_viewport',
-                'type': 'bool',
-                'stmt':
-                    'ApiDumpInstance::current().setIsDynamicViewport(' +
-                    'object.pDynamicState && ' +
-                    'std::count(' +
-                        'object.pDynamicState->pDynamicStates, ' +
-                        'object.pDynamicState->pDynamicStates + object.pDynamicState->dynamicStateCount, ' +
-                        'VK_DYNAMIC_STATE_VIEWPORT' +
-                    ') > 0);',
-             },
-             {
-                'name':'is_dynamic_scissor',
-                'type': 'bool',
-                'stmt':
-                    'ApiDumpInstance::current().setIsDynamicScissor(' +
-                    'object.pDynamicState && ' +
-                    'std::count(' +
-                        'object.pDynamicState->pDynamicStates, ' +
-                        'object.pDynamicState->pDynamicStates + object.pDynamicState->dynamicStateCount, ' +
-                        'VK_DYNAMIC_STATE_SCISSOR' +
-                    '));',
-            },
-        ],
-    },
-    'VkCommandBufferBeginInfo': {
-        'vkBeginCommandBuffer': [
-            {
-                'name': 'cmd_buffer',
-                'type': 'VkCommandBuffer',
-                'stmt': 'ApiDumpInstance::current().setCmdBuffer(commandBuffer);',
-            },
-        ],
-    },
-    'VkPhysicalDeviceMemoryProperties': {
-        'VkPhysicalDeviceMemoryProperties2': [
-            {
-                'name': 'memoryProperties',
-                'type': 'VkPhysicalDeviceMemoryProperties',
-                'stmt': 'ApiDumpInstance::current().setMemoryHeapCount(object.memoryProperties.memoryHeapCount);',
-            },
+/*
+ * This file is generated from the Khronos Vulkan XML API Registry.
+ */
+
+#pragma once
+
+#include "api_dump.h"
+#include "api_dump_video_binary.h"
+@if(not {isVideoGeneration})
+void dump_binary_pNext(const void* object, const ApiDumpSettings& settings);
+@end if
+@foreach union
+void dump_binary_{unName}(const {unName}& object, const ApiDumpSettings& settings);
+@end union
+
+//=========================== Type Implementations ==========================//
+
+@foreach type where('{etyName}' != 'void')
+void dump_binary_{etyName}({etyName} object, const ApiDumpSettings& settings)
+{{
+    dump_binary_raw(object, settings);
+}}
+@end type
+
+//========================= Basetype Implementations ========================//
+
+@foreach basetype where(not '{baseName}' in ['ANativeWindow', 'AHardwareBuffer', 'CAMetalLayer'])
+void dump_binary_{baseName}({baseName} object, const ApiDumpSettings& settings)
+{{
+    dump_binary_raw(object, settings);
+}}
+@end basetype
+@foreach basetype where('{baseName}' in ['ANativeWindow', 'AHardwareBuffer'])
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+void dump_binary_{baseName}(const {baseName}* object, const ApiDumpSettings& settings)
+{{
+    dump_binary_raw(object, settings);
+}}
+#endif
+@end basetype
+@foreach basetype where('{baseName}' in ['CAMetalLayer'])
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+void dump_binary_{baseName}({baseName} object, const ApiDumpSettings& settings)
+{{
+    dump_binary_raw(object, settings);
+}}
+#endif
+@end basetype
+
+//======================= System Type Implementations =======================//
+
+@foreach systype
+void dump_binary_{sysName}(const {sysType} object, const ApiDumpSettings& settings)
+{{
+    dump_binary_raw(object, settings);
+}}
+@end systype
+
+//========================== Handle Implementations =========================//
+
+@foreach handle
+void dump_binary_{hdlName}(const {hdlName} object, const ApiDumpSettings& settings)
+{{
+    dump_binary_raw(object, settings);
+}}
+@end handle
+
+//=========================== Enum Implementations ==========================//
+
+@foreach enum
+void dump_binary_{enumName}({enumName} object, const ApiDumpSettings& settings)
+{{
+    dump_binary_raw(object, settings);
+}}
+@end enum
+
+//========================= Bitmask Implementations =========================//
+
+@foreach bitmask
+void dump_binary_{bitName}({bitName} object, const ApiDumpSettings& settings)
+{{
+    dump_binary_raw(object, settings);
+}}
+@end bitmask
+
+//=========================== Flag Implementations ==========================//
+
+@foreach flag
+void dump_binary_{flagName}({flagName} object, const ApiDumpSettings& settings)
+{{
+    dump_binary_raw(object, settings);
+}}
+@end flag
+
+//======================= Func Pointer Implementations ======================//
+
+@foreach funcpointer
+void dump_binary_{pfnName}({pfnName} object, const ApiDumpSettings& settings)
+{{
+    dump_binary_raw(object, settings);
+}}
+@end funcpointer
+
+//============================== Struct Traits ==============================//
+
+@if({isVideoGeneration})
+// A member which points to an array counted by another member of the same struct
+struct ApiDumpCountedArray {{
+    size_t offset;
+    size_t count_offset;
+    size_t count_size;
+    size_t element_size;
+}};
+
+// The layout of a struct or of a union for the capture of the binary format. A flat object holds no pointer, even in its
+// nested structs and unions, so it is captured with a single copy of 'size' bytes; the others are followed through their
+// counted arrays and their pNext chain.
+template <typename T>
+struct ApiDumpStructTraits;
+@end if
+
+@foreach struct
+template <>
+struct ApiDumpStructTraits<{sctName}> {{
+    static constexpr size_t size = sizeof({sctName});
+    static constexpr bool is_flat = {sctIsFlat};
+    static constexpr bool has_pNext = {sctHasPNext};
+    static constexpr std::array<ApiDumpCountedArray, {sctCountedArrayCount}> counted_arrays = {sctCountedArrays};
+}};
+@end struct
+@foreach union
+template <>
+struct ApiDumpStructTraits<{unName}> {{
+    static constexpr size_t size = sizeof({unName});
+    static constexpr bool is_flat = {unIsFlat};
+    static constexpr bool has_pNext = false;
+    static constexpr std::array<ApiDumpCountedArray, 0> counted_arrays = {{}};
+}};
+@end union
+
+//========================== Struct Implementations =========================//
+
+@foreach struct
+void dump_binary_{sctName}(const {sctName}& object, const ApiDumpSettings& settings)
+{{
+    @foreach member
+        @if('{memParameterStorage}' != '' and '{memCondition}' != 'None')
+    if({memCondition})
+        {memParameterStorage}
+        @end if
+        @if('{memParameterStorage}' != '' and '{memCondition}' == 'None')
+    {memParameterStorage}
+        @end if
+    @end member
+
+    @foreach member
+        @if('{memCondition}' != 'None' and {memPtrLevel} < 2)
+    if(dump_binary_flag({memCondition}, settings))
+        @end if
+        @if({memPtrLevel} == 0)
+            @if('{memName}' != 'pNext')
+    dump_binary_{memTypeID}(object.{memName}, settings);
+            @end if
+            @if('{memName}' == 'pNext')
+    dump_binary_pNext(object.{memName}, settings);
+            @end if
+        @end if
+        @if({memPtrLevel} == 1 and '{memLength}' == 'None')
+    dump_binary_pointer<const {memBaseType}>(object.{memName}, settings, dump_binary_{memTypeID});
+        @end if
+        @if({memPtrLevel} == 1 and '{memLength}' != 'None' and not {memLengthIsMember})
+    dump_binary_array<const {memBaseType}>(object.{memName}, {memLength}, settings, dump_binary_{memTypeID});
+        @end if
+        @if({memPtrLevel} == 1 and '{memLength}' != 'None' and {memLengthIsMember} and '{memName}' != 'pCode')
+            @if('{memLength}'[0].isdigit() or '{memLength}'[0].isupper())
+    dump_binary_array<const {memBaseType}>(object.{memName}, {memLength}, settings, dump_binary_{memTypeID});
+            @end if
+            @if(not ('{memLength}'[0].isdigit() or '{memLength}'[0].isupper()))
+                @if('{memLength}' == 'rasterizationSamples')
+    dump_binary_array<const {memBaseType}>(object.{memName}, (object.{memLength} + 31) / 32, settings, dump_binary_{memTypeID});
+                @end if
+                @if('{memLength}' != 'rasterizationSamples')
+    dump_binary_array<const {memBaseType}>(object.{memName}, object.{memLength}, settings, dump_binary_{memTypeID});
+                @end if
+            @end if
+        @end if
+        @if({memPtrLevel} == 1 and '{memLength}' != 'None' and {memLengthIsMember} and '{memName}' == 'pCode')
+    dump_binary_array<const {memBaseType}>(settings.showShader() ? object.{memName} : NULL, object.{memLength}, settings, dump_binary_{memTypeID});
+        @end if
+    @end member
+}}
+@end struct
+
+//========================== Union Implementations ==========================//
+
+// The bytes of the union cover every choice which is a plain value; the choices which point to memory are written after.
+@foreach union
+void dump_binary_{unName}(const {unName}& object, const ApiDumpSettings& settings)
+{{
+    dump_binary_raw(object, settings);
+    @foreach choice
+    @if('{chcCondition}' != 'None' and ({chcPtrLevel} == 1 or '{chcTypeID}' == 'cstring' or '{chcIsStruct}' == 'true'))
+    if(dump_binary_flag({chcCondition}, settings))
+    @end if
+    @if({chcPtrLevel} == 0 and ('{chcTypeID}' == 'cstring' or '{chcIsStruct}' == 'true'))
+    dump_binary_{chcTypeID}(object.{chcName}, settings);
+    @end if
+    @if({chcPtrLevel} == 1 and '{chcLength}' == 'None')
+    dump_binary_pointer<const {chcBaseType}>(object.{chcName}, settings, dump_binary_{chcTypeID});
+    @end if
+    @if({chcPtrLevel} == 1 and '{chcLength}' != 'None')
+    dump_binary_array<const {chcBaseType}>(object.{chcName}, {chcLength}, settings, dump_binary_{chcTypeID});
+    @end if
+    @end choice
+}}
+@end union
+
+//======================== pNext Chain Implementation =======================//
+@if(not {isVideoGeneration})
+void dump_binary_pNext(const void* object, const ApiDumpSettings& settings)
+{{
+    if(object == nullptr) {{
+        dump_binary_raw<uint8_t>(API_DUMP_BINARY_PNEXT_NULL, settings);
+        return;
+    }}
+
+    const auto* base_struct = reinterpret_cast<const VkBaseInStructure*>(object);
+    switch(base_struct->sType) {{
+    @foreach struct
+        @if({sctStructureTypeIndex} != -1)
+    case {sctStructureTypeIndex}:
+        dump_binary_raw<uint8_t>(API_DUMP_BINARY_PNEXT_KNOWN, settings);
+        dump_binary_raw(base_struct->sType, settings);
+        dump_binary_{sctName}(*reinterpret_cast<const {sctName}*>(object), settings);
+        break;
+        @end if
+    @end struct
+
+    case 47: // VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO
+    case 48: // VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO
+        dump_binary_raw<uint8_t>(API_DUMP_BINARY_PNEXT_OPAQUE, settings);
+        dump_binary_raw(base_struct->sType, settings);
+        dump_binary_pNext(base_struct->pNext, settings);
+        break;
+    default:
+        // The chain isn't followed past an unknown structure.
+        dump_binary_raw<uint8_t>(API_DUMP_BINARY_PNEXT_OPAQUE, settings);
+        dump_binary_raw(base_struct->sType, settings);
+        dump_binary_pNext(nullptr, settings);
+    }}
+}}
+@end if
+//========================= Function Implementations ========================//
+
+@foreach function where('{funcName}' not in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+@if('{funcReturn}' != 'void')
+void dump_binary_{funcName}(ApiDumpInstance& dump_inst, {funcReturn} result, {funcTypedParams})
+@end if
+@if('{funcReturn}' == 'void')
+void dump_binary_{funcName}(ApiDumpInstance& dump_inst, {funcTypedParams})
+@end if
+{{
+    const ApiDumpSettings& settings(dump_inst.settings());
+
+    dump_binary_raw<uint32_t>({funcIndex}, settings);
+    @if('{funcReturn}' != 'void')
+    dump_binary_{funcReturn}(result, settings);
+    @end if
+    @foreach parameter
+    @if('{prmParameterStorage}' != '')
+    {prmParameterStorage}
+    @end if
+    @if({prmPtrLevel} == 0)
+    dump_binary_{prmTypeID}({prmName}, settings);
+    @end if
+    @if({prmPtrLevel} == 1 and '{prmLength}' == 'None')
+    dump_binary_pointer<const {prmBaseType}>({prmName}, settings, dump_binary_{prmTypeID});
+    @end if
+    @if({prmPtrLevel} == 1 and '{prmLength}' != 'None')
+    dump_binary_array<const {prmBaseType}>({prmName}, {prmLength}, settings, dump_binary_{prmTypeID});
+    @end if
+    @end parameter
+}}
+@end function
+"""
+
+BINARY_READER_CODEGEN = """
+/* Copyright (c) 2015-2023 Valve Corporation
+ * Copyright (c) 2015-2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This file is generated from the Khronos Vulkan XML API Registry.
+ */
+
+#pragma once
+
+#include "api_dump.h"
+@if(not {isVideoGeneration})
+#include "api_dump_text.h"
+#include "api_dump_html.h"
+#include "api_dump_json.h"
+@end if
+#include "api_dump_video_binary_reader.h"
+@if(not {isVideoGeneration})
+const void* read_binary_pNext(ApiDumpBinaryReader& reader);
+@end if
+@foreach union
+void read_binary_{unName}(ApiDumpBinaryReader& reader, {unName}& object);
+@end union
+
+//=========================== Type Implementations ==========================//
+
+@foreach type where('{etyName}' != 'void')
+void read_binary_{etyName}(ApiDumpBinaryReader& reader, {etyName}& object)
+{{
+    reader.raw(object);
+}}
+@end type
+
+//========================= Basetype Implementations ========================//
+
+@foreach basetype where(not '{baseName}' in ['ANativeWindow', 'AHardwareBuffer', 'CAMetalLayer'])
+void read_binary_{baseName}(ApiDumpBinaryReader& reader, {baseName}& object)
+{{
+    reader.raw(object);
+}}
+@end basetype
+@foreach basetype where('{baseName}' in ['ANativeWindow', 'AHardwareBuffer'])
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+template <typename T>
+void read_binary_{baseName}(ApiDumpBinaryReader& reader, T*& object)
+{{
+    read_binary_void(reader, object);
+}}
+#endif
+@end basetype
+@foreach basetype where('{baseName}' in ['CAMetalLayer'])
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+void read_binary_{baseName}(ApiDumpBinaryReader& reader, {baseName}& object)
+{{
+    reader.raw(object);
+}}
+#endif
+@end basetype
+
+//======================= System Type Implementations =======================//
+
+@foreach systype
+template <typename T>
+void read_binary_{sysName}(ApiDumpBinaryReader& reader, T& object)
+{{
+    reader.raw(object);
+}}
+@end systype
+
+//========================== Handle Implementations =========================//
+
+@foreach handle
+void read_binary_{hdlName}(ApiDumpBinaryReader& reader, {hdlName}& object)
+{{
+    reader.raw(object);
+}}
+@end handle
+
+//=========================== Enum Implementations ==========================//
+
+@foreach enum
+void read_binary_{enumName}(ApiDumpBinaryReader& reader, {enumName}& object)
+{{
+    reader.raw(object);
+}}
+@end enum
+
+//========================= Bitmask Implementations =========================//
+
+@foreach bitmask
+void read_binary_{bitName}(ApiDumpBinaryReader& reader, {bitName}& object)
+{{
+    reader.raw(object);
+}}
+@end bitmask
+
+//=========================== Flag Implementations ==========================//
+
+@foreach flag
+void read_binary_{flagName}(ApiDumpBinaryReader& reader, {flagName}& object)
+{{
+    reader.raw(object);
+}}
+@end flag
+
+//======================= Func Pointer Implementations ======================//
+
+@foreach funcpointer
+void read_binary_{pfnName}(ApiDumpBinaryReader& reader, {pfnName}& object)
+{{
+    reader.raw(object);
+}}
+@end funcpointer
+
+//========================== Struct Implementations =========================//
+
+// Conditions were evaluated when the capture was made, so the recorded flags are used instead of evaluating them again.
+@foreach struct
+void read_binary_{sctName}(ApiDumpBinaryReader& reader, {sctName}& object)
+{{
+    @foreach member
+        @if('{memCondition}' != 'None' and {memPtrLevel} < 2)
+    if(reader.flag())
+        @end if
+        @if({memPtrLevel} == 0)
+            @if('{memName}' == 'pNext')
+    object.{memName} = ({memType}) read_binary_pNext(reader);
+            @end if
+            @if('{memName}' != 'pNext' and '[' in '{memType}')
+    read_binary_fixed_cstring(reader, object.{memName}, sizeof(object.{memName}));
+            @end if
+            @if('{memName}' != 'pNext' and not '[' in '{memType}')
+    read_binary_{memTypeID}(reader, object.{memName});
+            @end if
+        @end if
+        @if({memPtrLevel} == 1 and '{memLength}' == 'None')
+    read_binary_pointer(reader, object.{memName}, read_binary_{memTypeID});
+        @end if
+        @if({memPtrLevel} == 1 and '{memLength}' != 'None' and '[' in '{memType}')
+    read_binary_fixed_array(reader, object.{memName}, read_binary_{memTypeID});
+        @end if
+        @if({memPtrLevel} == 1 and '{memLength}' != 'None' and not '[' in '{memType}')
+    read_binary_array(reader, object.{memName}, read_binary_{memTypeID});
+        @end if
+    @end member
+}}
+@end struct
+
+//========================== Union Implementations ==========================//
+
+// The choices of a union share their storage, so only the first structure choice is rebuilt in place and the others are
+// read past.
+@foreach union
+void read_binary_{unName}(ApiDumpBinaryReader& reader, {unName}& object)
+{{
+    reader.raw(object);
+    @foreach choice
+    @if('{chcCondition}' != 'None' and ({chcPtrLevel} == 1 or '{chcTypeID}' == 'cstring' or '{chcIsStruct}' == 'true'))
+    if(reader.flag())
+    @end if
+    @if({chcPtrLevel} == 0 and '{chcTypeID}' == 'cstring')
+    read_binary_cstring(reader, object.{chcName});
+    @end if
+    @if({chcPtrLevel} == 0 and '{chcIsStruct}' == 'true' and {chcIsFirstStruct})
+    read_binary_{chcTypeID}(reader, object.{chcName});
+    @end if
+    @if({chcPtrLevel} == 0 and '{chcIsStruct}' == 'true' and not {chcIsFirstStruct})
+    {{ {chcBaseType} unused{{}}; read_binary_{chcTypeID}(reader, unused); }}
+    @end if
+    @if({chcPtrLevel} == 1 and '{chcLength}' == 'None')
+    read_binary_pointer(reader, object.{chcName}, read_binary_{chcTypeID});
+    @end if
+    @if({chcPtrLevel} == 1 and '{chcLength}' != 'None')
+    read_binary_array(reader, object.{chcName}, read_binary_{chcTypeID});
+    @end if
+    @end choice
+}}
+@end union
+
+//======================== pNext Chain Implementation =======================//
+@if(not {isVideoGeneration})
+const void* read_binary_pNext(ApiDumpBinaryReader& reader)
+{{
+    uint8_t presence = API_DUMP_BINARY_PNEXT_NULL;
+    reader.raw(presence);
+    if(presence == API_DUMP_BINARY_PNEXT_NULL)
+        return nullptr;
+
+    VkStructureType sType = {{}};
+    reader.raw(sType);
+    if(presence == API_DUMP_BINARY_PNEXT_OPAQUE) {{
+        // Only the sType and the rest of the chain are needed to dump it as it was.
+        VkBaseInStructure* opaque = reader.allocate<VkBaseInStructure>(1);
+        const void* next = read_binary_pNext(reader);
+        if(opaque != nullptr) {{
+            opaque->sType = sType;
+            opaque->pNext = reinterpret_cast<const VkBaseInStructure*>(next);
+        }}
+        return opaque;
+    }}
+
+    switch(sType) {{
+    @foreach struct
+        @if({sctStructureTypeIndex} != -1)
+    case {sctStructureTypeIndex}: {{
+        {sctName}* object = reader.allocate<{sctName}>(1);
+        if(object != nullptr)
+            read_binary_{sctName}(reader, *object);
+        return object;
+    }}
+        @end if
+    @end struct
+    default:
+        reader.fail();
+        return nullptr;
+    }}
+}}
+@end if
+//========================= Function Implementations ========================//
+
+// Rebuilds the parameters of a call from its record, replays the state the layer tracks for it and formats it as if it
+// had just been made. A deferred call is formatted by the writer thread of the layer, which already tracked the state of
+// the call when it was made, and which writes out the output of the calling thread itself.
+@foreach function where('{funcName}' not in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+bool convert_binary_{funcName}(ApiDumpInstance& dump_inst, ApiDumpBinaryReader& reader, bool deferred)
+{{
+    @if('{funcReturn}' != 'void')
+    {funcReturn} result{{}};
+    read_binary_{funcReturn}(reader, result);
+    @end if
+    @foreach parameter
+    @if('[' in '{prmType}')
+    {prmChildType}* {prmName} = nullptr;
+    @end if
+    @if(not '[' in '{prmType}')
+    {prmType} {prmName}{{}};
+    @end if
+    @end parameter
+    @foreach parameter
+    @if({prmPtrLevel} == 0)
+    read_binary_{prmTypeID}(reader, {prmName});
+    @end if
+    @if({prmPtrLevel} == 1 and '{prmLength}' == 'None')
+    read_binary_pointer(reader, {prmName}, read_binary_{prmTypeID});
+    @end if
+    @if({prmPtrLevel} == 1 and '{prmLength}' != 'None')
+    read_binary_array(reader, {prmName}, read_binary_{prmTypeID});
+    @end if
+    @end parameter
+    if(reader.failed() || !reader.atEnd())
+        return false;
+
+    if(!deferred) {{
+        {funcStateTrackingCode}
+        @if('{funcName}' in ['vkDebugMarkerSetObjectNameEXT', 'vkSetDebugUtilsObjectNameEXT'])
+        dump_inst.update_object_name_map(pNameInfo);
+        @end if
+        if (!dump_inst.shouldDumpOutput())
+            return true;
+        dump_inst.beginOutput();
+    }}
+    switch(dump_inst.settings().format())
+    {{
+        @if('{funcReturn}' != 'void')
+        case ApiDumpFormat::Text:
+            dump_text_function_head(dump_inst, "{funcName}", "{funcNamedParams}", "{funcReturn}");
+            dump_text_{funcName}(dump_inst, result, {funcNamedParams});
+            break;
+        case ApiDumpFormat::Html:
+            dump_html_function_head(dump_inst, "{funcName}", "{funcNamedParams}", "{funcReturn}");
+            dump_html_{funcName}(dump_inst, result, {funcNamedParams});
+            break;
+        case ApiDumpFormat::Json:
+            dump_json_function_head(dump_inst, "{funcName}", "{funcReturn}");
+            dump_json_{funcName}(dump_inst, result, {funcNamedParams});
+            break;
+        @end if
+        @if('{funcReturn}' == 'void')
+        case ApiDumpFormat::Text:
+            dump_text_function_head(dump_inst, "{funcName}", "{funcNamedParams}", "{funcReturn}");
+            dump_text_{funcName}(dump_inst, {funcNamedParams});
+            break;
+        case ApiDumpFormat::Html:
+            dump_html_function_head(dump_inst, "{funcName}", "{funcNamedParams}", "{funcReturn}");
+            dump_html_{funcName}(dump_inst, {funcNamedParams});
+            break;
+        case ApiDumpFormat::Json:
+            dump_json_function_head(dump_inst, "{funcName}", "{funcReturn}");
+            dump_json_{funcName}(dump_inst, {funcNamedParams});
+            break;
+        @end if
+        case ApiDumpFormat::Binary:
+        case ApiDumpFormat::Stats:
+        case ApiDumpFormat::Trace:
+            break;
+    }}
+    if(!deferred)
+        dump_inst.endOutput();
+    return true;
+}}
+@end function
+
+@if(not {isVideoGeneration})
+// Returns false if the function index is unknown or the record doesn't match the function.
+bool convert_binary_call(ApiDumpInstance& dump_inst, uint32_t function_index, ApiDumpBinaryReader& reader, bool deferred)
+{{
+    switch(function_index) {{
+    @foreach function where('{funcName}' not in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+    case {funcIndex}:
+        return convert_binary_{funcName}(dump_inst, reader, deferred);
+    @end function
+    default:
+        return false;
+    }}
+}}
+
+// The call formatter of the writer thread when formatting is deferred. The calls are captured into binary records by the
+// threads which make them, which copies everything their parameters point to, and are only formatted here. A call which
+// failed before reaching the driver only has the head of its record, and isn't written out.
+void format_binary_record(const std::string& record, std::string& output)
+{{
+    ApiDumpInstance& dump_inst = ApiDumpInstance::current();
+    ApiDumpBinaryReader reader(record.data(), record.size());
+    output.clear();
+
+    uint64_t thread_id = 0;
+    uint64_t frame = 0;
+    int64_t time = 0;
+    uint64_t sequence = 0;
+    uint32_t function_index = 0;
+    reader.raw(thread_id);
+    reader.raw(frame);
+    reader.raw(time);
+    reader.raw(sequence);
+    if (reader.failed() || reader.atEnd())
+        return;
+    reader.raw(function_index);
+
+    dump_inst.setRecordedCallInfo(thread_id, frame, std::chrono::microseconds(time));
+    const bool converted = convert_binary_call(dump_inst, function_index, reader, true);
+    if (converted && dump_inst.settings().jsonLines())
+        dump_inst.settings().finishThreadOutputLine();
+    dump_inst.settings().takeThreadOutput(output);
+    if (!converted)
+        output.clear();
+}}
+@end if
+"""
+
+TRACE_CODEGEN = """
+/* Copyright (c) 2015-2023 Valve Corporation
+ * Copyright (c) 2015-2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * This file is generated from the Khronos Vulkan XML API Registry.
+ */
+
+#pragma once
+
+#include "api_dump.h"
+
+//========================= Function Implementations ========================//
+
+// The head of the trace event was written before the call, these add the summarized arguments and the timing to it.
+@foreach function where(not '{funcName}' in ['vkGetDeviceProcAddr', 'vkGetInstanceProcAddr'])
+@if('{funcReturn}' != 'void')
+void dump_trace_{funcName}(ApiDumpInstance& dump_inst, {funcReturn} result, {funcTypedParams})
+@end if
+@if('{funcReturn}' == 'void')
+void dump_trace_{funcName}(ApiDumpInstance& dump_inst, {funcTypedParams})
+@end if
+{{
+    const ApiDumpSettings& settings(dump_inst.settings());
+    @if('{funcReturn}' != 'void')
+    dump_trace_arg(settings, "result", result);
+    @end if
+    if(settings.showParams())
+    {{
+        @foreach parameter
+        dump_trace_arg(settings, "{prmName}", {prmName});
+        @end parameter
+    }}
+    dump_trace_function_tail(dump_inst);
+}}
+@end function
+"""
+
+POINTER_TYPES = ['void', 'xcb_connection_t', 'Display', 'SECURITY_ATTRIBUTES', 'ANativeWindow', 'AHardwareBuffer', 'wl_display', '_screen_context', '_screen_window', '_screen_buffer']
+
+# Arrays of these types are formatted in bulk by the dump_*_integer_array functions of api_dump.h rather than element by element
+INTEGER_ARRAY_TYPES = ['int8_t', 'uint8_t', 'int16_t', 'uint16_t', 'int32_t', 'uint32_t', 'int64_t', 'uint64_t', 'size_t', 'int']
+
+# Command buffers and descriptor sets are also freed along with their pool, without a call naming them, so the object
+# statistics only count their pools.
+UNCOUNTED_OBJECTS = ['VkCommandBuffer', 'VkDescriptorSet']
+
+TRACKED_STATE = {
+    'vkAllocateCommandBuffers':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().addCmdBuffers(\n' +
+                'device,\n' +
+                'pAllocateInfo->commandPool,\n' +
+                'pCommandBuffers,\n' +
+                'pAllocateInfo->commandBufferCount,\n' +
+                'pAllocateInfo->level\n'
+            ');',
+    'vkDestroyCommandPool':
+        'ApiDumpInstance::current().eraseCmdBufferPool(device, commandPool);'
+    ,
+    'vkFreeCommandBuffers':
+        'ApiDumpInstance::current().eraseCmdBuffers(device, commandPool, pCommandBuffers, commandBufferCount);'
+    ,
+    'vkBeginCommandBuffer':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().beginCmdBufferRecording(commandBuffer);'
+    ,
+    'vkCmdEndDebugUtilsLabelEXT':
+        'ApiDumpInstance::current().endLabelScope(commandBuffer);'
+    ,
+    'vkQueueEndDebugUtilsLabelEXT':
+        'ApiDumpInstance::current().endLabelScope(queue);'
+    ,
+    'vkAllocateMemory':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().countAllocatedMemory(device, pAllocateInfo, *pMemory);'
+    ,
+    'vkFreeMemory':
+        'ApiDumpInstance::current().countFreedMemory(memory);'
+    ,
+    'vkDestroyDevice':
+        'ApiDumpInstance::current().removeMemoryDevice(device);\n' +
+        'ApiDumpInstance::current().removePipelineDevice(device);\n' +
+        'ApiDumpInstance::current().removeSubmitDevice(device);'
+    ,
+    'vkQueueSubmit':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().recordSubmits(queue, submitCount, pSubmits, fence);'
+    ,
+    'vkQueueSubmit2':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().recordSubmits(queue, submitCount, pSubmits, fence);'
+    ,
+    'vkQueueSubmit2KHR':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().recordSubmits(queue, submitCount, pSubmits, fence);'
+    ,
+    'vkWaitForFences':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().recordFencesSignaled(fenceCount, pFences, waitAll == VK_TRUE || fenceCount == 1);'
+    ,
+    'vkGetFenceStatus':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().recordFencesSignaled(1, &fence, true);'
+    ,
+    'vkResetFences':
+        'ApiDumpInstance::current().forgetFences(fenceCount, pFences);'
+    ,
+    'vkDestroyFence':
+        'ApiDumpInstance::current().forgetFences(1, &fence);'
+    ,
+    'vkCreateSemaphore':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().addSemaphore(pCreateInfo, *pSemaphore);'
+    ,
+    'vkDestroySemaphore':
+        'ApiDumpInstance::current().removeSemaphore(semaphore);'
+    ,
+    'vkWaitSemaphores':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().recordSemaphoresSignaled(pWaitInfo);'
+    ,
+    'vkWaitSemaphoresKHR':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().recordSemaphoresSignaled(pWaitInfo);'
+    ,
+    'vkGetSemaphoreCounterValue':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().recordSemaphoreValue(semaphore, *pValue);'
+    ,
+    'vkGetSemaphoreCounterValueKHR':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().recordSemaphoreValue(semaphore, *pValue);'
+    ,
+    'vkQueueWaitIdle':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().recordQueueIdle(queue);'
+    ,
+    'vkDeviceWaitIdle':
+        'if(result == VK_SUCCESS)\n' +
+            'ApiDumpInstance::current().recordDeviceIdle(device);'
+    ,
+    'vkCmdBindPipeline':
+        'ApiDumpInstance::current().trackBindPipeline(commandBuffer, pipelineBindPoint, pipeline);'
+    ,
+    'vkCmdBindDescriptorSets':
+        'ApiDumpInstance::current().trackBindDescriptorSets(commandBuffer, pipelineBindPoint, layout, firstSet, ' +
+            'descriptorSetCount, pDescriptorSets, dynamicOffsetCount, pDynamicOffsets);'
+    ,
+    'vkCmdBindVertexBuffers':
+        'ApiDumpInstance::current().trackBindVertexBuffers(commandBuffer, firstBinding, bindingCount, pBuffers, pOffsets);'
+    ,
+    'vkCmdBindIndexBuffer':
+        'ApiDumpInstance::current().trackBindIndexBuffer(commandBuffer, buffer, offset, VK_WHOLE_SIZE, indexType);'
+    ,
+    'vkCmdSetViewport':
+        'ApiDumpInstance::current().trackSetViewports(commandBuffer, firstViewport, viewportCount, pViewports);'
+    ,
+    'vkCmdSetScissor':
+        'ApiDumpInstance::current().trackSetScissors(commandBuffer, firstScissor, scissorCount, pScissors);'
+    ,
+    'vkCmdExecuteCommands':
+        'ApiDumpInstance::current().forgetCmdBufferState(commandBuffer);'
+    ,
+    'vkCmdBindShadersEXT':
+        'ApiDumpInstance::current().forgetCmdBufferState(commandBuffer);'
+    ,
+}
+
+# The variants of the calls redundant_state checks which track the same state.
+for name in ['vkCmdBindVertexBuffers2', 'vkCmdBindVertexBuffers2EXT']:
+    TRACKED_STATE[name] = ('ApiDumpInstance::current().trackBindVertexBuffers(commandBuffer, firstBinding, bindingCount, ' +
+                           'pBuffers, pOffsets, pSizes, pStrides);')
+for name in ['vkCmdBindIndexBuffer2', 'vkCmdBindIndexBuffer2KHR']:
+    TRACKED_STATE[name] = 'ApiDumpInstance::current().trackBindIndexBuffer(commandBuffer, buffer, offset, size, indexType);'
+for name in ['vkCmdSetViewportWithCount', 'vkCmdSetViewportWithCountEXT']:
+    TRACKED_STATE[name] = 'ApiDumpInstance::current().trackSetViewports(commandBuffer, 0, viewportCount, pViewports, true);'
+for name in ['vkCmdSetScissorWithCount', 'vkCmdSetScissorWithCountEXT']:
+    TRACKED_STATE[name] = 'ApiDumpInstance::current().trackSetScissors(commandBuffer, 0, scissorCount, pScissors, true);'
+# The other ways of binding descriptors, whose bindings aren't compared.
+for name in ['vkCmdPushDescriptorSet', 'vkCmdPushDescriptorSetKHR', 'vkCmdPushDescriptorSetWithTemplate',
+             'vkCmdPushDescriptorSetWithTemplateKHR', 'vkCmdBindDescriptorSets2', 'vkCmdBindDescriptorSets2KHR',
+             'vkCmdPushDescriptorSet2', 'vkCmdPushDescriptorSet2KHR', 'vkCmdPushDescriptorSetWithTemplate2',
+             'vkCmdPushDescriptorSetWithTemplate2KHR', 'vkCmdBindDescriptorBuffersEXT', 'vkCmdSetDescriptorBufferOffsetsEXT',
+             'vkCmdSetDescriptorBufferOffsets2EXT', 'vkCmdBindDescriptorBufferEmbeddedSamplersEXT']:
+    TRACKED_STATE[name] = 'ApiDumpInstance::current().forgetDescriptorSets(commandBuffer);'
+
+PARAMETER_STATE = {
+    'VkPipelineViewportStateCreateInfo': {
+        'VkGraphicsPipelineCreateInfo': [
+            {
+                'name': 'is_dynamic_viewport',
+                'type': 'bool',
+                'stmt':
+                    'ApiDumpInstance::current().setIsDynamicViewport(' +
+                    'object.pDynamicState && ' +
+                    'std::count(' +
+                        'object.pDynamicState->pDynamicStates, ' +
+                        'object.pDynamicState->pDynamicStates + object.pDynamicState->dynamicStateCount, ' +
+                        'VK_DYNAMIC_STATE_VIEWPORT' +
+                    ') > 0);',
+             },
+             {
+                'name':'is_dynamic_scissor',
+                'type': 'bool',
+                'stmt':
+                    'ApiDumpInstance::current().setIsDynamicScissor(' +
+                    'object.pDynamicState && ' +
+                    'std::count(' +
+                        'object.pDynamicState->pDynamicStates, ' +
+                        'object.pDynamicState->pDynamicStates + object.pDynamicState->dynamicStateCount, ' +
+                        'VK_DYNAMIC_STATE_SCISSOR' +
+                    '));',
+            },
+        ],
+    },
+    'VkCommandBufferBeginInfo': {
+        'vkBeginCommandBuffer': [
+            {
+                'name': 'cmd_buffer',
+                'type': 'VkCommandBuffer',
+                'stmt': 'ApiDumpInstance::current().setCmdBuffer(commandBuffer);',
+            },
+        ],
+    },
+    'VkPhysicalDeviceMemoryProperties': {
+        'VkPhysicalDeviceMemoryProperties2': [
+            {
+                'name': 'memoryProperties',
+                'type': 'VkPhysicalDeviceMemoryProperties',
+                'stmt': 'ApiDumpInstance::current().setMemoryHeapCount(object.memoryProperties.memoryHeapCount);',
+            },
         ],
     },
     'VkDescriptorDataEXT': {
@@ -1713,6 +2837,7 @@ class ApiDumpGeneratorOptions(GeneratorOptions):
                  alignFuncParam = 0,
                  expandEnumerants = True,
                  isVideoGeneration = False,
+                 shardCount = 0,
                  ):
         GeneratorOptions.__init__(self,
                  conventions = conventions,
@@ -1742,6 +2867,36 @@ class ApiDumpGeneratorOptions(GeneratorOptions):
         self.indentFuncPointer = indentFuncPointer
         self.alignFuncParam  = alignFuncParam
         self.isVideoGeneration = isVideoGeneration
+        self.shardCount      = shardCount
+
+    # The files generated with these options, which are the output file and the translation units it is split into
+    def outputFiles(self):
+        name = os.path.splitext(self.filename)[0]
+        return [self.filename] + ['{}_{}.cpp'.format(name, index) for index in range(self.shardCount)]
+
+    # Hashes everything the output files are generated from, which are the registry, the scripts and the arguments
+    def generationHash(self, registryFile, scriptFiles, arguments):
+        generationHash = hashlib.sha256()
+        for filename in [registryFile] + scriptFiles:
+            with open(filename, 'rb') as inputFile:
+                generationHash.update(inputFile.read())
+        generationHash.update(repr(arguments).encode())
+        return generationHash.hexdigest()
+
+    # Whether the output files were last generated from inputs with this hash, in which case they don't need to be
+    # generated again. The hash is kept next to the output file.
+    def isGenerationCurrent(self, generationHash):
+        if not all(os.path.exists(os.path.join(self.directory, filename)) for filename in self.outputFiles()):
+            return False
+        try:
+            with open(os.path.join(self.directory, self.filename + '.hash'), encoding='utf-8') as hashFile:
+                return hashFile.read().strip() == generationHash
+        except OSError:
+            return False
+
+    def saveGenerationHash(self, generationHash):
+        with open(os.path.join(self.directory, self.filename + '.hash'), 'w', encoding='utf-8') as hashFile:
+            hashFile.write(generationHash + '\n')
 
 
 class ApiDumpOutputGenerator(OutputGenerator):
@@ -1754,6 +2909,10 @@ class ApiDumpOutputGenerator(OutputGenerator):
         gen.OutputGenerator.__init__(self, errFile, warnFile, diagFile)
         self.format = None
         self.isVideoGeneration = False
+        self.shardCount = 0
+        self.filename = None
+        self.directory = None
+        self.outputFiles = []
 
         self.constants = {}
         self.extensions = {}
@@ -1777,9 +2936,16 @@ class ApiDumpOutputGenerator(OutputGenerator):
         self.registryFile = registryFile
 
     def beginFile(self, genOpts):
-        gen.OutputGenerator.beginFile(self, genOpts)
+        # The output files are written by endFile, which leaves the ones whose contents did not change untouched
+        outputOpts = copy.copy(genOpts)
+        outputOpts.filename = None
+        gen.OutputGenerator.beginFile(self, outputOpts)
         self.format = genOpts.input
         self.isVideoGeneration = genOpts.isVideoGeneration
+        self.shardCount = genOpts.shardCount
+        self.filename = genOpts.filename
+        self.directory = genOpts.directory
+        self.outputFiles = genOpts.outputFiles()
 
         if self.registryFile is not None:
             root = xml.etree.ElementTree.parse(self.registryFile)
@@ -1839,6 +3005,12 @@ class ApiDumpOutputGenerator(OutputGenerator):
                     variable.is_struct = True
                 if variable.typeID in self.unions:
                     variable.is_union = True
+                # The call filter looks at the handles a function takes or returns
+                if variable.typeID in self.handles or self.aliases.get(variable.typeID) in self.handles:
+                    variable.is_handle = True
+                    variable.handle_index = self.handles[self.aliases.get(variable.typeID, variable.typeID)].index
+            value.objectTrackingCode = objectTrackingCode(value)
+            value.commandSummaryCode = commandSummaryCode(value)
         for value in self.structs.values():
             for variable in value.members:
                 if variable.typeID in self.structs:
@@ -1851,6 +3023,11 @@ class ApiDumpOutputGenerator(OutputGenerator):
                     variable.is_struct = True
                 if variable.typeID in self.unions:
                     variable.is_union = True
+            # The binary reader can only rebuild one of the overlapping structure choices in place
+            for variable in value.choices:
+                if variable.is_struct and variable.pointerLevels == 0:
+                    variable.is_first_struct = True
+                    break
 
         # Replace any types that are aliases with the non-aliased type
         for struct in self.structs.values():
@@ -1858,6 +3035,31 @@ class ApiDumpOutputGenerator(OutputGenerator):
                 if member.typeID in self.aliases:
                     member.typeID = self.aliases[member.typeID]
 
+        # The capture traits of the binary format. A type of the other registry, such as a video struct member of a Vulkan
+        # struct, is assumed to hold no pointer.
+        flatness = {}
+        def isFlat(name):
+            if name not in flatness:
+                variables = self.structs[name].members if name in self.structs else self.unions[name].choices
+                flatness[name] = all('*' not in variable.text and
+                                     (variable.typeID not in self.structs and variable.typeID not in self.unions or isFlat(variable.typeID))
+                                     for variable in variables)
+            return flatness[name]
+
+        for struct in self.structs.values():
+            struct.isFlat = isFlat(struct.name)
+            struct.hasPNext = any(member.name == 'pNext' for member in struct.members)
+            # Only the arrays counted by a member are listed, the other lengths are expressions evaluated by the dump code
+            memberNames = [member.name for member in struct.members]
+            struct.countedArrays = []
+            for member in struct.members:
+                if '*' in member.text and member.lengthMember and member.arrayLength in memberNames:
+                    elementSize = '1' if member.typeID == 'void' else 'sizeof({})'.format(member.childType)
+                    struct.countedArrays.append('{{offsetof({0}, {1}), offsetof({0}, {2}), sizeof({0}::{2}), {3}}}'.format(
+                        struct.name, member.name, member.arrayLength, elementSize))
+        for union in self.unions.values():
+            union.isFlat = isFlat(union.name)
+
 
         # Find every @foreach, @if, and @end
         forIter = re.finditer('(^\\s*\\@foreach\\s+[a-z]+(\\s+where\\(.*\\))?\\s*^)|(\\@foreach [a-z]+(\\s+where\\(.*\\))?\\b)', self.format, flags=re.MULTILINE)
@@ -1931,20 +3133,136 @@ class ApiDumpOutputGenerator(OutputGenerator):
 
         # Expand each loop into its full form
         lastIndex = 0
+        parts = []
         for _, loop in loops:
-            gen.write(self.format[lastIndex:loop.startPos[0]].format(**{}), file=self.outFile)
-            gen.write(self.expand(loop), file=self.outFile)
+            parts.append(self.format[lastIndex:loop.startPos[0]].format(**{}))
+            parts.append(self.expand(loop))
             lastIndex = loop.endPos[1]
-        gen.write(self.format[lastIndex:-1].format(**{}), file=self.outFile)
+        parts.append(self.format[lastIndex:-1].format(**{}))
+        text = '\n'.join(parts)
+
+        if self.shardCount > 0:
+            text = self.writeShards(text)
+        self.writeFile(self.filename, text + '\n')
 
         gen.OutputGenerator.endFile(self)
 
+    # Writes a generated file, unless it already has these contents. Keeping the timestamps of the files which did not
+    # change means that a build doesn't recompile anything which depends on them.
+    def writeFile(self, filename, text):
+        path = os.path.join(self.directory, filename)
+        try:
+            with open(path, encoding='utf-8', newline='') as existingFile:
+                if existingFile.read() == text:
+                    return
+        except OSError:
+            pass
+        with open(path, 'w', encoding='utf-8', newline='\n') as outputFile:
+            outputFile.write(text)
+
+    # Moves the function definitions of the generated text into shardCount translation units and returns the
+    # text left for the header, which declares the moved functions in their place. Each function goes to the
+    # unit picked by a hash of its name, so the units stay balanced and a function keeps its unit when others
+    # are added or removed by a registry update.
+    def writeShards(self, text):
+        definition = re.compile('^(?!static |inline |template)[A-Za-z_][\\w:<>&* ]* (\\w+)\\(.*\\)\\s*(\\{\\s*)?$')
+        lines = text.split('\n')
+        header = []
+        shards = [[] for _ in range(self.shardCount)]
+        guards = []
+        depth = 0
+        inComment = False
+        i = 0
+        while i < len(lines):
+            line = lines[i]
+            match = definition.match(line) if depth == 0 and not inComment else None
+            if match is not None and (match.group(2) is not None or (i + 1 < len(lines) and lines[i + 1].startswith('{'))):
+                # Copy the definition up to the brace which closes its body
+                bodyDepth = 0
+                end = i
+                while True:
+                    delta, inComment = self.braceDepthChange(lines[end], inComment)
+                    bodyDepth += delta
+                    if bodyDepth == 0 and (end > i or match.group(2) is not None) and '}' in lines[end]:
+                        break
+                    end += 1
+                header.append(line.rstrip(' {') + ';')
+                shard = shards[zlib.crc32(match.group(1).encode()) % self.shardCount]
+                shard.append(([list(guard) for guard in guards], lines[i:end + 1]))
+                i = end + 1
+                continue
+
+            # Functions inside of preprocessor conditionals are moved along with the conditionals
+            if depth == 0 and not inComment and line.startswith('#'):
+                directive = line[1:].split()[0] if len(line) > 1 else ''
+                if directive.startswith('if'):
+                    guards.append([line])
+                elif directive in ('elif', 'else'):
+                    guards[-1].append(line)
+                elif directive == 'endif':
+                    guards.pop()
+
+            delta, inComment = self.braceDepthChange(line, inComment)
+            depth += delta
+            header.append(line)
+            i += 1
+
+        # The shards keep the leading comments of the header, and include it in place of the moved definitions
+        pragma = header.index('#pragma once')
+        prefix = '\n'.join(header[:pragma] + ['#include "{}"'.format(self.filename)])
+        for filename, shard in zip(self.outputFiles[1:], shards):
+            out = [prefix]
+            openGuards = []
+            for definitionGuards, body in shard:
+                if definitionGuards != openGuards:
+                    out += ['#endif'] * len(openGuards)
+                    out += [''] + [line for guard in definitionGuards for line in guard]
+                    openGuards = definitionGuards
+                else:
+                    out.append('')
+                out += body
+            out += ['#endif'] * len(openGuards)
+            self.writeFile(filename, '\n'.join(out) + '\n')
+
+        return '\n'.join(header)
+
+    # Returns how much a line of the generated code changes the brace depth by, skipping over string and character
+    # literals and comments, along with whether the line ends inside of a block comment.
+    def braceDepthChange(self, line, inComment):
+        delta = 0
+        i = 0
+        while i < len(line):
+            if inComment:
+                end = line.find('*/', i)
+                if end < 0:
+                    return (delta, True)
+                inComment = False
+                i = end + 2
+                continue
+            c = line[i]
+            if c == '/' and line.startswith('//', i):
+                break
+            elif c == '/' and line.startswith('/*', i):
+                inComment = True
+                i += 2
+                continue
+            elif c == '"' or c == "'":
+                i += 1
+                while i < len(line) and line[i] != c:
+                    i += 2 if line[i] == '\\' else 1
+            elif c == '{':
+                delta += 1
+            elif c == '}':
+                delta -= 1
+            i += 1
+        return (delta, inComment)
+
     def genCmd(self, cmd, name, alias):
         gen.OutputGenerator.genCmd(self, cmd, name, alias)
 
         if name == "vkEnumerateInstanceVersion": return # TODO: Create exclusion list or metadata to indicate this
 
-        self.functions[cmd.elem.get('name')] = VulkanFunction(cmd.elem, self.constants, self.aliases, self.extFuncs)
+        self.functions[cmd.elem.get('name')] = VulkanFunction(cmd.elem, self.constants, self.aliases, self.extFuncs, len(self.functions))
 
     # These are actually constants
     def genEnum(self, enuminfo, name, alias):
@@ -1982,7 +3300,7 @@ class ApiDumpOutputGenerator(OutputGenerator):
             else:
                 self.externalTypes[typeinfo.elem.get('name')] = VulkanExternalType(typeinfo.elem)
         elif typeinfo.elem.get('category') == 'handle':
-            self.handles[typeinfo.elem.get('name')] = VulkanHandle(typeinfo.elem)
+            self.handles[typeinfo.elem.get('name')] = VulkanHandle(typeinfo.elem, len(self.handles))
         elif typeinfo.elem.get('category') == 'union':
             self.unions[typeinfo.elem.get('name')] = VulkanUnion(typeinfo.elem, self.constants)
         elif typeinfo.elem.get('category') == 'bitmask':
@@ -2036,17 +3354,20 @@ class ApiDumpOutputGenerator(OutputGenerator):
         if type(subjects) is dict:
             subjects = subjects.values()
 
+        # The parent values override the item values, and are the same for every item
+        parentValues = {'isVideoGeneration' : str(self.isVideoGeneration)}
+        for parent in parents:
+            parentValues.update(parent.values())
+
         for item in subjects:
 
             # Merge the values and the parent values
             values = item.values().copy()
-            values.update({'isVideoGeneration' : str(self.isVideoGeneration)})
-            for parent in parents:
-                values.update(parent.values())
+            values.update(parentValues)
 
             # Check if the condition is met
-            if loop.condition is not None:
-                cond = eval(loop.condition.format(**values))
+            if loop.predicate is not None:
+                cond = loop.predicate(values)
                 assert(cond == True or cond == False)
                 if not cond:
                     continue
@@ -2064,12 +3385,10 @@ class ApiDumpOutputGenerator(OutputGenerator):
                 out += '#if defined({})\n'.format(ext.guard)
 
             # Format the string
-            lastIndex = loop.startPos[1]
-            for child in loop.children:
-                out += loop.fullString[lastIndex:child.startPos[0]].format(**values)
+            for segment, child in zip(loop.segments, loop.children):
+                out += segment.format_map(values)
                 out += self.expand(child, parents=[item]+parents)
-                lastIndex = child.endPos[1]
-            out += loop.fullString[lastIndex:loop.endPos[0]].format(**values)
+            out += loop.segments[-1].format_map(values)
 
             # Close the ifdef
             if ext is not None and ext.guard is not None:
@@ -2103,7 +3422,39 @@ class Control:
         self.endPos = end
         self.text = text
         self.condition = condition
+        self.predicate = None if condition is None else compileCondition(condition)
         self.children = []
+        self._segments = None
+
+    @property
+    def segments(self):
+        # The text around the children, which is the same for every item the control is expanded for
+        if self._segments is None:
+            bounds = [self.startPos[1]] + [pos for child in self.children for pos in (child.startPos[0], child.endPos[1])] + [self.endPos[0]]
+            self._segments = [self.fullString[bounds[i]:bounds[i + 1]] for i in range(0, len(bounds), 2)]
+        return self._segments
+
+# Conditions are compiled once into a function of the values instead of being formatted and evaluated for every item.
+# A quoted placeholder is formatted into its string, and a bare one is evaluated as the python literal it is written as.
+_compiledConditions = {}
+
+@functools.lru_cache(maxsize=None)
+def evalConditionLiteral(text):
+    return eval(text)
+
+def conditionLiteral(value):
+    return value if type(value) in (bool, int) else evalConditionLiteral(str(value))
+
+def compileCondition(condition):
+    if condition not in _compiledConditions:
+        source = ''
+        for token in re.split('(\'[^\']*\'|"[^"]*")', condition):
+            if token[:1] in ('\'', '"'):
+                source += token + ('.format_map(v)' if '{' in token else '')
+            else:
+                source += re.sub('\\{(\\w+)\\}', 'conditionLiteral(v[\'\\1\'])', token)
+        _compiledConditions[condition] = eval('lambda v: (' + source + ')')
+    return _compiledConditions[condition]
 
 # Base class for VulkanStruct.Member and VulkanStruct.Parameter
 class VulkanVariable:
@@ -2183,8 +3534,12 @@ class VulkanVariable:
             for states in PARAMETER_STATE[self.typeID][parentName]:
                 self.parameterStorage += states['stmt']
 
+        self.arrayKind = 'integer_array' if self.typeID in INTEGER_ARRAY_TYPES else 'array'
+
         self.is_struct = False
         self.is_union = False
+        self.is_handle = False
+        self.handle_index = None
 
 class VulkanBasetype:
 
@@ -2227,8 +3582,72 @@ class VulkanBitmask:
             'bitName': self.name,
             'bitType': self.type,
             'bitWidth': self.width,
+            'bitOptionCount': len(self.options),
         }
 
+# The statements which count the objects a function creates or destroys, for the object statistics. The last parameter of
+# the create functions is what they return, and the last handle of the destroy functions is what they destroy.
+def objectTrackingCode(function):
+    if function.name in ['vkCreateInstance', 'vkCreateDevice']:
+        return ''
+    if function.name in ['vkDestroyInstance', 'vkDestroyDevice']:
+        return 'ApiDumpInstance::current().countDestroyedOwner(get_dispatch_key(%s));' % function.parameters[0].name
+    key = 'get_dispatch_key(%s)' % function.parameters[0].name
+
+    if function.name.startswith(('vkCreate', 'vkAllocate')) and function.returnType == 'VkResult':
+        created = function.parameters[-1]
+        if not created.is_handle or created.pointerLevels != 1 or created.typeID in UNCOUNTED_OBJECTS:
+            return ''
+        count = created.arrayLength if created.arrayLength is not None else '1'
+        return ('if (result >= VK_SUCCESS) ApiDumpInstance::current().countCreatedObjects(%s, %d, %s, %s);' %
+                (key, created.handle_index, created.name, count))
+
+    if function.name.startswith(('vkDestroy', 'vkFree')):
+        handles = [param for param in function.parameters[1:] if param.is_handle]
+        if len(handles) == 0 or handles[-1].typeID in UNCOUNTED_OBJECTS:
+            return ''
+        destroyed = handles[-1]
+        if destroyed.pointerLevels == 0:
+            return ('ApiDumpInstance::current().countDestroyedObjects(%s, %d, &%s, 1);' %
+                    (key, destroyed.handle_index, destroyed.name))
+        if destroyed.pointerLevels == 1 and destroyed.arrayLength is not None:
+            return ('ApiDumpInstance::current().countDestroyedObjects(%s, %d, %s, %s);' %
+                    (key, destroyed.handle_index, destroyed.name, destroyed.arrayLength))
+    return ''
+
+# The kind of command each vkCmd* call counts as in the command buffer summary, tried in order on the name of the call.
+COMMAND_SUMMARY_KINDS = [
+    (('vkCmdDrawIndirect', 'vkCmdDrawIndexedIndirect', 'vkCmdDrawMeshTasksIndirect', 'vkCmdDrawClusterIndirect'),
+     'DrawIndirect'),
+    (('vkCmdDrawIndexed', 'vkCmdDrawMultiIndexed'), 'DrawIndexed'),
+    (('vkCmdDraw',), 'Draw'),
+    (('vkCmdDispatch',), 'Dispatch'),
+    (('vkCmdTraceRays',), 'TraceRays'),
+    (('vkCmdPipelineBarrier', 'vkCmdWaitEvents'), 'Barrier'),
+    (('vkCmdBind', 'vkCmdPushDescriptorSet', 'vkCmdSetDescriptorBufferOffsets'), 'Bind'),
+    (('vkCmdPushConstants',), 'PushConstants'),
+    (('vkCmdBeginRenderPass', 'vkCmdBeginRendering'), 'RenderPass'),
+    (('vkCmdBeginQuery', 'vkCmdEndQuery', 'vkCmdResetQueryPool', 'vkCmdWriteTimestamp', 'vkCmdCopyQueryPoolResults'),
+     'Query'),
+    (('vkCmdClear', 'vkCmdFillBuffer'), 'Clear'),
+    (('vkCmdCopy', 'vkCmdBlit', 'vkCmdResolve', 'vkCmdUpdateBuffer'), 'Copy'),
+]
+
+# The statement which counts a vkCmd* call for the command buffer summary. Only the direct draws say how many vertices
+# and instances they draw.
+def commandSummaryCode(function):
+    if not function.name.startswith('vkCmd'):
+        return ''
+    kind = next((kind for prefixes, kind in COMMAND_SUMMARY_KINDS if function.name.startswith(prefixes)), 'Other')
+    counts = ''
+    if function.name == 'vkCmdDraw':
+        counts = ', vertexCount, instanceCount'
+    elif function.name == 'vkCmdDrawIndexed':
+        counts = ', indexCount, instanceCount'
+    return ('if (ApiDumpInstance::current().settings().commandBufferSummary()) '
+            'ApiDumpInstance::current().countCommand(%s, ApiDumpCommandKind::%s%s);' %
+            (function.parameters[0].name, kind, counts))
+
 def isPow2(num):
     return num != 0 and ((num & (num - 1)) == 0)
 
@@ -2262,6 +3681,8 @@ class VulkanEnum:
                 'optValue': self.value,
                 'optComment': self.comment,
                 'optMultiValue': self.multiValue,
+                'optExact': 'true' if self.multiValue is not None else 'false',
+                'optLength': len(self.name),
             }
 
     def __init__(self, rootNode, extensions):
@@ -2318,10 +3739,14 @@ class VulkanEnum:
                     continue
                 self.options.append(VulkanEnum.Option(childName, childValue, None, None))
 
+        # The name tables are searched by value
+        self.options.sort(key=lambda o: StrToInt(str(o.value)))
+
     def values(self):
         return {
             'enumName': self.name,
             'enumType': self.type,
+            'enumOptionCount': len(self.options),
         }
 
 class VulkanExtension:
@@ -2423,14 +3848,17 @@ class VulkanFunction:
                 'prmChildType': self.childType,
                 'prmPtrLevel': self.pointerLevels,
                 'prmLength': self.arrayLength,
+                'prmArrayKind': self.arrayKind,
                 'prmParameterStorage': self.parameterStorage,
                 'prmIndex': self.index,
                 'prmIsStruct': 'true' if self.is_struct else 'false',
-                'prmIsUnion': 'true' if self.is_union else 'false'
+                'prmIsUnion': 'true' if self.is_union else 'false',
+                'prmIsHandle': 'true' if self.is_handle else 'false'
             }
 
-    def __init__(self, rootNode, constants, aliases, extensions):
+    def __init__(self, rootNode, constants, aliases, extensions, index):
         self.name = rootNode.find('proto').find('name').text
+        self.index = index                      # Identifies the function in binary captures
         self.returnType = rootNode.find('proto').find('type').text
 
         self.parameters = []
@@ -2456,6 +3884,8 @@ class VulkanFunction:
         self.stateTrackingCode = ''
         if self.name in TRACKED_STATE:
             self.stateTrackingCode = TRACKED_STATE[self.name]
+        self.objectTrackingCode = ''
+        self.commandSummaryCode = ''
 
     def values(self):
         return {
@@ -2468,6 +3898,10 @@ class VulkanFunction:
             'funcDispatchParam': self.parameters[0].name,
             'funcDispatchType' : self.dispatchType,
             'funcStateTrackingCode': self.stateTrackingCode,
+            'funcObjectTrackingCode': self.objectTrackingCode,
+            'funcCommandSummaryCode': self.commandSummaryCode,
+            'funcIndex': self.index,
+            'funcFrameDelimiter': FRAME_DELIMITER_API_CALLS.get(self.name, 'None'),
         }
 
 class VulkanFunctionPointer:
@@ -2482,16 +3916,18 @@ class VulkanFunctionPointer:
 
 class VulkanHandle:
 
-    def __init__(self, rootNode):
+    def __init__(self, rootNode, index):
         self.name = rootNode.get('name')
         self.type = rootNode.get('type')
         self.parent = rootNode.get('parent')
+        self.index = index                      # Identifies the handle type in the object statistics
 
     def values(self):
         return {
             'hdlName': self.name,
             'hdlType': self.type,
             'hdlParent': self.parent,
+            'hdlIndex': self.index,
         }
 
 class VulkanStruct:
@@ -2517,6 +3953,7 @@ class VulkanStruct:
                 'memChildType': self.childType,
                 'memPtrLevel': self.pointerLevels,
                 'memLength': self.arrayLength,
+                'memArrayKind': self.arrayKind,
                 'memLengthIsMember': self.lengthMember,
                 'memCondition': self.condition,
                 'memParameterStorage': self.parameterStorage,
@@ -2537,6 +3974,11 @@ class VulkanStruct:
 
         self.structureIndex = -1
 
+        # Set by the output generator once every struct and union is known
+        self.isFlat = False
+        self.hasPNext = False
+        self.countedArrays = []
+
         for member in self.members:
             if(member.structValues is not None):
                 for opt in enums['VkStructureType'].options:
@@ -2571,6 +4013,10 @@ class VulkanStruct:
         return {
             'sctName': self.name,
             'sctStructureTypeIndex': self.structureIndex,
+            'sctIsFlat': 'true' if self.isFlat else 'false',
+            'sctHasPNext': 'true' if self.hasPNext else 'false',
+            'sctCountedArrayCount': len(self.countedArrays),
+            'sctCountedArrays': '{{{{{}}}}}'.format(', '.join(self.countedArrays)) if self.countedArrays else '{}',
         }
 
 class VulkanSystemType:
@@ -2602,6 +4048,7 @@ class VulkanUnion:
         def __init__(self, rootNode, constants, parentName, index):
             VulkanVariable.__init__(self, rootNode, constants, None, parentName)
             self.index = index
+            self.is_first_struct = False
 
              # Search for a member condition
             self.condition = None
@@ -2617,11 +4064,13 @@ class VulkanUnion:
                 'chcChildType': self.childType,
                 'chcPtrLevel': self.pointerLevels,
                 'chcLength': self.arrayLength,
+                'chcArrayKind': self.arrayKind,
                 'chcCondition': self.condition,
                 #'chcLengthIsMember': self.lengthMember,
                 'chcIndex': self.index,
                 'chcIsStruct': 'true' if self.is_struct else 'false',
                 'chcIsUnion': 'true' if self.is_union else 'false',
+                'chcIsFirstStruct': self.is_first_struct,
             }
 
     def __init__(self, rootNode, constants):
@@ -2632,7 +4081,11 @@ class VulkanUnion:
             self.choices.append(VulkanUnion.Choice(node, constants, self.name, index))
             index = index + 1
 
+        # Set by the output generator once every struct and union is known
+        self.isFlat = False
+
     def values(self):
         return {
             'unName': self.name,
+            'unIsFlat': 'true' if self.isFlat else 'false',
         }
@@ -179,7 +179,8 @@ def makeGenOpts(args):
             apientry          = 'VKAPI_CALL ',
             apientryp         = 'VKAPI_PTR *',
             alignFuncParam    = 48,
-            expandEnumerants  = False)
+            expandEnumerants  = False,
+            shardCount        = args.apiDumpShards)
     ]
 
     # API dump generator options for api_dump_video_text.h
@@ -209,7 +210,8 @@ def makeGenOpts(args):
             apientryp         = 'VKAPI_PTR *',
             alignFuncParam    = 48,
             expandEnumerants  = False,
-            isVideoGeneration = True)
+            isVideoGeneration = True,
+            shardCount        = args.apiDumpShards)
     ]
 
     # API dump generator options for api_dump_html.h
@@ -238,7 +240,8 @@ def makeGenOpts(args):
             apientry          = 'VKAPI_CALL ',
             apientryp         = 'VKAPI_PTR *',
             alignFuncParam    = 48,
-            expandEnumerants  = False)
+            expandEnumerants  = False,
+            shardCount        = args.apiDumpShards)
     ]
 
      # API dump generator options for api_dump_video_html.h
@@ -268,7 +271,8 @@ def makeGenOpts(args):
             apientryp         = 'VKAPI_PTR *',
             alignFuncParam    = 48,
             expandEnumerants  = False,
-            isVideoGeneration = True)
+            isVideoGeneration = True,
+            shardCount        = args.apiDumpShards)
     ]
 
     # API dump generator options for api_dump_json.h
@@ -297,7 +301,8 @@ def makeGenOpts(args):
             apientry          = 'VKAPI_CALL ',
             apientryp         = 'VKAPI_PTR *',
             alignFuncParam    = 48,
-            expandEnumerants  = False)
+            expandEnumerants  = False,
+            shardCount        = args.apiDumpShards)
     ]
 
     # API dump generator options for api_dump_video_json.h
@@ -327,7 +332,160 @@ def makeGenOpts(args):
             apientryp         = 'VKAPI_PTR *',
             alignFuncParam    = 48,
             expandEnumerants  = False,
-            isVideoGeneration = True)
+            isVideoGeneration = True,
+            shardCount        = args.apiDumpShards)
+    ]
+
+    # API dump generator options for api_dump_binary.h
+    genOpts['api_dump_binary.h'] = [
+        ApiDumpOutputGenerator,
+        ApiDumpGeneratorOptions(
+            conventions       = conventions,
+            input             = BINARY_CODEGEN,
+            filename          = 'api_dump_binary.h',
+            apiname           = 'vulkan',
+            genpath           = None,
+            profile           = None,
+            versions          = featuresPat,
+            emitversions      = featuresPat,
+            defaultExtensions = 'vulkan',
+            addExtensions     = addExtensionsPat,
+            removeExtensions  = removeExtensionsPat,
+            emitExtensions    = emitExtensionsPat,
+            prefixText        = prefixStrings + vkPrefixStrings,
+            genFuncPointers   = True,
+            protectFile       = protect,
+            protectFeature    = False,
+            protectProto      = None,
+            protectProtoStr   = 'VK_NO_PROTOTYPES',
+            apicall           = 'VKAPI_ATTR ',
+            apientry          = 'VKAPI_CALL ',
+            apientryp         = 'VKAPI_PTR *',
+            alignFuncParam    = 48,
+            expandEnumerants  = False,
+            shardCount        = args.apiDumpShards)
+    ]
+
+    # API dump generator options for api_dump_video_binary.h
+    genOpts['api_dump_video_binary.h'] = [
+        ApiDumpOutputGenerator,
+        ApiDumpGeneratorOptions(
+            conventions       = conventions,
+            input             = BINARY_CODEGEN,
+            filename          = 'api_dump_video_binary.h',
+            apiname           = 'vulkan',
+            genpath           = None,
+            profile           = None,
+            versions          = featuresPat,
+            emitversions      = featuresPat,
+            defaultExtensions = 'vulkan',
+            addExtensions     = addExtensionsPat,
+            removeExtensions  = removeExtensionsPat,
+            emitExtensions    = emitExtensionsPat,
+            prefixText        = prefixStrings + vkPrefixStrings,
+            genFuncPointers   = True,
+            protectFile       = protect,
+            protectFeature    = False,
+            protectProto      = None,
+            protectProtoStr   = 'VK_NO_PROTOTYPES',
+            apicall           = 'VKAPI_ATTR ',
+            apientry          = 'VKAPI_CALL ',
+            apientryp         = 'VKAPI_PTR *',
+            alignFuncParam    = 48,
+            expandEnumerants  = False,
+            isVideoGeneration = True,
+            shardCount        = args.apiDumpShards)
+    ]
+
+    # API dump generator options for api_dump_binary_reader.h
+    genOpts['api_dump_binary_reader.h'] = [
+        ApiDumpOutputGenerator,
+        ApiDumpGeneratorOptions(
+            conventions       = conventions,
+            input             = BINARY_READER_CODEGEN,
+            filename          = 'api_dump_binary_reader.h',
+            apiname           = 'vulkan',
+            genpath           = None,
+            profile           = None,
+            versions          = featuresPat,
+            emitversions      = featuresPat,
+            defaultExtensions = 'vulkan',
+            addExtensions     = addExtensionsPat,
+            removeExtensions  = removeExtensionsPat,
+            emitExtensions    = emitExtensionsPat,
+            prefixText        = prefixStrings + vkPrefixStrings,
+            genFuncPointers   = True,
+            protectFile       = protect,
+            protectFeature    = False,
+            protectProto      = None,
+            protectProtoStr   = 'VK_NO_PROTOTYPES',
+            apicall           = 'VKAPI_ATTR ',
+            apientry          = 'VKAPI_CALL ',
+            apientryp         = 'VKAPI_PTR *',
+            alignFuncParam    = 48,
+            expandEnumerants  = False,
+            shardCount        = args.apiDumpShards)
+    ]
+
+    # API dump generator options for api_dump_video_binary_reader.h
+    genOpts['api_dump_video_binary_reader.h'] = [
+        ApiDumpOutputGenerator,
+        ApiDumpGeneratorOptions(
+            conventions       = conventions,
+            input             = BINARY_READER_CODEGEN,
+            filename          = 'api_dump_video_binary_reader.h',
+            apiname           = 'vulkan',
+            genpath           = None,
+            profile           = None,
+            versions          = featuresPat,
+            emitversions      = featuresPat,
+            defaultExtensions = 'vulkan',
+            addExtensions     = addExtensionsPat,
+            removeExtensions  = removeExtensionsPat,
+            emitExtensions    = emitExtensionsPat,
+            prefixText        = prefixStrings + vkPrefixStrings,
+            genFuncPointers   = True,
+            protectFile       = protect,
+            protectFeature    = False,
+            protectProto      = None,
+            protectProtoStr   = 'VK_NO_PROTOTYPES',
+            apicall           = 'VKAPI_ATTR ',
+            apientry          = 'VKAPI_CALL ',
+            apientryp         = 'VKAPI_PTR *',
+            alignFuncParam    = 48,
+            expandEnumerants  = False,
+            isVideoGeneration = True,
+            shardCount        = args.apiDumpShards)
+    ]
+
+    # API dump generator options for api_dump_trace.h
+    genOpts['api_dump_trace.h'] = [
+        ApiDumpOutputGenerator,
+        ApiDumpGeneratorOptions(
+            conventions       = conventions,
+            input             = TRACE_CODEGEN,
+            filename          = 'api_dump_trace.h',
+            apiname           = 'vulkan',
+            genpath           = None,
+            profile           = None,
+            versions          = featuresPat,
+            emitversions      = featuresPat,
+            defaultExtensions = 'vulkan',
+            addExtensions     = addExtensionsPat,
+            removeExtensions  = removeExtensionsPat,
+            emitExtensions    = emitExtensionsPat,
+            prefixText        = prefixStrings + vkPrefixStrings,
+            genFuncPointers   = True,
+            protectFile       = protect,
+            protectFeature    = False,
+            protectProto      = None,
+            protectProtoStr   = 'VK_NO_PROTOTYPES',
+            apicall           = 'VKAPI_ATTR ',
+            apientry          = 'VKAPI_CALL ',
+            apientryp         = 'VKAPI_PTR *',
+            alignFuncParam    = 48,
+            expandEnumerants  = False,
+            shardCount        = args.apiDumpShards)
     ]
 
 
@@ -466,6 +624,8 @@ if __name__ == '__main__':
                         help='Enable group validation')
     parser.add_argument('-genpath', action='store', default='gen',
                         help='Path to generated files')
+    parser.add_argument('-apiDumpShards', action='store', type=int, default=0,
+                        help='Split the api_dump output formats into this many translation units')
     parser.add_argument('-o', action='store', dest='directory',
                         default='.',
                         help='Create target and related files in specified directory')
@@ -490,7 +650,7 @@ if __name__ == '__main__':
 
     # VulkanTools generator additions
     from tool_helper_file_generator import ToolHelperFileOutputGenerator, ToolHelperFileOutputGeneratorOptions
-    from api_dump_generator import ApiDumpGeneratorOptions, ApiDumpOutputGenerator, COMMON_CODEGEN, TEXT_CODEGEN, HTML_CODEGEN, JSON_CODEGEN
+    from api_dump_generator import ApiDumpGeneratorOptions, ApiDumpOutputGenerator, COMMON_CODEGEN, TEXT_CODEGEN, HTML_CODEGEN, JSON_CODEGEN, BINARY_CODEGEN, BINARY_READER_CODEGEN, TRACE_CODEGEN
     from vkconventions import VulkanConventions
 
     # This splits arguments which are space-separated lists
@@ -511,6 +671,17 @@ if __name__ == '__main__':
     # Create the API generator & generator options
     (gen, options) = genTarget(args)
 
+    # The api_dump files are only generated again when something they are generated from has changed. Otherwise they
+    # are left untouched, so that the build doesn't recompile what depends on them.
+    generationHash = None
+    if isinstance(options, ApiDumpGeneratorOptions):
+        scriptFiles = [sys.modules[name].__file__ for name in ['__main__', 'reg', 'generator', 'common_codegen', 'api_dump_generator']]
+        generationHash = options.generationHash(args.registry, scriptFiles, sys.argv[1:])
+        if options.isGenerationCurrent(generationHash):
+            if not args.quiet:
+                write('* Up to date', options.filename, file=sys.stderr)
+            sys.exit(0)
+
     # Create the registry object with the specified generator and generator
     # options. The options are set before XML loading as they may affect it.
     reg = Registry(gen, options)
@@ -540,5 +711,8 @@ if __name__ == '__main__':
         reg.apiGen()
         endTimer(args.time, '* Time to generate ' + options.filename + ' =')
 
+    if generationHash is not None:
+        options.saveGenerationHash(generationHash)
+
     if not args.quiet:
         write('* Generated ', options.filename, file=sys.stderr)
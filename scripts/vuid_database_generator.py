@@ -0,0 +1,74 @@
+#!/usr/bin/python3
+#
+# Copyright (c) 2023 Valve Corporation
+# Copyright (c) 2023 LunarG, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Converts validusage.json into the VUID database built into vkconfig_core, so that Vulkan Configurator
+# doesn't parse the JSON document at runtime. See vkconfig_core/vuid_database.h for the layout.
+#
+# Usage: vuid_database_generator.py <validusage.json> <output.cpp>
+
+import hashlib
+import json
+import struct
+import sys
+
+VUID_DATABASE_MAGIC = 0x44495556  # 'VUID'
+VUID_DATABASE_VERSION = 1
+
+def Generate(json_path, output_path):
+    with open(json_path, 'rb') as json_file:
+        json_data = json_file.read()
+
+    document = json.loads(json_data.decode('utf-8'))
+    vuids = set()
+    for api in document['validation'].values():
+        for entries in api.values():
+            for entry in entries:
+                vuids.add(entry['vuid'])
+
+    # Sorted bytewise, which is the std::string order used by vkconfig_core
+    vuids = sorted(vuid.encode('utf-8') for vuid in vuids)
+
+    offsets = []
+    pool = bytearray()
+    for vuid in vuids:
+        offsets.append(len(pool))
+        pool += vuid + b'\0'
+
+    blob = bytearray()
+    blob += struct.pack('<III', VUID_DATABASE_MAGIC, VUID_DATABASE_VERSION, len(vuids))
+    blob += hashlib.sha1(json_data).digest()
+    blob += struct.pack('<%dI' % len(offsets), *offsets)
+    blob += pool
+
+    lines = []
+    for i in range(0, len(blob), 24):
+        lines.append('    ' + ', '.join('0x%02x' % byte for byte in blob[i:i + 24]) + ',')
+
+    with open(output_path, 'w', newline='\n') as output_file:
+        output_file.write('// *** THIS FILE IS GENERATED - DO NOT EDIT ***\n')
+        output_file.write('// See vuid_database_generator.py for modifications\n\n')
+        output_file.write('#include "vuid_database.h"\n\n')
+        output_file.write('alignas(4) const unsigned char VUID_DATABASE[] = {\n')
+        output_file.write('\n'.join(lines))
+        output_file.write('\n};\n\n')
+        output_file.write('const std::size_t VUID_DATABASE_SIZE = sizeof(VUID_DATABASE);\n')
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        print('Usage: %s <validusage.json> <output.cpp>' % sys.argv[0])
+        sys.exit(1)
+    Generate(sys.argv[1], sys.argv[2])
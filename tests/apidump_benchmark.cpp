@@ -0,0 +1,257 @@
+/* Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures what the layers cost each call. Every thread records vkCmdBindDescriptorSets, vkCmdDraw and
+// vkUpdateDescriptorSets calls into a command buffer of its own, on whichever device the loader finds first, which is
+// meant to be the mock ICD. The layer settings are read once per process, so apidump_benchmark.sh runs this once for each
+// output format, and layer_scaling_benchmark.sh once for each layer configuration and thread count.
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every allocation made through operator new, by the benchmark or by a layer, while the calls are being measured. The
+// executable exports these, so that on Linux the layers loaded by the loader allocate through them too.
+static std::atomic<bool> counting_allocations{false};
+static std::atomic<uint64_t> allocation_count{0};
+
+void *operator new(size_t size) {
+    if (counting_allocations.load(std::memory_order_relaxed)) allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void *memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, size_t) noexcept { std::free(memory); }
+
+struct BenchmarkOptions {
+    std::vector<std::string> layers;
+    uint32_t thread_count = 1;
+    uint32_t iterations = 10000;
+};
+
+// The objects of one recording thread, so that threads share nothing but the device.
+struct ThreadObjects {
+    VkCommandPool command_pool = VK_NULL_HANDLE;
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+    std::chrono::nanoseconds elapsed{0};
+};
+
+static bool Check(VkResult result, const char *call) {
+    if (result == VK_SUCCESS) return true;
+    std::fprintf(stderr, "%s failed with VkResult %d\n", call, static_cast<int>(result));
+    return false;
+}
+
+static bool ParseOptions(int argc, char **argv, BenchmarkOptions &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--layer") {
+            options.layers.push_back("VK_LAYER_LUNARG_api_dump");
+        } else if (argument == "--layers" && i + 1 < argc) {
+            // The layers are given without VK_LAYER_LUNARG_, and enabled in the order given, the first closest to the
+            // application.
+            const std::string list = argv[++i];
+            for (size_t begin = 0, end = 0; begin < list.size(); begin = end + 1) {
+                end = std::min(list.find(',', begin), list.size());
+                if (end > begin) options.layers.push_back("VK_LAYER_LUNARG_" + list.substr(begin, end - begin));
+            }
+        } else if (argument == "--threads" && i + 1 < argc) {
+            options.thread_count = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+        } else if (argument == "--iterations" && i + 1 < argc) {
+            options.iterations = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+        } else {
+            std::fprintf(stderr,
+                         "Usage: %s [--layer] [--layers <layer>,...] [--threads <count>] [--iterations <count>]\n"
+                         "Records <iterations> vkCmdBindDescriptorSets, vkCmdDraw and vkUpdateDescriptorSets calls on each\n"
+                         "thread, with VK_LAYER_LUNARG_api_dump enabled if --layer is given, and the layers of --layers,\n"
+                         "such as api_dump,monitor,screenshot.\n",
+                         argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    BenchmarkOptions options;
+    if (!ParseOptions(argc, argv, options)) return 1;
+
+    std::vector<const char *> layer_names;
+    for (const std::string &layer : options.layers) layer_names.push_back(layer.c_str());
+    VkApplicationInfo app_info = {VK_STRUCTURE_TYPE_APPLICATION_INFO};
+    app_info.pApplicationName = "apidump_benchmark";
+    app_info.apiVersion = VK_API_VERSION_1_0;
+    VkInstanceCreateInfo instance_info = {VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+    instance_info.pApplicationInfo = &app_info;
+    instance_info.enabledLayerCount = static_cast<uint32_t>(layer_names.size());
+    instance_info.ppEnabledLayerNames = layer_names.data();
+    VkInstance instance = VK_NULL_HANDLE;
+    if (!Check(vkCreateInstance(&instance_info, nullptr, &instance), "vkCreateInstance")) return 1;
+
+    uint32_t physical_device_count = 1;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    const VkResult enumerate_result = vkEnumeratePhysicalDevices(instance, &physical_device_count, &physical_device);
+    if (enumerate_result != VK_INCOMPLETE && !Check(enumerate_result, "vkEnumeratePhysicalDevices")) return 1;
+    if (physical_device_count == 0) {
+        std::fprintf(stderr, "No physical device was found\n");
+        return 1;
+    }
+
+    const float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info = {VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+    queue_info.queueFamilyIndex = 0;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+    VkDeviceCreateInfo device_info = {VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    VkDevice device = VK_NULL_HANDLE;
+    if (!Check(vkCreateDevice(physical_device, &device_info, nullptr, &device), "vkCreateDevice")) return 1;
+
+    // A uniform buffer binding is all the descriptor calls need.
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    VkDescriptorSetLayoutCreateInfo set_layout_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    set_layout_info.bindingCount = 1;
+    set_layout_info.pBindings = &binding;
+    VkDescriptorSetLayout set_layout = VK_NULL_HANDLE;
+    if (!Check(vkCreateDescriptorSetLayout(device, &set_layout_info, nullptr, &set_layout), "vkCreateDescriptorSetLayout")) {
+        return 1;
+    }
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &set_layout;
+    VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+    if (!Check(vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout), "vkCreatePipelineLayout")) {
+        return 1;
+    }
+
+    VkDescriptorPoolSize pool_size = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, options.thread_count};
+    VkDescriptorPoolCreateInfo descriptor_pool_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    descriptor_pool_info.maxSets = options.thread_count;
+    descriptor_pool_info.poolSizeCount = 1;
+    descriptor_pool_info.pPoolSizes = &pool_size;
+    VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+    if (!Check(vkCreateDescriptorPool(device, &descriptor_pool_info, nullptr, &descriptor_pool), "vkCreateDescriptorPool")) {
+        return 1;
+    }
+
+    VkBufferCreateInfo buffer_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    buffer_info.size = 256;
+    buffer_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    if (!Check(vkCreateBuffer(device, &buffer_info, nullptr, &buffer), "vkCreateBuffer")) return 1;
+
+    std::vector<ThreadObjects> threads(options.thread_count);
+    for (ThreadObjects &objects : threads) {
+        VkCommandPoolCreateInfo command_pool_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        command_pool_info.queueFamilyIndex = 0;
+        if (!Check(vkCreateCommandPool(device, &command_pool_info, nullptr, &objects.command_pool), "vkCreateCommandPool")) {
+            return 1;
+        }
+
+        VkCommandBufferAllocateInfo command_buffer_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        command_buffer_info.commandPool = objects.command_pool;
+        command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        command_buffer_info.commandBufferCount = 1;
+        if (!Check(vkAllocateCommandBuffers(device, &command_buffer_info, &objects.command_buffer), "vkAllocateCommandBuffers")) {
+            return 1;
+        }
+
+        VkDescriptorSetAllocateInfo descriptor_set_info = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+        descriptor_set_info.descriptorPool = descriptor_pool;
+        descriptor_set_info.descriptorSetCount = 1;
+        descriptor_set_info.pSetLayouts = &set_layout;
+        if (!Check(vkAllocateDescriptorSets(device, &descriptor_set_info, &objects.descriptor_set), "vkAllocateDescriptorSets")) {
+            return 1;
+        }
+    }
+
+    // The threads all start recording together, once every one of them is running.
+    std::atomic<uint32_t> ready_threads{0};
+    std::atomic<bool> start{false};
+    std::vector<std::thread> workers;
+    counting_allocations.store(true, std::memory_order_relaxed);
+    for (ThreadObjects &objects : threads) {
+        workers.emplace_back([&options, &objects, &ready_threads, &start, device, pipeline_layout, buffer]() {
+            VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+            VkDescriptorBufferInfo descriptor_buffer = {buffer, 0, VK_WHOLE_SIZE};
+            VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+            write.dstSet = objects.descriptor_set;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            write.pBufferInfo = &descriptor_buffer;
+
+            ready_threads.fetch_add(1, std::memory_order_relaxed);
+            while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+
+            const auto begin = std::chrono::steady_clock::now();
+            vkBeginCommandBuffer(objects.command_buffer, &begin_info);
+            // The mock ICD checks nothing, so the draws don't need a render pass or a pipeline.
+            for (uint32_t i = 0; i < options.iterations; ++i) {
+                vkCmdBindDescriptorSets(objects.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1,
+                                        &objects.descriptor_set, 0, nullptr);
+                vkCmdDraw(objects.command_buffer, 3, 1, 0, 0);
+                vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+            }
+            vkEndCommandBuffer(objects.command_buffer);
+            objects.elapsed = std::chrono::steady_clock::now() - begin;
+        });
+    }
+    while (ready_threads.load(std::memory_order_relaxed) < options.thread_count) std::this_thread::yield();
+    const auto wall_begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (std::thread &worker : workers) worker.join();
+    const std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - wall_begin;
+    counting_allocations.store(false, std::memory_order_relaxed);
+
+    // Each thread makes its calls back to back, so a call takes the time all the threads spent over all their calls, while
+    // the throughput is of all the threads together, which is what stops growing with the threads when they contend.
+    std::chrono::nanoseconds elapsed{0};
+    for (const ThreadObjects &objects : threads) elapsed += objects.elapsed;
+    const double calls = (static_cast<double>(options.iterations) * 3 + 2) * options.thread_count;
+    std::printf("threads %u, calls %.0f, %.1f ns/call, %.0f calls/s, %.2f allocations/call\n", options.thread_count, calls,
+                static_cast<double>(elapsed.count()) / calls, calls / wall_time.count(),
+                static_cast<double>(allocation_count.load()) / calls);
+
+    for (ThreadObjects &objects : threads) vkDestroyCommandPool(device, objects.command_pool, nullptr);
+    vkDestroyBuffer(device, buffer, nullptr);
+    vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+    vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+    vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(instance, nullptr);
+    return 0;
+}
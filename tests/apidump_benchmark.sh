@@ -0,0 +1,90 @@
+#!/bin/bash
+
+# apidump_benchmark.sh
+# This script will run apidump_benchmark on the mock ICD, first without the api_dump layer and then with the layer in
+# each of its output formats. For each run it reports the time and the allocations of a call, and the bytes the layer
+# wrote for each call, so that the overhead of the layer can be compared between releases. The script requires a path
+# to the Vulkan-Tools build directory so that it can locate the mock ICD. The path can be defined using the environment
+# variable VULKAN_TOOLS_BUILD_DIR or using the command-line argument -t or --tools. The api_dump layer is found through
+# VK_LAYER_PATH, as usual.
+
+THREADS=1
+ITERATIONS=10000
+
+# Track unrecognized arguments.
+UNRECOGNIZED=()
+
+# Parse the command-line arguments.
+while [[ $# -gt 0 ]]
+do
+   KEY="$1"
+   case $KEY in
+      -t|--tools)
+      VULKAN_TOOLS_BUILD_DIR="$2"
+      shift
+      shift
+      ;;
+      --threads)
+      THREADS="$2"
+      shift
+      shift
+      ;;
+      --iterations)
+      ITERATIONS="$2"
+      shift
+      shift
+      ;;
+      *)
+      UNRECOGNIZED+=("$1")
+      shift
+      ;;
+   esac
+done
+
+# Reject unrecognized arguments.
+if [[ ${#UNRECOGNIZED[@]} -ne 0 ]]; then
+   echo "ERROR: $0:$LINENO"
+   echo "Unrecognized command-line arguments: ${UNRECOGNIZED[*]}"
+   exit 1
+fi
+
+if [ -z ${VULKAN_TOOLS_BUILD_DIR+x} ]; then
+   echo "ERROR: $0:$LINENO"
+   echo "Vulkan-Tools build directory is undefined."
+   echo "Please set VULKAN_TOOLS_BUILD_DIR or use the -t|--tools <path> command line option."
+   exit 1
+fi
+
+pushd $(dirname "${BASH_SOURCE[0]}") > /dev/null
+
+BENCHMARK="${APIDUMP_BENCHMARK:-./apidump_benchmark}"
+export VK_ICD_FILENAMES="$VULKAN_TOOLS_BUILD_DIR/icd/VkICD_mock_icd.json"
+
+printf "%-10s " "no layer"
+if ! "$BENCHMARK" --threads $THREADS --iterations $ITERATIONS
+then
+   popd > /dev/null
+   exit 1
+fi
+
+for FORMAT in text html json ndjson binary stats trace
+do
+   rm -f apidump_benchmark.tmp
+   RESULT=$(VK_APIDUMP_OUTPUT_FORMAT=$FORMAT VK_APIDUMP_LOG_FILENAME=apidump_benchmark.tmp \
+      "$BENCHMARK" --layer --threads $THREADS --iterations $ITERATIONS)
+   if [ $? -ne 0 ]
+   then
+      rm -f apidump_benchmark.tmp
+      popd > /dev/null
+      exit 1
+   fi
+   # The whole run is written, including the instance and device setup, which the calls of the benchmark dwarf.
+   CALLS=$(echo "$RESULT" | sed -n 's/.*calls \([0-9]*\),.*/\1/p')
+   BYTES=$(wc -c < apidump_benchmark.tmp)
+   printf "%-10s %s, %s bytes/call\n" "$FORMAT" "$RESULT" $(awk "BEGIN { printf \"%.1f\", $BYTES / $CALLS }")
+done
+
+rm -f apidump_benchmark.tmp
+popd > /dev/null
+
+exit 0
@@ -0,0 +1,407 @@
+/* Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks that api_dump neither loses nor reorders the calls of a thread, and that it puts them in the right frames, however
+// its output is written. Every thread records a known sequence of vkCmdDraw calls in every frame, while the main thread
+// waits, and then presents a headless swapchain once they are all done, so the frame of every call is known. The arguments of
+// each vkCmdDraw say which call it is:
+//     vertexCount    the thread, starting at 1
+//     instanceCount  the frame
+//     firstVertex    the call in the frame
+//     firstInstance  the call since the thread started
+// With --check, the output of a previous run is read back instead, and every vkCmdDraw of it is matched against the calls
+// made. apidump_stress_test.sh runs both for each output format and output mode.
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StressOptions {
+    bool layer = false;
+    uint32_t thread_count = 8;
+    uint32_t frame_count = 32;
+    uint32_t call_count = 64;
+    std::string check_file;
+    std::string check_format;
+};
+
+// How a format writes the parts of a call which are checked. A parameter is written as its name between the prefix and the
+// suffix, followed by the value marker and its value.
+struct OutputSyntax {
+    const char *format;
+    const char *call;
+    const char *frame;
+    const char *parameter_prefix;
+    const char *parameter_suffix;
+    const char *value;
+};
+
+// The frame of a call is the last frame marker before its parameters: the text format writes the frame in front of every
+// call, the html and json formats in front of every frame, ndjson in front of every call, and trace inside every call.
+static const OutputSyntax output_syntaxes[] = {
+    {"text", "vkCmdDraw(", "Frame ", "", ": ", " = "},
+    {"html", "<div class='var'>vkCmdDraw(", "Frame ", "<div class='var'>", "</div>", "<div class='val'>"},
+    {"json", "\"name\" : \"vkCmdDraw\"", "\"frameNumber\" : \"", "\"name\" : \"", "\"", "\"value\" : "},
+    {"ndjson", "\"name\" : \"vkCmdDraw\"", "\"frameNumber\" : \"", "\"name\" : \"", "\"", "\"value\" : "},
+    {"trace", "{\"name\" : \"vkCmdDraw\"", "\"frame\" : ", "\"", "\"", " : "},
+};
+
+static const char *checked_parameters[] = {"vertexCount", "instanceCount", "firstVertex", "firstInstance"};
+
+static bool Check(VkResult result, const char *call) {
+    if (result == VK_SUCCESS) return true;
+    std::fprintf(stderr, "%s failed with VkResult %d\n", call, static_cast<int>(result));
+    return false;
+}
+
+static bool ParseOptions(int argc, char **argv, StressOptions &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--layer") {
+            options.layer = true;
+        } else if (argument == "--threads" && i + 1 < argc) {
+            options.thread_count = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+        } else if (argument == "--frames" && i + 1 < argc) {
+            options.frame_count = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+        } else if (argument == "--calls" && i + 1 < argc) {
+            options.call_count = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+        } else if (argument == "--check" && i + 2 < argc) {
+            options.check_file = argv[++i];
+            options.check_format = argv[++i];
+        } else {
+            std::fprintf(stderr,
+                         "Usage: %s [--layer] [--threads <count>] [--frames <count>] [--calls <count>]\n"
+                         "          [--check <file> text|html|json|ndjson|trace|stats]\n"
+                         "Records <calls> vkCmdDraw calls on each thread in each of <frames> frames, with\n"
+                         "VK_LAYER_LUNARG_api_dump enabled if --layer is given. With --check, the api_dump output of a run\n"
+                         "with the same counts is read from <file> and checked call by call instead.\n",
+                         argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reads the number following position, after any quotes and spaces, or returns false if there is none.
+static bool ReadNumber(const std::string &output, size_t position, uint64_t &number) {
+    while (position < output.size() && (output[position] == '"' || output[position] == ' ')) ++position;
+    if (position >= output.size() || output[position] < '0' || output[position] > '9') return false;
+    number = 0;
+    for (; position < output.size() && output[position] >= '0' && output[position] <= '9'; ++position) {
+        number = number * 10 + static_cast<uint64_t>(output[position] - '0');
+    }
+    return true;
+}
+
+// Matches every call of the output against the calls each thread made, in the order they made them. Only the first errors
+// are reported, as one lost call usually makes every later one of its thread mismatch.
+static bool CheckCalls(const StressOptions &options, const std::string &output, const OutputSyntax &syntax) {
+    const uint64_t calls_per_thread = static_cast<uint64_t>(options.frame_count) * options.call_count;
+    std::vector<uint64_t> next_calls(options.thread_count, 0);
+    uint64_t checked = 0;
+    uint32_t errors = 0;
+    auto report = [&errors](size_t offset, const std::string &message) {
+        if (++errors <= 10) std::fprintf(stderr, "At byte %zu: %s\n", offset, message.c_str());
+    };
+
+    size_t frame_position = output.find(syntax.frame);
+    uint64_t frame = 0;
+    bool frame_known = false;
+    for (size_t call = output.find(syntax.call); call != std::string::npos;) {
+        const size_t next_call = output.find(syntax.call, call + 1);
+        const size_t end = next_call == std::string::npos ? output.size() : next_call;
+        uint64_t values[4] = {};
+        size_t position = call + strlen(syntax.call);
+        size_t first_parameter = std::string::npos;
+        bool complete = true;
+        for (size_t i = 0; i < 4 && complete; ++i) {
+            const std::string parameter = std::string(syntax.parameter_prefix) + checked_parameters[i] + syntax.parameter_suffix;
+            position = output.find(parameter, position);
+            if (i == 0) first_parameter = position;
+            const size_t value = position < end ? output.find(syntax.value, position + parameter.size()) : std::string::npos;
+            complete = value < end && ReadNumber(output, value + strlen(syntax.value), values[i]);
+            if (complete) position = value;
+        }
+        if (!complete) {
+            report(call, "a vkCmdDraw call is incomplete");
+            call = next_call;
+            continue;
+        }
+
+        while (frame_position != std::string::npos && frame_position < first_parameter) {
+            frame_known = ReadNumber(output, frame_position + strlen(syntax.frame), frame);
+            frame_position = output.find(syntax.frame, frame_position + 1);
+        }
+
+        ++checked;
+        const uint64_t thread = values[0] - 1;
+        if (values[0] == 0 || thread >= options.thread_count) {
+            report(call, "vkCmdDraw was called by thread " + std::to_string(values[0]) + ", which doesn't exist");
+        } else if (next_calls[thread] >= calls_per_thread) {
+            report(call, "thread " + std::to_string(values[0]) + " has more calls than it made");
+        } else {
+            const uint64_t expected = next_calls[thread]++;
+            if (values[3] != expected) {
+                report(call, "thread " + std::to_string(values[0]) + " call " + std::to_string(values[3]) +
+                                 " is where its call " + std::to_string(expected) + " should be");
+                // Following the calls which are there keeps a single lost or repeated call from failing all the rest.
+                next_calls[thread] = values[3] + 1;
+            } else if (values[1] != expected / options.call_count || values[2] != expected % options.call_count) {
+                report(call, "thread " + std::to_string(values[0]) + " call " + std::to_string(expected) + " has wrong arguments");
+            } else if (!frame_known || frame != values[1]) {
+                report(call, "thread " + std::to_string(values[0]) + " call " + std::to_string(expected) + " of frame " +
+                                 std::to_string(values[1]) + " is in frame " + (frame_known ? std::to_string(frame) : "?"));
+            }
+        }
+        call = next_call;
+    }
+
+    for (uint32_t thread = 0; thread < options.thread_count; ++thread) {
+        if (next_calls[thread] < calls_per_thread) {
+            ++errors;
+            std::fprintf(stderr, "Thread %u has %llu of its %llu calls\n", thread + 1,
+                         static_cast<unsigned long long>(next_calls[thread]), static_cast<unsigned long long>(calls_per_thread));
+        }
+    }
+    std::printf("%s: %llu vkCmdDraw calls checked, %u errors\n", syntax.format, static_cast<unsigned long long>(checked),
+                errors);
+    return errors == 0;
+}
+
+// With lunarg_api_dump.stats_per_frame, every frame has a report of its own, headed "Frames <first>-<last>:", in which the
+// vkCmdDraw row gives its call count. The calls of each thread are not told apart, so only the count of every frame is checked.
+static bool CheckStats(const StressOptions &options, const std::string &output) {
+    const uint64_t calls_per_frame = static_cast<uint64_t>(options.thread_count) * options.call_count;
+    std::map<uint64_t, uint64_t> frame_calls;
+    uint32_t errors = 0;
+    for (size_t report = output.find("Frames "); report != std::string::npos;) {
+        const size_t next_report = output.find("Frames ", report + 1);
+        uint64_t first_frame = 0;
+        uint64_t last_frame = 0;
+        const size_t dash = output.find('-', report);
+        if (!ReadNumber(output, report + strlen("Frames "), first_frame) || dash == std::string::npos ||
+            !ReadNumber(output, dash + 1, last_frame)) {
+            std::fprintf(stderr, "At byte %zu: a report has no frame range\n", report);
+            return false;
+        }
+        const size_t row = output.find("\nvkCmdDraw ", report);
+        uint64_t calls = 0;
+        if (row < next_report) ReadNumber(output, output.find_first_not_of(' ', row + strlen("\nvkCmdDraw ")), calls);
+        if (calls > 0 && first_frame != last_frame) {
+            ++errors;
+            std::fprintf(stderr, "Frames %llu-%llu are reported together\n", static_cast<unsigned long long>(first_frame),
+                         static_cast<unsigned long long>(last_frame));
+        }
+        frame_calls[first_frame] += calls;
+        report = next_report;
+    }
+
+    for (const auto &entry : frame_calls) {
+        const uint64_t expected = entry.first < options.frame_count ? calls_per_frame : 0;
+        if (entry.second != expected) {
+            ++errors;
+            std::fprintf(stderr, "Frame %llu has %llu vkCmdDraw calls instead of %llu\n",
+                         static_cast<unsigned long long>(entry.first), static_cast<unsigned long long>(entry.second),
+                         static_cast<unsigned long long>(expected));
+        }
+    }
+    for (uint32_t frame = 0; frame < options.frame_count; ++frame) {
+        if (frame_calls.count(frame) == 0) {
+            ++errors;
+            std::fprintf(stderr, "Frame %u has no report\n", frame);
+        }
+    }
+    std::printf("stats: %zu frame reports checked, %u errors\n", frame_calls.size(), errors);
+    return errors == 0;
+}
+
+static bool CheckOutput(const StressOptions &options) {
+    std::ifstream file(options.check_file, std::ifstream::in | std::ifstream::binary);
+    if (!file.is_open()) {
+        std::fprintf(stderr, "Could not read '%s'\n", options.check_file.c_str());
+        return false;
+    }
+    const std::string output((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (options.check_format == "stats") return CheckStats(options, output);
+    for (const OutputSyntax &syntax : output_syntaxes) {
+        if (options.check_format == syntax.format) return CheckCalls(options, output, syntax);
+    }
+    std::fprintf(stderr, "There is no check for the %s format\n", options.check_format.c_str());
+    return false;
+}
+
+int main(int argc, char **argv) {
+    StressOptions options;
+    if (!ParseOptions(argc, argv, options)) return 1;
+    if (!options.check_file.empty()) return CheckOutput(options) ? 0 : 1;
+
+    // The frames are delimited by vkQueuePresentKHR, so there has to be a swapchain to present, which headless surfaces give
+    // without a window.
+    const char *layer_name = "VK_LAYER_LUNARG_api_dump";
+    const char *instance_extensions[] = {VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME};
+    VkApplicationInfo app_info = {VK_STRUCTURE_TYPE_APPLICATION_INFO};
+    app_info.pApplicationName = "apidump_stress";
+    app_info.apiVersion = VK_API_VERSION_1_0;
+    VkInstanceCreateInfo instance_info = {VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+    instance_info.pApplicationInfo = &app_info;
+    instance_info.enabledLayerCount = options.layer ? 1 : 0;
+    instance_info.ppEnabledLayerNames = &layer_name;
+    instance_info.enabledExtensionCount = 2;
+    instance_info.ppEnabledExtensionNames = instance_extensions;
+    VkInstance instance = VK_NULL_HANDLE;
+    if (!Check(vkCreateInstance(&instance_info, nullptr, &instance), "vkCreateInstance")) return 1;
+
+    uint32_t physical_device_count = 1;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    const VkResult enumerate_result = vkEnumeratePhysicalDevices(instance, &physical_device_count, &physical_device);
+    if (enumerate_result != VK_INCOMPLETE && !Check(enumerate_result, "vkEnumeratePhysicalDevices")) return 1;
+    if (physical_device_count == 0) {
+        std::fprintf(stderr, "No physical device was found\n");
+        return 1;
+    }
+
+    auto create_headless_surface =
+        reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT"));
+    if (create_headless_surface == nullptr) {
+        std::fprintf(stderr, "vkCreateHeadlessSurfaceEXT was not found\n");
+        return 1;
+    }
+    VkHeadlessSurfaceCreateInfoEXT surface_info = {VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT};
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    if (!Check(create_headless_surface(instance, &surface_info, nullptr, &surface), "vkCreateHeadlessSurfaceEXT")) return 1;
+
+    const char *device_extension = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+    const float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info = {VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+    queue_info.queueFamilyIndex = 0;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+    VkDeviceCreateInfo device_info = {VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    device_info.enabledExtensionCount = 1;
+    device_info.ppEnabledExtensionNames = &device_extension;
+    VkDevice device = VK_NULL_HANDLE;
+    if (!Check(vkCreateDevice(physical_device, &device_info, nullptr, &device), "vkCreateDevice")) return 1;
+    VkQueue queue = VK_NULL_HANDLE;
+    vkGetDeviceQueue(device, 0, 0, &queue);
+
+    // The mock ICD checks nothing, so the swapchain only needs what every surface supports.
+    VkSwapchainCreateInfoKHR swapchain_info = {VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR};
+    swapchain_info.surface = surface;
+    swapchain_info.minImageCount = 2;
+    swapchain_info.imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    swapchain_info.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    swapchain_info.imageExtent = {64, 64};
+    swapchain_info.imageArrayLayers = 1;
+    swapchain_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    swapchain_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    swapchain_info.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    swapchain_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    swapchain_info.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    swapchain_info.clipped = VK_TRUE;
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    if (!Check(vkCreateSwapchainKHR(device, &swapchain_info, nullptr, &swapchain), "vkCreateSwapchainKHR")) return 1;
+
+    VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VkFence acquired = VK_NULL_HANDLE;
+    if (!Check(vkCreateFence(device, &fence_info, nullptr, &acquired), "vkCreateFence")) return 1;
+
+    // Every thread records into a command buffer of its own, which it begins again every frame.
+    std::vector<VkCommandPool> command_pools(options.thread_count, VK_NULL_HANDLE);
+    std::vector<VkCommandBuffer> command_buffers(options.thread_count, VK_NULL_HANDLE);
+    for (uint32_t thread = 0; thread < options.thread_count; ++thread) {
+        VkCommandPoolCreateInfo command_pool_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        command_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        command_pool_info.queueFamilyIndex = 0;
+        if (!Check(vkCreateCommandPool(device, &command_pool_info, nullptr, &command_pools[thread]), "vkCreateCommandPool")) {
+            return 1;
+        }
+        VkCommandBufferAllocateInfo command_buffer_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        command_buffer_info.commandPool = command_pools[thread];
+        command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        command_buffer_info.commandBufferCount = 1;
+        if (!Check(vkAllocateCommandBuffers(device, &command_buffer_info, &command_buffers[thread]), "vkAllocateCommandBuffers")) {
+            return 1;
+        }
+    }
+
+    // A frame starts when the main thread releases it, and ends once every thread has recorded its calls, so that the calls
+    // of the threads interleave within the frame but none of them can be made across a present.
+    std::atomic<uint32_t> released_frames{0};
+    std::atomic<uint32_t> recorded_frames{0};
+    std::vector<std::thread> workers;
+    for (uint32_t thread = 0; thread < options.thread_count; ++thread) {
+        workers.emplace_back([&options, &released_frames, &recorded_frames, &command_buffers, thread]() {
+            const VkCommandBuffer command_buffer = command_buffers[thread];
+            VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+            uint32_t sequence = 0;
+            for (uint32_t frame = 0; frame < options.frame_count; ++frame) {
+                while (released_frames.load(std::memory_order_acquire) <= frame) std::this_thread::yield();
+                vkBeginCommandBuffer(command_buffer, &begin_info);
+                for (uint32_t call = 0; call < options.call_count; ++call) {
+                    vkCmdDraw(command_buffer, thread + 1, frame, call, sequence++);
+                }
+                vkEndCommandBuffer(command_buffer);
+                recorded_frames.fetch_add(1, std::memory_order_release);
+            }
+        });
+    }
+
+    bool presented = true;
+    for (uint32_t frame = 0; frame < options.frame_count && presented; ++frame) {
+        released_frames.store(frame + 1, std::memory_order_release);
+        while (recorded_frames.load(std::memory_order_acquire) < (frame + 1) * options.thread_count) std::this_thread::yield();
+
+        uint32_t index = 0;
+        const VkResult acquire_result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, VK_NULL_HANDLE, acquired, &index);
+        presented = acquire_result == VK_SUBOPTIMAL_KHR || Check(acquire_result, "vkAcquireNextImageKHR");
+        if (!presented) break;
+        vkWaitForFences(device, 1, &acquired, VK_TRUE, UINT64_MAX);
+        vkResetFences(device, 1, &acquired);
+
+        VkPresentInfoKHR present_info = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
+        present_info.swapchainCount = 1;
+        present_info.pSwapchains = &swapchain;
+        present_info.pImageIndices = &index;
+        const VkResult present_result = vkQueuePresentKHR(queue, &present_info);
+        presented = present_result == VK_SUBOPTIMAL_KHR || Check(present_result, "vkQueuePresentKHR");
+    }
+    // The threads still waiting for a frame which won't come are released, so that they can be joined.
+    released_frames.store(options.frame_count, std::memory_order_release);
+    for (std::thread &worker : workers) worker.join();
+
+    for (VkCommandPool command_pool : command_pools) vkDestroyCommandPool(device, command_pool, nullptr);
+    vkDestroyFence(device, acquired, nullptr);
+    vkDestroySwapchainKHR(device, swapchain, nullptr);
+    vkDestroyDevice(device, nullptr);
+    vkDestroySurfaceKHR(instance, surface, nullptr);
+    vkDestroyInstance(instance, nullptr);
+    if (!presented) return 1;
+
+    std::printf("threads %u, frames %u, calls %llu\n", options.thread_count, options.frame_count,
+                static_cast<unsigned long long>(options.thread_count) * options.frame_count * options.call_count);
+    return 0;
+}
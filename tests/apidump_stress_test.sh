@@ -0,0 +1,149 @@
+#!/bin/bash
+
+# apidump_stress_test.sh
+# This script will run apidump_stress on the mock ICD with the api_dump layer, once for each output format and output
+# mode: synchronous, per-thread buffering, asynchronous, asynchronous with deferred formatting, asynchronous with queued
+# file writes, and for the binary format split per thread. apidump_stress records a known sequence of vkCmdDraw calls
+# from many threads across many frames, and then reads the output back and checks every call of it: that no call of a
+# thread is lost, repeated or out of order, and that every call is in the frame it was made in. Binary captures are
+# converted to text with api_dump_convert first, merging the files of a split capture. The stats format only has call
+# counts, so for it the count of every frame is checked. The script requires a path to the Vulkan-Tools build directory
+# so that it can locate the mock ICD. The path can be defined using the environment variable VULKAN_TOOLS_BUILD_DIR or
+# using the command-line argument -t or --tools. The layer is found through VK_LAYER_PATH, as usual, and
+# api_dump_convert next to it unless APIDUMP_CONVERT gives its path.
+
+THREADS=8
+FRAMES=32
+CALLS=64
+
+# Track unrecognized arguments.
+UNRECOGNIZED=()
+
+# Parse the command-line arguments.
+while [[ $# -gt 0 ]]
+do
+   KEY="$1"
+   case $KEY in
+      -t|--tools)
+      VULKAN_TOOLS_BUILD_DIR="$2"
+      shift
+      shift
+      ;;
+      --threads)
+      THREADS="$2"
+      shift
+      shift
+      ;;
+      --frames)
+      FRAMES="$2"
+      shift
+      shift
+      ;;
+      --calls)
+      CALLS="$2"
+      shift
+      shift
+      ;;
+      *)
+      UNRECOGNIZED+=("$1")
+      shift
+      ;;
+   esac
+done
+
+# Reject unrecognized arguments.
+if [[ ${#UNRECOGNIZED[@]} -ne 0 ]]; then
+   echo "ERROR: $0:$LINENO"
+   echo "Unrecognized command-line arguments: ${UNRECOGNIZED[*]}"
+   exit 1
+fi
+
+if [ -z ${VULKAN_TOOLS_BUILD_DIR+x} ]; then
+   echo "ERROR: $0:$LINENO"
+   echo "Vulkan-Tools build directory is undefined."
+   echo "Please set VULKAN_TOOLS_BUILD_DIR or use the -t|--tools <path> command line option."
+   exit 1
+fi
+
+if [ -t 1 ] ; then
+    RED='\033[0;31m'
+    GREEN='\033[0;32m'
+    NC='\033[0m' # No Color
+else
+    RED=''
+    GREEN=''
+    NC=''
+fi
+
+pushd $(dirname "${BASH_SOURCE[0]}") > /dev/null
+
+STRESS="${APIDUMP_STRESS:-./apidump_stress}"
+CONVERT="${APIDUMP_CONVERT:-${VK_LAYER_PATH%%:*}/api_dump_convert}"
+export VK_ICD_FILENAMES="$VULKAN_TOOLS_BUILD_DIR/icd/VkICD_mock_icd.json"
+COUNTS="--threads $THREADS --frames $FRAMES --calls $CALLS"
+
+# Each configuration is a name, the output format, and the settings only vk_layer_settings.txt has, separated by
+# semicolons, which are written to a settings file of the configuration's own.
+CONFIGURATIONS=()
+for FORMAT in text html json ndjson trace
+do
+   CONFIGURATIONS+=("$FORMAT|$FORMAT|")
+   CONFIGURATIONS+=("$FORMAT-buffered|$FORMAT|lunarg_api_dump.thread_buffering = true")
+   CONFIGURATIONS+=("$FORMAT-async|$FORMAT|lunarg_api_dump.async_output = true")
+done
+for FORMAT in text html json
+do
+   CONFIGURATIONS+=("$FORMAT-deferred|$FORMAT|lunarg_api_dump.async_output = true;lunarg_api_dump.deferred_formatting = true")
+done
+CONFIGURATIONS+=("binary|binary|")
+CONFIGURATIONS+=("binary-async|binary|lunarg_api_dump.async_output = true")
+CONFIGURATIONS+=("binary-split|binary|lunarg_api_dump.split_output = thread")
+CONFIGURATIONS+=("text-queued|text|lunarg_api_dump.async_output = true;lunarg_api_dump.queued_output = true")
+CONFIGURATIONS+=("binary-direct|binary|lunarg_api_dump.async_output = true;lunarg_api_dump.queued_output = true;lunarg_api_dump.direct_io = true")
+CONFIGURATIONS+=("stats|stats|lunarg_api_dump.stats_per_frame = true")
+
+rm -rf apidump_stress.settings
+mkdir apidump_stress.settings
+export VK_LAYER_SETTINGS_PATH="$PWD/apidump_stress.settings"
+
+printf "$GREEN[ RUN      ]$NC $0\n"
+FAILED=()
+for CONFIGURATION in "${CONFIGURATIONS[@]}"
+do
+   IFS='|' read -r NAME FORMAT FILE_SETTINGS <<< "$CONFIGURATION"
+   echo "$FILE_SETTINGS" | tr ';' '\n' > apidump_stress.settings/vk_layer_settings.txt
+   rm -f apidump_stress*.tmp apidump_stress*.bin
+
+   OUTPUT=apidump_stress.tmp
+   if [ "$FORMAT" == "binary" ]; then
+      OUTPUT=apidump_stress.bin
+   fi
+   VK_APIDUMP_OUTPUT_FORMAT=$FORMAT VK_APIDUMP_LOG_FILENAME=$OUTPUT "$STRESS" --layer $COUNTS > /dev/null
+   RESULT=$?
+
+   CHECK_FORMAT=$FORMAT
+   if [[ $RESULT -eq 0 && "$FORMAT" == "binary" ]]; then
+      "$CONVERT" apidump_stress*.bin text apidump_stress.tmp
+      RESULT=$?
+      CHECK_FORMAT=text
+   fi
+   if [ $RESULT -eq 0 ]; then
+      printf "%-16s " "$NAME"
+      "$STRESS" $COUNTS --check apidump_stress.tmp $CHECK_FORMAT
+      RESULT=$?
+   fi
+   if [ $RESULT -ne 0 ]; then
+      FAILED+=("$NAME")
+   fi
+done
+rm -rf apidump_stress*.tmp apidump_stress*.bin apidump_stress.settings
+
+popd > /dev/null
+
+if [[ ${#FAILED[@]} -ne 0 ]]; then
+   printf "$RED[  FAILED  ]$NC $0: ${FAILED[*]}\n"
+   exit 1
+fi
+
+printf "$GREEN[  PASSED  ]$NC $0\n"
+exit 0
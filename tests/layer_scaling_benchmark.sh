@@ -0,0 +1,185 @@
+#!/bin/bash
+
+# layer_scaling_benchmark.sh
+# This script will run apidump_benchmark on the mock ICD from 1 thread up to a number of threads, doubling them, first
+# without layers and then with each layer configuration: api_dump in each of its output formats with asynchronous output
+# off and on, api_dump with a function filter, the screenshot layer idle, the monitor layer, and the three layers together.
+# For each run it reports the calls per second of all the threads together, and writes them to layer_scaling.csv, which
+# --plot draws with gnuplot. The scaling efficiency of a configuration is how much its calls per second grow from 1 thread
+# to the most threads, compared to how much they grow without layers, so that the scaling of the mock ICD and of the
+# machine are left out: 1.0 scales as well as no layer does. With --min-efficiency, the script fails when a configuration
+# scales worse than that, for continuous integration to catch the layers serializing their calls. The script requires a
+# path to the Vulkan-Tools build directory so that it can locate the mock ICD. The path can be defined using the
+# environment variable VULKAN_TOOLS_BUILD_DIR or using the command-line argument -t or --tools. The layers are found
+# through VK_LAYER_PATH, as usual.
+
+MAX_THREADS=8
+ITERATIONS=10000
+MIN_EFFICIENCY=0
+PLOT=
+
+# Track unrecognized arguments.
+UNRECOGNIZED=()
+
+# Parse the command-line arguments.
+while [[ $# -gt 0 ]]
+do
+   KEY="$1"
+   case $KEY in
+      -t|--tools)
+      VULKAN_TOOLS_BUILD_DIR="$2"
+      shift
+      shift
+      ;;
+      --max-threads)
+      MAX_THREADS="$2"
+      shift
+      shift
+      ;;
+      --iterations)
+      ITERATIONS="$2"
+      shift
+      shift
+      ;;
+      --min-efficiency)
+      MIN_EFFICIENCY="$2"
+      shift
+      shift
+      ;;
+      --plot)
+      PLOT="$2"
+      shift
+      shift
+      ;;
+      *)
+      UNRECOGNIZED+=("$1")
+      shift
+      ;;
+   esac
+done
+
+# Reject unrecognized arguments.
+if [[ ${#UNRECOGNIZED[@]} -ne 0 ]]; then
+   echo "ERROR: $0:$LINENO"
+   echo "Unrecognized command-line arguments: ${UNRECOGNIZED[*]}"
+   exit 1
+fi
+
+if [ -z ${VULKAN_TOOLS_BUILD_DIR+x} ]; then
+   echo "ERROR: $0:$LINENO"
+   echo "Vulkan-Tools build directory is undefined."
+   echo "Please set VULKAN_TOOLS_BUILD_DIR or use the -t|--tools <path> command line option."
+   exit 1
+fi
+
+# The plot is written relative to the working directory, the results next to the benchmark.
+if [[ -n "$PLOT" && "$PLOT" != /* ]]; then
+   PLOT="$PWD/$PLOT"
+fi
+
+pushd $(dirname "${BASH_SOURCE[0]}") > /dev/null
+
+BENCHMARK="${APIDUMP_BENCHMARK:-./apidump_benchmark}"
+export VK_ICD_FILENAMES="$VULKAN_TOOLS_BUILD_DIR/icd/VkICD_mock_icd.json"
+
+# Each configuration is a name, the layers enabled, the settings given as environment variables, and the settings only
+# vk_layer_settings.txt has, separated by semicolons, which are written to a settings file of the configuration's own.
+CONFIGURATIONS=("none|||")
+for FORMAT in text html json ndjson binary stats trace
+do
+   CONFIGURATIONS+=("$FORMAT|api_dump|VK_APIDUMP_OUTPUT_FORMAT=$FORMAT|")
+   CONFIGURATIONS+=("$FORMAT-async|api_dump|VK_APIDUMP_OUTPUT_FORMAT=$FORMAT|lunarg_api_dump.async_output = true")
+done
+CONFIGURATIONS+=("text-filter|api_dump|VK_APIDUMP_OUTPUT_FORMAT=text VK_APIDUMP_FUNCTION_FILTER=vkCmdDraw|")
+CONFIGURATIONS+=("screenshot|screenshot||")
+CONFIGURATIONS+=("monitor|monitor||")
+CONFIGURATIONS+=("all|api_dump,monitor,screenshot|VK_APIDUMP_OUTPUT_FORMAT=text|")
+
+rm -rf layer_scaling.settings
+mkdir layer_scaling.settings
+export VK_LAYER_SETTINGS_PATH="$PWD/layer_scaling.settings"
+
+THREAD_COUNTS=()
+for ((THREADS = 1; THREADS < MAX_THREADS; THREADS *= 2))
+do
+   THREAD_COUNTS+=($THREADS)
+done
+THREAD_COUNTS+=($MAX_THREADS)
+
+echo "configuration,threads,calls_per_second" > layer_scaling.csv
+printf "%-14s" "calls/s"
+for THREADS in "${THREAD_COUNTS[@]}"
+do
+   printf " %12s" "$THREADS threads"
+done
+printf " %10s\n" "efficiency"
+
+BASELINE_GROWTH=
+FAILED=()
+for CONFIGURATION in "${CONFIGURATIONS[@]}"
+do
+   IFS='|' read -r NAME LAYERS SETTINGS FILE_SETTINGS <<< "$CONFIGURATION"
+   echo "$FILE_SETTINGS" | tr ';' '\n' > layer_scaling.settings/vk_layer_settings.txt
+   OPTIONS="--iterations $ITERATIONS"
+   if [ -n "$LAYERS" ]; then
+      OPTIONS="$OPTIONS --layers $LAYERS"
+   fi
+
+   printf "%-14s" "$NAME"
+   FIRST=
+   LAST=
+   for THREADS in "${THREAD_COUNTS[@]}"
+   do
+      rm -f layer_scaling.tmp
+      RESULT=$(env $SETTINGS VK_APIDUMP_LOG_FILENAME=layer_scaling.tmp "$BENCHMARK" $OPTIONS --threads $THREADS)
+      if [ $? -ne 0 ]
+      then
+         echo
+         rm -rf layer_scaling.tmp layer_scaling.settings
+         popd > /dev/null
+         exit 1
+      fi
+      RATE=$(echo "$RESULT" | sed -n 's/.* \([0-9]*\) calls\/s,.*/\1/p')
+      echo "$NAME,$THREADS,$RATE" >> layer_scaling.csv
+      printf " %12s" "$RATE"
+      FIRST=${FIRST:-$RATE}
+      LAST=$RATE
+   done
+
+   GROWTH=$(awk "BEGIN { printf \"%.4f\", $LAST / $FIRST }")
+   BASELINE_GROWTH=${BASELINE_GROWTH:-$GROWTH}
+   EFFICIENCY=$(awk "BEGIN { printf \"%.2f\", $GROWTH / $BASELINE_GROWTH }")
+   printf " %10s" "$EFFICIENCY"
+   if awk "BEGIN { exit !($EFFICIENCY < $MIN_EFFICIENCY) }"
+   then
+      FAILED+=("$NAME")
+      printf "  below %s" "$MIN_EFFICIENCY"
+   fi
+   echo
+done
+rm -rf layer_scaling.tmp layer_scaling.settings
+
+if [ -n "$PLOT" ]; then
+   if command -v gnuplot > /dev/null; then
+      PLOTS=
+      for CONFIGURATION in "${CONFIGURATIONS[@]}"
+      do
+         NAME=${CONFIGURATION%%|*}
+         PLOTS="$PLOTS${PLOTS:+, }'layer_scaling.csv' using 2:(strcol(1) eq '$NAME' ? \$3 : NaN) with linespoints title '$NAME'"
+      done
+      gnuplot -e "set terminal png size 1280,800; set output '$PLOT'; set datafile separator ','; set key outside; \
+set logscale x 2; set xlabel 'threads'; set ylabel 'calls per second'; plot $PLOTS"
+   else
+      echo "gnuplot was not found, the calls per second are in layer_scaling.csv"
+   fi
+fi
+
+popd > /dev/null
+
+if [[ ${#FAILED[@]} -ne 0 ]]; then
+   echo "ERROR: $0:$LINENO"
+   echo "Scaling efficiency below $MIN_EFFICIENCY: ${FAILED[*]}"
+   exit 1
+fi
+
+exit 0
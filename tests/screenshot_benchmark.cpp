@@ -0,0 +1,407 @@
+/* Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures what the screenshot layer costs the frames it captures. Every frame clears an image of a swapchain of
+// VK_EXT_headless_surface and presents it, on the device chosen, which is either the mock ICD or a real GPU. Each call to
+// vkQueuePresentKHR is timed, since that is where the layer copies the frames it captures. The layer settings are read once
+// per process, so screenshot_benchmark.sh runs this once for each file format.
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+struct BenchmarkOptions {
+    std::string file_format;
+    std::string directory = ".";
+    uint32_t device_index = 0;
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+    VkFormat format = VK_FORMAT_B8G8R8A8_UNORM;
+    uint32_t frames = 300;
+    uint32_t interval = 1;
+};
+
+// The objects of one image of the swapchain, which is cleared and presented by a command buffer of its own.
+struct ImageObjects {
+    VkImage image = VK_NULL_HANDLE;
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    VkSemaphore rendered = VK_NULL_HANDLE;
+    VkFence submitted = VK_NULL_HANDLE;
+};
+
+static const struct {
+    const char *name;
+    VkFormat format;
+    uint32_t bytes_per_pixel;
+} kFormats[] = {
+    {"bgra8", VK_FORMAT_B8G8R8A8_UNORM, 4},
+    {"rgba8", VK_FORMAT_R8G8B8A8_UNORM, 4},
+    {"bgra8_srgb", VK_FORMAT_B8G8R8A8_SRGB, 4},
+    {"a2b10g10r10", VK_FORMAT_A2B10G10R10_UNORM_PACK32, 4},
+    {"rgba16f", VK_FORMAT_R16G16B16A16_SFLOAT, 8},
+};
+
+static bool Check(VkResult result, const char *call) {
+    if (result == VK_SUCCESS) return true;
+    std::fprintf(stderr, "%s failed with VkResult %d\n", call, static_cast<int>(result));
+    return false;
+}
+
+static uint32_t BytesPerPixel(VkFormat format) {
+    for (const auto &entry : kFormats) {
+        if (entry.format == format) return entry.bytes_per_pixel;
+    }
+    return 4;
+}
+
+static bool ParseOptions(int argc, char **argv, BenchmarkOptions &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        bool valid = true;
+        if (argument == "--layer" && i + 1 < argc) {
+            options.file_format = argv[++i];
+        } else if (argument == "--dir" && i + 1 < argc) {
+            options.directory = argv[++i];
+        } else if (argument == "--device" && i + 1 < argc) {
+            options.device_index = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+        } else if (argument == "--size" && i + 1 < argc) {
+            valid = std::sscanf(argv[++i], "%ux%u", &options.width, &options.height) == 2 && options.width > 0 &&
+                    options.height > 0;
+        } else if (argument == "--format" && i + 1 < argc) {
+            const std::string name = argv[++i];
+            valid = false;
+            for (const auto &entry : kFormats) {
+                if (name == entry.name) {
+                    options.format = entry.format;
+                    valid = true;
+                }
+            }
+        } else if (argument == "--frames" && i + 1 < argc) {
+            options.frames = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+        } else if (argument == "--interval" && i + 1 < argc) {
+            options.interval = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            std::fprintf(stderr,
+                         "Usage: %s [--layer <file format>] [--dir <directory>] [--device <index>] [--size <width>x<height>]\n"
+                         "          [--format bgra8|rgba8|bgra8_srgb|a2b10g10r10|rgba16f] [--frames <count>]\n"
+                         "          [--interval <frames>]\n"
+                         "Presents <frames> frames to a headless swapchain, with VK_LAYER_LUNARG_screenshot enabled if --layer\n"
+                         "is given, capturing one frame in every <interval> to files of the file format given in <directory>.\n",
+                         argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void SetEnvironment(const char *name, const std::string &value) {
+#ifdef _WIN32
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 1);
+#endif
+}
+
+// The most memory the process has used, in bytes, which includes what the layer queued to be written.
+static uint64_t PeakMemory() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage = {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+// The bytes of the files in the directory, to tell what the captures wrote from what was there before.
+static uint64_t DirectoryBytes(const std::string &directory) {
+    uint64_t bytes = 0;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (it->is_regular_file(error)) bytes += it->file_size(error);
+    }
+    return bytes;
+}
+
+static double Percentile(const std::vector<double> &sorted, double fraction) {
+    const size_t index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int main(int argc, char **argv) {
+    BenchmarkOptions options;
+    if (!ParseOptions(argc, argv, options)) return 1;
+
+    const bool enable_layer = !options.file_format.empty();
+    if (enable_layer) {
+        // The first frame is number 0, so the range captures every <interval> frames from it to the last.
+        const uint32_t captures = (options.frames + options.interval - 1) / options.interval;
+        SetEnvironment("VK_SCREENSHOT_FRAMES", "0-" + std::to_string(captures) + "-" + std::to_string(options.interval));
+        SetEnvironment("VK_SCREENSHOT_FILE_FORMAT", options.file_format);
+        SetEnvironment("VK_SCREENSHOT_DIR", options.directory);
+    }
+    const uint64_t directory_bytes = enable_layer ? DirectoryBytes(options.directory) : 0;
+
+    const char *layer_name = "VK_LAYER_LUNARG_screenshot";
+    const char *instance_extensions[] = {VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME};
+    VkApplicationInfo app_info = {VK_STRUCTURE_TYPE_APPLICATION_INFO};
+    app_info.pApplicationName = "screenshot_benchmark";
+    app_info.apiVersion = VK_API_VERSION_1_0;
+    VkInstanceCreateInfo instance_info = {VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+    instance_info.pApplicationInfo = &app_info;
+    instance_info.enabledLayerCount = enable_layer ? 1 : 0;
+    instance_info.ppEnabledLayerNames = &layer_name;
+    instance_info.enabledExtensionCount = 2;
+    instance_info.ppEnabledExtensionNames = instance_extensions;
+    VkInstance instance = VK_NULL_HANDLE;
+    if (!Check(vkCreateInstance(&instance_info, nullptr, &instance), "vkCreateInstance")) return 1;
+
+    uint32_t physical_device_count = 0;
+    if (!Check(vkEnumeratePhysicalDevices(instance, &physical_device_count, nullptr), "vkEnumeratePhysicalDevices")) return 1;
+    std::vector<VkPhysicalDevice> physical_devices(physical_device_count);
+    const VkResult enumerate_result = vkEnumeratePhysicalDevices(instance, &physical_device_count, physical_devices.data());
+    if (enumerate_result != VK_INCOMPLETE && !Check(enumerate_result, "vkEnumeratePhysicalDevices")) return 1;
+    if (options.device_index >= physical_device_count) {
+        std::fprintf(stderr, "There is no physical device %u, %u were found\n", options.device_index, physical_device_count);
+        return 1;
+    }
+    const VkPhysicalDevice physical_device = physical_devices[options.device_index];
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+    auto create_headless_surface =
+        reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT"));
+    if (create_headless_surface == nullptr) {
+        std::fprintf(stderr, "vkCreateHeadlessSurfaceEXT was not found\n");
+        return 1;
+    }
+    VkHeadlessSurfaceCreateInfoEXT surface_info = {VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT};
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    if (!Check(create_headless_surface(instance, &surface_info, nullptr, &surface), "vkCreateHeadlessSurfaceEXT")) return 1;
+
+    // The frames are cleared, which any queue family that can present and does graphics can do.
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, queue_families.data());
+    uint32_t queue_family = queue_family_count;
+    for (uint32_t i = 0; i < queue_family_count && queue_family == queue_family_count; ++i) {
+        VkBool32 supported = VK_FALSE;
+        vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, surface, &supported);
+        if (supported && (queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) queue_family = i;
+    }
+    if (queue_family == queue_family_count) {
+        std::fprintf(stderr, "%s has no graphics queue that can present\n", properties.deviceName);
+        return 1;
+    }
+
+    uint32_t surface_format_count = 0;
+    vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device, surface, &surface_format_count, nullptr);
+    std::vector<VkSurfaceFormatKHR> surface_formats(surface_format_count);
+    vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device, surface, &surface_format_count, surface_formats.data());
+    const auto surface_format =
+        std::find_if(surface_formats.begin(), surface_formats.end(),
+                     [&options](const VkSurfaceFormatKHR &entry) { return entry.format == options.format; });
+    if (surface_format == surface_formats.end()) {
+        std::fprintf(stderr, "%s cannot present VkFormat %d\n", properties.deviceName, static_cast<int>(options.format));
+        return 1;
+    }
+    VkSurfaceCapabilitiesKHR capabilities = {};
+    if (!Check(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physical_device, surface, &capabilities),
+               "vkGetPhysicalDeviceSurfaceCapabilitiesKHR")) {
+        return 1;
+    }
+
+    const char *device_extension = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+    const float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info = {VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+    queue_info.queueFamilyIndex = queue_family;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+    VkDeviceCreateInfo device_info = {VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    device_info.enabledExtensionCount = 1;
+    device_info.ppEnabledExtensionNames = &device_extension;
+    VkDevice device = VK_NULL_HANDLE;
+    if (!Check(vkCreateDevice(physical_device, &device_info, nullptr, &device), "vkCreateDevice")) return 1;
+    VkQueue queue = VK_NULL_HANDLE;
+    vkGetDeviceQueue(device, queue_family, 0, &queue);
+
+    // A headless surface has no size of its own, and FIFO is the one present mode every surface has.
+    VkSwapchainCreateInfoKHR swapchain_info = {VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR};
+    swapchain_info.surface = surface;
+    swapchain_info.minImageCount = capabilities.minImageCount + 1;
+    if (capabilities.maxImageCount != 0) {
+        swapchain_info.minImageCount = std::min(swapchain_info.minImageCount, capabilities.maxImageCount);
+    }
+    swapchain_info.imageFormat = surface_format->format;
+    swapchain_info.imageColorSpace = surface_format->colorSpace;
+    swapchain_info.imageExtent = {options.width, options.height};
+    swapchain_info.imageArrayLayers = 1;
+    swapchain_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    swapchain_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    swapchain_info.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    swapchain_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    swapchain_info.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    swapchain_info.clipped = VK_TRUE;
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    if (!Check(vkCreateSwapchainKHR(device, &swapchain_info, nullptr, &swapchain), "vkCreateSwapchainKHR")) return 1;
+
+    uint32_t image_count = 0;
+    vkGetSwapchainImagesKHR(device, swapchain, &image_count, nullptr);
+    std::vector<VkImage> swapchain_images(image_count);
+    if (!Check(vkGetSwapchainImagesKHR(device, swapchain, &image_count, swapchain_images.data()), "vkGetSwapchainImagesKHR")) {
+        return 1;
+    }
+
+    VkCommandPoolCreateInfo command_pool_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    command_pool_info.queueFamilyIndex = queue_family;
+    VkCommandPool command_pool = VK_NULL_HANDLE;
+    if (!Check(vkCreateCommandPool(device, &command_pool_info, nullptr, &command_pool), "vkCreateCommandPool")) return 1;
+
+    VkFenceCreateInfo acquire_fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VkFence acquired = VK_NULL_HANDLE;
+    if (!Check(vkCreateFence(device, &acquire_fence_info, nullptr, &acquired), "vkCreateFence")) return 1;
+
+    // Each image is cleared to a color of its own, so that a capture which skips duplicates still writes every frame.
+    std::vector<ImageObjects> images(image_count);
+    for (uint32_t i = 0; i < image_count; ++i) {
+        ImageObjects &objects = images[i];
+        objects.image = swapchain_images[i];
+        VkCommandBufferAllocateInfo command_buffer_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        command_buffer_info.commandPool = command_pool;
+        command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        command_buffer_info.commandBufferCount = 1;
+        if (!Check(vkAllocateCommandBuffers(device, &command_buffer_info, &objects.command_buffer), "vkAllocateCommandBuffers")) {
+            return 1;
+        }
+        VkSemaphoreCreateInfo semaphore_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        if (!Check(vkCreateSemaphore(device, &semaphore_info, nullptr, &objects.rendered), "vkCreateSemaphore")) return 1;
+        VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        if (!Check(vkCreateFence(device, &fence_info, nullptr, &objects.submitted), "vkCreateFence")) return 1;
+
+        VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = objects.image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        vkBeginCommandBuffer(objects.command_buffer, &begin_info);
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        vkCmdPipelineBarrier(objects.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                             0, nullptr, 1, &barrier);
+        const float shade = static_cast<float>(i + 1) / static_cast<float>(image_count);
+        const VkClearColorValue color = {{shade, 1.0f - shade, 0.5f, 1.0f}};
+        vkCmdClearColorImage(objects.command_buffer, objects.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1,
+                             &barrier.subresourceRange);
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        vkCmdPipelineBarrier(objects.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+                             nullptr, 0, nullptr, 1, &barrier);
+        if (!Check(vkEndCommandBuffer(objects.command_buffer), "vkEndCommandBuffer")) return 1;
+    }
+
+    std::vector<double> present_us;
+    present_us.reserve(options.frames);
+    const auto begin = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < options.frames; ++frame) {
+        uint32_t index = 0;
+        const VkResult acquire_result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, VK_NULL_HANDLE, acquired, &index);
+        if (acquire_result != VK_SUBOPTIMAL_KHR && !Check(acquire_result, "vkAcquireNextImageKHR")) return 1;
+        vkWaitForFences(device, 1, &acquired, VK_TRUE, UINT64_MAX);
+        vkResetFences(device, 1, &acquired);
+
+        ImageObjects &objects = images[index];
+        vkWaitForFences(device, 1, &objects.submitted, VK_TRUE, UINT64_MAX);
+        vkResetFences(device, 1, &objects.submitted);
+        VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &objects.command_buffer;
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores = &objects.rendered;
+        if (!Check(vkQueueSubmit(queue, 1, &submit_info, objects.submitted), "vkQueueSubmit")) return 1;
+
+        VkPresentInfoKHR present_info = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
+        present_info.waitSemaphoreCount = 1;
+        present_info.pWaitSemaphores = &objects.rendered;
+        present_info.swapchainCount = 1;
+        present_info.pSwapchains = &swapchain;
+        present_info.pImageIndices = &index;
+        const auto present_begin = std::chrono::steady_clock::now();
+        const VkResult present_result = vkQueuePresentKHR(queue, &present_info);
+        present_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - present_begin).count());
+        if (present_result != VK_SUBOPTIMAL_KHR && !Check(present_result, "vkQueuePresentKHR")) return 1;
+    }
+
+    vkDeviceWaitIdle(device);
+    for (ImageObjects &objects : images) {
+        vkDestroyFence(device, objects.submitted, nullptr);
+        vkDestroySemaphore(device, objects.rendered, nullptr);
+    }
+    vkDestroyFence(device, acquired, nullptr);
+    vkDestroyCommandPool(device, command_pool, nullptr);
+    vkDestroySwapchainKHR(device, swapchain, nullptr);
+    // The layer writes the last of its captures before vkDestroyDevice returns, so they are all in the time taken.
+    vkDestroyDevice(device, nullptr);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    vkDestroySurfaceKHR(instance, surface, nullptr);
+    vkDestroyInstance(instance, nullptr);
+
+    std::sort(present_us.begin(), present_us.end());
+    std::printf("%s, %ux%u, frames %u, present p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us", properties.deviceName,
+                options.width, options.height, options.frames, Percentile(present_us, 0.5), Percentile(present_us, 0.9),
+                Percentile(present_us, 0.99), present_us.back());
+    if (enable_layer) {
+        // The throughput is of the frames read back, which is what the layer copies whatever the file format.
+        const uint32_t captures = (options.frames + options.interval - 1) / options.interval;
+        const double frame_bytes = static_cast<double>(options.width) * options.height * BytesPerPixel(options.format);
+        const uint64_t bytes = DirectoryBytes(options.directory);
+        const uint64_t written = bytes > directory_bytes ? bytes - directory_bytes : 0;
+        std::printf(", captures %u, %.1f captures/s, %.1f MB/s, %.1f MB written", captures, captures / seconds,
+                    captures * frame_bytes / seconds / 1e6, static_cast<double>(written) / 1e6);
+    }
+    std::printf(", peak memory %.1f MB\n", static_cast<double>(PeakMemory()) / 1e6);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#!/bin/bash
+
+# screenshot_benchmark.sh
+# This script will run screenshot_benchmark, first without the screenshot layer and then with the layer writing each of
+# its file formats, PPM, PNG, QOI and raw images and Y4M video. For each run it reports the times of vkQueuePresentKHR,
+# the captures made each second and the megabytes of frames read back each second, and the peak memory of the process,
+# so that the overhead of the layer can be compared between releases. The benchmark runs on the mock ICD, which needs a
+# path to the Vulkan-Tools build directory. The path can be defined using the environment variable VULKAN_TOOLS_BUILD_DIR
+# or using the command-line argument -t or --tools. With --gpu, the benchmark runs on the drivers installed instead, which
+# need to support VK_EXT_headless_surface. The screenshot layer is found through VK_LAYER_PATH, as usual.
+
+DEVICE=0
+SIZE=1920x1080
+FORMAT=bgra8
+FRAMES=300
+INTERVAL=1
+USE_GPU=0
+
+# Track unrecognized arguments.
+UNRECOGNIZED=()
+
+# Parse the command-line arguments.
+while [[ $# -gt 0 ]]
+do
+   KEY="$1"
+   case $KEY in
+      -t|--tools)
+      VULKAN_TOOLS_BUILD_DIR="$2"
+      shift
+      shift
+      ;;
+      --gpu)
+      USE_GPU=1
+      shift
+      ;;
+      --device)
+      DEVICE="$2"
+      shift
+      shift
+      ;;
+      --size)
+      SIZE="$2"
+      shift
+      shift
+      ;;
+      --format)
+      FORMAT="$2"
+      shift
+      shift
+      ;;
+      --frames)
+      FRAMES="$2"
+      shift
+      shift
+      ;;
+      --interval)
+      INTERVAL="$2"
+      shift
+      shift
+      ;;
+      *)
+      UNRECOGNIZED+=("$1")
+      shift
+      ;;
+   esac
+done
+
+# Reject unrecognized arguments.
+if [[ ${#UNRECOGNIZED[@]} -ne 0 ]]; then
+   echo "ERROR: $0:$LINENO"
+   echo "Unrecognized command-line arguments: ${UNRECOGNIZED[*]}"
+   exit 1
+fi
+
+if [ $USE_GPU -eq 0 ]; then
+   if [ -z ${VULKAN_TOOLS_BUILD_DIR+x} ]; then
+      echo "ERROR: $0:$LINENO"
+      echo "Vulkan-Tools build directory is undefined."
+      echo "Please set VULKAN_TOOLS_BUILD_DIR or use the -t|--tools <path> command line option, or use --gpu."
+      exit 1
+   fi
+   export VK_ICD_FILENAMES="$VULKAN_TOOLS_BUILD_DIR/icd/VkICD_mock_icd.json"
+fi
+
+pushd $(dirname "${BASH_SOURCE[0]}") > /dev/null
+
+BENCHMARK="${SCREENSHOT_BENCHMARK:-./screenshot_benchmark}"
+OPTIONS="--device $DEVICE --size $SIZE --format $FORMAT --frames $FRAMES --interval $INTERVAL"
+
+printf "%-10s " "no layer"
+if ! "$BENCHMARK" $OPTIONS
+then
+   popd > /dev/null
+   exit 1
+fi
+
+# Each file format writes to a directory of its own, which is emptied after it is measured.
+for FILE_FORMAT in PPM PNG QOI RAW Y4M
+do
+   rm -rf screenshot_benchmark.tmp
+   mkdir screenshot_benchmark.tmp
+   printf "%-10s " "$FILE_FORMAT"
+   if ! "$BENCHMARK" $OPTIONS --layer $FILE_FORMAT --dir screenshot_benchmark.tmp
+   then
+      rm -rf screenshot_benchmark.tmp
+      popd > /dev/null
+      exit 1
+   fi
+done
+
+rm -rf screenshot_benchmark.tmp
+popd > /dev/null
+
+exit 0
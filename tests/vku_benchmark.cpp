@@ -0,0 +1,188 @@
+/* Copyright (c) 2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures what the layers pay to read their settings through vku. A synthetic vk_layer_settings.txt of many settings of other
+// layers is written, and many VK_ environment variables are set, then the first query of a setting is timed, which finds the
+// settings file, reads it and reads the environment, as a layer does when it starts. Each query of each setting type is then
+// timed again once the settings are loaded, along with a query of a table of settings and the creation of a registry. vku
+// reads the settings once per process, so the first query can only be timed once per run.
+//
+// With --max-startup-us, the benchmark fails when the first query takes longer, so that ctest catches the regressions of the
+// startup time of the layers. On Linux, the settings file of Vulkan Configurator takes precedence over the one written here, so
+// it should not be running.
+
+#include "../vku/vk_layer_settings.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static const char *kLayer = "VK_LAYER_LUNARG_benchmark";
+
+struct BenchmarkOptions {
+    std::string directory = ".";
+    uint32_t settings = 10000;
+    uint32_t variables = 1000;
+    uint32_t iterations = 100000;
+    double max_startup_us = 0.0;
+};
+
+static bool ParseOptions(int argc, char **argv, BenchmarkOptions &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        bool valid = true;
+        if (argument == "--dir" && i + 1 < argc) {
+            options.directory = argv[++i];
+        } else if (argument == "--settings" && i + 1 < argc) {
+            options.settings = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+        } else if (argument == "--env" && i + 1 < argc) {
+            options.variables = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+        } else if (argument == "--iterations" && i + 1 < argc) {
+            options.iterations = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+        } else if (argument == "--max-startup-us" && i + 1 < argc) {
+            options.max_startup_us = std::max(std::atof(argv[++i]), 0.0);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            std::fprintf(stderr,
+                         "Usage: %s [--dir <directory>] [--settings <count>] [--env <count>] [--iterations <count>]\n"
+                         "          [--max-startup-us <microseconds>]\n"
+                         "Writes a vk_layer_settings.txt of <count> settings to <directory>, sets <count> VK_ environment\n"
+                         "variables, then times the first query of a setting and <iterations> queries of each setting type.\n",
+                         argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void SetEnvironment(const char *name, const std::string &value) {
+#ifdef _WIN32
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 1);
+#endif
+}
+
+// The settings of the layer benchmarked are spread through the settings of other layers, like in a file Vulkan Configurator
+// writes for a configuration of several layers.
+static bool WriteSettings(const std::string &filename, uint32_t count) {
+    FILE *file = std::fopen(filename.c_str(), "w");
+    if (file == nullptr) {
+        std::fprintf(stderr, "Failed to write %s\n", filename.c_str());
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i % 100 == 0) std::fprintf(file, "# Settings of the layer %u\n", i / 100);
+        std::fprintf(file, "lunarg_filler_%u.setting_%u = value_%u\n", i / 100, i % 100, i);
+        if (i == count / 2) {
+            std::fprintf(file, "lunarg_benchmark.bool_setting = true\n");
+            std::fprintf(file, "lunarg_benchmark.int_setting = 76\n");
+            std::fprintf(file, "lunarg_benchmark.float_setting = 0.5\n");
+            std::fprintf(file, "lunarg_benchmark.string_setting = My string\n");
+            std::fprintf(file, "lunarg_benchmark.list_setting = item0,1,item2,3\n");
+        }
+    }
+    if (count == 0) std::fprintf(file, "lunarg_benchmark.bool_setting = true\n");
+    std::fclose(file);
+    return true;
+}
+
+// The time of each of a number of calls, in nanoseconds. The results are summed so that the calls are not optimized away.
+template <typename Function>
+static double TimeCalls(uint32_t iterations, Function function) {
+    static volatile std::size_t sink = 0;
+    std::size_t sum = 0;
+    const auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) sum += function();
+    const auto end = std::chrono::steady_clock::now();
+    sink = sink + sum;
+    return std::chrono::duration<double, std::nano>(end - begin).count() / iterations;
+}
+
+int main(int argc, char **argv) {
+    BenchmarkOptions options;
+    if (!ParseOptions(argc, argv, options)) return 1;
+
+    const std::string filename = options.directory + "/vk_layer_settings.txt";
+    if (!WriteSettings(filename, options.settings)) return 1;
+    SetEnvironment("VK_LAYER_SETTINGS_PATH", options.directory);
+    for (uint32_t i = 0; i < options.variables; ++i) {
+        SetEnvironment(("VK_FILLER_" + std::to_string(i)).c_str(), "value_" + std::to_string(i));
+    }
+    SetEnvironment("VK_LUNARG_BENCHMARK_ENV_SETTING", "env value");
+
+    const auto startup_begin = std::chrono::steady_clock::now();
+    const bool found = vku::IsLayerSetting(kLayer, "bool_setting");
+    const double startup_us =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startup_begin).count();
+    std::remove(filename.c_str());
+    if (!found) {
+        std::fprintf(stderr, "The settings written to %s were not read\n", filename.c_str());
+        return 1;
+    }
+
+    std::printf("settings %u, environment variables %u, first query %.1f us\n", options.settings, options.variables, startup_us);
+
+    const uint32_t n = options.iterations;
+    std::printf("  %-26s %8.1f ns\n", "IsLayerSetting miss", TimeCalls(n, [] { return vku::IsLayerSetting(kLayer, "missing"); }));
+    std::printf("  %-26s %8.1f ns\n", "GetLayerSettingBool",
+                TimeCalls(n, [] { return vku::GetLayerSettingBool(kLayer, "bool_setting"); }));
+    std::printf("  %-26s %8.1f ns\n", "GetLayerSettingInt",
+                TimeCalls(n, [] { return vku::GetLayerSettingInt(kLayer, "int_setting"); }));
+    std::printf("  %-26s %8.1f ns\n", "GetLayerSettingFloat",
+                TimeCalls(n, [] { return vku::GetLayerSettingFloat(kLayer, "float_setting") > 0.0; }));
+    std::printf("  %-26s %8.1f ns\n", "GetLayerSettingString",
+                TimeCalls(n, [] { return vku::GetLayerSettingString(kLayer, "string_setting").size(); }));
+    std::printf("  %-26s %8.1f ns\n", "GetLayerSettingString env",
+                TimeCalls(n, [] { return vku::GetLayerSettingString(kLayer, "env_setting").size(); }));
+    std::printf("  %-26s %8.1f ns\n", "GetLayerSettingList",
+                TimeCalls(n, [] { return vku::GetLayerSettingList(kLayer, "list_setting").size(); }));
+
+    // The table and the registry of the five settings read above, as a layer reads them when an instance is created
+    const vku::LayerSettingDeclaration declarations[] = {{"bool_setting", vku::LAYER_SETTING_TYPE_BOOL},
+                                                         {"int_setting", vku::LAYER_SETTING_TYPE_INT},
+                                                         {"float_setting", vku::LAYER_SETTING_TYPE_FLOAT},
+                                                         {"string_setting", vku::LAYER_SETTING_TYPE_STRING},
+                                                         {"list_setting", vku::LAYER_SETTING_TYPE_LIST}};
+    bool bool_value = false;
+    int int_value = 0;
+    double float_value = 0.0;
+    std::string string_value;
+    vku::List list_value;
+    const vku::LayerSettingBinding bindings[] = {{"bool_setting", vku::LAYER_SETTING_TYPE_BOOL, "false", &bool_value},
+                                                 {"int_setting", vku::LAYER_SETTING_TYPE_INT, "0", &int_value},
+                                                 {"float_setting", vku::LAYER_SETTING_TYPE_FLOAT, "0.0", &float_value},
+                                                 {"string_setting", vku::LAYER_SETTING_TYPE_STRING, "", &string_value},
+                                                 {"list_setting", vku::LAYER_SETTING_TYPE_LIST, "", &list_value}};
+    std::printf("  %-26s %8.1f ns\n", "GetLayerSettings x5", TimeCalls(n, [&] {
+                    vku::GetLayerSettings(kLayer, bindings, 5);
+                    return list_value.size();
+                }));
+    std::printf("  %-26s %8.1f ns\n", "LayerSettingRegistry x5", TimeCalls(n, [&] {
+                    const vku::LayerSettingRegistry registry(kLayer, declarations, 5);
+                    return registry.GetList(4).size();
+                }));
+
+    if (options.max_startup_us > 0.0 && startup_us > options.max_startup_us) {
+        std::fprintf(stderr, "The first query took %.1f us, more than the %.1f us allowed\n", startup_us, options.max_startup_us);
+        return 1;
+    }
+    return 0;
+}
@@ -19,30 +19,61 @@
 
 #include <iostream>
 #include <sstream>
+#include <cstdlib>
 #include <cstring>
 #include <map>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
 
 #include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <vulkan/vulkan.h>
 
 #include "via_system.hpp"
 
 #ifdef VIA_WINDOWS_TARGET
 #include <windows.h>
+#else
+#include <dlfcn.h>
+#include <dirent.h>
+#include <unistd.h>
 #endif
 
+// Increment when the content of the library cache file changes
+static const int LIBRARY_CACHE_VERSION = 1;
+
+// Increment when the content of the fingerprints file of the --diff mode changes
+static const int FINGERPRINTS_VERSION = 1;
+
+// Increment when the layout of the Json and NDJson reports changes
+static const int VIA_JSON_SCHEMA_VERSION = 1;
+
+// Default bound of each step, the cube tests with validation on a software driver take about a minute
+static const int DEFAULT_STEP_TIMEOUT_SECONDS = 120;
+
 ViaSystem::ViaSystem() {
     _generate_unique_file = false;
     _out_file = "";
     _directory_symbol = '/';
     _home_path = "~/";
     _app_version = "Version 1.3";
+    _step_timeout_seconds = DEFAULT_STEP_TIMEOUT_SECONDS;
+    _watchdog_stopping = false;
 }
 
 bool ViaSystem::Init(int argc, char** argv) {
     char* output_path = nullptr;
     // Check and handle command-line arguments
     _run_cube_tests = true;
+    _use_library_cache = true;
+    _run_benchmarks = false;
+    _measure_load_timing = false;
+    _diff_since_last_run = false;
     _out_file_format = VIA_HTML_FORMAT;
     if (argc > 1) {
         for (int iii = 1; iii < argc; iii++) {
@@ -55,12 +86,29 @@ bool ViaSystem::Init(int argc, char** argv) {
                 _run_cube_tests = false;
             } else if (0 == strcmp("--vkconfig_output", argv[iii])) {
                 _out_file_format = VIA_VKCONFIG_FORMAT;
+            } else if (0 == strcmp("--json_output", argv[iii])) {
+                _out_file_format = VIA_JSON_FORMAT;
+            } else if (0 == strcmp("--ndjson_output", argv[iii])) {
+                _out_file_format = VIA_NDJSON_FORMAT;
+            } else if (0 == strcmp("--no_cache", argv[iii])) {
+                _use_library_cache = false;
+            } else if (0 == strcmp("--benchmark", argv[iii])) {
+                _run_benchmarks = true;
+            } else if (0 == strcmp("--load_timing", argv[iii])) {
+                _measure_load_timing = true;
+            } else if (0 == strcmp("--diff", argv[iii])) {
+                _diff_since_last_run = true;
+            } else if (0 == strcmp("--timeout", argv[iii]) && argc > (iii + 1)) {
+                _step_timeout_seconds = std::max(atoi(argv[iii + 1]), 0);
+                ++iii;
             } else {
                 std::cout << "Usage of " << argv[0] << ":" << std::endl
                           << "    " << argv[0]
                           << " [--unique_output] "
                              "[--output_path <path>]"
                              " [--disable_cube_tests]"
+                             " [--json_output] [--ndjson_output] [--no_cache] [--benchmark] [--load_timing] [--diff]"
+                             " [--timeout <seconds>]"
                           << std::endl
                           << "          [--unique_output] Optional "
                              "parameter to generate a unique html"
@@ -77,6 +125,27 @@ bool ViaSystem::Init(int argc, char** argv) {
                           << std::endl
                           << "          [--disable_cube_tests] Optional parameter to disable running cube to test the Vulkan SDK "
                              "installation."
+                          << std::endl
+                          << "          [--json_output] Optional parameter to generate a machine-readable json output file "
+                             "instead of html."
+                          << std::endl
+                          << "          [--ndjson_output] Optional parameter to generate a json output file with one line per "
+                             "section instead of html."
+                          << std::endl
+                          << "          [--no_cache] Optional parameter to verify all the driver libraries again instead of "
+                             "reusing the results of the previous runs."
+                          << std::endl
+                          << "          [--benchmark] Optional parameter to run GPU micro-benchmarks on the logical devices."
+                          << std::endl
+                          << "          [--load_timing] Optional parameter to measure the time the implicit layers and the "
+                             "drivers add to the instance and device creation."
+                          << std::endl
+                          << "          [--diff] Optional parameter to only analyze the installation and only output what changed "
+                             "since the last run."
+                          << std::endl
+                          << "          [--timeout <seconds>] Optional parameter to change the time after which a step that hangs "
+                             "is stopped, "
+                          << DEFAULT_STEP_TIMEOUT_SECONDS << " by default, 0 to never stop."
                           << std::endl;
                 return false;
             }
@@ -125,8 +194,10 @@ bool ViaSystem::Init(int argc, char** argv) {
     } else {
         if (_out_file_format == VIA_HTML_FORMAT) {
             _out_file += ".html";
-        } else if (_out_file_format == VIA_VKCONFIG_FORMAT) {
+        } else if (_out_file_format == VIA_VKCONFIG_FORMAT || _out_file_format == VIA_JSON_FORMAT) {
             _out_file += ".json";
+        } else if (_out_file_format == VIA_NDJSON_FORMAT) {
+            _out_file += ".ndjson";
         }
     }
 
@@ -156,33 +227,88 @@ bool ViaSystem::Init(int argc, char** argv) {
     _vulkan_max_info = {};
     _vulkan_max_info.desired_api_version.major = 1;
     _vulkan_max_info.max_api_version.major = 1;
+
+    // The library verification results and the fingerprints of the --diff mode are saved in the user's home folder
+#ifdef VIA_WINDOWS_TARGET
+    _library_cache_path = _home_path + "vkvia_library_cache.json";
+    _fingerprints_path = _home_path + "vkvia_fingerprints.json";
+#else
+    const char* home_env_value = getenv("HOME");
+    if (home_env_value != NULL) {
+        _library_cache_path = std::string(home_env_value) + "/.vkvia_library_cache.json";
+        _fingerprints_path = std::string(home_env_value) + "/.vkvia_fingerprints.json";
+    }
+#endif
+    _library_cache_changed = false;
+    if (_use_library_cache) {
+        LoadLibraryCache();
+        _manifest_cache_path = vku::GetManifestCachePath();
+    }
     return true;
 }
 
 bool ViaSystem::GenerateInfo() {
     StartOutput("LunarG VIA");
+    StartWatchdog();
+    std::chrono::steady_clock::time_point start;
+    ArmWatchdog("System Info");
     ViaResults results = GenerateSystemInfo();
+    DisarmWatchdog();
+    SaveLibraryCache();
+    if (!_manifest_cache_path.empty()) {
+        _manifest_cache.Save(_manifest_cache_path);
+    }
+    if (_diff_since_last_run) {
+        // Only the installation is analyzed, the Vulkan API calls and the tests are skipped
+        const uint32_t change_count = KeepReportChanges();
+        if (change_count == 0) {
+            std::cerr << "UNCHANGED: No change of the Vulkan installation since the last run" << std::endl;
+        } else {
+            std::cerr << "CHANGED: " << change_count << " change(s) of the Vulkan installation since the last run" << std::endl;
+        }
+        goto print_results;
+    }
     if (results != VIA_SUCCESSFUL) {
         goto print_results;
     }
+    start = std::chrono::steady_clock::now();
+    ArmWatchdog("Vulkan API Calls");
     results = GenerateVulkanInfo();
+    DisarmWatchdog();
+    AddPassTiming("Vulkan API Calls", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), results);
     if (results != VIA_SUCCESSFUL) {
         goto print_results;
     }
 
+    if (_measure_load_timing) {
+        start = std::chrono::steady_clock::now();
+        results = GenerateLoadTimingInfo();
+        AddPassTiming("Load Timing", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), results);
+        if (results != VIA_SUCCESSFUL) {
+            goto print_results;
+        }
+    }
+
     if (_run_cube_tests) {
+        start = std::chrono::steady_clock::now();
         results = GenerateTestInfo();
+        AddPassTiming("External Tests", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), results);
         if (results != VIA_SUCCESSFUL) {
             goto print_results;
         }
     }
 
 print_results:
+    StopWatchdog();
+    _report_result = results;
     EndOutput();
 
     // Print out a useful message for any common errors.
     switch (results) {
         case VIA_SUCCESSFUL: {
+            if (_diff_since_last_run) {
+                break;
+            }
             std::string vulkan_version_string = "Vulkan ";
             vulkan_version_string += std::to_string(_vulkan_max_info.desired_api_version.major);
             vulkan_version_string += ".";
@@ -249,6 +375,7 @@ print_results:
 }
 
 ViaSystem::~ViaSystem() {
+    StopWatchdog();
     _out_ofstream.close();
 #ifdef VIA_WINDOWS_TARGET
     if (_out_file_format == VIA_HTML_FORMAT) {
@@ -275,11 +402,20 @@ ViaSystem::~ViaSystem() {
 #endif
 }
 
-void ViaSystem::LogError(const std::string& error) { std::cerr << "VIA_ERROR:   " << error << std::endl; }
+void ViaSystem::LogError(const std::string& error) {
+    if (RecordReportEntry(VIA_REPORT_LOG_ERROR, error)) return;
+    std::cerr << "VIA_ERROR:   " << error << std::endl;
+}
 
-void ViaSystem::LogWarning(const std::string& warning) { std::cerr << "VIA_WARNING: " << warning << std::endl; }
+void ViaSystem::LogWarning(const std::string& warning) {
+    if (RecordReportEntry(VIA_REPORT_LOG_WARNING, warning)) return;
+    std::cerr << "VIA_WARNING: " << warning << std::endl;
+}
 
-void ViaSystem::LogInfo(const std::string& info) { std::cerr << "VIA_INFO:    " << info << std::endl; }
+void ViaSystem::LogInfo(const std::string& info) {
+    if (RecordReportEntry(VIA_REPORT_LOG_INFO, info)) return;
+    std::cerr << "VIA_INFO:    " << info << std::endl;
+}
 
 bool ViaSystem::IsAbsolutePath(const std::string& path) {
     if (path[0] == _directory_symbol) {
@@ -288,6 +424,338 @@ bool ViaSystem::IsAbsolutePath(const std::string& path) {
     return false;
 }
 
+// Open the library to verify it can be loaded by the Vulkan loader. Loading a library initializes it, which is slow for
+// large drivers, so the result is reused while the library file is unchanged.
+bool ViaSystem::VerifyLibrary(const std::string& library_file, std::string& error) {
+    struct stat file_stat;
+    const bool found_file = stat(library_file.c_str(), &file_stat) == 0;
+    if (found_file) {
+        std::lock_guard<std::mutex> lock(_library_cache_mutex);
+
+        auto it = _library_cache.find(library_file);
+        if (it != _library_cache.end() && it->second.size == static_cast<int64_t>(file_stat.st_size) &&
+            it->second.modified == static_cast<int64_t>(file_stat.st_mtime) &&
+            it->second.inode == static_cast<uint64_t>(file_stat.st_ino)) {
+            it->second.used = true;
+            error = it->second.error;
+            return it->second.loaded;
+        }
+    }
+
+    bool loaded = false;
+#ifdef VIA_WINDOWS_TARGET
+    HMODULE handle = LoadLibraryA(library_file.c_str());
+    if (NULL == handle) {
+        error = "LoadLibrary failed with error " + std::to_string(GetLastError());
+    } else {
+        FreeLibrary(handle);
+        loaded = true;
+    }
+#else
+    void* handle = dlopen(library_file.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (NULL == handle) {
+        const char* dl_error = dlerror();
+        error = dl_error != NULL ? dl_error : "";
+    } else {
+        dlclose(handle);
+        loaded = true;
+    }
+#endif
+
+    if (found_file) {
+        std::lock_guard<std::mutex> lock(_library_cache_mutex);
+
+        LibraryCacheEntry entry;
+        entry.size = static_cast<int64_t>(file_stat.st_size);
+        entry.modified = static_cast<int64_t>(file_stat.st_mtime);
+        entry.inode = static_cast<uint64_t>(file_stat.st_ino);
+        entry.loaded = loaded;
+        entry.error = loaded ? "" : error;
+        entry.used = true;
+        _library_cache[library_file] = entry;
+        _library_cache_changed = true;
+    }
+
+    return loaded;
+}
+
+#ifdef VIA_WINDOWS_TARGET
+const ViaSystem::DirectoryIndex* ViaSystem::GetDirectoryIndex(const std::string& directory) {
+    (void)directory;
+    return NULL;
+}
+
+bool ViaSystem::DirectoryContains(const std::string& directory, const std::string& name) {
+    (void)directory;
+    (void)name;
+    return false;
+}
+#else
+const ViaSystem::DirectoryIndex* ViaSystem::GetDirectoryIndex(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(_directory_indices_mutex);
+
+    auto it = _directory_indices.find(directory);
+    if (it != _directory_indices.end()) {
+        return it->second.get();
+    }
+
+    std::unique_ptr<DirectoryIndex> index;
+    DIR* dir = opendir(directory.c_str());
+    if (NULL != dir) {
+        index.reset(new DirectoryIndex);
+        dirent* cur_ent;
+        while ((cur_ent = readdir(dir)) != NULL) {
+            index->entries.push_back(cur_ent->d_name);
+            index->names.insert(cur_ent->d_name);
+        }
+        closedir(dir);
+    }
+
+    // The indices are never removed, so the returned pointer stays valid for the whole run
+    const DirectoryIndex* result = index.get();
+    _directory_indices[directory] = std::move(index);
+    return result;
+}
+
+// Only the names found in the index are checked for read access, which is what most lookups need
+bool ViaSystem::DirectoryContains(const std::string& directory, const std::string& name) {
+    std::string folder = directory;
+    while (folder.size() > 1 && folder[folder.size() - 1] == '/') {
+        folder.erase(folder.size() - 1);
+    }
+
+    const DirectoryIndex* index = GetDirectoryIndex(folder);
+    if (index == NULL || index->names.find(name) == index->names.end()) {
+        return false;
+    }
+
+    const std::string full_name = folder == "/" ? folder + name : folder + "/" + name;
+    return access(full_name.c_str(), R_OK) != -1;
+}
+#endif
+
+void ViaSystem::LoadLibraryCache() {
+    if (_library_cache_path.empty()) return;
+
+    std::ifstream stream(_library_cache_path.c_str(), std::ifstream::in);
+    if (stream.fail()) return;
+
+    Json::Value root = Json::nullValue;
+    Json::Reader reader;
+    if (!reader.parse(stream, root, false) || !root.isObject()) return;
+    if (root["version"].asInt() != LIBRARY_CACHE_VERSION) return;
+
+    const Json::Value& libraries = root["libraries"];
+    if (!libraries.isObject()) return;
+
+    const std::vector<std::string>& library_files = libraries.getMemberNames();
+    for (std::size_t i = 0, n = library_files.size(); i < n; ++i) {
+        const Json::Value& library = libraries[library_files[i]];
+
+        LibraryCacheEntry entry;
+        entry.size = library["size"].asInt64();
+        entry.modified = library["modified"].asInt64();
+        entry.inode = library["inode"].asUInt64();
+        entry.loaded = library["loaded"].asBool();
+        entry.error = library["error"].asString();
+        entry.used = false;
+        _library_cache[library_files[i]] = entry;
+    }
+}
+
+// The libraries which were not verified by this run are forgotten
+void ViaSystem::SaveLibraryCache() {
+    std::lock_guard<std::mutex> lock(_library_cache_mutex);
+
+    for (auto it = _library_cache.begin(); it != _library_cache.end();) {
+        if (it->second.used) {
+            ++it;
+        } else {
+            it = _library_cache.erase(it);
+            _library_cache_changed = true;
+        }
+    }
+
+    if (!_library_cache_changed || _library_cache_path.empty()) return;
+
+    Json::Value libraries(Json::objectValue);
+    for (auto it = _library_cache.begin(); it != _library_cache.end(); ++it) {
+        Json::Value library(Json::objectValue);
+        library["size"] = static_cast<Json::Int64>(it->second.size);
+        library["modified"] = static_cast<Json::Int64>(it->second.modified);
+        library["inode"] = static_cast<Json::UInt64>(it->second.inode);
+        library["loaded"] = it->second.loaded;
+        if (!it->second.error.empty()) {
+            library["error"] = it->second.error;
+        }
+        libraries[it->first] = library;
+    }
+
+    Json::Value root(Json::objectValue);
+    root["version"] = LIBRARY_CACHE_VERSION;
+    root["libraries"] = libraries;
+
+    std::ofstream stream(_library_cache_path.c_str(), std::ofstream::out);
+    if (stream.fail()) {
+        LogWarning("Failed to write the library cache " + _library_cache_path);
+        return;
+    }
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "    ";
+    std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+    writer->write(root, &stream);
+    stream << "\n";
+
+    _library_cache_changed = false;
+}
+
+void ViaSystem::RecordManifest(const std::string& json_filename, vku::ManifestType type, const Json::Value& root) {
+    const Json::Value& section = root[type == vku::MANIFEST_TYPE_DRIVER ? "ICD" : "layer"];
+
+    if (_measure_load_timing && type == vku::MANIFEST_TYPE_DRIVER && section.isObject()) {
+        std::lock_guard<std::mutex> lock(_load_timing_mutex);
+        if (std::find(_load_timing_drivers.begin(), _load_timing_drivers.end(), json_filename) == _load_timing_drivers.end()) {
+            _load_timing_drivers.push_back(json_filename);
+        }
+    }
+
+    if (_manifest_cache_path.empty()) return;
+
+    vku::ManifestSummary summary;
+    summary.type = type;
+    summary.status = section.isObject() ? vku::MANIFEST_STATUS_VALID : vku::MANIFEST_STATUS_INVALID;
+    if (section.isObject()) {
+        if (type != vku::MANIFEST_TYPE_DRIVER) {
+            summary.name = section["name"].asString();
+        }
+        summary.library_path = section["library_path"].asString();
+        summary.api_version = section["api_version"].asString();
+    }
+
+    _manifest_cache.Record(json_filename, summary);
+}
+
+// FNV-1a, the fingerprints must be the same from one run to the next
+static uint64_t HashReportText(uint64_t hash, const std::string& text) {
+    for (std::size_t i = 0, n = text.size(); i < n; ++i) {
+        hash ^= static_cast<unsigned char>(text[i]);
+        hash *= 1099511628211ull;
+    }
+    // Separate the texts so that moving characters between two texts changes the hash
+    hash ^= 0x1f;
+    hash *= 1099511628211ull;
+    return hash;
+}
+
+std::string ViaSystem::FingerprintReportNode(const ViaReportNode& node) {
+    uint64_t hash = HashReportText(14695981039346656037ull, node.text);
+    for (std::size_t row = 0, row_count = node.rows.size(); row < row_count; ++row) {
+        for (std::size_t col = 0, col_count = node.rows[row].size(); col < col_count; ++col) {
+            hash = HashReportText(hash, node.rows[row][col].element);
+        }
+        hash = HashReportText(hash, "");
+    }
+
+    char fingerprint[32];
+    snprintf(fingerprint, sizeof(fingerprint), "%016llx", static_cast<unsigned long long>(hash));
+    return fingerprint;
+}
+
+// Fingerprint the tables and texts of the report, and only keep the ones which changed since the last run. The
+// fingerprints of the installation are saved for the next run. The "Hardware" table is left out, the free memory and
+// disk space change every run. Returns the number of tables and texts added, changed or removed.
+uint32_t ViaSystem::KeepReportChanges() {
+    std::map<std::string, std::string> previous_fingerprints;
+    if (!_fingerprints_path.empty()) {
+        std::ifstream stream(_fingerprints_path.c_str(), std::ifstream::in);
+        Json::Value root = Json::nullValue;
+        Json::Reader reader;
+        if (!stream.fail() && reader.parse(stream, root, false) && root.isObject() &&
+            root["version"].asInt() == FINGERPRINTS_VERSION && root["fingerprints"].isObject()) {
+            const Json::Value& fingerprints = root["fingerprints"];
+            const std::vector<std::string>& keys = fingerprints.getMemberNames();
+            for (std::size_t i = 0, n = keys.size(); i < n; ++i) {
+                previous_fingerprints[keys[i]] = fingerprints[keys[i]].asString();
+            }
+        }
+    }
+
+    std::map<std::string, std::string> fingerprints;
+    std::vector<ViaReportNode> changes;
+    std::vector<std::vector<std::string>> change_rows;
+
+    for (std::size_t i = 0, n = _report.size(); i < n; ++i) {
+        if (_report[i].type != VIA_NODE_SECTION) continue;
+
+        std::vector<ViaReportNode> kept_children;
+        for (std::size_t j = 0, m = _report[i].children.size(); j < m; ++j) {
+            const ViaReportNode& node = _report[i].children[j];
+            if (node.type == VIA_NODE_TABLE && node.text == "Hardware") continue;
+
+            // Standard texts are identified by their text, a changed text is reported as removed and added
+            std::string key = _report[i].text + "/" + node.text;
+            for (uint32_t duplicate = 2; fingerprints.count(key) != 0; ++duplicate) {
+                key = _report[i].text + "/" + node.text + " [" + std::to_string(duplicate) + "]";
+            }
+
+            const std::string fingerprint = FingerprintReportNode(node);
+            fingerprints[key] = fingerprint;
+
+            auto previous = previous_fingerprints.find(key);
+            if (previous == previous_fingerprints.end()) {
+                change_rows.push_back({key, "Added"});
+                kept_children.push_back(node);
+            } else if (previous->second != fingerprint) {
+                change_rows.push_back({key, "Changed"});
+                kept_children.push_back(node);
+            }
+        }
+        _report[i].children = kept_children;
+    }
+
+    for (auto it = previous_fingerprints.begin(); it != previous_fingerprints.end(); ++it) {
+        if (fingerprints.count(it->first) == 0) {
+            change_rows.push_back({it->first, "Removed"});
+        }
+    }
+
+    // The list of the changes is the first section of the report
+    ViaReportNode table = {VIA_NODE_TABLE, "Changes", false, 2, {}, {}};
+    if (change_rows.empty()) {
+        table.rows.push_back({{"No change since the last run", VIA_ALIGN_LEFT}, {"", VIA_ALIGN_LEFT}});
+    }
+    for (std::size_t i = 0, n = change_rows.size(); i < n; ++i) {
+        table.rows.push_back({{change_rows[i][0], VIA_ALIGN_LEFT}, {change_rows[i][1], VIA_ALIGN_LEFT}});
+    }
+    ViaReportNode section = {VIA_NODE_SECTION, "Changes Since Last Run", true, 0, {table}, {}};
+    _report.insert(_report.begin(), section);
+
+    if (!_fingerprints_path.empty()) {
+        Json::Value json_fingerprints(Json::objectValue);
+        for (auto it = fingerprints.begin(); it != fingerprints.end(); ++it) {
+            json_fingerprints[it->first] = it->second;
+        }
+
+        Json::Value root(Json::objectValue);
+        root["version"] = FINGERPRINTS_VERSION;
+        root["fingerprints"] = json_fingerprints;
+
+        std::ofstream stream(_fingerprints_path.c_str(), std::ofstream::out);
+        if (stream.fail()) {
+            LogWarning("Failed to write the fingerprints " + _fingerprints_path);
+        } else {
+            Json::StreamWriterBuilder builder;
+            builder["indentation"] = "    ";
+            std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+            writer->write(root, &stream);
+            stream << "\n";
+        }
+    }
+
+    return static_cast<uint32_t>(change_rows.size());
+}
+
 bool ViaSystem::DetermineJsonLibraryPath(const std::string& json_location, const std::string& json_library_info,
                                          std::string& library_location) {
     bool success = false;
@@ -330,46 +798,77 @@ bool ViaSystem::DetermineJsonLibraryPath(const std::string& json_location, const
     return success;
 }
 
+// Run the work for each index from 0 to count, on the calling thread and up to one worker thread per core
+void ViaSystem::RunConcurrently(std::size_t count, const std::function<void(std::size_t)>& work) {
+    std::atomic<std::size_t> next(0);
+
+    auto run = [&]() {
+        for (std::size_t i = next++; i < count; i = next++) {
+            work(i);
+        }
+    };
+
+    const std::size_t thread_count = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), count);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < thread_count; ++i) {
+        threads.push_back(std::thread(run));
+    }
+    run();
+    for (std::size_t i = 0, n = threads.size(); i < n; ++i) {
+        threads[i].join();
+    }
+}
+
 ViaSystem::ViaResults ViaSystem::GenerateSystemInfo() {
     ViaResults overall_result = VIA_SUCCESSFUL;
 
     BeginSection("System Info");
 
-    ViaResults result = PrintSystemEnvironmentInfo();
-    if (VIA_SUCCESSFUL != result) {
-        overall_result = result;
-    }
-    result = PrintSystemHardwareInfo();
-    if (VIA_SUCCESSFUL != result) {
-        overall_result = result;
-    }
-    result = PrintSystemExecutableInfo();
-    if (VIA_SUCCESSFUL != result) {
-        overall_result = result;
-    }
-    result = PrintSystemDriverInfo();
-    if (VIA_SUCCESSFUL != result) {
-        overall_result = result;
-    }
-    result = PrintSystemLoaderInfo();
-    if (VIA_SUCCESSFUL != result) {
-        overall_result = result;
-    }
-    result = PrintSystemSdkInfo();
-    if (VIA_SUCCESSFUL != result) {
-        overall_result = result;
-    }
-    result = PrintSystemImplicitLayerInfo();
-    if (VIA_SUCCESSFUL != result) {
-        overall_result = result;
-    }
-    result = PrintSystemExplicitLayerInfo();
-    if (VIA_SUCCESSFUL != result) {
-        overall_result = result;
-    }
-    result = PrintSystemSettingsFileInfo();
-    if (VIA_SUCCESSFUL != result) {
-        overall_result = result;
+    PrepareSystemInfo();
+
+    // Each pass walks the file system, parses JSON files and loads libraries, they run concurrently. The explicit layers
+    // scan searches the override paths found by the implicit layers scan, so both run in the same pass.
+    struct SystemInfoPass {
+        const char* name;
+        std::function<ViaResults()> run;
+    };
+
+    const std::vector<SystemInfoPass> passes = {
+        {"System Environment", [this]() { return PrintSystemEnvironmentInfo(); }},
+        {"System Hardware", [this]() { return PrintSystemHardwareInfo(); }},
+        {"System Executable", [this]() { return PrintSystemExecutableInfo(); }},
+        {"System Drivers", [this]() { return PrintSystemDriverInfo(); }},
+        {"System Loader", [this]() { return PrintSystemLoaderInfo(); }},
+        {"System SDK", [this]() { return PrintSystemSdkInfo(); }},
+        {"System Layers",
+         [this]() {
+             const ViaResults implicit_result = PrintSystemImplicitLayerInfo();
+             const ViaResults explicit_result = PrintSystemExplicitLayerInfo();
+             return VIA_SUCCESSFUL != explicit_result ? explicit_result : implicit_result;
+         }},
+        {"System Settings File", [this]() { return PrintSystemSettingsFileInfo(); }},
+    };
+
+    const std::size_t pass_count = passes.size();
+    std::vector<std::vector<ViaReportEntry>> reports(pass_count);
+    std::vector<ViaResults> results(pass_count, VIA_SUCCESSFUL);
+    std::vector<double> seconds(pass_count, 0.0);
+
+    RunConcurrently(pass_count, [&](std::size_t i) {
+        const auto start = std::chrono::steady_clock::now();
+        _recording_report = &reports[i];
+        results[i] = passes[i].run();
+        _recording_report = nullptr;
+        seconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    });
+
+    // The sections are written in the order the passes used to run one after another
+    for (std::size_t i = 0; i < pass_count; ++i) {
+        ReplayReport(reports[i]);
+        AddPassTiming(passes[i].name, seconds[i], results[i]);
+        if (VIA_SUCCESSFUL != results[i]) {
+            overall_result = results[i];
+        }
     }
 
     EndSection();
@@ -545,429 +1044,459 @@ ViaSystem::ViaResults ViaSystem::GenerateInstanceInfo(void) {
 // Print out any information we can find out about physical devices using
 // the Vulkan commands.  There should be one for each Vulkan capable device
 // on the system.
-ViaSystem::ViaResults ViaSystem::GeneratePhysDevInfo(void) {
+// Print the properties of the physical device enumerated by the Vulkan 1.0 instance at the index
+ViaSystem::ViaResults ViaSystem::GeneratePhysDevProperties(uint32_t dev, VkResult enumerate_status) {
     ViaResults res = VIA_SUCCESSFUL;
+    VkPhysicalDevice phys_dev = _vulkan_1_0_info.vk_physical_devices[dev].vk_phys_dev;
     VkPhysicalDeviceProperties props;
-    std::vector<VkPhysicalDevice> min_phys_devices;
-    std::vector<VkPhysicalDevice> max_phys_devices;
-    VkResult status;
+    VkResult status = enumerate_status;
     char generic_string[1024];
-    uint32_t gpu_count = 0;
-    uint32_t max_api_gpu_count = 0;
-    VulkanApiVersion max_overall_version = {};
-    max_overall_version.major = 1;
-    uint32_t iii;
     uint32_t jjj;
 
-    PrintBeginTable("Physical Devices", 4);
-
     PrintBeginTableRow();
-    PrintTableElement("vkEnumeratePhysicalDevices [1.0]");
-    status = vkEnumeratePhysicalDevices(_vulkan_1_0_info.vk_instance, &gpu_count, NULL);
+    snprintf(generic_string, 1023, "[%d]", dev);
+    PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
     if (status) {
         snprintf(generic_string, 1023, "ERROR: Failed to query - %d", status);
         PrintTableElement(generic_string);
         PrintTableElement("");
         PrintTableElement("");
         PrintEndTableRow();
-        res = VIA_VULKAN_CANT_FIND_DRIVER;
-        goto out;
     } else {
-        snprintf(generic_string, 1023, "%d", gpu_count);
+        snprintf(generic_string, 1023, "0x%p", phys_dev);
         PrintTableElement(generic_string);
         PrintTableElement("");
         PrintTableElement("");
         PrintEndTableRow();
-    }
 
-    min_phys_devices.resize(gpu_count);
-    _vulkan_1_0_info.vk_physical_devices.resize(gpu_count);
-    status = vkEnumeratePhysicalDevices(_vulkan_1_0_info.vk_instance, &gpu_count, min_phys_devices.data());
-    if (VK_SUCCESS != status && VK_INCOMPLETE != status) {
+        vkGetPhysicalDeviceProperties(phys_dev, &props);
+
         PrintBeginTableRow();
         PrintTableElement("");
-        PrintTableElement("Failed to enumerate physical devices!");
-        PrintTableElement("");
+        PrintTableElement("Vendor");
+        switch (props.vendorID) {
+            case 0x8086:
+            case 0x8087:
+                snprintf(generic_string, 1023, "Intel [0x%04x]", props.vendorID);
+                break;
+            case 0x1002:
+            case 0x1022:
+                snprintf(generic_string, 1023, "AMD [0x%04x]", props.vendorID);
+                break;
+            case 0x10DE:
+                snprintf(generic_string, 1023, "Nvidia [0x%04x]", props.vendorID);
+                break;
+            case 0x1EB5:
+                snprintf(generic_string, 1023, "ARM [0x%04x]", props.vendorID);
+                break;
+            case 0x5143:
+                snprintf(generic_string, 1023, "Qualcomm [0x%04x]", props.vendorID);
+                break;
+            case 0x1099:
+            case 0x10C3:
+            case 0x1249:
+            case 0x4E8:
+                snprintf(generic_string, 1023, "Samsung [0x%04x]", props.vendorID);
+                break;
+            default:
+                snprintf(generic_string, 1023, "0x%04x", props.vendorID);
+                break;
+        }
+        PrintTableElement(generic_string);
         PrintTableElement("");
         PrintEndTableRow();
-        res = VIA_VULKAN_CANT_FIND_DRIVER;
-        goto out;
-    }
 
-    for (iii = 0; iii < gpu_count; iii++) {
-        _vulkan_1_0_info.vk_physical_devices[iii].vk_phys_dev = min_phys_devices[iii];
+        PrintBeginTableRow();
+        PrintTableElement("");
+        PrintTableElement("Device Name");
+        PrintTableElement(props.deviceName);
+        PrintTableElement("");
+        PrintEndTableRow();
 
         PrintBeginTableRow();
-        snprintf(generic_string, 1023, "[%d]", iii);
-        PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
-        if (status) {
-            snprintf(generic_string, 1023, "ERROR: Failed to query - %d", status);
-            PrintTableElement(generic_string);
-            PrintTableElement("");
-            PrintTableElement("");
-            PrintEndTableRow();
-        } else {
-            snprintf(generic_string, 1023, "0x%p", min_phys_devices[iii]);
-            PrintTableElement(generic_string);
-            PrintTableElement("");
-            PrintTableElement("");
-            PrintEndTableRow();
+        PrintTableElement("");
+        PrintTableElement("Device ID");
+        snprintf(generic_string, 1023, "0x%x", props.deviceID);
+        PrintTableElement(generic_string);
+        PrintTableElement("");
+        PrintEndTableRow();
 
-            vkGetPhysicalDeviceProperties(min_phys_devices[iii], &props);
+        PrintBeginTableRow();
+        PrintTableElement("");
+        PrintTableElement("Device Type");
+        switch (props.deviceType) {
+            case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+                PrintTableElement("Integrated GPU");
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+                PrintTableElement("Discrete GPU");
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+                PrintTableElement("Virtual GPU");
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_CPU:
+                PrintTableElement("CPU");
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_OTHER:
+                PrintTableElement("Other");
+                break;
+            default:
+                PrintTableElement("INVALID!");
+                break;
+        }
+        PrintTableElement("");
+        PrintEndTableRow();
 
-            PrintBeginTableRow();
-            PrintTableElement("");
-            PrintTableElement("Vendor");
-            switch (props.vendorID) {
-                case 0x8086:
-                case 0x8087:
-                    snprintf(generic_string, 1023, "Intel [0x%04x]", props.vendorID);
-                    break;
-                case 0x1002:
-                case 0x1022:
-                    snprintf(generic_string, 1023, "AMD [0x%04x]", props.vendorID);
-                    break;
-                case 0x10DE:
-                    snprintf(generic_string, 1023, "Nvidia [0x%04x]", props.vendorID);
-                    break;
-                case 0x1EB5:
-                    snprintf(generic_string, 1023, "ARM [0x%04x]", props.vendorID);
-                    break;
-                case 0x5143:
-                    snprintf(generic_string, 1023, "Qualcomm [0x%04x]", props.vendorID);
-                    break;
-                case 0x1099:
-                case 0x10C3:
-                case 0x1249:
-                case 0x4E8:
-                    snprintf(generic_string, 1023, "Samsung [0x%04x]", props.vendorID);
-                    break;
-                default:
-                    snprintf(generic_string, 1023, "0x%04x", props.vendorID);
-                    break;
-            }
-            PrintTableElement(generic_string);
-            PrintTableElement("");
-            PrintEndTableRow();
+        PrintBeginTableRow();
+        PrintTableElement("");
+        PrintTableElement("Driver Version");
+        snprintf(generic_string, 1023, "%d.%d.%d", VK_VERSION_MAJOR(props.driverVersion), VK_VERSION_MINOR(props.driverVersion),
+                 VK_VERSION_PATCH(props.driverVersion));
+        PrintTableElement(generic_string);
+        PrintTableElement("");
+        PrintEndTableRow();
 
-            PrintBeginTableRow();
-            PrintTableElement("");
-            PrintTableElement("Device Name");
-            PrintTableElement(props.deviceName);
-            PrintTableElement("");
-            PrintEndTableRow();
+        PrintBeginTableRow();
+        PrintTableElement("");
+        PrintTableElement("API Version");
+        snprintf(generic_string, 1023, "%d.%d.%d", VK_VERSION_MAJOR(props.apiVersion), VK_VERSION_MINOR(props.apiVersion),
+                 VK_VERSION_PATCH(props.apiVersion));
+        PrintTableElement(generic_string);
+        PrintTableElement("");
+        PrintEndTableRow();
 
+        uint32_t queue_fam_count;
+        vkGetPhysicalDeviceQueueFamilyProperties(phys_dev, &queue_fam_count, NULL);
+        if (queue_fam_count > 0) {
             PrintBeginTableRow();
             PrintTableElement("");
-            PrintTableElement("Device ID");
-            snprintf(generic_string, 1023, "0x%x", props.deviceID);
+            PrintTableElement("Queue Families");
+            snprintf(generic_string, 1023, "%d", queue_fam_count);
             PrintTableElement(generic_string);
             PrintTableElement("");
             PrintEndTableRow();
 
-            PrintBeginTableRow();
-            PrintTableElement("");
-            PrintTableElement("Device Type");
-            switch (props.deviceType) {
-                case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
-                    PrintTableElement("Integrated GPU");
-                    break;
-                case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
-                    PrintTableElement("Discrete GPU");
-                    break;
-                case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
-                    PrintTableElement("Virtual GPU");
-                    break;
-                case VK_PHYSICAL_DEVICE_TYPE_CPU:
-                    PrintTableElement("CPU");
-                    break;
-                case VK_PHYSICAL_DEVICE_TYPE_OTHER:
-                    PrintTableElement("Other");
-                    break;
-                default:
-                    PrintTableElement("INVALID!");
-                    break;
-            }
-            PrintTableElement("");
-            PrintEndTableRow();
+            _vulkan_1_0_info.vk_physical_devices[dev].vk_queue_fam_props.resize(queue_fam_count);
+            vkGetPhysicalDeviceQueueFamilyProperties(phys_dev, &queue_fam_count,
+                                                     _vulkan_1_0_info.vk_physical_devices[dev].vk_queue_fam_props.data());
+            for (jjj = 0; jjj < queue_fam_count; jjj++) {
+                PrintBeginTableRow();
+                PrintTableElement("");
+                snprintf(generic_string, 1023, "[%d]", jjj);
+                PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
+                PrintTableElement("Queue Count");
+                snprintf(generic_string, 1023, "%d",
+                         _vulkan_1_0_info.vk_physical_devices[dev].vk_queue_fam_props[jjj].queueCount);
+                PrintTableElement(generic_string);
+                PrintEndTableRow();
 
-            PrintBeginTableRow();
-            PrintTableElement("");
-            PrintTableElement("Driver Version");
-            snprintf(generic_string, 1023, "%d.%d.%d", VK_VERSION_MAJOR(props.driverVersion), VK_VERSION_MINOR(props.driverVersion),
-                     VK_VERSION_PATCH(props.driverVersion));
-            PrintTableElement(generic_string);
-            PrintTableElement("");
-            PrintEndTableRow();
-
-            PrintBeginTableRow();
-            PrintTableElement("");
-            PrintTableElement("API Version");
-            snprintf(generic_string, 1023, "%d.%d.%d", VK_VERSION_MAJOR(props.apiVersion), VK_VERSION_MINOR(props.apiVersion),
-                     VK_VERSION_PATCH(props.apiVersion));
-            PrintTableElement(generic_string);
-            PrintTableElement("");
-            PrintEndTableRow();
-
-            uint32_t queue_fam_count;
-            vkGetPhysicalDeviceQueueFamilyProperties(min_phys_devices[iii], &queue_fam_count, NULL);
-            if (queue_fam_count > 0) {
                 PrintBeginTableRow();
                 PrintTableElement("");
-                PrintTableElement("Queue Families");
-                snprintf(generic_string, 1023, "%d", queue_fam_count);
-                PrintTableElement(generic_string);
                 PrintTableElement("");
-                PrintEndTableRow();
-
-                _vulkan_1_0_info.vk_physical_devices[iii].vk_queue_fam_props.resize(queue_fam_count);
-                vkGetPhysicalDeviceQueueFamilyProperties(min_phys_devices[iii], &queue_fam_count,
-                                                         _vulkan_1_0_info.vk_physical_devices[iii].vk_queue_fam_props.data());
-                for (jjj = 0; jjj < queue_fam_count; jjj++) {
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    snprintf(generic_string, 1023, "[%d]", jjj);
-                    PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
-                    PrintTableElement("Queue Count");
-                    snprintf(generic_string, 1023, "%d",
-                             _vulkan_1_0_info.vk_physical_devices[iii].vk_queue_fam_props[jjj].queueCount);
-                    PrintTableElement(generic_string);
-                    PrintEndTableRow();
-
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement("Queue Flags");
-                    generic_string[0] = '\0';
-                    bool prev_set = false;
-                    if (_vulkan_1_0_info.vk_physical_devices[iii].vk_queue_fam_props[jjj].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-                        strncat(generic_string, "GRAPHICS", 1023);
-                        prev_set = true;
-                    }
-                    if (_vulkan_1_0_info.vk_physical_devices[iii].vk_queue_fam_props[jjj].queueFlags & VK_QUEUE_COMPUTE_BIT) {
-                        if (prev_set) {
-                            strncat(generic_string, " | ", 1023);
-                        }
-                        strncat(generic_string, "COMPUTE", 1023);
-                        prev_set = true;
-                    }
-                    if (_vulkan_1_0_info.vk_physical_devices[iii].vk_queue_fam_props[jjj].queueFlags & VK_QUEUE_TRANSFER_BIT) {
-                        if (prev_set) {
-                            strncat(generic_string, " | ", 1023);
-                        }
-                        strncat(generic_string, "TRANSFER", 1023);
-                        prev_set = true;
+                PrintTableElement("Queue Flags");
+                generic_string[0] = '\0';
+                bool prev_set = false;
+                if (_vulkan_1_0_info.vk_physical_devices[dev].vk_queue_fam_props[jjj].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                    strncat(generic_string, "GRAPHICS", 1023);
+                    prev_set = true;
+                }
+                if (_vulkan_1_0_info.vk_physical_devices[dev].vk_queue_fam_props[jjj].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+                    if (prev_set) {
+                        strncat(generic_string, " | ", 1023);
                     }
-                    if (_vulkan_1_0_info.vk_physical_devices[iii].vk_queue_fam_props[jjj].queueFlags &
-                        VK_QUEUE_SPARSE_BINDING_BIT) {
-                        if (prev_set) {
-                            strncat(generic_string, " | ", 1023);
-                        }
-                        strncat(generic_string, "SPARSE_BINDING", 1023);
-                        prev_set = true;
+                    strncat(generic_string, "COMPUTE", 1023);
+                    prev_set = true;
+                }
+                if (_vulkan_1_0_info.vk_physical_devices[dev].vk_queue_fam_props[jjj].queueFlags & VK_QUEUE_TRANSFER_BIT) {
+                    if (prev_set) {
+                        strncat(generic_string, " | ", 1023);
                     }
-                    if (!prev_set) {
-                        strncat(generic_string, "--NONE--", 1023);
+                    strncat(generic_string, "TRANSFER", 1023);
+                    prev_set = true;
+                }
+                if (_vulkan_1_0_info.vk_physical_devices[dev].vk_queue_fam_props[jjj].queueFlags &
+                    VK_QUEUE_SPARSE_BINDING_BIT) {
+                    if (prev_set) {
+                        strncat(generic_string, " | ", 1023);
                     }
-                    PrintTableElement(generic_string);
-                    PrintEndTableRow();
-
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement("Timestamp Valid Bits");
-                    snprintf(generic_string, 1023, "0x%x",
-                             _vulkan_1_0_info.vk_physical_devices[iii].vk_queue_fam_props[jjj].timestampValidBits);
-                    PrintTableElement(generic_string);
-                    PrintEndTableRow();
-
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement("Image Granularity");
-                    PrintTableElement("");
-                    PrintEndTableRow();
-
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement("Width", VIA_ALIGN_RIGHT);
-                    snprintf(generic_string, 1023, "0x%x",
-                             _vulkan_1_0_info.vk_physical_devices[iii].vk_queue_fam_props[jjj].minImageTransferGranularity.width);
-                    PrintTableElement(generic_string);
-                    PrintEndTableRow();
-
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement("Height", VIA_ALIGN_RIGHT);
-                    snprintf(generic_string, 1023, "0x%x",
-                             _vulkan_1_0_info.vk_physical_devices[iii].vk_queue_fam_props[jjj].minImageTransferGranularity.height);
-                    PrintTableElement(generic_string);
-                    PrintEndTableRow();
-
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement("Depth", VIA_ALIGN_RIGHT);
-                    snprintf(generic_string, 1023, "0x%x",
-                             _vulkan_1_0_info.vk_physical_devices[iii].vk_queue_fam_props[jjj].minImageTransferGranularity.depth);
-                    PrintTableElement(generic_string);
-                    PrintEndTableRow();
+                    strncat(generic_string, "SPARSE_BINDING", 1023);
+                    prev_set = true;
                 }
-            } else {
+                if (!prev_set) {
+                    strncat(generic_string, "--NONE--", 1023);
+                }
+                PrintTableElement(generic_string);
+                PrintEndTableRow();
+
                 PrintBeginTableRow();
                 PrintTableElement("");
-                PrintTableElement("vkGetPhysicalDeviceQueueFamilyProperties");
-                PrintTableElement("FAILED: Returned 0!");
                 PrintTableElement("");
+                PrintTableElement("Timestamp Valid Bits");
+                snprintf(generic_string, 1023, "0x%x",
+                         _vulkan_1_0_info.vk_physical_devices[dev].vk_queue_fam_props[jjj].timestampValidBits);
+                PrintTableElement(generic_string);
                 PrintEndTableRow();
-            }
 
-            VkPhysicalDeviceMemoryProperties memory_props;
-            vkGetPhysicalDeviceMemoryProperties(min_phys_devices[iii], &memory_props);
+                PrintBeginTableRow();
+                PrintTableElement("");
+                PrintTableElement("");
+                PrintTableElement("Image Granularity");
+                PrintTableElement("");
+                PrintEndTableRow();
 
-            PrintBeginTableRow();
-            PrintTableElement("");
-            PrintTableElement("Memory Heaps");
-            snprintf(generic_string, 1023, "%d", memory_props.memoryHeapCount);
-            PrintTableElement(generic_string);
-            PrintTableElement("");
-            PrintEndTableRow();
+                PrintBeginTableRow();
+                PrintTableElement("");
+                PrintTableElement("");
+                PrintTableElement("Width", VIA_ALIGN_RIGHT);
+                snprintf(generic_string, 1023, "0x%x",
+                         _vulkan_1_0_info.vk_physical_devices[dev].vk_queue_fam_props[jjj].minImageTransferGranularity.width);
+                PrintTableElement(generic_string);
+                PrintEndTableRow();
 
-            for (jjj = 0; jjj < memory_props.memoryHeapCount; jjj++) {
                 PrintBeginTableRow();
                 PrintTableElement("");
-                snprintf(generic_string, 1023, "[%d]", jjj);
-                PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
-                PrintTableElement("Property Flags");
-                generic_string[0] = '\0';
-                bool prev_set = false;
-                if (memory_props.memoryHeaps[jjj].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
-                    strncat(generic_string, "DEVICE_LOCAL", 1023);
-                    prev_set = true;
-                }
-                if (!prev_set) {
-                    strncat(generic_string, "--NONE--", 1023);
-                }
+                PrintTableElement("");
+                PrintTableElement("Height", VIA_ALIGN_RIGHT);
+                snprintf(generic_string, 1023, "0x%x",
+                         _vulkan_1_0_info.vk_physical_devices[dev].vk_queue_fam_props[jjj].minImageTransferGranularity.height);
                 PrintTableElement(generic_string);
                 PrintEndTableRow();
 
                 PrintBeginTableRow();
                 PrintTableElement("");
                 PrintTableElement("");
-                PrintTableElement("Heap Size");
-                std::ostringstream heap_string;
-                heap_string << static_cast<uint64_t>(memory_props.memoryHeaps[jjj].size);
-                PrintTableElement(heap_string.str());
+                PrintTableElement("Depth", VIA_ALIGN_RIGHT);
+                snprintf(generic_string, 1023, "0x%x",
+                         _vulkan_1_0_info.vk_physical_devices[dev].vk_queue_fam_props[jjj].minImageTransferGranularity.depth);
+                PrintTableElement(generic_string);
                 PrintEndTableRow();
             }
+        } else {
+            PrintBeginTableRow();
+            PrintTableElement("");
+            PrintTableElement("vkGetPhysicalDeviceQueueFamilyProperties");
+            PrintTableElement("FAILED: Returned 0!");
+            PrintTableElement("");
+            PrintEndTableRow();
+        }
+
+        VkPhysicalDeviceMemoryProperties memory_props;
+        vkGetPhysicalDeviceMemoryProperties(phys_dev, &memory_props);
 
+        PrintBeginTableRow();
+        PrintTableElement("");
+        PrintTableElement("Memory Heaps");
+        snprintf(generic_string, 1023, "%d", memory_props.memoryHeapCount);
+        PrintTableElement(generic_string);
+        PrintTableElement("");
+        PrintEndTableRow();
+
+        for (jjj = 0; jjj < memory_props.memoryHeapCount; jjj++) {
             PrintBeginTableRow();
             PrintTableElement("");
-            PrintTableElement("Memory Types");
-            snprintf(generic_string, 1023, "%d", memory_props.memoryTypeCount);
+            snprintf(generic_string, 1023, "[%d]", jjj);
+            PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
+            PrintTableElement("Property Flags");
+            generic_string[0] = '\0';
+            bool prev_set = false;
+            if (memory_props.memoryHeaps[jjj].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                strncat(generic_string, "DEVICE_LOCAL", 1023);
+                prev_set = true;
+            }
+            if (!prev_set) {
+                strncat(generic_string, "--NONE--", 1023);
+            }
             PrintTableElement(generic_string);
+            PrintEndTableRow();
+
+            PrintBeginTableRow();
+            PrintTableElement("");
             PrintTableElement("");
+            PrintTableElement("Heap Size");
+            std::ostringstream heap_string;
+            heap_string << static_cast<uint64_t>(memory_props.memoryHeaps[jjj].size);
+            PrintTableElement(heap_string.str());
             PrintEndTableRow();
+        }
 
-            for (jjj = 0; jjj < memory_props.memoryTypeCount; jjj++) {
-                PrintBeginTableRow();
-                PrintTableElement("");
-                snprintf(generic_string, 1023, "[%d]", jjj);
-                PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
-                PrintTableElement("Property Flags");
-                generic_string[0] = '\0';
-                bool prev_set = false;
-                if (memory_props.memoryTypes[jjj].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
-                    strncat(generic_string, "DEVICE_LOCAL", 1023);
-                    prev_set = true;
-                }
-                if (memory_props.memoryTypes[jjj].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
-                    if (prev_set) {
-                        strncat(generic_string, " | ", 1023);
-                    }
-                    strncat(generic_string, "HOST_VISIBLE", 1023);
-                    prev_set = true;
-                }
-                if (memory_props.memoryTypes[jjj].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
-                    if (prev_set) {
-                        strncat(generic_string, " | ", 1023);
-                    }
-                    strncat(generic_string, "HOST_COHERENT", 1023);
-                    prev_set = true;
+        PrintBeginTableRow();
+        PrintTableElement("");
+        PrintTableElement("Memory Types");
+        snprintf(generic_string, 1023, "%d", memory_props.memoryTypeCount);
+        PrintTableElement(generic_string);
+        PrintTableElement("");
+        PrintEndTableRow();
+
+        for (jjj = 0; jjj < memory_props.memoryTypeCount; jjj++) {
+            PrintBeginTableRow();
+            PrintTableElement("");
+            snprintf(generic_string, 1023, "[%d]", jjj);
+            PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
+            PrintTableElement("Property Flags");
+            generic_string[0] = '\0';
+            bool prev_set = false;
+            if (memory_props.memoryTypes[jjj].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
+                strncat(generic_string, "DEVICE_LOCAL", 1023);
+                prev_set = true;
+            }
+            if (memory_props.memoryTypes[jjj].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+                if (prev_set) {
+                    strncat(generic_string, " | ", 1023);
                 }
-                if (memory_props.memoryTypes[jjj].propertyFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) {
-                    if (prev_set) {
-                        strncat(generic_string, " | ", 1023);
-                    }
-                    strncat(generic_string, "HOST_CACHED", 1023);
-                    prev_set = true;
+                strncat(generic_string, "HOST_VISIBLE", 1023);
+                prev_set = true;
+            }
+            if (memory_props.memoryTypes[jjj].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+                if (prev_set) {
+                    strncat(generic_string, " | ", 1023);
                 }
-                if (memory_props.memoryTypes[jjj].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
-                    if (prev_set) {
-                        strncat(generic_string, " | ", 1023);
-                    }
-                    strncat(generic_string, "LAZILY_ALLOC", 1023);
-                    prev_set = true;
+                strncat(generic_string, "HOST_COHERENT", 1023);
+                prev_set = true;
+            }
+            if (memory_props.memoryTypes[jjj].propertyFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) {
+                if (prev_set) {
+                    strncat(generic_string, " | ", 1023);
                 }
-                if (!prev_set) {
-                    strncat(generic_string, "--NONE--", 1023);
+                strncat(generic_string, "HOST_CACHED", 1023);
+                prev_set = true;
+            }
+            if (memory_props.memoryTypes[jjj].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+                if (prev_set) {
+                    strncat(generic_string, " | ", 1023);
                 }
-                PrintTableElement(generic_string);
-                PrintEndTableRow();
-
-                PrintBeginTableRow();
-                PrintTableElement("");
-                PrintTableElement("");
-                PrintTableElement("Heap Index");
-                snprintf(generic_string, 1023, "%d", memory_props.memoryTypes[jjj].heapIndex);
-                PrintTableElement(generic_string);
-                PrintEndTableRow();
+                strncat(generic_string, "LAZILY_ALLOC", 1023);
+                prev_set = true;
             }
-
-            uint32_t num_ext_props;
-            std::vector<VkExtensionProperties> ext_props;
+            if (!prev_set) {
+                strncat(generic_string, "--NONE--", 1023);
+            }
+            PrintTableElement(generic_string);
+            PrintEndTableRow();
 
             PrintBeginTableRow();
             PrintTableElement("");
-            PrintTableElement("Device Extensions");
-            status = vkEnumerateDeviceExtensionProperties(min_phys_devices[iii], NULL, &num_ext_props, NULL);
+            PrintTableElement("");
+            PrintTableElement("Heap Index");
+            snprintf(generic_string, 1023, "%d", memory_props.memoryTypes[jjj].heapIndex);
+            PrintTableElement(generic_string);
+            PrintEndTableRow();
+        }
+
+        uint32_t num_ext_props;
+        std::vector<VkExtensionProperties> ext_props;
+
+        PrintBeginTableRow();
+        PrintTableElement("");
+        PrintTableElement("Device Extensions");
+        status = vkEnumerateDeviceExtensionProperties(phys_dev, NULL, &num_ext_props, NULL);
+        if (VK_SUCCESS != status) {
+            PrintTableElement("FAILED querying number of extensions");
+            PrintTableElement("");
+            PrintEndTableRow();
+
+            res = VIA_VULKAN_CANT_FIND_EXTENSIONS;
+        } else {
+            snprintf(generic_string, 1023, "%d", num_ext_props);
+            PrintTableElement(generic_string);
+            ext_props.resize(num_ext_props);
+            status = vkEnumerateDeviceExtensionProperties(phys_dev, NULL, &num_ext_props, ext_props.data());
             if (VK_SUCCESS != status) {
-                PrintTableElement("FAILED querying number of extensions");
-                PrintTableElement("");
+                PrintTableElement("FAILED querying actual extension info");
                 PrintEndTableRow();
 
                 res = VIA_VULKAN_CANT_FIND_EXTENSIONS;
             } else {
-                snprintf(generic_string, 1023, "%d", num_ext_props);
-                PrintTableElement(generic_string);
-                ext_props.resize(num_ext_props);
-                status = vkEnumerateDeviceExtensionProperties(min_phys_devices[iii], NULL, &num_ext_props, ext_props.data());
-                if (VK_SUCCESS != status) {
-                    PrintTableElement("FAILED querying actual extension info");
-                    PrintEndTableRow();
+                PrintTableElement("");
+                PrintEndTableRow();
 
-                    res = VIA_VULKAN_CANT_FIND_EXTENSIONS;
-                } else {
+                for (jjj = 0; jjj < num_ext_props; jjj++) {
+                    PrintBeginTableRow();
                     PrintTableElement("");
+                    snprintf(generic_string, 1023, "[%d]", jjj);
+                    PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
+                    PrintTableElement(ext_props[jjj].extensionName);
+                    snprintf(generic_string, 1023, "Spec Vers %d", ext_props[jjj].specVersion);
+                    PrintTableElement(generic_string);
                     PrintEndTableRow();
-
-                    for (jjj = 0; jjj < num_ext_props; jjj++) {
-                        PrintBeginTableRow();
-                        PrintTableElement("");
-                        snprintf(generic_string, 1023, "[%d]", jjj);
-                        PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
-                        PrintTableElement(ext_props[jjj].extensionName);
-                        snprintf(generic_string, 1023, "Spec Vers %d", ext_props[jjj].specVersion);
-                        PrintTableElement(generic_string);
-                        PrintEndTableRow();
-                    }
                 }
             }
         }
     }
 
+    return res;
+}
+
+ViaSystem::ViaResults ViaSystem::GeneratePhysDevInfo(void) {
+    ViaResults res = VIA_SUCCESSFUL;
+    VkPhysicalDeviceProperties props;
+    std::vector<VkPhysicalDevice> min_phys_devices;
+    std::vector<VkPhysicalDevice> max_phys_devices;
+    VkResult status;
+    char generic_string[1024];
+    uint32_t gpu_count = 0;
+    uint32_t max_api_gpu_count = 0;
+    VulkanApiVersion max_overall_version = {};
+    max_overall_version.major = 1;
+    uint32_t iii;
+
+    PrintBeginTable("Physical Devices", 4);
+
+    PrintBeginTableRow();
+    PrintTableElement("vkEnumeratePhysicalDevices [1.0]");
+    status = vkEnumeratePhysicalDevices(_vulkan_1_0_info.vk_instance, &gpu_count, NULL);
+    if (status) {
+        snprintf(generic_string, 1023, "ERROR: Failed to query - %d", status);
+        PrintTableElement(generic_string);
+        PrintTableElement("");
+        PrintTableElement("");
+        PrintEndTableRow();
+        res = VIA_VULKAN_CANT_FIND_DRIVER;
+        goto out;
+    } else {
+        snprintf(generic_string, 1023, "%d", gpu_count);
+        PrintTableElement(generic_string);
+        PrintTableElement("");
+        PrintTableElement("");
+        PrintEndTableRow();
+    }
+
+    min_phys_devices.resize(gpu_count);
+    _vulkan_1_0_info.vk_physical_devices.resize(gpu_count);
+    status = vkEnumeratePhysicalDevices(_vulkan_1_0_info.vk_instance, &gpu_count, min_phys_devices.data());
+    if (VK_SUCCESS != status && VK_INCOMPLETE != status) {
+        PrintBeginTableRow();
+        PrintTableElement("");
+        PrintTableElement("Failed to enumerate physical devices!");
+        PrintTableElement("");
+        PrintTableElement("");
+        PrintEndTableRow();
+        res = VIA_VULKAN_CANT_FIND_DRIVER;
+        goto out;
+    }
+
+    for (iii = 0; iii < gpu_count; iii++) {
+        _vulkan_1_0_info.vk_physical_devices[iii].vk_phys_dev = min_phys_devices[iii];
+    }
+
+    // Each physical device is queried on its own worker, its table rows are recorded and written in order
+    {
+        std::vector<std::vector<ViaReportEntry>> reports(gpu_count);
+        std::vector<ViaResults> results(gpu_count, VIA_SUCCESSFUL);
+        RunConcurrently(gpu_count, [&](std::size_t dev) {
+            _recording_report = &reports[dev];
+            results[dev] = GeneratePhysDevProperties(static_cast<uint32_t>(dev), status);
+            _recording_report = nullptr;
+        });
+
+        for (iii = 0; iii < gpu_count; iii++) {
+            ReplayReport(reports[iii]);
+            if (VIA_SUCCESSFUL != results[iii]) {
+                res = results[iii];
+            }
+        }
+    }
+    }
+
     // Find out the max physical device API version first and set the max total version
     // to the minimum of the instance version and the highest phsycial device version.
     if (_vulkan_max_info.vk_instance != VK_NULL_HANDLE &&
@@ -1058,9 +1587,6 @@ out:
 // device for each physical device we found.
 ViaSystem::ViaResults ViaSystem::GenerateLogicalDeviceInfo() {
     ViaResults res = VIA_SUCCESSFUL;
-    VkDeviceCreateInfo device_create_info{};
-    VkDeviceQueueCreateInfo queue_create_info{};
-    VkResult status = VK_SUCCESS;
     uint32_t dev_count;
     char generic_string[1024];
     bool found_driver = false;
@@ -1093,13 +1619,15 @@ ViaSystem::ViaResults ViaSystem::GenerateLogicalDeviceInfo() {
         PrintTableElement("");
         PrintEndTableRow();
 
+        // The devices are created concurrently, device creation dominates on machines with several GPUs
         vulkan_info->vk_logical_devices.resize(dev_count);
-        for (uint32_t dev = 0; dev < dev_count; dev++) {
-            device_create_info = {};
+        std::vector<VkResult> statuses(dev_count, VK_SUCCESS);
+        RunConcurrently(dev_count, [&](std::size_t dev) {
+            VkDeviceCreateInfo device_create_info = {};
             device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
             float queue_priority = 0;
-            queue_create_info = {};
+            VkDeviceQueueCreateInfo queue_create_info = {};
             queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
             queue_create_info.pNext = NULL;
             queue_create_info.queueCount = 1;
@@ -1117,7 +1645,7 @@ ViaSystem::ViaResults ViaSystem::GenerateLogicalDeviceInfo() {
             std::vector<const char *> portability_device_extension_list;
             std::vector<VkExtensionProperties> ext_props;
             uint32_t prop_count = 0;
-            status = vkEnumerateDeviceExtensionProperties(phys_devices[dev].vk_phys_dev, NULL, &prop_count, NULL);
+            VkResult status = vkEnumerateDeviceExtensionProperties(phys_devices[dev].vk_phys_dev, NULL, &prop_count, NULL);
             ext_props.resize(prop_count);
             if (VK_SUCCESS == status) {
                 status = vkEnumerateDeviceExtensionProperties(phys_devices[dev].vk_phys_dev, NULL, &prop_count, ext_props.data());
@@ -1141,13 +1669,17 @@ ViaSystem::ViaResults ViaSystem::GenerateLogicalDeviceInfo() {
                  }
             }
 
+            statuses[dev] =
+                vkCreateDevice(phys_devices[dev].vk_phys_dev, &device_create_info, NULL, &vulkan_info->vk_logical_devices[dev]);
+        });
+
+        for (uint32_t dev = 0; dev < dev_count; dev++) {
             PrintBeginTableRow();
             PrintTableElement("");
             snprintf(generic_string, 1023, "[%d]", dev);
             PrintTableElement(generic_string);
 
-            status =
-                vkCreateDevice(phys_devices[dev].vk_phys_dev, &device_create_info, NULL, &vulkan_info->vk_logical_devices[dev]);
+            const VkResult status = statuses[dev];
             if (VK_ERROR_INCOMPATIBLE_DRIVER == status) {
                 PrintTableElement("FAILED: Incompatible Driver");
                 if (!found_driver) {
@@ -1167,19 +1699,473 @@ ViaSystem::ViaResults ViaSystem::GenerateLogicalDeviceInfo() {
                     res = VIA_VULKAN_FAILED_CREATE_DEVICE;
                 }
             } else {
-                PrintTableElement("VIA_SUCCESSFUL");
-                found_driver = true;
-                // Clear any potential previous errors
-                res = VIA_SUCCESSFUL;
+                PrintTableElement("VIA_SUCCESSFUL");
+                found_driver = true;
+                // Clear any potential previous errors
+                res = VIA_SUCCESSFUL;
+            }
+
+            PrintEndTableRow();
+        }
+    }
+
+    PrintEndTable();
+
+    return res;
+}
+
+// The benchmarks are short and fixed so that the results of several machines can be compared
+static const VkDeviceSize BENCHMARK_COPY_SIZE = 16 * 1024 * 1024;
+static const uint32_t BENCHMARK_COPY_COUNT = 8;
+static const VkDeviceSize BENCHMARK_ALLOCATION_SIZE = 1024 * 1024;
+static const uint32_t BENCHMARK_ALLOCATION_COUNT = 32;
+static const uint32_t BENCHMARK_SUBMIT_COUNT = 100;
+static const uint32_t BENCHMARK_DISPATCH_COUNT = 1000;
+static const uint32_t BENCHMARK_DISPATCH_GROUP_COUNT = 1024;
+static const uint32_t BENCHMARK_DISPATCH_LOCAL_SIZE = 64;
+
+// SPIR-V of a compute shader with an empty main function and a local size of 64x1x1
+static const uint32_t BENCHMARK_DISPATCH_SHADER[] = {
+    0x07230203, 0x00010000, 0x00000000, 0x00000005, 0x00000000,              // Header, the bound is 5
+    0x00020011, 0x00000001,                                                  // OpCapability Shader
+    0x0003000e, 0x00000000, 0x00000001,                                      // OpMemoryModel Logical GLSL450
+    0x0005000f, 0x00000005, 0x00000001, 0x6e69616d, 0x00000000,              // OpEntryPoint GLCompute %1 "main"
+    0x00060010, 0x00000001, 0x00000011, 0x00000040, 0x00000001, 0x00000001,  // OpExecutionMode %1 LocalSize 64 1 1
+    0x00020013, 0x00000002,                                                  // %2 = OpTypeVoid
+    0x00030021, 0x00000003, 0x00000002,                                      // %3 = OpTypeFunction %2
+    0x00050036, 0x00000002, 0x00000001, 0x00000000, 0x00000003,              // %1 = OpFunction %2 None %3
+    0x000200f8, 0x00000004,                                                  // %4 = OpLabel
+    0x000100fd,                                                              // OpReturn
+    0x00010038,                                                              // OpFunctionEnd
+};
+
+struct BenchmarkContext {
+    VkDevice device;
+    VkQueue queue;
+    uint32_t queue_family_index;
+    VkCommandPool command_pool;
+    VkCommandBuffer command_buffer;
+    VkFence fence;
+};
+
+static double SecondsSince(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Submit the recorded command buffer and wait for its completion, the time includes the submission
+static VkResult SubmitBenchmark(const BenchmarkContext& context, double& seconds) {
+    VkSubmitInfo submit_info = {};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &context.command_buffer;
+
+    const auto start = std::chrono::steady_clock::now();
+    VkResult status = vkQueueSubmit(context.queue, 1, &submit_info, context.fence);
+    if (VK_SUCCESS == status) {
+        status = vkWaitForFences(context.device, 1, &context.fence, VK_TRUE, UINT64_MAX);
+    }
+    seconds = SecondsSince(start);
+    if (VK_SUCCESS == status) {
+        status = vkResetFences(context.device, 1, &context.fence);
+    }
+    return status;
+}
+
+// Submit the recorded command buffer a first time to exclude the driver warm up, then measure a second submission
+static VkResult RunBenchmark(const BenchmarkContext& context, double& seconds) {
+    VkResult status = SubmitBenchmark(context, seconds);
+    if (VK_SUCCESS == status) {
+        status = SubmitBenchmark(context, seconds);
+    }
+    return status;
+}
+
+static VkResult CreateBenchmarkContext(VkDevice device, uint32_t queue_family_index, BenchmarkContext& context) {
+    context = {};
+    context.device = device;
+    context.queue_family_index = queue_family_index;
+    vkGetDeviceQueue(device, queue_family_index, 0, &context.queue);
+
+    VkCommandPoolCreateInfo pool_create_info = {};
+    pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_create_info.queueFamilyIndex = queue_family_index;
+    VkResult status = vkCreateCommandPool(device, &pool_create_info, NULL, &context.command_pool);
+    if (VK_SUCCESS != status) {
+        return status;
+    }
+
+    VkCommandBufferAllocateInfo command_buffer_info = {};
+    command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_info.commandPool = context.command_pool;
+    command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    command_buffer_info.commandBufferCount = 1;
+    status = vkAllocateCommandBuffers(device, &command_buffer_info, &context.command_buffer);
+    if (VK_SUCCESS != status) {
+        return status;
+    }
+
+    VkFenceCreateInfo fence_create_info = {};
+    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    return vkCreateFence(device, &fence_create_info, NULL, &context.fence);
+}
+
+static void DestroyBenchmarkContext(BenchmarkContext& context) {
+    if (VK_NULL_HANDLE != context.fence) {
+        vkDestroyFence(context.device, context.fence, NULL);
+    }
+    // Destroying the pool frees its command buffer
+    if (VK_NULL_HANDLE != context.command_pool) {
+        vkDestroyCommandPool(context.device, context.command_pool, NULL);
+    }
+    context = {};
+}
+
+static VkResult BeginBenchmarkCommands(const BenchmarkContext& context) {
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    return vkBeginCommandBuffer(context.command_buffer, &begin_info);
+}
+
+// Average time of an empty submission, from vkQueueSubmit to the fence being signaled
+static VkResult BenchmarkSubmitLatency(const BenchmarkContext& context, double& latency_seconds) {
+    VkResult status = BeginBenchmarkCommands(context);
+    if (VK_SUCCESS == status) {
+        status = vkEndCommandBuffer(context.command_buffer);
+    }
+
+    double total_seconds = 0.0;
+    for (uint32_t i = 0; i < BENCHMARK_SUBMIT_COUNT && VK_SUCCESS == status; ++i) {
+        double seconds = 0.0;
+        status = SubmitBenchmark(context, seconds);
+        total_seconds += seconds;
+    }
+
+    latency_seconds = total_seconds / BENCHMARK_SUBMIT_COUNT;
+    return status;
+}
+
+// Time of BENCHMARK_DISPATCH_COUNT dispatches of an empty compute shader recorded in a single command buffer
+static VkResult BenchmarkDispatch(const BenchmarkContext& context, double& seconds) {
+    VkShaderModule shader_module = VK_NULL_HANDLE;
+    VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    VkShaderModuleCreateInfo shader_create_info = {};
+    shader_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shader_create_info.codeSize = sizeof(BENCHMARK_DISPATCH_SHADER);
+    shader_create_info.pCode = BENCHMARK_DISPATCH_SHADER;
+    VkResult status = vkCreateShaderModule(context.device, &shader_create_info, NULL, &shader_module);
+
+    if (VK_SUCCESS == status) {
+        VkPipelineLayoutCreateInfo layout_create_info = {};
+        layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        status = vkCreatePipelineLayout(context.device, &layout_create_info, NULL, &pipeline_layout);
+    }
+
+    if (VK_SUCCESS == status) {
+        VkComputePipelineCreateInfo pipeline_create_info = {};
+        pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeline_create_info.stage.module = shader_module;
+        pipeline_create_info.stage.pName = "main";
+        pipeline_create_info.layout = pipeline_layout;
+        status = vkCreateComputePipelines(context.device, VK_NULL_HANDLE, 1, &pipeline_create_info, NULL, &pipeline);
+    }
+
+    if (VK_SUCCESS == status) {
+        status = BeginBenchmarkCommands(context);
+    }
+
+    if (VK_SUCCESS == status) {
+        vkCmdBindPipeline(context.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        for (uint32_t i = 0; i < BENCHMARK_DISPATCH_COUNT; ++i) {
+            vkCmdDispatch(context.command_buffer, BENCHMARK_DISPATCH_GROUP_COUNT, 1, 1);
+        }
+        status = vkEndCommandBuffer(context.command_buffer);
+    }
+
+    if (VK_SUCCESS == status) {
+        status = RunBenchmark(context, seconds);
+    }
+
+    if (VK_NULL_HANDLE != pipeline) {
+        vkDestroyPipeline(context.device, pipeline, NULL);
+    }
+    if (VK_NULL_HANDLE != pipeline_layout) {
+        vkDestroyPipelineLayout(context.device, pipeline_layout, NULL);
+    }
+    if (VK_NULL_HANDLE != shader_module) {
+        vkDestroyShaderModule(context.device, shader_module, NULL);
+    }
+
+    return status;
+}
+
+// Average time of vkAllocateMemory and vkFreeMemory of BENCHMARK_ALLOCATION_SIZE bytes in the memory type
+static VkResult BenchmarkAllocation(VkDevice device, uint32_t memory_type_index, double& allocate_seconds, double& free_seconds) {
+    std::vector<VkDeviceMemory> memories(BENCHMARK_ALLOCATION_COUNT, VK_NULL_HANDLE);
+
+    VkMemoryAllocateInfo allocate_info = {};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = BENCHMARK_ALLOCATION_SIZE;
+    allocate_info.memoryTypeIndex = memory_type_index;
+
+    VkResult status = VK_SUCCESS;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCHMARK_ALLOCATION_COUNT && VK_SUCCESS == status; ++i) {
+        status = vkAllocateMemory(device, &allocate_info, NULL, &memories[i]);
+    }
+    allocate_seconds = SecondsSince(start) / BENCHMARK_ALLOCATION_COUNT;
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCHMARK_ALLOCATION_COUNT; ++i) {
+        if (VK_NULL_HANDLE != memories[i]) {
+            vkFreeMemory(device, memories[i], NULL);
+        }
+    }
+    free_seconds = SecondsSince(start) / BENCHMARK_ALLOCATION_COUNT;
+
+    return status;
+}
+
+// Time of BENCHMARK_COPY_COUNT copies of BENCHMARK_COPY_SIZE bytes between two buffers of the memory type.
+// 'supported' is false when the buffers can't be bound to the memory type.
+static VkResult BenchmarkCopy(const BenchmarkContext& context, uint32_t memory_type_index, bool& supported, double& seconds) {
+    VkBuffer buffers[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+    VkDeviceMemory memories[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+    VkResult status = VK_SUCCESS;
+    supported = true;
+
+    for (uint32_t i = 0; i < 2 && VK_SUCCESS == status && supported; ++i) {
+        VkBufferCreateInfo buffer_create_info = {};
+        buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_create_info.size = BENCHMARK_COPY_SIZE;
+        buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        status = vkCreateBuffer(context.device, &buffer_create_info, NULL, &buffers[i]);
+        if (VK_SUCCESS != status) {
+            break;
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(context.device, buffers[i], &requirements);
+        if (0 == (requirements.memoryTypeBits & (1u << memory_type_index))) {
+            supported = false;
+            break;
+        }
+
+        VkMemoryAllocateInfo allocate_info = {};
+        allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocate_info.allocationSize = requirements.size;
+        allocate_info.memoryTypeIndex = memory_type_index;
+        status = vkAllocateMemory(context.device, &allocate_info, NULL, &memories[i]);
+        if (VK_SUCCESS == status) {
+            status = vkBindBufferMemory(context.device, buffers[i], memories[i], 0);
+        }
+    }
+
+    if (VK_SUCCESS == status && supported) {
+        status = BeginBenchmarkCommands(context);
+    }
+
+    if (VK_SUCCESS == status && supported) {
+        VkBufferCopy region = {};
+        region.size = BENCHMARK_COPY_SIZE;
+        for (uint32_t i = 0; i < BENCHMARK_COPY_COUNT; ++i) {
+            vkCmdCopyBuffer(context.command_buffer, buffers[i % 2], buffers[(i + 1) % 2], 1, &region);
+        }
+        status = vkEndCommandBuffer(context.command_buffer);
+    }
+
+    if (VK_SUCCESS == status && supported) {
+        status = RunBenchmark(context, seconds);
+    }
+
+    for (uint32_t i = 0; i < 2; ++i) {
+        if (VK_NULL_HANDLE != buffers[i]) {
+            vkDestroyBuffer(context.device, buffers[i], NULL);
+        }
+        if (VK_NULL_HANDLE != memories[i]) {
+            vkFreeMemory(context.device, memories[i], NULL);
+        }
+    }
+
+    return status;
+}
+
+// Run the micro-benchmarks on the logical devices created by GenerateLogicalDeviceInfo. The devices are created with a
+// single queue of the first graphics queue family, and the benchmarks only use Vulkan 1.0 commands.
+ViaSystem::ViaResults ViaSystem::GenerateBenchmarkInfo() {
+    char generic_string[1024];
+    std::vector<VulkanPhysicalDeviceInfo>& phys_devices = _vulkan_1_0_info.vk_physical_devices;
+    const uint32_t dev_count = static_cast<uint32_t>(_vulkan_1_0_info.vk_logical_devices.size());
+
+    PrintBeginTable("Benchmarks", 4);
+
+    for (uint32_t dev = 0; dev < dev_count; dev++) {
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(phys_devices[dev].vk_phys_dev, &props);
+
+        PrintBeginTableRow();
+        snprintf(generic_string, 1023, "[%d]", dev);
+        PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
+        PrintTableElement(props.deviceName);
+        PrintTableElement("");
+        PrintTableElement("");
+        PrintEndTableRow();
+
+        VkDevice device = _vulkan_1_0_info.vk_logical_devices[dev];
+        if (VK_NULL_HANDLE == device) {
+            PrintBeginTableRow();
+            PrintTableElement("");
+            PrintTableElement("Skipped: No logical device");
+            PrintTableElement("");
+            PrintTableElement("");
+            PrintEndTableRow();
+            continue;
+        }
+
+        // Same queue family as the one selected by GenerateLogicalDeviceInfo
+        uint32_t queue_family_index = 0;
+        for (uint32_t queue = 0; queue < phys_devices[dev].vk_queue_fam_props.size(); queue++) {
+            if (0 != (phys_devices[dev].vk_queue_fam_props[queue].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+                queue_family_index = queue;
+                break;
+            }
+        }
+        const VkQueueFlags queue_flags = phys_devices[dev].vk_queue_fam_props.empty()
+                                             ? 0
+                                             : phys_devices[dev].vk_queue_fam_props[queue_family_index].queueFlags;
+
+        BenchmarkContext context;
+        VkResult status = CreateBenchmarkContext(device, queue_family_index, context);
+
+        PrintBeginTableRow();
+        PrintTableElement("");
+        PrintTableElement("Queue Submit Latency");
+        double latency_seconds = 0.0;
+        if (VK_SUCCESS == status) {
+            status = BenchmarkSubmitLatency(context, latency_seconds);
+        }
+        if (VK_SUCCESS != status) {
+            snprintf(generic_string, 1023, "FAILED : VkResult code = 0x%x", status);
+            PrintTableElement(generic_string);
+            PrintTableElement("");
+        } else {
+            snprintf(generic_string, 1023, "%.1f us", latency_seconds * 1000000.0);
+            PrintTableElement(generic_string);
+            snprintf(generic_string, 1023, "%d submissions", BENCHMARK_SUBMIT_COUNT);
+            PrintTableElement(generic_string);
+        }
+        PrintEndTableRow();
+
+        PrintBeginTableRow();
+        PrintTableElement("");
+        PrintTableElement("Compute Dispatch Throughput");
+        if (VK_SUCCESS != status) {
+            PrintTableElement("Skipped");
+            PrintTableElement("");
+        } else if (0 == (queue_flags & VK_QUEUE_COMPUTE_BIT)) {
+            PrintTableElement("Skipped: No compute queue");
+            PrintTableElement("");
+        } else {
+            double seconds = 0.0;
+            VkResult dispatch_status = BenchmarkDispatch(context, seconds);
+            if (VK_SUCCESS != dispatch_status) {
+                snprintf(generic_string, 1023, "FAILED : VkResult code = 0x%x", dispatch_status);
+                PrintTableElement(generic_string);
+                PrintTableElement("");
+            } else {
+                const double invocations =
+                    static_cast<double>(BENCHMARK_DISPATCH_COUNT) * BENCHMARK_DISPATCH_GROUP_COUNT * BENCHMARK_DISPATCH_LOCAL_SIZE;
+                snprintf(generic_string, 1023, "%.0f dispatches/s", seconds > 0.0 ? BENCHMARK_DISPATCH_COUNT / seconds : 0.0);
+                PrintTableElement(generic_string);
+                snprintf(generic_string, 1023, "%.2f Ginvocations/s", seconds > 0.0 ? invocations / seconds / 1e9 : 0.0);
+                PrintTableElement(generic_string);
+            }
+        }
+        PrintEndTableRow();
+
+        VkPhysicalDeviceMemoryProperties memory_props;
+        vkGetPhysicalDeviceMemoryProperties(phys_devices[dev].vk_phys_dev, &memory_props);
+
+        for (uint32_t type = 0; type < memory_props.memoryTypeCount; type++) {
+            const VkMemoryType& memory_type = memory_props.memoryTypes[type];
+
+            PrintBeginTableRow();
+            PrintTableElement("");
+            snprintf(generic_string, 1023, "Memory Type [%d] Heap [%d]", type, memory_type.heapIndex);
+            PrintTableElement(generic_string);
+            PrintTableElement("");
+            PrintTableElement("");
+            PrintEndTableRow();
+
+            // Lazily allocated memory is only for transient attachments, and the heap must hold the two copy buffers
+            const bool skip_type = (memory_type.propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0 ||
+                                   memory_props.memoryHeaps[memory_type.heapIndex].size < 4 * BENCHMARK_COPY_SIZE;
+
+            PrintBeginTableRow();
+            PrintTableElement("");
+            PrintTableElement("Copy Bandwidth", VIA_ALIGN_RIGHT);
+            if (VK_SUCCESS != status || skip_type) {
+                PrintTableElement("Skipped");
+                PrintTableElement("");
+            } else {
+                bool supported = true;
+                double seconds = 0.0;
+                VkResult copy_status = BenchmarkCopy(context, type, supported, seconds);
+                if (VK_SUCCESS != copy_status) {
+                    snprintf(generic_string, 1023, "FAILED : VkResult code = 0x%x", copy_status);
+                    PrintTableElement(generic_string);
+                    PrintTableElement("");
+                } else if (!supported) {
+                    PrintTableElement("Skipped: Unsupported by transfer buffers");
+                    PrintTableElement("");
+                } else {
+                    const double bytes = static_cast<double>(BENCHMARK_COPY_SIZE) * BENCHMARK_COPY_COUNT;
+                    snprintf(generic_string, 1023, "%.2f GB/s", seconds > 0.0 ? bytes / seconds / 1e9 : 0.0);
+                    PrintTableElement(generic_string);
+                    snprintf(generic_string, 1023, "%d x %d MB", BENCHMARK_COPY_COUNT,
+                             static_cast<int>(BENCHMARK_COPY_SIZE / (1024 * 1024)));
+                    PrintTableElement(generic_string);
+                }
             }
+            PrintEndTableRow();
 
+            PrintBeginTableRow();
+            PrintTableElement("");
+            PrintTableElement("Allocate / Free Latency", VIA_ALIGN_RIGHT);
+            if (skip_type) {
+                PrintTableElement("Skipped");
+                PrintTableElement("");
+            } else {
+                double allocate_seconds = 0.0;
+                double free_seconds = 0.0;
+                VkResult allocation_status = BenchmarkAllocation(device, type, allocate_seconds, free_seconds);
+                if (VK_SUCCESS != allocation_status) {
+                    snprintf(generic_string, 1023, "FAILED : VkResult code = 0x%x", allocation_status);
+                    PrintTableElement(generic_string);
+                    PrintTableElement("");
+                } else {
+                    snprintf(generic_string, 1023, "%.1f us / %.1f us", allocate_seconds * 1000000.0, free_seconds * 1000000.0);
+                    PrintTableElement(generic_string);
+                    snprintf(generic_string, 1023, "%d x %d MB", BENCHMARK_ALLOCATION_COUNT,
+                             static_cast<int>(BENCHMARK_ALLOCATION_SIZE / (1024 * 1024)));
+                    PrintTableElement(generic_string);
+                }
+            }
             PrintEndTableRow();
         }
+
+        DestroyBenchmarkContext(context);
     }
 
     PrintEndTable();
 
-    return res;
+    // A failing benchmark is reported in its table row, it doesn't make the Vulkan analysis fail
+    return VIA_SUCCESSFUL;
 }
 
 // Clean up all the Vulkan items we previously created and print
@@ -1269,6 +2255,12 @@ ViaSystem::ViaResults ViaSystem::GenerateVulkanInfo(void) {
     if (res != VIA_SUCCESSFUL) {
         goto out;
     }
+    if (_run_benchmarks) {
+        res = GenerateBenchmarkInfo();
+        if (res != VIA_SUCCESSFUL) {
+            goto out;
+        }
+    }
 
 out:
 
@@ -1281,312 +2273,840 @@ out:
     return res;
 }
 
+// Each configuration is measured several times and the fastest run is kept. The libraries are already in the file system
+// cache after the Vulkan API calls, so the timings are the ones of a warm application start.
+static const uint32_t LOAD_TIMING_RUN_COUNT = 3;
+
+struct LoadTiming {
+    VkResult status;
+    double instance_seconds;  // vkCreateInstance and vkEnumeratePhysicalDevices
+    double device_seconds;    // vkCreateDevice of every physical device
+    uint32_t device_count;
+};
+
+// Sets, or removes when 'value' is null, an environment variable of the process until the end of the scope. The loader reads
+// the variables in vkCreateInstance.
+class ScopedEnvironmentValue {
+   public:
+    ScopedEnvironmentValue(const std::string& name, const char* value) : _name(name), _had_previous(false) {
+#ifdef VIA_WINDOWS_TARGET
+        const DWORD size = GetEnvironmentVariableA(name.c_str(), NULL, 0);
+        if (size > 0) {
+            std::vector<char> previous(size);
+            GetEnvironmentVariableA(name.c_str(), previous.data(), size);
+            _previous = previous.data();
+            _had_previous = true;
+        }
+#else
+        const char* previous = getenv(name.c_str());
+        if (previous != NULL) {
+            _previous = previous;
+            _had_previous = true;
+        }
+#endif
+        Set(value);
+    }
+
+    ~ScopedEnvironmentValue() { Set(_had_previous ? _previous.c_str() : NULL); }
+
+   private:
+    ScopedEnvironmentValue(const ScopedEnvironmentValue&) = delete;
+    ScopedEnvironmentValue& operator=(const ScopedEnvironmentValue&) = delete;
+
+    void Set(const char* value) {
+#ifdef VIA_WINDOWS_TARGET
+        SetEnvironmentVariableA(_name.c_str(), value);
+#else
+        if (value != NULL) {
+            setenv(_name.c_str(), value, 1);
+        } else {
+            unsetenv(_name.c_str());
+        }
+#endif
+    }
+
+    std::string _name;
+    std::string _previous;
+    bool _had_previous;
+};
+
+static VkResult MeasureLoadTimingRun(LoadTiming& timing) {
+    timing.instance_seconds = 0.0;
+    timing.device_seconds = 0.0;
+    timing.device_count = 0;
+
+    VkApplicationInfo app_info = {};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "via";
+    app_info.applicationVersion = 1;
+    app_info.pEngineName = "via";
+    app_info.engineVersion = 1;
+    app_info.apiVersion = VK_API_VERSION_1_0;
+
+    VkInstanceCreateInfo inst_info = {};
+    inst_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    inst_info.pApplicationInfo = &app_info;
+
+    // Same portability enumeration as GenerateInstanceInfo, so that the same drivers are loaded
+    std::vector<const char*> instance_extensions;
+    uint32_t prop_count = 0;
+    std::vector<VkExtensionProperties> ext_props;
+    if (VK_SUCCESS == vkEnumerateInstanceExtensionProperties(NULL, &prop_count, NULL)) {
+        ext_props.resize(prop_count);
+        if (VK_SUCCESS != vkEnumerateInstanceExtensionProperties(NULL, &prop_count, ext_props.data())) {
+            ext_props.clear();
+        }
+    }
+    for (const auto& extension : ext_props) {
+        if (strcmp(extension.extensionName, VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME) == 0) {
+            instance_extensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+            inst_info.flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
+        }
+    }
+    inst_info.enabledExtensionCount = static_cast<uint32_t>(instance_extensions.size());
+    inst_info.ppEnabledExtensionNames = instance_extensions.data();
+
+    auto start = std::chrono::steady_clock::now();
+    VkInstance instance = VK_NULL_HANDLE;
+    VkResult status = vkCreateInstance(&inst_info, NULL, &instance);
+    if (VK_SUCCESS != status) {
+        return status;
+    }
+
+    uint32_t dev_count = 0;
+    std::vector<VkPhysicalDevice> phys_devices;
+    status = vkEnumeratePhysicalDevices(instance, &dev_count, NULL);
+    if (VK_SUCCESS == status) {
+        phys_devices.resize(dev_count);
+        status = vkEnumeratePhysicalDevices(instance, &dev_count, phys_devices.data());
+    }
+    timing.instance_seconds = SecondsSince(start);
+
+    for (uint32_t dev = 0; VK_SUCCESS == status && dev < dev_count; dev++) {
+        // Every device has a queue family 0, the cost of the device creation doesn't depend on its capabilities
+        float queue_priority = 0;
+        VkDeviceQueueCreateInfo queue_create_info = {};
+        queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queue_create_info.queueFamilyIndex = 0;
+        queue_create_info.queueCount = 1;
+        queue_create_info.pQueuePriorities = &queue_priority;
+
+        std::vector<const char*> device_extensions;
+        uint32_t device_prop_count = 0;
+        std::vector<VkExtensionProperties> device_ext_props;
+        if (VK_SUCCESS == vkEnumerateDeviceExtensionProperties(phys_devices[dev], NULL, &device_prop_count, NULL)) {
+            device_ext_props.resize(device_prop_count);
+            if (VK_SUCCESS !=
+                vkEnumerateDeviceExtensionProperties(phys_devices[dev], NULL, &device_prop_count, device_ext_props.data())) {
+                device_ext_props.clear();
+            }
+        }
+        for (const auto& extension : device_ext_props) {
+            if (strcmp(extension.extensionName, VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME) == 0) {
+                device_extensions.push_back(VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME);
+            }
+        }
+
+        VkDeviceCreateInfo device_create_info = {};
+        device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        device_create_info.queueCreateInfoCount = 1;
+        device_create_info.pQueueCreateInfos = &queue_create_info;
+        device_create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
+        device_create_info.ppEnabledExtensionNames = device_extensions.data();
+
+        start = std::chrono::steady_clock::now();
+        VkDevice device = VK_NULL_HANDLE;
+        status = vkCreateDevice(phys_devices[dev], &device_create_info, NULL, &device);
+        timing.device_seconds += SecondsSince(start);
+        if (VK_SUCCESS == status) {
+            vkDestroyDevice(device, NULL);
+            timing.device_count++;
+        }
+    }
+
+    vkDestroyInstance(instance, NULL);
+    return status;
+}
+
+// The fastest of LOAD_TIMING_RUN_COUNT runs, with the environment of the process
+static LoadTiming MeasureLoadTiming() {
+    LoadTiming timing = {};
+    for (uint32_t run = 0; run < LOAD_TIMING_RUN_COUNT; run++) {
+        LoadTiming run_timing;
+        timing.status = MeasureLoadTimingRun(run_timing);
+        if (VK_SUCCESS != timing.status) {
+            break;
+        }
+        if (run == 0 || run_timing.instance_seconds + run_timing.device_seconds <
+                            timing.instance_seconds + timing.device_seconds) {
+            timing = run_timing;
+            timing.status = VK_SUCCESS;
+        }
+    }
+    return timing;
+}
+
+// Format the timing cells of a configuration, the cost is the time the configuration adds to, or removes from, the reference
+static void FormatLoadTiming(const LoadTiming& timing, const LoadTiming* reference, std::string& instance_str,
+                             std::string& device_str, std::string& cost_str) {
+    char generic_string[1024];
+    if (VK_SUCCESS != timing.status) {
+        snprintf(generic_string, 1023, "FAILED : VkResult code = 0x%x", timing.status);
+        instance_str = generic_string;
+        device_str = "";
+        cost_str = "";
+        return;
+    }
+
+    snprintf(generic_string, 1023, "%.2f ms", timing.instance_seconds * 1000.0);
+    instance_str = generic_string;
+    snprintf(generic_string, 1023, "%.2f ms (%d)", timing.device_seconds * 1000.0, timing.device_count);
+    device_str = generic_string;
+    if (reference == NULL || VK_SUCCESS != reference->status) {
+        cost_str = "";
+    } else {
+        const double cost = (reference->instance_seconds + reference->device_seconds) -
+                            (timing.instance_seconds + timing.device_seconds);
+        snprintf(generic_string, 1023, "%+.2f ms", cost * 1000.0);
+        cost_str = generic_string;
+    }
+}
+
+// Measure the time each implicit layer and each driver adds to the creation of an instance and of the devices. The implicit
+// layers, such as overlays and capture tools, are loaded by every application and often explain a slow start.
+ViaSystem::ViaResults ViaSystem::GenerateLoadTimingInfo() {
+    std::string instance_str;
+    std::string device_str;
+    std::string cost_str;
+
+    BeginSection("Load Timing");
+
+    PrintStandardText("Fastest of " + std::to_string(LOAD_TIMING_RUN_COUNT) +
+                      " runs of vkCreateInstance and vkEnumeratePhysicalDevices, then of vkCreateDevice for each physical "
+                      "device. The cost of an implicit layer is the time saved by disabling it with its disable environment "
+                      "variable. The drivers are measured alone, with the implicit layers disabled.");
+
+    PrintBeginTable("Implicit Layers", 4);
+    PrintBeginTableRow();
+    PrintTableElement("Configuration");
+    PrintTableElement("Instance");
+    PrintTableElement("Devices");
+    PrintTableElement("Cost");
+    PrintEndTableRow();
+
+    // Each configuration is a step of the watchdog, so that the report names the layer or the driver which hangs
+    ArmWatchdog("Load Timing with all the implicit layers enabled");
+    const LoadTiming enabled_timing = MeasureLoadTiming();
+    FormatLoadTiming(enabled_timing, NULL, instance_str, device_str, cost_str);
+    PrintBeginTableRow();
+    PrintTableElement("All Implicit Layers Enabled");
+    PrintTableElement(instance_str);
+    PrintTableElement(device_str);
+    PrintTableElement(cost_str);
+    PrintEndTableRow();
+
+    for (std::size_t i = 0, n = _load_timing_layers.size(); i < n; ++i) {
+        const LoadTimingLayer& layer = _load_timing_layers[i];
+        LoadTiming timing;
+        {
+            ScopedEnvironmentValue disable(layer.disable_env_variable, layer.disable_env_value.c_str());
+            ArmWatchdog("Load Timing with " + layer.name + " disabled");
+            timing = MeasureLoadTiming();
+        }
+        FormatLoadTiming(timing, &enabled_timing, instance_str, device_str, cost_str);
+        PrintBeginTableRow();
+        PrintTableElement(layer.name, VIA_ALIGN_RIGHT);
+        PrintTableElement(instance_str);
+        PrintTableElement(device_str);
+        PrintTableElement(cost_str);
+        PrintEndTableRow();
+    }
+
+    std::vector<std::unique_ptr<ScopedEnvironmentValue>> disabled_layers;
+    for (std::size_t i = 0, n = _load_timing_layers.size(); i < n; ++i) {
+        disabled_layers.emplace_back(new ScopedEnvironmentValue(_load_timing_layers[i].disable_env_variable,
+                                                                _load_timing_layers[i].disable_env_value.c_str()));
+    }
+
+    ArmWatchdog("Load Timing with all the implicit layers disabled");
+    const LoadTiming disabled_timing = MeasureLoadTiming();
+    FormatLoadTiming(disabled_timing, &enabled_timing, instance_str, device_str, cost_str);
+    PrintBeginTableRow();
+    PrintTableElement("All Implicit Layers Disabled");
+    PrintTableElement(instance_str);
+    PrintTableElement(device_str);
+    PrintTableElement(cost_str);
+    PrintEndTableRow();
+    PrintEndTable();
+
+    PrintBeginTable("Drivers", 4);
+    PrintBeginTableRow();
+    PrintTableElement("Manifest");
+    PrintTableElement("Instance");
+    PrintTableElement("Devices");
+    PrintTableElement("");
+    PrintEndTableRow();
+
+    // Each driver manifest replaces the drivers the loader would find, VK_ICD_FILENAMES is the name used by the older loaders
+    for (std::size_t i = 0, n = _load_timing_drivers.size(); i < n; ++i) {
+        LoadTiming timing;
+        {
+            ScopedEnvironmentValue driver_files("VK_DRIVER_FILES", _load_timing_drivers[i].c_str());
+            ScopedEnvironmentValue icd_filenames("VK_ICD_FILENAMES", _load_timing_drivers[i].c_str());
+            ScopedEnvironmentValue add_driver_files("VK_ADD_DRIVER_FILES", NULL);
+            ArmWatchdog("Load Timing of " + _load_timing_drivers[i]);
+            timing = MeasureLoadTiming();
+        }
+        FormatLoadTiming(timing, NULL, instance_str, device_str, cost_str);
+        PrintBeginTableRow();
+        PrintTableElement(_load_timing_drivers[i]);
+        PrintTableElement(instance_str);
+        PrintTableElement(device_str);
+        PrintTableElement("");
+        PrintEndTableRow();
+    }
+    PrintEndTable();
+    DisarmWatchdog();
+
+    EndSection();
+
+    // A failing measure is reported in its table row, it doesn't make the Vulkan analysis fail
+    return VIA_SUCCESSFUL;
+}
+
 // Print methods
 
 void ViaSystem::StartOutput(const std::string& title) {
-    if (_out_file_format == VIA_HTML_FORMAT) {
-        StartOutputHTML(title);
-    } else if (_out_file_format == VIA_VKCONFIG_FORMAT) {
-        StartOutputVkConfig(title);
-    }
+    _report_title = title;
+    _report_result = VIA_SUCCESSFUL;
+    _report_passes.clear();
+    _report.clear();
+
+    char timestamp[64] = "";
+    time_t time_raw_format;
+    time(&time_raw_format);
+    tm* ptr_time = gmtime(&time_raw_format);
+    if (ptr_time != NULL) {
+        strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", ptr_time);
+    }
+    _report_timestamp = timestamp;
 }
 
-// Close out writing to the file.
+// Serialize the report, the file is written at once instead of flushed line by line
 void ViaSystem::EndOutput() {
     if (_out_file_format == VIA_HTML_FORMAT) {
-        EndOutputHTML();
+        WriteReportHTML(_out_ofstream);
     } else if (_out_file_format == VIA_VKCONFIG_FORMAT) {
-        EndOutputVkConfig();
+        WriteReportVkConfig(_out_ofstream);
+    } else if (_out_file_format == VIA_JSON_FORMAT) {
+        WriteReportJson(_out_ofstream);
+    } else if (_out_file_format == VIA_NDJSON_FORMAT) {
+        WriteReportNdJson(_out_ofstream);
     }
+    _out_ofstream.flush();
 }
 
-void ViaSystem::BeginSection(const std::string& section_str) {
-    if (_out_file_format == VIA_HTML_FORMAT) {
-        BeginSectionHTML(section_str);
-    } else if (_out_file_format == VIA_VKCONFIG_FORMAT) {
-        BeginSectionVkConfig(section_str);
+// The nodes are added to the section which is not ended yet, or to the root of the report
+std::vector<ViaSystem::ViaReportNode>& ViaSystem::GetCurrentReportNodes() {
+    if (!_report.empty() && _report.back().type == VIA_NODE_SECTION && !_report.back().ended) {
+        return _report.back().children;
     }
+    return _report;
+}
+
+ViaSystem::ViaReportNode* ViaSystem::GetCurrentReportTable() {
+    std::vector<ViaReportNode>& nodes = GetCurrentReportNodes();
+    if (nodes.empty() || nodes.back().type != VIA_NODE_TABLE) return nullptr;
+    return &nodes.back();
+}
+
+void ViaSystem::BeginSection(const std::string& section_str) {
+    if (RecordReportEntry(VIA_REPORT_BEGIN_SECTION, section_str)) return;
+
+    ViaReportNode node = {VIA_NODE_SECTION, section_str, false, 0, {}, {}};
+    _report.push_back(node);
 }
 
 void ViaSystem::EndSection() {
-    if (_out_file_format == VIA_HTML_FORMAT) {
-        EndSectionHTML();
-    } else if (_out_file_format == VIA_VKCONFIG_FORMAT) {
-        EndSectionVkConfig();
+    if (RecordReportEntry(VIA_REPORT_END_SECTION)) return;
+
+    if (!_report.empty() && _report.back().type == VIA_NODE_SECTION) {
+        _report.back().ended = true;
     }
 }
 
 void ViaSystem::PrintStandardText(const std::string& text_str) {
-    if (_out_file_format == VIA_HTML_FORMAT) {
-        PrintStandardTextHTML(text_str);
-    } else if (_out_file_format == VIA_VKCONFIG_FORMAT) {
-        PrintStandardTextVkConfig(text_str);
-    }
+    if (RecordReportEntry(VIA_REPORT_STANDARD_TEXT, text_str)) return;
+
+    ViaReportNode node = {VIA_NODE_STANDARD_TEXT, text_str, false, 0, {}, {}};
+    GetCurrentReportNodes().push_back(node);
 }
 
 void ViaSystem::PrintBeginTable(const std::string& table_name, uint32_t num_cols) {
-    if (_out_file_format == VIA_HTML_FORMAT) {
-        PrintBeginTableHTML(table_name, num_cols);
-    } else if (_out_file_format == VIA_VKCONFIG_FORMAT) {
-        PrintBeginTableVkConfig(table_name);
-    }
+    if (RecordReportEntry(VIA_REPORT_BEGIN_TABLE, table_name, num_cols)) return;
+
+    ViaReportNode node = {VIA_NODE_TABLE, table_name, false, num_cols, {}, {}};
+    GetCurrentReportNodes().push_back(node);
 }
 
 void ViaSystem::PrintBeginTableRow() {
-    if (_out_file_format == VIA_HTML_FORMAT) {
-        PrintBeginTableRowHTML();
-    } else if (_out_file_format == VIA_VKCONFIG_FORMAT) {
-        PrintBeginTableRowVkConfig();
-    }
+    if (RecordReportEntry(VIA_REPORT_BEGIN_TABLE_ROW)) return;
+
+    ViaReportNode* table = GetCurrentReportTable();
+    if (table == nullptr) return;
+
+    table->rows.push_back(std::vector<ViaReportCell>());
 }
 
 void ViaSystem::PrintTableElement(const std::string& element, ViaElementAlign align) {
-    if (_out_file_format == VIA_HTML_FORMAT) {
-        PrintTableElementHTML(element, align);
-    } else if (_out_file_format == VIA_VKCONFIG_FORMAT) {
-        PrintTableElementVkConfig(element);
+    if (RecordReportEntry(VIA_REPORT_TABLE_ELEMENT, element, align)) return;
+
+    ViaReportNode* table = GetCurrentReportTable();
+    if (table == nullptr) return;
+
+    if (table->rows.empty()) {
+        table->rows.push_back(std::vector<ViaReportCell>());
     }
+    ViaReportCell cell = {element, align};
+    table->rows.back().push_back(cell);
 }
 
+// A row ends with the next row, and a table ends with the next node
 void ViaSystem::PrintEndTableRow() {
-    if (_out_file_format == VIA_HTML_FORMAT) {
-        PrintEndTableRowHTML();
-    } else if (_out_file_format == VIA_VKCONFIG_FORMAT) {
-        PrintEndTableRowVkConfig();
-    }
+    if (RecordReportEntry(VIA_REPORT_END_TABLE_ROW)) return;
 }
 
 void ViaSystem::PrintEndTable() {
-    if (_out_file_format == VIA_HTML_FORMAT) {
-        PrintEndTableHTML();
-    } else if (_out_file_format == VIA_VKCONFIG_FORMAT) {
-        PrintEndTableVkConfig();
-    }
-}
-
-// HTML methods
-
-// Start writing to the HTML file by creating the appropriate
-// header information including the appropriate CSS and JavaScript
-// items.
-void ViaSystem::StartOutputHTML(const std::string& title) {
-    _out_ofstream << "<!DOCTYPE html>" << std::endl;
-    _out_ofstream << "<HTML lang=\"en\" xml:lang=\"en\" "
-                     "xmlns=\"http://www.w3.org/1999/xhtml\">"
-                  << std::endl;
-    _out_ofstream << std::endl << "<HEAD>" << std::endl << "    <TITLE>" << title << "</TITLE>" << std::endl;
-
-    _out_ofstream << "    <META charset=\"UTF-8\">" << std::endl
-                  << "    <style media=\"screen\" type=\"text/css\">" << std::endl
-                  << "        html {"
-                  << std::endl
-                  // By defining the color first, this won't override the background image
-                  // (unless the images aren't there).
-                  << "            background-color: #0b1e48;"
-                  << std::endl
-                  // The following changes try to load the text image twice (locally, then
-                  // off the web) followed by the background image twice (locally, then
-                  // off the web).  The background color will only show if both background
-                  // image loads fail.  In this way, a user will see their local copy on
-                  // their machine, while a person they share it with will see the web
-                  // images (or the background color).
-                  << "            background-image: url(\"https://vulkan.lunarg.com/img/VIATitle.png\"), "
-                  << "url(\"https://vulkan.lunarg.com/img/VIABackground.jpg\");" << std::endl
-                  << "            background-position: center top, center;" << std::endl
-                  << "            -webkit-background-size: auto, cover;" << std::endl
-                  << "            -moz-background-size: auto, cover;" << std::endl
-                  << "            -o-background-size: auto, cover;" << std::endl
-                  << "            background-size: auto, cover;" << std::endl
-                  << "            background-attachment: scroll, fixed;" << std::endl
-                  << "            background-repeat: no-repeat, no-repeat;" << std::endl
-                  << "        }"
-                  << std::endl
-                  // h1.section is used for section headers, and h1.version is used to
-                  // print out the application version text (which shows up just under
-                  // the title).
-                  << "        h1.section {" << std::endl
-                  << "            font-family: sans-serif;" << std::endl
-                  << "            font-size: 35px;" << std::endl
-                  << "            color: #FFFFFF;" << std::endl
-                  << "        }" << std::endl
-                  << "        h1.version {" << std::endl
-                  << "            font-family: sans-serif;" << std::endl
-                  << "            font-size: 25px;" << std::endl
-                  << "            color: #FFFFFF;" << std::endl
-                  << "        }" << std::endl
-                  << "        h2.note {" << std::endl
-                  << "            font-family: sans-serif;" << std::endl
-                  << "            font-size: 12px;" << std::endl
-                  << "            color: #FFFFFF;" << std::endl
-                  << "        }" << std::endl
-                  << "        table {" << std::endl
-                  << "            min-width: 600px;" << std::endl
-                  << "            width: 70%;" << std::endl
-                  << "            border-collapse: collapse;" << std::endl
-                  << "            border-color: grey;" << std::endl
-                  << "            font-family: sans-serif;" << std::endl
-                  << "        }" << std::endl
-                  << "        td.header {" << std::endl
-                  << "            padding: 18px;" << std::endl
-                  << "            border: 1px solid #ccc;" << std::endl
-                  << "            font-size: 18px;" << std::endl
-                  << "            color: #fff;" << std::endl
-                  << "        }" << std::endl
-                  << "        td.odd {" << std::endl
-                  << "            padding: 10px;" << std::endl
-                  << "            border: 1px solid #ccc;" << std::endl
-                  << "            font-size: 16px;" << std::endl
-                  << "            color: rgb(255, 255, 255);" << std::endl
-                  << "        }" << std::endl
-                  << "        td.even {" << std::endl
-                  << "            padding: 10px;" << std::endl
-                  << "            border: 1px solid #ccc;" << std::endl
-                  << "            font-size: 16px;" << std::endl
-                  << "            color: rgb(220, 220, 220);" << std::endl
-                  << "        }" << std::endl
-                  << "        tr.header {" << std::endl
-                  << "            background-color: rgba(64,64,64,0.75);" << std::endl
-                  << "        }" << std::endl
-                  << "        tr.odd {" << std::endl
-                  << "            background-color: rgba(0,0,0,0.6);" << std::endl
-                  << "        }" << std::endl
-                  << "        tr.even {" << std::endl
-                  << "            background-color: rgba(0,0,0,0.7);" << std::endl
-                  << "        }" << std::endl
-                  << "    </style>" << std::endl
-                  << "    <script src=\"https://ajax.googleapis.com/ajax/libs/jquery/"
-                  << "2.2.4/jquery.min.js\"></script>" << std::endl
-                  << "    <script type=\"text/javascript\">" << std::endl
-                  << "        $( document ).ready(function() {" << std::endl
-                  << "            $('table tr:not(.header)').hide();" << std::endl
-                  << "            $('.header').click(function() {" << std::endl
-                  << "                "
-                     "$(this).nextUntil('tr.header').slideToggle(300);"
-                  << std::endl
-                  << "            });" << std::endl
-                  << "        });" << std::endl
-                  << "    </script>" << std::endl
-                  << "</HEAD>" << std::endl
-                  << std::endl
-                  << "<BODY>" << std::endl
-                  << std::endl;
+    if (RecordReportEntry(VIA_REPORT_END_TABLE)) return;
+}
+
+thread_local std::vector<ViaSystem::ViaReportEntry>* ViaSystem::_recording_report = nullptr;
+
+// Returns true when the entry is recorded by a system info pass, instead of being written
+bool ViaSystem::RecordReportEntry(ViaReportEntryType type, const std::string& text, uint32_t value) {
+    if (_recording_report == nullptr) return false;
+
+    ViaReportEntry entry = {type, text, value};
+    _recording_report->push_back(entry);
+    return true;
+}
+
+void ViaSystem::ReplayReport(const std::vector<ViaReportEntry>& report) {
+    for (std::size_t i = 0, n = report.size(); i < n; ++i) {
+        const ViaReportEntry& entry = report[i];
+        switch (entry.type) {
+            case VIA_REPORT_BEGIN_SECTION:
+                BeginSection(entry.text);
+                break;
+            case VIA_REPORT_END_SECTION:
+                EndSection();
+                break;
+            case VIA_REPORT_STANDARD_TEXT:
+                PrintStandardText(entry.text);
+                break;
+            case VIA_REPORT_BEGIN_TABLE:
+                PrintBeginTable(entry.text, entry.value);
+                break;
+            case VIA_REPORT_BEGIN_TABLE_ROW:
+                PrintBeginTableRow();
+                break;
+            case VIA_REPORT_TABLE_ELEMENT:
+                PrintTableElement(entry.text, static_cast<ViaElementAlign>(entry.value));
+                break;
+            case VIA_REPORT_END_TABLE_ROW:
+                PrintEndTableRow();
+                break;
+            case VIA_REPORT_END_TABLE:
+                PrintEndTable();
+                break;
+            case VIA_REPORT_LOG_ERROR:
+                LogError(entry.text);
+                break;
+            case VIA_REPORT_LOG_WARNING:
+                LogWarning(entry.text);
+                break;
+            case VIA_REPORT_LOG_INFO:
+                LogInfo(entry.text);
+                break;
+        }
+    }
+}
+
+// HTML serializer
+
+// Write the HTML file with the appropriate header information including
+// the appropriate CSS and JavaScript items.
+void ViaSystem::WriteReportHTML(std::ostream& out) {
+    out << "<!DOCTYPE html>\n"
+           "<HTML lang=\"en\" xml:lang=\"en\" xmlns=\"http://www.w3.org/1999/xhtml\">\n"
+           "\n<HEAD>\n"
+           "    <TITLE>"
+        << _report_title << "</TITLE>\n";
+
+    out << "    <META charset=\"UTF-8\">\n"
+           "    <style media=\"screen\" type=\"text/css\">\n"
+           "        html {\n"
+           // By defining the color first, this won't override the background image
+           // (unless the images aren't there).
+           "            background-color: #0b1e48;\n"
+           // The following changes try to load the text image twice (locally, then
+           // off the web) followed by the background image twice (locally, then
+           // off the web).  The background color will only show if both background
+           // image loads fail.  In this way, a user will see their local copy on
+           // their machine, while a person they share it with will see the web
+           // images (or the background color).
+           "            background-image: url(\"https://vulkan.lunarg.com/img/VIATitle.png\"), "
+           "url(\"https://vulkan.lunarg.com/img/VIABackground.jpg\");\n"
+           "            background-position: center top, center;\n"
+           "            -webkit-background-size: auto, cover;\n"
+           "            -moz-background-size: auto, cover;\n"
+           "            -o-background-size: auto, cover;\n"
+           "            background-size: auto, cover;\n"
+           "            background-attachment: scroll, fixed;\n"
+           "            background-repeat: no-repeat, no-repeat;\n"
+           "        }\n"
+           // h1.section is used for section headers, and h1.version is used to
+           // print out the application version text (which shows up just under
+           // the title).
+           "        h1.section {\n"
+           "            font-family: sans-serif;\n"
+           "            font-size: 35px;\n"
+           "            color: #FFFFFF;\n"
+           "        }\n"
+           "        h1.version {\n"
+           "            font-family: sans-serif;\n"
+           "            font-size: 25px;\n"
+           "            color: #FFFFFF;\n"
+           "        }\n"
+           "        h2.note {\n"
+           "            font-family: sans-serif;\n"
+           "            font-size: 12px;\n"
+           "            color: #FFFFFF;\n"
+           "        }\n"
+           "        table {\n"
+           "            min-width: 600px;\n"
+           "            width: 70%;\n"
+           "            border-collapse: collapse;\n"
+           "            border-color: grey;\n"
+           "            font-family: sans-serif;\n"
+           "        }\n"
+           "        td.header {\n"
+           "            padding: 18px;\n"
+           "            border: 1px solid #ccc;\n"
+           "            font-size: 18px;\n"
+           "            color: #fff;\n"
+           "        }\n"
+           "        td.odd {\n"
+           "            padding: 10px;\n"
+           "            border: 1px solid #ccc;\n"
+           "            font-size: 16px;\n"
+           "            color: rgb(255, 255, 255);\n"
+           "        }\n"
+           "        td.even {\n"
+           "            padding: 10px;\n"
+           "            border: 1px solid #ccc;\n"
+           "            font-size: 16px;\n"
+           "            color: rgb(220, 220, 220);\n"
+           "        }\n"
+           "        tr.header {\n"
+           "            background-color: rgba(64,64,64,0.75);\n"
+           "        }\n"
+           "        tr.odd {\n"
+           "            background-color: rgba(0,0,0,0.6);\n"
+           "        }\n"
+           "        tr.even {\n"
+           "            background-color: rgba(0,0,0,0.7);\n"
+           "        }\n"
+           "    </style>\n"
+           "    <script src=\"https://ajax.googleapis.com/ajax/libs/jquery/2.2.4/jquery.min.js\"></script>\n"
+           "    <script type=\"text/javascript\">\n"
+           "        $( document ).ready(function() {\n"
+           "            $('table tr:not(.header)').hide();\n"
+           "            $('.header').click(function() {\n"
+           "                $(this).nextUntil('tr.header').slideToggle(300);\n"
+           "            });\n"
+           "        });\n"
+           "    </script>\n"
+           "</HEAD>\n"
+           "\n"
+           "<BODY>\n"
+           "\n";
     // We need space from the top for the VIA texture
     for (uint32_t space = 0; space < 15; space++) {
-        _out_ofstream << "    <BR />" << std::endl;
+        out << "    <BR />\n";
     }
 
-    _out_ofstream << "<center><h2 class=\"note\">< NOTE: Click on section name to expand "
-                     "table ></h2></center>"
-                  << std::endl
-                  << "    <BR />" << std::endl;
-}
+    out << "<center><h2 class=\"note\">< NOTE: Click on section name to expand table ></h2></center>\n"
+           "    <BR />\n";
 
-// Close out writing to the HTML file.
-void ViaSystem::EndOutputHTML() { _out_ofstream << "</BODY>" << std::endl << std::endl << "</HTML>" << std::endl; }
+    WriteReportNodesHTML(out, _report);
 
-void ViaSystem::BeginSectionHTML(const std::string& section_str) {
-    _out_ofstream << "    <H1 class=\"section\"><center>" << section_str << "</center></h1>" << std::endl;
+    out << "</BODY>\n\n</HTML>\n";
 }
 
-void ViaSystem::EndSectionHTML() { _out_ofstream << "    <BR/>" << std::endl << "    <BR/>" << std::endl; }
+void ViaSystem::WriteReportNodesHTML(std::ostream& out, const std::vector<ViaReportNode>& nodes) {
+    for (std::size_t i = 0, n = nodes.size(); i < n; ++i) {
+        const ViaReportNode& node = nodes[i];
 
-void ViaSystem::PrintStandardTextHTML(const std::string& text_str) {
-    _out_ofstream << "    <H2><font color=\"White\">" << text_str << "</font></H2>" << std::endl;
+        switch (node.type) {
+            case VIA_NODE_SECTION: {
+                out << "    <H1 class=\"section\"><center>" << node.text << "</center></h1>\n";
+                WriteReportNodesHTML(out, node.children);
+                if (node.ended) {
+                    out << "    <BR/>\n    <BR/>\n";
+                }
+            } break;
+            case VIA_NODE_STANDARD_TEXT: {
+                out << "    <H2><font color=\"White\">" << node.text << "</font></H2>\n";
+            } break;
+            case VIA_NODE_TABLE: {
+                out << "    <table align=\"center\">\n"
+                       "        <tr class=\"header\">\n"
+                       "            <td colspan=\""
+                    << node.num_cols << "\" class=\"header\">" << node.text
+                    << "</td>\n"
+                       "        </tr>\n";
+
+                for (std::size_t row = 0, row_count = node.rows.size(); row < row_count; ++row) {
+                    // The first row is odd
+                    const char* class_str = (row % 2) == 0 ? " class=\"odd\"" : " class=\"even\"";
+
+                    out << "        <tr" << class_str << ">\n";
+                    for (std::size_t col = 0, col_count = node.rows[row].size(); col < col_count; ++col) {
+                        const ViaReportCell& cell = node.rows[row][col];
+
+                        const char* align_str = "";
+                        if (cell.align == VIA_ALIGN_RIGHT) {
+                            align_str = " align=\"right\"";
+                        } else if (cell.align == VIA_ALIGN_CENTER) {
+                            align_str = " align=\"center\"";
+                        }
+                        out << "            <td" << align_str << class_str << ">" << cell.element << "</td>\n";
+                    }
+                    out << "        </tr>\n";
+                }
+
+                out << "    </table>\n";
+            } break;
+        }
+    }
 }
 
-void ViaSystem::PrintBeginTableHTML(const std::string& table_name, uint32_t num_cols) {
-    _out_ofstream << "    <table align=\"center\">" << std::endl
-                  << "        <tr class=\"header\">" << std::endl
-                  << "            <td colspan=\"" << num_cols << "\" class=\"header\">" << table_name << "</td>" << std::endl
-                  << "        </tr>" << std::endl;
+// VkConfig serializer
+
+void ViaSystem::WriteReportVkConfig(std::ostream& out) {
+    uint32_t table_count = 0;
+    uint32_t standard_text_count = 0;
 
-    _outputting_to_odd_row = true;
+    out << "{\n";
+    WriteReportNodesVkConfig(out, _report, table_count, standard_text_count);
+    out << "\n}\n";
 }
 
-void ViaSystem::PrintBeginTableRowHTML() {
-    std::string class_str = "";
-    if (_outputting_to_odd_row) {
-        class_str = " class=\"odd\"";
-    } else {
-        class_str = " class=\"even\"";
+// The sections are not written, the texts and tables are numbered across the whole report
+void ViaSystem::WriteReportNodesVkConfig(std::ostream& out, const std::vector<ViaReportNode>& nodes, uint32_t& table_count,
+                                         uint32_t& standard_text_count) {
+    for (std::size_t i = 0, n = nodes.size(); i < n; ++i) {
+        const ViaReportNode& node = nodes[i];
+
+        switch (node.type) {
+            case VIA_NODE_SECTION: {
+                WriteReportNodesVkConfig(out, node.children, table_count, standard_text_count);
+            } break;
+            case VIA_NODE_STANDARD_TEXT: {
+                if (table_count > 0) {
+                    out << ",\n";
+                }
+                out << "\t\"" << standard_text_count << "\": \"" << node.text << "\"";
+                table_count++;
+                standard_text_count++;
+            } break;
+            case VIA_NODE_TABLE: {
+                if (table_count > 0) {
+                    out << ",\n";
+                }
+                out << "\t\"" << node.text << "\": {\n";
+                table_count++;
+
+                for (std::size_t row = 0, row_count = node.rows.size(); row < row_count; ++row) {
+                    if (row > 0) {
+                        out << ",\n";
+                    }
+                    out << "\t\t\"" << row << "\": {\n";
+
+                    for (std::size_t col = 0, col_count = node.rows[row].size(); col < col_count; ++col) {
+                        if (col > 0) {
+                            out << ",\n";
+                        }
+                        out << "\t\t\t\"" << col << "\": \"" << node.rows[row][col].element << "\"";
+                    }
+                    out << "\n\t\t}";
+                }
+                out << "\n\t}";
+            } break;
+        }
     }
-    _out_ofstream << "        <tr" << class_str << ">" << std::endl;
 }
 
-void ViaSystem::PrintTableElementHTML(const std::string& element, ViaElementAlign align) {
-    std::string align_str = "";
-    std::string class_str = "";
-    if (align == VIA_ALIGN_RIGHT) {
-        align_str = " align=\"right\"";
-    } else if (align == VIA_ALIGN_CENTER) {
-        align_str = " align=\"center\"";
-    }
-    if (_outputting_to_odd_row) {
-        class_str = " class=\"odd\"";
-    } else {
-        class_str = " class=\"even\"";
+// Json serializer
+
+// Unlike the vkconfig format, the report structure is kept and the strings are escaped
+// A single compact document containing the run information and the whole report
+void ViaSystem::WriteReportJson(std::ostream& out) {
+    Json::Value root = BuildReportRunJson();
+    root["report"] = BuildReportNodesJson(_report);
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+    writer->write(root, &out);
+    out << "\n";
+}
+
+// One compact document per line: the run information, then each top level node of the report. Every line carries the
+// schema version and the timestamp of the run, so the lines can be ingested independently.
+void ViaSystem::WriteReportNdJson(std::ostream& out) {
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+
+    Json::Value run = BuildReportRunJson();
+    run["type"] = "run";
+    writer->write(run, &out);
+    out << "\n";
+
+    for (std::size_t i = 0, n = _report.size(); i < n; ++i) {
+        Json::Value line = BuildReportNodeJson(_report[i]);
+        line["schema_version"] = VIA_JSON_SCHEMA_VERSION;
+        line["timestamp"] = _report_timestamp;
+        line["type"] = "node";
+        writer->write(line, &out);
+        out << "\n";
     }
-    _out_ofstream << "            <td" << align_str << class_str << ">" << element << "</td>" << std::endl;
 }
 
-void ViaSystem::PrintEndTableRowHTML() {
-    _out_ofstream << "        </tr>" << std::endl;
-    _outputting_to_odd_row = !_outputting_to_odd_row;
+Json::Value ViaSystem::BuildReportRunJson() {
+    Json::Value json_passes(Json::arrayValue);
+    for (std::size_t i = 0, n = _report_passes.size(); i < n; ++i) {
+        Json::Value json_pass(Json::objectValue);
+        json_pass["name"] = _report_passes[i].name;
+        json_pass["seconds"] = _report_passes[i].seconds;
+        json_pass["result"] = static_cast<int>(_report_passes[i].result);
+        json_passes.append(json_pass);
+    }
+
+    Json::Value root(Json::objectValue);
+    root["schema_version"] = VIA_JSON_SCHEMA_VERSION;
+    root["title"] = _report_title;
+    root["version"] = _app_version;
+    root["timestamp"] = _report_timestamp;
+    root["result"] = static_cast<int>(_report_result);
+    root["passes"] = json_passes;
+    return root;
 }
 
-void ViaSystem::PrintEndTableHTML() { _out_ofstream << "    </table>" << std::endl; }
+Json::Value ViaSystem::BuildReportNodesJson(const std::vector<ViaReportNode>& nodes) {
+    Json::Value json_nodes(Json::arrayValue);
 
-// VkConfig print methods
+    for (std::size_t i = 0, n = nodes.size(); i < n; ++i) {
+        json_nodes.append(BuildReportNodeJson(nodes[i]));
+    }
 
-void ViaSystem::StartOutputVkConfig(const std::string& title) {
-    _table_count = 0;
-    _standard_text_count = 0;
-    _out_ofstream << "{" << std::endl;
+    return json_nodes;
 }
 
-void ViaSystem::EndOutputVkConfig() { _out_ofstream << "\n}" << std::endl; }
+Json::Value ViaSystem::BuildReportNodeJson(const ViaReportNode& node) {
+    Json::Value json_node(Json::objectValue);
+    switch (node.type) {
+        case VIA_NODE_SECTION: {
+            json_node["section"] = node.text;
+            json_node["children"] = BuildReportNodesJson(node.children);
+        } break;
+        case VIA_NODE_STANDARD_TEXT: {
+            json_node["text"] = node.text;
+        } break;
+        case VIA_NODE_TABLE: {
+            Json::Value json_rows(Json::arrayValue);
+            for (std::size_t row = 0, row_count = node.rows.size(); row < row_count; ++row) {
+                Json::Value json_row(Json::arrayValue);
+                for (std::size_t col = 0, col_count = node.rows[row].size(); col < col_count; ++col) {
+                    json_row.append(node.rows[row][col].element);
+                }
+                json_rows.append(json_row);
+            }
+
+            json_node["table"] = node.text;
+            json_node["columns"] = node.num_cols;
+            json_node["rows"] = json_rows;
+        } break;
+    }
+    return json_node;
+}
 
-void ViaSystem::BeginSectionVkConfig(const std::string& section_str) { return; }
+void ViaSystem::AddPassTiming(const std::string& name, double seconds, ViaResults result) {
+    ViaPassTiming timing = {name, seconds, result};
+    _report_passes.push_back(timing);
+}
 
-void ViaSystem::EndSectionVkConfig() { return; }
+void ViaSystem::StartWatchdog() {
+    if (_step_timeout_seconds <= 0 || _watchdog_thread.joinable()) return;
 
-void ViaSystem::PrintStandardTextVkConfig(const std::string& text_str) {
-    if (_table_count > 0) {
-        _out_ofstream << "," << std::endl;
-    }
-    _out_ofstream << "\t\"" << _standard_text_count << "\": \"" << text_str << "\"";
-    _table_count++;
-    _standard_text_count++;
+    _watchdog_stopping = false;
+    _watchdog_step.clear();
+    _watchdog_thread = std::thread(&ViaSystem::RunWatchdog, this);
 }
 
-void ViaSystem::PrintBeginTableVkConfig(const std::string& table_name) {
-    _row_count = 0;
-    if (_table_count > 0) {
-        _out_ofstream << "," << std::endl;
+void ViaSystem::StopWatchdog() {
+    if (!_watchdog_thread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(_watchdog_mutex);
+        _watchdog_stopping = true;
     }
-    _out_ofstream << "\t\"" << table_name << "\": {" << std::endl;
-    _table_count++;
+    _watchdog_condition.notify_all();
+    _watchdog_thread.join();
 }
-void ViaSystem::PrintBeginTableRowVkConfig() {
-    _col_count = 0;
-    if (_row_count > 0) {
-        _out_ofstream << "," << std::endl;
-    }
-    _out_ofstream << "\t\t\"" << _row_count << "\": {" << std::endl;
-    _row_count++;
+
+void ViaSystem::ArmWatchdog(const std::string& step) {
+    std::lock_guard<std::mutex> lock(_watchdog_mutex);
+    _watchdog_step = step;
+    _watchdog_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(_step_timeout_seconds);
+    _watchdog_condition.notify_all();
 }
 
-void ViaSystem::PrintTableElementVkConfig(const std::string& element) {
-    if (_col_count > 0) {
-        _out_ofstream << "," << std::endl;
-    }
-    _out_ofstream << "\t\t\t\"" << _col_count << "\": \"" << element << "\"";
-    _col_count++;
+// Once the watchdog is writing the report of a timed out step, this waits for the process to exit
+void ViaSystem::DisarmWatchdog() {
+    std::lock_guard<std::mutex> lock(_watchdog_mutex);
+    _watchdog_step.clear();
+    _watchdog_condition.notify_all();
 }
 
-void ViaSystem::PrintEndTableRowVkConfig() { _out_ofstream << "\n\t\t}"; }
+void ViaSystem::RunWatchdog() {
+    std::unique_lock<std::mutex> lock(_watchdog_mutex);
+    while (!_watchdog_stopping) {
+        if (_watchdog_step.empty()) {
+            _watchdog_condition.wait(lock);
+        } else if (_watchdog_condition.wait_until(lock, _watchdog_deadline) == std::cv_status::timeout &&
+                   !_watchdog_step.empty() && std::chrono::steady_clock::now() >= _watchdog_deadline) {
+            break;
+        }
+    }
+    if (_watchdog_stopping) return;
+
+    // The step is hanging in a driver or a layer, the report is written as it is. The lock is kept, so a step which ends now
+    // waits in DisarmWatchdog instead of adding to the report.
+    const std::string message =
+        _watchdog_step + " didn't finish in " + std::to_string(_step_timeout_seconds) + " seconds, the report stops there.";
+    _report_result = VIA_STEP_TIMED_OUT;
+    AddPassTiming(_watchdog_step, static_cast<double>(_step_timeout_seconds), VIA_STEP_TIMED_OUT);
 
-void ViaSystem::PrintEndTableVkConfig() { _out_ofstream << "\n\t}"; }
+    ViaReportNode node = {VIA_NODE_STANDARD_TEXT, "TIMED OUT: " + message, false, 0, {}, {}};
+    _report.push_back(node);
+    EndOutput();
+
+    LogError("Timed out: " + message);
+    std::_Exit(-1);
+}
 
 // Trim any whitespace preceeding or following the actual
 // content inside of a string.  The actual items labeled
@@ -1737,9 +3257,12 @@ void ViaSystem::GenerateSettingsFileJsonInfo(const std::string& settings_file) {
 }
 
 // Print out the information stored in an explicit layer's JSON file.
-void ViaSystem::GenerateExplicitLayerJsonInfo(const char* layer_json_filename, Json::Value root) {
+void ViaSystem::GenerateExplicitLayerJsonInfo(const char* layer_json_filename, Json::Value root, vku::ManifestType type) {
     char generic_string[1024];
     uint32_t ext;
+
+    RecordManifest(layer_json_filename, type, root);
+
     if (!root["layer"].isNull()) {
         PrintBeginTableRow();
         PrintTableElement("");
@@ -1916,10 +3439,11 @@ void ViaSystem::GenerateImplicitLayerJsonInfo(const char* layer_json_filename, J
     bool enable_var_set = false;
     std::string enable_return = "";
     std::string disable_env_variable = "--NONE--";
+    std::string disable_env_value = "";
     bool disable_var_set = false;
     std::string disable_return = "";
 
-    GenerateExplicitLayerJsonInfo(layer_json_filename, root);
+    GenerateExplicitLayerJsonInfo(layer_json_filename, root, vku::MANIFEST_TYPE_IMPLICIT_LAYER);
 
     // Record any override paths that may be present forcing us to look for explicit layers in a
     // particular location.
@@ -1970,6 +3494,7 @@ void ViaSystem::GenerateImplicitLayerJsonInfo(const char* layer_json_filename, J
                 continue;
             }
             disable_env_variable = dis_iter.key().asString();
+            disable_env_value = (*dis_iter).asString();
             disable_return = GetEnvironmentalVariableValue(disable_env_variable);
             if (atoi(disable_return.c_str()) != 0) {
                 disable_var_set = true;
@@ -2042,6 +3567,23 @@ void ViaSystem::GenerateImplicitLayerJsonInfo(const char* layer_json_filename, J
         }
     }
 
+    // The load timing disables each enabled layer in turn, which is only possible with a disable environment variable
+    if (_measure_load_timing && enabled && !disable_env_value.empty()) {
+        LoadTimingLayer layer;
+        layer.name = root["layer"]["name"].asString();
+        layer.disable_env_variable = disable_env_variable;
+        layer.disable_env_value = disable_env_value;
+
+        std::lock_guard<std::mutex> lock(_load_timing_mutex);
+        bool found = false;
+        for (std::size_t i = 0, n = _load_timing_layers.size(); i < n; ++i) {
+            found |= _load_timing_layers[i].name == layer.name;
+        }
+        if (!found) {
+            _load_timing_layers.push_back(layer);
+        }
+    }
+
     // Print the overall state (ENABLED or DISABLED) so we can
     // quickly determine if this layer is being used.
     PrintBeginTableRow();
@@ -2079,7 +3621,6 @@ ViaSystem::ViaResults ViaSystem::GenerateTestInfo(void) {
     BeginSection("External Tests");
     if (_found_sdk) {
         std::string cube_exe;
-        std::string full_cmd;
         std::string path = "";
 
         LogInfo("SDK Found! - Will attempt to run tests");
@@ -2120,40 +3661,74 @@ ViaSystem::ViaResults ViaSystem::GenerateTestInfo(void) {
 
             LogInfo("   Attempting to run " + cube_exe + " in " + path);
 
-            full_cmd = cube_exe;
-            full_cmd += " --c 100 --suppress_popups";
-            int test_result = RunTestInDirectory(path, cube_exe, full_cmd);
+            // The variants are independent, they run concurrently and their logs are written once both are done
+            struct CubeTest {
+                std::vector<std::string> args;
+                std::string cmd_line;
+                int result;
+                double seconds;
+                std::vector<ViaReportEntry> logs;
+            };
+
+            const uint32_t frame_count = 100;
+
+            std::vector<CubeTest> tests(2);
+            tests[0].args = {"--c", std::to_string(frame_count), "--suppress_popups"};
+            tests[1].args = tests[0].args;
+            tests[1].args.push_back("--validate");
+
+            auto run = [&](CubeTest& test) {
+                test.cmd_line = cube_exe;
+                for (std::size_t i = 0, n = test.args.size(); i < n; ++i) {
+                    test.cmd_line += " " + test.args[i];
+                }
 
-            PrintBeginTable("Cube", 2);
+                _recording_report = &test.logs;
+                LogInfo("       Command-line: " + test.cmd_line);
+                const auto start = std::chrono::steady_clock::now();
+                test.result = RunTestInDirectory(path, cube_exe, test.args);
+                test.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                _recording_report = nullptr;
+            };
 
-            PrintBeginTableRow();
-            PrintTableElement(full_cmd);
-            if (test_result == 0) {
-                PrintTableElement("VIA_SUCCESSFUL");
-                _ran_tests = true;
-            } else if (test_result == 1) {
-                PrintTableElement("Not Found");
-            } else {
-                PrintTableElement("FAILED!");
-                res = VIA_TEST_FAILED;
-            }
-            PrintEndTableRow();
+            std::thread validate_thread(run, std::ref(tests[1]));
+            run(tests[0]);
+            validate_thread.join();
 
-            full_cmd += " --validate";
+            PrintBeginTable("Cube", 4);
 
-            PrintBeginTableRow();
-            PrintTableElement(full_cmd);
-            test_result = RunTestInDirectory(path, cube_exe, full_cmd);
-            if (test_result == 0) {
-                PrintTableElement("VIA_SUCCESSFUL");
-                _ran_tests = true;
-            } else if (test_result == 1) {
-                PrintTableElement("Not Found");
-            } else {
-                PrintTableElement("FAILED!");
-                res = VIA_TEST_FAILED;
+            for (std::size_t i = 0, n = tests.size(); i < n; ++i) {
+                ReplayReport(tests[i].logs);
+
+                PrintBeginTableRow();
+                PrintTableElement(tests[i].cmd_line);
+                if (tests[i].result == 0) {
+                    PrintTableElement("VIA_SUCCESSFUL");
+                    _ran_tests = true;
+                } else if (tests[i].result == 1) {
+                    PrintTableElement("Not Found");
+                } else if (tests[i].result == 2) {
+                    PrintTableElement("TIMED OUT");
+                    res = VIA_TEST_FAILED;
+                } else {
+                    PrintTableElement("FAILED!");
+                    res = VIA_TEST_FAILED;
+                }
+
+                // The wall time includes the instance and device creation, it's a lower bound of the driver frame rate
+                if (tests[i].result == 1) {
+                    PrintTableElement("");
+                    PrintTableElement("");
+                } else {
+                    char generic_string[64];
+                    snprintf(generic_string, sizeof(generic_string), "%.2f s", tests[i].seconds);
+                    PrintTableElement(generic_string);
+                    snprintf(generic_string, sizeof(generic_string), "%.1f FPS",
+                             tests[i].seconds > 0.0 ? frame_count / tests[i].seconds : 0.0);
+                    PrintTableElement(generic_string);
+                }
+                PrintEndTableRow();
             }
-            PrintEndTableRow();
 
             // Make it this far, we shouldn't test anymore
             break;
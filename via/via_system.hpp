@@ -21,9 +21,18 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
 #include <fstream>
+#include <functional>
 
 #include <json/json.h>
+#include "../vku/vk_manifest_cache.h"
 #include <vulkan/vulkan.h>
 
 #if (defined(_MSC_VER) && _MSC_VER < 1900 /*vs2015*/) || defined MINGW_HAS_SECURE_API
@@ -45,6 +54,7 @@ class ViaSystem {
 
         VIA_UNKNOWN_ERROR = -1,
         VIA_SYSTEM_CALL_FAILURE = -2,
+        VIA_STEP_TIMED_OUT = -3,
 
         VIA_MISSING_DRIVER_REGISTRY = -20,
         VIA_MISSING_DRIVER_JSON = -21,
@@ -61,6 +71,14 @@ class ViaSystem {
         VIA_TEST_FAILED = -60,
     };
 
+    // Directory methods, each directory is read once and the following lookups are answered from its index
+    struct DirectoryIndex {
+        std::vector<std::string> entries;  // In the order returned by the file system
+        std::set<std::string> names;
+    };
+    const DirectoryIndex* GetDirectoryIndex(const std::string& directory);
+    bool DirectoryContains(const std::string& directory, const std::string& name);
+
    protected:
     struct OverrideExpiration {
         uint16_t year;
@@ -72,6 +90,44 @@ class ViaSystem {
 
     enum ViaElementAlign { VIA_ALIGN_LEFT = 0, VIA_ALIGN_CENTER, VIA_ALIGN_RIGHT };
 
+    // The system info passes run concurrently, so each of them records its output which is written in the passes order
+    enum ViaReportEntryType {
+        VIA_REPORT_BEGIN_SECTION = 0,
+        VIA_REPORT_END_SECTION,
+        VIA_REPORT_STANDARD_TEXT,
+        VIA_REPORT_BEGIN_TABLE,
+        VIA_REPORT_BEGIN_TABLE_ROW,
+        VIA_REPORT_TABLE_ELEMENT,
+        VIA_REPORT_END_TABLE_ROW,
+        VIA_REPORT_END_TABLE,
+        VIA_REPORT_LOG_ERROR,
+        VIA_REPORT_LOG_WARNING,
+        VIA_REPORT_LOG_INFO
+    };
+
+    struct ViaReportEntry {
+        ViaReportEntryType type;
+        std::string text;
+        uint32_t value;  // Number of columns of a table, or alignment of a table element
+    };
+
+    // The report is built in memory by the print methods, it's serialized once by EndOutput
+    enum ViaReportNodeType { VIA_NODE_SECTION = 0, VIA_NODE_STANDARD_TEXT, VIA_NODE_TABLE };
+
+    struct ViaReportCell {
+        std::string element;
+        ViaElementAlign align;
+    };
+
+    struct ViaReportNode {
+        ViaReportNodeType type;
+        std::string text;  // Title of a section, text of a standard text or name of a table
+        bool ended;        // Whether EndSection was called for a section, it is not when the capture stopped early
+        uint32_t num_cols;
+        std::vector<ViaReportNode> children;
+        std::vector<std::vector<ViaReportCell>> rows;
+    };
+
     // Print methods
     void StartOutput(const std::string& title);
     void EndOutput();
@@ -83,30 +139,37 @@ class ViaSystem {
     void PrintTableElement(const std::string& element, ViaElementAlign align = VIA_ALIGN_LEFT);
     void PrintEndTableRow();
     void PrintEndTable();
+    bool RecordReportEntry(ViaReportEntryType type, const std::string& text = "", uint32_t value = 0);
+    void ReplayReport(const std::vector<ViaReportEntry>& report);
+    std::vector<ViaReportNode>& GetCurrentReportNodes();
+    ViaReportNode* GetCurrentReportTable();
+
+    // HTML serializer
+    void WriteReportHTML(std::ostream& out);
+    void WriteReportNodesHTML(std::ostream& out, const std::vector<ViaReportNode>& nodes);
+
+    // VkConfig serializer
+    void WriteReportVkConfig(std::ostream& out);
+    void WriteReportNodesVkConfig(std::ostream& out, const std::vector<ViaReportNode>& nodes, uint32_t& table_count,
+                                  uint32_t& standard_text_count);
 
-    // HTML methods
-    void StartOutputHTML(const std::string& title);
-    void EndOutputHTML();
-    void BeginSectionHTML(const std::string& section_str);
-    void EndSectionHTML();
-    void PrintStandardTextHTML(const std::string& text_str);
-    void PrintBeginTableHTML(const std::string& table_name, uint32_t num_cols);
-    void PrintBeginTableRowHTML();
-    void PrintTableElementHTML(const std::string& element, ViaElementAlign align = VIA_ALIGN_LEFT);
-    void PrintEndTableRowHTML();
-    void PrintEndTableHTML();
-
-    // VkConfig output methods
-    void StartOutputVkConfig(const std::string& title);
-    void EndOutputVkConfig();
-    void BeginSectionVkConfig(const std::string& section_str);
-    void EndSectionVkConfig();
-    void PrintStandardTextVkConfig(const std::string& text_str);
-    void PrintBeginTableVkConfig(const std::string& table_name);
-    void PrintBeginTableRowVkConfig();
-    void PrintTableElementVkConfig(const std::string& element);
-    void PrintEndTableRowVkConfig();
-    void PrintEndTableVkConfig();
+    // Json serializers, the documents are compact and versioned by VIA_JSON_SCHEMA_VERSION to be ingested by tools
+    void WriteReportJson(std::ostream& out);
+    void WriteReportNdJson(std::ostream& out);
+    Json::Value BuildReportRunJson();
+    Json::Value BuildReportNodesJson(const std::vector<ViaReportNode>& nodes);
+    Json::Value BuildReportNodeJson(const ViaReportNode& node);
+
+    // Timing of the passes, serialized by the Json formats
+    void AddPassTiming(const std::string& name, double seconds, ViaResults result);
+
+    // The watchdog bounds the steps which run drivers and layers in the process, a hanging driver can't be interrupted so the
+    // watchdog writes the report produced so far and exits when the armed step doesn't finish in time
+    void StartWatchdog();
+    void StopWatchdog();
+    void ArmWatchdog(const std::string& step);
+    void DisarmWatchdog();
+    void RunWatchdog();
 
     // Logging methods
     void LogError(const std::string& error);
@@ -119,12 +182,26 @@ class ViaSystem {
     virtual std::string GetEnvironmentalVariableValue(const std::string& env_var) = 0;
     virtual bool ExpandPathWithEnvVar(std::string& path) = 0;
 
+    // Library methods, the verification results are cached between runs
+    bool VerifyLibrary(const std::string& library_file, std::string& error);
+    void LoadLibraryCache();
+    void SaveLibraryCache();
+
+    // The summaries of the parsed manifests are shared with Vulkan Configurator
+    void RecordManifest(const std::string& json_filename, vku::ManifestType type, const Json::Value& root);
+
+    // Diff methods
+    uint32_t KeepReportChanges();
+    static std::string FingerprintReportNode(const ViaReportNode& node);
+
     // Json Methods
     bool DetermineJsonLibraryPath(const std::string& json_location, const std::string& json_library_info,
                                   std::string& library_location);
 
     // Methods children need to override
     virtual bool IsAbsolutePath(const std::string& path);
+    // Gather the system state shared by several system info passes, before they run concurrently
+    virtual void PrepareSystemInfo() {}
     virtual ViaResults PrintSystemEnvironmentInfo() = 0;
     virtual ViaResults PrintSystemHardwareInfo() = 0;
     virtual ViaResults PrintSystemExecutableInfo() = 0;
@@ -134,21 +211,28 @@ class ViaSystem {
     virtual ViaResults PrintSystemImplicitLayerInfo() = 0;
     virtual ViaResults PrintSystemExplicitLayerInfo() = 0;
     virtual ViaResults PrintSystemSettingsFileInfo() = 0;
-    virtual int RunTestInDirectory(std::string path, std::string test, std::string cmd_line) = 0;
+    virtual int RunTestInDirectory(const std::string& path, const std::string& test, const std::vector<std::string>& args) = 0;
     virtual void PrintFileVersionInfo(const std::string& json_filename, const std::string& library) {}
     virtual bool CheckExpiration(OverrideExpiration expiration) = 0;
 
+    // Run the work for each index concurrently, the print methods must be recorded by the work
+    static void RunConcurrently(std::size_t count, const std::function<void(std::size_t)>& work);
+
     // Non-overrideable capture functions
     ViaResults GenerateSystemInfo();
     ViaResults GenerateVulkanInfo();
     ViaResults GenerateTestInfo();
     void GenerateSettingsFileJsonInfo(const std::string& settings_file);
-    void GenerateExplicitLayerJsonInfo(const char* layer_json_filename, Json::Value root);
+    void GenerateExplicitLayerJsonInfo(const char* layer_json_filename, Json::Value root,
+                                       vku::ManifestType type = vku::MANIFEST_TYPE_EXPLICIT_LAYER);
     void GenerateImplicitLayerJsonInfo(const char* layer_json_filename, Json::Value root, std::vector<std::string>& override_paths);
     ViaResults GenerateInstanceInfo(void);
     ViaResults GeneratePhysDevInfo(void);
+    ViaResults GeneratePhysDevProperties(uint32_t dev, VkResult enumerate_status);
     ViaResults GenerateLogicalDeviceInfo();
+    ViaResults GenerateBenchmarkInfo();
     void GenerateCleanupInfo(void);
+    ViaResults GenerateLoadTimingInfo();
 
     struct VulkanApiVersion {
         uint16_t major;
@@ -187,10 +271,18 @@ class ViaSystem {
     std::string _full_out_file;
     std::ofstream _out_ofstream;
 
+    // When set, the print and log methods called by this thread are recorded instead of written
+    static thread_local std::vector<ViaReportEntry>* _recording_report;
+
     // Command Line Argument items
     bool _run_cube_tests;
+    bool _use_library_cache;
+    bool _run_benchmarks;
+    bool _measure_load_timing;
+    bool _diff_since_last_run;
+    int _step_timeout_seconds;  // 0 if the steps are not bounded
 
-    enum ViaFileFormat { VIA_HTML_FORMAT = 0, VIA_VKCONFIG_FORMAT };
+    enum ViaFileFormat { VIA_HTML_FORMAT = 0, VIA_VKCONFIG_FORMAT, VIA_JSON_FORMAT, VIA_NDJSON_FORMAT };
     ViaFileFormat _out_file_format;
 
     // SDK items
@@ -199,14 +291,65 @@ class ViaSystem {
     bool _is_system_installed_sdk;
     bool _ran_tests;
 
-    // Table-specific items
-    bool _outputting_to_odd_row;
-    uint32_t _row_count;
-    uint32_t _col_count;
-    uint32_t _table_count;
-    uint32_t _standard_text_count;
+    // Library verification cache items, keyed by library path
+    struct LibraryCacheEntry {
+        int64_t size;
+        int64_t modified;
+        uint64_t inode;
+        bool loaded;
+        std::string error;
+        bool used;
+    };
+
+    std::string _library_cache_path;
+    std::map<std::string, LibraryCacheEntry> _library_cache;
+    bool _library_cache_changed;
+    std::mutex _library_cache_mutex;
+
+    // Manifest summaries cache items, shared with Vulkan Configurator
+    std::string _manifest_cache_path;
+    vku::ManifestCache _manifest_cache;
+
+    // Fingerprints of the report tables saved by the --diff mode
+    std::string _fingerprints_path;
+
+    // Directory index items, keyed by directory path, null when the directory can't be opened
+    std::map<std::string, std::unique_ptr<DirectoryIndex>> _directory_indices;
+    std::mutex _directory_indices_mutex;
+
+    // Report items
+    struct ViaPassTiming {
+        std::string name;
+        double seconds;
+        ViaResults result;
+    };
+
+    std::string _report_title;
+    std::string _report_timestamp;  // UTC time of StartOutput, in the ISO 8601 format
+    ViaResults _report_result;
+    std::vector<ViaPassTiming> _report_passes;
+    std::vector<ViaReportNode> _report;
 
     VulkanInstanceInfo _vulkan_1_0_info;
     VulkanInstanceInfo _vulkan_max_info;
     std::vector<std::string> _layer_override_search_path;
+
+    // Load timing items, recorded by the system info passes. Only the implicit layers enabled by the environment are recorded.
+    struct LoadTimingLayer {
+        std::string name;
+        std::string disable_env_variable;
+        std::string disable_env_value;
+    };
+
+    std::vector<LoadTimingLayer> _load_timing_layers;
+    std::vector<std::string> _load_timing_drivers;  // Paths of the driver manifests
+    std::mutex _load_timing_mutex;
+
+    // Watchdog items
+    std::thread _watchdog_thread;
+    std::mutex _watchdog_mutex;
+    std::condition_variable _watchdog_condition;
+    bool _watchdog_stopping;
+    std::string _watchdog_step;  // Empty when no step is armed
+    std::chrono::steady_clock::time_point _watchdog_deadline;
 };
@@ -30,6 +30,9 @@
 #include <sys/utsname.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <errno.h>
 #include <dlfcn.h>
 
 #include "via_system_bsd.hpp"
@@ -53,46 +56,82 @@ ViaSystemBSD::ViaSystemBSD() : ViaSystem() {
 }
 
 // Run the test in the specified directory with the corresponding
-// command-line arguments.
-// Returns 0 on no error, 1 if test file wasn't found, and -1
-// on any other errors.
-int ViaSystemBSD::RunTestInDirectory(std::string path, std::string test, std::string cmd_line) {
-    int err_code = -1;
-    char orig_dir[1024];
-    orig_dir[0] = '\0';
-
-    LogInfo("       Command-line: " + cmd_line);
-
-    if (NULL != getcwd(orig_dir, 1023)) {
-        if (path.empty()) {
-            // If the path is empty, check system paths.
-            auto const which_query = "which " + test;
-            err_code = system(which_query.c_str());
-            if (err_code != 0) {
-                LogWarning(test + " not found.  Skipping.");
-            } else {
-                err_code = system(cmd_line.c_str());
+// command-line arguments. The test is spawned with its own working
+// directory, so the working directory of VIA is never changed.
+// Returns 0 on no error, 1 if test file wasn't found, 2 if the
+// test was killed after the step timeout, and -1 on any other errors.
+int ViaSystemBSD::RunTestInDirectory(const std::string &path, const std::string &test, const std::vector<std::string> &args) {
+    std::string test_path;
+    if (path.empty()) {
+        // If the path is empty, check system paths.
+        const char *env_value = getenv("PATH");
+        if (env_value != NULL) {
+            std::string env_value_copy = env_value;
+            char *tok_state = NULL;
+            char *tok = strtok_r(&env_value_copy[0], ":", &tok_state);
+            while (tok != NULL && test_path.empty()) {
+                const std::string candidate = std::string(tok) + "/" + test;
+                if (-1 != access(candidate.c_str(), X_OK)) {
+                    test_path = candidate;
+                }
+                tok = strtok_r(NULL, ":", &tok_state);
             }
-        } else {
-            int err = chdir(path.c_str());
-            if (-1 != err) {
-                if (-1 != access(test.c_str(), X_OK)) {
-                    err_code = system(cmd_line.c_str());
-                } else {
-                    // Can't run because it's either not there or an actual
-                    // exe.  So, just return a separate error code.
-                    err_code = 1;
-                    LogWarning(test + " not found.  Skipping.");
+        }
+    } else if (-1 != access((path + "/" + test).c_str(), X_OK)) {
+        test_path = path + "/" + test;
+    }
+
+    if (test_path.empty()) {
+        // Can't run because it's either not there or an actual
+        // exe.  So, just return a separate error code.
+        LogWarning(test + " not found.  Skipping.");
+        return 1;
+    }
+
+    // The arguments are built before forking, the child only calls async-signal-safe functions
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(test.c_str()));
+    for (std::size_t i = 0, n = args.size(); i < n; ++i) {
+        argv.push_back(const_cast<char *>(args[i].c_str()));
+    }
+    argv.push_back(NULL);
+
+    const pid_t pid = fork();
+    if (pid == -1) {
+        return -1;
+    } else if (pid == 0) {
+        if (!path.empty() && chdir(path.c_str()) == -1) {
+            _exit(127);
+        }
+        execv(test_path.c_str(), &argv[0]);
+        _exit(127);
+    }
+
+    // The test is polled so that it can be killed when it hangs
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(_step_timeout_seconds);
+    int status = 0;
+    for (;;) {
+        const pid_t waited = waitpid(pid, &status, _step_timeout_seconds > 0 ? WNOHANG : 0);
+        if (waited == pid) {
+            break;
+        } else if (waited == -1 && errno != EINTR) {
+            return -1;
+        } else if (waited == 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                kill(pid, SIGKILL);
+                while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {
                 }
-            } else {
-                // Path doesn't exist at all
-                err_code = 1;
-                LogWarning(test + " not found.  Skipping.");
+                LogWarning(test + " didn't finish in " + std::to_string(_step_timeout_seconds) + " seconds.  Killed.");
+                return 2;
             }
-            err = chdir(orig_dir);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
     }
-    return err_code;
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        return 0;
+    }
+    return -1;
 }
 
 ViaSystem::ViaResults ViaSystemBSD::PrintSystemEnvironmentInfo() {
@@ -317,17 +356,7 @@ ViaSystem::ViaResults ViaSystemBSD::PrintSystemExecutableInfo() {
 
 // Utility function to determine if a driver may exist in the folder.
 static bool CheckDriver(ViaSystemBSD *via_sys_bsd, std::string &folder_loc, std::string &object_name) {
-    bool success = false;
-    (void)via_sys_bsd;
-    std::string full_name = folder_loc;
-    if (folder_loc.c_str()[folder_loc.size() - 1] != '/') {
-        full_name += "/";
-    }
-    full_name += object_name;
-    if (access(full_name.c_str(), R_OK) != -1) {
-        success = true;
-    }
-    return success;
+    return via_sys_bsd->DirectoryContains(folder_loc, object_name);
 }
 
 // Pointer to a function sed to validate if the system object is found
@@ -365,7 +394,10 @@ static bool FindBSDSystemObject(ViaSystemBSD *via_sys_bsd, std::string object_na
     // LD_LIBRARY_PATH may have multiple folders listed in it (colon
     // ':' delimited)
     if (env_value != NULL) {
-        char *tok = strtok(env_value, ":");
+        // Tokenize a copy, other passes may read the same environment variable concurrently
+        std::string env_value_copy = env_value;
+        char *tok_state = NULL;
+        char *tok = strtok_r(&env_value_copy[0], ":", &tok_state);
         while (tok != NULL) {
             if (strlen(tok) > 0) {
                 path_to_check = tok;
@@ -376,7 +408,7 @@ static bool FindBSDSystemObject(ViaSystemBSD *via_sys_bsd, std::string object_na
                     found_one = true;
                 }
             }
-            tok = strtok(NULL, ":");
+            tok = strtok_r(NULL, ":", &tok_state);
         }
     }
 
@@ -384,18 +416,6 @@ out:
     return found_one;
 }
 
-static bool VerifyOpen(std::string library_file, std::string &error) {
-    bool success = false;
-    void *handle = dlopen(library_file.c_str(), RTLD_NOW | RTLD_LOCAL);
-    if (NULL == handle) {
-        error = dlerror();
-    } else {
-        dlclose(handle);
-        success = true;
-    }
-    return success;
-}
-
 bool ViaSystemBSD::ReadDriverJson(std::string cur_driver_json, bool &found_lib) {
     bool found_json = false;
     std::ifstream *stream = NULL;
@@ -426,6 +446,8 @@ bool ViaSystemBSD::ReadDriverJson(std::string cur_driver_json, bool &found_lib)
         goto out;
     }
 
+    RecordManifest(cur_driver_json, vku::MANIFEST_TYPE_DRIVER, root);
+
     PrintBeginTableRow();
     PrintTableElement("");
     PrintTableElement("JSON File Version");
@@ -472,11 +494,11 @@ bool ViaSystemBSD::ReadDriverJson(std::string cur_driver_json, bool &found_lib)
             // First try the generated path.
             if (access(full_driver_path.c_str(), R_OK) != -1) {
                 found_lib = true;
-                could_load = VerifyOpen(full_driver_path, load_error);
+                could_load = VerifyLibrary(full_driver_path, load_error);
             } else if (driver_name.find("/") == std::string::npos) {
                 if (FindBSDSystemObject(this, driver_name, location, CheckDriver, true)) {
                     found_lib = true;
-                    could_load = VerifyOpen(location, load_error);
+                    could_load = VerifyLibrary(location, load_error);
                 }
             }
         }
@@ -578,7 +600,10 @@ void ViaSystemBSD::PrintDriverEnvVarInfo(const char* var, bool& found_json, bool
 
         // These variables may have multiple folders listed in it (colon
         // ':' delimited)
-        char *tok = strtok(env_var_value, ":");
+        // Tokenize a copy, other passes may read the same environment variable concurrently
+        std::string env_var_value_copy = env_var_value;
+        char *tok_state = NULL;
+        char *tok = strtok_r(&env_var_value_copy[0], ":", &tok_state);
         if (tok != NULL) {
             while (tok != NULL) {
                 if (access(tok, R_OK) != -1) {
@@ -598,7 +623,7 @@ void ViaSystemBSD::PrintDriverEnvVarInfo(const char* var, bool& found_json, bool
                     PrintTableElement("");
                     PrintEndTableRow();
                 }
-                tok = strtok(NULL, ":");
+                tok = strtok_r(NULL, ":", &tok_state);
             }
         } else {
             if (access(env_var_value, R_OK) != -1) {
@@ -718,15 +743,14 @@ ViaSystem::ViaResults ViaSystemBSD::PrintSystemDriverInfo() {
 // Print out all the runtime files found in a given location.  This way we
 // capture the full state of the system.
 ViaSystem::ViaResults ViaSystemBSD::PrintRuntimesInFolder(std::string &folder_loc, std::string &object_name, bool print_header) {
-    DIR *runtime_dir;
     ViaResults res = VIA_SUCCESSFUL;
 
-    runtime_dir = opendir(folder_loc.c_str());
+    // The folders are the ones searched for the driver libraries, so they are usually already indexed
+    const DirectoryIndex *runtime_dir = GetDirectoryIndex(folder_loc);
     if (NULL != runtime_dir) {
         bool file_found = false;
         FILE *pfp;
         uint32_t i = 0;
-        dirent *cur_ent;
         std::string command_str;
         std::stringstream generic_str;
         char path[1035];
@@ -739,13 +763,13 @@ ViaSystem::ViaResults ViaSystemBSD::PrintRuntimesInFolder(std::string &folder_lo
             PrintEndTableRow();
         }
 
-        while ((cur_ent = readdir(runtime_dir)) != NULL) {
-            if (NULL != strstr(cur_ent->d_name, object_name.c_str()) && strlen(cur_ent->d_name) == 14) {
+        for (const auto &cur_ent : runtime_dir->entries) {
+            if (cur_ent.find(object_name) != std::string::npos && cur_ent.size() == 14) {
                 // Get the source of this symbolic link
                 command_str = "stat -c%N \'";
                 command_str += folder_loc;
                 command_str += "/";
-                command_str += cur_ent->d_name;
+                command_str += cur_ent;
                 command_str += "\'";
                 pfp = popen(command_str.c_str(), "r");
 
@@ -757,7 +781,7 @@ ViaSystem::ViaResults ViaSystemBSD::PrintRuntimesInFolder(std::string &folder_lo
                 file_found = true;
 
                 if (pfp == NULL) {
-                    PrintTableElement(cur_ent->d_name);
+                    PrintTableElement(cur_ent);
                     PrintTableElement("Failed to retrieve symbolic link");
                     res = VIA_SYSTEM_CALL_FAILURE;
                 } else {
@@ -778,7 +802,7 @@ ViaSystem::ViaResults ViaSystemBSD::PrintRuntimesInFolder(std::string &folder_lo
                             PrintTableElement(trim_after);
                         }
                     } else {
-                        PrintTableElement(cur_ent->d_name);
+                        PrintTableElement(cur_ent);
                         PrintTableElement("Failed to retrieve symbolic link");
                     }
 
@@ -795,7 +819,6 @@ ViaSystem::ViaResults ViaSystemBSD::PrintRuntimesInFolder(std::string &folder_lo
             PrintTableElement("");
             PrintEndTableRow();
         }
-        closedir(runtime_dir);
     } else {
         PrintBeginTableRow();
         PrintTableElement(folder_loc, VIA_ALIGN_RIGHT);
@@ -1219,7 +1242,10 @@ ViaSystem::ViaResults ViaSystemBSD::PrintLayerEnvVar(const char* var) {
     char *env_value = getenv(var);
     std::string cur_json;
     if (NULL != env_value) {
-        char *tok = strtok(env_value, ":");
+        // Tokenize a copy, other passes may read the same environment variable concurrently
+        std::string env_value_copy = env_value;
+        char *tok_state = NULL;
+        char *tok = strtok_r(&env_value_copy[0], ":", &tok_state);
         std::string explicit_layer_id = var;
 
         PrintBeginTableRow();
@@ -1238,7 +1264,7 @@ ViaSystem::ViaResults ViaSystemBSD::PrintLayerEnvVar(const char* var) {
                 cur_name << "Path " << offset++;
                 explicit_layer_id = cur_name.str();
                 result = PrintExplicitLayersInFolder(explicit_layer_id, cur_json);
-                tok = strtok(NULL, ":");
+                tok = strtok_r(NULL, ":", &tok_state);
             }
         } else {
             cur_json = env_value;
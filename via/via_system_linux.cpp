@@ -29,10 +29,89 @@
 #include <sys/utsname.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <errno.h>
 #include <dlfcn.h>
+#include <link.h>
 
 #include "via_system_linux.hpp"
 
+// The system information is read from the files of the kernel and from the dynamic linker, a shell is only spawned for the
+// optional package queries
+
+// Returns the path of an executable found in the folders of PATH, or an empty string
+static std::string FindExecutableInPath(const std::string &name) {
+    const char *env_value = getenv("PATH");
+    if (env_value == NULL) {
+        return "";
+    }
+
+    std::string env_value_copy = env_value;
+    char *tok_state = NULL;
+    char *tok = strtok_r(&env_value_copy[0], ":", &tok_state);
+    while (tok != NULL) {
+        const std::string candidate = std::string(tok) + "/" + name;
+        if (-1 != access(candidate.c_str(), X_OK)) {
+            return candidate;
+        }
+        tok = strtok_r(NULL, ":", &tok_state);
+    }
+    return "";
+}
+
+// Returns the first line of a small file, such as the sysfs attributes, without the trailing new line
+static std::string ReadFirstLine(const std::string &path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// In the largest unit of which the size has at least one, rounded down
+static std::string FormatByteSize(uint64_t bytes) {
+    char generic_string[64];
+    if ((bytes >> 40) > 0x0ULL) {
+        snprintf(generic_string, 63, "%u TB", static_cast<uint32_t>(bytes >> 40));
+    } else if ((bytes >> 30) > 0x0ULL) {
+        snprintf(generic_string, 63, "%u GB", static_cast<uint32_t>(bytes >> 30));
+    } else if ((bytes >> 20) > 0x0ULL) {
+        snprintf(generic_string, 63, "%u MB", static_cast<uint32_t>(bytes >> 20));
+    } else if ((bytes >> 10) > 0x0ULL) {
+        snprintf(generic_string, 63, "%u KB", static_cast<uint32_t>(bytes >> 10));
+    } else {
+        snprintf(generic_string, 63, "%u bytes", static_cast<uint32_t>(bytes));
+    }
+    return generic_string;
+}
+
+// Returns the path the dynamic linker resolves a library name to, which is the search the loader does, instead of querying
+// ldconfig
+static bool FindLibraryInLinkerPath(const std::string &library_name, std::string &location) {
+    void *handle = dlopen(library_name.c_str(), RTLD_LAZY | RTLD_LOCAL);
+    if (handle == NULL) {
+        return false;
+    }
+
+    struct link_map *map = NULL;
+    const bool found = 0 == dlinfo(handle, RTLD_DI_LINKMAP, &map) && map != NULL && map->l_name != NULL && map->l_name[0] != '\0';
+    if (found) {
+        location = map->l_name;
+    }
+    dlclose(handle);
+    return found;
+}
+
+// dl_iterate_phdr callback returning the path of the Vulkan runtime loaded by via, instead of parsing the output of ldd
+static int FindLoadedRuntime(struct dl_phdr_info *info, size_t size, void *data) {
+    (void)size;
+    if (info->dlpi_name != NULL && NULL != strstr(info->dlpi_name, "libvulkan.so.")) {
+        *static_cast<std::string *>(data) = info->dlpi_name;
+        return 1;
+    }
+    return 0;
+}
+
 ViaSystemLinux::ViaSystemLinux() : ViaSystem() {
     char temp_c_string[1024];
     ssize_t len = ::readlink("/proc/self/exe", temp_c_string, 1023);
@@ -50,84 +129,92 @@ ViaSystemLinux::ViaSystemLinux() : ViaSystem() {
 }
 
 // Run the test in the specified directory with the corresponding
-// command-line arguments.
-// Returns 0 on no error, 1 if test file wasn't found, and -1
-// on any other errors.
-int ViaSystemLinux::RunTestInDirectory(std::string path, std::string test, std::string cmd_line) {
-    int err_code = -1;
-    char orig_dir[1024];
-    orig_dir[0] = '\0';
-
-    LogInfo("       Command-line: " + cmd_line);
-
-    if (NULL != getcwd(orig_dir, 1023)) {
-        if (path.empty()) {
-            // If the path is empty, check system paths.
-            auto const which_query = "which " + test;
-            err_code = system(which_query.c_str());
-            if (err_code != 0) {
-                err_code = 1;
-                LogWarning(test + " not found.  Skipping.");
-            } else {
-                err_code = system(cmd_line.c_str());
-            }
-        } else {
-            int err = chdir(path.c_str());
-            if (-1 != err) {
-                if (-1 != access(test.c_str(), X_OK)) {
-                    err_code = system(cmd_line.c_str());
-                } else {
-                    // Can't run because it's either not there or an actual
-                    // exe.  So, just return a separate error code.
-                    err_code = 1;
-                    LogWarning(test + " not found.  Skipping.");
+// command-line arguments. The test is spawned with its own working
+// directory, so the working directory of VIA is never changed.
+// Returns 0 on no error, 1 if test file wasn't found, 2 if the
+// test was killed after the step timeout, and -1 on any other errors.
+int ViaSystemLinux::RunTestInDirectory(const std::string &path, const std::string &test, const std::vector<std::string> &args) {
+    std::string test_path;
+    if (path.empty()) {
+        // If the path is empty, check system paths.
+        test_path = FindExecutableInPath(test);
+    } else if (-1 != access((path + "/" + test).c_str(), X_OK)) {
+        test_path = path + "/" + test;
+    }
+
+    if (test_path.empty()) {
+        // Can't run because it's either not there or an actual
+        // exe.  So, just return a separate error code.
+        LogWarning(test + " not found.  Skipping.");
+        return 1;
+    }
+
+    // The arguments are built before forking, the child only calls async-signal-safe functions
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(test.c_str()));
+    for (std::size_t i = 0, n = args.size(); i < n; ++i) {
+        argv.push_back(const_cast<char *>(args[i].c_str()));
+    }
+    argv.push_back(NULL);
+
+    const pid_t pid = fork();
+    if (pid == -1) {
+        return -1;
+    } else if (pid == 0) {
+        if (!path.empty() && chdir(path.c_str()) == -1) {
+            _exit(127);
+        }
+        execv(test_path.c_str(), &argv[0]);
+        _exit(127);
+    }
+
+    // The test is polled so that it can be killed when it hangs
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(_step_timeout_seconds);
+    int status = 0;
+    for (;;) {
+        const pid_t waited = waitpid(pid, &status, _step_timeout_seconds > 0 ? WNOHANG : 0);
+        if (waited == pid) {
+            break;
+        } else if (waited == -1 && errno != EINTR) {
+            return -1;
+        } else if (waited == 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                kill(pid, SIGKILL);
+                while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {
                 }
-            } else {
-                // Path doesn't exist at all
-                err_code = 1;
-                LogWarning(test + " not found.  Skipping.");
+                LogWarning(test + " didn't finish in " + std::to_string(_step_timeout_seconds) + " seconds.  Killed.");
+                return 2;
             }
-            err = chdir(orig_dir);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
     }
-    if (err_code && err_code != 1) {
-        err_code = -1;
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        return 0;
     }
-    return err_code;
+    return -1;
 }
 
 ViaSystem::ViaResults ViaSystemLinux::PrintSystemEnvironmentInfo() {
     ViaResults result = VIA_SUCCESSFUL;
-    char path[1035];
     char *env_value;
     utsname uts_buffer;
 
     PrintBeginTable("Environment", 3);
 
-    FILE *fp = popen("cat /etc/os-release", "r");
-    if (fp == NULL) {
+    std::ifstream os_release("/etc/os-release");
+    if (!os_release.is_open()) {
         PrintBeginTableRow();
         PrintTableElement("ERROR");
-        PrintTableElement("Failed to cat /etc/os-release");
+        PrintTableElement("Failed to read /etc/os-release");
         PrintTableElement("");
         PrintEndTableRow();
         result = VIA_SYSTEM_CALL_FAILURE;
     } else {
-        // Read the output a line at a time - output it.
-        while (fgets(path, sizeof(path) - 1, fp) != NULL) {
-            if (NULL != strstr(path, "PRETTY_NAME")) {
-                uint32_t index;
-                index = strlen(path) - 1;
-                while (path[index] == ' ' || path[index] == '\t' || path[index] == '\r' || path[index] == '\n' ||
-                       path[index] == '\"') {
-                    path[index] = '\0';
-                    index = strlen(path) - 1;
-                }
-                index = 13;
-                while (path[index] == ' ' || path[index] == '\t' || path[index] == '\"') {
-                    index++;
-                }
-                _os_name = &path[index];
+        std::string line;
+        while (std::getline(os_release, line)) {
+            if (0 == line.compare(0, 12, "PRETTY_NAME=")) {
+                _os_name = TrimWhitespace(line.substr(12), " \t\n\r\"");
                 PrintBeginTableRow();
                 PrintTableElement("Linux");
                 PrintTableElement("");
@@ -141,7 +228,6 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemEnvironmentInfo() {
                 break;
             }
         }
-        pclose(fp);
     }
 
     errno = 0;
@@ -226,10 +312,23 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemHardwareInfo() {
     int num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
     snprintf(generic_string, 1023, "%d", num_cpus);
 
+    // The CPUs of a machine are the same model, the first one is enough
+    std::string cpu_model;
+    std::ifstream cpu_info("/proc/cpuinfo");
+    std::string line;
+    while (cpu_model.empty() && std::getline(cpu_info, line)) {
+        if (0 == line.compare(0, 10, "model name")) {
+            const std::size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                cpu_model = TrimWhitespace(line.substr(colon + 1));
+            }
+        }
+    }
+
     PrintBeginTableRow();
     PrintTableElement("CPUs");
     PrintTableElement(generic_string);
-    PrintTableElement("");
+    PrintTableElement(cpu_model);
     PrintEndTableRow();
 
     memory = (sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE)) >> 10;
@@ -252,75 +351,72 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemHardwareInfo() {
     PrintTableElement(generic_string);
     PrintEndTableRow();
 
-    // Print system disk space usage
-    if (0 == statvfs("/etc/os-release", &fs_stats)) {
-        uint64_t bytes_total = (uint64_t)fs_stats.f_bsize * (uint64_t)fs_stats.f_bavail;
-        if ((bytes_total >> 40) > 0x0ULL) {
-            snprintf(generic_string, 1023, "%u TB", static_cast<uint32_t>(bytes_total >> 40));
-            PrintBeginTableRow();
-            PrintTableElement("System Disk Space");
-            PrintTableElement("Free");
-            PrintTableElement(generic_string);
-            PrintEndTableRow();
-        } else if ((bytes_total >> 30) > 0x0ULL) {
-            snprintf(generic_string, 1023, "%u GB", static_cast<uint32_t>(bytes_total >> 30));
+    // The memory the kernel estimates available to start new applications, in KB
+    std::ifstream mem_info("/proc/meminfo");
+    while (std::getline(mem_info, line)) {
+        if (0 == line.compare(0, 13, "MemAvailable:")) {
             PrintBeginTableRow();
-            PrintTableElement("System Disk Space");
-            PrintTableElement("Free");
-            PrintTableElement(generic_string);
-            PrintEndTableRow();
-        } else if ((bytes_total >> 20) > 0x0ULL) {
-            snprintf(generic_string, 1023, "%u MB", static_cast<uint32_t>(bytes_total >> 20));
-            PrintBeginTableRow();
-            PrintTableElement("System Disk Space");
-            PrintTableElement("Free");
-            PrintTableElement(generic_string);
-            PrintEndTableRow();
-        } else if ((bytes_total >> 10) > 0x0ULL) {
-            snprintf(generic_string, 1023, "%u KB", static_cast<uint32_t>(bytes_total >> 10));
-            PrintBeginTableRow();
-            PrintTableElement("System Disk Space");
-            PrintTableElement("Free");
-            PrintTableElement(generic_string);
-            PrintEndTableRow();
-        } else {
-            snprintf(generic_string, 1023, "%u bytes", static_cast<uint32_t>(bytes_total));
-            PrintBeginTableRow();
-            PrintTableElement("System Disk Space");
+            PrintTableElement("");
             PrintTableElement("Free");
-            PrintTableElement(generic_string);
+            PrintTableElement(FormatByteSize(strtoull(line.c_str() + 13, NULL, 10) << 10));
             PrintEndTableRow();
+            break;
         }
     }
 
-    // Print current directory disk space info
-    sprintf(generic_string, "df -h \'%s\' | awk \'{ print $4 } \' | tail -n 1", _cur_path.c_str());
-    FILE *fp = popen(generic_string, "r");
-    if (fp == NULL) {
+    // Print system disk space usage
+    if (0 == statvfs("/etc/os-release", &fs_stats)) {
         PrintBeginTableRow();
-        PrintTableElement("Current Dir Disk Space");
-        PrintTableElement("WARNING");
-        PrintTableElement("Failed to determine current directory disk space");
+        PrintTableElement("System Disk Space");
+        PrintTableElement("Free");
+        PrintTableElement(FormatByteSize((uint64_t)fs_stats.f_bsize * (uint64_t)fs_stats.f_bavail));
         PrintEndTableRow();
-    } else {
-        PrintBeginTableRow();
-        PrintTableElement("Current Dir Disk Space");
+    }
+
+    // Print current directory disk space info
+    PrintBeginTableRow();
+    PrintTableElement("Current Dir Disk Space");
+    if (0 == statvfs(_cur_path.c_str(), &fs_stats)) {
         PrintTableElement("Free");
-        if (fgets(generic_string, 1023, fp) != NULL) {
-            uint32_t i = 0;
-            while (generic_string[i] != '\0') {
-                if (generic_string[i] == '\n') {
-                    generic_string[i] = '\0';
-                    break;
-                }
-                i++;
+        PrintTableElement(FormatByteSize((uint64_t)fs_stats.f_bsize * (uint64_t)fs_stats.f_bavail));
+    } else {
+        PrintTableElement("WARNING");
+        PrintTableElement("Failed to determine current directory disk space");
+    }
+    PrintEndTableRow();
+
+    // The GPUs are the DRM cards, the connectors of a card are named after it and skipped
+    const DirectoryIndex *drm_dir = GetDirectoryIndex("/sys/class/drm");
+    if (NULL != drm_dir) {
+        uint32_t gpu_count = 0;
+        for (const auto &cur_ent : drm_dir->entries) {
+            if (cur_ent.compare(0, 4, "card") != 0 || cur_ent.find('-') != std::string::npos) {
+                continue;
             }
+
+            const std::string device_path = "/sys/class/drm/" + cur_ent + "/device";
+            const std::string vendor_id = ReadFirstLine(device_path + "/vendor");
+            const std::string device_id = ReadFirstLine(device_path + "/device");
+            if (vendor_id.empty()) {
+                continue;
+            }
+
+            char driver_link[1035];
+            std::string driver = "Unknown driver";
+            const ssize_t len = readlink((device_path + "/driver").c_str(), driver_link, sizeof(driver_link) - 1);
+            if (len > 0) {
+                driver_link[len] = '\0';
+                driver = driver_link;
+                driver = driver.substr(driver.rfind('/') + 1);
+            }
+
+            snprintf(generic_string, 1023, "[%d] %s", gpu_count++, cur_ent.c_str());
+            PrintBeginTableRow();
+            PrintTableElement(gpu_count == 1 ? "GPUs" : "");
             PrintTableElement(generic_string);
-        } else {
-            PrintTableElement("Failed to determine current directory disk space");
+            PrintTableElement(vendor_id + ":" + device_id + " (" + driver + ")");
+            PrintEndTableRow();
         }
-        PrintEndTableRow();
-        pclose(fp);
     }
 
     PrintEndTable();
@@ -368,17 +464,7 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemExecutableInfo() {
 
 // Utility function to determine if a driver may exist in the folder.
 static bool CheckDriver(ViaSystemLinux *via_sys_linux, std::string &folder_loc, std::string &object_name) {
-    bool success = false;
-    (void)via_sys_linux;
-    std::string full_name = folder_loc;
-    if (folder_loc.c_str()[folder_loc.size() - 1] != '/') {
-        full_name += "/";
-    }
-    full_name += object_name;
-    if (access(full_name.c_str(), R_OK) != -1) {
-        success = true;
-    }
-    return success;
+    return via_sys_linux->DirectoryContains(folder_loc, object_name);
 }
 
 // Pointer to a function sed to validate if the system object is found
@@ -437,7 +523,10 @@ static bool FindLinuxSystemObject(ViaSystemLinux *via_sys_linux, std::string obj
     // LD_LIBRARY_PATH may have multiple folders listed in it (colon
     // ':' delimited)
     if (env_value != NULL) {
-        char *tok = strtok(env_value, ":");
+        // Tokenize a copy, other passes may read the same environment variable concurrently
+        std::string env_value_copy = env_value;
+        char *tok_state = NULL;
+        char *tok = strtok_r(&env_value_copy[0], ":", &tok_state);
         while (tok != NULL) {
             if (strlen(tok) > 0) {
                 path_to_check = tok;
@@ -448,7 +537,7 @@ static bool FindLinuxSystemObject(ViaSystemLinux *via_sys_linux, std::string obj
                     found_one = true;
                 }
             }
-            tok = strtok(NULL, ":");
+            tok = strtok_r(NULL, ":", &tok_state);
         }
     }
 
@@ -456,18 +545,6 @@ out:
     return found_one;
 }
 
-static bool VerifyOpen(std::string library_file, std::string &error) {
-    bool success = false;
-    void *handle = dlopen(library_file.c_str(), RTLD_NOW | RTLD_LOCAL);
-    if (NULL == handle) {
-        error = dlerror();
-    } else {
-        dlclose(handle);
-        success = true;
-    }
-    return success;
-}
-
 bool ViaSystemLinux::ReadDriverJson(std::string cur_driver_json, bool &found_lib) {
     bool found_json = false;
     std::ifstream *stream = NULL;
@@ -498,6 +575,8 @@ bool ViaSystemLinux::ReadDriverJson(std::string cur_driver_json, bool &found_lib
         goto out;
     }
 
+    RecordManifest(cur_driver_json, vku::MANIFEST_TYPE_DRIVER, root);
+
     PrintBeginTableRow();
     PrintTableElement("");
     PrintTableElement("JSON File Version");
@@ -544,19 +623,25 @@ bool ViaSystemLinux::ReadDriverJson(std::string cur_driver_json, bool &found_lib
             // First try the generated path.
             if (access(full_driver_path.c_str(), R_OK) != -1) {
                 found_lib = true;
-                could_load = VerifyOpen(full_driver_path, load_error);
+                could_load = VerifyLibrary(full_driver_path, load_error);
             } else if (driver_name.find("/") == std::string::npos) {
                 if (FindLinuxSystemObject(this, driver_name, location, CheckDriver, true)) {
                     found_lib = true;
-                    could_load = VerifyOpen(location, load_error);
+                    could_load = VerifyLibrary(location, load_error);
                 }
             }
         }
         if (!found_lib) {
-            FILE *fp;
-            sprintf(generic_string, "/sbin/ldconfig -v -N -p | grep %s | awk \'{ print $4 }\'", driver_name.c_str());
-            fp = popen(generic_string, "r");
-            if (fp == NULL) {
+            if (FindLibraryInLinkerPath(driver_name, location)) {
+                snprintf(generic_string, 1023, "Found at %s", location.c_str());
+                PrintBeginTableRow();
+                PrintTableElement("");
+                PrintTableElement("");
+                PrintTableElement(generic_string);
+                PrintEndTableRow();
+                found_lib = true;
+                could_load = VerifyLibrary(location, load_error);
+            } else {
                 snprintf(generic_string, 1023,
                          "Failed to find driver %s "
                          "referenced by JSON %s",
@@ -566,21 +651,6 @@ bool ViaSystemLinux::ReadDriverJson(std::string cur_driver_json, bool &found_lib
                 PrintTableElement("");
                 PrintTableElement(generic_string);
                 PrintEndTableRow();
-            } else {
-                char query_res[1024];
-
-                // Read the output a line at a time - output it.
-                if (fgets(query_res, sizeof(query_res) - 1, fp) != NULL) {
-                    snprintf(generic_string, 2047, "Found at %s", query_res);
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement(generic_string);
-                    PrintEndTableRow();
-                    found_lib = true;
-                    could_load = VerifyOpen(query_res, load_error);
-                }
-                pclose(fp);
             }
         } else if (!could_load) {
             PrintBeginTableRow();
@@ -670,7 +740,10 @@ void ViaSystemLinux::PrintDriverEnvVarInfo(const char* var, bool& found_json, bo
 
         // These variables may have multiple folders listed in it (colon
         // ':' delimited)
-        char *tok = strtok(env_var_value, ":");
+        // Tokenize a copy, other passes may read the same environment variable concurrently
+        std::string env_var_value_copy = env_var_value;
+        char *tok_state = NULL;
+        char *tok = strtok_r(&env_var_value_copy[0], ":", &tok_state);
         if (tok != NULL) {
             while (tok != NULL) {
                 if (access(tok, R_OK) != -1) {
@@ -690,7 +763,7 @@ void ViaSystemLinux::PrintDriverEnvVarInfo(const char* var, bool& found_json, bo
                     PrintTableElement("");
                     PrintEndTableRow();
                 }
-                tok = strtok(NULL, ":");
+                tok = strtok_r(NULL, ":", &tok_state);
             }
         } else {
             if (access(env_var_value, R_OK) != -1) {
@@ -812,18 +885,14 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemDriverInfo() {
 // Print out all the runtime files found in a given location.  This way we
 // capture the full state of the system.
 ViaSystem::ViaResults ViaSystemLinux::PrintRuntimesInFolder(std::string &folder_loc, std::string &object_name, bool print_header) {
-    DIR *runtime_dir;
     ViaResults res = VIA_SUCCESSFUL;
 
-    runtime_dir = opendir(folder_loc.c_str());
+    // The folders are the ones searched for the driver libraries, so they are usually already indexed
+    const DirectoryIndex *runtime_dir = GetDirectoryIndex(folder_loc);
     if (NULL != runtime_dir) {
         bool file_found = false;
-        FILE *pfp;
         uint32_t i = 0;
-        dirent *cur_ent;
-        std::string command_str;
-        std::stringstream generic_str;
-        char path[1035];
+        char link_target[1035];
 
         if (print_header) {
             PrintBeginTableRow();
@@ -833,53 +902,30 @@ ViaSystem::ViaResults ViaSystemLinux::PrintRuntimesInFolder(std::string &folder_
             PrintEndTableRow();
         }
 
-        while ((cur_ent = readdir(runtime_dir)) != NULL) {
-            if (NULL != strstr(cur_ent->d_name, object_name.c_str()) && strlen(cur_ent->d_name) == 14) {
-                // Get the source of this symbolic link
-                command_str = "stat -c%N \'";
-                command_str += folder_loc;
-                command_str += "/";
-                command_str += cur_ent->d_name;
-                command_str += "\'";
-                pfp = popen(command_str.c_str(), "r");
-
-                generic_str << "[" << i++ << "]";
+        for (const auto &cur_ent : runtime_dir->entries) {
+            if (cur_ent.find(object_name) != std::string::npos && cur_ent.size() == 14) {
+                // Get the source of this symbolic link, readlink fails with EINVAL if the file is not a symbolic link
+                const std::string runtime_path = folder_loc + "/" + cur_ent;
+                const ssize_t len = readlink(runtime_path.c_str(), link_target, sizeof(link_target) - 1);
 
                 PrintBeginTableRow();
-                PrintTableElement(generic_str.str(), VIA_ALIGN_RIGHT);
+                PrintTableElement("[" + std::to_string(i++) + "]", VIA_ALIGN_RIGHT);
 
                 file_found = true;
 
-                if (pfp == NULL) {
-                    PrintTableElement(cur_ent->d_name);
-                    PrintTableElement("Failed to retrieve symbolic link");
-                    res = VIA_SYSTEM_CALL_FAILURE;
+                if (len > 0) {
+                    link_target[len] = '\0';
+                    PrintTableElement(runtime_path);
+                    PrintTableElement(link_target);
+                } else if (errno == EINVAL) {
+                    PrintTableElement(runtime_path);
+                    PrintTableElement("");
                 } else {
-                    if (NULL != fgets(path, sizeof(path) - 1, pfp)) {
-                        std::string cmd = path;
-                        size_t arrow_loc = cmd.find("->");
-                        if (arrow_loc == std::string::npos) {
-                            std::string trimmed_path = TrimWhitespace(path, " \t\n\r\'\"");
-
-                            PrintTableElement(trimmed_path);
-                            PrintTableElement("");
-                        } else {
-                            std::string before_arrow = cmd.substr(0, arrow_loc);
-                            std::string trim_before = TrimWhitespace(before_arrow, " \t\n\r\'\"");
-                            std::string after_arrow = cmd.substr(arrow_loc + 2, std::string::npos);
-                            std::string trim_after = TrimWhitespace(after_arrow, " \t\n\r\'\"");
-                            PrintTableElement(trim_before);
-                            PrintTableElement(trim_after);
-                        }
-                    } else {
-                        PrintTableElement(cur_ent->d_name);
-                        PrintTableElement("Failed to retrieve symbolic link");
-                    }
-
-                    PrintEndTableRow();
-
-                    pclose(pfp);
+                    PrintTableElement(cur_ent);
+                    PrintTableElement("Failed to retrieve symbolic link");
                 }
+
+                PrintEndTableRow();
             }
         }
         if (!file_found) {
@@ -889,7 +935,6 @@ ViaSystem::ViaResults ViaSystemLinux::PrintRuntimesInFolder(std::string &folder_
             PrintTableElement("");
             PrintEndTableRow();
         }
-        closedir(runtime_dir);
     } else {
         PrintBeginTableRow();
         PrintTableElement(folder_loc, VIA_ALIGN_RIGHT);
@@ -909,12 +954,7 @@ static bool CheckRuntime(ViaSystemLinux *via_sys_linux, std::string &folder_loc,
 ViaSystem::ViaResults ViaSystemLinux::PrintSystemLoaderInfo() {
     ViaResults result = VIA_SUCCESSFUL;
     const char vulkan_so_prefix[] = "libvulkan.so.";
-    char path[1035];
-    char generic_string[2048];
-    char buff[1024];
-    std::string runtime_dir_name;
     std::string location;
-    FILE *pfp;
 
     PrintBeginTable("Vulkan Runtimes", 3);
 
@@ -928,71 +968,27 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemLoaderInfo() {
         result = VIA_VULKAN_CANT_FIND_RUNTIME;
     }
 
-    ssize_t len = ::readlink("/proc/self/exe", buff, 1023);
-    if (len != -1) {
-        buff[len] = '\0';
-
-        std::string runtime_dir_id = "Runtime Folder Used By via";
-        snprintf(generic_string, 2047, "ldd \'%s\'", buff);
-        pfp = popen(generic_string, "r");
-        if (pfp == NULL) {
-            PrintBeginTableRow();
-            PrintTableElement(runtime_dir_id);
-            PrintTableElement("Failed to query via library info");
-            PrintTableElement("");
-            PrintEndTableRow();
-            result = VIA_SYSTEM_CALL_FAILURE;
-        } else {
-            bool found = false;
-            while (fgets(path, sizeof(path) - 1, pfp) != NULL) {
-                if (NULL != strstr(path, vulkan_so_prefix)) {
-                    std::string cmd = path;
-                    size_t arrow_loc = cmd.find("=>");
-                    if (arrow_loc == std::string::npos) {
-                        std::string trimmed_path = TrimWhitespace(path, " \t\n\r\'\"");
-                        PrintBeginTableRow();
-                        PrintTableElement(runtime_dir_id);
-                        PrintTableElement(trimmed_path);
-                        PrintTableElement("");
-                        PrintEndTableRow();
-                    } else {
-                        std::string after_arrow = cmd.substr(arrow_loc + 2);
-                        std::string before_slash = after_arrow.substr(0, after_arrow.rfind("/"));
-                        std::string trimmed = TrimWhitespace(before_slash, " \t\n\r\'\"");
+    // The runtime is the one the dynamic linker loaded in via
+    const std::string runtime_dir_id = "Runtime Folder Used By via";
+    std::string loaded_runtime;
+    dl_iterate_phdr(FindLoadedRuntime, &loaded_runtime);
+    if (loaded_runtime.empty()) {
+        PrintBeginTableRow();
+        PrintTableElement(runtime_dir_id);
+        PrintTableElement("Failed to find Vulkan SO used for via");
+        PrintTableElement("");
+        PrintEndTableRow();
+    } else {
+        std::string runtime_dir = loaded_runtime.substr(0, loaded_runtime.rfind("/"));
 
-                        PrintBeginTableRow();
-                        PrintTableElement(runtime_dir_id);
-                        PrintTableElement(trimmed);
-                        PrintTableElement("");
-                        PrintEndTableRow();
+        PrintBeginTableRow();
+        PrintTableElement(runtime_dir_id);
+        PrintTableElement(runtime_dir);
+        PrintTableElement("");
+        PrintEndTableRow();
 
-                        std::string find_so = vulkan_so_prefix;
-                        ViaResults temp_res = PrintRuntimesInFolder(trimmed, find_so, false);
-                        if (!found) {
-                            // If nothing's been found so far, save the current error message
-                            result = temp_res;
-                            // If the result was successful, then we did end up finding at least
-                            // one.
-                            if (result == VIA_SUCCESSFUL) {
-                                found = true;
-                            }
-                            // We found at least one runtime already, clear any failures
-                        } else if (found && result == VIA_VULKAN_CANT_FIND_RUNTIME) {
-                            result = VIA_SUCCESSFUL;
-                        }
-                    }
-                    break;
-                }
-            }
-            if (!found) {
-                PrintBeginTableRow();
-                PrintTableElement(runtime_dir_id);
-                PrintTableElement("Failed to find Vulkan SO used for via");
-                PrintTableElement("");
-                PrintEndTableRow();
-            }
-            pclose(pfp);
-        }
+        std::string find_so = vulkan_so_prefix;
+        result = PrintRuntimesInFolder(runtime_dir, find_so, false);
     }
 
     PrintEndTable();
@@ -1003,11 +999,8 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemLoaderInfo() {
 // locations.
 ViaSystem::ViaResults ViaSystemLinux::PrintExplicitLayersInFolder(const std::string &id, std::string &folder_loc) {
     ViaResults res = VIA_SUCCESSFUL;
-    DIR *layer_dir;
-
-    layer_dir = opendir(folder_loc.c_str());
+    const DirectoryIndex *layer_dir = GetDirectoryIndex(folder_loc);
     if (NULL != layer_dir) {
-        dirent *cur_ent;
         std::string cur_layer;
         char generic_string[1024];
         uint32_t i = 0;
@@ -1021,14 +1014,14 @@ ViaSystem::ViaResults ViaSystemLinux::PrintExplicitLayersInFolder(const std::str
         PrintEndTableRow();
 
         // Loop through each JSON in a given folder
-        while ((cur_ent = readdir(layer_dir)) != NULL) {
-            if (NULL != strstr(cur_ent->d_name, ".json")) {
+        for (const auto &cur_ent : layer_dir->entries) {
+            if (cur_ent.find(".json") != std::string::npos) {
                 found_json = true;
 
                 snprintf(generic_string, 1023, "[%d]", i++);
                 cur_layer = folder_loc;
                 cur_layer += "/";
-                cur_layer += cur_ent->d_name;
+                cur_layer += cur_ent;
 
                 // Parse the JSON file
                 std::ifstream *stream = NULL;
@@ -1037,7 +1030,7 @@ ViaSystem::ViaResults ViaSystemLinux::PrintExplicitLayersInFolder(const std::str
                     PrintBeginTableRow();
                     PrintTableElement("");
                     PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
-                    PrintTableElement(cur_ent->d_name);
+                    PrintTableElement(cur_ent);
                     PrintTableElement("ERROR reading JSON file!");
                     PrintEndTableRow();
                 } else {
@@ -1049,14 +1042,14 @@ ViaSystem::ViaResults ViaSystemLinux::PrintExplicitLayersInFolder(const std::str
                         PrintBeginTableRow();
                         PrintTableElement("");
                         PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
-                        PrintTableElement(cur_ent->d_name);
+                        PrintTableElement(cur_ent);
                         PrintTableElement(reader.getFormattedErrorMessages());
                         PrintEndTableRow();
                     } else {
                         PrintBeginTableRow();
                         PrintTableElement("");
                         PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
-                        PrintTableElement(cur_ent->d_name);
+                        PrintTableElement(cur_ent);
                         PrintTableElement("");
                         PrintEndTableRow();
 
@@ -1078,7 +1071,6 @@ ViaSystem::ViaResults ViaSystemLinux::PrintExplicitLayersInFolder(const std::str
             PrintTableElement("No JSON files found");
             PrintEndTableRow();
         }
-        closedir(layer_dir);
     } else {
         PrintBeginTableRow();
         PrintTableElement("");
@@ -1157,7 +1149,8 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemSdkInfo() {
     }
 
     // Next, try system install items
-    if (!sdk_exists) {
+    // The package query is skipped on the distributions without dpkg, this spares spawning a shell which fails
+    if (!sdk_exists && !FindExecutableInPath("dpkg-query").empty()) {
         FILE *dpkg_output = popen("dpkg-query --show --showformat='${Package} ${Version}' vulkan-sdk", "r");
 
         if (dpkg_output != nullptr) {
@@ -1170,7 +1163,8 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemSdkInfo() {
                 if (!strncmp(cur_line, target.c_str(), target.size())) {
                     uint32_t count = 0;
                     // Found it
-                    char *p = strtok(cur_line, " ");
+                    char *tok_state = NULL;
+                    char *p = strtok_r(cur_line, " ", &tok_state);
                     while (p) {
                         if (count == 0) {
                             install_name = p;
@@ -1179,7 +1173,7 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemSdkInfo() {
                             break;
                         }
                         count++;
-                        p = strtok(NULL, " ");
+                        p = strtok_r(NULL, " ", &tok_state);
                     }
                     break;
                 }
@@ -1218,8 +1212,6 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemImplicitLayerInfo() {
     uint32_t i = 0;
     char generic_string[1024];
     char cur_vulkan_layer_json[1024];
-    DIR *layer_dir;
-    dirent *cur_ent;
     std::string layer_path;
 
     PrintBeginTable("Vulkan Implicit Layers", 4);
@@ -1255,7 +1247,7 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemImplicitLayerInfo() {
                 continue;
         }
 
-        layer_dir = opendir(cur_layer_path.c_str());
+        const DirectoryIndex *layer_dir = GetDirectoryIndex(cur_layer_path);
         if (NULL != layer_dir) {
             PrintBeginTableRow();
             PrintTableElement(cur_layer_path, VIA_ALIGN_RIGHT);
@@ -1263,14 +1255,14 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemImplicitLayerInfo() {
             PrintTableElement("");
             PrintTableElement("");
             PrintEndTableRow();
-            while ((cur_ent = readdir(layer_dir)) != NULL) {
-                if (NULL != strstr(cur_ent->d_name, ".json")) {
+            for (const auto &cur_ent : layer_dir->entries) {
+                if (cur_ent.find(".json") != std::string::npos) {
                     snprintf(generic_string, 1023, "[%d]", i++);
-                    snprintf(cur_vulkan_layer_json, 1023, "%s/%s", cur_layer_path.c_str(), cur_ent->d_name);
+                    snprintf(cur_vulkan_layer_json, 1023, "%s/%s", cur_layer_path.c_str(), cur_ent.c_str());
 
                     PrintBeginTableRow();
                     PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
-                    PrintTableElement(cur_ent->d_name);
+                    PrintTableElement(cur_ent);
                     PrintTableElement("");
                     PrintTableElement("");
                     PrintEndTableRow();
@@ -1306,7 +1298,6 @@ ViaSystem::ViaResults ViaSystemLinux::PrintSystemImplicitLayerInfo() {
                     }
                 }
             }
-            closedir(layer_dir);
         } else {
             PrintBeginTableRow();
             PrintTableElement(cur_layer_path, VIA_ALIGN_RIGHT);
@@ -1328,7 +1319,10 @@ ViaSystem::ViaResults ViaSystemLinux::PrintLayerEnvVar(const char* var) {
     char *env_value = getenv(var);
     std::string cur_json;
     if (NULL != env_value) {
-        char *tok = strtok(env_value, ":");
+        // Tokenize a copy, other passes may read the same environment variable concurrently
+        std::string env_value_copy = env_value;
+        char *tok_state = NULL;
+        char *tok = strtok_r(&env_value_copy[0], ":", &tok_state);
         std::string explicit_layer_id = var;
 
         PrintBeginTableRow();
@@ -1347,7 +1341,7 @@ ViaSystem::ViaResults ViaSystemLinux::PrintLayerEnvVar(const char* var) {
                 cur_name << "Path " << offset++;
                 explicit_layer_id = cur_name.str();
                 result = PrintExplicitLayersInFolder(explicit_layer_id, cur_json);
-                tok = strtok(NULL, ":");
+                tok = strtok_r(NULL, ":", &tok_state);
             }
         } else {
             cur_json = env_value;
@@ -30,7 +30,8 @@ class ViaSystemLinux : public ViaSystem {
     ViaResults PrintRuntimesInFolder(std::string &folder_loc, std::string &object_name, bool print_header = true);
 
    protected:
-    virtual int RunTestInDirectory(std::string path, std::string test, std::string cmd_line) override;
+    virtual int RunTestInDirectory(const std::string &path, const std::string &test,
+                                   const std::vector<std::string> &args) override;
     virtual ViaResults PrintSystemEnvironmentInfo() override;
     virtual ViaResults PrintSystemHardwareInfo() override;
     virtual ViaResults PrintSystemExecutableInfo() override;
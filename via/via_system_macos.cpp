@@ -31,6 +31,9 @@
 #include <sys/utsname.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <errno.h>
 #include <dlfcn.h>
 #include <mach-o/dyld.h>
 
@@ -56,46 +59,82 @@ ViaSystemMacOS::ViaSystemMacOS() : ViaSystem() {
 }
 
 // Run the test in the specified directory with the corresponding
-// command-line arguments.
-// Returns 0 on no error, 1 if test file wasn't found, and -1
-// on any other errors.
-int ViaSystemMacOS::RunTestInDirectory(std::string path, std::string test, std::string cmd_line) {
-    int err_code = -1;
-    char orig_dir[1024];
-    orig_dir[0] = '\0';
-
-    LogInfo("       Command-line: " + cmd_line);
-
-    if (NULL != getcwd(orig_dir, 1023)) {
-        if (path.empty()) {
-            // If the path is empty, check system paths.
-            auto const which_query = "which " + test;
-            err_code = system(which_query.c_str());
-            if (err_code != 0) {
-                LogWarning(test + " not found.  Skipping.");
-            } else {
-                err_code = system(cmd_line.c_str());
+// command-line arguments. The test is spawned with its own working
+// directory, so the working directory of VIA is never changed.
+// Returns 0 on no error, 1 if test file wasn't found, 2 if the
+// test was killed after the step timeout, and -1 on any other errors.
+int ViaSystemMacOS::RunTestInDirectory(const std::string &path, const std::string &test, const std::vector<std::string> &args) {
+    std::string test_path;
+    if (path.empty()) {
+        // If the path is empty, check system paths.
+        const char *env_value = getenv("PATH");
+        if (env_value != NULL) {
+            std::string env_value_copy = env_value;
+            char *tok_state = NULL;
+            char *tok = strtok_r(&env_value_copy[0], ":", &tok_state);
+            while (tok != NULL && test_path.empty()) {
+                const std::string candidate = std::string(tok) + "/" + test;
+                if (-1 != access(candidate.c_str(), X_OK)) {
+                    test_path = candidate;
+                }
+                tok = strtok_r(NULL, ":", &tok_state);
             }
-        } else {
-            int err = chdir(path.c_str());
-            if (-1 != err) {
-                if (-1 != access(test.c_str(), X_OK)) {
-                    err_code = system(cmd_line.c_str());
-                } else {
-                    // Can't run because it's either not there or an actual
-                    // exe.  So, just return a separate error code.
-                    err_code = 1;
-                    LogWarning(test + " not found.  Skipping.");
+        }
+    } else if (-1 != access((path + "/" + test).c_str(), X_OK)) {
+        test_path = path + "/" + test;
+    }
+
+    if (test_path.empty()) {
+        // Can't run because it's either not there or an actual
+        // exe.  So, just return a separate error code.
+        LogWarning(test + " not found.  Skipping.");
+        return 1;
+    }
+
+    // The arguments are built before forking, the child only calls async-signal-safe functions
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(test.c_str()));
+    for (std::size_t i = 0, n = args.size(); i < n; ++i) {
+        argv.push_back(const_cast<char *>(args[i].c_str()));
+    }
+    argv.push_back(NULL);
+
+    const pid_t pid = fork();
+    if (pid == -1) {
+        return -1;
+    } else if (pid == 0) {
+        if (!path.empty() && chdir(path.c_str()) == -1) {
+            _exit(127);
+        }
+        execv(test_path.c_str(), &argv[0]);
+        _exit(127);
+    }
+
+    // The test is polled so that it can be killed when it hangs
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(_step_timeout_seconds);
+    int status = 0;
+    for (;;) {
+        const pid_t waited = waitpid(pid, &status, _step_timeout_seconds > 0 ? WNOHANG : 0);
+        if (waited == pid) {
+            break;
+        } else if (waited == -1 && errno != EINTR) {
+            return -1;
+        } else if (waited == 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                kill(pid, SIGKILL);
+                while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {
                 }
-            } else {
-                // Path doesn't exist at all
-                err_code = 1;
-                LogWarning(test + " not found.  Skipping.");
+                LogWarning(test + " didn't finish in " + std::to_string(_step_timeout_seconds) + " seconds.  Killed.");
+                return 2;
             }
-            err = chdir(orig_dir);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
     }
-    return err_code;
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        return 0;
+    }
+    return -1;
 }
 
 ViaSystem::ViaResults ViaSystemMacOS::PrintSystemEnvironmentInfo() {
@@ -329,17 +368,7 @@ ViaSystem::ViaResults ViaSystemMacOS::PrintSystemExecutableInfo() {
 
 // Utility function to determine if a driver may exist in the folder.
 static bool CheckDriver(ViaSystemMacOS *via_sys_macos, std::string &folder_loc, std::string &object_name) {
-    bool success = false;
-    (void)via_sys_macos;
-    std::string full_name = folder_loc;
-    if (folder_loc.c_str()[folder_loc.size() - 1] != '/') {
-        full_name += "/";
-    }
-    full_name += object_name;
-    if (access(full_name.c_str(), R_OK) != -1) {
-        success = true;
-    }
-    return success;
+    return via_sys_macos->DirectoryContains(folder_loc, object_name);
 }
 
 // Pointer to a function sed to validate if the system object is found
@@ -377,7 +406,10 @@ static bool FindMacOSSystemObject(ViaSystemMacOS *via_sys_macos, std::string obj
     // DYLD_LIBRARY_PATH may have multiple folders listed in it (colon
     // ':' delimited)
     if (env_value != NULL) {
-        char *tok = strtok(env_value, ":");
+        // Tokenize a copy, other passes may read the same environment variable concurrently
+        std::string env_value_copy = env_value;
+        char *tok_state = NULL;
+        char *tok = strtok_r(&env_value_copy[0], ":", &tok_state);
         while (tok != NULL) {
             if (strlen(tok) > 0) {
                 path_to_check = tok;
@@ -388,7 +420,7 @@ static bool FindMacOSSystemObject(ViaSystemMacOS *via_sys_macos, std::string obj
                     found_one = true;
                 }
             }
-            tok = strtok(NULL, ":");
+            tok = strtok_r(NULL, ":", &tok_state);
         }
     }
 
@@ -396,18 +428,6 @@ out:
     return found_one;
 }
 
-static bool VerifyOpen(std::string library_file, std::string &error) {
-    bool success = false;
-    void *handle = dlopen(library_file.c_str(), RTLD_NOW | RTLD_LOCAL);
-    if (NULL == handle) {
-        error = dlerror();
-    } else {
-        dlclose(handle);
-        success = true;
-    }
-    return success;
-}
-
 bool ViaSystemMacOS::ReadDriverJson(std::string cur_driver_json, bool &found_lib) {
     bool found_json = false;
     std::ifstream *stream = NULL;
@@ -438,6 +458,8 @@ bool ViaSystemMacOS::ReadDriverJson(std::string cur_driver_json, bool &found_lib
         goto out;
     }
 
+    RecordManifest(cur_driver_json, vku::MANIFEST_TYPE_DRIVER, root);
+
     PrintBeginTableRow();
     PrintTableElement("");
     PrintTableElement("JSON File Version");
@@ -484,11 +506,11 @@ bool ViaSystemMacOS::ReadDriverJson(std::string cur_driver_json, bool &found_lib
             // First try the generated path.
             if (access(full_driver_path.c_str(), R_OK) != -1) {
                 found_lib = true;
-                could_load = VerifyOpen(full_driver_path, load_error);
+                could_load = VerifyLibrary(full_driver_path, load_error);
             } else if (driver_name.find("/") == std::string::npos) {
                 if (FindMacOSSystemObject(this, driver_name, location, CheckDriver, true)) {
                     found_lib = true;
-                    could_load = VerifyOpen(location, load_error);
+                    could_load = VerifyLibrary(location, load_error);
                 }
             }
         }
@@ -507,7 +529,7 @@ bool ViaSystemMacOS::ReadDriverJson(std::string cur_driver_json, bool &found_lib
                     PrintTableElement(generic_string);
                     PrintEndTableRow();
                     found_lib = true;
-                    could_load = VerifyOpen(path.c_str(), load_error);
+                    could_load = VerifyLibrary(path.c_str(), load_error);
                     break;
                 }
             }
@@ -610,7 +632,10 @@ void ViaSystemMacOS::PrintDriverEnvVarInfo(const char *var, bool &found_json, bo
 
         // These variables may have multiple folders listed in it (colon
         // ':' delimited)
-        char *tok = strtok(env_var_value, ":");
+        // Tokenize a copy, other passes may read the same environment variable concurrently
+        std::string env_var_value_copy = env_var_value;
+        char *tok_state = NULL;
+        char *tok = strtok_r(&env_var_value_copy[0], ":", &tok_state);
         if (tok != NULL) {
             while (tok != NULL) {
                 if (access(tok, R_OK) != -1) {
@@ -630,7 +655,7 @@ void ViaSystemMacOS::PrintDriverEnvVarInfo(const char *var, bool &found_json, bo
                     PrintTableElement("");
                     PrintEndTableRow();
                 }
-                tok = strtok(NULL, ":");
+                tok = strtok_r(NULL, ":", &tok_state);
             }
         } else {
             if (access(env_var_value, R_OK) != -1) {
@@ -752,14 +777,13 @@ ViaSystem::ViaResults ViaSystemMacOS::PrintSystemDriverInfo() {
 // Print out all the runtime files found in a given location.  This way we
 // capture the full state of the system.
 ViaSystem::ViaResults ViaSystemMacOS::PrintRuntimesInFolder(std::string &folder_loc, std::string &object_name, bool print_header) {
-    DIR *runtime_dir;
     ViaResults res = VIA_SUCCESSFUL;
 
-    runtime_dir = opendir(folder_loc.c_str());
+    // The folders are the ones searched for the driver libraries, so they are usually already indexed
+    const DirectoryIndex *runtime_dir = GetDirectoryIndex(folder_loc);
     if (NULL != runtime_dir) {
         bool file_found = false;
         uint32_t i = 0;
-        dirent *cur_ent;
         std::string command_str;
         std::stringstream generic_str;
 
@@ -771,11 +795,11 @@ ViaSystem::ViaResults ViaSystemMacOS::PrintRuntimesInFolder(std::string &folder_
             PrintEndTableRow();
         }
 
-        while ((cur_ent = readdir(runtime_dir)) != NULL) {
+        for (const auto &cur_ent : runtime_dir->entries) {
             std::string name_check = object_name + "dylib";
-            if (NULL != strstr(cur_ent->d_name, name_check.c_str())) {
+            if (cur_ent.find(name_check) != std::string::npos) {
                 char buffer[1023];
-                std::string object_path = folder_loc + "/" + cur_ent->d_name;
+                std::string object_path = folder_loc + "/" + cur_ent;
                 ssize_t len = readlink(object_path.c_str(), buffer, 1023);
 
                 generic_str << "[" << i++ << "]";
@@ -786,7 +810,7 @@ ViaSystem::ViaResults ViaSystemMacOS::PrintRuntimesInFolder(std::string &folder_
                 file_found = true;
 
                 if (len == -1) {
-                    PrintTableElement(cur_ent->d_name);
+                    PrintTableElement(cur_ent);
                     PrintTableElement("Failed to retrieve symbolic link");
                     res = VIA_SYSTEM_CALL_FAILURE;
                 } else {
@@ -797,7 +821,7 @@ ViaSystem::ViaResults ViaSystemMacOS::PrintRuntimesInFolder(std::string &folder_
                         PrintTableElement(object_path);
                         PrintTableElement(trimmed_path);
                     } else {
-                        PrintTableElement(cur_ent->d_name);
+                        PrintTableElement(cur_ent);
                         PrintTableElement("Failed to retrieve symbolic link");
                     }
 
@@ -812,7 +836,6 @@ ViaSystem::ViaResults ViaSystemMacOS::PrintRuntimesInFolder(std::string &folder_
             PrintTableElement("");
             PrintEndTableRow();
         }
-        closedir(runtime_dir);
     } else {
         PrintBeginTableRow();
         PrintTableElement(folder_loc, VIA_ALIGN_RIGHT);
@@ -1181,7 +1204,10 @@ ViaSystem::ViaResults ViaSystemMacOS::PrintLayerEnvVar(const char *var) {
     char *env_value = getenv(var);
     std::string cur_json;
     if (NULL != env_value) {
-        char *tok = strtok(env_value, ":");
+        // Tokenize a copy, other passes may read the same environment variable concurrently
+        std::string env_value_copy = env_value;
+        char *tok_state = NULL;
+        char *tok = strtok_r(&env_value_copy[0], ":", &tok_state);
         std::string explicit_layer_id = var;
 
         PrintBeginTableRow();
@@ -1200,7 +1226,7 @@ ViaSystem::ViaResults ViaSystemMacOS::PrintLayerEnvVar(const char *var) {
                 cur_name << "Path " << offset++;
                 explicit_layer_id = cur_name.str();
                 result = PrintExplicitLayersInFolder(explicit_layer_id, cur_json);
-                tok = strtok(NULL, ":");
+                tok = strtok_r(NULL, ":", &tok_state);
             }
         } else {
             cur_json = env_value;
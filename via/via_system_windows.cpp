@@ -31,6 +31,7 @@ ViaSystemWindows::ViaSystemWindows() : ViaSystem() {
     _generate_unique_file = false;
     _out_file = "";
     _directory_symbol = '\\';
+    _found_device_ids = false;
 
     // Determine the user's home directory
     char home_drive[32];
@@ -182,91 +183,101 @@ static bool ReadRegKeyDword(HKEY regFolder, const char *keyPath, const char *val
     return retVal;
 }
 
-static bool FindNextRegKey(HKEY regFolder, const char *keyPath, const char *keySearch, const int itemIndex, const int maxLength,
-                           char *retString) {
-    bool retVal = false;
-    DWORD bufLen = 1023;
+// Snapshot the names of the sub-keys of a key containing keySearch, in a single pass. RegQueryInfoKey gives the number of
+// sub-keys and the longest name, so the key is opened once and the name buffer allocated once.
+static bool EnumerateRegSubKeys(HKEY regFolder, const char *keyPath, const char *keySearch, std::vector<std::string> &subKeys) {
     DWORD keyFlags = KEY_ENUMERATE_SUB_KEYS | KEY_QUERY_VALUE;
     HKEY hKey;
     LONG lret;
-    int itemCount = 0;
 
     if (g_is_wow64) {
         keyFlags |= KEY_WOW64_64KEY;
     }
 
-    *retString = '\0';
+    subKeys.clear();
     lret = RegOpenKeyExA(regFolder, keyPath, 0, keyFlags, &hKey);
+    if (lret != ERROR_SUCCESS) {
+        return false;
+    }
+
+    DWORD subKeyCount = 0;
+    DWORD maxSubKeyLen = 0;
+    lret = RegQueryInfoKeyA(hKey, NULL, NULL, NULL, &subKeyCount, &maxSubKeyLen, NULL, NULL, NULL, NULL, NULL, NULL);
     if (lret == ERROR_SUCCESS) {
-        DWORD index = 0;
-        char keyName[1024];
+        std::vector<char> keyName(maxSubKeyLen + 1);
+        subKeys.reserve(subKeyCount);
 
-        do {
-            lret = RegEnumKeyExA(hKey, index, keyName, &bufLen, NULL, NULL, NULL, NULL);
+        for (DWORD index = 0; index < subKeyCount; ++index) {
+            DWORD bufLen = static_cast<DWORD>(keyName.size());
+            lret = RegEnumKeyExA(hKey, index, keyName.data(), &bufLen, NULL, NULL, NULL, NULL);
             if (ERROR_SUCCESS != lret) {
                 break;
             }
-            if (strlen(keySearch) == 0 || NULL != strstr(keyName, keySearch)) {
-                if (itemIndex == itemCount) {
-                    strncpy_s(retString, maxLength, keyName, bufLen);
-                    retVal = true;
-                    break;
-                } else {
-                    itemCount++;
-                }
+            if (strlen(keySearch) == 0 || NULL != strstr(keyName.data(), keySearch)) {
+                subKeys.push_back(std::string(keyName.data(), bufLen));
             }
-            bufLen = 1023;
-            ++index;
-        } while (true);
+        }
     }
+    RegCloseKey(hKey);
 
-    return retVal;
+    return lret == ERROR_SUCCESS;
 }
 
-static bool FindNextRegValue(HKEY regFolder, const char *keyPath, const char *valueSearch, const int startIndex,
-                             const int maxLength, char *retString, uint32_t *retValue) {
-    bool retVal = false;
-    DWORD bufLen = 1023;
+struct RegValueEntry {
+    std::string name;
+    uint32_t dword_value;  // 0 when the value is not a REG_DWORD
+};
+
+// Snapshot the values of a key in a single pass. RegQueryInfoKey gives the number of values and the longest name and
+// data, so the key is opened once and the buffers allocated once.
+static bool EnumerateRegValues(HKEY regFolder, const char *keyPath, std::vector<RegValueEntry> &values) {
     DWORD keyFlags = KEY_ENUMERATE_SUB_KEYS | KEY_QUERY_VALUE;
-    HKEY hKey = 0;
+    HKEY hKey;
     LONG lret;
 
     if (g_is_wow64) {
         keyFlags |= KEY_WOW64_64KEY;
     }
 
-    *retValue = 0;
-    *retString = '\0';
+    values.clear();
     lret = RegOpenKeyExA(regFolder, keyPath, 0, keyFlags, &hKey);
+    if (lret != ERROR_SUCCESS) {
+        return false;
+    }
+
+    DWORD valueCount = 0;
+    DWORD maxValueNameLen = 0;
+    DWORD maxValueLen = 0;
+    lret = RegQueryInfoKeyA(hKey, NULL, NULL, NULL, NULL, NULL, NULL, &valueCount, &maxValueNameLen, &maxValueLen, NULL, NULL);
     if (lret == ERROR_SUCCESS) {
-        DWORD index = startIndex;
-        char valueName[1024];
+        std::vector<char> valueName(maxValueNameLen + 1);
+        std::vector<BYTE> data(maxValueLen > sizeof(DWORD) ? maxValueLen : sizeof(DWORD));
+        values.reserve(valueCount);
 
-        do {
-            DWORD type = REG_DWORD;
-            DWORD value = 0;
-            DWORD len = 4;
-            valueName[0] = '\0';
+        for (DWORD index = 0; index < valueCount; ++index) {
+            DWORD bufLen = static_cast<DWORD>(valueName.size());
+            DWORD len = static_cast<DWORD>(data.size());
+            DWORD type = REG_NONE;
 
-            lret = RegEnumValueA(hKey, index, valueName, &bufLen, NULL, &type, (LPBYTE)&value, &len);
+            lret = RegEnumValueA(hKey, index, valueName.data(), &bufLen, NULL, &type, data.data(), &len);
             if (ERROR_SUCCESS != lret) {
                 break;
             }
-            if (type == REG_DWORD) {
-                *retValue = value;
-            }
-            if (strlen(valueSearch) == 0 || NULL != strstr(valueName, valueSearch)) {
-                strncpy_s(retString, maxLength, valueName, bufLen);
-                retVal = true;
-                break;
-            }
 
-            bufLen = 10231;
-            ++index;
-        } while (true);
+            RegValueEntry entry;
+            entry.name.assign(valueName.data(), bufLen);
+            entry.dword_value = 0;
+            if (type == REG_DWORD && len >= sizeof(DWORD)) {
+                DWORD value;
+                memcpy(&value, data.data(), sizeof(DWORD));
+                entry.dword_value = value;
+            }
+            values.push_back(entry);
+        }
     }
+    RegCloseKey(hKey);
 
-    return retVal;
+    return lret == ERROR_SUCCESS;
 }
 
 bool ViaSystemWindows::FindDriverIdsFromPlugAndPlay() {
@@ -366,13 +377,10 @@ void FindRegistryJsons(std::vector<HKEY> &registry_top_hkey, std::vector<std::st
 
         // Find the registry settings indicating the location of the driver
         // JSON files.
-        uint32_t i = 0;
-        uint32_t returned_value = 0;
-        char cur_vulkan_driver_json[1024];
-        while (FindNextRegValue(registry_top_hkey[iter], registry_locations[iter].c_str(), "", i, 1023, cur_vulkan_driver_json,
-                                &returned_value)) {
-            json_paths.emplace_back(full_registry_path, (returned_value == 0), cur_vulkan_driver_json);
-            i++;
+        std::vector<RegValueEntry> values;
+        EnumerateRegValues(registry_top_hkey[iter], registry_locations[iter].c_str(), values);
+        for (std::size_t i = 0, n = values.size(); i < n; ++i) {
+            json_paths.emplace_back(full_registry_path, (values[i].dword_value == 0), values[i].name);
         }
     }
 }
@@ -424,31 +432,54 @@ bool ViaSystemWindows::FindDriverSpecificRegistryJsons(const std::string &key_na
 }
 
 // Run the test in the specified directory with the corresponding
-// command-line arguments.
-// Returns 0 on no error, 1 if test file wasn't found, and -1
-// on any other errors.
-int ViaSystemWindows::RunTestInDirectory(std::string path, std::string test, std::string cmd_line) {
-    int err_code = -1;
-    char orig_dir[1024];
-    orig_dir[0] = '\0';
-
-    LogInfo("       Command-line: " + cmd_line);
-
-    if (0 != GetCurrentDirectoryA(1023, orig_dir) && TRUE == SetCurrentDirectoryA(path.c_str())) {
-        if (TRUE == PathFileExists(test.c_str())) {
-            err_code = system(cmd_line.c_str());
-        } else {
-            // Path to specific exe doesn't exist
-            err_code = 1;
-            LogWarning(test + " not found.  Skipping.");
-        }
-        SetCurrentDirectoryA(orig_dir);
-    } else {
-        // Path to test doesn't exist.
-        err_code = 1;
+// command-line arguments. The test is spawned with its own working
+// directory, so the working directory of VIA is never changed.
+// Returns 0 on no error, 1 if test file wasn't found, 2 if the
+// test was killed after the step timeout, and -1 on any other errors.
+int ViaSystemWindows::RunTestInDirectory(const std::string &path, const std::string &test, const std::vector<std::string> &args) {
+    const std::string test_path = path + "\\" + test;
+    if (TRUE != PathFileExists(test_path.c_str())) {
+        // Path to specific exe doesn't exist
         LogWarning(test + " not found.  Skipping.");
+        return 1;
     }
-    return err_code;
+
+    std::string cmd_line = "\"" + test_path + "\"";
+    for (std::size_t i = 0, n = args.size(); i < n; ++i) {
+        cmd_line += " " + args[i];
+    }
+
+    STARTUPINFOA startup_info;
+    ZeroMemory(&startup_info, sizeof(startup_info));
+    startup_info.cb = sizeof(startup_info);
+    PROCESS_INFORMATION process_info;
+    ZeroMemory(&process_info, sizeof(process_info));
+
+    // CreateProcessA may modify the command-line buffer
+    std::vector<char> cmd_line_buffer(cmd_line.begin(), cmd_line.end());
+    cmd_line_buffer.push_back('\0');
+
+    if (TRUE != CreateProcessA(test_path.c_str(), &cmd_line_buffer[0], NULL, NULL, FALSE, 0, NULL, path.c_str(), &startup_info,
+                               &process_info)) {
+        return -1;
+    }
+
+    const DWORD timeout_ms = _step_timeout_seconds > 0 ? static_cast<DWORD>(_step_timeout_seconds) * 1000 : INFINITE;
+    if (WAIT_TIMEOUT == WaitForSingleObject(process_info.hProcess, timeout_ms)) {
+        TerminateProcess(process_info.hProcess, 1);
+        WaitForSingleObject(process_info.hProcess, INFINITE);
+        CloseHandle(process_info.hThread);
+        CloseHandle(process_info.hProcess);
+        LogWarning(test + " didn't finish in " + std::to_string(_step_timeout_seconds) + " seconds.  Killed.");
+        return 2;
+    }
+
+    DWORD exit_code = 1;
+    GetExitCodeProcess(process_info.hProcess, &exit_code);
+    CloseHandle(process_info.hThread);
+    CloseHandle(process_info.hProcess);
+
+    return exit_code == 0 ? 0 : -1;
 }
 
 // Determine what version an executable or library file is.
@@ -486,6 +517,15 @@ bool ViaSystemWindows::GetFileVersion(const std::string &filename, std::string &
     return success;
 }
 
+// The hardware info and the layers scans depend on the system info and the devices queried here
+void ViaSystemWindows::PrepareSystemInfo() {
+    ZeroMemory(&_system_info, sizeof(SYSTEM_INFO));
+    GetSystemInfo(&_system_info);
+
+    // Query any Graphics devices at this time
+    _found_device_ids = FindDriverIdsFromPlugAndPlay();
+}
+
 ViaSystem::ViaResults ViaSystemWindows::PrintSystemEnvironmentInfo() {
     ViaResults result = VIA_SUCCESSFUL;
     char generic_string[1024];
@@ -510,9 +550,6 @@ ViaSystem::ViaResults ViaSystemWindows::PrintSystemEnvironmentInfo() {
     ZeroMemory(&_os_version_info, sizeof(OSVERSIONINFOEX));
     _os_version_info.dwOSVersionInfoSize = sizeof(OSVERSIONINFOEX);
 
-    ZeroMemory(&_system_info, sizeof(SYSTEM_INFO));
-    GetSystemInfo(&_system_info);
-
     // Since this is Windows #ifdef code, determine the version of Windows
     // that the application is running on.  It's not trivial and has to
     // refer to items queried in the above structures as well as the
@@ -924,14 +961,6 @@ ViaSystem::ViaResults ViaSystemWindows::PrintSystemExecutableInfo() {
 bool ViaSystemWindows::PrintDriverRegistryInfo(std::vector<std::tuple<std::string, bool, std::string>> &cur_driver_json,
                                                std::string system_path, bool &found_lib) {
     bool found_json = false;
-    std::ifstream *stream = NULL;
-    Json::Value root = Json::nullValue;
-    Json::Value dev_exts = Json::nullValue;
-    Json::Value inst_exts = Json::nullValue;
-    Json::Reader reader;
-    std::string full_driver_path;
-    char generic_string[1024];
-    uint32_t j = 0;
     std::string cur_reg_name;
 
     PrintBeginTableRow();
@@ -941,6 +970,19 @@ bool ViaSystemWindows::PrintDriverRegistryInfo(std::vector<std::tuple<std::strin
     PrintTableElement("");
     PrintEndTableRow();
 
+    // The JSON files are parsed and their libraries verified concurrently, their rows are recorded and written in order
+    const std::size_t json_count = cur_driver_json.size();
+    std::vector<std::vector<ViaReportEntry>> reports(json_count);
+    std::unique_ptr<bool[]> found_jsons(new bool[json_count]());
+    std::unique_ptr<bool[]> found_libs(new bool[json_count]());
+    // This runs in a system info pass, so the calling thread restores the recording of the pass
+    RunConcurrently(json_count, [&](std::size_t i) {
+        std::vector<ViaReportEntry> *pass_report = _recording_report;
+        _recording_report = &reports[i];
+        found_jsons[i] = PrintDriverRegistryJson(std::get<2>(cur_driver_json[i]), system_path, found_libs[i]);
+        _recording_report = pass_report;
+    });
+
     for (uint32_t i = 0; i < cur_driver_json.size(); ++i) {
         std::string driver_json_name = std::get<0>(cur_driver_json[i]);
         std::string driver_json_path = std::get<2>(cur_driver_json[i]);
@@ -965,113 +1007,127 @@ bool ViaSystemWindows::PrintDriverRegistryInfo(std::vector<std::tuple<std::strin
         PrintEndTableRow();
         cur_reg_name = driver_json_name;
 
-        stream = new std::ifstream(driver_json_path.c_str(), std::ifstream::in);
-        if (nullptr == stream || stream->fail()) {
-            PrintBeginTableRow();
-            PrintTableElement("");
-            PrintTableElement("");
-            PrintTableElement("Error reading JSON file");
-            PrintTableElement(ConvertPathFormat(driver_json_path));
-            PrintEndTableRow();
-            continue;
-        }
+        ReplayReport(reports[i]);
+        found_json |= found_jsons[i];
+        found_lib |= found_libs[i];
+    }
 
-        if (!reader.parse(*stream, root, false) || root.isNull()) {
-            PrintBeginTableRow();
-            PrintTableElement("");
-            PrintTableElement("");
-            PrintTableElement("Error reading JSON file");
-            PrintTableElement(reader.getFormattedErrorMessages());
-            PrintEndTableRow();
-            stream->close();
-            delete stream;
-            stream = NULL;
-            continue;
-        }
+    return found_json;
+}
 
+// Print the content of a driver JSON file found in the registry, and verify its library
+bool ViaSystemWindows::PrintDriverRegistryJson(const std::string &driver_json_path, const std::string &system_path,
+                                               bool &found_lib) {
+    bool found_json = false;
+    std::ifstream *stream = NULL;
+    Json::Value root = Json::nullValue;
+    Json::Value dev_exts = Json::nullValue;
+    Json::Value inst_exts = Json::nullValue;
+    Json::Reader reader;
+    std::string full_driver_path;
+    char generic_string[1024];
+    uint32_t j = 0;
+
+    stream = new std::ifstream(driver_json_path.c_str(), std::ifstream::in);
+    if (nullptr == stream || stream->fail()) {
         PrintBeginTableRow();
         PrintTableElement("");
         PrintTableElement("");
-        PrintTableElement("JSON File Version");
-        if (!root["file_format_version"].isNull()) {
-            PrintTableElement(root["file_format_version"].asString());
-        } else {
-            PrintTableElement("MISSING!");
-        }
+        PrintTableElement("Error reading JSON file");
+        PrintTableElement(ConvertPathFormat(driver_json_path));
         PrintEndTableRow();
+        delete stream;
+        return found_json;
+    }
 
-        if (root["ICD"].isNull()) {
-            PrintBeginTableRow();
-            PrintTableElement("");
-            PrintTableElement("");
-            PrintTableElement("ICD Section");
-            PrintTableElement("MISSING!");
-            PrintEndTableRow();
-            stream->close();
-            delete stream;
-            stream = NULL;
-            continue;
-        }
-
-        found_json = true;
-
+    if (!reader.parse(*stream, root, false) || root.isNull()) {
         PrintBeginTableRow();
         PrintTableElement("");
         PrintTableElement("");
-        PrintTableElement("API Version");
-        if (!root["ICD"]["api_version"].isNull()) {
-            PrintTableElement(root["ICD"]["api_version"].asString());
-        } else {
-            PrintTableElement("MISSING!");
-        }
+        PrintTableElement("Error reading JSON file");
+        PrintTableElement(reader.getFormattedErrorMessages());
         PrintEndTableRow();
+        stream->close();
+        delete stream;
+        stream = NULL;
+        return found_json;
+    }
+
+    RecordManifest(driver_json_path, vku::MANIFEST_TYPE_DRIVER, root);
 
+    PrintBeginTableRow();
+    PrintTableElement("");
+    PrintTableElement("");
+    PrintTableElement("JSON File Version");
+    if (!root["file_format_version"].isNull()) {
+        PrintTableElement(root["file_format_version"].asString());
+    } else {
+        PrintTableElement("MISSING!");
+    }
+    PrintEndTableRow();
+
+    if (root["ICD"].isNull()) {
         PrintBeginTableRow();
         PrintTableElement("");
         PrintTableElement("");
-        PrintTableElement("Library Path");
-        if (!root["ICD"]["library_path"].isNull()) {
-            std::string driver_name = root["ICD"]["library_path"].asString();
-            PrintTableElement(ConvertPathFormat(driver_name));
-            PrintEndTableRow();
+        PrintTableElement("ICD Section");
+        PrintTableElement("MISSING!");
+        PrintEndTableRow();
+        stream->close();
+        delete stream;
+        stream = NULL;
+        return found_json;
+    }
 
-            if (DetermineJsonLibraryPath(driver_json_path.c_str(), driver_name.c_str(), full_driver_path)) {
-                std::string system_name = system_path;
-                system_name += "\\";
-                system_name += driver_name;
+    found_json = true;
 
-                std::string version_string;
-                if (GetFileVersion(full_driver_path, version_string)) {
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement("Library File Version");
-                    PrintTableElement(version_string);
-                    PrintEndTableRow();
+    PrintBeginTableRow();
+    PrintTableElement("");
+    PrintTableElement("");
+    PrintTableElement("API Version");
+    if (!root["ICD"]["api_version"].isNull()) {
+        PrintTableElement(root["ICD"]["api_version"].asString());
+    } else {
+        PrintTableElement("MISSING!");
+    }
+    PrintEndTableRow();
 
-                    found_lib = true;
-                } else if (GetFileVersion(system_name.c_str(), version_string)) {
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement("Library File Version");
-                    PrintTableElement(version_string);
-                    PrintEndTableRow();
+    PrintBeginTableRow();
+    PrintTableElement("");
+    PrintTableElement("");
+    PrintTableElement("Library Path");
+    if (!root["ICD"]["library_path"].isNull()) {
+        std::string driver_name = root["ICD"]["library_path"].asString();
+        PrintTableElement(ConvertPathFormat(driver_name));
+        PrintEndTableRow();
 
-                    found_lib = true;
-                } else {
-                    snprintf(generic_string, 1023, "Failed to find driver %s or %s referenced by JSON %s",
-                             ConvertPathFormat(root["ICD"]["library_path"].asString()).c_str(),
-                             ConvertPathFormat(full_driver_path).c_str(), ConvertPathFormat(driver_json_path).c_str());
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement(generic_string);
-                    PrintEndTableRow();
-                }
+        if (DetermineJsonLibraryPath(driver_json_path.c_str(), driver_name.c_str(), full_driver_path)) {
+            std::string system_name = system_path;
+            system_name += "\\";
+            system_name += driver_name;
+
+            std::string version_string;
+            if (GetFileVersion(full_driver_path, version_string)) {
+                PrintBeginTableRow();
+                PrintTableElement("");
+                PrintTableElement("");
+                PrintTableElement("Library File Version");
+                PrintTableElement(version_string);
+                PrintEndTableRow();
+
+                found_lib = true;
+            } else if (GetFileVersion(system_name.c_str(), version_string)) {
+                PrintBeginTableRow();
+                PrintTableElement("");
+                PrintTableElement("");
+                PrintTableElement("Library File Version");
+                PrintTableElement(version_string);
+                PrintEndTableRow();
+
+                found_lib = true;
             } else {
-                snprintf(generic_string, 1023, "Failed to find driver %s referenced by JSON %s",
+                snprintf(generic_string, 1023, "Failed to find driver %s or %s referenced by JSON %s",
+                         ConvertPathFormat(root["ICD"]["library_path"].asString()).c_str(),
                          ConvertPathFormat(full_driver_path).c_str(), ConvertPathFormat(driver_json_path).c_str());
                 PrintBeginTableRow();
                 PrintTableElement("");
@@ -1081,68 +1137,77 @@ bool ViaSystemWindows::PrintDriverRegistryInfo(std::vector<std::tuple<std::strin
                 PrintEndTableRow();
             }
         } else {
-            PrintTableElement("MISSING!");
-            PrintEndTableRow();
-        }
-
-        char count_str[1024];
-        j = 0;
-        dev_exts = root["ICD"]["device_extensions"];
-        if (!dev_exts.isNull() && dev_exts.isArray()) {
-            snprintf(count_str, 1023, "%d", dev_exts.size());
+            snprintf(generic_string, 1023, "Failed to find driver %s referenced by JSON %s",
+                     ConvertPathFormat(full_driver_path).c_str(), ConvertPathFormat(driver_json_path).c_str());
             PrintBeginTableRow();
             PrintTableElement("");
             PrintTableElement("");
-            PrintTableElement("Device Extensions");
-            PrintTableElement(count_str);
+            PrintTableElement("");
+            PrintTableElement(generic_string);
             PrintEndTableRow();
+        }
+    } else {
+        PrintTableElement("MISSING!");
+        PrintEndTableRow();
+    }
 
-            for (Json::ValueIterator dev_ext_it = dev_exts.begin(); dev_ext_it != dev_exts.end(); dev_ext_it++) {
-                Json::Value dev_ext = (*dev_ext_it);
-                Json::Value dev_ext_name = dev_ext["name"];
-                if (!dev_ext_name.isNull()) {
-                    snprintf(generic_string, 1023, "[%d]", j);
+    char count_str[1024];
+    j = 0;
+    dev_exts = root["ICD"]["device_extensions"];
+    if (!dev_exts.isNull() && dev_exts.isArray()) {
+        snprintf(count_str, 1023, "%d", dev_exts.size());
+        PrintBeginTableRow();
+        PrintTableElement("");
+        PrintTableElement("");
+        PrintTableElement("Device Extensions");
+        PrintTableElement(count_str);
+        PrintEndTableRow();
 
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
-                    PrintTableElement(dev_ext_name.asString());
-                    PrintEndTableRow();
-                }
+        for (Json::ValueIterator dev_ext_it = dev_exts.begin(); dev_ext_it != dev_exts.end(); dev_ext_it++) {
+            Json::Value dev_ext = (*dev_ext_it);
+            Json::Value dev_ext_name = dev_ext["name"];
+            if (!dev_ext_name.isNull()) {
+                snprintf(generic_string, 1023, "[%d]", j);
+
+                PrintBeginTableRow();
+                PrintTableElement("");
+                PrintTableElement("");
+                PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
+                PrintTableElement(dev_ext_name.asString());
+                PrintEndTableRow();
             }
         }
-        inst_exts = root["ICD"]["instance_extensions"];
-        j = 0;
-        if (!inst_exts.isNull() && inst_exts.isArray()) {
-            snprintf(count_str, 1023, "%d", inst_exts.size());
-            PrintBeginTableRow();
-            PrintTableElement("");
-            PrintTableElement("");
-            PrintTableElement("Instance Extensions");
-            PrintTableElement(count_str);
-            PrintEndTableRow();
+    }
+    inst_exts = root["ICD"]["instance_extensions"];
+    j = 0;
+    if (!inst_exts.isNull() && inst_exts.isArray()) {
+        snprintf(count_str, 1023, "%d", inst_exts.size());
+        PrintBeginTableRow();
+        PrintTableElement("");
+        PrintTableElement("");
+        PrintTableElement("Instance Extensions");
+        PrintTableElement(count_str);
+        PrintEndTableRow();
 
-            for (Json::ValueIterator inst_ext_it = inst_exts.begin(); inst_ext_it != inst_exts.end(); inst_ext_it++) {
-                Json::Value inst_ext = (*inst_ext_it);
-                Json::Value inst_ext_name = inst_ext["name"];
-                if (!inst_ext_name.isNull()) {
-                    snprintf(generic_string, 1023, "[%d]", j);
+        for (Json::ValueIterator inst_ext_it = inst_exts.begin(); inst_ext_it != inst_exts.end(); inst_ext_it++) {
+            Json::Value inst_ext = (*inst_ext_it);
+            Json::Value inst_ext_name = inst_ext["name"];
+            if (!inst_ext_name.isNull()) {
+                snprintf(generic_string, 1023, "[%d]", j);
 
-                    PrintBeginTableRow();
-                    PrintTableElement("");
-                    PrintTableElement("");
-                    PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
-                    PrintTableElement(inst_ext_name.asString());
-                    PrintEndTableRow();
-                }
+                PrintBeginTableRow();
+                PrintTableElement("");
+                PrintTableElement("");
+                PrintTableElement(generic_string, VIA_ALIGN_RIGHT);
+                PrintTableElement(inst_ext_name.asString());
+                PrintEndTableRow();
             }
         }
-        if (nullptr != stream) {
-            stream->close();
-            delete stream;
-            stream = NULL;
-        }
+    }
+    if (nullptr != stream) {
+        stream->close();
+        delete stream;
+        stream = NULL;
     }
 
     return found_json;
@@ -1169,7 +1234,8 @@ void ViaSystemWindows::PrintDriverEnvVarInfo(const char* var, const std::string&
         PrintTableElement("");
         PrintEndTableRow();
 
-        tok = strtok(env_value, ";");
+        char *tok_state = NULL;
+        tok = strtok_s(env_value, ";", &tok_state);
         if (NULL != tok) {
             keep_looping = true;
             strncpy(full_driver_path, tok, 1023);
@@ -1206,7 +1272,7 @@ void ViaSystemWindows::PrintDriverEnvVarInfo(const char* var, const std::string&
                 PrintEndTableRow();
             }
 
-            tok = strtok(NULL, ";");
+            tok = strtok_s(NULL, ";", &tok_state);
             if (NULL == tok) {
                 keep_looping = false;
             } else {
@@ -1220,8 +1286,8 @@ ViaSystem::ViaResults ViaSystemWindows::PrintSystemDriverInfo() {
     ViaResults result = VIA_SUCCESSFUL;
     PrintBeginTable("Vulkan Driver Info", 4);
 
-    // Query any Graphics devices at this time
-    if (!FindDriverIdsFromPlugAndPlay()) {
+    // The Graphics devices were queried by PrepareSystemInfo
+    if (!_found_device_ids) {
         result = VIA_MISSING_DRIVER_REGISTRY;
     } else {
         ViaResults res = VIA_SUCCESSFUL;
@@ -1289,10 +1355,12 @@ ViaSystem::ViaResults ViaSystemWindows::PrintSystemDriverInfo() {
 
 void ViaSystemWindows::PrintUninstallRegInfo(HKEY reg_folder, char *output_string, char *count_string, char *generic_string,
                                              char *version_string, unsigned int &install_count) {
-    uint32_t i = 0;
     // Find all Vulkan Runtime keys in the registry, and loop through each.
-    while (FindNextRegKey(reg_folder, g_uninstall_reg_path, "VulkanRT", i, 1023, output_string)) {
-        snprintf(count_string, 1023, "[%d]", i++);
+    std::vector<std::string> runtime_keys;
+    EnumerateRegSubKeys(reg_folder, g_uninstall_reg_path, "VulkanRT", runtime_keys);
+    for (uint32_t i = 0; i < runtime_keys.size(); ++i) {
+        snprintf(output_string, 1023, "%s", runtime_keys[i].c_str());
+        snprintf(count_string, 1023, "[%d]", i);
 
         snprintf(generic_string, 1023, "%s\\%s", g_uninstall_reg_path, output_string);
 
@@ -1480,11 +1548,13 @@ ViaSystem::ViaResults ViaSystemWindows::PrintSystemLoaderInfo() {
 }
 
 bool ViaSystemWindows::PrintSdkUninstallRegInfo(HKEY reg_folder, char *output_string, char *count_string, char *generic_string) {
-    uint32_t i = 0;
     bool found = false;
-    while (FindNextRegKey(reg_folder, g_uninstall_reg_path, "VulkanSDK", i, 1024, output_string)) {
+    std::vector<std::string> sdk_keys;
+    EnumerateRegSubKeys(reg_folder, g_uninstall_reg_path, "VulkanSDK", sdk_keys);
+    for (uint32_t i = 0; i < sdk_keys.size(); ++i) {
         found = true;
-        snprintf(count_string, 1023, "[%d]", i++);
+        snprintf(output_string, 1024, "%s", sdk_keys[i].c_str());
+        snprintf(count_string, 1023, "[%d]", i);
         snprintf(generic_string, 1023, "%s\\%s", g_uninstall_reg_path, output_string);
         ReadRegKeyString(reg_folder, generic_string, "InstallDir", 1024, output_string);
 
@@ -1880,7 +1950,8 @@ ViaSystem::ViaResults ViaSystemWindows::PrintLayerEnvVar(const char* var, bool&
 
         // Variable may have multiple folders listed in it (colon
         // ';' delimited)
-        char *tok = strtok(generic_string, ";");
+        char *tok_state = NULL;
+        char *tok = strtok_s(generic_string, ";", &tok_state);
         if (tok != NULL) {
             cur_layer_path = tok;
             keep_looping = true;
@@ -1901,7 +1972,7 @@ ViaSystem::ViaResults ViaSystemWindows::PrintLayerEnvVar(const char* var, bool&
 
             result = FindAndPrintAllExplicitLayersInPath(cur_layer_path);
 
-            tok = strtok(NULL, ";");
+            tok = strtok_s(NULL, ";", &tok_state);
             if (tok == NULL) {
                 keep_looping = false;
             } else {
@@ -2068,14 +2139,11 @@ ViaSystem::ViaResults ViaSystemWindows::PrintSystemSettingsFileInfo() {
             PrintEndTableRow();
 
             // Find the registry settings indicating the location of the settings JSON files.
-            uint32_t i = 0;
-            uint32_t returned_value = 0;
             bool printed = false;
-            char cur_vulkan_driver_json[1024];
-            while (FindNextRegValue(registry_top_hkey[iter], registry_locations[iter].c_str(), "", i, 1023, cur_vulkan_driver_json,
-                                    &returned_value)) {
-                GenerateSettingsFileJsonInfo(cur_vulkan_driver_json);
-                i++;
+            std::vector<RegValueEntry> values;
+            EnumerateRegValues(registry_top_hkey[iter], registry_locations[iter].c_str(), values);
+            for (std::size_t i = 0, n = values.size(); i < n; ++i) {
+                GenerateSettingsFileJsonInfo(values[i].name);
                 printed = true;
             }
             if (!printed) {
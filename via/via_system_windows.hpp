@@ -37,7 +37,9 @@ class ViaSystemWindows : public ViaSystem {
 
    protected:
     virtual bool IsAbsolutePath(const std::string& path) override;
-    virtual int RunTestInDirectory(std::string path, std::string test, std::string cmd_line) override;
+    virtual void PrepareSystemInfo() override;
+    virtual int RunTestInDirectory(const std::string& path, const std::string& test,
+                                   const std::vector<std::string>& args) override;
     virtual ViaResults PrintSystemEnvironmentInfo();
     virtual ViaResults PrintSystemHardwareInfo();
     virtual ViaResults PrintSystemExecutableInfo();
@@ -58,6 +60,7 @@ class ViaSystemWindows : public ViaSystem {
                                          std::vector<std::tuple<std::string, bool, std::string>>& json_paths);
     bool PrintDriverRegistryInfo(std::vector<std::tuple<std::string, bool, std::string>>& cur_driver_json, std::string system_path,
                                  bool& found_lib);
+    bool PrintDriverRegistryJson(const std::string& driver_json_path, const std::string& system_path, bool& found_lib);
     bool GetFileVersion(const std::string& filename, std::string& version_string);
     void PrintUninstallRegInfo(HKEY reg_folder, char* output_string, char* count_string, char* generic_string, char* version_string,
                                unsigned int& install_count);
@@ -73,6 +76,7 @@ class ViaSystemWindows : public ViaSystem {
     OSVERSIONINFOEX _os_version_info;
     SYSTEM_INFO _system_info;
     std::vector<std::tuple<std::string, DEVINST>> _device_ids;
+    bool _found_device_ids;
 };
 
 #endif  //  VIA_WINDOWS_TARGET
@@ -47,7 +47,12 @@ Configurator &Configurator::Get(const std::string &VULKAN_SDK) {
 }
 
 Configurator::Configurator(const std::string &VULKAN_SDK)
-    : path(VULKAN_SDK), environment(path), layers(environment), configurations(environment), request_vulkan_status(true) {}
+    : path(VULKAN_SDK),
+      environment(path),
+      layers(environment),
+      configurations(environment),
+      request_vulkan_status(true),
+      vulkan_system_outdated(true) {}
 
 Configurator::~Configurator() {
     configurations.SaveAllConfigurations(layers.available_layers);
@@ -62,6 +67,10 @@ bool Configurator::Init() {
     // override app list.
     layers.LoadAllInstalledLayers();
 
+    return this->InitConfigurations();
+}
+
+bool Configurator::InitConfigurations() {
     QSettings settings;
     if (settings.value("crashed", QVariant(false)).toBool()) {
         settings.setValue("crashed", false);
@@ -102,6 +111,7 @@ void Configurator::ActivateConfiguration(const std::string &configuration_name)
         this->environment.SetPerConfigUserDefinedLayersPaths(configuration->user_defined_paths);
         this->layers.LoadAllInstalledLayers();
         this->configurations.LoadAllConfigurations(this->layers.available_layers);
+        this->vulkan_system_outdated = true;
     }
     this->configurations.RefreshConfiguration(this->layers.available_layers);
 
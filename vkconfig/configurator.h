@@ -29,11 +29,16 @@
 #include "../vkconfig_core/configuration_manager.h"
 #include "../vkconfig_core/platform.h"
 
+#include "vulkan_util.h"
+
 class Configurator {
    public:
     static Configurator& Get(const std::string& VULKAN_SDK = "");
     bool Init();
 
+    // The second step of Init, once the layers are loaded, so that the GUI may load the layers with another thread
+    bool InitConfigurations();
+
     // The list of applications affected
    public:
     bool SupportDifferentLayerVersions(Version* return_loader_version = nullptr) const;
@@ -70,4 +75,8 @@ class Configurator {
     ConfigurationManager configurations;
     std::vector<std::string> device_names;
     bool request_vulkan_status;
+
+    // The last result of ProbeVulkanSystem, it's outdated when the layers are reloaded until the next probe starts
+    VulkanSystemInfo vulkan_system;
+    bool vulkan_system_outdated;
 };
@@ -150,6 +150,8 @@ LayersDialog::LayersDialog(QWidget *parent, const Configuration &configuration)
     connect(ui->layerTreeSorted, SIGNAL(itemClicked(QTreeWidgetItem *, int)), this,
             SLOT(OnLayerTreeSortedClicked(QTreeWidgetItem *, int)));
 
+    connect(ui->lineEditLayerFilter, SIGNAL(textChanged(const QString &)), this, SLOT(OnLayerFilterChanged(const QString &)));
+
     this->Reinit();
 }
 
@@ -200,6 +202,9 @@ void LayersDialog::Reload() {
     const std::vector<ParameterState> &ParameterStates = StoreParameterStates(this->configuration.parameters);
     std::vector<std::string> user_defined_paths = this->configuration.user_defined_paths;
 
+    // The layers binaries may have been updated too
+    this->manifest_32bits.clear();
+
     Configurator &configurator = Configurator::Get();
     configurator.configurations.available_configurations.clear();
     configurator.environment.SetPerConfigUserDefinedLayersPaths(this->configuration.user_defined_paths);
@@ -286,7 +291,11 @@ void LayersDialog::AddLayerItem(const Parameter &parameter) {
 
         decorated_name += format(" - %s", layer->api_version.str().c_str());
 
-        if (IsDLL32Bit(layer->manifest_path)) {
+        auto bits = manifest_32bits.find(layer->manifest_path);
+        if (bits == manifest_32bits.end()) {
+            bits = manifest_32bits.insert(std::make_pair(layer->manifest_path, IsDLL32Bit(layer->manifest_path))).first;
+        }
+        if (bits->second) {
             decorated_name += " (32-bit)";
         }
 
@@ -309,6 +318,13 @@ void LayersDialog::AddLayerItem(const Parameter &parameter) {
     item->setFlags(item->flags() | Qt::ItemIsSelectable);
     item->setDisabled(layer == nullptr);
 
+    std::string filtered_text = parameter.key;
+    if (layer != nullptr) {
+        filtered_text += format(" %s %s", GetLayerTypeLabel(layer->type), layer->manifest_path.c_str());
+    }
+    item->setData(0, Qt::UserRole, QString(filtered_text.c_str()));
+    FilterLayerItem(item);
+
     // Add the top level item
     ui->layerTree->addTopLevelItem(item);
 
@@ -328,6 +344,67 @@ void LayersDialog::AddLayerItem(const Parameter &parameter) {
     connect(widget, SIGNAL(selectionMade(QTreeWidgetItem *, int)), this, SLOT(layerUseChanged(QTreeWidgetItem *, int)));
 }
 
+// Whether the available layers tree lists the layers in the order of the parameters
+bool LayersDialog::IsLayerItemsOrdered() const {
+    const std::vector<Layer> &available_layers = Configurator::Get().layers.available_layers;
+
+    int item_index = 0;
+    for (std::size_t i = 0, n = this->configuration.parameters.size(); i < n; ++i) {
+        const Parameter &parameter = this->configuration.parameters[i];
+
+        // Like AddLayerItem, the missing layers that are excluded are hidden
+        if (parameter.state == LAYER_STATE_EXCLUDED && FindByKey(available_layers, parameter.key.c_str()) == nullptr) continue;
+
+        if (item_index >= ui->layerTree->topLevelItemCount()) return false;
+
+        const TreeWidgetItemParameter *item = dynamic_cast<TreeWidgetItemParameter *>(ui->layerTree->topLevelItem(item_index++));
+        assert(item != nullptr);
+        if (item->layer_name != parameter.key) return false;
+    }
+
+    return item_index == ui->layerTree->topLevelItemCount();
+}
+
+// Updates the combo boxes of the available layers tree whose parameter state changed
+void LayersDialog::UpdateLayerItemStates() {
+    for (int i = 0, n = ui->layerTree->topLevelItemCount(); i < n; ++i) {
+        QTreeWidgetItem *item = ui->layerTree->topLevelItem(i);
+
+        const TreeWidgetItemParameter *layer_item = dynamic_cast<TreeWidgetItemParameter *>(item);
+        assert(layer_item != nullptr);
+
+        const Parameter *parameter = FindByKey(this->configuration.parameters, layer_item->layer_name.c_str());
+        assert(parameter != nullptr);
+
+        WidgetTreeFriendlyComboBox *widget = dynamic_cast<WidgetTreeFriendlyComboBox *>(ui->layerTree->itemWidget(item, 1));
+        if (widget == nullptr || widget->currentIndex() == parameter->state) continue;
+
+        widget->blockSignals(true);
+        widget->setCurrentIndex(parameter->state);
+        widget->blockSignals(false);
+    }
+}
+
+void LayersDialog::FilterLayerItem(QTreeWidgetItem *item) {
+    const QString &filtered_text = item->data(0, Qt::UserRole).toString();
+    item->setHidden(!this->layer_filter.isEmpty() && !filtered_text.contains(this->layer_filter, Qt::CaseInsensitive));
+}
+
+void LayersDialog::OnLayerFilterChanged(const QString &filter) {
+    const QString &trimmed_filter = filter.trimmed();
+
+    // When the filter is only extended, the layers already hidden remain hidden
+    const bool extended = !this->layer_filter.isEmpty() && trimmed_filter.startsWith(this->layer_filter, Qt::CaseInsensitive);
+    this->layer_filter = trimmed_filter;
+
+    for (int i = 0, n = ui->layerTree->topLevelItemCount(); i < n; ++i) {
+        QTreeWidgetItem *item = ui->layerTree->topLevelItem(i);
+        if (extended && item->isHidden()) continue;
+
+        FilterLayerItem(item);
+    }
+}
+
 void LayersDialog::LoadAvailableLayersUI() {
     ui->layerTree->clear();
 
@@ -483,9 +560,10 @@ void LayersDialog::OverrideOrder(const std::string layer_name, const TreeWidgetI
     std::swap(below_parameter->overridden_rank, above_parameter->overridden_rank);
 
     OrderParameter(configuration.parameters, Configurator::Get().layers.available_layers);
-    LoadAvailableLayersUI();
+    if (!IsLayerItemsOrdered()) {
+        LoadAvailableLayersUI();
+    }
     LoadSortedLayersUI();
-    LoadUserDefinedPaths();
 
     UpdateUI();
 }
@@ -606,9 +684,13 @@ void LayersDialog::layerUseChanged(QTreeWidgetItem *item, int selection) {
 
     ui->button_reset->setEnabled(true);
 
-    LoadAvailableLayersUI();
+    // The rows of the available layers are only recreated when the state change moved some layers
+    if (IsLayerItemsOrdered()) {
+        UpdateLayerItemStates();
+    } else {
+        LoadAvailableLayersUI();
+    }
     LoadSortedLayersUI();
-    LoadUserDefinedPaths();
 
     UpdateUI();
 }
@@ -695,6 +777,7 @@ void LayersDialog::accept() {
     saved_configuration->parameters = this->configuration.parameters;
     saved_configuration->user_defined_paths = this->configuration.user_defined_paths;
     saved_configuration->setting_tree_state.clear();
+    saved_configuration->MarkDirty();
 
     configurator.configurations.SaveAllConfigurations(configurator.layers.available_layers);
     configurator.configurations.LoadAllConfigurations(configurator.layers.available_layers);
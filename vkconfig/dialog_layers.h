@@ -28,6 +28,7 @@
 #include "ui_dialog_layers.h"
 
 #include <cassert>
+#include <map>
 #include <memory>
 
 class TreeWidgetItemParameter : public QTreeWidgetItem {
@@ -63,6 +64,7 @@ class LayersDialog : public QDialog {
     void OnLayerTreeSortedClicked(QTreeWidgetItem *item, int column);
 
     void layerUseChanged(QTreeWidgetItem *item, int selection);
+    void OnLayerFilterChanged(const QString &filter);
 
    private:
     LayersDialog(const LayersDialog &) = delete;
@@ -81,6 +83,9 @@ class LayersDialog : public QDialog {
     void Reload();
     void Reinit();
     void AddLayerItem(const Parameter &parameter);
+    bool IsLayerItemsOrdered() const;
+    void UpdateLayerItemStates();
+    void FilterLayerItem(QTreeWidgetItem *item);
     void BuildParameters();
     void OverrideAllExplicitLayers();
     void OverrideOrder(const std::string layer_name, const TreeWidgetItemParameter *below, const TreeWidgetItemParameter *above);
@@ -89,5 +94,11 @@ class LayersDialog : public QDialog {
     std::string selected_available_layer_name;
     std::string selected_sorted_layer_name;
 
+    // The text typed to filter the available layers, matched against their name, type and manifest path
+    QString layer_filter;
+
+    // Whether the binary of each manifest is 32-bit, the binaries are only mapped once per dialog
+    std::map<std::string, bool> manifest_32bits;
+
     std::unique_ptr<Ui::dialog_layers> ui;
 };
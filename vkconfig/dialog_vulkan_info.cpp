@@ -20,18 +20,18 @@
  */
 
 #include "dialog_vulkan_info.h"
+#include "configurator.h"
+#include "vulkan_util.h"
 
 #include "../vkconfig_core/util.h"
 #include "../vkconfig_core/platform.h"
+#include "../vkconfig_core/override.h"
 
-#include <QProcess>
 #include <QFile>
 #include <QTextStream>
 #include <QDir>
-#include <QJsonDocument>
 #include <QJsonParseError>
 #include <QJsonObject>
-#include <QJsonValue>
 #include <QJsonArray>
 #include <QMessageBox>
 #include <QStringList>
@@ -40,13 +40,37 @@
 #include <cstdlib>
 #include <cassert>
 
-VulkanInfoDialog::VulkanInfoDialog(QWidget *parent) : QDialog(parent), ui(new Ui::dialog_vulkan_info) {
+// The last vulkaninfo output, reused while the Vulkan loader and drivers remain the same
+struct VulkanInfoCache {
+    std::string drivers_signature;
+    QJsonDocument json_document;
+};
+
+static VulkanInfoCache &GetVulkanInfoCache() {
+    static VulkanInfoCache cache;
+    return cache;
+}
+
+static QString GetVulkanInfoOutputPath() { return QDir::temp().path() + "/vulkaninfo.json"; }
+
+VulkanInfoDialog::VulkanInfoDialog(QWidget *parent)
+    : QDialog(parent), ui(new Ui::dialog_vulkan_info), configuration_surrendered(false) {
     ui->setupUi(this);
     setWindowFlags(windowFlags() & ~Qt::WindowContextHelpButtonHint);
 
+    this->connect(ui->treeWidget, SIGNAL(itemExpanded(QTreeWidgetItem *)), this, SLOT(OnItemExpanded(QTreeWidgetItem *)));
+
     Run();
 }
 
+VulkanInfoDialog::~VulkanInfoDialog() {
+    if (this->parser.joinable()) {
+        this->parser.join();
+    }
+
+    this->RestoreConfiguration();
+}
+
 void VulkanInfoDialog::Run() {
     static const char *VULKAN_INFO_PATH[] = {
         "vulkaninfoSDK",              // PLATFORM_WINDOWS
@@ -58,59 +82,122 @@ void VulkanInfoDialog::Run() {
                   "The tranlation table size doesn't match the enum number of elements");
 
     ui->treeWidget->clear();
+    this->pending_properties.clear();
+
+    ui->treeWidget->headerItem()->setText(0, "Running vulkaninfo...");
+    ui->progress_bar->show();
+
+    show();
+
+    // vulkaninfo reports the Vulkan system without the layers override of the active configuration
+    Configurator &configurator = Configurator::Get();
+    if (configurator.configurations.HasActiveConfiguration(configurator.layers.available_layers)) {
+        SurrenderConfiguration(configurator.environment);
+        this->configuration_surrendered = true;
+    }
+
+    this->drivers_signature = GetVulkanDriversSignature();
+
+    const VulkanInfoCache &cache = GetVulkanInfoCache();
+    if (!this->drivers_signature.empty() && cache.drivers_signature == this->drivers_signature) {
+        this->RestoreConfiguration();
+        this->Populate(cache.json_document);
+        return;
+    }
 
     QProcess *vulkan_info = new QProcess(this);
     vulkan_info->setProgram(VULKAN_INFO_PATH[VKC_PLATFORM]);
 
-    QString filePath = QDir::temp().path();
-
     QStringList args;
     args << "--vkconfig_output";
-    args << filePath;
+    args << QDir::temp().path();
 
     // Wait... make sure we don't pick up the old one!
-    filePath += "/vulkaninfo.json";
-    remove(filePath.toUtf8().constData());
+    remove(GetVulkanInfoOutputPath().toUtf8().constData());
+
+    // Lock and load... The dialog remains responsive while vulkaninfo runs
+    this->connect(vulkan_info, SIGNAL(finished(int, QProcess::ExitStatus)), this,
+                  SLOT(OnProcessFinished(int, QProcess::ExitStatus)));
 
-    // Lock and load...
     vulkan_info->setArguments(args);
     vulkan_info->start();
-    vulkan_info->waitForFinished();
 
-    // Check for the output file
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox msgBox;
-        msgBox.setText("Error running vulkaninfo. Is your SDK up to date and installed properly?");
-        msgBox.exec();
-        return;
+    if (!vulkan_info->waitForStarted()) {
+        this->OnProcessFinished(-1, QProcess::CrashExit);
     }
+}
+
+void VulkanInfoDialog::OnProcessFinished(int exit_code, QProcess::ExitStatus exit_status) {
+    (void)exit_code;
+    (void)exit_status;
+
+    this->RestoreConfiguration();
 
-    QString jsonText = file.readAll();
-    file.close();
+    if (this->parser.joinable()) return;
+
+    const QString file_path = GetVulkanInfoOutputPath();
+
+    this->parser = std::thread([this, file_path]() {
+        // Check for the output file
+        QFile file(file_path);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            this->parse_error = "Error running vulkaninfo. Is your SDK up to date and installed properly?";
+        } else {
+            // Convert the text to a JSON document & validate it
+            QJsonParseError json_parse_error;
+            this->parsed_document = QJsonDocument::fromJson(file.readAll(), &json_parse_error);
+            file.close();
+
+            if (json_parse_error.error != QJsonParseError::NoError) {
+                this->parse_error = "Cannot parse vulkaninfo output: " + json_parse_error.errorString();
+            } else if (this->parsed_document.isNull() || this->parsed_document.isEmpty()) {
+                this->parse_error = tr("Json document is empty!");
+            }
+        }
+
+        QMetaObject::invokeMethod(this, "OnDocumentParsed", Qt::QueuedConnection);
+    });
+}
+
+void VulkanInfoDialog::OnDocumentParsed() {
+    this->parser.join();
+
+    if (!this->parse_error.isEmpty()) {
+        ui->progress_bar->hide();
 
-    //////////////////////////////////////////////////////
-    // Convert the text to a JSON document & validate it
-    QJsonParseError parseError;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonText.toUtf8(), &parseError);
-    if (parseError.error != QJsonParseError::NoError) {
         QMessageBox msgBox;
-        msgBox.setWindowTitle("Cannot parse vulkaninfo output.");
-        msgBox.setText(parseError.errorString());
+        msgBox.setText(this->parse_error);
         msgBox.exec();
+
+        this->close();
         return;
     }
 
-    if (jsonDoc.isNull() || jsonDoc.isEmpty()) {
-        QMessageBox msgBox;
-        msgBox.setText(tr("Json document is empty!"));
-        msgBox.exec();
-        return;
+    VulkanInfoCache &cache = GetVulkanInfoCache();
+    cache.drivers_signature = this->drivers_signature;
+    cache.json_document = this->parsed_document;
+
+    this->Populate(this->parsed_document);
+}
+
+void VulkanInfoDialog::RestoreConfiguration() {
+    if (!this->configuration_surrendered) return;
+
+    this->configuration_surrendered = false;
+
+    Configurator &configurator = Configurator::Get();
+    if (configurator.configurations.HasActiveConfiguration(configurator.layers.available_layers)) {
+        OverrideConfiguration(configurator.environment, configurator.layers.available_layers,
+                              *configurator.configurations.GetActiveConfiguration());
     }
+}
+
+void VulkanInfoDialog::Populate(const QJsonDocument &json_document) {
+    ui->progress_bar->hide();
 
     /////////////////////////////////////////////////////////
     // Get the instance version and set that to the header
-    QJsonObject jsonTopObject = jsonDoc.object();
+    QJsonObject jsonTopObject = json_document.object();
     QJsonValue instance = jsonTopObject.value("Vulkan Instance Version");
     QString output = "Vulkan Instance Version: " + instance.toString();
 
@@ -142,8 +229,23 @@ void VulkanInfoDialog::Run() {
     parent_node = new QTreeWidgetItem();
     parent_node->setText(0, "Device Properties and Extensions");
     BuildDevices(rootObject, parent_node);
+}
 
-    show();
+/// The children of the tree item are only created when the user expands it, most of the properties are never looked at.
+void VulkanInfoDialog::DeferGenericProperties(const QJsonValue &json_value, QTreeWidgetItem *tree_item) {
+    tree_item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+    this->pending_properties[tree_item] = json_value;
+}
+
+void VulkanInfoDialog::OnItemExpanded(QTreeWidgetItem *item) {
+    std::map<QTreeWidgetItem *, QJsonValue>::iterator it = this->pending_properties.find(item);
+    if (it == this->pending_properties.end()) return;
+
+    QJsonValue json_value = it->second;
+    this->pending_properties.erase(it);
+
+    item->setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicatorWhenChildless);
+    TraverseGenericProperties(json_value, item);
 }
 
 /// Many large sections are generic enough to simply parse and construct a tree,
@@ -164,7 +266,7 @@ void VulkanInfoDialog::TraverseGenericProperties(QJsonValue &parentJson, QTreeWi
                 QTreeWidgetItem *pNewChild = new QTreeWidgetItem();
                 pNewChild->setText(0, fields[field]);
                 pParentTreeItem->addChild(pNewChild);
-                TraverseGenericProperties(fieldValue, pNewChild);
+                DeferGenericProperties(fieldValue, pNewChild);
                 continue;
             }
 
@@ -348,7 +450,7 @@ void VulkanInfoDialog::BuildDevices(QJsonValue &jsonValue, QTreeWidgetItem *root
             if (propertyParents[j] == "Device Extensions")
                 BuildExtensions(default_value, parent);
             else
-                TraverseGenericProperties(default_value, parent);
+                DeferGenericProperties(default_value, parent);
         }
     }
 }
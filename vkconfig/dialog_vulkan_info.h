@@ -23,13 +23,26 @@
 
 #include "ui_dialog_vulkan_info.h"
 
+#include <QProcess>
+#include <QJsonDocument>
+#include <QJsonValue>
+
+#include <map>
 #include <memory>
+#include <string>
+#include <thread>
 
 class VulkanInfoDialog : public QDialog {
     Q_OBJECT
 
    public:
     explicit VulkanInfoDialog(QWidget *parent = nullptr);
+    ~VulkanInfoDialog();
+
+   public Q_SLOTS:
+    void OnProcessFinished(int exit_code, QProcess::ExitStatus exit_status);
+    void OnDocumentParsed();
+    void OnItemExpanded(QTreeWidgetItem *item);
 
    private:
     VulkanInfoDialog(const VulkanInfoDialog &) = delete;
@@ -41,8 +54,23 @@ class VulkanInfoDialog : public QDialog {
     void BuildGroups(QJsonValue &json_value, QTreeWidgetItem *root);
     void BuildDevices(QJsonValue &json_value, QTreeWidgetItem *root);
     void TraverseGenericProperties(QJsonValue &parent_json, QTreeWidgetItem *parent_tree_item);
+    void DeferGenericProperties(const QJsonValue &json_value, QTreeWidgetItem *tree_item);
 
     void Run();
+    void Populate(const QJsonDocument &json_document);
+    void RestoreConfiguration();
 
     std::unique_ptr<Ui::dialog_vulkan_info> ui;
+
+    // The layers override is surrendered while vulkaninfo runs
+    bool configuration_surrendered;
+    std::string drivers_signature;
+
+    // vulkaninfo.json is read and parsed on this thread, the results are used by OnDocumentParsed
+    std::thread parser;
+    QJsonDocument parsed_document;
+    QString parse_error;
+
+    // The JSON values of the tree items populated when they are expanded for the first time
+    std::map<QTreeWidgetItem *, QJsonValue> pending_properties;
 };
@@ -24,13 +24,12 @@
 #include "main_doc.h"
 #include "main_signal.h"
 
-#include <cassert>
+#include "../vkconfig_core/profiler.h"
 
-int main(int argc, char* argv[]) {
-    InitSignals();
-
-    const CommandLine command_line(argc, argv);
+#include <cassert>
+#include <cstdio>
 
+static int run(int argc, char* argv[], const CommandLine& command_line) {
     if (command_line.error != ERROR_NONE) {
         command_line.log();
         command_line.usage();
@@ -65,3 +64,19 @@ int main(int argc, char* argv[]) {
         }
     }
 }
+
+int main(int argc, char* argv[]) {
+    InitSignals();
+
+    const CommandLine command_line(argc, argv);
+
+    EnableProfiler(command_line.profile);
+
+    const int result = run(argc, argv, command_line);
+
+    if (command_line.profile) {
+        printf("%s", GetProfilerReport().c_str());
+    }
+
+    return result;
+}
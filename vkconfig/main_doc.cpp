@@ -92,6 +92,23 @@ int run_doc_settings(const CommandLine& command_line) {
     return rval;
 }
 
+int run_doc_all(const CommandLine& command_line) {
+    PathManager paths(command_line.command_vulkan_sdk);
+    Environment environment(paths);
+    environment.Reset(Environment::DEFAULT);
+
+    LayerManager layers(environment);
+    layers.LoadAllInstalledLayers();
+
+    if (layers.available_layers.empty()) {
+        fprintf(stderr, "vkconfig: Could not find any layer\n");
+        fprintf(stderr, "Run \"vkconfig layers --list\" to get list of available layers\n");
+        return -1;
+    }
+
+    return ExportAllDocs(layers.available_layers, command_line.doc_out_dir);
+}
+
 int run_doc(const CommandLine& command_line) {
     assert(command_line.command == COMMAND_DOC);
     assert(command_line.error == ERROR_NONE);
@@ -106,6 +123,9 @@ int run_doc(const CommandLine& command_line) {
         case COMMAND_DOC_SETTINGS: {
             return run_doc_settings(command_line);
         }
+        case COMMAND_DOC_ALL: {
+            return run_doc_all(command_line);
+        }
         default: {
             assert(0);
             return -1;
@@ -65,10 +65,8 @@ int run_gui(int argc, char* argv[], const CommandLine& command_line) {
         }
     }
 
-    // We simply cannot run without any layers
-    Configurator& configurator = Configurator::Get(command_line.command_vulkan_sdk);
-
-    if (!configurator.Init()) return -1;
+    // The layers and the configurations are loaded by the main window once it's shown
+    Configurator::Get(command_line.command_vulkan_sdk);
 
     // The main GUI is driven here
     MainWindow main_window;
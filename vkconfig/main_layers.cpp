@@ -31,11 +31,14 @@ static int RunLayersOverride(const CommandLine& command_line) {
     Environment environment(paths);
     environment.Reset(Environment::DEFAULT);
 
+    const QJsonDocument& json_document = ParseConfigurationFile(command_line.layers_configuration_path);
+
+    // Only the layers used by the configuration are needed to override the layers
     LayerManager layers(environment);
-    layers.LoadAllInstalledLayers();
+    layers.LoadLayers(ReadConfigurationLayerKeys(json_document));
 
     Configuration configuration;
-    const bool load_result = configuration.Load(layers.available_layers, command_line.layers_configuration_path.c_str());
+    const bool load_result = configuration.Load(layers.available_layers, json_document);
     if (!load_result) {
         printf("\nFailed to load the layers configuration file...\n");
         return -1;
@@ -138,6 +141,8 @@ int run_layers(const CommandLine& command_line) {
     assert(command_line.command == COMMAND_LAYERS);
     assert(command_line.error == ERROR_NONE);
 
+    EnableLayerInterfaceData(false);
+
     switch (command_line.command_layers_arg) {
         case COMMAND_LAYERS_OVERRIDE: {
             return RunLayersOverride(command_line);
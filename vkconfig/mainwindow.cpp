@@ -37,6 +37,8 @@
 #include "../vkconfig_core/help.h"
 #include "../vkconfig_core/doc.h"
 #include "../vkconfig_core/date.h"
+#include "../vkconfig_core/profiler.h"
+#include "../vkconfig_core/override.h"
 
 #include <QProcess>
 #include <QMessageBox>
@@ -47,6 +49,9 @@
 #include <QLineEdit>
 #include <QSettings>
 #include <QDesktopServices>
+#include <QApplication>
+#include <QDir>
+#include <QInputDialog>
 
 #if VKC_PLATFORM == VKC_PLATFORM_LINUX || VKC_PLATFORM == VKC_PLATFORM_MACOS
 #include <unistd.h>
@@ -54,6 +59,23 @@
 
 #include <cassert>
 
+// The log browser only displays the last lines of the output of the launched application, the output is kept in full in the
+// log file. The output pending display is bounded as well, so that the memory and the GUI time don't depend on its volume.
+static const int LOG_MAX_BLOCK_COUNT = 2048;
+static const int LOG_PENDING_MAX_SIZE = 4 * 1024 * 1024;
+
+// The frames presented during the first second of each run of the layer cost estimate are not measured
+static const double LAYER_COST_WARMUP_MS = 1000.0;
+static const int LAYER_COST_TERMINATE_MS = 5000;
+
+// The live statistics panel is updated at a fixed rate, whatever the amount of layer output
+static const int LIVE_STATS_INTERVAL_MS = 500;
+// The memory budget is sampled by the monitor layer every that many presents
+static const char *LIVE_STATS_MEMORY_BUDGET_FRAMES = "60";
+
+// Only the environment values that changed are saved, so checking them often costs little
+static const int ENVIRONMENT_SAVE_INTERVAL_MS = 2000;
+
 static const int LAUNCH_COLUMN0_SIZE = 220;
 static const int LAUNCH_COLUMN2_SIZE = 32;
 static const int LAUNCH_SPACING_SIZE = 2;
@@ -67,6 +89,17 @@ MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
       _launch_application(nullptr),
       _log_file(nullptr),
+      _log_omitted_lines(0),
+      _refresh_flags(0),
+      _vulkan_system_surrendered(false),
+      _layers_loading(false),
+      _layer_cost_index(0),
+      _layer_cost_duration_ms(0),
+      _layer_cost_terminated(false),
+      _live_stats_launches(0),
+#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
+      _layer_registry_changed(false),
+#endif
       _launcher_apps_combo(nullptr),
       _launcher_executable(nullptr),
       _launcher_arguments(nullptr),
@@ -96,6 +129,7 @@ MainWindow::MainWindow(QWidget *parent)
 
     connect(ui->actionVulkan_Installation, SIGNAL(triggered(bool)), this, SLOT(toolsVulkanInstallation(bool)));
     connect(ui->actionRestore_Default_Configurations, SIGNAL(triggered(bool)), this, SLOT(toolsResetToDefault(bool)));
+    connect(ui->actionEstimate_Layer_Costs, SIGNAL(triggered(bool)), this, SLOT(toolsEstimateLayerCosts(bool)));
 
     connect(ui->configuration_tree, SIGNAL(itemChanged(QTreeWidgetItem *, int)), this,
             SLOT(OnConfigurationItemChanged(QTreeWidgetItem *, int)));
@@ -113,6 +147,40 @@ MainWindow::MainWindow(QWidget *parent)
 
     connect(ui->launcher_loader_debug, SIGNAL(currentIndexChanged(int)), this, SLOT(OnLauncherLoaderMessageChanged(int)));
 
+    // Installers write several files, the layers are reloaded once they are done
+    _layer_paths_timer.setSingleShot(true);
+    _layer_paths_timer.setInterval(500);
+    connect(&_layer_paths_watcher, SIGNAL(directoryChanged(const QString &)), &_layer_paths_timer, SLOT(start()));
+    connect(&_layer_paths_watcher, SIGNAL(fileChanged(const QString &)), &_layer_paths_timer, SLOT(start()));
+    connect(&_layer_paths_timer, SIGNAL(timeout()), this, SLOT(OnLayerPathsChanged()));
+
+#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
+    // The registry is only searched again when it changed
+    Configurator::Get().layers.EnableRegistryCache(true);
+    _layer_registry_watcher.reset(new RegistryWatcher([this]() {
+        _layer_registry_changed = true;
+        _layer_paths_timer.start();
+    }));
+#endif
+
+    _layer_cost_timer.setSingleShot(true);
+    connect(&_layer_cost_timer, SIGNAL(timeout()), this, SLOT(OnLayerCostTimeout()));
+
+    _live_stats_timer.setInterval(LIVE_STATS_INTERVAL_MS);
+    connect(&_live_stats_timer, SIGNAL(timeout()), this, SLOT(OnLiveStatsTimeout()));
+
+    _log_timer.setSingleShot(true);
+    _log_timer.setInterval(50);
+    connect(&_log_timer, SIGNAL(timeout()), this, SLOT(FlushLog()));
+
+    _refresh_timer.setSingleShot(true);
+    _refresh_timer.setInterval(0);
+    connect(&_refresh_timer, SIGNAL(timeout()), this, SLOT(OnRefresh()));
+
+    _environment_timer.setInterval(ENVIRONMENT_SAVE_INTERVAL_MS);
+    connect(&_environment_timer, SIGNAL(timeout()), this, SLOT(OnEnvironmentTimeout()));
+    _environment_timer.start();
+
     Configurator &configurator = Configurator::Get();
     Environment &environment = configurator.environment;
 
@@ -123,24 +191,32 @@ MainWindow::MainWindow(QWidget *parent)
     ui->splitter_2->restoreState(environment.Get(LAYOUT_MAIN_SPLITTER2));
     ui->splitter_3->restoreState(environment.Get(LAYOUT_MAIN_SPLITTER3));
 
-    LoadConfigurationList();
+    StartLayersLoading();
 
     // Resetting this from the default prevents the log window (a QTextEdit) from overflowing.
     // Whenever the control surpasses this block count, old blocks are discarded.
     // Note: We could make this a user configurable setting down the road should this be
     // insufficinet.
-    ui->log_browser->document()->setMaximumBlockCount(2048);
+    ui->log_browser->document()->setMaximumBlockCount(LOG_MAX_BLOCK_COUNT);
     ui->configuration_tree->scrollToItem(ui->configuration_tree->topLevelItem(0), QAbstractItemView::PositionAtTop);
 
-    if (configurator.configurations.HasSelectConfiguration()) {
-        _settings_tree_manager.CreateGUI(ui->settings_tree);
+    ScheduleRefresh(REFRESH_SETTINGS_TREE);
+}
+
+MainWindow::~MainWindow() {
+    // The override files of the active configuration are restored, and no other run is started when the application is killed
+    StopLayerCostEstimate();
+    ResetLaunchApplication();
+
+    if (_layers_thread.joinable()) {
+        _layers_thread.join();
     }
 
-    UpdateUI();
+    if (_vulkan_system_thread.joinable()) {
+        _vulkan_system_thread.join();
+    }
 }
 
-MainWindow::~MainWindow() { ResetLaunchApplication(); }
-
 static std::string GetMainWindowTitle(bool active) {
 #if VKCONFIG_DATE
     std::string title = format("%s %s-%s", VKCONFIG_NAME, Version::VKCONFIG.str().c_str(), GetBuildDate().c_str());
@@ -152,6 +228,8 @@ static std::string GetMainWindowTitle(bool active) {
 }
 
 void MainWindow::UpdateUI() {
+    ScopedTimer timer("MainWindow::UpdateUI");
+
     Configurator &configurator = Configurator::Get();
     const Environment &environment = Configurator::Get().environment;
     const bool has_select_configuration = configurator.configurations.HasSelectConfiguration();
@@ -236,6 +314,7 @@ void MainWindow::UpdateUI() {
     const bool has_application_list = !environment.GetApplications().empty();
     ui->push_button_launcher->setEnabled(has_application_list);
     ui->push_button_launcher->setText(_launch_application ? "Terminate" : "Launch");
+    ui->actionEstimate_Layer_Costs->setEnabled(_layer_cost_runs.empty());
     ui->check_box_clear_on_launch->setChecked(environment.Get(LAYOUT_LAUNCHER_NOT_CLEAR) != "true");
     ui->launcher_loader_debug->setCurrentIndex(environment.GetLoaderMessage());
 
@@ -265,10 +344,15 @@ void MainWindow::UpdateUI() {
         _launcher_log_file_edit->setEnabled(has_application_list);
     }
 
-    if (configurator.request_vulkan_status) {
+    if (configurator.request_vulkan_status && (configurator.vulkan_system_outdated || _vulkan_system_thread.joinable())) {
+        // The status is reported once the Vulkan system is probed, without blocking the GUI
+        StartVulkanSystemProbe();
+    } else if (configurator.request_vulkan_status) {
+        _log_pending.clear();
+        _log_omitted_lines = 0;
         ui->log_browser->clear();
 
-        ui->log_browser->setPlainText(("Vulkan Development Status:\n" + GenerateVulkanStatus()).c_str());
+        ui->log_browser->setPlainText(("Vulkan Development Status:\n" + GenerateVulkanStatus(configurator.vulkan_system)).c_str());
         ui->push_button_clear_log->setEnabled(true);
         configurator.request_vulkan_status = false;
 
@@ -283,13 +367,225 @@ void MainWindow::UpdateUI() {
                        .c_str());
 
     ui->configuration_tree->blockSignals(false);
+
+    UpdateLayerPathsWatcher();
 }
 
 void MainWindow::UpdateConfiguration() {}
 
+void MainWindow::StartVulkanSystemProbe() {
+    if (_vulkan_system_thread.joinable()) return;
+
+    _log_pending.clear();
+    _log_omitted_lines = 0;
+    ui->log_browser->setPlainText("Vulkan Development Status:\n- Probing the Vulkan system...\n");
+
+    Configurator &configurator = Configurator::Get();
+    configurator.vulkan_system_outdated = false;
+
+    // The probe doesn't load the layers of the active configuration
+    _vulkan_system_surrendered = configurator.configurations.HasActiveConfiguration(configurator.layers.available_layers);
+    if (_vulkan_system_surrendered) {
+        SurrenderConfiguration(configurator.environment);
+    }
+
+    _vulkan_system_thread = std::thread([this]() {
+        _vulkan_system_probe = ProbeVulkanSystem();
+        QMetaObject::invokeMethod(this, "OnVulkanSystemProbed", Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::OnVulkanSystemProbed() {
+    _vulkan_system_thread.join();
+
+    Configurator &configurator = Configurator::Get();
+
+    if (_vulkan_system_surrendered && configurator.configurations.HasActiveConfiguration(configurator.layers.available_layers)) {
+        OverrideConfiguration(configurator.environment, configurator.layers.available_layers,
+                              *configurator.configurations.GetActiveConfiguration());
+    }
+    _vulkan_system_surrendered = false;
+
+    // When the layers were reloaded during the probe, the status request starts another probe
+    configurator.vulkan_system = _vulkan_system_probe;
+    configurator.request_vulkan_status = true;
+
+    ScheduleRefresh(REFRESH_UI);
+}
+
+void MainWindow::StartLayersLoading() {
+    Configurator &configurator = Configurator::Get();
+
+    _layers_loading = true;
+
+    // Until the configurations are loaded, the widgets using them are disabled and only the last active configuration is shown
+    ui->group_box_management->setEnabled(false);
+    ui->group_box_configurations->setEnabled(false);
+    ui->group_box_settings->setEnabled(false);
+    ui->push_button_launcher->setEnabled(false);
+    ui->menuTools->setEnabled(false);
+
+    ui->configuration_tree->clear();
+    const std::string active_configuration = configurator.environment.Get(ACTIVE_CONFIGURATION);
+    if (!active_configuration.empty()) {
+        QTreeWidgetItem *item = new QTreeWidgetItem();
+        item->setText(1, active_configuration.c_str());
+        ui->configuration_tree->addTopLevelItem(item);
+    }
+
+    ui->log_browser->setPlainText("Vulkan Development Status:\n- Loading the Vulkan layers...\n");
+
+    // The alerts are shown once the layers are loaded, by the GUI thread
+    configurator.layers.DeferAlerts(true);
+
+    _layers_thread = std::thread([this]() {
+        Configurator::Get().layers.LoadAllInstalledLayers();
+        QMetaObject::invokeMethod(this, "OnLayersLoaded", Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::OnLayersLoaded() {
+    _layers_thread.join();
+    _layers_loading = false;
+
+    Configurator &configurator = Configurator::Get();
+    configurator.layers.DeferAlerts(false);
+    configurator.layers.ReportInvalidManifests();
+
+    configurator.InitConfigurations();
+
+    // The configurations group box is enabled by UpdateUI depending on the override mode
+    ui->group_box_management->setEnabled(true);
+    ui->group_box_settings->setEnabled(true);
+    ui->menuTools->setEnabled(true);
+
+    LoadConfigurationList();
+    ScheduleRefresh(REFRESH_SETTINGS_TREE);
+}
+
+void MainWindow::ScheduleRefresh(RefreshFlags refresh_flags) {
+    // The settings tree references the configuration data which may be changing, it's only recreated by the refresh pass
+    if (refresh_flags & (REFRESH_CONFIGURATION_LIST | REFRESH_SETTINGS_TREE)) {
+        _settings_tree_manager.CleanupGUI();
+    }
+
+    _refresh_flags |= refresh_flags;
+    if (!_refresh_timer.isActive()) _refresh_timer.start();
+}
+
+void MainWindow::OnRefresh() {
+    // The refreshes requested during the startup are done once the layers are loaded
+    if (_layers_loading) return;
+
+    Configurator &configurator = Configurator::Get();
+
+    if (_refresh_flags & REFRESH_OVERRIDE) {
+        configurator.configurations.RefreshConfiguration(configurator.layers.available_layers);
+    }
+
+    if (_refresh_flags & REFRESH_CONFIGURATION_LIST) {
+        LoadConfigurationList();
+    }
+
+    // UpdateUI already recreates the settings tree when it reports the Vulkan status of an active configuration
+    const bool settings_tree_updated = configurator.request_vulkan_status && !configurator.vulkan_system_outdated &&
+                                       !_vulkan_system_thread.joinable() &&
+                                       configurator.configurations.HasActiveConfiguration(configurator.layers.available_layers);
+
+    if ((_refresh_flags & REFRESH_SETTINGS_TREE) && !settings_tree_updated) {
+        if (configurator.configurations.HasSelectConfiguration()) {
+            _settings_tree_manager.CreateGUI(ui->settings_tree);
+        }
+    }
+
+    // The refresh steps above may request a UI update too, it's done below
+    _refresh_flags = 0;
+    _refresh_timer.stop();
+
+    UpdateUI();
+}
+
+// The layer search folders change with the user-defined paths of the active configuration
+void MainWindow::UpdateLayerPathsWatcher() {
+    const Configurator &configurator = Configurator::Get();
+
+    QStringList paths;
+    for (std::size_t i = 0, n = configurator.layers.searched_paths.size(); i < n; ++i) {
+        const QString path(configurator.layers.searched_paths[i].c_str());
+        if (CheckDirectoryExists(configurator.layers.searched_paths[i]) && !paths.contains(path)) {
+            paths.append(path);
+        }
+    }
+
+    // Modified manifests don't change their folder on all platforms, so the manifests are watched too
+    for (std::size_t i = 0, n = configurator.layers.available_layers.size(); i < n; ++i) {
+        const QString path(configurator.layers.available_layers[i].manifest_path.c_str());
+        if (!path.startsWith(":/") && !paths.contains(path)) {
+            paths.append(path);
+        }
+    }
+
+    paths.sort();
+    QStringList watched_paths = _layer_paths_watcher.directories() + _layer_paths_watcher.files();
+    watched_paths.sort();
+    if (watched_paths == paths) return;
+
+    if (!watched_paths.empty()) {
+        _layer_paths_watcher.removePaths(watched_paths);
+    }
+    if (!paths.empty()) {
+        _layer_paths_watcher.addPaths(paths);
+    }
+}
+
+void MainWindow::OnLayerPathsChanged() {
+    // The dialogs use the layers, they are reloaded when the dialogs are closed
+    if (QApplication::activeModalWidget() != nullptr || _layers_loading) {
+        _layer_paths_timer.start();
+        return;
+    }
+
+    Configurator &configurator = Configurator::Get();
+
+#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
+    if (_layer_registry_changed) {
+        configurator.layers.InvalidateRegistryCache();
+        _layer_registry_changed = false;
+    }
+#endif
+
+    const LayerChanges &changes = configurator.layers.LoadAllInstalledLayers();
+    if (changes.Empty()) {
+        UpdateLayerPathsWatcher();
+        return;
+    }
+
+    for (std::size_t i = 0, n = changes.added.size(); i < n; ++i) {
+        Log(format("Layer found: %s", changes.added[i].c_str()));
+    }
+    for (std::size_t i = 0, n = changes.updated.size(); i < n; ++i) {
+        Log(format("Layer updated: %s", changes.updated[i].c_str()));
+    }
+    for (std::size_t i = 0, n = changes.removed.size(); i < n; ++i) {
+        Log(format("Layer removed: %s", changes.removed[i].c_str()));
+    }
+
+    const std::string active_configuration = configurator.environment.Get(ACTIVE_CONFIGURATION);
+
+    configurator.configurations.LoadAllConfigurations(configurator.layers.available_layers);
+    configurator.vulkan_system_outdated = true;
+
+    LoadConfigurationList();
+    SelectConfigurationItem(active_configuration);
+
+    ScheduleRefresh(REFRESH_OVERRIDE | REFRESH_SETTINGS_TREE);
+}
+
 // Load or refresh the list of configuration. Any configuration that uses a layer that
 // is not detected on the system is disabled.
 void MainWindow::LoadConfigurationList() {
+    ScopedTimer timer("MainWindow::LoadConfigurationList");
+
     // There are lots of ways into this, and in none of them
     // can we have an active editor running.
     _settings_tree_manager.CleanupGUI();
@@ -322,7 +618,7 @@ void MainWindow::LoadConfigurationList() {
     ui->configuration_tree->resizeColumnToContents(1);
 
     configurator.request_vulkan_status = true;
-    this->UpdateUI();
+    this->ScheduleRefresh(REFRESH_UI);
 }
 
 /// Okay, because we are using custom controls, some of
@@ -347,10 +643,9 @@ void MainWindow::on_radio_override_clicked() {
     Configurator &configurator = Configurator::Get();
 
     configurator.environment.SetMode(OVERRIDE_MODE_ACTIVE, true);
-    configurator.configurations.RefreshConfiguration(configurator.layers.available_layers);
     configurator.request_vulkan_status = true;
 
-    UpdateUI();
+    ScheduleRefresh(REFRESH_OVERRIDE);
 }
 
 // No override at all, fully controlled by the application
@@ -358,10 +653,9 @@ void MainWindow::on_radio_fully_clicked() {
     Configurator &configurator = Configurator::Get();
 
     configurator.environment.SetMode(OVERRIDE_MODE_ACTIVE, false);
-    configurator.configurations.RefreshConfiguration(configurator.layers.available_layers);
     configurator.request_vulkan_status = true;
 
-    UpdateUI();
+    ScheduleRefresh(REFRESH_OVERRIDE);
 }
 
 // We want to apply to just the app list... hang on there. Doe we have the new loader?
@@ -396,9 +690,7 @@ void MainWindow::on_check_box_apply_list_clicked() {
         dialog.exec();
     }
 
-    configurator.configurations.RefreshConfiguration(configurator.layers.available_layers);
-
-    UpdateUI();
+    ScheduleRefresh(REFRESH_OVERRIDE);
 }
 
 void MainWindow::on_check_box_persistent_clicked() {
@@ -417,9 +709,143 @@ void MainWindow::toolsResetToDefault(bool checked) {
     Configurator &configurator = Configurator::Get();
     configurator.ResetToDefault(true);
 
-    LoadConfigurationList();
+    ScheduleRefresh(REFRESH_CONFIGURATION_LIST);
+}
 
-    UpdateUI();
+void MainWindow::toolsEstimateLayerCosts(bool checked) {
+    (void)checked;
+
+    Configurator &configurator = Configurator::Get();
+    const Configuration *configuration = configurator.configurations.GetActiveConfiguration();
+
+    if (_launch_application != nullptr || configuration == nullptr || configurator.environment.GetApplications().empty() ||
+        FindByKey(configurator.layers.available_layers, LAYER_COST_MONITOR_NAME) == nullptr) {
+        QMessageBox alert;
+        alert.QDialog::setWindowTitle("Estimate Layer Costs");
+        alert.setText("The layer costs can't be estimated.");
+        alert.setInformativeText(
+            format("The application of the launcher is run with the layers overridden by the active configuration one at a time, "
+                   "with %s to log the frames. It requires an active configuration, an application not already running and %s.",
+                   LAYER_COST_MONITOR_NAME, LAYER_COST_MONITOR_NAME)
+                .c_str());
+        alert.setIcon(QMessageBox::Warning);
+        alert.exec();
+        return;
+    }
+
+    bool accepted = false;
+    const int duration = QInputDialog::getInt(this, "Estimate Layer Costs", "Duration of each run of the application, in seconds:",
+                                              10, 2, 600, 1, &accepted);
+    if (!accepted) return;
+
+    // The runs use the last setting changes
+    _settings_tree_manager.FlushRefresh();
+
+    _layer_cost_runs = PlanLayerCostRuns(*configuration, configurator.layers.available_layers);
+    _layer_cost_index = 0;
+    _layer_cost_duration_ms = duration * 1000;
+
+    _log_pending.clear();
+    _log_omitted_lines = 0;
+    ui->log_browser->clear();
+    Log(format("Estimating the layer costs of \"%s\" configuration:\n- Application: %s\n- %d runs of %d seconds\n",
+               configuration->key.c_str(), configurator.environment.GetActiveApplication().app_name.c_str(),
+               static_cast<int>(_layer_cost_runs.size()), duration));
+
+    StartLayerCostRun();
+}
+
+static std::string GetLayerCostLogPath(std::size_t run_index) {
+    return format("%s/layer_cost_%d.csv", GetPath(BUILTIN_PATH_APPDATA).c_str(), static_cast<int>(run_index));
+}
+
+void MainWindow::StartLayerCostRun() {
+    Configurator &configurator = Configurator::Get();
+    const LayerCostRun &run = _layer_cost_runs[_layer_cost_index];
+
+    // The active configuration may have been changed meanwhile
+    const Configuration *configuration = configurator.configurations.GetActiveConfiguration();
+    if (configuration == nullptr) {
+        StopLayerCostEstimate();
+        return;
+    }
+
+    OverrideConfiguration(configurator.environment, configurator.layers.available_layers,
+                          MakeLayerCostConfiguration(*configuration, configurator.layers.available_layers, run));
+
+    const std::string log_path = GetLayerCostLogPath(_layer_cost_index);
+    QFile::remove(log_path.c_str());
+
+    // The environment variable has precedence over the monitor settings of the configuration
+    QStringList environment;
+    const QStringList &variables = BuildEnvVariables();
+    for (int i = 0, n = variables.size(); i < n; ++i) {
+        if (!variables[i].startsWith("VK_MONITOR_LOG_FILE=")) environment << variables[i];
+    }
+    environment << (QString("VK_MONITOR_LOG_FILE=") + log_path.c_str());
+
+    Log(format("- Run %d of %d: %s\n", static_cast<int>(_layer_cost_index + 1), static_cast<int>(_layer_cost_runs.size()),
+               run.label.c_str()));
+
+    _layer_cost_terminated = false;
+    _layer_cost_launch_time = std::chrono::steady_clock::now();
+    if (!LaunchApplication(environment)) {
+        StopLayerCostEstimate();
+        return;
+    }
+
+    _layer_cost_timer.start(_layer_cost_duration_ms);
+    ScheduleRefresh(REFRESH_UI);
+}
+
+void MainWindow::OnLayerCostTimeout() {
+    if (_launch_application == nullptr) return;
+
+    // The application is asked to quit first, so that the monitor layer writes its last frames
+    if (!_layer_cost_terminated) {
+        _layer_cost_terminated = true;
+        _launch_application->terminate();
+        _layer_cost_timer.start(LAYER_COST_TERMINATE_MS);
+    } else {
+        _launch_application->kill();
+    }
+}
+
+// Called once the application of the run exited
+void MainWindow::FinishLayerCostRun() {
+    _layer_cost_timer.stop();
+
+    LayerCostRun &run = _layer_cost_runs[_layer_cost_index];
+    run.done = true;
+    run.valid = LoadFrameLogStats(GetLayerCostLogPath(_layer_cost_index), LAYER_COST_WARMUP_MS, run.stats);
+
+    // The steady clock is shared by the processes, so the timestamps of the frame log are comparable with the launch time
+    if (run.valid) {
+        const uint64_t launch_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(_layer_cost_launch_time.time_since_epoch()).count());
+        run.startup_ms = run.stats.first_present_ns > launch_ns ? (run.stats.first_present_ns - launch_ns) / 1000000.0 : 0.0;
+    }
+
+    if (++_layer_cost_index < _layer_cost_runs.size()) {
+        StartLayerCostRun();
+        return;
+    }
+
+    Log("\nLayer costs, compared with the run without layers:\n" + GenerateLayerCostReport(_layer_cost_runs));
+    StopLayerCostEstimate();
+}
+
+void MainWindow::StopLayerCostEstimate() {
+    if (_layer_cost_runs.empty()) return;
+
+    _layer_cost_timer.stop();
+    _layer_cost_runs.clear();
+
+    // Restore the override of the active configuration
+    Configurator &configurator = Configurator::Get();
+    configurator.configurations.RefreshConfiguration(configurator.layers.available_layers);
+
+    ScheduleRefresh(REFRESH_UI);
 }
 
 // Thist signal actually comes from the radio button
@@ -437,7 +863,7 @@ void MainWindow::OnConfigurationItemClicked(bool checked) {
 
     Configurator::Get().ActivateConfiguration(item->configuration_name);
 
-    UpdateUI();
+    ScheduleRefresh(REFRESH_UI);
 }
 
 void MainWindow::OnConfigurationTreeClicked(QTreeWidgetItem *item, int column) {
@@ -448,7 +874,7 @@ void MainWindow::OnConfigurationTreeClicked(QTreeWidgetItem *item, int column) {
         Configurator::Get().ActivateConfiguration(configuration_item->configuration_name);
     }
 
-    UpdateUI();
+    ScheduleRefresh(REFRESH_UI);
 }
 
 /// An item has been changed. Check for edit of the items name (configuration name)
@@ -500,6 +926,7 @@ void MainWindow::OnConfigurationItemChanged(QTreeWidgetItem *item, int column) {
             // Rename configuration ; Remove old configuration file ; change the name of the configuration
             configurator.configurations.RemoveConfigurationFile(old_name);
             configuration->key = configuration_item->configuration_name = new_name;
+            configuration->MarkDirty();
             configurator.configurations.SaveAllConfigurations(configurator.layers.available_layers);
             configurator.configurations.LoadAllConfigurations(configurator.layers.available_layers);
 
@@ -510,7 +937,7 @@ void MainWindow::OnConfigurationItemChanged(QTreeWidgetItem *item, int column) {
         }
     }
 
-    UpdateUI();
+    ScheduleRefresh(REFRESH_UI);
 }
 
 /// This gets called with keyboard selections and clicks that do not necessarily
@@ -550,8 +977,9 @@ void MainWindow::OnHelpAbout(bool checked) {
 void MainWindow::StartTool(Tool tool) {
     std::string active_configuration;
 
+    // VulkanInfoDialog runs vulkaninfo in the background so it surrenders the layers override itself until vulkaninfo is done
     Configurator &configurator = Configurator::Get();
-    if (configurator.configurations.HasActiveConfiguration(configurator.layers.available_layers)) {
+    if (tool != TOOL_VULKAN_INFO && configurator.configurations.HasActiveConfiguration(configurator.layers.available_layers)) {
         active_configuration = configurator.configurations.GetActiveConfiguration()->key;
         configurator.configurations.SetActiveConfiguration(configurator.layers.available_layers, nullptr);
     }
@@ -684,7 +1112,7 @@ void MainWindow::resizeEvent(QResizeEvent *event) {
 void MainWindow::showEvent(QShowEvent *event) {
     (void)event;
 
-    UpdateUI();
+    ScheduleRefresh(REFRESH_UI);
 
     event->accept();
 }
@@ -694,10 +1122,7 @@ void MainWindow::on_push_button_applications_clicked() {
     ApplicationsDialog dlg(this);
     dlg.exec();
 
-    Configurator &configurator = Configurator::Get();
-    configurator.configurations.RefreshConfiguration(configurator.layers.available_layers);
-
-    UpdateUI();
+    ScheduleRefresh(REFRESH_OVERRIDE);
 }
 
 void MainWindow::on_push_button_new_clicked() { this->NewClicked(); }
@@ -719,7 +1144,7 @@ void MainWindow::on_push_button_duplicate_clicked() {
 
     configurator.ActivateConfiguration(duplicated_configuration.key);
 
-    LoadConfigurationList();
+    ScheduleRefresh(REFRESH_CONFIGURATION_LIST);
 }
 
 void MainWindow::on_push_button_edit_clicked() {
@@ -731,7 +1156,7 @@ void MainWindow::on_push_button_edit_clicked() {
 
     LayersDialog dlg(this, *configuration);
     if (dlg.exec() == QDialog::Accepted) {
-        LoadConfigurationList();
+        ScheduleRefresh(REFRESH_CONFIGURATION_LIST);
     }
 }
 
@@ -747,7 +1172,7 @@ void MainWindow::EditClicked(ConfigurationListItem *item) {
 
     LayersDialog dlg(this, *configuration);
     if (dlg.exec() == QDialog::Accepted) {
-        LoadConfigurationList();
+        ScheduleRefresh(REFRESH_CONFIGURATION_LIST);
     }
 }
 
@@ -771,7 +1196,7 @@ void MainWindow::NewClicked() {
             break;
     }
 
-    LoadConfigurationList();
+    ScheduleRefresh(REFRESH_CONFIGURATION_LIST);
 }
 
 void MainWindow::RemoveConfiguration(const std::string &configuration_name) {
@@ -792,7 +1217,7 @@ void MainWindow::RemoveConfiguration(const std::string &configuration_name) {
     Configurator &configurator = Configurator::Get();
     configurator.configurations.RemoveConfiguration(configurator.layers.available_layers, configuration_name);
     configurator.request_vulkan_status = true;
-    LoadConfigurationList();
+    ScheduleRefresh(REFRESH_CONFIGURATION_LIST);
 }
 
 void MainWindow::RemoveClicked(ConfigurationListItem *item) {
@@ -830,9 +1255,11 @@ void MainWindow::ResetClicked(ConfigurationListItem *item) {
     alert.setIcon(QMessageBox::Warning);
     if (alert.exec() == QMessageBox::No) return;
 
+    _settings_tree_manager.CleanupGUI();
+
     configuration->Reset(configurator.layers.available_layers, configurator.path);
 
-    LoadConfigurationList();
+    ScheduleRefresh(REFRESH_CONFIGURATION_LIST);
 }
 
 void MainWindow::RenameClicked(ConfigurationListItem *item) {
@@ -878,7 +1305,7 @@ void MainWindow::ImportClicked(ConfigurationListItem *item) {
     if (full_import_path.empty()) return;
 
     configurator.configurations.ImportConfiguration(configurator.layers.available_layers, full_import_path);
-    LoadConfigurationList();
+    ScheduleRefresh(REFRESH_CONFIGURATION_LIST);
 }
 
 void MainWindow::ExportClicked(ConfigurationListItem *item) {
@@ -903,7 +1330,7 @@ void MainWindow::ReloadDefaultClicked(ConfigurationListItem *item) {
         Configurator &configurator = Configurator::Get();
         configurator.configurations.ReloadDefaultsConfigurations(configurator.layers.available_layers);
 
-        LoadConfigurationList();
+        ScheduleRefresh(REFRESH_CONFIGURATION_LIST);
     }
 }
 
@@ -922,10 +1349,7 @@ void MainWindow::OnSettingsTreeClicked(QTreeWidgetItem *item, int column) {
     (void)column;
     (void)item;
 
-    Configurator &configurator = Configurator::Get();
-    configurator.configurations.RefreshConfiguration(configurator.layers.available_layers);
-
-    this->UpdateUI();
+    this->ScheduleRefresh(REFRESH_OVERRIDE);
 }
 
 void MainWindow::SetupLauncherTree() {
@@ -1061,7 +1485,7 @@ void MainWindow::OnLauncherLoaderMessageChanged(int level) {
     configurator.environment.SetLoaderMessage(static_cast<LoaderMessageLevel>(level));
     configurator.request_vulkan_status = true;
 
-    this->UpdateUI();
+    this->ScheduleRefresh(REFRESH_UI);
 }
 
 void MainWindow::launchSetExecutable() {
@@ -1160,6 +1584,8 @@ void MainWindow::launchArgsEdited(const QString &arguments) {
 
 // Clear the browser window
 void MainWindow::on_push_button_clear_log_clicked() {
+    _log_pending.clear();
+    _log_omitted_lines = 0;
     ui->log_browser->clear();
     ui->log_browser->update();
     ui->push_button_clear_log->setEnabled(false);
@@ -1276,10 +1702,12 @@ bool MainWindow::eventFilter(QObject *target, QEvent *event) {
                         break;
                 }
                 configuration->setting_tree_state.clear();
+                configuration->MarkDirty();
                 _settings_tree_manager.CreateGUI(ui->settings_tree);
             } else if (action == show_advanced_setting_action) {
                 configuration->view_advanced_settings = action->isChecked();
                 configuration->setting_tree_state.clear();
+                configuration->MarkDirty();
                 _settings_tree_manager.CreateGUI(ui->settings_tree);
             } else if (action == export_html_action) {
                 const std::string path = format("%s/%s.html", GetPath(BUILTIN_PATH_APPDATA).c_str(), layer->key.c_str());
@@ -1412,12 +1840,16 @@ bool MainWindow::SelectConfigurationItem(const std::string &configuration_name)
 }
 
 void MainWindow::ResetLaunchApplication() {
+    _live_stats_timer.stop();
+    _live_stats_reader.Stop();
+    ui->widget_live_stats->setVisible(false);
+
     if (_launch_application) {
         _launch_application->kill();
         _launch_application->waitForFinished();
         _launch_application.reset();
 
-        UpdateUI();
+        ScheduleRefresh(REFRESH_UI);
     }
 }
 
@@ -1429,13 +1861,91 @@ QStringList MainWindow::BuildEnvVariables() const {
     return env;
 }
 
+// The value of the variable in the environment, or empty if it's not set
+static QString FindEnvVariable(const QStringList &environment, const char *variable) {
+    const QString prefix = QString(variable) + "=";
+    for (int i = 0, n = environment.size(); i < n; ++i) {
+        if (environment[i].startsWith(prefix)) return environment[i].mid(prefix.size());
+    }
+    return QString();
+}
+
+bool MainWindow::LaunchApplication(const QStringList &environment) {
+    Configurator &configurator = Configurator::Get();
+    const Application &active_application = configurator.environment.GetActiveApplication();
+
+    // The monitor layer publishes its telemetry for the live statistics, unless the user already set it up
+    QStringList launch_environment = environment;
+    QString telemetry_name = FindEnvVariable(environment, "VK_MONITOR_TELEMETRY");
+    if (telemetry_name.isEmpty()) {
+        const long long pid = static_cast<long long>(QCoreApplication::applicationPid());
+        telemetry_name = format("vkconfig_telemetry_%lld_%d", pid, ++_live_stats_launches).c_str();
+        launch_environment << (QString("VK_MONITOR_TELEMETRY=") + telemetry_name);
+    }
+    if (FindEnvVariable(environment, "VK_MONITOR_MEMORY_BUDGET_FRAMES").isEmpty()) {
+        launch_environment << (QString("VK_MONITOR_MEMORY_BUDGET_FRAMES=") + LIVE_STATS_MEMORY_BUDGET_FRAMES);
+    }
+
+    _launch_application.reset(new QProcess(this));
+    connect(_launch_application.get(), SIGNAL(readyReadStandardOutput()), this, SLOT(standardOutputAvailable()));
+    connect(_launch_application.get(), SIGNAL(readyReadStandardError()), this, SLOT(errorOutputAvailable()));
+    connect(_launch_application.get(), SIGNAL(finished(int, QProcess::ExitStatus)), this,
+            SLOT(processClosed(int, QProcess::ExitStatus)));
+
+    _launch_application->setProgram(active_application.executable_path.c_str());
+    _launch_application->setWorkingDirectory(active_application.working_folder.c_str());
+    _launch_application->setEnvironment(launch_environment);
+
+    if (!active_application.arguments.empty()) {
+        const QStringList args = QString(active_application.arguments.c_str()).split(" ");
+        _launch_application->setArguments(args);
+    }
+
+    _launch_application->start(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    _launch_application->setProcessChannelMode(QProcess::MergedChannels);
+    _launch_application->closeWriteChannel();
+
+    // Wait... did we start? Give it 4 seconds, more than enough time
+    if (!_launch_application->waitForStarted(4000)) {
+        _launch_application->deleteLater();
+        _launch_application = nullptr;
+
+        const std::string failed_log = std::string("Failed to launch ") + active_application.executable_path.c_str() + "!\n";
+        Log(failed_log);
+        return false;
+    }
+
+    const Configuration *configuration = configurator.configurations.GetActiveConfiguration();
+    const std::string api_dump_path = configuration != nullptr ? GetApiDumpStatsPath(*configuration) : "";
+
+    _live_stats_reader.Start(telemetry_name.toStdString(), api_dump_path, LIVE_STATS_INTERVAL_MS);
+    _live_stats_timer.start();
+    ui->widget_live_stats->SetStats(LiveStats());
+    ui->widget_live_stats->setVisible(true);
+
+    return true;
+}
+
+void MainWindow::OnEnvironmentTimeout() {
+    // The layers loading thread reads the environment
+    if (_layers_loading) return;
+
+    Configurator::Get().environment.Save();
+}
+
+void MainWindow::OnLiveStatsTimeout() { ui->widget_live_stats->SetStats(_live_stats_reader.GetStats()); }
+
 void MainWindow::on_push_button_launcher_clicked() {
-    // Are we already monitoring a running app? If so, terminate it
+    // Are we already monitoring a running app? If so, terminate it, which cancels the layer cost estimate too
     if (_launch_application != nullptr) {
+        StopLayerCostEstimate();
         ResetLaunchApplication();
         return;
     }
 
+    // The application must start with the last setting changes
+    _settings_tree_manager.FlushRefresh();
+
     // We are logging, let's add that we've launched a new application
     std::string launch_log = "Launching Vulkan Application:\n";
 
@@ -1488,39 +1998,17 @@ void MainWindow::on_push_button_launcher_clicked() {
         }
     }
 
-    if (ui->check_box_clear_on_launch->isChecked()) ui->log_browser->clear();
+    if (ui->check_box_clear_on_launch->isChecked()) {
+        _log_pending.clear();
+        _log_omitted_lines = 0;
+        ui->log_browser->clear();
+    }
     Log(launch_log.c_str());
 
     // Launch the test application
-    _launch_application.reset(new QProcess(this));
-    connect(_launch_application.get(), SIGNAL(readyReadStandardOutput()), this, SLOT(standardOutputAvailable()));
-    connect(_launch_application.get(), SIGNAL(readyReadStandardError()), this, SLOT(errorOutputAvailable()));
-    connect(_launch_application.get(), SIGNAL(finished(int, QProcess::ExitStatus)), this,
-            SLOT(processClosed(int, QProcess::ExitStatus)));
+    LaunchApplication(BuildEnvVariables());
 
-    _launch_application->setProgram(active_application.executable_path.c_str());
-    _launch_application->setWorkingDirectory(active_application.working_folder.c_str());
-    _launch_application->setEnvironment(BuildEnvVariables());
-
-    if (!active_application.arguments.empty()) {
-        const QStringList args = QString(active_application.arguments.c_str()).split(" ");
-        _launch_application->setArguments(args);
-    }
-
-    _launch_application->start(QIODevice::ReadOnly | QIODevice::Unbuffered);
-    _launch_application->setProcessChannelMode(QProcess::MergedChannels);
-    _launch_application->closeWriteChannel();
-
-    // Wait... did we start? Give it 4 seconds, more than enough time
-    if (!_launch_application->waitForStarted(4000)) {
-        _launch_application->deleteLater();
-        _launch_application = nullptr;
-
-        const std::string failed_log = std::string("Failed to launch ") + active_application.executable_path.c_str() + "!\n";
-        Log(failed_log);
-    }
-
-    UpdateUI();
+    ScheduleRefresh(REFRESH_UI);
 }
 
 /// The process we are following is closed. We don't actually care about the
@@ -1539,12 +2027,17 @@ void MainWindow::processClosed(int exit_code, QProcess::ExitStatus status) {
     disconnect(_launch_application.get(), SIGNAL(readyReadStandardOutput()), this, SLOT(standardOutputAvailable()));
 
     Log("Process terminated");
+    FlushLog();
 
     if (_log_file.isOpen()) {
         _log_file.close();
     }
 
     ResetLaunchApplication();
+
+    if (!_layer_cost_runs.empty()) {
+        FinishLayerCostRun();
+    }
 }
 
 /// This signal get's raised whenever the spawned Vulkan appliction writes
@@ -1565,11 +2058,49 @@ void MainWindow::errorOutputAvailable() {
 }
 
 void MainWindow::Log(const std::string &log) {
-    ui->log_browser->setPlainText(ui->log_browser->toPlainText() + "\n" + log.c_str());
-    ui->push_button_clear_log->setEnabled(true);
+    if (!_log_pending.isEmpty()) _log_pending += "\n";
+    _log_pending += log.c_str();
+    if (!_log_timer.isActive()) _log_timer.start();
+
+    // Only the last lines are displayed, drop the older pending output at a line boundary
+    if (_log_pending.size() > LOG_PENDING_MAX_SIZE) {
+        const int cut = _log_pending.indexOf('\n', _log_pending.size() - LOG_PENDING_MAX_SIZE / 2);
+        const int removed = cut == -1 ? _log_pending.size() - LOG_PENDING_MAX_SIZE / 2 : cut + 1;
+        _log_omitted_lines += _log_pending.leftRef(removed).count('\n');
+        _log_pending.remove(0, removed);
+    }
 
+    // Buffered by QFile, flushed with the log browser update
     if (_log_file.isOpen()) {
         _log_file.write(log.c_str(), log.size());
+    }
+}
+
+void MainWindow::FlushLog() {
+    _log_timer.stop();
+
+    if (!_log_pending.isEmpty()) {
+        // Skip the lines the log browser would discard right away
+        int lines = _log_pending.count('\n') + 1;
+        int start = 0;
+        for (; lines > LOG_MAX_BLOCK_COUNT; --lines) {
+            start = _log_pending.indexOf('\n', start) + 1;
+            ++_log_omitted_lines;
+        }
+
+        if (_log_omitted_lines > 0) {
+            const std::string omitted = _log_file.isOpen() ? format("[%d lines only written to the log file]", _log_omitted_lines)
+                                                           : format("[%d lines omitted]", _log_omitted_lines);
+            ui->log_browser->appendPlainText(omitted.c_str());
+            _log_omitted_lines = 0;
+        }
+
+        ui->log_browser->appendPlainText(_log_pending.mid(start));
+        ui->push_button_clear_log->setEnabled(true);
+        _log_pending.clear();
+    }
+
+    if (_log_file.isOpen()) {
         _log_file.flush();
     }
 }
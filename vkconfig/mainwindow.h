@@ -24,6 +24,10 @@
 #include "configurator.h"
 #include "settings_tree.h"
 
+#include "../vkconfig_core/registry.h"
+#include "../vkconfig_core/layer_cost.h"
+#include "../vkconfig_core/live_stats.h"
+
 #include "ui_mainwindow.h"
 
 #include <QDialog>
@@ -34,9 +38,13 @@
 #include <QShowEvent>
 #include <QResizeEvent>
 #include <QProcess>
+#include <QFileSystemWatcher>
+#include <QTimer>
 
+#include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
 
 /// This just allows me to associate a specific profile definition
 /// with a list widget item.
@@ -53,6 +61,15 @@ class ConfigurationListItem : public QTreeWidgetItem {
 
 enum Tool { TOOL_VULKAN_INFO, TOOL_VULKAN_INSTALL };
 
+enum RefreshFlag {
+    REFRESH_UI = (1 << 0),
+    REFRESH_OVERRIDE = (1 << 1),            // Write the override files of the active configuration
+    REFRESH_CONFIGURATION_LIST = (1 << 2),  // Rebuild the list of configurations
+    REFRESH_SETTINGS_TREE = (1 << 3)        // Rebuild the settings tree of the selected configuration
+};
+
+typedef int RefreshFlags;
+
 class MainWindow : public QMainWindow {
     Q_OBJECT
 
@@ -63,14 +80,70 @@ class MainWindow : public QMainWindow {
     void UpdateUI();
     void UpdateConfiguration();
 
+    // The refreshes requested during an event loop iteration are coalesced into a single pass ending with UpdateUI
+    void ScheduleRefresh(RefreshFlags refresh_flags);
+
    private:
     SettingsTreeManager _settings_tree_manager;
 
     std::unique_ptr<QProcess> _launch_application;  // Keeps track of the monitored app
     QFile _log_file;                                // Log file for layer output
 
+    // The output of the launched application is appended to the log browser at most every 50ms, a chatty application would
+    // otherwise keep the GUI busy laying out the log
+    QString _log_pending;
+    int _log_omitted_lines;  // Lines of the output that were only written to the log file
+    QTimer _log_timer;
+
+    RefreshFlags _refresh_flags;
+    QTimer _refresh_timer;
+
+    // The environment changes are saved by this timer rather than by each GUI action
+    QTimer _environment_timer;
+
+    // The Vulkan system is probed on this thread for the Vulkan status, the layers override is surrendered meanwhile
+    std::thread _vulkan_system_thread;
+    VulkanSystemInfo _vulkan_system_probe;
+    bool _vulkan_system_surrendered;
+
+    void StartVulkanSystemProbe();
+
+    // The layers are loaded on this thread at startup, the window only shows the last active configuration meanwhile
+    std::thread _layers_thread;
+    bool _layers_loading;
+
+    void StartLayersLoading();
+
+    // Runs the application of the launcher once per step of the layer cost estimate, with the monitor layer logging the frames
+    std::vector<LayerCostRun> _layer_cost_runs;
+    std::size_t _layer_cost_index;
+    int _layer_cost_duration_ms;
+    bool _layer_cost_terminated;
+    QTimer _layer_cost_timer;
+    std::chrono::steady_clock::time_point _layer_cost_launch_time;
+
+    void StartLayerCostRun();
+    void FinishLayerCostRun();
+    void StopLayerCostEstimate();
+
+    // The statistics of the launched application are read from the monitor layer telemetry and the api_dump statistics on the
+    // thread of the reader, and only copied to the live statistics panel by the timer
+    LiveStatsReader _live_stats_reader;
+    QTimer _live_stats_timer;
+    int _live_stats_launches;
+
     void LoadConfigurationList();
     void SetupLauncherTree();
+    void UpdateLayerPathsWatcher();
+
+    // Watches the layer search folders to reload the layers when some are installed, modified or removed
+    QFileSystemWatcher _layer_paths_watcher;
+    QTimer _layer_paths_timer;
+#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
+    // Watches the registry keys the layers are searched in, including the display drivers keys
+    std::unique_ptr<RegistryWatcher> _layer_registry_watcher;
+    bool _layer_registry_changed;
+#endif
 
     void closeEvent(QCloseEvent *event) override;
     void showEvent(QShowEvent *event) override;
@@ -108,6 +181,7 @@ class MainWindow : public QMainWindow {
     void toolsVulkanInfo(bool checked);
     void toolsVulkanInstallation(bool checked);
     void toolsResetToDefault(bool checked);
+    void toolsEstimateLayerCosts(bool checked);
 
     void OnHelpFindLayers(bool checked);
     void OnHelpAbout(bool checked);
@@ -150,6 +224,14 @@ class MainWindow : public QMainWindow {
     void OnConfigurationTreeClicked(QTreeWidgetItem *item, int column);
     void OnSettingsTreeClicked(QTreeWidgetItem *item, int column);
     void OnLauncherLoaderMessageChanged(int level);
+    void OnLayerPathsChanged();
+    void OnRefresh();
+    void OnVulkanSystemProbed();
+    void OnLayersLoaded();
+    void OnLayerCostTimeout();
+    void OnLiveStatsTimeout();
+    void OnEnvironmentTimeout();
+    void FlushLog();
 
     void standardOutputAvailable();                                 // stdout output is available
     void errorOutputAvailable();                                    // Layeroutput is available
@@ -162,6 +244,7 @@ class MainWindow : public QMainWindow {
     void RemoveConfiguration(const std::string &configuration_name);
     bool SelectConfigurationItem(const std::string &configuration_name);
     void ResetLaunchApplication();
+    bool LaunchApplication(const QStringList &environment);
     void StartTool(Tool tool);
     QStringList BuildEnvVariables() const;
 
@@ -37,6 +37,7 @@
 #include "../vkconfig_core/alert.h"
 #include "../vkconfig_core/version.h"
 #include "../vkconfig_core/platform.h"
+#include "../vkconfig_core/profiler.h"
 #include "../vkconfig_core/util.h"
 
 #include <QLineEdit>
@@ -50,9 +51,15 @@
 static const char *TOOLTIP_ORDER =
     "Layers are executed between the Vulkan application and driver in the specific order represented here";
 
-SettingsTreeManager::SettingsTreeManager() : tree(nullptr) {}
+SettingsTreeManager::SettingsTreeManager() : tree(nullptr) {
+    this->refresh_timer.setSingleShot(true);
+    this->refresh_timer.setInterval(250);
+    this->connect(&this->refresh_timer, SIGNAL(timeout()), this, SLOT(OnRefreshConfiguration()));
+}
 
 void SettingsTreeManager::CreateGUI(QTreeWidget *build_tree) {
+    ScopedTimer timer("SettingsTreeManager::CreateGUI");
+
     assert(build_tree);
 
     // Do this first to make absolutely sure if these is an old configuration still active it's state gets saved.
@@ -122,6 +129,9 @@ void SettingsTreeManager::CreateGUI(QTreeWidget *build_tree) {
 
             if (layer == nullptr) continue;
 
+            // The widgets modify the settings, which may still be shared with a duplicated configuration
+            parameter.DetachSettings(available_layers);
+
             // Handle the case were we get off easy. No settings.
             if (parameter.settings.empty()) {
                 QTreeWidgetItem *layer_child_item = new QTreeWidgetItem();
@@ -135,8 +145,11 @@ void SettingsTreeManager::CreateGUI(QTreeWidget *build_tree) {
                 layer_item->addChild(presets_item);
                 WidgetPreset *presets_combobox = new WidgetPreset(this->tree, presets_item, *layer, parameter);
                 this->connect(presets_combobox, SIGNAL(itemChanged()), this, SLOT(OnPresetChanged()));
+                this->preset_widgets.push_back(presets_combobox);
             }
 
+            this->layers.push_back(layer);
+
             if (UseBuiltinValidationSettings(parameter)) {
                 BuildValidationTree(layer_item, parameter);
             } else {
@@ -194,6 +207,7 @@ void SettingsTreeManager::CreateGUI(QTreeWidget *build_tree) {
 
     this->connect(this->tree, SIGNAL(expanded(const QModelIndex)), this, SLOT(OnExpandedChanged(const QModelIndex)));
     this->connect(this->tree, SIGNAL(collapsed(const QModelIndex)), this, SLOT(OnCollapsedChanged(const QModelIndex)));
+    this->connect(this->tree, SIGNAL(itemExpanded(QTreeWidgetItem *)), this, SLOT(OnItemExpanded(QTreeWidgetItem *)));
 
     this->tree->resizeColumnToContents(0);
 
@@ -201,6 +215,8 @@ void SettingsTreeManager::CreateGUI(QTreeWidget *build_tree) {
         this->SetTreeState(configuration->setting_tree_state, 0, this->tree->invisibleRootItem());
     }
 
+    this->CreateVisibleWidgets(this->tree->invisibleRootItem());
+
     this->tree->blockSignals(false);
 }
 
@@ -208,6 +224,9 @@ void SettingsTreeManager::CleanupGUI() {
     if (this->tree == nullptr)  // Was not initialized
         return;
 
+    // Don't lose the last setting changes
+    this->FlushRefresh();
+
     Configurator &configurator = Configurator::Get();
 
     Configuration *configuration = configurator.configurations.GetActiveConfiguration();
@@ -215,8 +234,16 @@ void SettingsTreeManager::CleanupGUI() {
 
     configuration->setting_tree_state.clear();
     GetTreeState(configuration->setting_tree_state, this->tree->invisibleRootItem());
+    configuration->MarkDirty();
 
     this->validation.reset();
+    this->pending_widgets.clear();
+    this->setting_widgets.clear();
+    this->preset_widgets.clear();
+    this->layers.clear();
+    this->setting_items.clear();
+
+    this->disconnect(this->tree, SIGNAL(itemExpanded(QTreeWidgetItem *)), this, SLOT(OnItemExpanded(QTreeWidgetItem *)));
 
     this->tree->clear();
     this->tree = nullptr;
@@ -233,6 +260,7 @@ void SettingsTreeManager::OnExpandedChanged(const QModelIndex &index) {
     Configuration *configuration = configurator.configurations.GetActiveConfiguration();
     configuration->setting_tree_state.clear();
     GetTreeState(configuration->setting_tree_state, this->tree->invisibleRootItem());
+    configuration->MarkDirty();
 
     return;
 }
@@ -248,6 +276,7 @@ void SettingsTreeManager::OnCollapsedChanged(const QModelIndex &index) {
     Configuration *configuration = configurator.configurations.GetActiveConfiguration();
     configuration->setting_tree_state.clear();
     GetTreeState(configuration->setting_tree_state, this->tree->invisibleRootItem());
+    configuration->MarkDirty();
 
     return;
 }
@@ -293,6 +322,49 @@ static bool IsBuiltinValidationSetting(const Parameter &parameter, const std::st
     return IsStringFound(keys, key);
 }
 
+// The widgets that add child items remain created with their item, so that the items match the saved tree state
+template <typename WIDGET, typename META>
+void SettingsTreeManager::DeferWidget(QTreeWidgetItem *item, const META &meta, Parameter &parameter) {
+    item->setExpanded(meta.expanded);
+
+    this->pending_widgets[item] = [this, item, &meta, &parameter]() {
+        WIDGET *widget = new WIDGET(this->tree, item, meta, parameter.settings);
+        this->ConnectSetting(widget, item, meta.key);
+    };
+}
+
+void SettingsTreeManager::CreateVisibleWidgets(QTreeWidgetItem *parent) {
+    for (int i = 0, n = parent->childCount(); i < n; ++i) {
+        QTreeWidgetItem *child = parent->child(i);
+
+        std::map<QTreeWidgetItem *, std::function<void()> >::iterator pending = this->pending_widgets.find(child);
+        if (pending != this->pending_widgets.end()) {
+            const std::function<void()> create_widget = pending->second;
+            this->pending_widgets.erase(pending);
+
+            const bool expanded = child->isExpanded();  // The widgets reset the expanded state of their item
+            create_widget();
+            if (child->isExpanded() != expanded) child->setExpanded(expanded);
+        }
+
+        if (child->isExpanded()) this->CreateVisibleWidgets(child);
+    }
+}
+
+void SettingsTreeManager::ConnectSetting(QObject *widget, QTreeWidgetItem *item, const std::string &key) {
+    SettingWidget &setting_widget = this->setting_widgets[widget];
+    setting_widget.item = item;
+    setting_widget.key = key;
+    this->connect(widget, SIGNAL(itemChanged()), this, SLOT(OnSettingChanged()));
+}
+
+void SettingsTreeManager::OnItemExpanded(QTreeWidgetItem *item) {
+    if (this->tree == nullptr)  // Was not initialized
+        return;
+
+    this->CreateVisibleWidgets(item);
+}
+
 void SettingsTreeManager::BuildTreeItem(QTreeWidgetItem *parent, Parameter &parameter, const SettingMeta &meta_object) {
     if (IsBuiltinValidationSetting(parameter, meta_object.key)) return;
     if (!IsPlatformSupported(meta_object.platform_flags)) return;
@@ -305,6 +377,8 @@ void SettingsTreeManager::BuildTreeItem(QTreeWidgetItem *parent, Parameter &para
     item->setSizeHint(0, QSize(0, ITEM_HEIGHT));
     parent->addChild(item);
 
+    this->setting_items[&meta_object].push_back(item);
+
     switch (meta_object.type) {
         case SETTING_GROUP: {
             item->setText(0, meta_object.label.c_str());
@@ -316,29 +390,25 @@ void SettingsTreeManager::BuildTreeItem(QTreeWidgetItem *parent, Parameter &para
         case SETTING_BOOL_NUMERIC_DEPRECATED: {
             const SettingMetaBool &meta = static_cast<const SettingMetaBool &>(meta_object);
 
-            WidgetSettingBool *widget = new WidgetSettingBool(tree, item, meta, parameter.settings);
-            this->connect(widget, SIGNAL(itemChanged()), this, SLOT(OnSettingChanged()));
+            this->DeferWidget<WidgetSettingBool>(item, meta, parameter);
         } break;
 
         case SETTING_INT: {
             const SettingMetaInt &meta = static_cast<const SettingMetaInt &>(meta_object);
 
-            WidgetSettingInt *widget = new WidgetSettingInt(tree, item, meta, parameter.settings);
-            this->connect(widget, SIGNAL(itemChanged()), this, SLOT(OnSettingChanged()));
+            this->DeferWidget<WidgetSettingInt>(item, meta, parameter);
         } break;
 
         case SETTING_FLOAT: {
             const SettingMetaFloat &meta = static_cast<const SettingMetaFloat &>(meta_object);
 
-            WidgetSettingFloat *widget = new WidgetSettingFloat(tree, item, meta, parameter.settings);
-            this->connect(widget, SIGNAL(itemChanged()), this, SLOT(OnSettingChanged()));
+            this->DeferWidget<WidgetSettingFloat>(item, meta, parameter);
         } break;
 
         case SETTING_FRAMES: {
             const SettingMetaFrames &meta = static_cast<const SettingMetaFrames &>(meta_object);
 
-            WidgetSettingFrames *widget = new WidgetSettingFrames(tree, item, meta, parameter.settings);
-            this->connect(widget, SIGNAL(itemChanged()), this, SLOT(OnSettingChanged()));
+            this->DeferWidget<WidgetSettingFrames>(item, meta, parameter);
         } break;
 
         case SETTING_SAVE_FILE:
@@ -347,14 +417,19 @@ void SettingsTreeManager::BuildTreeItem(QTreeWidgetItem *parent, Parameter &para
             const SettingMetaFilesystem &meta = static_cast<const SettingMetaFilesystem &>(meta_object);
 
             WidgetSettingFilesystem *widget = new WidgetSettingFilesystem(tree, item, meta, parameter.settings);
-            this->connect(widget, SIGNAL(itemChanged()), this, SLOT(OnSettingChanged()));
+
+            // Loading a profile file also selects one of its profiles
+            if (meta.type == SETTING_LOAD_FILE && meta.format == "PROFILE") {
+                this->connect(widget, SIGNAL(itemChanged()), this, SLOT(OnSettingChanged()));
+            } else {
+                this->ConnectSetting(widget, item, meta.key);
+            }
         } break;
 
         case SETTING_ENUM: {
             const SettingMetaEnum &meta = static_cast<const SettingMetaEnum &>(meta_object);
 
-            WidgetSettingEnum *enum_widget = new WidgetSettingEnum(tree, item, meta, parameter.settings);
-            this->connect(enum_widget, SIGNAL(itemChanged()), this, SLOT(OnSettingChanged()));
+            this->DeferWidget<WidgetSettingEnum>(item, meta, parameter);
 
             SettingDataEnum *data = FindSetting<SettingDataEnum>(parameter.settings, meta.key.c_str());
 
@@ -385,9 +460,14 @@ void SettingsTreeManager::BuildTreeItem(QTreeWidgetItem *parent, Parameter &para
 
                 QTreeWidgetItem *child = new QTreeWidgetItem();
                 item->addChild(child);
+                child->setExpanded(value.expanded);
+                this->setting_items[&meta_object].push_back(child);
 
-                WidgetSettingFlag *widget = new WidgetSettingFlag(tree, child, meta, parameter.settings, value.key.c_str());
-                this->connect(widget, SIGNAL(itemChanged()), this, SLOT(OnSettingChanged()));
+                const std::string flag = value.key;
+                this->pending_widgets[child] = [this, child, &meta, &parameter, flag]() {
+                    WidgetSettingFlag *widget = new WidgetSettingFlag(this->tree, child, meta, parameter.settings, flag.c_str());
+                    this->ConnectSetting(widget, child, meta.key);
+                };
 
                 for (std::size_t j = 0, o = value.settings.size(); j < o; ++j) {
                     this->BuildTreeItem(child, parameter, *value.settings[j]);
@@ -398,15 +478,14 @@ void SettingsTreeManager::BuildTreeItem(QTreeWidgetItem *parent, Parameter &para
         case SETTING_STRING: {
             const SettingMetaString &meta = static_cast<const SettingMetaString &>(meta_object);
 
-            WidgetSettingString *widget = new WidgetSettingString(tree, item, meta, parameter.settings);
-            this->connect(widget, SIGNAL(itemChanged()), this, SLOT(OnSettingChanged()));
+            this->DeferWidget<WidgetSettingString>(item, meta, parameter);
         } break;
 
         case SETTING_LIST: {
             const SettingMetaList &meta = static_cast<const SettingMetaList &>(meta_object);
 
             WidgetSettingList *widget = new WidgetSettingList(tree, item, meta, parameter.settings);
-            this->connect(widget, SIGNAL(itemChanged()), this, SLOT(OnSettingChanged()));
+            this->ConnectSetting(widget, item, meta.key);
         } break;
 
         default: {
@@ -457,7 +536,49 @@ int SettingsTreeManager::SetTreeState(QByteArray &byte_array, int index, QTreeWi
 
 void SettingsTreeManager::OnPresetChanged() { this->Refresh(REFRESH_ENABLE_AND_STATE); }
 
-void SettingsTreeManager::OnSettingChanged() { this->Refresh(REFRESH_ENABLE_ONLY); }
+void SettingsTreeManager::OnSettingChanged() {
+    std::map<QObject *, SettingWidget>::const_iterator setting_widget = this->setting_widgets.find(this->sender());
+
+    // The validation widget and the profile file widget change several settings at once
+    if (setting_widget == this->setting_widgets.end()) {
+        for (std::size_t i = 0, n = this->preset_widgets.size(); i < n; ++i) {
+            this->preset_widgets[i]->UpdateSettings();
+        }
+
+        this->Refresh(REFRESH_ENABLE_ONLY);
+        return;
+    }
+
+    const std::string &key = setting_widget->second.key;
+
+    this->tree->blockSignals(true);
+
+    for (std::size_t i = 0, n = this->preset_widgets.size(); i < n; ++i) {
+        this->preset_widgets[i]->UpdateSetting(key);
+        this->preset_widgets[i]->Refresh(REFRESH_ENABLE_ONLY);
+    }
+
+    this->RefreshItem(REFRESH_ENABLE_ONLY, setting_widget->second.item);
+
+    // Only the settings with a dependence on the changed setting may change of state
+    for (std::size_t i = 0, n = this->layers.size(); i < n; ++i) {
+        const std::vector<const SettingMeta *> &dependents = this->layers[i]->dependents.Find(key);
+
+        for (std::size_t j = 0, o = dependents.size(); j < o; ++j) {
+            std::map<const SettingMeta *, std::vector<QTreeWidgetItem *> >::const_iterator items =
+                this->setting_items.find(dependents[j]);
+            if (items == this->setting_items.end()) continue;
+
+            for (std::size_t k = 0, p = items->second.size(); k < p; ++k) {
+                this->RefreshItem(REFRESH_ENABLE_ONLY, items->second[k]);
+            }
+        }
+    }
+
+    this->tree->blockSignals(false);
+
+    this->ScheduleRefreshConfiguration();
+}
 
 void SettingsTreeManager::Refresh(RefreshAreas refresh_areas) {
     this->tree->blockSignals(true);
@@ -469,6 +590,14 @@ void SettingsTreeManager::Refresh(RefreshAreas refresh_areas) {
 
     this->tree->blockSignals(false);
 
+    this->ScheduleRefreshConfiguration();
+}
+
+void SettingsTreeManager::ScheduleRefreshConfiguration() {
+    // The widgets change the settings of the active configuration before notifying of the change
+    Configuration *configuration = Configurator::Get().configurations.GetActiveConfiguration();
+    if (configuration != nullptr) configuration->MarkDirty();
+
     QSettings settings;
     if (!settings.value("vkconfig_restart", false).toBool()) {
         settings.setValue("vkconfig_restart", true);
@@ -476,7 +605,18 @@ void SettingsTreeManager::Refresh(RefreshAreas refresh_areas) {
         Alert::ConfiguratorRestart();
     }
 
-    // Refresh layer configuration
+    // Refresh layer configuration, once the setting changes settle
+    this->refresh_timer.start();
+}
+
+void SettingsTreeManager::FlushRefresh() {
+    if (!this->refresh_timer.isActive()) return;
+
+    this->refresh_timer.stop();
+    this->OnRefreshConfiguration();
+}
+
+void SettingsTreeManager::OnRefreshConfiguration() {
     Configurator &configurator = Configurator::Get();
     configurator.configurations.RefreshConfiguration(configurator.layers.available_layers);
 }
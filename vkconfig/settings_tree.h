@@ -29,10 +29,14 @@
 #include "../vkconfig_core/configuration.h"
 
 #include <QObject>
+#include <QTimer>
 #include <QTreeWidget>
 
+#include <string>
 #include <vector>
 #include <memory>
+#include <map>
+#include <functional>
 
 class SettingsTreeManager : QObject {
     Q_OBJECT
@@ -47,11 +51,16 @@ class SettingsTreeManager : QObject {
 
     void Refresh(RefreshAreas refresh_areas);
 
+    // Writes the layers configuration files now when setting changes are still pending
+    void FlushRefresh();
+
    public Q_SLOTS:
     void OnSettingChanged();
     void OnPresetChanged();
     void OnExpandedChanged(const QModelIndex &index);
     void OnCollapsedChanged(const QModelIndex &index);
+    void OnRefreshConfiguration();
+    void OnItemExpanded(QTreeWidgetItem *item);
 
    private:
     SettingsTreeManager(const SettingsTreeManager &) = delete;
@@ -63,6 +72,29 @@ class SettingsTreeManager : QObject {
 
     void RefreshItem(RefreshAreas refresh_areas, QTreeWidgetItem *parent);
 
+    template <typename WIDGET, typename META>
+    void DeferWidget(QTreeWidgetItem *item, const META &meta, Parameter &parameter);
+    void CreateVisibleWidgets(QTreeWidgetItem *parent);
+    void ConnectSetting(QObject *widget, QTreeWidgetItem *item, const std::string &key);
+    void ScheduleRefreshConfiguration();
+
     QTreeWidget *tree;
     std::unique_ptr<WidgetSettingValidation> validation;
+
+    // The widgets of the items hidden by a collapsed parent are only created when the parent is expanded
+    std::map<QTreeWidgetItem *, std::function<void()> > pending_widgets;
+
+    struct SettingWidget {
+        QTreeWidgetItem *item;
+        std::string key;
+    };
+
+    // The setting key each widget changes, so that only the presets and the dependents of that key are refreshed
+    std::map<QObject *, SettingWidget> setting_widgets;
+    std::vector<WidgetPreset *> preset_widgets;
+    std::vector<const Layer *> layers;
+    std::map<const SettingMeta *, std::vector<QTreeWidgetItem *> > setting_items;
+
+    // Bursts of setting changes, such as a slider drag, result in a single refresh of the layers configuration files
+    QTimer refresh_timer;
 };
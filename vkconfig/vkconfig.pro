@@ -42,15 +42,19 @@ SOURCES += \
     ../vkconfig_core/json.cpp \
     ../vkconfig_core/json_validator.cpp \
     ../vkconfig_core/layer.cpp \
+    ../vkconfig_core/layer_cost.cpp \
     ../vkconfig_core/layer_manager.cpp \
+    ../vkconfig_core/layer_manifest_cache.cpp \
     ../vkconfig_core/layer_preset.cpp \
     ../vkconfig_core/layer_state.cpp \
     ../vkconfig_core/layer_type.cpp \
+    ../vkconfig_core/live_stats.cpp \
     ../vkconfig_core/override.cpp \
     ../vkconfig_core/parameter.cpp \
     ../vkconfig_core/path.cpp \
     ../vkconfig_core/path_manager.cpp \
     ../vkconfig_core/platform.cpp \
+    ../vkconfig_core/profiler.cpp \
     ../vkconfig_core/registry.cpp \
     ../vkconfig_core/setting.cpp \
     ../vkconfig_core/setting_bool.cpp \
@@ -64,7 +68,9 @@ SOURCES += \
     ../vkconfig_core/setting_string.cpp \
     ../vkconfig_core/util.cpp \
     ../vkconfig_core/version.cpp \
+    ../vkconfig_core/vuid_database.cpp \
     vulkan_util.cpp \
+    widget_live_stats.cpp \
     widget_preset.cpp \
     widget_setting.cpp \
     widget_setting_bool.cpp \
@@ -109,15 +115,19 @@ HEADERS += \
     ../vkconfig_core/json.h \
     ../vkconfig_core/json_validator.h \
     ../vkconfig_core/layer.h \
+    ../vkconfig_core/layer_cost.h \
     ../vkconfig_core/layer_manager.h \
+    ../vkconfig_core/layer_manifest_cache.h \
     ../vkconfig_core/layer_preset.h \
     ../vkconfig_core/layer_state.h \
     ../vkconfig_core/layer_type.h \
+    ../vkconfig_core/live_stats.h \
     ../vkconfig_core/override.h \
     ../vkconfig_core/parameter.h \
     ../vkconfig_core/path.h \
     ../vkconfig_core/path_manager.h \
     ../vkconfig_core/platform.h \
+    ../vkconfig_core/profiler.h \
     ../vkconfig_core/registry.h \
     ../vkconfig_core/setting.h \
     ../vkconfig_core/setting_bool.h \
@@ -131,7 +141,9 @@ HEADERS += \
     ../vkconfig_core/setting_string.h \
     ../vkconfig_core/util.h \
     ../vkconfig_core/version.h \
+    ../vkconfig_core/vuid_database.h \
     vulkan_util.h \
+    widget_live_stats.h \
     widget_preset.h \
     widget_setting.h \
     widget_setting_bool.h \
@@ -178,6 +190,10 @@ win32: {
   RC_ICONS = resourcefiles/vulkan.ico
 }
 
+unix:!macx: {
+  LIBS += -lrt
+}
+
 macx: {
 #CONFIG += file_copies
 #COPIES += shellScript
@@ -25,6 +25,7 @@
 #include "../vkconfig_core/util.h"
 #include "../vkconfig_core/platform.h"
 #include "../vkconfig_core/override.h"
+#include "../vkconfig_core/profiler.h"
 
 #include <vulkan/vulkan.h>
 
@@ -93,6 +94,8 @@ static std::string GetUserDefinedLayersPathsLog(const char *label, UserDefinedLa
 }
 
 VkResult CreateInstance(QLibrary &library, VkInstance &instance, bool enumerate_portability) {
+    ScopedTimer timer("CreateInstance");
+
     if (!enumerate_portability) return VK_ERROR_INCOMPATIBLE_DRIVER;
 
     PFN_vkEnumerateInstanceExtensionProperties vkEnumerateInstanceExtensionProperties =
@@ -152,68 +155,65 @@ VkResult CreateInstance(QLibrary &library, VkInstance &instance, bool enumerate_
     return vkCreateInstance(&inst_info, nullptr, &instance);
 }
 
-std::string GenerateVulkanStatus() {
-    std::string log;
+// The loader version followed by the version of the driver of each physical device, changing when the Vulkan system does
+std::string GetVulkanDriversSignature() {
+    const Version loader_version = GetVulkanLoaderVersion();
+    if (loader_version == Version::VERSION_NULL) return "";
 
-    const Configurator &configurator = Configurator::Get();
+    std::string signature = loader_version.str();
 
-    // Layers override configuration
-    if (configurator.configurations.HasActiveConfiguration(configurator.layers.available_layers)) {
-        log +=
-            format("- Layers override: \"%s\" configuration\n", configurator.configurations.GetActiveConfiguration()->key.c_str());
-    } else {
-        log += "- Layers override: None\n";
+    QLibrary library(GetVulkanLibrary());
+
+    VkInstance instance = VK_NULL_HANDLE;
+    VkResult err = CreateInstance(library, instance, false);
+    if (err == VK_ERROR_INCOMPATIBLE_DRIVER) {
+        err = CreateInstance(library, instance, true);
     }
+    if (err != VK_SUCCESS) return signature;
 
-    // Check Vulkan SDK path
-    const std::string search_path(configurator.path.GetPath(PATH_VULKAN_SDK));
-    if (!search_path.empty())
-        log += format("- VULKAN_SDK environment variable: %s\n", search_path.c_str());
-    else
-        log += "- VULKAN_SDK environment variable not set\n";
+    PFN_vkEnumeratePhysicalDevices vkEnumeratePhysicalDevices =
+        (PFN_vkEnumeratePhysicalDevices)library.resolve("vkEnumeratePhysicalDevices");
+    assert(vkEnumeratePhysicalDevices);
 
-    const Version loader_version = GetVulkanLoaderVersion();
+    PFN_vkGetPhysicalDeviceProperties pfnGetPhysicalDeviceProperties =
+        (PFN_vkGetPhysicalDeviceProperties)library.resolve("vkGetPhysicalDeviceProperties");
+    assert(pfnGetPhysicalDeviceProperties);
 
-    if (loader_version == Version::VERSION_NULL) {
-        Alert::LoaderFailure();
+    PFN_vkDestroyInstance vkDestroyInstance = (PFN_vkDestroyInstance)library.resolve("vkDestroyInstance");
+    assert(vkDestroyInstance);
 
-        log += "- Could not find a Vulkan Loader.\n";
-        return log;
-    } else {
-        log += format("- Vulkan Loader version: %s\n", loader_version.str().c_str());
-        const LoaderMessageLevel loader_debug_message = configurator.environment.GetLoaderMessage();
-        if (loader_debug_message != LOADER_MESSAGE_NONE) {
-            log += format("    - VK_LOADER_DEBUG=%s\n", GetLoaderDebugToken(loader_debug_message).c_str());
-        }
+    uint32_t gpu_count = 0;
+    err = vkEnumeratePhysicalDevices(instance, &gpu_count, NULL);
+
+    std::vector<VkPhysicalDevice> devices(gpu_count);
+    if (err == VK_SUCCESS && gpu_count > 0) {
+        err = vkEnumeratePhysicalDevices(instance, &gpu_count, &devices[0]);
     }
 
-    log += "- User-Defined Layers locations:\n";
-    log += GetUserDefinedLayersPathsLog("VK_LAYER_PATH variable", USER_DEFINED_LAYERS_PATHS_ENV_SET);
-    log += GetUserDefinedLayersPathsLog("Per-configuration paths", USER_DEFINED_LAYERS_PATHS_GUI);
-    log += GetUserDefinedLayersPathsLog("VK_ADD_LAYER_PATH variable", USER_DEFINED_LAYERS_PATHS_ENV_ADD);
+    if (err == VK_SUCCESS) {
+        for (std::size_t i = 0, n = devices.size(); i < n; ++i) {
+            VkPhysicalDeviceProperties properties;
+            pfnGetPhysicalDeviceProperties(devices[i], &properties);
 
-    const std::string layer_settings_path(qgetenv("VK_LAYER_SETTINGS_PATH"));
-    if (!layer_settings_path.empty()) {
-        log += "- `vk_layer_settings.txt` location overridden by VK_LAYER_SETTINGS_PATH:\n";
-        if (layer_settings_path.find("vk_layer_settings.txt") == std::string::npos) {
-            log += format("    %s\n", layer_settings_path.c_str());
-        } else {
-            log += format("    %s\n", ExtractAbsoluteDir(layer_settings_path).c_str());
+            signature += format(";%s %04X:%04X %08X", properties.deviceName, properties.vendorID, properties.deviceID,
+                                properties.driverVersion);
         }
-    } else {
-        const std::string path = GetPath(BUILTIN_PATH_OVERRIDE_SETTINGS);
-        log += "- `vk_layer_settings.txt` uses the default platform path:\n";
-        log += format("    %s\n", ExtractAbsoluteDir(path).c_str());
     }
 
-    // If there is no Vulkan loader installed, we can't call any Vulkan API.
-    if (loader_version == Version::VERSION_NULL) {
-        return log;
-    }
+    vkDestroyInstance(instance, NULL);
 
-    Configuration *active_configuration = configurator.configurations.GetActiveConfiguration();
-    if (configurator.configurations.HasActiveConfiguration(configurator.layers.available_layers)) {
-        SurrenderConfiguration(configurator.environment);
+    return signature;
+}
+
+VulkanSystemInfo ProbeVulkanSystem() {
+    ScopedTimer timer("ProbeVulkanSystem");
+
+    VulkanSystemInfo vulkan_system;
+
+    vulkan_system.loader_version = GetVulkanLoaderVersion();
+    if (vulkan_system.loader_version == Version::VERSION_NULL) {
+        vulkan_system.error = VULKAN_SYSTEM_LOADER_FAILURE;
+        return vulkan_system;
     }
 
     QLibrary library(GetVulkanLibrary());
@@ -231,22 +231,8 @@ std::string GenerateVulkanStatus() {
     err = vkEnumerateInstanceLayerProperties(&instance_layer_count, &layers_properties[0]);
     assert(!err);
 
-    log += "- Available Layers:\n";
     for (std::size_t i = 0, n = layers_properties.size(); i < n; ++i) {
-        const Layer *layer = FindByKey(configurator.layers.available_layers, layers_properties[i].layerName);
-
-        std::string status;
-        if (layer != nullptr) {
-            if (layer->status != STATUS_STABLE) {
-                status = GetToken(layer->status);
-            }
-        }
-
-        if (status.empty()) {
-            log += format("    - %s\n", layers_properties[i].layerName);
-        } else {
-            log += format("    - %s (%s)\n", layers_properties[i].layerName, status.c_str());
-        }
+        vulkan_system.layers.push_back(layers_properties[i].layerName);
     }
 
     VkInstance inst = VK_NULL_HANDLE;
@@ -255,10 +241,8 @@ std::string GenerateVulkanStatus() {
         // If no compatible driver were found, trying with portability enumeration
         err = CreateInstance(library, inst, true);
         if (err == VK_ERROR_INCOMPATIBLE_DRIVER) {
-            Alert::InstanceFailure();
-
-            log += "- Cannot find a compatible Vulkan installable client driver (ICD).\n";
-            return log;
+            vulkan_system.error = VULKAN_SYSTEM_INSTANCE_FAILURE;
+            return vulkan_system;
         }
     }
     assert(err == VK_SUCCESS);
@@ -300,11 +284,10 @@ std::string GenerateVulkanStatus() {
 
     // This can fail on a new Linux setup. Check and fail gracefully rather than crash.
     if (err != VK_SUCCESS) {
-        Alert::PhysicalDeviceFailure();
         vkDestroyInstance(inst, NULL);
 
-        log += "- Cannot find a compatible Vulkan installable client driver (ICD).\n";
-        return log;
+        vulkan_system.error = VULKAN_SYSTEM_PHYSICAL_DEVICE_FAILURE;
+        return vulkan_system;
     }
 
     std::vector<VkPhysicalDevice> devices;
@@ -317,18 +300,13 @@ std::string GenerateVulkanStatus() {
         (PFN_vkGetPhysicalDeviceProperties)library.resolve("vkGetPhysicalDeviceProperties");
     assert(pfnGetPhysicalDeviceProperties);
 
-    Configurator &configurator_edit = Configurator::Get();
-    configurator_edit.device_names.clear();
-
-    log += "- Physical Devices:\n";
     for (std::size_t i = 0, n = devices.size(); i < n; ++i) {
         VkPhysicalDeviceProperties properties;
         pfnGetPhysicalDeviceProperties(devices[i], &properties);
 
-        const std::string vk_version = format("%d.%d.%d", VK_VERSION_MAJOR(properties.apiVersion),
-                                              VK_VERSION_MINOR(properties.apiVersion), VK_VERSION_PATCH(properties.apiVersion));
-
-        log += format("    - %s with Vulkan %s\n", properties.deviceName, vk_version.c_str());
+        VulkanPhysicalDeviceInfo physical_device;
+        physical_device.name = properties.deviceName;
+        physical_device.api_version = Version(properties.apiVersion);
 
         if (has_device_id) {
             PFN_vkGetPhysicalDeviceProperties2 pfnGetPhysicalDeviceProperties2 =
@@ -340,20 +318,117 @@ std::string GenerateVulkanStatus() {
 
             pfnGetPhysicalDeviceProperties2(devices[i], &properties2);
 
-            const std::string deviceUUID = GetUUIDString(properties_deviceid.deviceUUID);
-            log += format("        - deviceUUID: %s\n", deviceUUID.c_str());
-
-            const std::string driverUUID = GetUUIDString(properties_deviceid.driverUUID);
-            log += format("        - driverUUID: %s\n", driverUUID.c_str());
+            physical_device.device_uuid = GetUUIDString(properties_deviceid.deviceUUID);
+            physical_device.driver_uuid = GetUUIDString(properties_deviceid.driverUUID);
         }
 
-        configurator_edit.device_names.push_back(properties.deviceName);
+        vulkan_system.physical_devices.push_back(physical_device);
     }
 
     vkDestroyInstance(inst, NULL);
 
-    if (active_configuration != nullptr) {
-        OverrideConfiguration(configurator.environment, configurator.layers.available_layers, *active_configuration);
+    return vulkan_system;
+}
+
+std::string GenerateVulkanStatus(const VulkanSystemInfo &vulkan_system) {
+    std::string log;
+
+    const Configurator &configurator = Configurator::Get();
+
+    // Layers override configuration
+    if (configurator.configurations.HasActiveConfiguration(configurator.layers.available_layers)) {
+        log +=
+            format("- Layers override: \"%s\" configuration\n", configurator.configurations.GetActiveConfiguration()->key.c_str());
+    } else {
+        log += "- Layers override: None\n";
+    }
+
+    // Check Vulkan SDK path
+    const std::string search_path(configurator.path.GetPath(PATH_VULKAN_SDK));
+    if (!search_path.empty())
+        log += format("- VULKAN_SDK environment variable: %s\n", search_path.c_str());
+    else
+        log += "- VULKAN_SDK environment variable not set\n";
+
+    const Version &loader_version = vulkan_system.loader_version;
+
+    if (vulkan_system.error == VULKAN_SYSTEM_LOADER_FAILURE) {
+        Alert::LoaderFailure();
+
+        log += "- Could not find a Vulkan Loader.\n";
+        return log;
+    } else {
+        log += format("- Vulkan Loader version: %s\n", loader_version.str().c_str());
+        const LoaderMessageLevel loader_debug_message = configurator.environment.GetLoaderMessage();
+        if (loader_debug_message != LOADER_MESSAGE_NONE) {
+            log += format("    - VK_LOADER_DEBUG=%s\n", GetLoaderDebugToken(loader_debug_message).c_str());
+        }
+    }
+
+    log += "- User-Defined Layers locations:\n";
+    log += GetUserDefinedLayersPathsLog("VK_LAYER_PATH variable", USER_DEFINED_LAYERS_PATHS_ENV_SET);
+    log += GetUserDefinedLayersPathsLog("Per-configuration paths", USER_DEFINED_LAYERS_PATHS_GUI);
+    log += GetUserDefinedLayersPathsLog("VK_ADD_LAYER_PATH variable", USER_DEFINED_LAYERS_PATHS_ENV_ADD);
+
+    const std::string layer_settings_path(qgetenv("VK_LAYER_SETTINGS_PATH"));
+    if (!layer_settings_path.empty()) {
+        log += "- `vk_layer_settings.txt` location overridden by VK_LAYER_SETTINGS_PATH:\n";
+        if (layer_settings_path.find("vk_layer_settings.txt") == std::string::npos) {
+            log += format("    %s\n", layer_settings_path.c_str());
+        } else {
+            log += format("    %s\n", ExtractAbsoluteDir(layer_settings_path).c_str());
+        }
+    } else {
+        const std::string path = GetPath(BUILTIN_PATH_OVERRIDE_SETTINGS);
+        log += "- `vk_layer_settings.txt` uses the default platform path:\n";
+        log += format("    %s\n", ExtractAbsoluteDir(path).c_str());
+    }
+
+    log += "- Available Layers:\n";
+    for (std::size_t i = 0, n = vulkan_system.layers.size(); i < n; ++i) {
+        const Layer *layer = FindByKey(configurator.layers.available_layers, vulkan_system.layers[i].c_str());
+
+        std::string status;
+        if (layer != nullptr) {
+            if (layer->status != STATUS_STABLE) {
+                status = GetToken(layer->status);
+            }
+        }
+
+        if (status.empty()) {
+            log += format("    - %s\n", vulkan_system.layers[i].c_str());
+        } else {
+            log += format("    - %s (%s)\n", vulkan_system.layers[i].c_str(), status.c_str());
+        }
+    }
+
+    if (vulkan_system.error == VULKAN_SYSTEM_INSTANCE_FAILURE) {
+        Alert::InstanceFailure();
+
+        log += "- Cannot find a compatible Vulkan installable client driver (ICD).\n";
+        return log;
+    } else if (vulkan_system.error == VULKAN_SYSTEM_PHYSICAL_DEVICE_FAILURE) {
+        Alert::PhysicalDeviceFailure();
+
+        log += "- Cannot find a compatible Vulkan installable client driver (ICD).\n";
+        return log;
+    }
+
+    Configurator &configurator_edit = Configurator::Get();
+    configurator_edit.device_names.clear();
+
+    log += "- Physical Devices:\n";
+    for (std::size_t i = 0, n = vulkan_system.physical_devices.size(); i < n; ++i) {
+        const VulkanPhysicalDeviceInfo &physical_device = vulkan_system.physical_devices[i];
+
+        log += format("    - %s with Vulkan %s\n", physical_device.name.c_str(), physical_device.api_version.str().c_str());
+
+        if (!physical_device.device_uuid.empty()) {
+            log += format("        - deviceUUID: %s\n", physical_device.device_uuid.c_str());
+            log += format("        - driverUUID: %s\n", physical_device.driver_uuid.c_str());
+        }
+
+        configurator_edit.device_names.push_back(physical_device.name);
     }
 
     return log;
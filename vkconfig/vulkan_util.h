@@ -23,6 +23,38 @@
 #include "../vkconfig_core/version.h"
 
 #include <string>
+#include <vector>
+
+enum VulkanSystemError {
+    VULKAN_SYSTEM_NO_ERROR = 0,
+    VULKAN_SYSTEM_LOADER_FAILURE,
+    VULKAN_SYSTEM_INSTANCE_FAILURE,
+    VULKAN_SYSTEM_PHYSICAL_DEVICE_FAILURE
+};
+
+struct VulkanPhysicalDeviceInfo {
+    VulkanPhysicalDeviceInfo() : api_version(Version::VERSION_NULL) {}
+
+    std::string name;
+    Version api_version;
+    std::string device_uuid;  // Empty when VK_KHR_external_memory_capabilities is not supported
+    std::string driver_uuid;
+};
+
+struct VulkanSystemInfo {
+    VulkanSystemInfo() : error(VULKAN_SYSTEM_NO_ERROR), loader_version(Version::VERSION_NULL) {}
+
+    VulkanSystemError error;
+    Version loader_version;
+    std::vector<std::string> layers;
+    std::vector<VulkanPhysicalDeviceInfo> physical_devices;
+};
 
 Version GetVulkanLoaderVersion();
-std::string GenerateVulkanStatus();
+std::string GetVulkanDriversSignature();
+
+// Load the Vulkan loader to enumerate the layers and the physical devices. It doesn't access the Configurator so that it can run
+// on a worker thread, the caller surrenders the layers override beforehand.
+VulkanSystemInfo ProbeVulkanSystem();
+
+std::string GenerateVulkanStatus(const VulkanSystemInfo &vulkan_system);
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "widget_live_stats.h"
+
+#include "../vkconfig_core/util.h"
+
+#include <QHBoxLayout>
+#include <QPainter>
+#include <QPolygonF>
+
+#include <algorithm>
+#include <cmath>
+
+WidgetFrameTimeGraph::WidgetFrameTimeGraph(QWidget* parent) : QWidget(parent) {
+    this->setMinimumSize(160, 56);
+    this->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    this->setToolTip("Median frame time of each update of the monitor layer telemetry");
+}
+
+void WidgetFrameTimeGraph::SetFrameTimes(const std::vector<float>& frame_times_ms) {
+    if (this->frame_times_ms == frame_times_ms) return;
+
+    this->frame_times_ms = frame_times_ms;
+    this->update();
+}
+
+void WidgetFrameTimeGraph::paintEvent(QPaintEvent* event) {
+    (void)event;
+
+    QPainter painter(this);
+    const QRectF area = QRectF(this->rect()).adjusted(0.5, 0.5, -0.5, -0.5);
+    painter.fillRect(area, this->palette().base());
+    painter.setPen(this->palette().mid().color());
+    painter.drawRect(area);
+
+    if (this->frame_times_ms.size() < 2) return;
+
+    // The scale is rounded up to the next 10 ms so that it doesn't change with every sample
+    const float max_ms = *std::max_element(this->frame_times_ms.begin(), this->frame_times_ms.end());
+    const float scale_ms = std::max(10.0f, std::ceil(max_ms / 10.0f) * 10.0f);
+
+    QPolygonF line;
+    const double step = area.width() / static_cast<double>(LIVE_STATS_HISTORY - 1);
+    const double start = area.right() - step * static_cast<double>(this->frame_times_ms.size() - 1);
+    for (std::size_t i = 0, n = this->frame_times_ms.size(); i < n; ++i) {
+        const double y = area.bottom() - area.height() * static_cast<double>(this->frame_times_ms[i] / scale_ms);
+        line << QPointF(start + step * static_cast<double>(i), y);
+    }
+
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(this->palette().highlight().color());
+    painter.drawPolyline(line);
+
+    painter.setPen(this->palette().text().color());
+    painter.drawText(area.adjusted(4, 2, -4, -2), Qt::AlignTop | Qt::AlignLeft, format("%.0f ms", scale_ms).c_str());
+}
+
+WidgetLiveStats::WidgetLiveStats(QWidget* parent)
+    : QWidget(parent), label_frames(new QLabel(this)), graph(new WidgetFrameTimeGraph(this)), label_calls(new QLabel(this)) {
+    this->label_frames->setMinimumWidth(180);
+    this->label_frames->setAlignment(Qt::AlignTop | Qt::AlignLeft);
+    this->label_calls->setMinimumWidth(240);
+    this->label_calls->setAlignment(Qt::AlignTop | Qt::AlignLeft);
+    this->label_calls->setToolTip(
+        "Functions which took the most time and submits per frame, from the JSON statistics written to a file by "
+        "VK_LAYER_LUNARG_api_dump with the Statistics output format");
+
+    QHBoxLayout* layout = new QHBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(this->label_frames);
+    layout->addWidget(this->graph, 1);
+    layout->addWidget(this->label_calls);
+
+    this->SetStats(LiveStats());
+}
+
+void WidgetLiveStats::SetStats(const LiveStats& stats) {
+    std::string frames;
+    if (!stats.telemetry) {
+        frames = "Waiting for VK_LAYER_LUNARG_monitor...";
+    } else if (stats.frames == 0) {
+        frames = "No frame presented";
+    } else {
+        frames = format("%.1f FPS, %llu frames\nMedian: %.2f ms, P99: %.2f ms", stats.fps,
+                        static_cast<unsigned long long>(stats.frames), stats.median_ms, stats.p99_ms);
+        if (stats.gpu_time_ms >= 0.0f) frames += format("\nGPU: %.2f ms", stats.gpu_time_ms);
+        if (stats.memory_budget_mb > 0.0f) {
+            frames += format("\nVRAM: %.0f / %.0f MB", stats.memory_usage_mb, stats.memory_budget_mb);
+        }
+    }
+    this->label_frames->setText(frames.c_str());
+    this->graph->SetFrameTimes(stats.frame_times_ms);
+
+    std::string calls;
+    if (!stats.api_stats) {
+        calls = "No VK_LAYER_LUNARG_api_dump statistics";
+    } else {
+        calls = format("Submits per frame: %.1f", stats.submits_per_frame);
+        for (std::size_t i = 0, n = stats.top_calls.size(); i < n; ++i) {
+            calls += format("\n%s: %.2f ms (%llu)", stats.top_calls[i].name.c_str(), stats.top_calls[i].total_ms,
+                            static_cast<unsigned long long>(stats.top_calls[i].calls));
+        }
+    }
+    this->label_calls->setText(calls.c_str());
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#pragma once
+
+#include "../vkconfig_core/live_stats.h"
+
+#include <QLabel>
+#include <QPaintEvent>
+#include <QWidget>
+
+#include <vector>
+
+// The median frame times of the last updates of the monitor layer telemetry
+class WidgetFrameTimeGraph : public QWidget {
+    Q_OBJECT
+
+   public:
+    explicit WidgetFrameTimeGraph(QWidget* parent = nullptr);
+
+    void SetFrameTimes(const std::vector<float>& frame_times_ms);
+
+   protected:
+    void paintEvent(QPaintEvent* event) override;
+
+   private:
+    std::vector<float> frame_times_ms;
+};
+
+// The statistics of the application launched by the launcher, as read from the layers by a LiveStatsReader
+class WidgetLiveStats : public QWidget {
+    Q_OBJECT
+
+   public:
+    explicit WidgetLiveStats(QWidget* parent = nullptr);
+
+    void SetStats(const LiveStats& stats);
+
+   private:
+    QLabel* label_frames;
+    WidgetFrameTimeGraph* graph;
+    QLabel* label_calls;
+};
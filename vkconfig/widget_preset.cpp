@@ -23,7 +23,11 @@
 #include <cassert>
 
 WidgetPreset::WidgetPreset(QTreeWidget* tree, QTreeWidgetItem* item, const Layer& layer, Parameter& parameter)
-    : WidgetSettingBase(tree, item), layer(layer), parameter(parameter), field(new ComboBox(this)) {
+    : WidgetSettingBase(tree, item),
+      layer(layer),
+      parameter(parameter),
+      tracker(layer.presets, parameter.settings),
+      field(new ComboBox(this)) {
     assert(&layer);
     assert(&parameter);
 
@@ -53,19 +57,22 @@ WidgetPreset::WidgetPreset(QTreeWidget* tree, QTreeWidgetItem* item, const Layer
 void WidgetPreset::Refresh(RefreshAreas refresh_areas) {
     (void)refresh_areas;
 
-    const std::string& preset_label = layer.FindPresetLabel(parameter.settings);
+    const LayerPreset* preset = this->tracker.FindPreset();
+    const std::string preset_label = preset != nullptr ? preset->label : Layer::NO_PRESET;
 
     this->field->blockSignals(true);
     this->field->setCurrentIndex(GetComboBoxIndex(preset_label.c_str()));
     this->field->blockSignals(false);
 
-    if (preset_label != Layer::NO_PRESET) {
-        const LayerPreset* preset = GetPreset(layer.presets, preset_label.c_str());
-        assert(preset != nullptr);
+    if (preset != nullptr) {
         this->setToolTip(preset->description.c_str());
     }
 }
 
+void WidgetPreset::UpdateSetting(const std::string& key) { this->tracker.Update(key); }
+
+void WidgetPreset::UpdateSettings() { this->tracker.UpdateAll(); }
+
 void WidgetPreset::resizeEvent(QResizeEvent* event) {
     const QRect button_rect = QRect(0, 0, event->size().width(), event->size().height());
     this->field->setGeometry(button_rect);
@@ -89,6 +96,7 @@ void WidgetPreset::OnPresetChanged(int combox_preset_index) {
     const LayerPreset* preset = GetPreset(layer.presets, preset_label.c_str());
     assert(preset != nullptr);
     parameter.ApplyPresetSettings(*preset);
+    this->tracker.UpdateAll();
 
     emit itemChanged();
 }
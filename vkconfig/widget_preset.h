@@ -28,6 +28,7 @@
 
 #include <QResizeEvent>
 
+#include <string>
 #include <vector>
 
 class WidgetPreset : public WidgetSettingBase {
@@ -38,6 +39,10 @@ class WidgetPreset : public WidgetSettingBase {
 
     void Refresh(RefreshAreas refresh_areas) override;
 
+    // To call when a setting of the parameter was changed by another widget, before refreshing
+    void UpdateSetting(const std::string& key);
+    void UpdateSettings();
+
    public Q_SLOTS:
     void OnPresetChanged(int combox_preset_index);
 
@@ -53,5 +58,6 @@ class WidgetPreset : public WidgetSettingBase {
     std::vector<std::string> preset_labels;  // The preset in the combobox
     const Layer& layer;
     Parameter& parameter;
+    LayerPresetTracker tracker;
     ComboBox* field;
 };
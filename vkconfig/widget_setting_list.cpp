@@ -39,23 +39,70 @@ const char *GetFieldToolTip(const SettingMetaList &meta, bool current_list_empty
     }
 }
 
+static std::string GetSearchText(const NumberOrString &value) {
+    return value.key.empty() ? format("%d", value.number) : value.key;
+}
+
+SettingListSearchModel::SettingListSearchModel(const std::vector<NumberOrString> &values,
+                                               const std::vector<EnabledNumberOrString> &excluded, QObject *parent)
+    : QAbstractListModel(parent), values(values), excluded(excluded), complete(false) {}
+
+void SettingListSearchModel::SetFilter(const QString &filter) {
+    const std::string text = filter.toStdString();
+
+    std::vector<std::size_t> matches;
+
+    if (!text.empty()) {
+        // When the user keeps typing, the new matches are among the previous ones unless some were cut off
+        const bool refine = this->complete && !this->filter.empty() && text.find(this->filter) != std::string::npos;
+
+        const std::size_t count = refine ? this->matches.size() : this->values.size();
+        for (std::size_t i = 0; i < count && matches.size() < MAX_MATCH_COUNT; ++i) {
+            const std::size_t index = refine ? this->matches[i] : i;
+            const NumberOrString &value = this->values[index];
+
+            if (GetSearchText(value).find(text) == std::string::npos) continue;
+            if (IsValueFound(this->excluded, value)) continue;
+
+            matches.push_back(index);
+        }
+
+        this->complete = matches.size() < MAX_MATCH_COUNT;
+    }
+
+    this->beginResetModel();
+    this->filter = text;
+    this->matches.swap(matches);
+    this->endResetModel();
+}
+
+void SettingListSearchModel::Invalidate() { this->complete = false; }
+
+int SettingListSearchModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(this->matches.size());
+}
+
+QVariant SettingListSearchModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= static_cast<int>(this->matches.size())) return QVariant();
+    if (role != Qt::DisplayRole && role != Qt::EditRole) return QVariant();
+
+    return QString(GetSearchText(this->values[this->matches[index.row()]]).c_str());
+}
+
 WidgetSettingList::WidgetSettingList(QTreeWidget *tree, QTreeWidgetItem *item, const SettingMetaList &meta,
                                      SettingDataSet &data_set)
     : WidgetSettingBase(tree, item),
       meta(meta),
       data_set(data_set),
       search(nullptr),
+      search_model(nullptr),
       field(new QLineEdit(this)),
-      add_button(new QPushButton(this)),
-      list(meta.list) {
+      add_button(new QPushButton(this)) {
     assert(&this->meta);
 
     std::vector<EnabledNumberOrString> value = this->data().value;
-    for (std::size_t i = 0, n = value.size(); i < n; ++i) {
-        ::RemoveValue(this->list, value[i]);
-    }
 
-    const char *tooltip = GetFieldToolTip(this->meta, this->list.empty());
+    const char *tooltip = GetFieldToolTip(this->meta, !this->HasAvailableValues());
 
     this->field->show();
     this->field->setText("");
@@ -93,10 +140,12 @@ void WidgetSettingList::Refresh(RefreshAreas refresh_areas) {
     this->item->setHidden(enabled == SETTING_DEPENDENCE_HIDE);
     this->item->setDisabled(enabled != SETTING_DEPENDENCE_ENABLE);
     this->setEnabled(enabled == SETTING_DEPENDENCE_ENABLE);
-    this->field->setEnabled(enabled == SETTING_DEPENDENCE_ENABLE && (!this->meta.list_only || !this->list.empty()));
+    const bool available_values = !this->meta.list_only || this->HasAvailableValues();
+
+    this->field->setEnabled(enabled == SETTING_DEPENDENCE_ENABLE && available_values);
     this->add_button->setEnabled(enabled == SETTING_DEPENDENCE_ENABLE && !this->field->text().isEmpty());
 
-    if (this->meta.list_only && this->list.empty()) {
+    if (!available_values) {
         this->field->hide();
         this->add_button->hide();
     } else {
@@ -157,10 +206,11 @@ bool WidgetSettingList::eventFilter(QObject *target, QEvent *event) {
 void WidgetSettingList::ResetCompleter() {
     if (this->search != nullptr) this->search->deleteLater();
 
-    this->search = new QCompleter(ConvertValues(this->list), this);
-    this->search->setCompletionMode(QCompleter::PopupCompletion);
-    this->search->setModelSorting(QCompleter::CaseSensitivelySortedModel);
-    this->search->setFilterMode(Qt::MatchContains);
+    // The model does the filtering as the user types, so the completer displays it unfiltered
+    this->search = new QCompleter(this);
+    this->search_model = new SettingListSearchModel(this->meta.list, this->data().value, this->search);
+    this->search->setModel(this->search_model);
+    this->search->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
     this->search->setCaseSensitivity(Qt::CaseSensitive);
     this->search->setMaxVisibleItems(20);
 
@@ -169,6 +219,16 @@ void WidgetSettingList::ResetCompleter() {
     this->connect(this->search, SIGNAL(activated(const QString &)), this, SLOT(OnCompleted(const QString &)), Qt::QueuedConnection);
 }
 
+bool WidgetSettingList::HasAvailableValues() {
+    const std::vector<EnabledNumberOrString> &value = this->data().value;
+
+    for (std::size_t i = 0, n = this->meta.list.size(); i < n; ++i) {
+        if (!IsValueFound(value, this->meta.list[i])) return true;
+    }
+
+    return false;
+}
+
 void WidgetSettingList::AddElement(EnabledNumberOrString &element) {
     QTreeWidgetItem *child = new QTreeWidgetItem();
     child->setSizeHint(0, QSize(0, ITEM_HEIGHT));
@@ -220,7 +280,6 @@ void WidgetSettingList::OnElementAppended() {
 
     value.push_back(entry);
     std::sort(value.begin(), value.end());
-    ::RemoveValue(this->list, entry);
 
     emit itemChanged();
 }
@@ -238,13 +297,18 @@ void WidgetSettingList::OnTextEdited(const QString &value) {
     this->Resize();
 
     this->add_button->setEnabled(!value.isEmpty());
+
+    this->search_model->SetFilter(value);
+    if (this->search_model->rowCount() > 0 && this->field->hasFocus()) {
+        this->search->complete();
+    }
 }
 
 void WidgetSettingList::OnElementRemoved(const QString &element) {
     NumberOrString list_value(element.toStdString());
-    this->list.push_back(list_value);
 
     RemoveValue(this->data().value, EnabledNumberOrString(list_value));
+    this->search_model->Invalidate();
 }
 
 void WidgetSettingList::OnSettingChanged() { emit itemChanged(); }
@@ -27,10 +27,37 @@
 
 #include <QResizeEvent>
 #include <QStringList>
+#include <QAbstractListModel>
 #include <QCompleter>
 #include <QLineEdit>
 #include <QPushButton>
 
+// The accepted values of a list setting containing the text typed by the user. The values are read from the setting meta rather
+// than copied for each widget and the values already listed by the setting data are skipped.
+class SettingListSearchModel : public QAbstractListModel {
+   public:
+    SettingListSearchModel(const std::vector<NumberOrString> &values, const std::vector<EnabledNumberOrString> &excluded,
+                           QObject *parent);
+
+    void SetFilter(const QString &filter);
+
+    // The excluded values changed, the next filter searches all the values again
+    void Invalidate();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+   private:
+    enum { MAX_MATCH_COUNT = 256 };
+
+    const std::vector<NumberOrString> &values;
+    const std::vector<EnabledNumberOrString> &excluded;
+
+    std::string filter;
+    std::vector<std::size_t> matches;
+    bool complete;
+};
+
 class WidgetSettingList : public WidgetSettingBase {
     Q_OBJECT
 
@@ -58,6 +85,7 @@ class WidgetSettingList : public WidgetSettingBase {
     void Resize();
     void AddElement(EnabledNumberOrString &element);
     void ResetCompleter();
+    bool HasAvailableValues();
 
     SettingDataList &data();
 
@@ -65,10 +93,10 @@ class WidgetSettingList : public WidgetSettingBase {
     SettingDataSet &data_set;
 
     QCompleter *search;
+    SettingListSearchModel *search_model;
     QLineEdit *field;
     QPushButton *add_button;
     QSize size;
 
-    std::vector<NumberOrString> list;
     std::vector<EnabledNumberOrString> value_cached;
 };
@@ -150,6 +150,7 @@ static const CommandDocDesc command_doc_desc[] = {
     {COMMAND_DOC_HTML, "--html", 3},
     {COMMAND_DOC_MARKDOWN, "--markdown", 3},
     {COMMAND_DOC_SETTINGS, "--settings", 3},
+    {COMMAND_DOC_ALL, "--all", 2},
 };
 
 static CommandLayersArg GetCommandLayersId(const char* token) {
@@ -203,16 +204,30 @@ CommandLine::CommandLine(int argc, char* argv[])
       command_vulkan_sdk(_command_vulkan_sdk),
       doc_layer_name(_doc_layer_name),
       doc_out_dir(_doc_out_dir),
+      profile(_profile),
       error(_error),
       error_args(_error_args),
       _command(COMMAND_GUI),
       _command_reset_arg(COMMAND_RESET_NONE),
       _command_layers_arg(COMMAND_LAYERS_NONE),
       _command_doc_arg(COMMAND_DOC_NONE),
+      _profile(false),
       _error(ERROR_NONE),
       _help(HELP_DEFAULT) {
     assert(argc >= 1);
 
+    // The '--profile' option may be combined with any command, remove it before parsing the command
+    std::vector<char*> args;
+    for (int i = 0; i < argc; ++i) {
+        if (i > 0 && std::strcmp(argv[i], "--profile") == 0) {
+            _profile = true;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    argc = static_cast<int>(args.size());
+    argv = &args[0];
+
     if (argc <= 1) return;
     int arg_offset = 1;
 
@@ -258,18 +273,12 @@ CommandLine::CommandLine(int argc, char* argv[])
             }
         } break;
         case COMMAND_DOC: {
-            if (argc <= arg_offset + 2) {
+            if (argc <= arg_offset + 1) {
                 _error = ERROR_MISSING_COMMAND_ARGUMENT;
                 _error_args.push_back(argv[arg_offset + 0]);
                 break;
             }
 
-            if (argc > 5) {
-                _error = ERROR_TOO_MANY_COMMAND_ARGUMENTS;
-                _error_args.push_back(argv[arg_offset + 0]);
-                break;
-            }
-
             _command_doc_arg = GetCommandDocId(argv[arg_offset + 1]);
             if (_command_doc_arg == COMMAND_DOC_NONE) {
                 _error = ERROR_INVALID_COMMAND_ARGUMENT;
@@ -277,10 +286,28 @@ CommandLine::CommandLine(int argc, char* argv[])
                 _error_args.push_back(argv[arg_offset + 1]);
                 break;
             }
-            _doc_layer_name = argv[arg_offset + 2];
-            if (argc == 5) {
+
+            // The output dir is the only optional argument
+            const CommandDocDesc& desc = GetCommandDoc(_command_doc_arg);
+            if (argc < arg_offset + desc.required_arguments) {
+                _error = ERROR_MISSING_COMMAND_ARGUMENT;
+                _error_args.push_back(argv[arg_offset + 0]);
+                break;
+            }
+
+            if (argc > arg_offset + desc.required_arguments + 1) {
+                _error = ERROR_TOO_MANY_COMMAND_ARGUMENTS;
+                _error_args.push_back(argv[arg_offset + 0]);
+                break;
+            }
+
+            if (_command_doc_arg != COMMAND_DOC_ALL) {
+                _doc_layer_name = argv[arg_offset + 2];
+            }
+
+            if (argc == arg_offset + desc.required_arguments + 1) {
                 // Output dir arg was specified
-                _doc_out_dir = argv[arg_offset + 3];
+                _doc_out_dir = argv[arg_offset + desc.required_arguments];
             } else
                 // Output dir arg was not specified
                 _doc_out_dir = ".";
@@ -374,7 +401,7 @@ void CommandLine::usage() const {
         }
         case HELP_DEFAULT: {
             printf("Usage\n");
-            printf("\tvkconfig [[help] | [version] | [gui] | [layers <args>]]\n");
+            printf("\tvkconfig [--profile] [[help] | [version] | [gui] | [layers <args>]]\n");
             printf("\n");
             printf("Command:\n");
             printf("\thelp                      = Display usage and documentation.\n");
@@ -384,6 +411,9 @@ void CommandLine::usage() const {
             printf("\tdoc                       = Create doc files for layer.\n");
             printf("\treset                     = Reset layers configurations.\n");
             printf("\n");
+            printf("Option:\n");
+            printf("\t--profile                 = Display the duration of the %s operations on exit.\n", VKCONFIG_NAME);
+            printf("\n");
             printf("  (Use 'vkconfig help <command>' for detailed usage of %s commands.)\n", VKCONFIG_NAME);
             break;
         }
@@ -443,6 +473,7 @@ void CommandLine::usage() const {
             printf("\tvkconfig doc --html <layer_name> [<output_dir>]\n");
             printf("\tvkconfig doc --markdown <layer_name> [<output_dir>]\n");
             printf("\tvkconfig doc --settings <layer_name> [<output_dir>]\n");
+            printf("\tvkconfig doc --all [<output_dir>]\n");
             printf("\n");
             printf("Description\n");
             printf("\tvkconfig doc --html <layer_name> [<output_dir>]\n");
@@ -456,6 +487,11 @@ void CommandLine::usage() const {
             printf("\tvkconfig doc --settings <layer_name> [<output_dir>]\n");
             printf("\t\tCreate the vk_layers_settings.txt file for the given layer.\n");
             printf("\t\tThe file is written to <output_dir>, or current directory if not specified.\n");
+            printf("\n");
+            printf("\tvkconfig doc --all [<output_dir>]\n");
+            printf("\t\tCreate the html and markdown documentation files for all the available layers.\n");
+            printf("\t\tThe files of the layers whose manifest didn't change since the previous run are kept.\n");
+            printf("\t\tThe files are written to <output_dir>, or current directory if not specified.\n");
             break;
         }
         case HELP_RESET: {
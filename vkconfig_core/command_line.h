@@ -43,7 +43,7 @@ enum CommandLayersArg {
     COMMAND_LAYERS_VERBOSE
 };
 
-enum CommandDocArg { COMMAND_DOC_NONE = 0, COMMAND_DOC_HTML, COMMAND_DOC_MARKDOWN, COMMAND_DOC_SETTINGS };
+enum CommandDocArg { COMMAND_DOC_NONE = 0, COMMAND_DOC_HTML, COMMAND_DOC_MARKDOWN, COMMAND_DOC_SETTINGS, COMMAND_DOC_ALL };
 
 enum CommandResetArg { COMMAND_RESET_NONE = 0, COMMAND_RESET_SOFT, COMMAND_RESET_HARD };
 
@@ -74,6 +74,7 @@ class CommandLine {
     const std::string& command_vulkan_sdk;
     const std::string& doc_layer_name;
     const std::string& doc_out_dir;
+    const bool& profile;  // Print the duration of the operations on exit, set by the '--profile' option of any command
 
     const CommandError& error;
     const std::vector<std::string>& error_args;
@@ -90,6 +91,7 @@ class CommandLine {
     std::string _command_vulkan_sdk;
     std::string _doc_layer_name;
     std::string _doc_out_dir;
+    bool _profile;
 
     CommandError _error;
     std::vector<std::string> _error_args;
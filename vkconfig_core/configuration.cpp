@@ -28,6 +28,7 @@
 
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
@@ -41,7 +42,12 @@
 
 static const char* SUPPORTED_CONFIG_FILES[] = {"_2_2_3", "_2_2_2", "_2_2_1"};
 
-Configuration::Configuration() : key("New Configuration"), platform_flags(PLATFORM_DESKTOP_BIT), view_advanced_settings(false) {}
+Configuration::Configuration()
+    : key("New Configuration"),
+      platform_flags(PLATFORM_DESKTOP_BIT),
+      view_advanced_settings(false),
+      generation(1),
+      saved_generation(0) {}
 
 bool Configuration::Load2_2(const std::vector<Layer>& available_layers, const QJsonObject& json_root_object) {
     const QJsonValue& json_configuration_value = json_root_object.value("configuration");
@@ -131,25 +137,53 @@ bool Configuration::Load2_2(const std::vector<Layer>& available_layers, const QJ
     return true;
 }
 
-bool Configuration::Load(const std::vector<Layer>& available_layers, const std::string& full_path) {
+QJsonDocument ParseConfigurationFile(const std::string& full_path) {
     assert(!full_path.empty());
 
-    this->parameters.clear();
-
     QFile file(full_path.c_str());
     const bool result = file.open(QIODevice::ReadOnly | QIODevice::Text);
     assert(result);
-    QString json_text = file.readAll();
+    const QByteArray json_text = file.readAll();
     file.close();
 
     QJsonParseError parse_error;
-    QJsonDocument json_doc = QJsonDocument::fromJson(json_text.toUtf8(), &parse_error);
+    const QJsonDocument json_doc = QJsonDocument::fromJson(json_text, &parse_error);
 
     if (parse_error.error != QJsonParseError::NoError) {
+        return QJsonDocument();
+    }
+
+    return json_doc;
+}
+
+std::vector<std::string> ReadConfigurationLayerKeys(const QJsonDocument& json_document) {
+    std::vector<std::string> layer_keys;
+
+    const QJsonValue& json_configuration_value = json_document.object().value("configuration");
+    if (json_configuration_value == QJsonValue::Undefined) return layer_keys;
+
+    const QJsonArray& json_layers_array = json_configuration_value.toObject().value("layers").toArray();
+    for (int i = 0, n = json_layers_array.size(); i < n; ++i) {
+        layer_keys.push_back(json_layers_array[i].toObject().value("name").toString().toStdString());
+    }
+
+    return layer_keys;
+}
+
+bool Configuration::Load(const std::vector<Layer>& available_layers, const std::string& full_path) {
+    return this->Load(available_layers, ParseConfigurationFile(full_path));
+}
+
+bool Configuration::Load(const std::vector<Layer>& available_layers, const QJsonDocument& json_document) {
+    this->parameters.clear();
+
+    if (json_document.isNull()) {
         return false;
     }
 
-    return Load2_2(available_layers, json_doc.object());
+    const bool result = Load2_2(available_layers, json_document.object());
+    if (result) this->saved_generation = this->generation;
+    return result;
 }
 
 bool Configuration::Save(const std::vector<Layer>& available_layers, const std::string& full_path, bool exporter) const {
@@ -223,9 +257,19 @@ bool Configuration::Save(const std::vector<Layer>& available_layers, const std::
 
     QJsonDocument doc(root);
 
-    QFile json_file(full_path.c_str());
-    const bool result = json_file.open(QIODevice::WriteOnly | QIODevice::Text);
+    // Written to a temporary file renamed over the previous one, so that an interrupted save never leaves a partial file
+    const QByteArray content = doc.toJson();
+    QSaveFile json_file(full_path.c_str());
+    bool result = json_file.open(QIODevice::WriteOnly | QIODevice::Text);
     assert(result);
+    if (result) {
+        result = json_file.write(content) == content.size();
+        if (result) {
+            result = json_file.commit();
+        } else {
+            json_file.cancelWriting();
+        }
+    }
 
     if (!result) {
         QMessageBox alert;
@@ -235,8 +279,8 @@ bool Configuration::Save(const std::vector<Layer>& available_layers, const std::
         alert.exec();
         return false;
     } else {
-        json_file.write(doc.toJson());
-        json_file.close();
+        // An exported file is not the file of the configuration
+        if (!exporter) this->saved_generation = this->generation;
         return true;
     }
 }
@@ -254,6 +298,7 @@ void Configuration::Reset(const std::vector<Layer>& available_layers, const Path
             assert(result);
 
             OrderParameter(this->parameters, available_layers);
+            this->MarkDirty();  // The saved file may differ from the built-in one
             return;
         }
     }
@@ -280,12 +325,14 @@ void Configuration::Reset(const std::vector<Layer>& available_layers, const Path
         for (auto it = this->parameters.begin(); it != this->parameters.end(); ++it) {
             it->state = LAYER_STATE_APPLICATION_CONTROLLED;
             it->overridden_rank = Parameter::NO_RANK;
+            it->DetachSettings(available_layers);
             for (std::size_t i = 0, n = it->settings.size(); i < n; ++i) {
                 it->settings[i]->Reset();
             }
         }
 
         OrderParameter(this->parameters, available_layers);
+        this->MarkDirty();
     }
 }
 
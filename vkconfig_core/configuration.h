@@ -25,7 +25,9 @@
 #include "path_manager.h"
 
 #include <QByteArray>
+#include <QJsonDocument>
 
+#include <cstdint>
 #include <vector>
 #include <string>
 
@@ -34,6 +36,7 @@ class Configuration {
     Configuration();
 
     bool Load(const std::vector<Layer>& available_layers, const std::string& full_path);
+    bool Load(const std::vector<Layer>& available_layers, const QJsonDocument& json_document);
     bool Save(const std::vector<Layer>& available_layers, const std::string& full_path, bool exporter = false) const;
     bool HasOverride() const;
 
@@ -52,8 +55,24 @@ class Configuration {
 
     bool IsBuiltIn() const;
 
+    // Must be called after every change of the configuration, its parameters or their settings, so that the configuration
+    // is written again by the next save. Loading and saving a configuration to its file leave it unchanged.
+    void MarkDirty() { ++this->generation; }
+    bool IsDirty() const { return this->generation != this->saved_generation; }
+
    private:
     bool Load2_2(const std::vector<Layer>& available_layers, const QJsonObject& json_root_object);
+
+    // A new configuration is dirty, as it has no file yet
+    std::uint64_t generation;
+    mutable std::uint64_t saved_generation;
 };
 
+// Doesn't depend on the layers, so that configuration files may be parsed by several threads at once. Returns a null document
+// when the file is not a valid JSON file.
+QJsonDocument ParseConfigurationFile(const std::string& full_path);
+
+// The keys of the layers listed by a parsed configuration file, so that only these layers may be loaded
+std::vector<std::string> ReadConfigurationLayerKeys(const QJsonDocument& json_document);
+
 std::string MakeConfigurationName(const std::vector<Configuration>& configurations, const std::string& configuration_name);
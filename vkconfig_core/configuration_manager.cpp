@@ -23,10 +23,16 @@
 #include "configuration_manager.h"
 #include "override.h"
 #include "alert.h"
+#include "profiler.h"
 
 #include <QMessageBox>
+#include <QFileInfo>
 #include <QFileInfoList>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 static const char *SUPPORTED_CONFIG_FILES[] = {"_2_2_3", "_2_2_2", "_2_2_1"};
 
 ConfigurationManager::ConfigurationManager(Environment &environment) : active_configuration(nullptr), environment(environment) {}
@@ -34,6 +40,8 @@ ConfigurationManager::ConfigurationManager(Environment &environment) : active_co
 ConfigurationManager::~ConfigurationManager() {}
 
 void ConfigurationManager::LoadAllConfigurations(const std::vector<Layer> &available_layers) {
+    ScopedTimer timer("ConfigurationManager::LoadAllConfigurations");
+
     this->available_configurations.clear();
     this->active_configuration = nullptr;
 
@@ -48,11 +56,22 @@ void ConfigurationManager::LoadAllConfigurations(const std::vector<Layer> &avail
 
     const std::string base_config_path = GetPath(BUILTIN_PATH_CONFIG_REF);
 
+    std::vector<std::string> configuration_paths;
     for (std::size_t i = 0, n = countof(SUPPORTED_CONFIG_FILES); i < n; ++i) {
-        const std::string path = base_config_path + SUPPORTED_CONFIG_FILES[i];
-        LoadConfigurationsPath(available_layers, path.c_str());
+        const QFileInfoList &configuration_files = GetJSONFiles((base_config_path + SUPPORTED_CONFIG_FILES[i]).c_str());
+        for (int j = 0, m = configuration_files.size(); j < m; ++j) {
+            std::string path = configuration_files[j].absoluteFilePath().toStdString();
+
+            // Skip "2_2_1/Portability.json" because we replaced the devsim layer by the profiles layer
+            if (path.find("2_2_1/Portability.json") != std::string::npos) {
+                path = ":/configurations/Portability.json";
+            }
+            configuration_paths.push_back(path);
+        }
     }
 
+    LoadConfigurationFiles(available_layers, configuration_paths);
+
     RefreshConfiguration(available_layers);
 }
 
@@ -90,19 +109,35 @@ void ConfigurationManager::SortConfigurations() {
     std::sort(this->available_configurations.begin(), this->available_configurations.end(), Compare());
 }
 
-void ConfigurationManager::LoadConfigurationsPath(const std::vector<Layer> &available_layers, const char *path) {
-    const QFileInfoList &configuration_files = GetJSONFiles(path);
-    for (int i = 0, n = configuration_files.size(); i < n; ++i) {
-        const QFileInfo &info = configuration_files[i];
+void ConfigurationManager::LoadConfigurationFiles(const std::vector<Layer> &available_layers,
+                                                  const std::vector<std::string> &paths) {
+    const std::size_t path_count = paths.size();
+    if (path_count == 0) return;
 
-        Configuration configuration;
-        std::string path = info.absoluteFilePath().toStdString();
+    // Reading and parsing the files is done by several threads. Loading the configurations instantiates the settings of the
+    // layers and may show alerts, so it remains on this thread.
+    std::vector<QJsonDocument> documents(path_count);
+    std::atomic<std::size_t> next_path(0);
 
-        // Skip "2_2_1/Portability.json" because we replaced the devsim layer by the profiles layer
-        if (path.find("2_2_1/Portability.json") != std::string::npos) {
-            path = ":/configurations/Portability.json";
+    auto parse = [&]() {
+        for (std::size_t i = next_path++; i < path_count; i = next_path++) {
+            documents[i] = ParseConfigurationFile(paths[i]);
         }
-        const bool result = configuration.Load(available_layers, path);
+    };
+
+    const std::size_t thread_count = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), path_count);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < thread_count; ++i) {
+        threads.push_back(std::thread(parse));
+    }
+    parse();
+    for (std::size_t i = 0, n = threads.size(); i < n; ++i) {
+        threads[i].join();
+    }
+
+    for (std::size_t i = 0; i < path_count; ++i) {
+        Configuration configuration;
+        const bool result = configuration.Load(available_layers, documents[i]);
         if (!result) continue;
 
         if (FindByKey(available_configurations, configuration.key.c_str()) != nullptr) continue;
@@ -113,28 +148,28 @@ void ConfigurationManager::LoadConfigurationsPath(const std::vector<Layer> &avai
 }
 
 void ConfigurationManager::SaveAllConfigurations(const std::vector<Layer> &available_layers) {
+    const std::string base_path = GetPath(BUILTIN_PATH_CONFIG_LAST) + "/";
+
     for (std::size_t i = 0, n = available_configurations.size(); i < n; ++i) {
-        const std::string path = GetPath(BUILTIN_PATH_CONFIG_LAST) + "/" + available_configurations[i].key + ".json";
+        const std::string path = base_path + available_configurations[i].key + ".json";
+
+        // The configurations loaded from elsewhere, such as the built-in ones or those of older versions, have no file yet
+        if (!available_configurations[i].IsDirty() && QFileInfo::exists(path.c_str())) continue;
+
         available_configurations[i].Save(available_layers, path.c_str());
     }
 }
 
 Configuration &ConfigurationManager::CreateConfiguration(const std::vector<Layer> &available_layers,
                                                          const std::string &configuration_name, bool duplicate) {
-    Configuration *duplicate_configuration = FindByKey(available_configurations, configuration_name.c_str());
-
-    Configuration new_configuration = duplicate_configuration != nullptr && duplicate ? *duplicate_configuration : Configuration();
-    new_configuration.key = MakeConfigurationName(available_configurations, configuration_name);
-
-    const std::string path = GetPath(BUILTIN_PATH_CONFIG_LAST) + "/" + new_configuration.key + ".json";
-    new_configuration.Save(available_layers, path.c_str());
+    (void)available_layers;
 
-    // Reload from file to workaround the lack of SettingSet copy support
-    Configuration configuration;
-    const bool result = configuration.Load(available_layers, path.c_str());
-    assert(result);
+    Configuration *duplicate_configuration = FindByKey(available_configurations, configuration_name.c_str());
 
-    RemoveConfigurationFile(new_configuration.key);
+    // The parameters of the duplicate share their setting data with the original configuration until either is edited
+    Configuration configuration = duplicate_configuration != nullptr && duplicate ? *duplicate_configuration : Configuration();
+    configuration.key = MakeConfigurationName(available_configurations, configuration_name);
+    configuration.MarkDirty();
 
     this->available_configurations.push_back(configuration);
     this->SortConfigurations();
@@ -279,6 +314,7 @@ void ConfigurationManager::ImportConfiguration(const std::vector<Layer> &availab
     }
 
     configuration.key = MakeConfigurationName(this->available_configurations, configuration.key + " (Imported)");
+    configuration.MarkDirty();
     this->available_configurations.push_back(configuration);
     this->SortConfigurations();
     SetActiveConfiguration(available_layers, configuration.key.c_str());
@@ -79,7 +79,7 @@ class ConfigurationManager {
 
     void RemoveConfigurationFiles();
 
-    void LoadConfigurationsPath(const std::vector<Layer>& available_layers, const char* path);
+    void LoadConfigurationFiles(const std::vector<Layer>& available_layers, const std::vector<std::string>& paths);
     void LoadDefaultConfigurations(const std::vector<Layer>& available_layers);
 
     Configuration* active_configuration;
@@ -23,6 +23,14 @@
 #include "override.h"
 
 #include <QFileInfo>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
 
 static std::string BuildPlatformsHtml(int platform_flags) {
     std::string text;
@@ -277,8 +285,21 @@ size_t GetNumSettings(const Layer& layer) {
     return rval;
 }
 
-void ExportHtmlDoc(const Layer& layer, const std::string& path) {
+// Most of the text is written per setting, reserving the buffer upfront avoids most of the reallocations
+static std::size_t EstimateDocSize(const Layer& layer) { return 4096 + GetNumSettings(layer) * 2048 + layer.presets.size() * 1024; }
+
+static bool WriteDocFile(const std::string& text, const std::string& path) {
+    QFile file(path.c_str());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+
+    file.write(text.c_str(), static_cast<qint64>(text.size()));
+    file.close();
+    return true;
+}
+
+static std::string BuildHtmlDoc(const Layer& layer) {
     std::string text;
+    text.reserve(EstimateDocSize(layer));
 
     text += "<!DOCTYPE html>\n";
     text += "<html>\n";
@@ -377,18 +398,12 @@ void ExportHtmlDoc(const Layer& layer, const std::string& path) {
     text += "</body>\n";
     text += "</html>\n";
 
-    QFile file(path.c_str());
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        file.write(text.c_str());
-        file.close();
-        printf("vkconfig: html file written to %s\n", path.c_str());
-    } else {
-        printf("vkconfig: could not write %s\n", path.c_str());
-    }
+    return text;
 }
 
-void ExportMarkdownDoc(const Layer& layer, const std::string& path) {
+static std::string BuildMarkdownDoc(const Layer& layer) {
     std::string text;
+    text.reserve(EstimateDocSize(layer));
 
     text += format("## %s\n", layer.key.c_str());
 
@@ -449,16 +464,145 @@ void ExportMarkdownDoc(const Layer& layer, const std::string& path) {
         }
     }
 
-    QFile file(path.c_str());
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        file.write(text.c_str());
-        file.close();
+    return text;
+}
+
+void ExportHtmlDoc(const Layer& layer, const std::string& path) {
+    if (WriteDocFile(BuildHtmlDoc(layer), path)) {
+        printf("vkconfig: html file written to %s\n", path.c_str());
+    } else {
+        printf("vkconfig: could not write %s\n", path.c_str());
+    }
+}
+
+void ExportMarkdownDoc(const Layer& layer, const std::string& path) {
+    if (WriteDocFile(BuildMarkdownDoc(layer), path)) {
         printf("vkconfig: markdown file written to %s\n", path.c_str());
     } else {
         printf("vkconfig: could not write %s\n", path.c_str());
     }
 }
 
+// Increment when the generated documentation changes, so that all the layers are exported again
+static const int DOC_CACHE_VERSION = 1;
+
+static std::string GetManifestHash(const std::string& manifest_path) {
+    QFile file(manifest_path.c_str());
+    if (!file.open(QIODevice::ReadOnly)) return std::string();
+
+    const QByteArray& hash = QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha1);
+    return QString(hash.toHex()).toStdString();
+}
+
+static QJsonObject LoadDocCache(const std::string& cache_path) {
+    QFile file(cache_path.c_str());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return QJsonObject();
+
+    const QJsonDocument& json_doc = QJsonDocument::fromJson(file.readAll());
+    if (!json_doc.isObject()) return QJsonObject();
+
+    const QJsonObject& json_root_object = json_doc.object();
+    if (json_root_object.value("version").toInt() != DOC_CACHE_VERSION) return QJsonObject();
+    if (json_root_object.value("vkconfig").toString().toStdString() != Version::VKCONFIG.str()) return QJsonObject();
+
+    return json_root_object.value("layers").toObject();
+}
+
+int ExportAllDocs(const std::vector<Layer>& available_layers, const std::string& out_dir) {
+    const std::string cache_path = out_dir + "/vkconfig_doc_cache.json";
+    const QJsonObject& json_cached_layers = LoadDocCache(cache_path);
+
+    const std::size_t layer_count = available_layers.size();
+
+    // Looked up upfront, the worker threads only read standard containers
+    std::vector<std::string> cached_hashes(layer_count);
+    for (std::size_t i = 0; i < layer_count; ++i) {
+        cached_hashes[i] = json_cached_layers.value(available_layers[i].key.c_str()).toString().toStdString();
+    }
+
+    std::vector<std::string> hashes(layer_count);
+    std::vector<std::string> html_texts(layer_count);
+    std::vector<std::string> markdown_texts(layer_count);
+    std::unique_ptr<bool[]> skipped(new bool[layer_count]);
+    std::atomic<std::size_t> next_layer(0);
+
+    auto build = [&]() {
+        for (std::size_t i = next_layer++; i < layer_count; i = next_layer++) {
+            const Layer& layer = available_layers[i];
+
+            hashes[i] = GetManifestHash(layer.manifest_path);
+
+            const std::string& html_path = format("%s/%s.html", out_dir.c_str(), layer.key.c_str());
+            const std::string& markdown_path = format("%s/%s.md", out_dir.c_str(), layer.key.c_str());
+            skipped[i] = !hashes[i].empty() && hashes[i] == cached_hashes[i] && QFileInfo(html_path.c_str()).exists() &&
+                         QFileInfo(markdown_path.c_str()).exists();
+            if (skipped[i]) continue;
+
+            html_texts[i] = BuildHtmlDoc(layer);
+            markdown_texts[i] = BuildMarkdownDoc(layer);
+        }
+    };
+
+    const std::size_t thread_count = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), layer_count);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < thread_count; ++i) {
+        threads.push_back(std::thread(build));
+    }
+    build();
+    for (std::size_t i = 0, n = threads.size(); i < n; ++i) {
+        threads[i].join();
+    }
+
+    // The files are written in the layers order to keep the output of the command deterministic
+    int result = 0;
+    QJsonObject json_layers_object;
+    for (std::size_t i = 0; i < layer_count; ++i) {
+        const Layer& layer = available_layers[i];
+
+        if (skipped[i]) {
+            printf("vkconfig: %s documentation is up to date\n", layer.key.c_str());
+            json_layers_object.insert(layer.key.c_str(), hashes[i].c_str());
+            continue;
+        }
+
+        const std::string& html_path = format("%s/%s.html", out_dir.c_str(), layer.key.c_str());
+        const std::string& markdown_path = format("%s/%s.md", out_dir.c_str(), layer.key.c_str());
+
+        const bool html_written = WriteDocFile(html_texts[i], html_path);
+        if (html_written) {
+            printf("vkconfig: html file written to %s\n", html_path.c_str());
+        } else {
+            printf("vkconfig: could not write %s\n", html_path.c_str());
+        }
+
+        const bool markdown_written = WriteDocFile(markdown_texts[i], markdown_path);
+        if (markdown_written) {
+            printf("vkconfig: markdown file written to %s\n", markdown_path.c_str());
+        } else {
+            printf("vkconfig: could not write %s\n", markdown_path.c_str());
+        }
+
+        // A layer which files couldn't be written is exported again by the next run
+        if (html_written && markdown_written) {
+            json_layers_object.insert(layer.key.c_str(), hashes[i].c_str());
+        } else {
+            result = -1;
+        }
+    }
+
+    QJsonObject json_root_object;
+    json_root_object.insert("version", DOC_CACHE_VERSION);
+    json_root_object.insert("vkconfig", Version::VKCONFIG.str().c_str());
+    json_root_object.insert("layers", json_layers_object);
+
+    QJsonDocument doc(json_root_object);
+    if (!WriteDocFile(doc.toJson().toStdString(), cache_path)) {
+        printf("vkconfig: could not write %s\n", cache_path.c_str());
+    }
+
+    return result;
+}
+
 void ExportSettingsDoc(const std::vector<Layer>& available_layers, const Configuration& configuration, const std::string& path) {
     if (WriteSettingsOverride(available_layers, configuration, path))
         printf("vkconfig: settings written to %s\n", path.c_str());
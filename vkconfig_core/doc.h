@@ -27,5 +27,9 @@ void ExportHtmlDoc(const Layer& layer, const std::string& path);
 
 void ExportMarkdownDoc(const Layer& layer, const std::string& path);
 
+// Export the html and markdown documentation of all the layers, skipping the layers which manifest didn't change
+// since the previous export to the same directory. Returns 0 on success.
+int ExportAllDocs(const std::vector<Layer>& available_layers, const std::string& out_dir);
+
 void ExportSettingsDoc(const std::vector<Layer>& available_layers,
                        const Configuration& configuration, const std::string& path);
@@ -35,6 +35,10 @@
 #include <QTextStream>
 
 #include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
 
 // Saved settings for the application
 #define VKCONFIG_KEY_INITIALIZE_FILES "FirstTimeRun"
@@ -180,6 +184,7 @@ void Environment::Reset(ResetMode mode) {
                 loader_message_level = GetLoaderDebug(loader_debug_message);
             }
             settings.setValue(VKCONFIG_KEY_LOADER_MESSAGE, static_cast<int>(loader_message_level));
+            this->stored_values[VKCONFIG_KEY_LOADER_MESSAGE] = static_cast<int>(loader_message_level);
             break;
         }
         case SYSTEM: {
@@ -250,6 +255,16 @@ bool Environment::Load() {
         this->user_defined_layers_paths[USER_DEFINED_LAYERS_PATHS_ENV_ADD].clear();
     }
 
+    // Only the values that differ from the ones in QSettings are saved. The version is saved once vkconfig is updated.
+    this->stored_values.clear();
+    const std::vector<std::pair<std::string, QVariant> >& values = GetSettingsValues();
+    for (std::size_t i = 0, n = values.size(); i < n; ++i) {
+        if (settings.contains(values[i].first.c_str())) this->stored_values[values[i].first] = values[i].second;
+    }
+    if (settings.contains(VKCONFIG_KEY_VKCONFIG_VERSION)) {
+        this->stored_values[VKCONFIG_KEY_VKCONFIG_VERSION] = settings.value(VKCONFIG_KEY_VKCONFIG_VERSION).toString();
+    }
+
     // Load application list
     const bool result = LoadApplications();
     assert(result);
@@ -261,7 +276,8 @@ bool Environment::LoadApplications() {
     const std::string& application_list_json = GetPath(BUILTIN_PATH_APPLIST);
     QFile file(application_list_json.c_str());
     if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {  // if applist.json exist, load saved applications
-        QString data = file.readAll();
+        this->stored_applications = file.readAll();
+        QString data = this->stored_applications;
         file.close();
 
         applications.clear();
@@ -310,33 +326,50 @@ bool Environment::LoadApplications() {
     return true;
 }
 
-bool Environment::Save() const {
-    QSettings settings;
+std::vector<std::pair<std::string, QVariant> > Environment::GetSettingsValues() const {
+    std::vector<std::pair<std::string, QVariant> > values;
 
     // Save 'first_run'
-    settings.setValue(VKCONFIG_KEY_INITIALIZE_FILES, first_run);
+    values.push_back(std::make_pair(VKCONFIG_KEY_INITIALIZE_FILES, QVariant(first_run)));
 
     // Save 'version'
-    settings.setValue(VKCONFIG_KEY_VKCONFIG_VERSION, Version::LAYER_CONFIG.str().c_str());
+    values.push_back(std::make_pair(VKCONFIG_KEY_VKCONFIG_VERSION, QVariant(Version::LAYER_CONFIG.str().c_str())));
 
     // Save 'override_mode'
-    settings.setValue(VKCONFIG_KEY_OVERRIDE_MODE, override_state);
+    values.push_back(std::make_pair(VKCONFIG_KEY_OVERRIDE_MODE, QVariant(static_cast<int>(override_state))));
 
     // Save 'loader_message'
-    settings.setValue(VKCONFIG_KEY_LOADER_MESSAGE, static_cast<int>(loader_message_level));
+    values.push_back(std::make_pair(VKCONFIG_KEY_LOADER_MESSAGE, QVariant(static_cast<int>(loader_message_level))));
 
     // Save active state
     for (std::size_t i = 0; i < ACTIVE_COUNT; ++i) {
-        settings.setValue(GetActiveToken(static_cast<Active>(i)), actives[i].c_str());
+        values.push_back(std::make_pair(GetActiveToken(static_cast<Active>(i)), QVariant(actives[i].c_str())));
     }
 
     // Save layout state
     for (std::size_t i = 0; i < LAYOUT_COUNT; ++i) {
-        settings.setValue(GetLayoutStateToken(static_cast<LayoutState>(i)), layout_states[i]);
+        values.push_back(std::make_pair(GetLayoutStateToken(static_cast<LayoutState>(i)), QVariant(layout_states[i])));
     }
 
     // Save default configuration initizalized
-    settings.setValue("default_configuration_files", ConvertString(this->default_configuration_filenames));
+    values.push_back(std::make_pair("default_configuration_files", QVariant(ConvertString(this->default_configuration_filenames))));
+
+    return values;
+}
+
+bool Environment::Save() {
+    const std::vector<std::pair<std::string, QVariant> >& values = GetSettingsValues();
+
+    // On Windows, each value is a registry write, and on Linux the whole file is written again
+    std::unique_ptr<QSettings> settings;
+    for (std::size_t i = 0, n = values.size(); i < n; ++i) {
+        auto it = this->stored_values.find(values[i].first);
+        if (it != this->stored_values.end() && it->second == values[i].second) continue;
+
+        if (settings == nullptr) settings.reset(new QSettings);
+        settings->setValue(values[i].first.c_str(), values[i].second);
+        this->stored_values[values[i].first] = values[i].second;
+    }
 
     const bool result = SaveApplications();
     assert(result);
@@ -344,7 +377,7 @@ bool Environment::Save() const {
     return true;
 }
 
-bool Environment::SaveApplications() const {
+bool Environment::SaveApplications() {
     QJsonObject root;
 
     for (std::size_t i = 0, n = applications.size(); i < n; ++i) {
@@ -364,16 +397,20 @@ bool Environment::SaveApplications() const {
         root.insert(QFileInfo(applications[i].app_name.c_str()).fileName(), application_object);
     }
 
+    const QByteArray& data = QJsonDocument(root).toJson();
+    if (data == this->stored_applications) return true;
+
     const std::string& app_list_json = GetPath(BUILTIN_PATH_APPLIST);
     assert(QFileInfo(app_list_json.c_str()).absoluteDir().exists());
 
     QFile file(app_list_json.c_str());
     const bool result = file.open(QIODevice::WriteOnly | QIODevice::Text);
     assert(result);
-    QJsonDocument doc(root);
-    file.write(doc.toJson());
+    file.write(data);
     file.close();
 
+    this->stored_applications = data;
+
     return true;
 }
 
@@ -652,16 +689,36 @@ std::vector<Application> Environment::CreateDefaultApplications() const {
 }
 
 std::vector<Application> Environment::RemoveMissingApplications(const std::vector<Application>& applications) const {
-    std::vector<Application> valid_applications;
+    const std::size_t application_count = applications.size();
+    if (application_count == 0) return applications;
 
-    // Remove applications that can't be found
-    for (std::size_t i = 0, n = applications.size(); i < n; ++i) {
-        const Application& application = applications[i];
+    // The executables may be on slow or unreachable network drives, so they are checked concurrently
+    std::unique_ptr<bool[]> found(new bool[application_count]);
+    std::atomic<std::size_t> next_application(0);
+
+    auto check = [&]() {
+        for (std::size_t i = next_application++; i < application_count; i = next_application++) {
+            found[i] = QFileInfo(applications[i].executable_path.c_str()).exists();
+        }
+    };
 
-        const QFileInfo file_info(application.executable_path.c_str());
-        if (!file_info.exists()) continue;
+    const std::size_t thread_count =
+        std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), application_count);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < thread_count; ++i) {
+        threads.push_back(std::thread(check));
+    }
+    check();
+    for (std::size_t i = 0, n = threads.size(); i < n; ++i) {
+        threads[i].join();
+    }
+
+    // Remove applications that can't be found, the list order is preserved
+    std::vector<Application> valid_applications;
+    for (std::size_t i = 0; i < application_count; ++i) {
+        if (!found[i]) continue;
 
-        valid_applications.push_back(application);
+        valid_applications.push_back(applications[i]);
     }
 
     return valid_applications;
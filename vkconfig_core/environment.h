@@ -25,10 +25,13 @@
 #include "path_manager.h"
 
 #include <QByteArray>
+#include <QVariant>
 
 #include <array>
+#include <map>
 #include <vector>
 #include <string>
+#include <utility>
 
 enum OverrideFlag { OVERRIDE_FLAG_ACTIVE = (1 << 0), OVERRIDE_FLAG_SELECTED = (1 << 1), OVERRIDE_FLAG_PERSISTENT = (1 << 2) };
 
@@ -113,8 +116,9 @@ class Environment {
 
     bool Load();
     bool LoadApplications();
-    bool Save() const;
-    bool SaveApplications() const;
+    // Only the values that changed since they were last loaded or saved are written, so it may be called frequently
+    bool Save();
+    bool SaveApplications();
 
     void SelectActiveApplication(std::size_t application_index);
     int GetActiveApplicationIndex() const;
@@ -178,6 +182,13 @@ class Environment {
 
     PathManager& paths_manager;
 
+    // The values as last loaded from or saved to QSettings, by key, and the application list file
+    std::map<std::string, QVariant> stored_values;
+    QByteArray stored_applications;
+
+    // The values saved to QSettings, by key
+    std::vector<std::pair<std::string, QVariant> > GetSettingsValues() const;
+
     std::vector<std::string> default_configuration_filenames;
 
     // Update default applications path to use relative path (really useful only on Windows)
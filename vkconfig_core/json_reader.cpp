@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "json_reader.h"
+
+#include <cassert>
+#include <cstring>
+
+JsonReader::JsonReader(const char* text, std::size_t size) : text(text), size(size), offset(0), error(false) {
+    assert(text != nullptr || size == 0);
+
+    // Skip the UTF-8 byte order mark, like QJsonDocument
+    static const char BOM[] = "\xEF\xBB\xBF";
+    if (size >= 3 && std::memcmp(text, BOM, 3) == 0) {
+        this->offset = 3;
+    }
+}
+
+bool JsonReader::Fail() {
+    this->error = true;
+    return false;
+}
+
+void JsonReader::SkipWhitespace() {
+    while (this->offset < this->size) {
+        const char c = this->text[this->offset];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+        ++this->offset;
+    }
+}
+
+bool JsonReader::Expect(char c) {
+    this->SkipWhitespace();
+    if (this->offset >= this->size || this->text[this->offset] != c) return this->Fail();
+
+    ++this->offset;
+    return true;
+}
+
+JsonType JsonReader::Peek() {
+    if (this->error) return JSON_TYPE_NONE;
+
+    this->SkipWhitespace();
+    if (this->offset >= this->size) return JSON_TYPE_NONE;
+
+    switch (this->text[this->offset]) {
+        case '{':
+            return JSON_TYPE_OBJECT;
+        case '[':
+            return JSON_TYPE_ARRAY;
+        case '"':
+            return JSON_TYPE_STRING;
+        case 't':
+        case 'f':
+        case 'n':
+            return JSON_TYPE_LITERAL;
+        case '-':
+            return JSON_TYPE_NUMBER;
+        default:
+            return this->text[this->offset] >= '0' && this->text[this->offset] <= '9' ? JSON_TYPE_NUMBER : JSON_TYPE_NONE;
+    }
+}
+
+bool JsonReader::BeginObject() {
+    if (this->error) return false;
+    if (this->scopes.size() >= MAX_DEPTH) return this->Fail();
+    if (!this->Expect('{')) return false;
+
+    this->scopes.push_back(true);
+    return true;
+}
+
+bool JsonReader::BeginArray() {
+    if (this->error) return false;
+    if (this->scopes.size() >= MAX_DEPTH) return this->Fail();
+    if (!this->Expect('[')) return false;
+
+    this->scopes.push_back(true);
+    return true;
+}
+
+bool JsonReader::NextItem(char close) {
+    if (this->error) return false;
+    assert(!this->scopes.empty());
+
+    this->SkipWhitespace();
+    if (this->offset >= this->size) return this->Fail();
+
+    if (this->text[this->offset] == close) {
+        ++this->offset;
+        this->scopes.pop_back();
+        return false;
+    }
+
+    if (this->scopes.back()) {
+        this->scopes.back() = false;
+    } else if (!this->Expect(',')) {
+        return false;
+    }
+
+    return true;
+}
+
+bool JsonReader::NextMember(std::string& key) {
+    if (!this->NextItem('}')) return false;
+    if (!this->ReadString(key)) return false;
+
+    return this->Expect(':');
+}
+
+bool JsonReader::NextElement() { return this->NextItem(']'); }
+
+bool JsonReader::ReadHex(unsigned& code) {
+    if (this->offset + 4 > this->size) return this->Fail();
+
+    code = 0;
+    for (std::size_t i = 0; i < 4; ++i) {
+        const char c = this->text[this->offset++];
+        code <<= 4;
+        if (c >= '0' && c <= '9') {
+            code |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            code |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            code |= c - 'A' + 10;
+        } else {
+            return this->Fail();
+        }
+    }
+
+    return true;
+}
+
+bool JsonReader::ReadString(std::string& value) {
+    if (this->error) return false;
+    if (!this->Expect('"')) return false;
+
+    value.clear();
+
+    while (this->offset < this->size) {
+        const char c = this->text[this->offset++];
+
+        if (c == '"') return true;
+        if (static_cast<unsigned char>(c) < 0x20) return this->Fail();
+
+        if (c != '\\') {
+            value += c;
+            continue;
+        }
+
+        if (this->offset >= this->size) return this->Fail();
+
+        switch (this->text[this->offset++]) {
+            case '"':
+                value += '"';
+                break;
+            case '\\':
+                value += '\\';
+                break;
+            case '/':
+                value += '/';
+                break;
+            case 'b':
+                value += '\b';
+                break;
+            case 'f':
+                value += '\f';
+                break;
+            case 'n':
+                value += '\n';
+                break;
+            case 'r':
+                value += '\r';
+                break;
+            case 't':
+                value += '\t';
+                break;
+            case 'u': {
+                unsigned code = 0;
+                if (!this->ReadHex(code)) return false;
+
+                // A surrogate pair encodes the code points above the basic multilingual plane
+                if (code >= 0xD800 && code <= 0xDBFF && this->offset + 1 < this->size && this->text[this->offset] == '\\' &&
+                    this->text[this->offset + 1] == 'u') {
+                    this->offset += 2;
+
+                    unsigned low = 0;
+                    if (!this->ReadHex(low)) return false;
+                    if (low < 0xDC00 || low > 0xDFFF) return this->Fail();
+
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+
+                if (code < 0x80) {
+                    value += static_cast<char>(code);
+                } else if (code < 0x800) {
+                    value += static_cast<char>(0xC0 | (code >> 6));
+                    value += static_cast<char>(0x80 | (code & 0x3F));
+                } else if (code < 0x10000) {
+                    value += static_cast<char>(0xE0 | (code >> 12));
+                    value += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    value += static_cast<char>(0x80 | (code & 0x3F));
+                } else {
+                    value += static_cast<char>(0xF0 | (code >> 18));
+                    value += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                    value += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    value += static_cast<char>(0x80 | (code & 0x3F));
+                }
+            } break;
+            default:
+                return this->Fail();
+        }
+    }
+
+    return this->Fail();
+}
+
+bool JsonReader::SkipNumber() {
+    const std::size_t begin = this->offset;
+
+    if (this->offset < this->size && this->text[this->offset] == '-') ++this->offset;
+
+    std::size_t digits = 0;
+    while (this->offset < this->size && this->text[this->offset] >= '0' && this->text[this->offset] <= '9') {
+        ++this->offset;
+        ++digits;
+    }
+    if (digits == 0) return this->Fail();
+
+    if (this->offset < this->size && this->text[this->offset] == '.') {
+        ++this->offset;
+
+        digits = 0;
+        while (this->offset < this->size && this->text[this->offset] >= '0' && this->text[this->offset] <= '9') {
+            ++this->offset;
+            ++digits;
+        }
+        if (digits == 0) return this->Fail();
+    }
+
+    if (this->offset < this->size && (this->text[this->offset] == 'e' || this->text[this->offset] == 'E')) {
+        ++this->offset;
+        if (this->offset < this->size && (this->text[this->offset] == '+' || this->text[this->offset] == '-')) ++this->offset;
+
+        digits = 0;
+        while (this->offset < this->size && this->text[this->offset] >= '0' && this->text[this->offset] <= '9') {
+            ++this->offset;
+            ++digits;
+        }
+        if (digits == 0) return this->Fail();
+    }
+
+    return this->offset > begin;
+}
+
+bool JsonReader::SkipLiteral() {
+    static const char* literals[] = {"true", "false", "null"};
+
+    for (std::size_t i = 0, n = sizeof(literals) / sizeof(literals[0]); i < n; ++i) {
+        const std::size_t length = std::strlen(literals[i]);
+        if (this->offset + length <= this->size && std::memcmp(this->text + this->offset, literals[i], length) == 0) {
+            this->offset += length;
+            return true;
+        }
+    }
+
+    return this->Fail();
+}
+
+bool JsonReader::SkipValue() {
+    switch (this->Peek()) {
+        case JSON_TYPE_OBJECT: {
+            if (!this->BeginObject()) return false;
+
+            std::string key;
+            while (this->NextMember(key)) {
+                if (!this->SkipValue()) return false;
+            }
+            return !this->error;
+        }
+        case JSON_TYPE_ARRAY: {
+            if (!this->BeginArray()) return false;
+
+            while (this->NextElement()) {
+                if (!this->SkipValue()) return false;
+            }
+            return !this->error;
+        }
+        case JSON_TYPE_STRING: {
+            std::string value;
+            return this->ReadString(value);
+        }
+        case JSON_TYPE_NUMBER:
+            return this->SkipNumber();
+        case JSON_TYPE_LITERAL:
+            return this->SkipLiteral();
+        default:
+            return this->Fail();
+    }
+}
+
+bool JsonReader::Skip() {
+    if (this->error) return false;
+
+    return this->SkipValue();
+}
+
+bool JsonReader::End() {
+    if (this->error) return false;
+    if (!this->scopes.empty()) return this->Fail();
+
+    this->SkipWhitespace();
+    if (this->offset != this->size) return this->Fail();
+
+    return true;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+enum JsonType { JSON_TYPE_NONE = 0, JSON_TYPE_OBJECT, JSON_TYPE_ARRAY, JSON_TYPE_STRING, JSON_TYPE_NUMBER, JSON_TYPE_LITERAL };
+
+// Streaming reader of a JSON text, which reads the values in the order of the text without building a document. The values
+// which are not needed are skipped, their syntax is still checked. After an error, every function returns false.
+class JsonReader {
+   public:
+    JsonReader(const char* text, std::size_t size);
+
+    // The type of the next value, JSON_TYPE_NONE on a syntax error
+    JsonType Peek();
+
+    // To call with the next value being an object, then NextMember, followed by reading or skipping the member value,
+    // until it returns false at the end of the object
+    bool BeginObject();
+    bool NextMember(std::string& key);
+
+    // To call with the next value being an array, then NextElement, followed by reading or skipping the element,
+    // until it returns false at the end of the array
+    bool BeginArray();
+    bool NextElement();
+
+    bool ReadString(std::string& value);
+    bool Skip();
+
+    // Returns true when the whole text was read without error
+    bool End();
+
+    bool HasError() const { return this->error; }
+
+    // The offset of the next character to read
+    std::size_t Offset() const { return this->offset; }
+
+   private:
+    enum { MAX_DEPTH = 1024 };  // Like QJsonDocument
+
+    void SkipWhitespace();
+    bool Expect(char c);
+    bool Fail();
+    bool SkipNumber();
+    bool SkipLiteral();
+    bool SkipValue();
+    bool NextItem(char close);
+    bool ReadHex(unsigned& code);
+
+    const char* text;
+    std::size_t size;
+    std::size_t offset;
+    std::vector<bool> scopes;  // For each object or array being read, whether its next member or element is the first
+    bool error;
+};
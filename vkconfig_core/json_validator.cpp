@@ -20,11 +20,11 @@
 
 #include "json_validator.h"
 #include "json.h"
+#include "profiler.h"
 #include "util.h"
 
-#include <QJsonDocument>
-
 #include <iostream>
+#include <memory>
 
 #ifndef JSON_VALIDATION_OFF
 
@@ -40,35 +40,35 @@ using valijson::ValidationResults;
 using valijson::Validator;
 using valijson::adapters::QtJsonAdapter;
 
-static std::unique_ptr<Schema> schema;
-static std::unique_ptr<Validator> validator;
-
-JsonValidator::JsonValidator() {}
-
-bool JsonValidator::Check(const QString &json_data) {
-    assert(!json_data.isEmpty());
-
-    if (!schema) {
+// Compiled on first use, the initialization of the static is thread safe. The schema is only read by validations.
+static const Schema &GetSchema() {
+    static const std::unique_ptr<Schema> schema([] {
         const QJsonDocument schema_document = ParseJsonFile(":/layers/schema.json");
 
-        schema.reset(new Schema);
+        std::unique_ptr<Schema> schema(new Schema);
 
         SchemaParser parser;
         QtJsonAdapter schema_adapter(schema_document.object());
         parser.populateSchema(schema_adapter, *schema);
-    }
+        return schema;
+    }());
+
+    return *schema;
+}
+
+JsonValidator::JsonValidator() {}
+
+bool JsonValidator::Check(const QJsonDocument &json_document) {
+    assert(!json_document.isNull());
+    ScopedTimer timer("JsonValidator::Check");
 
-    QJsonParseError json_parse_error;
-    const QJsonDocument json_document = QJsonDocument::fromJson(json_data.toUtf8(), &json_parse_error);
-    if (json_parse_error.error != QJsonParseError::NoError) {
-        return false;
-    }
 
+    // The Validator keeps per validation state (regex cache, ...), one is created per check
     Validator validator(Validator::kWeakTypes);
     QtJsonAdapter document_adapter(json_document.object());
 
     ValidationResults results;
-    if (!validator.validate(*schema, document_adapter, &results)) {
+    if (!validator.validate(GetSchema(), document_adapter, &results)) {
         ValidationResults::Error error;
         unsigned int error_num = 1;
         while (results.popError(error)) {
@@ -101,8 +101,8 @@ bool JsonValidator::Check(const QString &json_data) {
 
 JsonValidator::JsonValidator() {}
 
-bool JsonValidator::Check(const QString &json_data) {
-    (void)json_data;
+bool JsonValidator::Check(const QJsonDocument &json_document) {
+    (void)json_document;
 
     return true;
 }
@@ -21,10 +21,13 @@
 #pragma once
 
 #include <QString>
+#include <QJsonDocument>
 
+// The layers JSON schema is compiled once and shared, so manifests may be checked by several threads at once
 struct JsonValidator {
     JsonValidator();
 
-    bool Check(const QString& json_data);
+    // Validates a document already parsed by the caller against the layers JSON schema
+    bool Check(const QJsonDocument& json_document);
     QString message;
 };
@@ -33,6 +33,7 @@
 #include "util.h"
 #include "path.h"
 #include "json.h"
+#include "json_reader.h"
 #include "json_validator.h"
 #include "alert.h"
 
@@ -42,9 +43,45 @@
 #include <QJsonArray>
 
 #include <cassert>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <algorithm>
 
+static bool layer_interface_data_enabled = true;
+
+struct BuiltinLayer {
+    BuiltinLayer() : loaded(false) {}
+
+    std::once_flag load_flag;
+    bool loaded;
+    Layer layer;
+};
+
+// The built-in definitions of the old layers are loaded at most once per process, the first time a layer needs one, and
+// shared by all the layers using them. Like the settings of layer copies, the shared settings are never modified.
+static const Layer* GetBuiltinLayer(const std::string& path, LayerType layer_type) {
+    static std::mutex builtin_layers_mutex;
+    static std::map<std::pair<std::string, bool>, std::unique_ptr<BuiltinLayer> > builtin_layers;
+
+    BuiltinLayer* builtin_layer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(builtin_layers_mutex);
+        std::unique_ptr<BuiltinLayer>& entry = builtin_layers[std::make_pair(path, layer_interface_data_enabled)];
+        if (entry == nullptr) entry.reset(new BuiltinLayer);
+        builtin_layer = entry.get();
+    }
+
+    // Layers are loaded by several threads: the first one loads the definition while the others wait for it
+    std::call_once(builtin_layer->load_flag, [&]() {
+        std::string invalid_message;  // The built-in files are only validated by debug builds
+        builtin_layer->loaded = builtin_layer->layer.Load(std::vector<Layer>(), path, layer_type, &invalid_message);
+    });
+
+    return builtin_layer->loaded ? &builtin_layer->layer : nullptr;
+}
+
 static std::string GetBuiltinFolder(const Version& version) {
     QDir dir(":/layers");
     dir.setFilter(QDir::Dirs);
@@ -75,10 +112,11 @@ static std::string GetBuiltinFolder(const Version& version) {
 
 const char* Layer::NO_PRESET = "User-Defined Settings";
 
-Layer::Layer() : status(STATUS_STABLE), platforms(PLATFORM_DESKTOP_BIT), type(LAYER_TYPE_EXPLICIT) {}
+Layer::Layer()
+    : status(STATUS_STABLE), platforms(PLATFORM_DESKTOP_BIT), type(LAYER_TYPE_EXPLICIT), memory(std::make_shared<SettingArena>()) {}
 
 Layer::Layer(const std::string& key, const LayerType layer_type)
-    : key(key), status(STATUS_STABLE), platforms(PLATFORM_DESKTOP_BIT), type(layer_type) {}
+    : key(key), status(STATUS_STABLE), platforms(PLATFORM_DESKTOP_BIT), type(layer_type), memory(std::make_shared<SettingArena>()) {}
 
 Layer::Layer(const std::string& key, const LayerType layer_type, const Version& file_format_version, const Version& api_version,
              const std::string& implementation_version, const std::string& library_path)
@@ -89,7 +127,8 @@ Layer::Layer(const std::string& key, const LayerType layer_type, const Version&
       implementation_version(implementation_version),
       status(STATUS_STABLE),
       platforms(PLATFORM_DESKTOP_BIT),
-      type(layer_type) {}
+      type(layer_type),
+      memory(std::make_shared<SettingArena>()) {}
 
 // Todo: Load the layer with Vulkan API
 bool Layer::IsValid() const {
@@ -98,11 +137,16 @@ bool Layer::IsValid() const {
 }
 
 std::string Layer::FindPresetLabel(const SettingDataSet& settings) const {
-    for (std::size_t i = 0, n = this->presets.size(); i < n; ++i) {
-        if (HasPreset(settings, this->presets[i].settings)) return this->presets[i].label;
-    }
+    const LayerPresetTracker tracker(this->presets, settings);
+
+    const LayerPreset* preset = tracker.FindPreset();
+    return preset != nullptr ? preset->label : NO_PRESET;
+}
 
-    return NO_PRESET;
+template <typename T>
+SettingMeta* Layer::CreateSettingMeta(const std::string& key) {
+    void* storage = this->memory->Allocate(sizeof(T), alignof(T));
+    return this->memory->Track(new (storage) T(*this, key));
 }
 
 SettingMeta* Layer::Instantiate(SettingMetaSet& meta_set, const std::string& key, const SettingType type) {
@@ -110,43 +154,43 @@ SettingMeta* Layer::Instantiate(SettingMetaSet& meta_set, const std::string& key
 
     switch (type) {
         case SETTING_STRING:
-            setting_meta = new SettingMetaString(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaString>(key);
             break;
         case SETTING_INT:
-            setting_meta = new SettingMetaInt(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaInt>(key);
             break;
         case SETTING_FLOAT:
-            setting_meta = new SettingMetaFloat(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaFloat>(key);
             break;
         case SETTING_GROUP:
-            setting_meta = new SettingMetaGroup(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaGroup>(key);
             break;
         case SETTING_SAVE_FILE:
-            setting_meta = new SettingMetaFileSave(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaFileSave>(key);
             break;
         case SETTING_LOAD_FILE:
-            setting_meta = new SettingMetaFileLoad(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaFileLoad>(key);
             break;
         case SETTING_SAVE_FOLDER:
-            setting_meta = new SettingMetaFolderSave(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaFolderSave>(key);
             break;
         case SETTING_BOOL:
-            setting_meta = new SettingMetaBool(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaBool>(key);
             break;
         case SETTING_BOOL_NUMERIC_DEPRECATED:
-            setting_meta = new SettingMetaBoolNumeric(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaBoolNumeric>(key);
             break;
         case SETTING_ENUM:
-            setting_meta = new SettingMetaEnum(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaEnum>(key);
             break;
         case SETTING_FLAGS:
-            setting_meta = new SettingMetaFlags(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaFlags>(key);
             break;
         case SETTING_FRAMES:
-            setting_meta = new SettingMetaFrames(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaFrames>(key);
             break;
         case SETTING_LIST:
-            setting_meta = new SettingMetaList(*this, key);
+            setting_meta = CreateSettingMeta<SettingMetaList>(key);
             break;
         default:
             assert(0);
@@ -154,13 +198,111 @@ SettingMeta* Layer::Instantiate(SettingMetaSet& meta_set, const std::string& key
     }
 
     assert(setting_meta != nullptr);
-    this->memory.push_back(std::shared_ptr<SettingMeta>(setting_meta));
     meta_set.push_back(setting_meta);
     return setting_meta;
 }
 
 /// Reports errors via a message box. This might be a bad idea?
-bool Layer::Load(const std::vector<Layer>& available_layers, const std::string& full_path_to_file, LayerType layer_type) {
+static void ReportInvalidLayer(const std::string& full_path_to_file, const std::string& message, std::string* invalid_message) {
+    if (invalid_message != nullptr) {
+        *invalid_message = message;
+    } else {
+        Alert::LayerInvalid(full_path_to_file.c_str(), message.c_str());
+    }
+}
+
+// The values of a layer manifest other than its features
+struct LayerManifestHeader {
+    LayerManifestHeader() : has_file_format_version(false), has_layer(false), has_platforms(false), features_size(0) {}
+
+    bool has_file_format_version;
+    bool has_layer;
+    std::string file_format_version;
+    std::map<std::string, std::string> layer_strings;  // The values which aren't strings are read as empty strings
+    bool has_platforms;
+    std::vector<std::string> platforms;
+    std::size_t features_offset;
+    std::size_t features_size;  // 0 when the manifest has no features
+};
+
+// Reads the manifest header with a streaming reader, so that a JSON document is only built for the features of the layer or
+// for the validation of the manifest. The syntax of the whole manifest is checked.
+static bool ReadLayerManifestHeader(const QByteArray& json_text, LayerManifestHeader& header) {
+    JsonReader reader(json_text.constData(), static_cast<std::size_t>(json_text.size()));
+    if (reader.Peek() != JSON_TYPE_OBJECT) return false;
+
+    reader.BeginObject();
+
+    std::string root_key;
+    while (reader.NextMember(root_key)) {
+        if (root_key == "file_format_version") {
+            header.has_file_format_version = true;
+            if (reader.Peek() == JSON_TYPE_STRING) {
+                reader.ReadString(header.file_format_version);
+            } else {
+                reader.Skip();
+            }
+        } else if (root_key == "layer") {
+            header.has_layer = true;
+            if (reader.Peek() != JSON_TYPE_OBJECT) {
+                reader.Skip();
+                continue;
+            }
+
+            reader.BeginObject();
+
+            std::string layer_key;
+            while (reader.NextMember(layer_key)) {
+                if (layer_key == "features") {
+                    reader.Peek();
+                    header.features_offset = reader.Offset();
+                    reader.Skip();
+                    header.features_size = reader.Offset() - header.features_offset;
+                } else if (layer_key == "platforms") {
+                    header.has_platforms = true;
+                    header.platforms.clear();
+                    if (reader.Peek() != JSON_TYPE_ARRAY) {
+                        reader.Skip();
+                        continue;
+                    }
+
+                    reader.BeginArray();
+                    while (reader.NextElement()) {
+                        header.platforms.push_back(std::string());
+                        if (reader.Peek() == JSON_TYPE_STRING) {
+                            reader.ReadString(header.platforms.back());
+                        } else {
+                            reader.Skip();
+                        }
+                    }
+                } else if (reader.Peek() == JSON_TYPE_STRING) {
+                    reader.ReadString(header.layer_strings[layer_key]);
+                } else {
+                    header.layer_strings[layer_key].clear();
+                    reader.Skip();
+                }
+            }
+        } else {
+            reader.Skip();
+        }
+    }
+
+    return reader.End();
+}
+
+static const std::string& GetLayerString(const LayerManifestHeader& header, const char* key) {
+    static const std::string empty;
+
+    std::map<std::string, std::string>::const_iterator it = header.layer_strings.find(key);
+    return it != header.layer_strings.end() ? it->second : empty;
+}
+
+static bool HasLayerString(const LayerManifestHeader& header, const char* key) {
+    return header.layer_strings.find(key) != header.layer_strings.end();
+}
+
+bool Layer::Load(const std::vector<Layer>& available_layers, const std::string& full_path_to_file, LayerType layer_type,
+                 std::string* invalid_message, LayerManifestCache* cache) {
     this->type = layer_type;  // Set layer type, no way to know this from the json file
 
     if (full_path_to_file.empty()) return false;
@@ -170,43 +312,31 @@ bool Layer::Load(const std::vector<Layer>& available_layers, const std::string&
         return false;
     }
 
-    QString json_text = file.readAll();
+    const QByteArray json_text = file.readAll();
     file.close();
 
     this->manifest_path = full_path_to_file;
 
-    // Convert the text to a JSON document & validate it.
-    // It does need to be a valid json formatted file.
-    QJsonParseError json_parse_error;
-    const QJsonDocument& json_document = QJsonDocument::fromJson(json_text.toUtf8(), &json_parse_error);
-    if (json_parse_error.error != QJsonParseError::NoError) {
-        return false;
-    }
-
-    // Make sure it's not empty
-    if (json_document.isNull() || json_document.isEmpty()) {
+    // Check it's a valid JSON layer manifest, ignore otherwise
+    LayerManifestHeader header;
+    if (!ReadLayerManifestHeader(json_text, header)) {
         return false;
     }
-
-    // First check it's a layer manifest, ignore otherwise.
-    const QJsonObject& json_root_object = json_document.object();
-    if (json_root_object.value("file_format_version") == QJsonValue::Undefined) {
+    if (!header.has_file_format_version) {
         return false;  // Not a layer JSON file
     }
-    if (json_root_object.value("layer") == QJsonValue::Undefined) {
+    if (!header.has_layer) {
         return false;  // Not a layer JSON file
     }
 
-    this->file_format_version = ReadVersionValue(json_root_object, "file_format_version");
+    this->file_format_version = Version(header.file_format_version.c_str());
     if (this->file_format_version.GetMajor() > 1) {
-        Alert::LayerInvalid(full_path_to_file.c_str(),
-                            format("Unsupported layer file format: %s", this->file_format_version.str().c_str()).c_str());
+        ReportInvalidLayer(full_path_to_file, format("Unsupported layer file format: %s", this->file_format_version.str().c_str()),
+                           invalid_message);
         return false;
     }
 
-    const QJsonObject& json_layer_object = ReadObject(json_root_object, "layer");
-
-    this->key = ReadStringValue(json_layer_object, "name");
+    this->key = GetLayerString(header, "name");
 
     if (this->key == "VK_LAYER_LUNARG_override") {
         return false;
@@ -217,7 +347,7 @@ bool Layer::Load(const std::vector<Layer>& available_layers, const std::string&
         return false;
     }
 
-    this->api_version = ReadVersionValue(json_layer_object, "api_version");
+    this->api_version = Version(GetLayerString(header, "api_version").c_str());
 
     const bool is_builtin_layer_file =
         full_path_to_file.rfind(":/") == 0;  // Check whether the path start with ":/" for resource file paths.
@@ -228,48 +358,63 @@ bool Layer::Load(const std::vector<Layer>& available_layers, const std::string&
 #else
     const bool should_validate = !is_builtin_layer_file;
 #endif
-    const bool is_valid = should_validate ? validator.Check(json_text) : true;
+    bool is_valid = true;
+    if (should_validate) {
+        std::string validation_message;
+        if (cache != nullptr && cache->Find(full_path_to_file, is_valid, validation_message)) {
+            validator.message = validation_message.c_str();
+        } else {
+            // Only the validation needs a JSON document of the whole manifest
+            is_valid = validator.Check(QJsonDocument::fromJson(json_text));
+            if (cache != nullptr) cache->Record(full_path_to_file, is_valid, validator.message.toStdString());
+        }
+    }
 
-    const QJsonValue& json_library_path_value = json_layer_object.value("library_path");
-    if (json_library_path_value != QJsonValue::Undefined) {
-        this->binary_path = json_library_path_value.toString().toStdString();
+    if (HasLayerString(header, "library_path")) {
+        this->binary_path = GetLayerString(header, "library_path");
     }
 
-    this->implementation_version = ReadStringValue(json_layer_object, "implementation_version");
-    if (json_layer_object.value("status") != QJsonValue::Undefined) {
-        this->status = GetStatusType(ReadStringValue(json_layer_object, "status").c_str());
+    this->implementation_version = GetLayerString(header, "implementation_version");
+    if (HasLayerString(header, "status")) {
+        this->status = GetStatusType(GetLayerString(header, "status").c_str());
     }
-    if (json_layer_object.value("platforms") != QJsonValue::Undefined) {
-        this->platforms = GetPlatformFlags(ReadStringArray(json_layer_object, "platforms"));
+    if (header.has_platforms) {
+        this->platforms = GetPlatformFlags(header.platforms);
     }
-    this->description = ReadStringValue(json_layer_object, "description");
-    if (json_layer_object.value("introduction") != QJsonValue::Undefined) {
-        this->introduction = ReadStringValue(json_layer_object, "introduction");
+    this->description = GetLayerString(header, "description");
+    if (HasLayerString(header, "introduction")) {
+        this->introduction = GetLayerString(header, "introduction");
     }
-    if (json_layer_object.value("url") != QJsonValue::Undefined) {
-        this->url = ReadStringValue(json_layer_object, "url");
+    if (HasLayerString(header, "url")) {
+        this->url = GetLayerString(header, "url");
     }
 
     if (!is_valid && this->key != "VK_LAYER_LUNARG_override") {
         if (!is_builtin_layer_file || (is_builtin_layer_file && this->api_version >= Version(1, 2, 170))) {
-            Alert::LayerInvalid(full_path_to_file.c_str(), validator.message.toStdString().c_str());
+            ReportInvalidLayer(full_path_to_file, validator.message.toStdString(), invalid_message);
             return false;
         }
     }
 
-    const QJsonValue& json_features_value = json_layer_object.value("features");
-    if (json_features_value != QJsonValue::Undefined) {
-        const QJsonObject& json_features_object = json_features_value.toObject();
+    if (header.features_size > 0) {
+        // Only the features of the layer are converted to a JSON document
+        const QByteArray json_features_text =
+            QByteArray::fromRawData(json_text.constData() + header.features_offset, static_cast<int>(header.features_size));
+        const QJsonObject& json_features_object = QJsonDocument::fromJson(json_features_text).object();
 
         // Load layer settings
         const QJsonValue& json_settings_value = json_features_object.value("settings");
         if (json_settings_value != QJsonValue::Undefined) {
             AddSettingsSet(this->settings, nullptr, json_settings_value);
+
+            if (IsLayerInterfaceDataEnabled()) {
+                this->dependents = SettingDependents(this->settings);
+            }
         }
 
         // Load layer presets
         const QJsonValue& json_presets_value = json_features_object.value("presets");
-        if (json_presets_value != QJsonValue::Undefined) {
+        if (json_presets_value != QJsonValue::Undefined && IsLayerInterfaceDataEnabled()) {
             assert(json_presets_value.isArray());
             const QJsonArray& json_preset_array = json_presets_value.toArray();
             for (int preset_index = 0, preset_count = json_preset_array.size(); preset_index < preset_count; ++preset_index) {
@@ -295,21 +440,27 @@ bool Layer::Load(const std::vector<Layer>& available_layers, const std::string&
     if (!is_builtin_layer_file && this->api_version <= Version(1, 2, 176)) {
         const std::string path = GetBuiltinFolder(this->api_version) + "/" + this->key + ".json";
 
-        Layer default_layer;
-        if (default_layer.Load(available_layers, path, this->type)) {
-            this->introduction = default_layer.introduction;
-            this->url = default_layer.url;
-            this->platforms = default_layer.platforms;
-            this->status = default_layer.status;
-            std::swap(this->settings, default_layer.settings);
-            std::swap(this->presets, default_layer.presets);
-            this->memory = default_layer.memory;
+        const Layer* default_layer = GetBuiltinLayer(path, this->type);
+        if (default_layer != nullptr) {
+            this->introduction = default_layer->introduction;
+            this->url = default_layer->url;
+            this->platforms = default_layer->platforms;
+            this->status = default_layer->status;
+            this->settings = default_layer->settings;
+            this->presets = default_layer->presets;
+            this->dependents = default_layer->dependents;
+            this->memory = default_layer->memory;
         }
     }
 
     return this->IsValid();  // Not all JSON file are layer JSON valid
 }
 
+
+void EnableLayerInterfaceData(bool enabled) { layer_interface_data_enabled = enabled; }
+
+bool IsLayerInterfaceDataEnabled() { return layer_interface_data_enabled; }
+
 void CollectDefaultSettingData(const SettingMetaSet& meta_set, SettingDataSet& data_set) {
     for (std::size_t i = 0, n = meta_set.size(); i < n; ++i) {
         SettingMeta* setting_meta = meta_set[i];
@@ -25,6 +25,7 @@
 #include "layer_preset.h"
 #include "layer_type.h"
 #include "version.h"
+#include "layer_manifest_cache.h"
 
 #include <QObject>
 #include <QJsonDocument>
@@ -42,6 +43,10 @@ class Layer {
     Layer(const std::string& key, const LayerType layer_type, const Version& file_format_version, const Version& api_version,
           const std::string& implementation_version, const std::string& library_path);
 
+    // The settings are shared by the copies, vectors of layers move them when they grow
+    Layer(const Layer&) = default;
+    Layer(Layer&&) = default;
+
     bool IsValid() const;
 
     std::string FindPresetLabel(const SettingDataSet& settings) const;
@@ -65,17 +70,31 @@ class Layer {
     int platforms;
     std::string manifest_path;
     LayerType type;
-    QJsonDocument profile;
 
     std::vector<SettingMeta*> settings;
     std::vector<LayerPreset> presets;
 
-    bool Load(const std::vector<Layer>& available_layers, const std::string& full_path_to_file, LayerType layer_type);
+    // For each setting key, the settings depending on it. Only built with the layer interface data.
+    SettingDependents dependents;
+
+    // When invalid_message is set, an invalid manifest is reported there instead of with an alert, so that layers can be loaded
+    // from threads other than the GUI thread. When cache is set, the validation result of an unchanged manifest is reused.
+    bool Load(const std::vector<Layer>& available_layers, const std::string& full_path_to_file, LayerType layer_type,
+              std::string* invalid_message = nullptr, LayerManifestCache* cache = nullptr);
 
    private:
     Layer& operator=(const Layer&) = delete;
 
-    std::vector<std::shared_ptr<SettingMeta> > memory;  // Settings are deleted when all layers instances are deleted.
+    template <typename T>
+    SettingMeta* CreateSettingMeta(const std::string& key);
+
+    friend struct SettingMeta;
+    std::shared_ptr<SettingArena> memory;  // Settings are deleted when all layers instances are deleted.
 };
 
 void CollectDefaultSettingData(const SettingMetaSet& meta_set, SettingDataSet& data_set);
+
+// The command line modes don't display the layers, so the data only used by the GUI, the presets and the VUIDs listed by the
+// validation layer settings, are not loaded when disabled. Enabled by default.
+void EnableLayerInterfaceData(bool enabled);
+bool IsLayerInterfaceDataEnabled();
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "layer_cost.h"
+#include "platform.h"
+#include "util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+const char* LAYER_COST_MONITOR_NAME = "VK_LAYER_LUNARG_monitor";
+
+struct FrameRecord {
+    uint64_t timestamp_ns;
+    double frame_time_ms;
+};
+
+static std::vector<std::string> SplitColumns(const std::string& line) {
+    std::vector<std::string> columns;
+
+    std::size_t begin = 0;
+    for (;;) {
+        const std::size_t end = line.find(',', begin);
+        columns.push_back(line.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+        if (end == std::string::npos) break;
+        begin = end + 1;
+    }
+
+    return columns;
+}
+
+// The JSON frame log has an object per line with numbers only, so the values are found without a JSON parser
+static bool ReadJsonNumber(const std::string& line, const char* key, double& value) {
+    const std::string& member = format("\"%s\":", key);
+    const std::size_t offset = line.find(member);
+    if (offset == std::string::npos) return false;
+
+    const char* begin = line.c_str() + offset + member.size();
+    char* end = nullptr;
+    value = std::strtod(begin, &end);
+    return end != begin;
+}
+
+static bool ReadFrameLog(const std::string& path, std::vector<FrameRecord>& records) {
+    std::ifstream file(path.c_str());
+    if (!file) return false;
+
+    std::string line;
+    if (!std::getline(file, line)) return false;
+
+    const bool json = !line.empty() && line[0] == '{';
+
+    std::size_t timestamp_column = 0;
+    std::size_t frame_time_column = 0;
+    if (!json) {
+        const std::vector<std::string>& header = SplitColumns(line);
+        timestamp_column = std::find(header.begin(), header.end(), "timestamp_ns") - header.begin();
+        frame_time_column = std::find(header.begin(), header.end(), "frame_time_ms") - header.begin();
+        if (timestamp_column == header.size() || frame_time_column == header.size()) return false;
+        if (!std::getline(file, line)) return true;
+    }
+
+    do {
+        FrameRecord record;
+
+        if (json) {
+            double timestamp_ns = 0.0;
+            if (!ReadJsonNumber(line, "timestamp_ns", timestamp_ns)) continue;
+            if (!ReadJsonNumber(line, "frame_time_ms", record.frame_time_ms)) continue;
+            record.timestamp_ns = static_cast<uint64_t>(timestamp_ns);
+        } else {
+            const std::vector<std::string>& columns = SplitColumns(line);
+            if (timestamp_column >= columns.size() || frame_time_column >= columns.size()) continue;
+
+            // The last line may be partial when the application was terminated
+            char* end = nullptr;
+            record.timestamp_ns = std::strtoull(columns[timestamp_column].c_str(), &end, 10);
+            if (*end != '\0' || columns[timestamp_column].empty()) continue;
+            record.frame_time_ms = std::strtod(columns[frame_time_column].c_str(), &end);
+            if (*end != '\0' || columns[frame_time_column].empty()) continue;
+        }
+
+        records.push_back(record);
+    } while (std::getline(file, line));
+
+    return true;
+}
+
+// The nearest-rank percentile of sorted values
+static double GetPercentile(const std::vector<double>& values, double percentile) {
+    const std::size_t rank = static_cast<std::size_t>(std::ceil(percentile / 100.0 * values.size()));
+    return values[std::max<std::size_t>(rank, 1) - 1];
+}
+
+bool LoadFrameLogStats(const std::string& path, double warmup_ms, FrameLogStats& stats) {
+    stats = FrameLogStats();
+
+    std::vector<FrameRecord> records;
+    if (!ReadFrameLog(path, records)) return false;
+    if (records.empty()) return false;
+
+    // The records of several swapchains are interleaved, but in the order of the presents
+    stats.first_present_ns = records[0].timestamp_ns;
+    for (std::size_t i = 1, n = records.size(); i < n; ++i) {
+        stats.first_present_ns = std::min(stats.first_present_ns, records[i].timestamp_ns);
+    }
+
+    const uint64_t warmup_end_ns = stats.first_present_ns + static_cast<uint64_t>(warmup_ms * 1000000.0);
+
+    std::vector<double> frame_times;
+    frame_times.reserve(records.size());
+    for (std::size_t i = 0, n = records.size(); i < n; ++i) {
+        if (records[i].timestamp_ns < warmup_end_ns) continue;
+        frame_times.push_back(records[i].frame_time_ms);
+    }
+
+    stats.frames = frame_times.size();
+    if (frame_times.empty()) return false;
+
+    std::sort(frame_times.begin(), frame_times.end());
+    stats.median_ms = GetPercentile(frame_times, 50.0);
+    stats.p90_ms = GetPercentile(frame_times, 90.0);
+    stats.p99_ms = GetPercentile(frame_times, 99.0);
+
+    return true;
+}
+
+std::vector<LayerCostRun> PlanLayerCostRuns(const Configuration& configuration, const std::vector<Layer>& available_layers) {
+    std::vector<LayerCostRun> runs;
+
+    LayerCostRun baseline;
+    baseline.label = "No layers";
+    runs.push_back(baseline);
+
+    std::vector<std::string> layers;
+    for (std::size_t i = 0, n = configuration.parameters.size(); i < n; ++i) {
+        const Parameter& parameter = configuration.parameters[i];
+        if (!IsPlatformSupported(parameter.platform_flags)) continue;
+        if (parameter.state != LAYER_STATE_OVERRIDDEN) continue;
+        if (parameter.key == LAYER_COST_MONITOR_NAME) continue;
+        if (FindByKey(available_layers, parameter.key.c_str()) == nullptr) continue;
+
+        layers.push_back(parameter.key);
+
+        LayerCostRun run;
+        run.label = parameter.key;
+        run.layers.push_back(parameter.key);
+        runs.push_back(run);
+    }
+
+    if (layers.size() > 1) {
+        LayerCostRun chain;
+        chain.label = "All layers";
+        chain.layers = layers;
+        runs.push_back(chain);
+    }
+
+    return runs;
+}
+
+Configuration MakeLayerCostConfiguration(const Configuration& configuration, const std::vector<Layer>& available_layers,
+                                         const LayerCostRun& run) {
+    Configuration run_configuration = configuration;
+    run_configuration.parameters = GatherParameters(configuration.parameters, available_layers);
+
+    for (std::size_t i = 0, n = run_configuration.parameters.size(); i < n; ++i) {
+        Parameter& parameter = run_configuration.parameters[i];
+
+        const bool overridden = parameter.key == LAYER_COST_MONITOR_NAME ||
+                                std::find(run.layers.begin(), run.layers.end(), parameter.key) != run.layers.end();
+        parameter.state = overridden ? LAYER_STATE_OVERRIDDEN : LAYER_STATE_EXCLUDED;
+    }
+
+    OrderParameter(run_configuration.parameters, available_layers);
+
+    return run_configuration;
+}
+
+static std::string FormatOverhead(double value, double baseline) {
+    if (baseline <= 0.0) return "";
+    return format("%+.1f%%", (value - baseline) / baseline * 100.0);
+}
+
+std::string GenerateLayerCostReport(const std::vector<LayerCostRun>& runs) {
+    std::string report = format("%-40s %10s %8s %10s %8s %10s %10s %8s\n", "Run", "Startup", "", "Median", "", "P90", "P99", "Frames");
+
+    const LayerCostRun* baseline = !runs.empty() && runs[0].valid ? &runs[0] : nullptr;
+
+    for (std::size_t i = 0, n = runs.size(); i < n; ++i) {
+        const LayerCostRun& run = runs[i];
+        if (!run.done) continue;
+
+        if (!run.valid) {
+            report += format("%-40s %s\n", run.label.c_str(), "No frame presented");
+            continue;
+        }
+
+        const bool compared = baseline != nullptr && baseline != &run;
+
+        report += format("%-40s %7.0f ms %8s %7.2f ms %8s %7.2f ms %7.2f ms %8d\n", run.label.c_str(), run.startup_ms,
+                         compared ? FormatOverhead(run.startup_ms, baseline->startup_ms).c_str() : "", run.stats.median_ms,
+                         compared ? FormatOverhead(run.stats.median_ms, baseline->stats.median_ms).c_str() : "", run.stats.p90_ms,
+                         run.stats.p99_ms, static_cast<int>(run.stats.frames));
+    }
+
+    return report;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#pragma once
+
+#include "configuration.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The monitor layer logs the presents of each run of an application estimating the cost of the layers
+extern const char* LAYER_COST_MONITOR_NAME;
+
+// The statistics of the frame log written by the monitor layer during a run of an application
+struct FrameLogStats {
+    FrameLogStats() : frames(0), first_present_ns(0), median_ms(0.0), p90_ms(0.0), p99_ms(0.0) {}
+
+    std::size_t frames;         // Measured, after the warm-up
+    uint64_t first_present_ns;  // Steady clock timestamp of the first present
+    double median_ms;
+    double p90_ms;
+    double p99_ms;
+};
+
+// The frames presented during the first warmup_ms milliseconds after the first present are not measured. The CSV and the JSON
+// frame logs are both read.
+bool LoadFrameLogStats(const std::string& path, double warmup_ms, FrameLogStats& stats);
+
+// A run of the application with the monitor layer and the listed layers only
+struct LayerCostRun {
+    LayerCostRun() : done(false), valid(false), startup_ms(0.0) {}
+
+    std::string label;
+    std::vector<std::string> layers;
+
+    bool done;
+    bool valid;         // Whether frames were measured
+    double startup_ms;  // From the launch to the first present
+    FrameLogStats stats;
+};
+
+// A run without layers, a run per layer overridden by the configuration, then a run of the whole chain
+std::vector<LayerCostRun> PlanLayerCostRuns(const Configuration& configuration, const std::vector<Layer>& available_layers);
+
+// The configuration overriding the monitor layer and the layers of the run, with the settings of the configuration. The other
+// layers, including the implicit layers, are excluded.
+Configuration MakeLayerCostConfiguration(const Configuration& configuration, const std::vector<Layer>& available_layers,
+                                         const LayerCostRun& run);
+
+// A table of the startup time and frame times of each run and their overhead over the run without layers
+std::string GenerateLayerCostReport(const std::vector<LayerCostRun>& runs);
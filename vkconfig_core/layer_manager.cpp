@@ -22,10 +22,23 @@
 #include "util.h"
 #include "platform.h"
 #include "registry.h"
+#include "alert.h"
+#include "profiler.h"
 
 #include <QSettings>
 #include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
 #include <QStringList>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <utility>
+#include <atomic>
+#include <thread>
+#include <set>
 
 /// Going back and forth between the Windows registry and looking for files
 /// in specific folders is just a mess. This class consolidates all that into
@@ -40,6 +53,7 @@ class PathFinder {
 
    public:
     PathFinder() {}
+    explicit PathFinder(const QStringList &files) : files(files) {}
 
     // Constructor does all the work. Abstracts away instances where we might
     // be searching a disk path, or a registry path.
@@ -82,135 +96,420 @@ static const char *SEARCH_PATHS[] = {"/usr/local/etc/vulkan/explicit_layer.d",
                                      ".local/share/vulkan/implicit_layer.d"};
 #endif
 
-LayerManager::LayerManager(const Environment &environment) : environment(environment) { available_layers.reserve(10); }
+LayerManager::LayerManager(const Environment &environment)
+    : environment(environment), registry_cache_enabled(false), alerts_deferred(false) {
+    available_layers.reserve(10);
+}
+
+void LayerManager::Clear() {
+    available_layers.clear();
+    manifest_stamps.clear();
+}
+
+void LayerManager::EnableRegistryCache(bool enabled) {
+    registry_cache_enabled = enabled;
+    registry_manifests.clear();
+}
+
+void LayerManager::InvalidateRegistryCache() { registry_manifests.clear(); }
+
+void LayerManager::DeferAlerts(bool deferred) { alerts_deferred = deferred; }
+
+void LayerManager::ReportInvalidManifests() {
+    for (std::size_t i = 0, n = invalid_manifests.size(); i < n; ++i) {
+        Alert::LayerInvalid(invalid_manifests[i].path.c_str(), invalid_manifests[i].message.c_str());
+    }
+    invalid_manifests.clear();
+}
+
+QStringList LayerManager::FindRegistryManifests(const std::string &path) {
+    if (registry_cache_enabled) {
+        auto it = registry_manifests.find(path);
+        if (it != registry_manifests.end()) return it->second;
+    }
+
+    QStringList files;
+#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
+    if (QString(path.c_str()).contains("...")) {
+        files = FindRegistryLayerManifests(path.c_str());
+    } else {
+        QSettings settings(path.c_str(), QSettings::NativeFormat);
+        files = settings.allKeys();
+    }
+#endif
+
+    if (registry_cache_enabled) {
+        registry_manifests[path] = files;
+    }
 
-void LayerManager::Clear() { available_layers.clear(); }
+    return files;
+}
 
 bool LayerManager::Empty() const { return available_layers.empty(); }
 
 // Find all installed layers on the system.
-void LayerManager::LoadAllInstalledLayers() {
-    available_layers.clear();
+LayerChanges LayerManager::LoadAllInstalledLayers() {
+    ScopedTimer timer("LayerManager::LoadAllInstalledLayers");
+
+    // A new search, the layer search folders may have changed
+    InvalidatePathCache();
+
+    // The layers of the previous search are reused if their manifest didn't change
+    reusable_layers.clear();
+    reusable_layers.swap(available_layers);
+    const std::map<std::string, ManifestStamp> previous_stamps = manifest_stamps;
+
+    std::vector<std::string> paths;
 
     // FIRST: If VK_LAYER_PATH is set it has precedence over other layers.
     const std::vector<std::string> &env_user_defined_layers_paths_set =
         environment.GetUserDefinedLayersPaths(USER_DEFINED_LAYERS_PATHS_ENV_SET);
-    for (std::size_t i = 0, n = env_user_defined_layers_paths_set.size(); i < n; ++i) {
-        LoadLayersFromPath(env_user_defined_layers_paths_set[i]);
-    }
+    paths.insert(paths.end(), env_user_defined_layers_paths_set.begin(), env_user_defined_layers_paths_set.end());
 
     // SECOND: Any per layers configuration user-defined path from Vulkan Configurator? Search for those too
     const std::vector<std::string> &gui_config_user_defined_layers_paths =
         environment.GetUserDefinedLayersPaths(USER_DEFINED_LAYERS_PATHS_GUI);
-    for (std::size_t i = 0, n = gui_config_user_defined_layers_paths.size(); i < n; ++i) {
-        LoadLayersFromPath(gui_config_user_defined_layers_paths[i]);
-    }
+    paths.insert(paths.end(), gui_config_user_defined_layers_paths.begin(), gui_config_user_defined_layers_paths.end());
 
     // THIRD: Add VK_ADD_LAYER_PATH layers
     const std::vector<std::string> &env_user_defined_layers_paths_add =
         environment.GetUserDefinedLayersPaths(USER_DEFINED_LAYERS_PATHS_ENV_ADD);
-    for (std::size_t i = 0, n = env_user_defined_layers_paths_add.size(); i < n; ++i) {
-        LoadLayersFromPath(env_user_defined_layers_paths_add[i]);
-    }
+    paths.insert(paths.end(), env_user_defined_layers_paths_add.begin(), env_user_defined_layers_paths_add.end());
 
     // FOURTH: Standard layer paths, in standard locations. The above has always taken precedence
-    for (std::size_t i = 0, n = countof(SEARCH_PATHS); i < n; i++) {
-        LoadLayersFromPath(SEARCH_PATHS[i]);
-    }
+    paths.insert(paths.end(), SEARCH_PATHS, SEARCH_PATHS + countof(SEARCH_PATHS));
 
     // FIFTH: See if thee is anyting in the VULKAN_SDK path that wasn't already found elsewhere
     if (!qgetenv("VULKAN_SDK").isEmpty()) {
-        LoadLayersFromPath(GetPath(BUILTIN_PATH_EXPLICIT_LAYERS));
+        paths.push_back(GetPath(BUILTIN_PATH_EXPLICIT_LAYERS));
+    }
+
+    const std::string& cache_path = GetPath(BUILTIN_PATH_LAYERS_CACHE);
+    manifest_cache.Load(cache_path);
+
+    const std::string& summaries_path = vku::GetManifestCachePath();
+    manifest_summaries.Load(summaries_path);
+
+    LoadLayersFromPaths(paths, &manifest_cache);
+
+    if (QFileInfo(cache_path.c_str()).absoluteDir().exists()) {
+        manifest_cache.Save(cache_path);
+    }
+
+    if (!summaries_path.empty()) {
+        manifest_summaries.Save(summaries_path);
+    }
+
+    LayerChanges changes;
+
+    std::map<std::string, ManifestStamp> stamps;
+    for (std::size_t i = 0, n = available_layers.size(); i < n; ++i) {
+        const Layer &layer = available_layers[i];
+
+        auto stamp = manifest_stamps.find(layer.manifest_path);
+        if (stamp != manifest_stamps.end()) {
+            stamps.insert(*stamp);
+        }
+
+        const Layer *previous_layer = FindByKey(reusable_layers, layer.key.c_str());
+        if (previous_layer == nullptr) {
+            changes.added.push_back(layer.key);
+        } else if (previous_layer->manifest_path != layer.manifest_path) {
+            changes.updated.push_back(layer.key);
+        } else {
+            auto previous_stamp = previous_stamps.find(layer.manifest_path);
+            if (previous_stamp != previous_stamps.end() && stamp != manifest_stamps.end() &&
+                (previous_stamp->second.size != stamp->second.size || previous_stamp->second.modified != stamp->second.modified)) {
+                changes.updated.push_back(layer.key);
+            }
+        }
     }
+
+    for (std::size_t i = 0, n = reusable_layers.size(); i < n; ++i) {
+        if (FindByKey(available_layers, reusable_layers[i].key.c_str()) == nullptr) {
+            changes.removed.push_back(reusable_layers[i].key);
+        }
+    }
+
+    // Only keep the stamps of the available layers
+    manifest_stamps.swap(stamps);
+    reusable_layers.clear();
+
+    return changes;
 }
 
 // Load a single layer
-void LayerManager::LoadLayer(const std::string &layer_name) {
+void LayerManager::LoadLayer(const std::string &layer_name) { this->LoadLayers(std::vector<std::string>(1, layer_name)); }
+
+void LayerManager::LoadLayers(const std::vector<std::string> &layer_names) {
     available_layers.clear();
 
+    const std::string &summaries_path = vku::GetManifestCachePath();
+    manifest_summaries.Load(summaries_path);
+
+    for (std::size_t i = 0, n = layer_names.size(); i < n; ++i) {
+        if (FindByKey(available_layers, layer_names[i].c_str()) != nullptr) continue;
+
+        this->SearchLayer(layer_names[i]);
+    }
+
+    if (!summaries_path.empty()) {
+        manifest_summaries.Save(summaries_path);
+    }
+}
+
+bool LayerManager::SearchLayer(const std::string &layer_name) {
     // FIRST: If VK_LAYER_PATH is set it has precedence over other layers.
     const std::vector<std::string> &env_user_defined_layers_paths_set =
         environment.GetUserDefinedLayersPaths(USER_DEFINED_LAYERS_PATHS_ENV_SET);
     for (std::size_t i = 0, n = env_user_defined_layers_paths_set.size(); i < n; ++i) {
-        if (LoadLayerFromPath(layer_name, env_user_defined_layers_paths_set[i])) return;
+        if (LoadLayerFromPath(layer_name, env_user_defined_layers_paths_set[i])) return true;
     }
 
     // SECOND: Any per layers configuration user-defined path from Vulkan Configurator? Search for those too
     const std::vector<std::string> &gui_config_user_defined_layers_paths =
         environment.GetUserDefinedLayersPaths(USER_DEFINED_LAYERS_PATHS_GUI);
     for (std::size_t i = 0, n = gui_config_user_defined_layers_paths.size(); i < n; ++i) {
-        if (LoadLayerFromPath(layer_name, gui_config_user_defined_layers_paths[i])) return;
+        if (LoadLayerFromPath(layer_name, gui_config_user_defined_layers_paths[i])) return true;
     }
 
     // THIRD: Add VK_ADD_LAYER_PATH layers
     const std::vector<std::string> &env_user_defined_layers_paths_add =
         environment.GetUserDefinedLayersPaths(USER_DEFINED_LAYERS_PATHS_ENV_ADD);
     for (std::size_t i = 0, n = env_user_defined_layers_paths_add.size(); i < n; ++i) {
-        if (LoadLayerFromPath(layer_name, env_user_defined_layers_paths_add[i])) return;
+        if (LoadLayerFromPath(layer_name, env_user_defined_layers_paths_add[i])) return true;
     }
 
     // FOURTH: Standard layer paths, in standard locations. The above has always taken precedence
     for (std::size_t i = 0, n = countof(SEARCH_PATHS); i < n; i++) {
-        if (LoadLayerFromPath(layer_name, SEARCH_PATHS[i])) return;
+        if (LoadLayerFromPath(layer_name, SEARCH_PATHS[i])) return true;
     }
 
     // FIFTH: See if thee is anyting in the VULKAN_SDK path that wasn't already found elsewhere
     if (!qgetenv("VULKAN_SDK").isEmpty()) {
-        if (LoadLayerFromPath(layer_name, GetPath(BUILTIN_PATH_EXPLICIT_LAYERS))) return;
+        if (LoadLayerFromPath(layer_name, GetPath(BUILTIN_PATH_EXPLICIT_LAYERS))) return true;
     }
+
+    return false;
+}
+
+static std::string ReadManifestLayerKey(const std::string &manifest_path) {
+    QFile file(manifest_path.c_str());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return "";
+
+    const QJsonDocument &json_document = QJsonDocument::fromJson(file.readAll());
+    return json_document.object().value("layer").toObject().value("name").toString().toStdString();
+}
+
+static vku::ManifestSummary GetManifestSummary(const Layer &layer) {
+    vku::ManifestSummary summary;
+    summary.type = layer.type == LAYER_TYPE_IMPLICIT ? vku::MANIFEST_TYPE_IMPLICIT_LAYER : vku::MANIFEST_TYPE_EXPLICIT_LAYER;
+    summary.name = layer.key;
+    summary.library_path = layer.binary_path;
+    summary.api_version = layer.api_version.str();
+    summary.status = vku::MANIFEST_STATUS_VALID;
+    return summary;
+}
+
+std::string LayerManager::FindManifestLayerKey(const std::string &manifest_path) {
+    vku::ManifestSummary summary;
+    if (manifest_summaries.Find(manifest_path, summary) && summary.type != vku::MANIFEST_TYPE_DRIVER) {
+        return summary.name;
+    }
+
+    return ReadManifestLayerKey(manifest_path);
+}
+
+static LayerType GetLayerType(const std::string &path) {
+    LayerType type = LAYER_TYPE_USER_DEFINED;
+    if (QString(path.c_str()).contains("explicit", Qt::CaseInsensitive)) type = LAYER_TYPE_EXPLICIT;
+    if (QString(path.c_str()).contains("implicit", Qt::CaseInsensitive)) type = LAYER_TYPE_IMPLICIT;
+    return type;
 }
 
 /// Search a folder and load up all the layers found there. This does NOT
 /// load the default settings for each layer. This is just a master list of
 /// layers found. Do NOT load duplicate layer names. The type of layer (explicit or implicit) is
 /// determined from the path name.
-void LayerManager::LoadLayersFromPath(const std::string &path) {
-    // On Windows custom files are in the file system. On non Windows all layers are
-    // searched this way
-    LayerType type = LAYER_TYPE_USER_DEFINED;
-    if (QString(path.c_str()).contains("explicit", Qt::CaseInsensitive)) type = LAYER_TYPE_EXPLICIT;
-    if (QString(path.c_str()).contains("implicit", Qt::CaseInsensitive)) type = LAYER_TYPE_IMPLICIT;
+void LayerManager::LoadLayersFromPath(const std::string &path) { LoadLayersFromPaths(std::vector<std::string>(1, path)); }
 
-    PathFinder file_list;
+/// Search folders in order and load up all the layers found there, the first layer found of a name taking precedence.
+/// The manifests found are loaded and validated by several threads, then added in the order they were found. When cache is set,
+/// the manifests that didn't change since they were recorded there are not validated again.
+void LayerManager::LoadLayersFromPaths(const std::vector<std::string> &paths, LayerManifestCache *cache) {
+    std::vector<LayerManifest> manifests;
 
-    if (VKC_PLATFORM == VKC_PLATFORM_WINDOWS) {
-        if (QString(path.c_str()).contains("...")) {
-#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
-            LoadRegistryLayers(path.c_str(), available_layers, type);
-#endif
-            return;
+    searched_paths.clear();
+
+    for (std::size_t path_index = 0, path_count = paths.size(); path_index < path_count; ++path_index) {
+        const std::string &path = paths[path_index];
+
+        // On Windows custom files are in the file system. On non Windows all layers are
+        // searched this way
+        const LayerType type = GetLayerType(path);
+
+        PathFinder file_list;
+
+        if (VKC_PLATFORM == VKC_PLATFORM_WINDOWS) {
+            if (type == LAYER_TYPE_USER_DEFINED) {
+                file_list = PathFinder(path, true);
+                searched_paths.push_back(path);
+            } else {
+                // The registry keys, including the display drivers keys, whose layers are found in place
+                file_list = PathFinder(FindRegistryManifests(path));
+            }
+        } else if (VKC_PLATFORM == VKC_PLATFORM_LINUX || VKC_PLATFORM == VKC_PLATFORM_MACOS) {
+            // On Linux/Mac, we also need the home folder
+            std::string search_path = path;
+            if (path[0] == '.') {
+                search_path = QDir().homePath().toStdString() + "/" + path;
+            }
+
+            file_list = PathFinder(search_path, true);
+            searched_paths.push_back(search_path);
+        } else {
+            assert(0);  // Platform unknown
         }
 
-        file_list = PathFinder(path, (type == LAYER_TYPE_USER_DEFINED));
-    } else if (VKC_PLATFORM == VKC_PLATFORM_LINUX || VKC_PLATFORM == VKC_PLATFORM_MACOS) {
-        // On Linux/Mac, we also need the home folder
-        std::string search_path = path;
-        if (path[0] == '.') {
-            search_path = QDir().homePath().toStdString() + "/" + path;
+        for (int i = 0, n = file_list.FileCount(); i < n; ++i) {
+            LayerManifest manifest;
+            manifest.path = file_list.GetFileName(i);
+            manifest.type = type;
+            manifests.push_back(manifest);
         }
+    }
 
-        file_list = PathFinder(search_path, true);
-    } else {
-        assert(0);  // Platform unknown
+    LoadManifests(manifests, cache);
+}
+
+void LayerManager::LoadManifests(const std::vector<LayerManifest> &manifests, LayerManifestCache *cache) {
+    const std::size_t manifest_count = manifests.size();
+    if (manifest_count == 0) return;
+
+    // Layer::Load only uses the layers already loaded to skip duplicates early, which is done here once all are loaded
+    const std::vector<Layer> no_layers;
+
+    std::vector<Layer> layers(manifest_count);
+    std::vector<std::string> invalid_messages(manifest_count);
+    std::unique_ptr<bool[]> loaded(new bool[manifest_count]);
+    std::atomic<std::size_t> next_manifest(0);
+
+    // The layers reused from the previous search, when their manifest didn't change since
+    std::vector<ManifestStamp> stamps(manifest_count);
+    std::vector<const Layer *> reused_layers(manifest_count, nullptr);
+    for (std::size_t i = 0; i < manifest_count; ++i) {
+        const QFileInfo file_info(manifests[i].path.c_str());
+        stamps[i].size = file_info.size();
+        stamps[i].modified = file_info.lastModified().toMSecsSinceEpoch();
+
+        auto stamp = manifest_stamps.find(manifests[i].path);
+        if (stamp == manifest_stamps.end()) continue;
+        if (stamp->second.size != stamps[i].size || stamp->second.modified != stamps[i].modified) continue;
+
+        for (std::size_t j = 0, n = reusable_layers.size(); j < n; ++j) {
+            if (reusable_layers[j].manifest_path == manifests[i].path && reusable_layers[j].type == manifests[i].type) {
+                reused_layers[i] = &reusable_layers[j];
+                break;
+            }
+        }
     }
 
-    for (int i = 0, n = file_list.FileCount(); i < n; ++i) {
-        Layer layer;
-        if (layer.Load(available_layers, file_list.GetFileName(i).c_str(), type)) {
-            // Make sure this layer name has not already been added
-            if (FindByKey(available_layers, layer.key.c_str()) != nullptr) continue;
+    // A manifest whose layer name is known to be the same as a previous manifest's is only loaded if the previous one fails
+    std::vector<std::string> deferred_keys(manifest_count);
+    std::set<std::string> known_keys;
+    for (std::size_t i = 0, n = available_layers.size(); i < n; ++i) {
+        known_keys.insert(available_layers[i].key);
+    }
+    for (std::size_t i = 0; i < manifest_count; ++i) {
+        std::string key;
+        vku::ManifestSummary summary;
+        if (reused_layers[i] != nullptr) {
+            key = reused_layers[i]->key;
+        } else if (manifest_summaries.Find(manifests[i].path, summary) && summary.type != vku::MANIFEST_TYPE_DRIVER &&
+                   summary.status == vku::MANIFEST_STATUS_VALID) {
+            key = summary.name;
+        }
+        if (key.empty()) continue;
 
-            // Good to go, add the layer
-            available_layers.push_back(layer);
+        if (!known_keys.insert(key).second && reused_layers[i] == nullptr) {
+            deferred_keys[i] = key;
+        }
+    }
+
+    auto load = [&]() {
+        for (std::size_t i = next_manifest++; i < manifest_count; i = next_manifest++) {
+            if (reused_layers[i] != nullptr) {
+                loaded[i] = true;
+            } else if (!deferred_keys[i].empty()) {
+                loaded[i] = false;
+            } else {
+                loaded[i] = layers[i].Load(no_layers, manifests[i].path, manifests[i].type, &invalid_messages[i], cache);
+            }
+        }
+    };
+
+    const std::size_t thread_count = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), manifest_count);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < thread_count; ++i) {
+        threads.push_back(std::thread(load));
+    }
+    load();
+    for (std::size_t i = 0, n = threads.size(); i < n; ++i) {
+        threads[i].join();
+    }
+
+    available_layers.reserve(available_layers.size() + manifest_count);
+
+    for (std::size_t i = 0; i < manifest_count; ++i) {
+        if (!deferred_keys[i].empty()) {
+            if (FindByKey(available_layers, deferred_keys[i].c_str()) != nullptr) continue;
+
+            // The previous manifest of the layer failed to load
+            loaded[i] = layers[i].Load(no_layers, manifests[i].path, manifests[i].type, &invalid_messages[i], cache);
+        }
+
+        if (reused_layers[i] == nullptr) {
+            if (loaded[i]) {
+                manifest_summaries.Record(manifests[i].path, GetManifestSummary(layers[i]));
+            } else if (!invalid_messages[i].empty()) {
+                vku::ManifestSummary summary;
+                summary.status = vku::MANIFEST_STATUS_INVALID;
+                manifest_summaries.Record(manifests[i].path, summary);
+            }
+        }
+
+        const Layer &layer = reused_layers[i] != nullptr ? *reused_layers[i] : layers[i];
+
+        // Make sure this layer name has not already been added
+        const bool is_duplicate = !layer.key.empty() && FindByKey(available_layers, layer.key.c_str()) != nullptr;
+
+        if (loaded[i]) {
+            // Good to go, add the layer. A reused layer may be found again in another path, so it's copied.
+            if (!is_duplicate) {
+                if (reused_layers[i] != nullptr) {
+                    available_layers.push_back(layer);
+                } else {
+                    available_layers.push_back(std::move(layers[i]));
+                }
+                manifest_stamps[manifests[i].path] = stamps[i];
+            }
+        } else if (!invalid_messages[i].empty() && !is_duplicate) {
+            // Alerts are only shown by the GUI thread, and not for the layers that would have been skipped as duplicates
+            if (alerts_deferred) {
+                InvalidManifest invalid_manifest;
+                invalid_manifest.path = manifests[i].path;
+                invalid_manifest.message = invalid_messages[i];
+                invalid_manifests.push_back(invalid_manifest);
+            } else {
+                Alert::LayerInvalid(manifests[i].path.c_str(), invalid_messages[i].c_str());
+            }
         }
     }
 }
 
 // Attempt to load the named layer from the given path
 bool LayerManager::LoadLayerFromPath(const std::string &layer_name, const std::string &path) {
-    LayerType type = LAYER_TYPE_USER_DEFINED;
-    if (QString(path.c_str()).contains("explicit", Qt::CaseInsensitive)) type = LAYER_TYPE_EXPLICIT;
-    if (QString(path.c_str()).contains("implicit", Qt::CaseInsensitive)) type = LAYER_TYPE_IMPLICIT;
+    const LayerType type = GetLayerType(path);
 
     PathFinder file_list;
 
@@ -226,11 +525,16 @@ bool LayerManager::LoadLayerFromPath(const std::string &layer_name, const std::s
     }
 
     for (int i = 0, n = file_list.FileCount(); i < n; ++i) {
+        // Only the manifest of the requested layer is fully loaded
+        if (FindManifestLayerKey(file_list.GetFileName(i)) != layer_name) continue;
+
         Layer layer;
         if (layer.Load(available_layers, file_list.GetFileName(i).c_str(), type)) {
+            manifest_summaries.Record(file_list.GetFileName(i), GetManifestSummary(layer));
+
             // Add this layer if the layer name matches, then return
             if (layer_name == layer.key) {
-                available_layers.push_back(layer);
+                available_layers.push_back(std::move(layer));
                 return true;
             }
         }
@@ -23,12 +23,24 @@
 #include "layer.h"
 #include "environment.h"
 
+#include "../vku/vk_manifest_cache.h"
+
 #include <QStringList>
 
 #include <string>
 #include <vector>
+#include <map>
 #include <memory>
 
+// The keys of the layers added, removed or updated by LayerManager::LoadAllInstalledLayers
+struct LayerChanges {
+    bool Empty() const { return added.empty() && removed.empty() && updated.empty(); }
+
+    std::vector<std::string> added;
+    std::vector<std::string> removed;
+    std::vector<std::string> updated;
+};
+
 class LayerManager {
    public:
     LayerManager(const Environment& environment);
@@ -36,13 +48,67 @@ class LayerManager {
     void Clear();
     bool Empty() const;
 
-    void LoadAllInstalledLayers();
+    // Only the manifests added or modified since the previous call are loaded again
+    LayerChanges LoadAllInstalledLayers();
     void LoadLayer(const std::string& layer_name);
+    // Only the manifests of the requested layers are loaded, they are found in the same search paths order
+    void LoadLayers(const std::vector<std::string>& layer_names);
     void LoadLayersFromPath(const std::string& path);
+    void LoadLayersFromPaths(const std::vector<std::string>& paths, LayerManifestCache* cache = nullptr);
 
     std::vector<Layer> available_layers;
 
     const Environment& environment;
+
+    // Validation results of the manifests loaded by LoadAllInstalledLayers, saved between runs
+    LayerManifestCache manifest_cache;
+
+    // Summaries of the manifests shared with VIA, to skip the manifests of layers already found and to find the requested layers
+    // without parsing every manifest
+    vku::ManifestCache manifest_summaries;
+
+    // The folders searched by the last LoadLayersFromPaths, to watch for layers being installed or removed
+    std::vector<std::string> searched_paths;
+
+    // On Windows, the layer manifests found in the registry are kept between searches until InvalidateRegistryCache is called,
+    // when the registry is watched for changes by the caller
+    void EnableRegistryCache(bool enabled);
+    void InvalidateRegistryCache();
+
+    // When deferred, the alerts of the invalid manifests are kept until ReportInvalidManifests is called by the GUI thread, so that
+    // the layers can be loaded by another thread
+    void DeferAlerts(bool deferred);
+    void ReportInvalidManifests();
+
    private:
+    struct LayerManifest {
+        std::string path;
+        LayerType type;
+    };
+
+    struct ManifestStamp {
+        qint64 size;
+        qint64 modified;
+    };
+
+    // The stamps of the manifests of the available layers when they were loaded
+    std::map<std::string, ManifestStamp> manifest_stamps;
+    std::vector<Layer> reusable_layers;
+
+    bool registry_cache_enabled;
+    std::map<std::string, QStringList> registry_manifests;
+
+    struct InvalidManifest {
+        std::string path;
+        std::string message;
+    };
+
+    bool alerts_deferred;
+    std::vector<InvalidManifest> invalid_manifests;
+
+    QStringList FindRegistryManifests(const std::string& path);
+    std::string FindManifestLayerKey(const std::string& manifest_path);
+    bool SearchLayer(const std::string& layer_name);
     bool LoadLayerFromPath(const std::string& layer_name, const std::string& path);
+    void LoadManifests(const std::vector<LayerManifest>& manifests, LayerManifestCache* cache);
 };
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "layer_manifest_cache.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QStringList>
+
+// Increment when the content of the cache file changes
+static const int CACHE_VERSION = 1;
+
+// Validation results are only valid for the schema used to validate the manifests
+static std::string GetSchemaHash() {
+    QFile file(":/layers/schema.json");
+    if (!file.open(QIODevice::ReadOnly)) return std::string();
+
+    const QByteArray& hash = QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha1);
+    return QString(hash.toHex()).toStdString();
+}
+
+LayerManifestCache::LayerManifestCache() : schema_hash(GetSchemaHash()), changed(false) {}
+
+bool LayerManifestCache::Load(const std::string& cache_path) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    entries.clear();
+    changed = false;
+
+    QFile file(cache_path.c_str());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+
+    const QByteArray& data = file.readAll();
+    file.close();
+
+    const QJsonDocument& json_doc = QJsonDocument::fromJson(data);
+    if (!json_doc.isObject()) return false;
+
+    const QJsonObject& json_root_object = json_doc.object();
+    if (json_root_object.value("version").toInt() != CACHE_VERSION) return false;
+    if (json_root_object.value("schema").toString().toStdString() != schema_hash) return false;
+
+    const QJsonObject& json_manifests_object = json_root_object.value("manifests").toObject();
+    const QStringList& manifest_paths = json_manifests_object.keys();
+    for (int i = 0, n = manifest_paths.size(); i < n; ++i) {
+        const QJsonObject& json_entry_object = json_manifests_object.value(manifest_paths[i]).toObject();
+
+        Entry entry;
+        entry.size = static_cast<qint64>(json_entry_object.value("size").toDouble());
+        entry.modified = static_cast<qint64>(json_entry_object.value("modified").toDouble());
+        entry.is_valid = json_entry_object.value("valid").toBool();
+        entry.message = json_entry_object.value("message").toString().toStdString();
+        entry.used = false;
+        entries.insert(std::make_pair(manifest_paths[i].toStdString(), entry));
+    }
+
+    return true;
+}
+
+bool LayerManifestCache::Save(const std::string& cache_path) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Forget the manifests that were not found by the last search
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->second.used) {
+            ++it;
+        } else {
+            it = entries.erase(it);
+            changed = true;
+        }
+    }
+
+    if (!changed) return true;
+
+    QJsonObject json_manifests_object;
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        QJsonObject json_entry_object;
+        json_entry_object.insert("size", static_cast<double>(it->second.size));
+        json_entry_object.insert("modified", static_cast<double>(it->second.modified));
+        json_entry_object.insert("valid", it->second.is_valid);
+        if (!it->second.message.empty()) {
+            json_entry_object.insert("message", it->second.message.c_str());
+        }
+        json_manifests_object.insert(it->first.c_str(), json_entry_object);
+    }
+
+    QJsonObject json_root_object;
+    json_root_object.insert("version", CACHE_VERSION);
+    json_root_object.insert("schema", schema_hash.c_str());
+    json_root_object.insert("manifests", json_manifests_object);
+
+    QFile file(cache_path.c_str());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+
+    QJsonDocument doc(json_root_object);
+    file.write(doc.toJson());
+    file.close();
+
+    changed = false;
+    return true;
+}
+
+void LayerManifestCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    changed = changed || !entries.empty();
+    entries.clear();
+}
+
+bool LayerManifestCache::Find(const std::string& manifest_path, bool& is_valid, std::string& message) {
+    qint64 size = 0;
+    qint64 modified = 0;
+    if (!GetFileStamp(manifest_path, size, modified)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = entries.find(manifest_path);
+    if (it == entries.end()) return false;
+
+    // The manifest changed since it was validated
+    if (it->second.size != size || it->second.modified != modified) return false;
+
+    it->second.used = true;
+    is_valid = it->second.is_valid;
+    message = it->second.message;
+    return true;
+}
+
+void LayerManifestCache::Record(const std::string& manifest_path, bool is_valid, const std::string& message) {
+    Entry entry;
+    if (!GetFileStamp(manifest_path, entry.size, entry.modified)) return;
+    entry.is_valid = is_valid;
+    entry.message = message;
+    entry.used = true;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    entries[manifest_path] = entry;
+    changed = true;
+}
+
+std::size_t LayerManifestCache::Size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return entries.size();
+}
+
+bool LayerManifestCache::GetFileStamp(const std::string& manifest_path, qint64& size, qint64& modified) {
+    // The resource files are built-in, there is nothing to cache
+    if (manifest_path.rfind(":/", 0) == 0) return false;
+
+    const QFileInfo file_info(manifest_path.c_str());
+    if (!file_info.exists()) return false;
+
+    size = file_info.size();
+    modified = file_info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
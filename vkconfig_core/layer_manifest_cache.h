@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#pragma once
+
+#include <QtGlobal>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+// Remembers the schema validation result of the layer manifests, keyed by path, size and modification time, so that the
+// manifests that didn't change since the last run are not validated again. The cache is discarded when the layer schema changes.
+// Find and Record may be called from several threads.
+class LayerManifestCache {
+   public:
+    LayerManifestCache();
+
+    bool Load(const std::string& cache_path);
+    bool Save(const std::string& cache_path);
+    void Clear();
+
+    // Returns whether the manifest validation result is known, in which case 'is_valid' and 'message' are set
+    bool Find(const std::string& manifest_path, bool& is_valid, std::string& message);
+    void Record(const std::string& manifest_path, bool is_valid, const std::string& message);
+
+    std::size_t Size() const;
+
+   private:
+    struct Entry {
+        qint64 size;
+        qint64 modified;
+        bool is_valid;
+        std::string message;
+        bool used;
+    };
+
+    static bool GetFileStamp(const std::string& manifest_path, qint64& size, qint64& modified);
+
+    mutable std::mutex mutex;
+    std::map<std::string, Entry> entries;
+    std::string schema_hash;
+    bool changed;
+};
@@ -49,3 +49,68 @@ bool HasPreset(const SettingDataSet& layer_settings, const SettingDataSetConst&
 
     return true;
 }
+
+LayerPresetTracker::LayerPresetTracker(const std::vector<LayerPreset>& presets, const SettingDataSet& settings)
+    : presets(presets), mismatch_counts(presets.size(), 0) {
+    // Like FindSetting, the first setting of a key is the one compared
+    std::unordered_map<std::string, const SettingData*> setting_index;
+    for (std::size_t i = 0, n = settings.size(); i < n; ++i) {
+        setting_index.emplace(settings[i]->key, settings[i]);
+    }
+
+    for (std::size_t preset_index = 0, preset_count = presets.size(); preset_index < preset_count; ++preset_index) {
+        const SettingDataSetConst& preset_settings = presets[preset_index].settings;
+
+        // Like HasPreset, a preset without settings is never matched
+        if (preset_settings.empty()) this->mismatch_counts[preset_index] = 1;
+
+        for (std::size_t i = 0, n = preset_settings.size(); i < n; ++i) {
+            const auto it = setting_index.find(preset_settings[i]->key);
+
+            Entry entry;
+            entry.preset_index = preset_index;
+            entry.preset_setting = preset_settings[i];
+            entry.setting = it != setting_index.end() ? it->second : nullptr;
+            entry.matched = false;
+            ++this->mismatch_counts[preset_index];
+
+            this->entry_index.emplace(preset_settings[i]->key, this->entries.size());
+            this->entries.push_back(entry);
+        }
+    }
+
+    this->UpdateAll();
+}
+
+void LayerPresetTracker::Evaluate(Entry& entry) {
+    const bool matched = entry.setting != nullptr && *entry.preset_setting == *entry.setting;
+    if (matched == entry.matched) return;
+
+    entry.matched = matched;
+    if (matched) {
+        --this->mismatch_counts[entry.preset_index];
+    } else {
+        ++this->mismatch_counts[entry.preset_index];
+    }
+}
+
+void LayerPresetTracker::Update(const std::string& key) {
+    const auto range = this->entry_index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        this->Evaluate(this->entries[it->second]);
+    }
+}
+
+void LayerPresetTracker::UpdateAll() {
+    for (std::size_t i = 0, n = this->entries.size(); i < n; ++i) {
+        this->Evaluate(this->entries[i]);
+    }
+}
+
+const LayerPreset* LayerPresetTracker::FindPreset() const {
+    for (std::size_t i = 0, n = this->mismatch_counts.size(); i < n; ++i) {
+        if (this->mismatch_counts[i] == 0) return &this->presets[i];
+    }
+
+    return nullptr;
+}
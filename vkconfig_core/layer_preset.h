@@ -23,6 +23,8 @@
 #include "header.h"
 #include "setting.h"
 
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 struct LayerPreset : public Header {
@@ -34,3 +36,35 @@ const LayerPreset* GetPreset(const std::vector<LayerPreset>& presets, const char
 // Check whether "layer_settings" has all the settings set in "preset_settings"
 // "layer_settings" may have more settings then "preset_settings" and return true
 bool HasPreset(const SettingDataSet& layer_settings, const SettingDataSetConst& preset_settings);
+
+// Tracks which presets the settings of a parameter match, with a count of mismatched settings per preset. When a setting
+// changes, only the preset settings of its key are compared again, so that finding the preset is not a search of every
+// preset setting through the settings of the parameter. The presets and the settings must outlive the tracker.
+class LayerPresetTracker {
+   public:
+    LayerPresetTracker(const std::vector<LayerPreset>& presets, const SettingDataSet& settings);
+
+    // To call after the setting of the key changed
+    void Update(const std::string& key);
+
+    // To call after several settings changed, such as when a preset is applied
+    void UpdateAll();
+
+    // The first preset all the settings of which are matched, nullptr if there is none
+    const LayerPreset* FindPreset() const;
+
+   private:
+    struct Entry {
+        std::size_t preset_index;
+        const SettingData* preset_setting;
+        const SettingData* setting;  // nullptr when the parameter doesn't have the setting, which then never matches
+        bool matched;
+    };
+
+    void Evaluate(Entry& entry);
+
+    const std::vector<LayerPreset>& presets;
+    std::vector<Entry> entries;
+    std::unordered_multimap<std::string, std::size_t> entry_index;
+    std::vector<std::size_t> mismatch_counts;
+};
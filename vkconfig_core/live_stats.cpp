@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "live_stats.h"
+#include "path.h"
+#include "setting_bool.h"
+#include "setting_filesystem.h"
+#include "setting_flags.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+
+#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
+#include <windows.h>
+#elif VKC_PLATFORM == VKC_PLATFORM_LINUX || VKC_PLATFORM == VKC_PLATFORM_MACOS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char* API_DUMP_LAYER_NAME = "VK_LAYER_LUNARG_api_dump";
+
+// The new api_dump output read by an update is capped, the older reports are skipped when the application writes faster
+static const int64_t API_DUMP_MAX_READ_SIZE = 4 * 1024 * 1024;
+
+LiveStats::LiveStats()
+    : telemetry(false),
+      telemetry_updates(0),
+      frames(0),
+      fps(0.0f),
+      median_ms(0.0f),
+      p99_ms(0.0f),
+      gpu_time_ms(-1.0f),
+      memory_usage_mb(-1.0f),
+      memory_budget_mb(-1.0f),
+      api_stats(false),
+      submits_per_frame(0.0) {}
+
+bool ReadTelemetryBlock(const void* block, std::size_t size, LiveStats& stats) {
+    if (block == nullptr || size < LIVE_TELEMETRY_HEADER_SIZE) return false;
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(block);
+    const LiveTelemetryHeader* header = reinterpret_cast<const LiveTelemetryHeader*>(bytes);
+
+    // The magic is written last by the layer
+    if (header->magic != LIVE_TELEMETRY_MAGIC) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (header->version != LIVE_TELEMETRY_VERSION || header->slot_size < sizeof(LiveTelemetrySlot)) return false;
+    if (size < LIVE_TELEMETRY_HEADER_SIZE + static_cast<std::size_t>(header->slot_size) * header->slot_count) return false;
+
+    const uint64_t updates = header->updates.load(std::memory_order_acquire);
+
+    bool found = false;
+    uint64_t frames = 0;
+    float fps = 0.0f;
+    float median_ms = 0.0f;
+    float p99_ms = 0.0f;
+    float gpu_time_ms = -1.0f;
+    float memory_usage_mb = -1.0f;
+    float memory_budget_mb = -1.0f;
+
+    for (uint32_t i = 0, n = header->slot_count; i < n; ++i) {
+        const LiveTelemetrySlot* slot =
+            reinterpret_cast<const LiveTelemetrySlot*>(bytes + LIVE_TELEMETRY_HEADER_SIZE + header->slot_size * i);
+
+        const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence & 1) continue;
+
+        const uint64_t slot_swapchain = slot->swapchain;
+        const uint64_t slot_frames = slot->frames;
+        const float slot_fps = slot->fps;
+        const float slot_median_ms = slot->median_ms;
+        const float slot_p99_ms = slot->p99_ms;
+        const float slot_gpu_time_ms = slot->gpu_time_ms;
+        const float slot_memory_usage_mb = slot->memory_usage_mb;
+        const float slot_memory_budget_mb = slot->memory_budget_mb;
+
+        // The slot was rewritten while it was read
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load(std::memory_order_relaxed) != sequence) continue;
+
+        if (slot_swapchain == 0) continue;
+        if (found && slot_frames <= frames) continue;
+
+        found = true;
+        frames = slot_frames;
+        fps = slot_fps;
+        median_ms = slot_median_ms;
+        p99_ms = slot_p99_ms;
+        gpu_time_ms = slot_gpu_time_ms;
+        memory_usage_mb = slot_memory_usage_mb;
+        memory_budget_mb = slot_memory_budget_mb;
+    }
+
+    stats.telemetry = true;
+    if (!found) return true;
+
+    stats.frames = frames;
+    stats.fps = fps;
+    stats.median_ms = median_ms;
+    stats.p99_ms = p99_ms;
+    stats.gpu_time_ms = gpu_time_ms;
+    stats.memory_usage_mb = memory_usage_mb;
+    stats.memory_budget_mb = memory_budget_mb;
+
+    // A sample of the frame time graph per update of the layer
+    if (updates != stats.telemetry_updates) {
+        stats.telemetry_updates = updates;
+        stats.frame_times_ms.push_back(median_ms);
+        if (stats.frame_times_ms.size() > LIVE_STATS_HISTORY) {
+            stats.frame_times_ms.erase(stats.frame_times_ms.begin(),
+                                       stats.frame_times_ms.begin() + (stats.frame_times_ms.size() - LIVE_STATS_HISTORY));
+        }
+    }
+
+    return true;
+}
+
+// The reports are objects of an array which braces are the only ones at the start of a line
+static std::size_t FindReportBegin(const std::string& text, std::size_t offset) {
+    for (std::size_t i = text.find('{', offset); i != std::string::npos; i = text.find('{', i + 1)) {
+        if (i == 0 || text[i - 1] == '\n') return i;
+    }
+    return std::string::npos;
+}
+
+bool ReadApiDumpStatsReports(std::string& text, LiveStats& stats) {
+    std::map<std::string, LiveApiCall> calls;
+    uint64_t frames = 0;
+    uint64_t submits = 0;
+    bool read = false;
+
+    std::size_t consumed = 0;
+    for (;;) {
+        const std::size_t begin = FindReportBegin(text, consumed);
+        if (begin == std::string::npos) {
+            // Only a line may still become the beginning of a report
+            const std::size_t line = text.rfind('\n');
+            if (line != std::string::npos) consumed = std::max(consumed, line + 1);
+            break;
+        }
+
+        consumed = begin;
+
+        const std::size_t end = text.find("\n}", begin);
+        if (end == std::string::npos) break;
+
+        consumed = end + 2;
+
+        const QJsonDocument& document = QJsonDocument::fromJson(QByteArray(text.data() + begin, static_cast<int>(end + 2 - begin)));
+        if (!document.isObject()) continue;
+
+        const QJsonObject& report = document.object();
+        read = true;
+
+        const qint64 first_frame = report.value("firstFrame").toVariant().toLongLong();
+        const qint64 last_frame = report.value("lastFrame").toVariant().toLongLong();
+        if (last_frame >= first_frame) frames += static_cast<uint64_t>(last_frame - first_frame + 1);
+
+        const QJsonArray& functions = report.value("functions").toArray();
+        for (int i = 0, n = functions.size(); i < n; ++i) {
+            const QJsonObject& function = functions[i].toObject();
+            const std::string& name = function.value("name").toString().toStdString();
+            const uint64_t function_calls = function.value("calls").toVariant().toULongLong();
+
+            LiveApiCall& call = calls[name];
+            call.name = name;
+            call.calls += function_calls;
+            call.total_ms += function.value("totalNs").toDouble() / 1000000.0;
+
+            if (name == "vkQueueSubmit" || name == "vkQueueSubmit2" || name == "vkQueueSubmit2KHR") submits += function_calls;
+        }
+    }
+
+    text.erase(0, consumed);
+
+    if (!read) return false;
+
+    stats.api_stats = true;
+    stats.submits_per_frame = frames > 0 ? static_cast<double>(submits) / static_cast<double>(frames) : 0.0;
+
+    stats.top_calls.clear();
+    for (auto it = calls.begin(); it != calls.end(); ++it) {
+        stats.top_calls.push_back(it->second);
+    }
+
+    const std::size_t top_count = std::min<std::size_t>(stats.top_calls.size(), LIVE_STATS_TOP_CALLS);
+    std::partial_sort(stats.top_calls.begin(), stats.top_calls.begin() + top_count, stats.top_calls.end(),
+                      [](const LiveApiCall& a, const LiveApiCall& b) { return a.total_ms > b.total_ms; });
+    stats.top_calls.resize(top_count);
+
+    return true;
+}
+
+std::string GetApiDumpStatsPath(const Configuration& configuration) {
+    const Parameter* parameter = FindByKey(configuration.parameters, API_DUMP_LAYER_NAME);
+    if (parameter == nullptr || parameter->state != LAYER_STATE_OVERRIDDEN) return "";
+
+    const SettingDataEnum* output_format = FindSetting<SettingDataEnum>(parameter->settings, "output_format");
+    const SettingDataBool* file = FindSetting<SettingDataBool>(parameter->settings, "file");
+    const SettingDataBool* stats_json = FindSetting<SettingDataBool>(parameter->settings, "stats_json");
+    const SettingDataFileSave* log_filename = FindSetting<SettingDataFileSave>(parameter->settings, "log_filename");
+
+    if (output_format == nullptr || output_format->value != "stats") return "";
+    if (file == nullptr || !file->value || stats_json == nullptr || !stats_json->value) return "";
+    if (log_filename == nullptr || log_filename->value.empty()) return "";
+
+    return ReplaceBuiltInVariable(log_filename->value);
+}
+
+LiveStatsReader::LiveStatsReader()
+    : interval_ms(500),
+      mapping(nullptr),
+      mapping_size(0),
+#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
+      mapping_handle(nullptr),
+#endif
+      api_dump_offset(0),
+      stopping(false) {
+}
+
+LiveStatsReader::~LiveStatsReader() { this->Stop(); }
+
+void LiveStatsReader::Start(const std::string& telemetry_name, const std::string& api_dump_path, int interval_ms) {
+    this->Stop();
+
+    this->telemetry_name = telemetry_name;
+    this->api_dump_path = api_dump_path;
+    this->interval_ms = std::max(interval_ms, 1);
+    this->api_dump_text.clear();
+    this->api_dump_offset = 0;
+    this->stopping = false;
+    this->stats = LiveStats();
+
+    this->thread = std::thread(&LiveStatsReader::Run, this);
+}
+
+void LiveStatsReader::Stop() {
+    if (!this->thread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->stopped.notify_one();
+    this->thread.join();
+}
+
+bool LiveStatsReader::IsRunning() const { return this->thread.joinable(); }
+
+LiveStats LiveStatsReader::GetStats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->stats;
+}
+
+void LiveStatsReader::Run() {
+    LiveStats current;
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (!this->stopped.wait_for(lock, std::chrono::milliseconds(this->interval_ms), [this] { return this->stopping; })) {
+        lock.unlock();
+        this->UpdateTelemetry(current);
+        this->UpdateApiStats(current);
+        lock.lock();
+
+        this->stats = current;
+    }
+    lock.unlock();
+
+    this->UnmapTelemetry();
+}
+
+void LiveStatsReader::UpdateTelemetry(LiveStats& current) {
+    if (this->telemetry_name.empty()) return;
+
+    // The shared memory is only created once the application creates its Vulkan instance
+    if (this->mapping == nullptr && !this->MapTelemetry()) return;
+
+    ReadTelemetryBlock(this->mapping, this->mapping_size, current);
+}
+
+void LiveStatsReader::UpdateApiStats(LiveStats& current) {
+    if (this->api_dump_path.empty()) return;
+
+    std::ifstream file(this->api_dump_path.c_str(), std::ios::in | std::ios::binary);
+    if (!file) return;
+
+    file.seekg(0, std::ios::end);
+    const int64_t size = static_cast<int64_t>(file.tellg());
+    if (size < 0) return;
+
+    // The file was written again from the start
+    if (size < this->api_dump_offset) {
+        this->api_dump_offset = 0;
+        this->api_dump_text.clear();
+    }
+
+    bool skipped = false;
+    if (size - this->api_dump_offset > API_DUMP_MAX_READ_SIZE) {
+        this->api_dump_offset = size - API_DUMP_MAX_READ_SIZE;
+        this->api_dump_text.clear();
+        skipped = true;
+    }
+
+    if (size == this->api_dump_offset) return;
+
+    std::string text(static_cast<std::size_t>(size - this->api_dump_offset), '\0');
+    file.seekg(this->api_dump_offset);
+    file.read(&text[0], static_cast<std::streamsize>(text.size()));
+    text.resize(static_cast<std::size_t>(file.gcount()));
+    this->api_dump_offset += static_cast<int64_t>(text.size());
+
+    // The reading starts at a line boundary
+    if (skipped) {
+        const std::size_t line = text.find('\n');
+        text.erase(0, line == std::string::npos ? text.size() : line + 1);
+    }
+
+    this->api_dump_text += text;
+    ReadApiDumpStatsReports(this->api_dump_text, current);
+}
+
+bool LiveStatsReader::MapTelemetry() {
+#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
+    HANDLE handle = OpenFileMappingA(FILE_MAP_READ, FALSE, this->telemetry_name.c_str());
+    if (handle == nullptr) return false;
+
+    const std::size_t size = LIVE_TELEMETRY_HEADER_SIZE + LIVE_TELEMETRY_SLOT_SIZE * LIVE_TELEMETRY_SLOTS;
+    const void* address = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, size);
+    if (address == nullptr) {
+        CloseHandle(handle);
+        return false;
+    }
+
+    this->mapping_handle = handle;
+    this->mapping = address;
+    this->mapping_size = size;
+    return true;
+#elif VKC_PLATFORM == VKC_PLATFORM_LINUX || VKC_PLATFORM == VKC_PLATFORM_MACOS
+    const std::string& name = this->telemetry_name[0] == '/' ? this->telemetry_name : "/" + this->telemetry_name;
+
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+
+    // The layer sizes the shared memory after creating it
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < LIVE_TELEMETRY_HEADER_SIZE) {
+        close(fd);
+        return false;
+    }
+
+    const std::size_t size = static_cast<std::size_t>(info.st_size);
+    void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) return false;
+
+    this->mapping = address;
+    this->mapping_size = size;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void LiveStatsReader::UnmapTelemetry() {
+    if (this->mapping == nullptr) return;
+
+#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
+    UnmapViewOfFile(this->mapping);
+    CloseHandle(this->mapping_handle);
+    this->mapping_handle = nullptr;
+#elif VKC_PLATFORM == VKC_PLATFORM_LINUX || VKC_PLATFORM == VKC_PLATFORM_MACOS
+    munmap(const_cast<void*>(this->mapping), this->mapping_size);
+#endif
+
+    this->mapping = nullptr;
+    this->mapping_size = 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#pragma once
+
+#include "configuration.h"
+#include "platform.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The layout of the shared memory block the monitor layer publishes the statistics of the swapchains to, as described by
+// layersvt/monitor_telemetry.h
+enum {
+    LIVE_TELEMETRY_MAGIC = 0x4D4C4554,
+    LIVE_TELEMETRY_VERSION = 2,
+    LIVE_TELEMETRY_HEADER_SIZE = 64,
+    LIVE_TELEMETRY_SLOT_SIZE = 64,
+    LIVE_TELEMETRY_SLOTS = 16
+};
+
+struct LiveTelemetryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint32_t process_id;
+    uint32_t interval_ms;
+    std::atomic<uint64_t> updates;
+};
+
+struct LiveTelemetrySlot {
+    std::atomic<uint64_t> sequence;  // Odd while the slot is written
+    uint64_t swapchain;
+    uint64_t frames;
+    uint64_t timestamp_ns;
+    float fps;
+    float median_ms;
+    float p99_ms;
+    float p99_9_ms;
+    float gpu_time_ms;       // -1 if not measured
+    float memory_usage_mb;   // -1 if not sampled
+    float memory_budget_mb;  // -1 if not sampled
+};
+
+static_assert(sizeof(LiveTelemetryHeader) <= LIVE_TELEMETRY_HEADER_SIZE, "Unexpected telemetry header size");
+static_assert(sizeof(LiveTelemetrySlot) <= LIVE_TELEMETRY_SLOT_SIZE, "Unexpected telemetry slot size");
+
+enum { LIVE_STATS_HISTORY = 120, LIVE_STATS_TOP_CALLS = 5 };
+
+struct LiveApiCall {
+    LiveApiCall() : calls(0), total_ms(0.0) {}
+
+    std::string name;
+    uint64_t calls;
+    double total_ms;
+};
+
+// The statistics of the application launched by vkconfig, as last read from the layers
+struct LiveStats {
+    LiveStats();
+
+    // From the monitor layer telemetry, of the swapchain that presented the most frames
+    bool telemetry;
+    uint64_t telemetry_updates;
+    uint64_t frames;
+    float fps;
+    float median_ms;
+    float p99_ms;
+    float gpu_time_ms;
+    float memory_usage_mb;
+    float memory_budget_mb;
+    std::vector<float> frame_times_ms;  // The median frame time of the last LIVE_STATS_HISTORY updates, the oldest first
+
+    // From the api_dump statistics reports, over the reports read by the last update
+    bool api_stats;
+    double submits_per_frame;
+    std::vector<LiveApiCall> top_calls;  // The LIVE_STATS_TOP_CALLS functions which took the most time, the slowest first
+};
+
+// Returns false if the block is not published yet or has an unknown layout. A slot written while it is read is skipped.
+bool ReadTelemetryBlock(const void* block, std::size_t size, LiveStats& stats);
+
+// Reads the complete JSON reports at the start of 'text', written by api_dump with the 'stats' output format, and removes them
+// from 'text'. Returns whether any report was read.
+bool ReadApiDumpStatsReports(std::string& text, LiveStats& stats);
+
+// The file the api_dump statistics reports are written to by the configuration, or empty if the configuration doesn't write the
+// JSON statistics of api_dump to a file
+std::string GetApiDumpStatsPath(const Configuration& configuration);
+
+// Reads the monitor layer telemetry and the api_dump statistics of a running application on a thread, every 'interval_ms'
+// milliseconds, so that neither the amount of layer output nor the wait for the shared memory to be created are on the UI
+// thread. The UI only copies the last statistics with GetStats.
+class LiveStatsReader {
+   public:
+    LiveStatsReader();
+    ~LiveStatsReader();
+
+    // Either may be empty
+    void Start(const std::string& telemetry_name, const std::string& api_dump_path, int interval_ms);
+    void Stop();
+
+    bool IsRunning() const;
+    LiveStats GetStats() const;
+
+   private:
+    LiveStatsReader(const LiveStatsReader&) = delete;
+    LiveStatsReader& operator=(const LiveStatsReader&) = delete;
+
+    void Run();
+    void UpdateTelemetry(LiveStats& current);
+    void UpdateApiStats(LiveStats& current);
+    bool MapTelemetry();
+    void UnmapTelemetry();
+
+    std::string telemetry_name;
+    std::string api_dump_path;
+    int interval_ms;
+
+    const void* mapping;
+    std::size_t mapping_size;
+#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
+    void* mapping_handle;
+#endif
+
+    std::string api_dump_text;  // Not yet complete reports
+    int64_t api_dump_offset;
+
+    mutable std::mutex mutex;
+    std::condition_variable stopped;
+    bool stopping;
+    std::thread thread;
+    LiveStats stats;
+};
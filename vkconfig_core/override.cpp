@@ -21,6 +21,7 @@
 #include "override.h"
 #include "util.h"
 #include "platform.h"
+#include "profiler.h"
 #include "registry.h"
 
 #include <QString>
@@ -28,12 +29,32 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QTextStream>
 
 #include <vulkan/vulkan.h>
 
 #include <cstdio>
 
+// Layers may watch the override files: the content is written to a temporary file renamed over the previous one, so that a
+// partial file is never observed, and the file is left untouched when the content is unchanged.
+static bool WriteOverrideFile(const std::string& path, const QByteArray& content) {
+    QFile current_file(path.c_str());
+    if (current_file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const bool unchanged = current_file.readAll() == content;
+        current_file.close();
+        if (unchanged) return true;
+    }
+
+    QSaveFile file(path.c_str());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+    if (file.write(content) != content.size()) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
 // Create and write VkLayer_override.json file
 bool WriteLayersOverride(const Environment& environment, const std::vector<Layer>& available_layers,
                          const Configuration& configuration, const std::string& layers_path) {
@@ -47,6 +68,9 @@ bool WriteLayersOverride(const Environment& environment, const std::vector<Layer
     QStringList layer_system_paths;
 
     QStringList layer_override_paths;
+
+    const KeyIndex<Layer> layer_index(available_layers);
+
     for (std::size_t i = 0, n = configuration.parameters.size(); i < n; ++i) {
         const Parameter& parameter = configuration.parameters[i];
         if (!(parameter.platform_flags & (1 << VKC_PLATFORM))) {
@@ -55,7 +79,7 @@ bool WriteLayersOverride(const Environment& environment, const std::vector<Layer
 
         if (parameter.state != LAYER_STATE_OVERRIDDEN) continue;
 
-        const Layer* layer = FindByKey(available_layers, parameter.key.c_str());
+        const Layer* layer = layer_index.Find(parameter.key);
         if (layer == nullptr) {
             continue;
         }
@@ -145,11 +169,8 @@ bool WriteLayersOverride(const Environment& environment, const std::vector<Layer
     root.insert("layer", layer);
     QJsonDocument doc(root);
 
-    QFile json_file(layers_path.c_str());
-    const bool result_layers_file = json_file.open(QIODevice::WriteOnly | QIODevice::Text);
+    const bool result_layers_file = WriteOverrideFile(layers_path, doc.toJson());
     assert(result_layers_file);
-    json_file.write(doc.toJson());
-    json_file.close();
 
     return result_layers_file;
 }
@@ -161,16 +182,14 @@ bool WriteSettingsOverride(const std::vector<Layer>& available_layers, const Con
         fprintf(stderr, "Cannot open file %s\n", settings_path.c_str());
         exit(1);
     };
-    QFile file(settings_path.c_str());
-    const bool result_settings_file = file.open(QIODevice::WriteOnly | QIODevice::Text);
-    if (!result_settings_file) {
-        fprintf(stderr, "Cannot open file %s\n", settings_path.c_str());
-        exit(1);
-    }
-    QTextStream stream(&file);
+
+    QByteArray content;
+    QTextStream stream(&content, QIODevice::WriteOnly);
 
     bool has_missing_layers = false;
 
+    const KeyIndex<Layer> layer_index(available_layers);
+
     // Loop through all the layers
     for (std::size_t j = 0, n = configuration.parameters.size(); j < n; ++j) {
         const Parameter& parameter = configuration.parameters[j];
@@ -178,7 +197,7 @@ bool WriteSettingsOverride(const std::vector<Layer>& available_layers, const Con
             continue;
         }
 
-        const Layer* layer = FindByKey(available_layers, parameter.key.c_str());
+        const Layer* layer = layer_index.Find(parameter.key);
         if (layer == nullptr) {
             has_missing_layers = true;
             continue;
@@ -193,6 +212,8 @@ bool WriteSettingsOverride(const std::vector<Layer>& available_layers, const Con
 
         std::string lc_layer_name = GetLayerSettingPrefix(layer->key);
 
+        const SettingMetaIndex setting_index(layer->settings);
+
         for (std::size_t i = 0, m = parameter.settings.size(); i < m; ++i) {
             const SettingData* setting_data = parameter.settings[i];
 
@@ -212,7 +233,7 @@ bool WriteSettingsOverride(const std::vector<Layer>& available_layers, const Con
             }
 
             // Skip missing settings
-            const SettingMeta* meta = FindSetting(layer->settings, setting_data->key.c_str());
+            const SettingMeta* meta = setting_index.Find(setting_data->key);
             if (meta == nullptr) {
                 continue;
             }
@@ -260,19 +281,25 @@ bool WriteSettingsOverride(const std::vector<Layer>& available_layers, const Con
             stream << "\n\n";
         }
     }
-    file.close();
+    stream.flush();
+
+    const bool result_settings_file = WriteOverrideFile(settings_path, content);
+    if (!result_settings_file) {
+        fprintf(stderr, "Cannot write file %s\n", settings_path.c_str());
+        exit(1);
+    }
 
     return result_settings_file && !has_missing_layers;
 }
 
 bool OverrideConfiguration(const Environment& environment, const std::vector<Layer>& available_layers,
                            const Configuration& configuration) {
+    ScopedTimer timer("OverrideConfiguration");
+
     const std::string layers_path = GetPath(BUILTIN_PATH_OVERRIDE_LAYERS);
     const std::string settings_path = GetPath(BUILTIN_PATH_OVERRIDE_SETTINGS);
 
-    // Clean up
-    SurrenderConfiguration(environment);
-
+    // The override files are replaced rather than erased first, so that running applications never find them missing
     // VkLayer_override.json
     const bool result_layers = WriteLayersOverride(environment, available_layers, configuration, layers_path);
 
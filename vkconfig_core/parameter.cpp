@@ -29,21 +29,52 @@
 
 #include <cassert>
 #include <algorithm>
+#include <unordered_map>
 
 static const char* VK_LAYER_KHRONOS_PROFILES_NAME = "VK_LAYER_KHRONOS_profiles";
 static const char* VK_LAYER_KHRONOS_VALIDATION_NAME = "VK_LAYER_KHRONOS_validation";
 
+bool Parameter::HasSharedSettings() const { return this->settings_owner.use_count() > 1; }
+
+void Parameter::DetachSettings(const std::vector<Layer>& available_layers) {
+    if (!this->HasSharedSettings()) return;
+
+    // Without the layer, the settings can't be instantiated but they can't be edited either
+    const Layer* layer = FindByKey(available_layers, this->key.c_str());
+    if (layer == nullptr) return;
+
+    SettingDataSet settings;
+    CollectDefaultSettingData(layer->settings, settings);
+
+    // The settings were collected in the same order, unless the layer was reloaded since
+    for (std::size_t i = 0, n = settings.size(); i < n; ++i) {
+        const SettingData* shared_setting = i < this->settings.size() && this->settings[i]->key == settings[i]->key
+                                                ? this->settings[i]
+                                                : FindSetting(this->settings, settings[i]->key.c_str());
+        if (shared_setting == nullptr || shared_setting->type != settings[i]->type) continue;
+
+        settings[i]->Copy(shared_setting);
+    }
+
+    this->settings = settings;
+    this->settings_owner = std::make_shared<int>(0);
+}
+
 bool Parameter::ApplyPresetSettings(const LayerPreset& preset) {
+    std::unordered_multimap<std::string, SettingData*> setting_index;
+    for (std::size_t i = 0, n = this->settings.size(); i < n; ++i) {
+        setting_index.emplace(this->settings[i]->key, this->settings[i]);
+    }
+
     for (std::size_t preset_index = 0, preset_count = preset.settings.size(); preset_index < preset_count; ++preset_index) {
         const SettingData* preset_setting = preset.settings[preset_index];
 
-        for (std::size_t i = 0, n = this->settings.size(); i < n; ++i) {
-            SettingData* current_setting = this->settings[i];
-
-            if (current_setting->key != preset_setting->key) continue;
+        const auto range = setting_index.equal_range(preset_setting->key);
+        for (auto it = range.first; it != range.second; ++it) {
+            SettingData* current_setting = it->second;
             if (current_setting->type != preset_setting->type) continue;
 
-            this->settings[i]->Copy(preset_setting);
+            current_setting->Copy(preset_setting);
         }
     }
 
@@ -53,7 +84,11 @@ bool Parameter::ApplyPresetSettings(const LayerPreset& preset) {
 ParameterRank GetParameterOrdering(const std::vector<Layer>& available_layers, const Parameter& parameter) {
     assert(!parameter.key.empty());
 
-    const Layer* layer = FindByKey(available_layers, parameter.key.c_str());
+    return GetParameterOrdering(FindByKey(available_layers, parameter.key.c_str()), parameter);
+}
+
+// 'layer' is the layer of the parameter, nullptr when it's missing
+ParameterRank GetParameterOrdering(const Layer* layer, const Parameter& parameter) {
     if (layer == nullptr) {
         return PARAMETER_RANK_MISSING;
     } else if (parameter.state == LAYER_STATE_EXCLUDED) {
@@ -78,11 +113,13 @@ Version ComputeMinApiVersion(const Version api_version, const std::vector<Parame
 
     Version min_version = api_version;
 
+    const KeyIndex<Layer> layer_index(layers);
+
     for (std::size_t i = 0, n = parameters.size(); i < n; ++i) {
-        const Layer* layer = FindByKey(layers, parameters[i].key.c_str());
+        const Layer* layer = layer_index.Find(parameters[i].key);
         if (layer == nullptr) continue;
 
-        const ParameterRank state = GetParameterOrdering(layers, parameters[i]);
+        const ParameterRank state = GetParameterOrdering(layer, parameters[i]);
 
         if (state == PARAMETER_RANK_EXCLUDED) continue;
         if (state == PARAMETER_RANK_MISSING) continue;
@@ -95,11 +132,11 @@ Version ComputeMinApiVersion(const Version api_version, const std::vector<Parame
 
 void OrderParameter(std::vector<Parameter>& parameters, const std::vector<Layer>& layers) {
     struct ParameterCompare {
-        ParameterCompare(const std::vector<Layer>& layers) : layers(layers) {}
+        ParameterCompare(const KeyIndex<Layer>& layer_index) : layer_index(layer_index) {}
 
         bool operator()(const Parameter& a, const Parameter& b) const {
-            const ParameterRank rankA = GetParameterOrdering(layers, a);
-            const ParameterRank rankB = GetParameterOrdering(layers, b);
+            const ParameterRank rankA = GetParameterOrdering(layer_index.Find(a.key), a);
+            const ParameterRank rankB = GetParameterOrdering(layer_index.Find(b.key), b);
             if (rankA == rankB && a.state == LAYER_STATE_OVERRIDDEN) {
                 if (a.overridden_rank != Parameter::NO_RANK && b.overridden_rank != Parameter::NO_RANK)
                     return a.overridden_rank < b.overridden_rank;
@@ -119,10 +156,11 @@ void OrderParameter(std::vector<Parameter>& parameters, const std::vector<Layer>
                 return rankA < rankB;
         }
 
-        const std::vector<Layer>& layers;
+        const KeyIndex<Layer>& layer_index;
     };
 
-    std::sort(parameters.begin(), parameters.end(), ParameterCompare(layers));
+    const KeyIndex<Layer> layer_index(layers);
+    std::sort(parameters.begin(), parameters.end(), ParameterCompare(layer_index));
 
     for (std::size_t i = 0, n = parameters.size(); i < n; ++i) {
         if (parameters[i].state == LAYER_STATE_OVERRIDDEN)
@@ -145,6 +183,8 @@ void FilterParameters(std::vector<Parameter>& parameters, const LayerState state
 }
 
 bool HasMissingLayer(const std::vector<Parameter>& parameters, const std::vector<Layer>& layers, std::string& missing_layer) {
+    const KeyIndex<Layer> layer_index(layers);
+
     for (auto it = parameters.begin(), end = parameters.end(); it != end; ++it) {
         if (it->state == LAYER_STATE_EXCLUDED) {
             continue;  // If excluded are missing, it doesn't matter
@@ -154,7 +194,7 @@ bool HasMissingLayer(const std::vector<Parameter>& parameters, const std::vector
             continue;  // If unsupported are missing, it doesn't matter
         }
 
-        if (!IsFound(layers, it->key.c_str())) {
+        if (!layer_index.IsFound(it->key)) {
             missing_layer = it->key;
             return true;
         }
@@ -180,13 +220,15 @@ std::size_t CountOverriddenLayers(const std::vector<Parameter>& parameters) {
 std::size_t CountExcludedLayers(const std::vector<Parameter>& parameters, const std::vector<Layer>& layers) {
     std::size_t count = 0;
 
+    const KeyIndex<Layer> layer_index(layers);
+
     for (std::size_t i = 0, n = parameters.size(); i < n; ++i) {
         const Parameter& parameter = parameters[i];
         if (!IsPlatformSupported(parameter.platform_flags)) continue;
 
         if (parameter.state != LAYER_STATE_EXCLUDED) continue;
 
-        const Layer* layer = FindByKey(layers, parameter.key.c_str());
+        const Layer* layer = layer_index.Find(parameter.key);
         if (layer == nullptr) continue;  // Do not display missing excluded layers
 
         ++count;
@@ -206,11 +248,13 @@ std::vector<Parameter> GatherParameters(const std::vector<Parameter>& parameters
         gathered_parameters.push_back(parameter);
     }
 
+    const KeyIndex<Parameter> parameter_index(parameters);
+
     for (std::size_t i = 0, n = available_layers.size(); i < n; ++i) {
         const Layer& layer = available_layers[i];
 
         // The layer is already in the layer tree
-        if (IsFound(parameters, layer.key.c_str())) continue;
+        if (parameter_index.IsFound(layer.key)) continue;
 
         Parameter parameter;
         parameter.key = layer.key;
@@ -24,6 +24,7 @@
 #include "layer_state.h"
 #include "setting.h"
 
+#include <memory>
 #include <vector>
 
 enum ParameterRank {
@@ -38,15 +39,28 @@ enum ParameterRank {
 struct Parameter {
     static const int NO_RANK = -1;
 
-    Parameter() : state(LAYER_STATE_APPLICATION_CONTROLLED), platform_flags(PLATFORM_DESKTOP_BIT), overridden_rank(NO_RANK) {
+    Parameter()
+        : state(LAYER_STATE_APPLICATION_CONTROLLED),
+          platform_flags(PLATFORM_DESKTOP_BIT),
+          overridden_rank(NO_RANK),
+          settings_owner(std::make_shared<int>(0)) {
         assert(true);
     }
 
     Parameter(const std::string& key, const LayerState state)
-        : key(key), state(state), platform_flags(PLATFORM_DESKTOP_BIT), overridden_rank(NO_RANK) {
+        : key(key),
+          state(state),
+          platform_flags(PLATFORM_DESKTOP_BIT),
+          overridden_rank(NO_RANK),
+          settings_owner(std::make_shared<int>(0)) {
         assert(true);
     }
 
+    // The copies of a parameter share its setting data until DetachSettings is called on one of them,
+    // so it must be called before modifying the settings of a parameter that may have been copied
+    bool HasSharedSettings() const;
+    void DetachSettings(const std::vector<Layer>& available_layers);
+
     bool ApplyPresetSettings(const LayerPreset& preset);
 
     std::string key;
@@ -55,9 +69,13 @@ struct Parameter {
     SettingDataSet settings;
     int overridden_rank;
     Version api_version;
+
+   private:
+    std::shared_ptr<int> settings_owner;  // Shared by the parameters sharing the same setting data
 };
 
 ParameterRank GetParameterOrdering(const std::vector<Layer>& available_layers, const Parameter& parameter);
+ParameterRank GetParameterOrdering(const Layer* layer, const Parameter& parameter);
 Version ComputeMinApiVersion(const Version api_version, const std::vector<Parameter>& parameters, const std::vector<Layer>& layers);
 void OrderParameter(std::vector<Parameter>& parameters, const std::vector<Layer>& layers);
 void FilterParameters(std::vector<Parameter>& parameters, const LayerState state);
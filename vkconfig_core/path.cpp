@@ -28,8 +28,11 @@
 #include <QDir>
 #include <QJsonDocument>
 
+#include <array>
 #include <cassert>
 #include <cstring>
+#include <map>
+#include <mutex>
 
 Path::Path() {}
 
@@ -48,6 +51,33 @@ const char* Path::c_str() const {
     return data.c_str();
 }
 
+// The directory existence checks, until the file system may have changed
+static std::mutex directories_mutex;
+static std::map<std::string, bool> directories;
+
+static void RecordDirectory(const std::string& path, bool exists) {
+    std::lock_guard<std::mutex> lock(directories_mutex);
+    directories[path] = exists;
+}
+
+bool CheckDirectoryExists(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(directories_mutex);
+
+        std::map<std::string, bool>::const_iterator it = directories.find(path);
+        if (it != directories.end()) return it->second;
+    }
+
+    const bool exists = QDir(path.c_str()).exists();
+    RecordDirectory(path, exists);
+    return exists;
+}
+
+void InvalidatePathCache() {
+    std::lock_guard<std::mutex> lock(directories_mutex);
+    directories.clear();
+}
+
 void CheckPathsExist(const std::string& path, bool is_full_path) {
     QString tmp_path(ConvertNativeSeparators(path).c_str());
 
@@ -56,14 +86,57 @@ void CheckPathsExist(const std::string& path, bool is_full_path) {
         tmp_path = file_info.absoluteDir().absolutePath();
     }
 
+    if (CheckDirectoryExists(tmp_path.toStdString())) return;
+
     QDir dir;
-    if (!dir.exists(tmp_path)) {
-        dir.mkpath(tmp_path);
-        assert(dir.exists(tmp_path));
-    }
+    dir.mkpath(tmp_path);
+    assert(dir.exists(tmp_path));
+
+    RecordDirectory(tmp_path.toStdString(), true);
+}
+
+static std::string ResolvePath(BuiltinPath path);
+
+// The values the built-in paths are resolved from
+static std::string GetPathEnvironment() {
+    return QDir().homePath().toStdString() + '\n' + qgetenv("VULKAN_SDK").toStdString() + '\n' +
+           qgetenv("VK_LAYER_SETTINGS_PATH").toStdString();
 }
 
 std::string GetPath(BuiltinPath path) {
+    assert(path >= BUILTIN_PATH_FIRST && path <= BUILTIN_PATH_LAST);
+
+    static std::mutex mutex;
+    static std::string environment;
+    static std::array<std::string, BUILTIN_PATH_COUNT> paths;
+    static std::array<bool, BUILTIN_PATH_COUNT> resolved;
+
+    const std::string current_environment = GetPathEnvironment();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (environment != current_environment) {
+            environment = current_environment;
+            resolved.fill(false);
+        }
+
+        if (resolved[path]) return paths[path];
+    }
+
+    // Resolved without the lock held, the built-in paths are resolved from other built-in paths
+    const std::string result = ResolvePath(path);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (environment == current_environment) {
+        paths[path] = result;
+        resolved[path] = true;
+    }
+
+    return result;
+}
+
+static std::string ResolvePath(BuiltinPath path) {
     std::string result;
 
     switch (path) {
@@ -98,6 +171,10 @@ std::string GetPath(BuiltinPath path) {
             result = GetPath(BUILTIN_PATH_CONFIG_LAST) + "/../applist.json";
             break;
         }
+        case BUILTIN_PATH_LAYERS_CACHE: {
+            result = GetPath(BUILTIN_PATH_CONFIG_LAST) + "/../layers_cache.json";
+            break;
+        }
         case BUILTIN_PATH_OVERRIDE_SETTINGS: {
             static const char* TABLE[] = {
                 "/vkconfig/override",  // ENVIRONMENT_WIN32
@@ -198,6 +275,8 @@ struct BuiltinDesc {
 };
 
 std::string ReplaceBuiltInVariable(const std::string& path) {
+    if (path.find("${") == std::string::npos) return path;
+
     static const BuiltinDesc VARIABLES[] = {{BUILTIN_PATH_HOME, "${HOME}"},
                                             {BUILTIN_PATH_LOCAL_LEGACY, "${LOCAL}"},
                                             {BUILTIN_PATH_LOCAL, "${VK_LOCAL}"},
@@ -223,16 +302,20 @@ std::string ConvertSeparators(const std::string& path, const char* native_separa
     const std::size_t native_separator_size = std::strlen(native_separator);
     const std::size_t alien_separator_size = std::strlen(alien_separator);
 
-    std::string current_path = path;
-    while (current_path.find_first_of(alien_separator) < current_path.size()) {
-        const std::size_t found = current_path.find_first_of(alien_separator);
-        const std::size_t size = current_path.size();
-
-        if (found < size - alien_separator_size)
-            current_path = current_path.substr(0, found) + native_separator +
-                           current_path.substr(found + alien_separator_size, size - found - alien_separator_size);
-        else
-            current_path = current_path.substr(0, found);
+    std::string current_path;
+    current_path.reserve(path.size());
+
+    // Replaces the alien separators in a single pass, a trailing alien separator ends the path
+    for (std::size_t i = 0, n = path.size(); i < n;) {
+        if (std::strchr(alien_separator, path[i]) == nullptr || path[i] == '\0') {
+            current_path += path[i];
+            ++i;
+        } else if (i < n - alien_separator_size) {
+            current_path += native_separator;
+            i += alien_separator_size;
+        } else {
+            break;
+        }
     }
 
     // Remove trailing native separator
@@ -278,10 +361,28 @@ bool IsPortableFilename(const std::string& path) {
 }
 
 QFileInfoList GetJSONFiles(const char* directory) {
+    static std::mutex mutex;
+    static std::map<std::string, QFileInfoList> resource_files;
+
+    const bool is_resource = std::strncmp(directory, ":/", 2) == 0;
+    if (is_resource) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::map<std::string, QFileInfoList>::const_iterator it = resource_files.find(directory);
+        if (it != resource_files.end()) return it->second;
+    }
+
     QDir dir(directory);
     dir.setFilter(QDir::Files | QDir::NoSymLinks);
     dir.setNameFilters(QStringList() << "*.json");
-    return dir.entryInfoList();
+    const QFileInfoList files = dir.entryInfoList();
+
+    if (is_resource) {
+        std::lock_guard<std::mutex> lock(mutex);
+        resource_files[directory] = files;
+    }
+
+    return files;
 }
 
 std::string ExtractAbsoluteDir(const std::string& path) {
@@ -32,6 +32,7 @@ enum BuiltinPath {
     BUILTIN_PATH_CONFIG_REF,
     BUILTIN_PATH_CONFIG_LAST,
     BUILTIN_PATH_APPLIST,
+    BUILTIN_PATH_LAYERS_CACHE,
     BUILTIN_PATH_OVERRIDE_LAYERS,
     BUILTIN_PATH_OVERRIDE_SETTINGS,
     BUILTIN_PATH_EXPLICIT_LAYERS,
@@ -68,6 +69,13 @@ const char* GetNativeSeparator();
 // Create a directory if it doesn't exist
 void CheckPathsExist(const std::string& path, bool is_full_path = false);
 
+// Whether the directory exists. The result is remembered until InvalidatePathCache is called.
+bool CheckDirectoryExists(const std::string& path);
+
+// Forget the directory existence checks, to call when the file system may have changed, such as when the layers are searched
+void InvalidatePathCache();
+
+// The built-in paths are resolved again only when the home directory or the environment variables they use change
 std::string GetPath(BuiltinPath path);
 
 // Replace built-in variable by the actual path
@@ -75,6 +83,7 @@ std::string ReplaceBuiltInVariable(const std::string& path);
 
 bool IsPortableFilename(const std::string& path);
 
+// The listings of the resource directories are remembered, they don't change
 QFileInfoList GetJSONFiles(const char* directory);
 
 std::string ExtractAbsoluteDir(const std::string& path);
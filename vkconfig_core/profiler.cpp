@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "profiler.h"
+#include "util.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+struct ProfilerNode {
+    explicit ProfilerNode(const char* name) : name(name), count(0), duration(std::chrono::steady_clock::duration::zero()) {}
+
+    std::string name;
+    std::size_t count;
+    std::chrono::steady_clock::duration duration;
+    std::vector<std::size_t> children;
+};
+
+static const std::size_t PROFILER_ROOT = 0;
+
+static std::atomic<bool> profiler_enabled(false);
+static std::mutex profiler_mutex;
+static std::vector<ProfilerNode> profiler_nodes(1, ProfilerNode(""));
+static thread_local std::size_t profiler_current = PROFILER_ROOT;
+
+ScopedTimer::ScopedTimer(const char* name) : enabled(profiler_enabled), node(PROFILER_ROOT), parent(profiler_current) {
+    if (!this->enabled) return;
+
+    {
+        std::lock_guard<std::mutex> lock(profiler_mutex);
+
+        const std::vector<std::size_t>& children = profiler_nodes[this->parent].children;
+        for (std::size_t i = 0, n = children.size(); i < n && this->node == PROFILER_ROOT; ++i) {
+            if (profiler_nodes[children[i]].name == name) this->node = children[i];
+        }
+
+        if (this->node == PROFILER_ROOT) {
+            this->node = profiler_nodes.size();
+            profiler_nodes.push_back(ProfilerNode(name));
+            profiler_nodes[this->parent].children.push_back(this->node);
+        }
+    }
+
+    profiler_current = this->node;
+    this->start = std::chrono::steady_clock::now();
+}
+
+ScopedTimer::~ScopedTimer() {
+    if (!this->enabled) return;
+
+    const std::chrono::steady_clock::duration duration = std::chrono::steady_clock::now() - this->start;
+
+    profiler_current = this->parent;
+
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    ++profiler_nodes[this->node].count;
+    profiler_nodes[this->node].duration += duration;
+}
+
+void EnableProfiler(bool enabled) { profiler_enabled = enabled; }
+
+bool IsProfilerEnabled() { return profiler_enabled; }
+
+void ResetProfiler() {
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+
+    profiler_nodes.erase(profiler_nodes.begin() + 1, profiler_nodes.end());
+    profiler_nodes[PROFILER_ROOT].children.clear();
+}
+
+static void AppendReport(std::string& report, std::size_t node, int depth) {
+    const ProfilerNode& profiler_node = profiler_nodes[node];
+
+    const double milliseconds = std::chrono::duration<double, std::milli>(profiler_node.duration).count();
+    report += format("%*s%s: %.3f ms", depth * 2, "", profiler_node.name.c_str(), milliseconds);
+    if (profiler_node.count > 1) {
+        report += format(" (%d calls)", static_cast<int>(profiler_node.count));
+    }
+    report += "\n";
+
+    for (std::size_t i = 0, n = profiler_node.children.size(); i < n; ++i) {
+        AppendReport(report, profiler_node.children[i], depth + 1);
+    }
+}
+
+std::string GetProfilerReport() {
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+
+    std::string report;
+    const std::vector<std::size_t>& children = profiler_nodes[PROFILER_ROOT].children;
+    for (std::size_t i = 0, n = children.size(); i < n; ++i) {
+        AppendReport(report, children[i], 0);
+    }
+
+    return report;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Measures the duration of a scope when the profiler is enabled. The scopes nested on the same thread are reported as children
+// of the enclosing scope, the scopes of the worker threads are reported at the root. The durations of the scopes with the same
+// name and parent are accumulated.
+class ScopedTimer {
+   public:
+    explicit ScopedTimer(const char* name);
+    ~ScopedTimer();
+
+   private:
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    bool enabled;
+    std::size_t node;
+    std::size_t parent;
+    std::chrono::steady_clock::time_point start;
+};
+
+void EnableProfiler(bool enabled);
+bool IsProfilerEnabled();
+
+// Discards the measured durations, must not be called while a ScopedTimer is alive
+void ResetProfiler();
+
+// Hierarchical report of the measured durations, in milliseconds
+std::string GetProfilerReport();
@@ -19,9 +19,12 @@
  */
 
 #include "registry.h"
+#include "util.h"
 
 #include <QTextStream>
 
+#include <utility>
+
 #if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
 #include <windows.h>
 #include <winreg.h>
@@ -83,7 +86,7 @@ void RemoveRegistryEntriesForLayers(QString override_file, QString settings_file
 }
 
 /// Look for device specific layers
-static void LoadDeviceRegistry(DEVINST id, const QString &entry, std::vector<Layer> &layers, LayerType type) {
+static void FindDeviceRegistryManifests(DEVINST id, const QString &entry, QStringList &manifests) {
     HKEY key;
     if (CM_Open_DevNode_Key(id, KEY_QUERY_VALUE, 0, RegDisposition_OpenExisting, &key, CM_REGISTRY_SOFTWARE) != CR_SUCCESS) return;
 
@@ -103,10 +106,7 @@ static void LoadDeviceRegistry(DEVINST id, const QString &entry, std::vector<Lay
 
     if (data_type == REG_SZ || data_type == REG_MULTI_SZ) {
         for (wchar_t *curr_filename = path; curr_filename[0] != '\0'; curr_filename += wcslen(curr_filename) + 1) {
-            Layer layer;
-            if (layer.Load(layers, QString::fromWCharArray(curr_filename).toStdString(), type)) {
-                layers.push_back(layer);
-            }
+            manifests.append(QString::fromWCharArray(curr_filename));
 
             if (data_type == REG_SZ) {
                 break;
@@ -119,23 +119,8 @@ static void LoadDeviceRegistry(DEVINST id, const QString &entry, std::vector<Lay
 }
 
 /// This is for Windows only. It looks for device specific layers in the Windows registry.
-void LoadRegistryLayers(const QString &path, std::vector<Layer> &layers, LayerType type) {
-    QString root_string = path.section('\\', 0, 0);
-    static QHash<QString, HKEY> root_keys = {
-        {"HKEY_CLASSES_ROOT", HKEY_CLASSES_ROOT},
-        {"HKEY_CURRENT_CONFIG", HKEY_CURRENT_CONFIG},
-        {"HKEY_CURRENT_USER", HKEY_CURRENT_USER},
-        {"HKEY_LOCAL_MACHINE", HKEY_LOCAL_MACHINE},
-        {"HKEY_USERS", HKEY_USERS},
-    };
-
-    HKEY root = HKEY_CURRENT_USER;
-    for (auto label : root_keys.keys()) {
-        if (label == root_string) {
-            root = root_keys[label];
-            break;
-        }
-    }
+QStringList FindRegistryLayerManifests(const QString &path) {
+    QStringList manifests;
 
     static const QString DISPLAY_GUID = "{4d36e968-e325-11ce-bfc1-08002be10318}";
     static const QString SOFTWARE_COMPONENT_GUID = "{5c4c3332-344d-483c-8739-259e934c9cc8}";
@@ -153,13 +138,10 @@ void LoadRegistryLayers(const QString &path, std::vector<Layer> &layers, LayerTy
 
     if (device_names != nullptr) {
         QString entry;
-        // This has already been set by now
         if (path.endsWith("VulkanExplicitLayers")) {
             entry = "VulkanExplicitLayers";
-            type = LAYER_TYPE_EXPLICIT;
         } else if (path.endsWith("VulkanImplicitLayers")) {
             entry = "VulkanImplicitLayers";
-            type = LAYER_TYPE_IMPLICIT;
         }
 
         for (wchar_t *device_name = device_names; device_name[0] != '\0'; device_name += wcslen(device_name) + 1) {
@@ -167,7 +149,7 @@ void LoadRegistryLayers(const QString &path, std::vector<Layer> &layers, LayerTy
             if (CM_Locate_DevNodeW(&device_id, device_name, CM_LOCATE_DEVNODE_NORMAL) != CR_SUCCESS) {
                 continue;
             }
-            LoadDeviceRegistry(device_id, entry, layers, type);
+            FindDeviceRegistryManifests(device_id, entry, manifests);
 
             DEVINST child_id;
             if (CM_Get_Child(&child_id, device_id, 0) != CR_SUCCESS) {
@@ -184,7 +166,7 @@ void LoadRegistryLayers(const QString &path, std::vector<Layer> &layers, LayerTy
                     continue;
                 }
                 if (wcscmp(child_guid, (LPCWSTR)SOFTWARE_COMPONENT_GUID.utf16()) == 0) {
-                    LoadDeviceRegistry(child_id, entry, layers, type);
+                    FindDeviceRegistryManifests(child_id, entry, manifests);
                     break;
                 }
             } while (CM_Get_Sibling(&child_id, child_id, 0) == CR_SUCCESS);
@@ -194,6 +176,74 @@ void LoadRegistryLayers(const QString &path, std::vector<Layer> &layers, LayerTy
     if (device_names != nullptr) {
         delete[] device_names;
     }
+
+    return manifests;
+}
+
+static const DWORD REGISTRY_NOTIFY_FILTER = REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET;
+
+RegistryWatcher::RegistryWatcher(const std::function<void()> &changed) : changed(changed) {
+    struct WatchedPath {
+        HKEY root;
+        const wchar_t *path;
+        BOOL watch_subtree;
+    };
+
+    static const WatchedPath PATHS[] = {
+        {HKEY_LOCAL_MACHINE, L"Software\\Khronos\\Vulkan\\ExplicitLayers", FALSE},
+        {HKEY_LOCAL_MACHINE, L"Software\\Khronos\\Vulkan\\ImplicitLayers", FALSE},
+        {HKEY_CURRENT_USER, L"Software\\Khronos\\Vulkan\\ExplicitLayers", FALSE},
+        {HKEY_CURRENT_USER, L"Software\\Khronos\\Vulkan\\ImplicitLayers", FALSE},
+        // The display adapters and software components classes, where the drivers register their layers
+        {HKEY_LOCAL_MACHINE, L"System\\CurrentControlSet\\Control\\Class\\{4d36e968-e325-11ce-bfc1-08002be10318}", TRUE},
+        {HKEY_LOCAL_MACHINE, L"System\\CurrentControlSet\\Control\\Class\\{5c4c3332-344d-483c-8739-259e934c9cc8}", TRUE}};
+
+    this->keys.reserve(countof(PATHS));
+
+    for (std::size_t i = 0, n = countof(PATHS); i < n; ++i) {
+        HKEY key;
+        if (RegOpenKeyExW(PATHS[i].root, PATHS[i].path, 0, KEY_NOTIFY, &key) != ERROR_SUCCESS) continue;
+
+        HANDLE event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+        if (event == nullptr) {
+            RegCloseKey(key);
+            continue;
+        }
+
+        if (RegNotifyChangeKeyValue(key, PATHS[i].watch_subtree, REGISTRY_NOTIFY_FILTER, event, TRUE) != ERROR_SUCCESS) {
+            CloseHandle(event);
+            RegCloseKey(key);
+            continue;
+        }
+
+        const std::size_t index = this->keys.size();
+
+        WatchedKey watched_key;
+        watched_key.key = key;
+        watched_key.watch_subtree = PATHS[i].watch_subtree;
+        watched_key.event = event;
+        watched_key.notifier = new QWinEventNotifier(event);
+        QObject::connect(watched_key.notifier, &QWinEventNotifier::activated, [this, index]() { this->OnKeyChanged(index); });
+
+        this->keys.push_back(watched_key);
+    }
+}
+
+RegistryWatcher::~RegistryWatcher() {
+    for (std::size_t i = 0, n = this->keys.size(); i < n; ++i) {
+        delete this->keys[i].notifier;
+        CloseHandle(this->keys[i].event);
+        RegCloseKey(this->keys[i].key);
+    }
+}
+
+void RegistryWatcher::OnKeyChanged(std::size_t index) {
+    const WatchedKey &watched_key = this->keys[index];
+
+    // A notification is only sent once, the key is watched again before the layers are searched
+    RegNotifyChangeKeyValue(watched_key.key, watched_key.watch_subtree, REGISTRY_NOTIFY_FILTER, watched_key.event, TRUE);
+
+    this->changed();
 }
 
 #endif  // VKC_PLATFORM == VKC_PLATFORM_WINDOWS
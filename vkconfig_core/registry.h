@@ -25,14 +25,44 @@
 
 #if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
 
+#include <windows.h>
+
 #include <QString>
+#include <QStringList>
+#include <QWinEventNotifier>
 
+#include <functional>
 #include <vector>
 
 void AppendRegistryEntriesForLayers(QString override_file, QString settings_file);
 
 void RemoveRegistryEntriesForLayers(QString override_file, QString settings_file);
 
-void LoadRegistryLayers(const QString &path, std::vector<Layer> &layers, LayerType type);
+// The layer manifests of the display drivers, registered in their device registry keys
+QStringList FindRegistryLayerManifests(const QString &path);
+
+// Calls 'changed' when the registry keys the layers are searched in change, the display driver keys included. The keys which
+// don't exist when the watcher is created are not watched.
+class RegistryWatcher {
+   public:
+    explicit RegistryWatcher(const std::function<void()> &changed);
+    ~RegistryWatcher();
+
+   private:
+    RegistryWatcher(const RegistryWatcher &) = delete;
+    RegistryWatcher &operator=(const RegistryWatcher &) = delete;
+
+    void OnKeyChanged(std::size_t index);
+
+    struct WatchedKey {
+        HKEY key;
+        BOOL watch_subtree;
+        HANDLE event;
+        QWinEventNotifier *notifier;
+    };
+
+    std::vector<WatchedKey> keys;
+    std::function<void()> changed;
+};
 
 #endif  // VKC_PLATFORM == VKC_PLATFORM_WINDOWS
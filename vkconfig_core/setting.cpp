@@ -18,6 +18,7 @@
  * - Christophe Riccio <christophe@lunarg.com>
  */
 
+#include "layer.h"
 #include "setting_bool.h"
 #include "setting_filesystem.h"
 #include "setting_flags.h"
@@ -30,6 +31,7 @@
 #include "util.h"
 #include "version.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include <QJsonArray>
@@ -90,18 +92,43 @@ bool SettingData::Equal(const SettingData& other) const {
     return true;
 }
 
+SettingArena::~SettingArena() {
+    for (std::size_t i = this->destructors.size(); i > 0; --i) {
+        this->destructors[i - 1].destroy(this->destructors[i - 1].object);
+    }
+}
+
+static char* AlignPointer(char* pointer, std::size_t alignment) {
+    return pointer + (alignment - reinterpret_cast<std::uintptr_t>(pointer) % alignment) % alignment;
+}
+
+void* SettingArena::Allocate(std::size_t size, std::size_t alignment) {
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    // Objects larger than a block get a block of their own, the current block remains in use
+    if (size + alignment > BLOCK_SIZE) {
+        this->blocks.push_back(std::unique_ptr<char[]>(new char[size + alignment]));
+        return AlignPointer(this->blocks.back().get(), alignment);
+    }
+
+    char* memory = this->block == nullptr ? nullptr : AlignPointer(this->block + this->block_used, alignment);
+    if (memory == nullptr || memory + size > this->block + BLOCK_SIZE) {
+        this->blocks.push_back(std::unique_ptr<char[]>(new char[BLOCK_SIZE]));
+        this->block = this->blocks.back().get();
+        memory = AlignPointer(this->block, alignment);
+    }
+
+    this->block_used = static_cast<std::size_t>(memory + size - this->block);
+    return memory;
+}
+
 SettingMeta::SettingMeta(Layer& layer, const std::string& key, const SettingType type)
-    : key(key), type(type), dependence_mode(DEPENDENCE_NONE), layer(layer) {
+    : key(key), type(type), dependence_mode(DEPENDENCE_NONE), layer(layer), arena(*layer.memory) {
     assert(!this->key.empty());
     assert(type >= SETTING_FIRST && type <= SETTING_LAST);
 }
 
-SettingMeta::~SettingMeta() {
-    for (std::size_t i = 0, n = this->instances.size(); i < n; ++i) {
-        delete this->instances[i];
-        this->instances[i] = nullptr;
-    }
-}
+SettingMeta::~SettingMeta() {}
 
 bool IsSupported(const SettingMeta* meta) {
     if (meta == nullptr) return false;
@@ -211,6 +238,63 @@ const SettingMeta* FindSetting(const SettingMetaSet& settings, const char* key)
     return nullptr;
 }
 
+SettingMetaIndex::SettingMetaIndex(const SettingMetaSet& settings) { Insert(settings); }
+
+const SettingMeta* SettingMetaIndex::Find(const std::string& key) const {
+    auto it = index.find(key);
+    return it == index.end() ? nullptr : it->second;
+}
+
+void SettingMetaIndex::Insert(const SettingMetaSet& settings) {
+    for (std::size_t i = 0, n = settings.size(); i < n; ++i) {
+        index.insert(std::make_pair(settings[i]->key, settings[i]));
+
+        Insert(settings[i]->children);
+
+        if (IsEnum(settings[i]->type) || IsFlags(settings[i]->type)) {
+            const SettingMetaEnum& setting_meta_enum = static_cast<const SettingMetaEnum&>(*settings[i]);
+
+            for (std::size_t j = 0, o = setting_meta_enum.enum_values.size(); j < o; ++j) {
+                Insert(setting_meta_enum.enum_values[j].settings);
+            }
+        }
+    }
+}
+
+SettingDependents::SettingDependents(const SettingMetaSet& settings) { Insert(settings); }
+
+const std::vector<const SettingMeta*>& SettingDependents::Find(const std::string& key) const {
+    static const std::vector<const SettingMeta*> no_dependents;
+
+    auto it = dependents.find(key);
+    return it == dependents.end() ? no_dependents : it->second;
+}
+
+void SettingDependents::Insert(const SettingMetaSet& settings) {
+    for (std::size_t i = 0, n = settings.size(); i < n; ++i) {
+        const SettingMeta* setting_meta = settings[i];
+
+        for (std::size_t j = 0, o = setting_meta->dependence.size(); j < o; ++j) {
+            std::vector<const SettingMeta*>& key_dependents = dependents[setting_meta->dependence[j]->key];
+
+            // A dependence may list several values of a key
+            if (std::find(key_dependents.begin(), key_dependents.end(), setting_meta) == key_dependents.end()) {
+                key_dependents.push_back(setting_meta);
+            }
+        }
+
+        Insert(setting_meta->children);
+
+        if (IsEnum(setting_meta->type) || IsFlags(setting_meta->type)) {
+            const SettingMetaEnum& setting_meta_enum = static_cast<const SettingMetaEnum&>(*setting_meta);
+
+            for (std::size_t j = 0, o = setting_meta_enum.enum_values.size(); j < o; ++j) {
+                Insert(setting_meta_enum.enum_values[j].settings);
+            }
+        }
+    }
+}
+
 SettingData* FindSetting(SettingDataSet& settings, const char* key) {
     for (std::size_t i = 0, n = settings.size(); i < n; ++i) {
         if (settings[i]->key == key) {
@@ -24,8 +24,12 @@
 
 #include <memory>
 #include <vector>
+#include <unordered_map>
 #include <cassert>
+#include <cstdint>
 #include <limits>
+#include <new>
+#include <utility>
 
 #include <QJsonObject>
 
@@ -110,6 +114,51 @@ typedef std::vector<SettingMeta*> SettingMetaSet;
 typedef std::vector<SettingData*> SettingDataSet;
 typedef std::vector<const SettingData*> SettingDataSetConst;
 
+// Bump allocator owning the setting objects of a layer, so that the many small SettingMeta and SettingData objects created
+// while loading the layer manifests are packed in a few blocks and released at once. The objects are destroyed in the reverse
+// order of their creation when the arena is deleted. Not thread safe: an arena is only used by the thread loading its layer.
+class SettingArena {
+   public:
+    SettingArena() : block(nullptr), block_used(0) {}
+    ~SettingArena();
+
+    void* Allocate(std::size_t size, std::size_t alignment);
+
+    // The object will be destroyed by the arena
+    template <typename T>
+    T* Track(T* object) {
+        this->destructors.push_back(Destructor{object, &SettingArena::Destroy<T>});
+        return object;
+    }
+
+    template <typename T, typename... Args>
+    T* Create(Args&&... args) {
+        void* memory = this->Allocate(sizeof(T), alignof(T));
+        return this->Track(new (memory) T(std::forward<Args>(args)...));
+    }
+
+   private:
+    SettingArena(const SettingArena&) = delete;
+    SettingArena& operator=(const SettingArena&) = delete;
+
+    template <typename T>
+    static void Destroy(void* object) {
+        static_cast<T*>(object)->~T();
+    }
+
+    struct Destructor {
+        void* object;
+        void (*destroy)(void* object);
+    };
+
+    enum { BLOCK_SIZE = 16 * 1024 };
+
+    std::vector<std::unique_ptr<char[]> > blocks;
+    char* block;  // The block of the next allocations
+    std::size_t block_used;
+    std::vector<Destructor> destructors;
+};
+
 struct SettingMeta : public Header {
     SettingMeta(Layer& layer, const std::string& key, const SettingType type);
     virtual ~SettingMeta();
@@ -133,7 +182,8 @@ struct SettingMeta : public Header {
     virtual bool Equal(const SettingMeta& other) const;
     Layer& layer;
 
-    std::vector<SettingData*> instances;
+    // Owns the instances of the setting, shared with the layer
+    SettingArena& arena;
 };
 
 struct SettingData {
@@ -194,6 +244,35 @@ const T* FindSetting(const SettingDataSet& settings, const char* key) {
     return static_cast<const T*>(FindSetting(settings, key));
 }
 
+// Hash index of a setting tree by key, for the functions looking up many settings.
+// Like FindSetting, the first setting of a key in depth first order is found. The index is invalidated when the tree is modified.
+class SettingMetaIndex {
+   public:
+    explicit SettingMetaIndex(const SettingMetaSet& settings);
+
+    const SettingMeta* Find(const std::string& key) const;
+
+   private:
+    void Insert(const SettingMetaSet& settings);
+
+    std::unordered_map<std::string, const SettingMeta*> index;
+};
+
+// Reverse graph of the setting dependences: for each setting key, the settings with a dependence on that key.
+// When a setting changes, only its dependents need their dependence to be checked again.
+class SettingDependents {
+   public:
+    SettingDependents() {}
+    explicit SettingDependents(const SettingMetaSet& settings);
+
+    const std::vector<const SettingMeta*>& Find(const std::string& key) const;
+
+   private:
+    void Insert(const SettingMetaSet& settings);
+
+    std::unordered_map<std::string, std::vector<const SettingMeta*> > dependents;
+};
+
 std::size_t CountSettings(const SettingMetaSet& settings);
 
 bool CheckSettingOverridden(const SettingMeta& meta);
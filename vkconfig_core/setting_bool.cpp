@@ -31,9 +31,8 @@ SettingMetaBool::SettingMetaBool(Layer& layer, const std::string& key, const Set
     : SettingMeta(layer, key, type), default_value(false) {}
 
 SettingData* SettingMetaBool::Instantiate() {
-    SettingData* setting_data = new SettingDataBool(this);
+    SettingData* setting_data = this->arena.Create<SettingDataBool>(this);
     setting_data->Reset();
-    this->instances.push_back(setting_data);
     return setting_data;
 }
 
@@ -94,7 +93,7 @@ const SettingType SettingMetaBoolNumeric::TYPE(SETTING_BOOL_NUMERIC_DEPRECATED);
 
 SettingMetaBoolNumeric::SettingMetaBoolNumeric(Layer& layer, const std::string& key) : SettingMetaBool(layer, key, TYPE) {}
 
-SettingData* SettingMetaBoolNumeric::Instantiate() { return new SettingDataBoolNumeric(this); }
+SettingData* SettingMetaBoolNumeric::Instantiate() { return this->arena.Create<SettingDataBoolNumeric>(this); }
 
 std::string SettingMetaBoolNumeric::Export(ExportMode export_mode) const {
     (void)export_mode;
@@ -85,9 +85,8 @@ const SettingType SettingMetaFileLoad::TYPE(SETTING_LOAD_FILE);
 SettingMetaFileLoad::SettingMetaFileLoad(Layer& layer, const std::string& key) : SettingMetaFilesystem(layer, key, TYPE) {}
 
 SettingData* SettingMetaFileLoad::Instantiate() {
-    SettingData* setting_data = new SettingDataFileLoad(this);
+    SettingData* setting_data = this->arena.Create<SettingDataFileLoad>(this);
     setting_data->Reset();
-    this->instances.push_back(setting_data);
     return setting_data;
 }
 
@@ -122,9 +121,8 @@ const SettingType SettingMetaFileSave::TYPE(SETTING_SAVE_FILE);
 SettingMetaFileSave::SettingMetaFileSave(Layer& layer, const std::string& key) : SettingMetaFilesystem(layer, key, TYPE) {}
 
 SettingData* SettingMetaFileSave::Instantiate() {
-    SettingData* setting_data = new SettingDataFileSave(this);
+    SettingData* setting_data = this->arena.Create<SettingDataFileSave>(this);
     setting_data->Reset();
-    this->instances.push_back(setting_data);
     return setting_data;
 }
 
@@ -149,9 +147,8 @@ const SettingType SettingMetaFolderSave::TYPE(SETTING_SAVE_FOLDER);
 SettingMetaFolderSave::SettingMetaFolderSave(Layer& layer, const std::string& key) : SettingMetaFilesystem(layer, key, TYPE) {}
 
 SettingData* SettingMetaFolderSave::Instantiate() {
-    SettingData* setting_data = new SettingDataFolderSave(this);
+    SettingData* setting_data = this->arena.Create<SettingDataFolderSave>(this);
     setting_data->Reset();
-    this->instances.push_back(setting_data);
     return setting_data;
 }
 
@@ -70,9 +70,8 @@ const SettingType SettingMetaEnum::TYPE = SETTING_ENUM;
 SettingMetaEnum::SettingMetaEnum(Layer& layer, const std::string& key) : SettingMetaEnumeration(layer, key, TYPE) {}
 
 SettingData* SettingMetaEnum::Instantiate() {
-    SettingData* setting_data = new SettingDataEnum(this);
+    SettingData* setting_data = this->arena.Create<SettingDataEnum>(this);
     setting_data->Reset();
-    this->instances.push_back(setting_data);
     return setting_data;
 }
 
@@ -116,9 +115,8 @@ const SettingType SettingMetaFlags::TYPE(SETTING_FLAGS);
 SettingMetaFlags::SettingMetaFlags(Layer& layer, const std::string& key) : SettingMetaEnumeration(layer, key, TYPE) {}
 
 SettingData* SettingMetaFlags::Instantiate() {
-    SettingData* setting_data = new SettingDataFlags(this);
+    SettingData* setting_data = this->arena.Create<SettingDataFlags>(this);
     setting_data->Reset();
-    this->instances.push_back(setting_data);
     return setting_data;
 }
 
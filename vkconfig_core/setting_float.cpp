@@ -30,9 +30,8 @@ SettingMetaFloat::SettingMetaFloat(Layer& layer, const std::string& key)
     : SettingMeta(layer, key, TYPE), default_value(0.0f), min_value(0.0f), max_value(0.0f), precision(0), width(0) {}
 
 SettingData* SettingMetaFloat::Instantiate() {
-    SettingData* setting_data = new SettingDataFloat(this);
+    SettingData* setting_data = this->arena.Create<SettingDataFloat>(this);
     setting_data->Reset();
-    this->instances.push_back(setting_data);
     return setting_data;
 }
 
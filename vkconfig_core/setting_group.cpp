@@ -27,9 +27,8 @@ const SettingType SettingMetaGroup::TYPE(SETTING_GROUP);
 SettingMetaGroup::SettingMetaGroup(Layer& layer, const std::string& key) : SettingMeta(layer, key, TYPE) {}
 
 SettingData* SettingMetaGroup::Instantiate() {
-    SettingData* setting_data = new SettingDataGroup(this);
+    SettingData* setting_data = this->arena.Create<SettingDataGroup>(this);
     setting_data->Reset();
-    this->instances.push_back(setting_data);
     return setting_data;
 }
 
@@ -32,9 +32,8 @@ SettingMetaInt::SettingMetaInt(Layer& layer, const std::string& key)
       max_value(std::numeric_limits<int>::max()) {}
 
 SettingData* SettingMetaInt::Instantiate() {
-    SettingData* setting_data = new SettingDataInt(this);
+    SettingData* setting_data = this->arena.Create<SettingDataInt>(this);
     setting_data->Reset();
-    this->instances.push_back(setting_data);
     return setting_data;
 }
 
@@ -21,49 +21,82 @@
 #include "setting_list.h"
 #include "json.h"
 #include "layer.h"
+#include "profiler.h"
+#include "vuid_database.h"
 
 #include <QFile>
+#include <QCryptographicHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 
-static QString ReadAll(const std::string& path) {
-    QString json_text;
+#include <algorithm>
+#include <iterator>
+
+static QByteArray ReadAll(const std::string& path) {
+    QByteArray data;
 
     QFile file(path.c_str());
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        json_text = file.readAll();
+    if (file.open(QIODevice::ReadOnly)) {
+        data = file.readAll();
         file.close();
     }
 
-    return json_text;
+    return data;
 }
 
-void LoadVUIDs(std::vector<NumberOrString>& value) {
+static std::vector<NumberOrString> ReadVUIDs(const VUIDDatabase& database) {
+    std::vector<NumberOrString> vuids(database.Size());
+
+    // The database is already sorted
+    for (std::size_t i = 0, n = database.Size(); i < n; ++i) {
+        vuids[i].key = database.Get(i);
+    }
+
+    return vuids;
+}
+
+static std::vector<NumberOrString> ReadVUIDs() {
+    ScopedTimer timer("ReadVUIDs");
+
+    std::vector<NumberOrString> vuids;
+
     const std::string vulkan_sdk_path(qgetenv("VULKAN_SDK").toStdString());
-    const std::string path = vulkan_sdk_path.empty() ? "/usr" : vulkan_sdk_path;
 
-    QString json_text;
+    QByteArray json_data;
+
+    if (!vulkan_sdk_path.empty()) {
+        json_data = ReadAll(vulkan_sdk_path + "/share/vulkan/registry/validusage.json");
+    }
 
-    if (!vulkan_sdk_path.empty() && json_text.isEmpty()) {
-        json_text = ReadAll(vulkan_sdk_path + "/share/vulkan/registry/validusage.json");
+    // The JSON document is only parsed when it's not the one the built-in database was generated from
+    const VUIDDatabase& database = GetBuiltinVUIDDatabase();
+    if (database.Size() > 0) {
+        if (json_data.isEmpty()) {
+            return ReadVUIDs(database);
+        }
+
+        const QByteArray database_hash(reinterpret_cast<const char*>(database.GetSourceHash()), VUIDDatabase::HASH_SIZE);
+        if (QCryptographicHash::hash(json_data, QCryptographicHash::Sha1) == database_hash) {
+            return ReadVUIDs(database);
+        }
     }
 
-    if (json_text.isEmpty()) {
-        json_text = ReadAll(":/layers/validusage.json");
+    if (json_data.isEmpty()) {
+        json_data = ReadAll(":/layers/validusage.json");
     }
 
-    if (json_text.isEmpty()) {
-        return;
+    if (json_data.isEmpty()) {
+        return vuids;
     }
 
     // Convert the text to a JSON document & validate it.
     // It does need to be a valid json formatted file.
     QJsonParseError json_parse_error;
-    const QJsonDocument& json_document = QJsonDocument::fromJson(json_text.toUtf8(), &json_parse_error);
+    const QJsonDocument& json_document = QJsonDocument::fromJson(json_data, &json_parse_error);
 
     const QJsonObject& json_root_object = json_document.object();
     if (json_root_object.value("validation") == QJsonValue::Undefined) {
-        return;
+        return vuids;
     }
 
     const QJsonObject& json_validation_object = json_root_object.value("validation").toObject();
@@ -86,10 +119,28 @@ void LoadVUIDs(std::vector<NumberOrString>& value) {
 
                 NumberOrString data;
                 data.key = vuid_value.toStdString();
-                value.push_back(data);
+                vuids.push_back(data);
             }
         }
     }
+
+    std::sort(vuids.begin(), vuids.end());
+    vuids.shrink_to_fit();
+
+    return vuids;
+}
+
+// validusage.json is only read the first time it's needed, the sorted VUIDs are then shared by all the list settings.
+const std::vector<NumberOrString>& GetVUIDs() {
+    static const std::vector<NumberOrString> vuids(ReadVUIDs());
+    return vuids;
+}
+
+void LoadVUIDs(std::vector<NumberOrString>& value) {
+    ScopedTimer timer("LoadVUIDs");
+
+    const std::vector<NumberOrString>& vuids = GetVUIDs();
+    value.insert(value.end(), vuids.begin(), vuids.end());
 }
 
 // SettingMetaList
@@ -99,9 +150,8 @@ const SettingType SettingMetaList::TYPE(SETTING_LIST);
 SettingMetaList::SettingMetaList(Layer& layer, const std::string& key) : SettingMeta(layer, key, TYPE), list_only(false) {}
 
 SettingData* SettingMetaList::Instantiate() {
-    SettingData* setting_data = new SettingDataList(this);
+    SettingData* setting_data = this->arena.Create<SettingDataList>(this);
     setting_data->Reset();
-    this->instances.push_back(setting_data);
     return setting_data;
 }
 
@@ -121,12 +171,18 @@ bool SettingMetaList::Load(const QJsonObject& json_setting) {
         }
     }
 
-    if (this->layer.key == "VK_LAYER_KHRONOS_validation") {
-        ::LoadVUIDs(this->list);
-    }
-
     std::sort(this->list.begin(), this->list.end());
 
+    if (this->layer.key == "VK_LAYER_KHRONOS_validation" && IsLayerInterfaceDataEnabled()) {
+        // The VUIDs are already sorted, only the values of the manifest need sorting before they are merged
+        const std::vector<NumberOrString>& vuids = GetVUIDs();
+
+        std::vector<NumberOrString> merged;
+        merged.reserve(this->list.size() + vuids.size());
+        std::merge(this->list.begin(), this->list.end(), vuids.begin(), vuids.end(), std::back_inserter(merged));
+        this->list.swap(merged);
+    }
+
     if (json_setting.value("list_only") != QJsonValue::Undefined) {
         this->list_only = ReadBoolValue(json_setting, "list_only");
     }
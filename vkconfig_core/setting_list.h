@@ -22,6 +22,9 @@
 
 #include "setting.h"
 
+// The VUIDs of validusage.json, sorted
+const std::vector<NumberOrString>& GetVUIDs();
+
 struct SettingMetaList : public SettingMeta {
     static const SettingType TYPE;
 
@@ -31,9 +31,8 @@ SettingMetaString::SettingMetaString(Layer& layer, const std::string& key, const
     : SettingMeta(layer, key, setting_type) {}
 
 SettingData* SettingMetaString::Instantiate() {
-    SettingData* setting_data = new SettingDataString(this);
+    SettingData* setting_data = this->arena.Create<SettingDataString>(this);
     setting_data->Reset();
-    this->instances.push_back(setting_data);
     return setting_data;
 }
 
@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "../layer_manager.h"
+#include "../configuration_manager.h"
+#include "../override.h"
+#include "../doc.h"
+#include "../profiler.h"
+#include "../platform.h"
+#include "../util.h"
+
+#include <gtest/gtest.h>
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Measures vkconfig_core on a synthetic environment much larger than a usual one: hundreds of layers with large settings trees
+// and hundreds of VUIDs in their list settings, and dozens of configurations using all of them.
+//
+// The size of the environment is multiplied by VKCONFIG_BENCHMARK_SCALE. The durations and the peak memory are printed and
+// written to benchmark_large_environment.txt. When VKCONFIG_BENCHMARK_BASELINE is the path of such a file written by a
+// previous run, the benchmark fails if a step got slower than the baseline by more than the tolerance.
+
+static const int LAYER_COUNT = 200;
+static const int GROUP_COUNT = 8;  // Groups of settings by layer, each with a setting of every type
+static const int ENUM_VALUE_COUNT = 8;
+static const int VUID_COUNT = 400;  // In the list setting of each layer
+static const int PRESET_COUNT = 4;
+static const int CONFIGURATION_COUNT = 40;
+
+// A step may be that much slower than the baseline, the small durations are dominated by the noise
+static const double BASELINE_TOLERANCE = 1.5;
+static const double BASELINE_MARGIN_MS = 20.0;
+
+struct Measurement {
+    std::string name;
+    double milliseconds;
+    std::size_t peak_memory;  // In kilobytes, when the step ended
+};
+
+// The peak resident memory of the process, in kilobytes
+static std::size_t GetPeakMemory() {
+#if VKC_PLATFORM == VKC_PLATFORM_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if VKC_PLATFORM == VKC_PLATFORM_MACOS
+    return usage.ru_maxrss / 1024;  // In bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+static int GetScale() {
+    const int scale = qEnvironmentVariableIntValue("VKCONFIG_BENCHMARK_SCALE");
+    return scale > 0 ? scale : 1;
+}
+
+static void Measure(std::vector<Measurement>& measurements, const char* name, const std::function<void()>& step) {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    step();
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    Measurement measurement;
+    measurement.name = name;
+    measurement.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+    measurement.peak_memory = GetPeakMemory();
+    measurements.push_back(measurement);
+}
+
+static QJsonObject MakeSetting(const std::string& key, const char* type) {
+    QJsonObject json_setting;
+    json_setting.insert("key", key.c_str());
+    json_setting.insert("label", key.c_str());
+    json_setting.insert("description", format("Description of %s, long enough to look like a real one", key.c_str()).c_str());
+    json_setting.insert("type", type);
+    return json_setting;
+}
+
+static QJsonArray MakeValues(const std::string& key) {
+    QJsonArray json_values;
+    for (int i = 0; i < ENUM_VALUE_COUNT; ++i) {
+        QJsonObject json_value;
+        json_value.insert("key", format("%s_value%d", key.c_str(), i).c_str());
+        json_value.insert("label", format("Value %d", i).c_str());
+        json_value.insert("description", format("Description of the value %d", i).c_str());
+        json_values.append(json_value);
+    }
+    return json_values;
+}
+
+static QJsonObject MakeGroup(int group_index) {
+    const std::string group = format("group%d", group_index);
+
+    QJsonObject json_bool = MakeSetting(group + "_enabled", "BOOL");
+    json_bool.insert("default", true);
+
+    QJsonObject json_dependence;
+    json_dependence.insert("mode", "ALL");
+    QJsonObject json_dependence_setting;
+    json_dependence_setting.insert("key", json_bool.value("key"));
+    json_dependence_setting.insert("value", true);
+    json_dependence.insert("settings", QJsonArray() << json_dependence_setting);
+
+    QJsonObject json_int = MakeSetting(group + "_int", "INT");
+    json_int.insert("default", group_index);
+    json_int.insert("dependence", json_dependence);
+
+    QJsonObject json_string = MakeSetting(group + "_string", "STRING");
+    json_string.insert("default", group.c_str());
+    json_string.insert("dependence", json_dependence);
+
+    QJsonObject json_enum = MakeSetting(group + "_enum", "ENUM");
+    json_enum.insert("flags", MakeValues(group + "_enum"));
+    json_enum.insert("default", (group + "_enum_value0").c_str());
+    json_enum.insert("dependence", json_dependence);
+
+    QJsonObject json_flags = MakeSetting(group + "_flags", "FLAGS");
+    json_flags.insert("flags", MakeValues(group + "_flags"));
+    json_flags.insert("default", QJsonArray() << (group + "_flags_value0").c_str() << (group + "_flags_value1").c_str());
+    json_flags.insert("dependence", json_dependence);
+
+    QJsonObject json_frames = MakeSetting(group + "_frames", "FRAMES");
+    json_frames.insert("default", "1-10,20");
+    json_frames.insert("dependence", json_dependence);
+
+    QJsonObject json_group = MakeSetting(group, "GROUP");
+    json_group.insert("settings", QJsonArray() << json_bool << json_int << json_string << json_enum << json_flags << json_frames);
+    return json_group;
+}
+
+static QJsonObject MakeVuids() {
+    QJsonArray json_list;
+    QJsonArray json_default;
+    for (int i = 0; i < VUID_COUNT; ++i) {
+        const std::string vuid = format("VUID-vkCmdDraw%d-None-%05d", i % 16, 2000 + i);
+        json_list.append(vuid.c_str());
+
+        if (i % 8 == 0) {
+            QJsonObject json_value;
+            json_value.insert("key", vuid.c_str());
+            json_value.insert("enabled", true);
+            json_default.append(json_value);
+        }
+    }
+
+    QJsonObject json_vuids = MakeSetting("message_id_filter", "LIST");
+    json_vuids.insert("list", json_list);
+    json_vuids.insert("default", json_default);
+    return json_vuids;
+}
+
+static QJsonObject MakePreset(int preset_index) {
+    QJsonArray json_settings;
+    for (int i = 0; i < GROUP_COUNT; ++i) {
+        QJsonObject json_setting;
+        json_setting.insert("key", format("group%d_enum", i).c_str());
+        json_setting.insert("value", format("group%d_enum_value%d", i, preset_index % ENUM_VALUE_COUNT).c_str());
+        json_settings.append(json_setting);
+    }
+
+    QJsonObject json_preset;
+    json_preset.insert("label", format("Preset %d", preset_index).c_str());
+    json_preset.insert("description", format("Description of the preset %d", preset_index).c_str());
+    json_preset.insert("settings", json_settings);
+    return json_preset;
+}
+
+static bool WriteLayerManifest(const QString& path, int layer_index) {
+    QJsonArray json_settings;
+    for (int i = 0; i < GROUP_COUNT; ++i) {
+        json_settings.append(MakeGroup(i));
+    }
+    json_settings.append(MakeVuids());
+
+    QJsonArray json_presets;
+    for (int i = 0; i < PRESET_COUNT; ++i) {
+        json_presets.append(MakePreset(i));
+    }
+
+    QJsonObject json_features;
+    json_features.insert("presets", json_presets);
+    json_features.insert("settings", json_settings);
+
+    QJsonObject json_layer;
+    json_layer.insert("name", format("VK_LAYER_BENCHMARK_layer_%03d", layer_index).c_str());
+    json_layer.insert("type", "GLOBAL");
+    json_layer.insert("library_path", "./libVkLayer_benchmark.so");
+    json_layer.insert("api_version", "1.3.250");
+    json_layer.insert("implementation_version", "1");
+    json_layer.insert("description", format("Synthetic layer %d", layer_index).c_str());
+    json_layer.insert("features", json_features);
+
+    QJsonObject json_root;
+    json_root.insert("file_format_version", "1.2.0");
+    json_root.insert("layer", json_layer);
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+    return file.write(QJsonDocument(json_root).toJson()) > 0;
+}
+
+static void WriteMeasurements(const std::vector<Measurement>& measurements, const char* path) {
+    std::ofstream file(path);
+    for (std::size_t i = 0, n = measurements.size(); i < n; ++i) {
+        file << measurements[i].name << '\t' << measurements[i].milliseconds << '\t' << measurements[i].peak_memory << '\n';
+    }
+}
+
+static std::map<std::string, double> ReadBaseline(const char* path) {
+    std::map<std::string, double> baseline;
+
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string name;
+        double milliseconds = 0.0;
+        if (std::getline(stream, name, '\t') && stream >> milliseconds) {
+            baseline[name] = milliseconds;
+        }
+    }
+
+    return baseline;
+}
+
+TEST(benchmark_large_environment, vkconfig_core) {
+    const int scale = GetScale();
+    const int layer_count = LAYER_COUNT * scale;
+    const int configuration_count = CONFIGURATION_COUNT * scale;
+
+    const QString root = QDir::currentPath() + "/benchmark_large_environment";
+    QDir(root).removeRecursively();
+    ASSERT_TRUE(QDir().mkpath(root + "/home"));
+    ASSERT_TRUE(QDir().mkpath(root + "/layers"));
+
+    // The configurations, the override files and the settings are written in a home directory of the benchmark
+    const QByteArray home = qgetenv("HOME");
+    qputenv("HOME", (root + "/home").toUtf8());
+
+    for (int i = 0; i < layer_count; ++i) {
+        ASSERT_TRUE(WriteLayerManifest(root + format("/layers/VK_LAYER_BENCHMARK_layer_%03d.json", i).c_str(), i));
+    }
+
+    std::vector<Measurement> measurements;
+
+    ResetProfiler();
+    EnableProfiler(true);
+
+    {
+        PathManager paths("");
+        Environment environment(paths);
+        environment.Reset(Environment::DEFAULT);
+        environment.SetPerConfigUserDefinedLayersPaths(std::vector<std::string>(1, (root + "/layers").toStdString()));
+
+        LayerManager layer_manager(environment);
+        Measure(measurements, "LoadAllInstalledLayers", [&]() { layer_manager.LoadAllInstalledLayers(); });
+        Measure(measurements, "LoadAllInstalledLayers unchanged", [&]() { layer_manager.LoadAllInstalledLayers(); });
+
+        const std::vector<Layer>& available_layers = layer_manager.available_layers;
+        ASSERT_GE(available_layers.size(), static_cast<std::size_t>(layer_count));
+
+        ConfigurationManager configuration_manager(environment);
+        for (int i = 0; i < configuration_count; ++i) {
+            Configuration configuration;
+            configuration.key = format("Benchmark %03d", i);
+            configuration.description = "Synthetic configuration";
+
+            for (std::size_t j = 0, n = available_layers.size(); j < n; ++j) {
+                const LayerState state = (i + j) % 4 == 3 ? LAYER_STATE_EXCLUDED : LAYER_STATE_OVERRIDDEN;
+
+                Parameter parameter(available_layers[j].key, state);
+                CollectDefaultSettingData(available_layers[j].settings, parameter.settings);
+                configuration.parameters.push_back(parameter);
+            }
+
+            configuration_manager.available_configurations.push_back(configuration);
+        }
+
+        Measure(measurements, "SaveAllConfigurations", [&]() { configuration_manager.SaveAllConfigurations(available_layers); });
+        Measure(measurements, "LoadAllConfigurations", [&]() { configuration_manager.LoadAllConfigurations(available_layers); });
+        ASSERT_GE(configuration_manager.available_configurations.size(), static_cast<std::size_t>(configuration_count));
+
+        const Configuration* configuration = FindByKey(configuration_manager.available_configurations, "Benchmark 000");
+        ASSERT_TRUE(configuration != nullptr);
+
+        bool overridden = false;
+        Measure(measurements, "OverrideConfiguration",
+                [&]() { overridden = OverrideConfiguration(environment, available_layers, *configuration); });
+        EXPECT_TRUE(overridden);
+        EXPECT_TRUE(SurrenderConfiguration(environment));
+
+        const std::string doc_path = (root + "/settings.txt").toStdString();
+        Measure(measurements, "ExportSettingsDoc", [&]() { ExportSettingsDoc(available_layers, *configuration, doc_path); });
+        EXPECT_TRUE(QFile::exists(doc_path.c_str()));
+
+        environment.Reset(Environment::SYSTEM);  // Don't change the system settings on exit
+    }
+
+    EnableProfiler(false);
+
+    std::printf("%d layers, %d configurations\n", layer_count, configuration_count);
+    for (std::size_t i = 0, n = measurements.size(); i < n; ++i) {
+        std::printf("%-36s %10.1f ms %10zu KB peak\n", measurements[i].name.c_str(), measurements[i].milliseconds,
+                    measurements[i].peak_memory);
+    }
+    std::printf("\n%s", GetProfilerReport().c_str());
+
+    WriteMeasurements(measurements, "benchmark_large_environment.txt");
+
+    const QByteArray baseline_path = qgetenv("VKCONFIG_BENCHMARK_BASELINE");
+    if (!baseline_path.isEmpty()) {
+        const std::map<std::string, double>& baseline = ReadBaseline(baseline_path.constData());
+        EXPECT_FALSE(baseline.empty());
+
+        for (std::size_t i = 0, n = measurements.size(); i < n; ++i) {
+            auto it = baseline.find(measurements[i].name);
+            if (it == baseline.end()) continue;
+
+            EXPECT_LE(measurements[i].milliseconds, it->second * BASELINE_TOLERANCE + BASELINE_MARGIN_MS) << measurements[i].name;
+        }
+    }
+
+    if (home.isNull()) {
+        qunsetenv("HOME");
+    } else {
+        qputenv("HOME", home);
+    }
+    QDir(root).removeRecursively();
+}
@@ -47,6 +47,18 @@ TEST(test_command_line, execute_mode) {
     EXPECT_TRUE(command_line.layers_configuration_path.empty());
 }
 
+TEST(test_command_line, profile) {
+    static char* argv[] = {"vkconfig", "layers", "--profile", "--list"};
+    int argc = static_cast<int>(countof(argv));
+
+    CommandLine command_line(argc, argv);
+
+    EXPECT_EQ(ERROR_NONE, command_line.error);
+    EXPECT_TRUE(command_line.profile);
+    EXPECT_EQ(COMMAND_LAYERS, command_line.command);
+    EXPECT_EQ(COMMAND_LAYERS_LIST, command_line.command_layers_arg);
+}
+
 TEST(test_command_line, usage_mode_help) {
     static char* argv[] = {"vkconfig", "--help"};
     int argc = static_cast<int>(countof(argv));
@@ -203,6 +215,44 @@ TEST(test_command_line, usage_mode_layers_override_invalid_args) {
     EXPECT_TRUE(command_line.layers_configuration_path.empty());
 }
 
+TEST(test_command_line, usage_mode_doc_all) {
+    static char* argv[] = {"vkconfig", "doc", "--all", "out"};
+    int argc = static_cast<int>(countof(argv));
+
+    CommandLine command_line(argc, argv);
+
+    EXPECT_EQ(ERROR_NONE, command_line.error);
+    EXPECT_TRUE(command_line.error_args.empty());
+    EXPECT_EQ(COMMAND_DOC, command_line.command);
+    EXPECT_EQ(COMMAND_DOC_ALL, command_line.command_doc_arg);
+    EXPECT_TRUE(command_line.doc_layer_name.empty());
+    EXPECT_STREQ("out", command_line.doc_out_dir.c_str());
+}
+
+TEST(test_command_line, usage_mode_doc_all_invalid_args) {
+    static char* argv[] = {"vkconfig", "doc", "--all", "out", "bla"};
+    int argc = static_cast<int>(countof(argv));
+
+    CommandLine command_line(argc, argv);
+
+    EXPECT_EQ(ERROR_TOO_MANY_COMMAND_ARGUMENTS, command_line.error);
+    EXPECT_EQ(1, command_line.error_args.size());
+    EXPECT_EQ(COMMAND_DOC, command_line.command);
+    EXPECT_EQ(COMMAND_DOC_ALL, command_line.command_doc_arg);
+}
+
+TEST(test_command_line, usage_mode_doc_html_missing_layer) {
+    static char* argv[] = {"vkconfig", "doc", "--html"};
+    int argc = static_cast<int>(countof(argv));
+
+    CommandLine command_line(argc, argv);
+
+    EXPECT_EQ(ERROR_MISSING_COMMAND_ARGUMENT, command_line.error);
+    EXPECT_EQ(1, command_line.error_args.size());
+    EXPECT_EQ(COMMAND_DOC, command_line.command);
+    EXPECT_TRUE(command_line.doc_layer_name.empty());
+}
+
 #if VKC_PLATFORM == VKC_PLATFORM_LINUX
 #pragma GCC diagnostic pop
 #elif VKC_PLATFORM == VKC_PLATFORM_MACOS
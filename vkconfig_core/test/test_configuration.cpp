@@ -77,6 +77,55 @@ TEST(test_configuration, load_and_save_v2_2_2) {
     EXPECT_EQ(configuration_loaded, configuration_saved);
 }
 
+TEST(test_configuration, load_parsed_document) {
+    const QJsonDocument json_document = ParseConfigurationFile(":/Configuration 2.2.2.json");
+    EXPECT_FALSE(json_document.isNull());
+
+    Configuration configuration_parsed;
+    EXPECT_TRUE(configuration_parsed.Load(std::vector<Layer>(), json_document));
+
+    Configuration configuration_loaded;
+    EXPECT_TRUE(configuration_loaded.Load(std::vector<Layer>(), ":/Configuration 2.2.2.json"));
+
+    EXPECT_EQ(configuration_loaded, configuration_parsed);
+
+    Configuration configuration_invalid;
+    EXPECT_FALSE(configuration_invalid.Load(std::vector<Layer>(), QJsonDocument()));
+}
+
+TEST(test_configuration, dirty_generation) {
+    Configuration configuration;
+    EXPECT_TRUE(configuration.IsDirty());
+
+    EXPECT_TRUE(configuration.Load(std::vector<Layer>(), ":/Configuration 2.2.2.json"));
+    EXPECT_FALSE(configuration.IsDirty());
+
+    configuration.MarkDirty();
+    EXPECT_TRUE(configuration.IsDirty());
+
+    // Exporting doesn't write the file of the configuration
+    EXPECT_TRUE(configuration.Save(std::vector<Layer>(), "test_dirty_generation_export.json", true));
+    EXPECT_TRUE(configuration.IsDirty());
+
+    EXPECT_TRUE(configuration.Save(std::vector<Layer>(), "test_dirty_generation.json"));
+    EXPECT_FALSE(configuration.IsDirty());
+}
+
+TEST(test_configuration, read_layer_keys) {
+    const QJsonDocument json_document = ParseConfigurationFile(":/Configuration 2.2.2.json");
+
+    Configuration configuration;
+    EXPECT_TRUE(configuration.Load(std::vector<Layer>(), json_document));
+
+    const std::vector<std::string>& layer_keys = ReadConfigurationLayerKeys(json_document);
+    ASSERT_EQ(configuration.parameters.size(), layer_keys.size());
+    for (std::size_t i = 0, n = layer_keys.size(); i < n; ++i) {
+        EXPECT_STREQ(configuration.parameters[i].key.c_str(), layer_keys[i].c_str());
+    }
+
+    EXPECT_TRUE(ReadConfigurationLayerKeys(QJsonDocument()).empty());
+}
+
 static std::vector<Configuration> GenerateConfigurations() {
     std::vector<Configuration> configurations;
 
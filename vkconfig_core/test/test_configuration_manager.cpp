@@ -19,6 +19,9 @@
  */
 
 #include "../configuration_manager.h"
+#include "../util.h"
+
+#include <QFile>
 
 #include <gtest/gtest.h>
 
@@ -70,3 +73,46 @@ TEST(test_configuration_manager, create_remove) {
 
     environment.Reset(Environment::SYSTEM);  // Don't change the system settings on exit
 }
+
+TEST(test_configuration_manager, save_only_dirty) {
+    PathManager path_manager("");
+    Environment environment(path_manager);
+    environment.Reset(Environment::DEFAULT);
+
+    std::vector<Layer> available_layers;
+
+    ConfigurationManager configuration_manager(environment);
+    Configuration &configuration = configuration_manager.CreateConfiguration(available_layers, "Configuration Dirty");
+    const std::string key = configuration.key;
+    const std::string path = GetPath(BUILTIN_PATH_CONFIG_LAST) + "/" + key + ".json";
+
+    // A new configuration has no file yet
+    configuration_manager.SaveAllConfigurations(available_layers);
+    EXPECT_FALSE(FindByKey(configuration_manager.available_configurations, key.c_str())->IsDirty());
+
+    // Overwrite the file behind the back of the manager, which only writes the changed configurations
+    {
+        QFile file(path.c_str());
+        EXPECT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Text));
+        file.write("{}");
+    }
+    configuration_manager.SaveAllConfigurations(available_layers);
+    {
+        QFile file(path.c_str());
+        EXPECT_TRUE(file.open(QIODevice::ReadOnly | QIODevice::Text));
+        EXPECT_EQ(QByteArray("{}"), file.readAll());
+    }
+
+    FindByKey(configuration_manager.available_configurations, key.c_str())->MarkDirty();
+    configuration_manager.SaveAllConfigurations(available_layers);
+    {
+        QFile file(path.c_str());
+        EXPECT_TRUE(file.open(QIODevice::ReadOnly | QIODevice::Text));
+        EXPECT_NE(QByteArray("{}"), file.readAll());
+    }
+
+    configuration_manager.RemoveConfiguration(available_layers, key);
+    EXPECT_TRUE(configuration_manager.Empty());
+
+    environment.Reset(Environment::SYSTEM);  // Don't change the system settings on exit
+}
@@ -23,6 +23,7 @@
 #include "../environment.h"
 
 #include <QFile>
+#include <QSettings>
 
 #include <gtest/gtest.h>
 
@@ -40,3 +41,19 @@ TEST(test_environment, remove_missing_applications) {
 
     EXPECT_EQ(1, environment.RemoveMissingApplications(applications).size());
 }
+
+TEST(test_environment, save_changed_values) {
+    PathManager path_manager("");
+    Environment environment(path_manager);
+    environment.Set(ACTIVE_APPLICATION, "vkcube");
+    environment.Save();
+
+    // Unchanged values are not written again
+    QSettings().setValue("launchApp", "written_elsewhere");
+    environment.Save();
+    EXPECT_STREQ("written_elsewhere", QSettings().value("launchApp").toString().toStdString().c_str());
+
+    environment.Set(ACTIVE_APPLICATION, "vkcubepp");
+    environment.Save();
+    EXPECT_STREQ("vkcubepp", QSettings().value("launchApp").toString().toStdString().c_str());
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "../json_reader.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+static bool IsValidJson(const char* text) {
+    JsonReader reader(text, std::strlen(text));
+    reader.Skip();
+    return reader.End();
+}
+
+TEST(test_json_reader, read_members) {
+    const char* text =
+        "\xEF\xBB\xBF{ \"a\": \"A\", \"b\": [1, -2.5e3, true, null], \"c\": { \"d\": \"D\" }, \"e\": \"\\u00e9\\n\" }";
+
+    JsonReader reader(text, std::strlen(text));
+    ASSERT_TRUE(reader.BeginObject());
+
+    std::string key;
+    std::string value;
+
+    ASSERT_TRUE(reader.NextMember(key));
+    EXPECT_STREQ("a", key.c_str());
+    EXPECT_EQ(JSON_TYPE_STRING, reader.Peek());
+    ASSERT_TRUE(reader.ReadString(value));
+    EXPECT_STREQ("A", value.c_str());
+
+    ASSERT_TRUE(reader.NextMember(key));
+    EXPECT_STREQ("b", key.c_str());
+    EXPECT_EQ(JSON_TYPE_ARRAY, reader.Peek());
+    ASSERT_TRUE(reader.Skip());
+
+    ASSERT_TRUE(reader.NextMember(key));
+    EXPECT_STREQ("c", key.c_str());
+    ASSERT_TRUE(reader.BeginObject());
+    ASSERT_TRUE(reader.NextMember(key));
+    EXPECT_STREQ("d", key.c_str());
+    ASSERT_TRUE(reader.ReadString(value));
+    EXPECT_STREQ("D", value.c_str());
+    EXPECT_FALSE(reader.NextMember(key));
+    EXPECT_FALSE(reader.HasError());
+
+    ASSERT_TRUE(reader.NextMember(key));
+    EXPECT_STREQ("e", key.c_str());
+    ASSERT_TRUE(reader.ReadString(value));
+    EXPECT_STREQ("\xC3\xA9\n", value.c_str());
+
+    EXPECT_FALSE(reader.NextMember(key));
+    EXPECT_TRUE(reader.End());
+}
+
+TEST(test_json_reader, read_elements) {
+    const char* text = "[\"a\", \"b\"]";
+
+    JsonReader reader(text, std::strlen(text));
+    ASSERT_TRUE(reader.BeginArray());
+
+    std::vector<std::string> values;
+    while (reader.NextElement()) {
+        std::string value;
+        ASSERT_TRUE(reader.ReadString(value));
+        values.push_back(value);
+    }
+
+    EXPECT_TRUE(reader.End());
+    ASSERT_EQ(2, values.size());
+    EXPECT_STREQ("a", values[0].c_str());
+    EXPECT_STREQ("b", values[1].c_str());
+}
+
+TEST(test_json_reader, valid) {
+    EXPECT_TRUE(IsValidJson("{}"));
+    EXPECT_TRUE(IsValidJson(" [ ] "));
+    EXPECT_TRUE(IsValidJson("{\"a\": [{}, [], 0, 1.5, -1e-2, false, \"\\ud83d\\ude00\"]}"));
+}
+
+TEST(test_json_reader, invalid) {
+    EXPECT_FALSE(IsValidJson(""));
+    EXPECT_FALSE(IsValidJson("{"));
+    EXPECT_FALSE(IsValidJson("{} {}"));
+    EXPECT_FALSE(IsValidJson("{\"a\" 1}"));
+    EXPECT_FALSE(IsValidJson("{\"a\": 1,}"));
+    EXPECT_FALSE(IsValidJson("{\"a\": 1 \"b\": 2}"));
+    EXPECT_FALSE(IsValidJson("[1 2]"));
+    EXPECT_FALSE(IsValidJson("[tru]"));
+    EXPECT_FALSE(IsValidJson("[1.]"));
+    EXPECT_FALSE(IsValidJson("[\"\\x\"]"));
+    EXPECT_FALSE(IsValidJson("[\"a]"));
+}
+
+TEST(test_json_reader, max_depth) {
+    const std::string nested = std::string(2000, '[') + std::string(2000, ']');
+    JsonReader reader(nested.c_str(), nested.size());
+    EXPECT_FALSE(reader.Skip());
+    EXPECT_TRUE(reader.HasError());
+}
@@ -30,6 +30,8 @@
 
 #include <gtest/gtest.h>
 
+#include <QFile>
+
 #include <regex>
 
 inline SettingMetaString* InstantiateString(Layer& layer, const std::string& key) {
@@ -56,6 +58,46 @@ TEST(test_layer, collect_settings) {
     EXPECT_STREQ("value0", data_string->value.c_str());
 }
 
+TEST(test_layer, copy_move_share_settings) {
+    Layer layer;
+    const bool load_loaded = layer.Load(std::vector<Layer>(), ":/VK_LAYER_LUNARG_test_03.json", LAYER_TYPE_EXPLICIT);
+    ASSERT_TRUE(load_loaded);
+    ASSERT_EQ(2, layer.settings.size());
+
+    const SettingMeta* setting = layer.settings[0];
+
+    Layer layer_copy(layer);
+    EXPECT_STREQ(layer.key.c_str(), layer_copy.key.c_str());
+    EXPECT_EQ(setting, layer_copy.settings[0]);
+
+    std::vector<Layer> layers;
+    layers.push_back(std::move(layer));
+    layers.push_back(layer_copy);  // Grow the vector, moving the first layer
+    EXPECT_EQ(setting, layers[0].settings[0]);
+    EXPECT_EQ(setting, layers[1].settings[0]);
+    EXPECT_STREQ("VK_LAYER_LUNARG_test_03", layers[0].key.c_str());
+}
+
+TEST(test_layer, instances_outlive_layer_copy) {
+    SettingDataSet instances;
+    {
+        std::vector<Layer> layers;
+        {
+            Layer layer;
+            const bool load_loaded = layer.Load(std::vector<Layer>(), ":/VK_LAYER_LUNARG_test_03.json", LAYER_TYPE_EXPLICIT);
+            ASSERT_TRUE(load_loaded);
+
+            CollectDefaultSettingData(layer.settings, instances);
+            layers.push_back(layer);
+        }
+
+        // The settings and their instances are owned by the arena shared by the copies of the layer
+        ASSERT_EQ(2, instances.size());
+        EXPECT_EQ(layers[0].settings[0]->key, instances[0]->key);
+        EXPECT_EQ(layers[0].settings[1]->key, instances[1]->key);
+    }
+}
+
 TEST(test_layer, load_header_overridden) {
     Layer layer;
     const bool load_loaded = layer.Load(std::vector<Layer>(), ":/VK_LAYER_LUNARG_test_00.json", LAYER_TYPE_EXPLICIT);
@@ -228,6 +270,54 @@ TEST(test_layer, load_1_1_0_header) {
     EXPECT_TRUE(layer.presets.empty());
 }
 
+TEST(test_layer, load_builtin_settings_once) {
+    // An old manifest, whose settings are taken from the built-in definition of the layer
+    const char* manifest =
+        "{ \"file_format_version\" : \"1.1.0\", \"layer\": { \"name\": \"VK_LAYER_LUNARG_api_dump\", \"type\": \"GLOBAL\", "
+        "\"library_path\": \".\\\\VkLayer_api_dump.dll\", \"api_version\": \"1.2.162\", \"implementation_version\": \"2\", "
+        "\"description\": \"LunarG debug layer\" } }";
+    {
+        QFile file("test_layer_builtin_api_dump.json");
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Text));
+        file.write(manifest);
+    }
+
+    Layer layer_a;
+    ASSERT_TRUE(layer_a.Load(std::vector<Layer>(), "test_layer_builtin_api_dump.json", LAYER_TYPE_EXPLICIT));
+    Layer layer_b;
+    ASSERT_TRUE(layer_b.Load(std::vector<Layer>(), "test_layer_builtin_api_dump.json", LAYER_TYPE_EXPLICIT));
+
+    ASSERT_FALSE(layer_a.settings.empty());
+    EXPECT_EQ(layer_a.settings, layer_b.settings);
+    EXPECT_EQ(layer_a.presets.size(), layer_b.presets.size());
+}
+
+TEST(test_layer, load_without_interface_data) {
+    EnableLayerInterfaceData(false);
+
+    Layer layer;
+    const bool load_loaded = layer.Load(std::vector<Layer>(), ":/VK_LAYER_LUNARG_reference_1_2_0.json", LAYER_TYPE_EXPLICIT);
+
+    EnableLayerInterfaceData(true);
+
+    ASSERT_TRUE(load_loaded);
+    EXPECT_TRUE(layer.presets.empty());
+    EXPECT_FALSE(layer.settings.empty());
+}
+
+TEST(test_layer, load_setting_dependents) {
+    Layer layer;
+    const bool load_loaded = layer.Load(std::vector<Layer>(), ":/VK_LAYER_LUNARG_reference_1_2_1.json", LAYER_TYPE_EXPLICIT);
+    ASSERT_TRUE(load_loaded);
+
+    const std::vector<const SettingMeta*>& dependents = layer.dependents.Find("toogle");
+    EXPECT_EQ(11, dependents.size());
+    EXPECT_EQ(FindSetting(layer.settings, "enum_with_optional"), dependents[0]);
+    EXPECT_EQ(FindSetting(layer.settings, "list_with_optional"), dependents[10]);
+
+    EXPECT_TRUE(layer.dependents.Find("enum_with_optional").empty());
+}
+
 TEST(test_layer, load_1_2_0_preset_and_setting_type) {
     Layer layer;
     const bool load_loaded = layer.Load(std::vector<Layer>(), ":/VK_LAYER_LUNARG_reference_1_2_0.json", LAYER_TYPE_EXPLICIT);
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "../layer_cost.h"
+#include "../util.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+static std::vector<Layer> GenerateTestLayers() {
+    std::vector<Layer> layers;
+    layers.push_back(Layer(LAYER_COST_MONITOR_NAME, LAYER_TYPE_EXPLICIT, Version(1, 0, 0), Version(1, 2, 148), "1", "layer.json"));
+    layers.push_back(Layer("Layer E0", LAYER_TYPE_EXPLICIT, Version(1, 0, 0), Version(1, 2, 148), "1", "layer.json"));
+    layers.push_back(Layer("Layer E1", LAYER_TYPE_EXPLICIT, Version(1, 0, 0), Version(1, 2, 148), "1", "layer.json"));
+    layers.push_back(Layer("Layer I0", LAYER_TYPE_IMPLICIT, Version(1, 0, 0), Version(1, 2, 148), "1", "layer.json"));
+    return layers;
+}
+
+static Configuration GenerateTestConfiguration() {
+    Configuration configuration;
+    configuration.parameters.push_back(Parameter("Layer E0", LAYER_STATE_OVERRIDDEN));
+    configuration.parameters.push_back(Parameter("Layer E1", LAYER_STATE_OVERRIDDEN));
+    configuration.parameters.push_back(Parameter("Layer E2", LAYER_STATE_OVERRIDDEN));
+    configuration.parameters.push_back(Parameter("Layer I0", LAYER_STATE_APPLICATION_CONTROLLED));
+    return configuration;
+}
+
+static void WriteFile(const char* path, const std::string& text) {
+    std::FILE* file = std::fopen(path, "w");
+    ASSERT_TRUE(file != nullptr);
+    std::fputs(text.c_str(), file);
+    std::fclose(file);
+}
+
+TEST(test_layer_cost, load_csv) {
+    std::string text = "frame,timestamp_ns,frame_time_ms,swapchain,gpu_frame,gpu_time_ms\n";
+    // The first 10 frames are presented during the warm-up
+    for (int i = 0; i < 110; ++i) {
+        text += format("%d,%llu,%.3f,0x1,,\n", i, 1000000000ull + i * 10000000ull, i < 10 ? 100.0 : static_cast<double>(i - 9));
+    }
+    text += "110,21000";  // Terminated application
+
+    WriteFile("./test_layer_cost.csv", text);
+
+    FrameLogStats stats;
+    EXPECT_TRUE(LoadFrameLogStats("./test_layer_cost.csv", 100.0, stats));
+    EXPECT_EQ(100, stats.frames);
+    EXPECT_EQ(1000000000ull, stats.first_present_ns);
+    EXPECT_DOUBLE_EQ(50.0, stats.median_ms);
+    EXPECT_DOUBLE_EQ(90.0, stats.p90_ms);
+    EXPECT_DOUBLE_EQ(99.0, stats.p99_ms);
+}
+
+TEST(test_layer_cost, load_json) {
+    WriteFile("./test_layer_cost.json",
+              "{\"frame\": 0, \"timestamp_ns\": 2000, \"frame_time_ms\": 4.000, \"swapchain\": \"0x1\"}\n"
+              "{\"frame\": 1, \"timestamp_ns\": 1000, \"frame_time_ms\": 2.000, \"swapchain\": \"0x2\"}\n");
+
+    FrameLogStats stats;
+    EXPECT_TRUE(LoadFrameLogStats("./test_layer_cost.json", 0.0, stats));
+    EXPECT_EQ(2, stats.frames);
+    EXPECT_EQ(1000, stats.first_present_ns);
+    EXPECT_DOUBLE_EQ(2.0, stats.median_ms);
+    EXPECT_DOUBLE_EQ(4.0, stats.p99_ms);
+}
+
+TEST(test_layer_cost, load_no_frame) {
+    WriteFile("./test_layer_cost_empty.csv", "frame,timestamp_ns,frame_time_ms,swapchain\n");
+
+    FrameLogStats stats;
+    EXPECT_FALSE(LoadFrameLogStats("./test_layer_cost_empty.csv", 0.0, stats));
+    EXPECT_FALSE(LoadFrameLogStats("./test_layer_cost_missing.csv", 0.0, stats));
+}
+
+TEST(test_layer_cost, plan) {
+    const std::vector<LayerCostRun>& runs = PlanLayerCostRuns(GenerateTestConfiguration(), GenerateTestLayers());
+
+    // The missing layer isn't measured
+    ASSERT_EQ(4, runs.size());
+    EXPECT_TRUE(runs[0].layers.empty());
+    EXPECT_STREQ("Layer E0", runs[1].label.c_str());
+    EXPECT_STREQ("Layer E1", runs[2].label.c_str());
+    EXPECT_EQ(2, runs[3].layers.size());
+}
+
+TEST(test_layer_cost, configuration) {
+    const std::vector<Layer>& layers = GenerateTestLayers();
+    const std::vector<LayerCostRun>& runs = PlanLayerCostRuns(GenerateTestConfiguration(), layers);
+
+    const Configuration& configuration = MakeLayerCostConfiguration(GenerateTestConfiguration(), layers, runs[1]);
+
+    EXPECT_EQ(LAYER_STATE_OVERRIDDEN, FindByKey(configuration.parameters, LAYER_COST_MONITOR_NAME)->state);
+    EXPECT_EQ(LAYER_STATE_OVERRIDDEN, FindByKey(configuration.parameters, "Layer E0")->state);
+    EXPECT_EQ(LAYER_STATE_EXCLUDED, FindByKey(configuration.parameters, "Layer E1")->state);
+    EXPECT_EQ(LAYER_STATE_EXCLUDED, FindByKey(configuration.parameters, "Layer I0")->state);
+}
+
+TEST(test_layer_cost, report) {
+    std::vector<LayerCostRun> runs = PlanLayerCostRuns(GenerateTestConfiguration(), GenerateTestLayers());
+    runs[0].done = runs[0].valid = true;
+    runs[0].startup_ms = 100.0;
+    runs[0].stats.median_ms = 10.0;
+    runs[1].done = runs[1].valid = true;
+    runs[1].startup_ms = 150.0;
+    runs[1].stats.median_ms = 12.0;
+    runs[2].done = true;
+
+    const std::string& report = GenerateLayerCostReport(runs);
+    EXPECT_NE(std::string::npos, report.find("+50.0%"));
+    EXPECT_NE(std::string::npos, report.find("+20.0%"));
+    EXPECT_NE(std::string::npos, report.find("No frame presented"));
+    EXPECT_EQ(std::string::npos, report.find("All layers"));
+}
@@ -22,6 +22,15 @@
 
 #include <gtest/gtest.h>
 
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+
+static bool Contains(const std::vector<std::string>& keys, const char* key) {
+    return std::find(keys.begin(), keys.end(), key) != keys.end();
+}
+
 TEST(test_layer_manager, load_only_layer_json) {
     PathManager paths("");
     Environment environment(paths);
@@ -34,3 +43,88 @@ TEST(test_layer_manager, load_only_layer_json) {
 
     environment.Reset(Environment::SYSTEM);  // Don't change the system settings on exit
 }
+
+TEST(test_layer_manager, load_layers_from_paths_in_order) {
+    PathManager paths("");
+    Environment environment(paths);
+    environment.Reset(Environment::DEFAULT);
+
+    LayerManager layer_manager(environment);
+    layer_manager.LoadLayersFromPath(":/");
+
+    // The layers found again in the second path are duplicates, so they are skipped
+    LayerManager layer_manager_paths(environment);
+    layer_manager_paths.LoadLayersFromPaths(std::vector<std::string>{":/", ":/"});
+
+    ASSERT_EQ(layer_manager.available_layers.size(), layer_manager_paths.available_layers.size());
+    for (std::size_t i = 0, n = layer_manager.available_layers.size(); i < n; ++i) {
+        EXPECT_STREQ(layer_manager.available_layers[i].key.c_str(), layer_manager_paths.available_layers[i].key.c_str());
+        EXPECT_STREQ(layer_manager.available_layers[i].manifest_path.c_str(),
+                     layer_manager_paths.available_layers[i].manifest_path.c_str());
+    }
+
+    environment.Reset(Environment::SYSTEM);  // Don't change the system settings on exit
+}
+
+TEST(test_layer_manager, load_all_installed_layers_changes) {
+    const QString path = QDir::currentPath() + "/test_layer_manager_changes";
+    QDir(path).removeRecursively();
+    ASSERT_TRUE(QDir().mkpath(path));
+    ASSERT_TRUE(QFile::copy(":/VK_LAYER_LUNARG_test_00.json", path + "/VK_LAYER_LUNARG_test_00.json"));
+    ASSERT_TRUE(QFile::copy(":/VK_LAYER_LUNARG_test_01.json", path + "/VK_LAYER_LUNARG_test_01.json"));
+    QFile::setPermissions(path + "/VK_LAYER_LUNARG_test_01.json", QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+    PathManager paths("");
+    Environment environment(paths);
+    environment.Reset(Environment::DEFAULT);
+    environment.SetPerConfigUserDefinedLayersPaths(std::vector<std::string>(1, path.toStdString()));
+
+    LayerManager layer_manager(environment);
+
+    const LayerChanges& changes_first = layer_manager.LoadAllInstalledLayers();
+    EXPECT_TRUE(Contains(changes_first.added, "VK_LAYER_LUNARG_test_00"));
+    EXPECT_TRUE(Contains(changes_first.added, "VK_LAYER_LUNARG_test_01"));
+    EXPECT_TRUE(changes_first.removed.empty());
+
+    // Nothing changed, the layers are reused
+    const LayerChanges& changes_same = layer_manager.LoadAllInstalledLayers();
+    EXPECT_TRUE(changes_same.Empty());
+    EXPECT_TRUE(FindByKey(layer_manager.available_layers, "VK_LAYER_LUNARG_test_00") != nullptr);
+
+    EXPECT_TRUE(QFile::remove(path + "/VK_LAYER_LUNARG_test_01.json"));
+
+    const LayerChanges& changes_removed = layer_manager.LoadAllInstalledLayers();
+    EXPECT_TRUE(changes_removed.added.empty());
+    EXPECT_TRUE(changes_removed.updated.empty());
+    EXPECT_TRUE(Contains(changes_removed.removed, "VK_LAYER_LUNARG_test_01"));
+    EXPECT_TRUE(FindByKey(layer_manager.available_layers, "VK_LAYER_LUNARG_test_01") == nullptr);
+
+    QDir(path).removeRecursively();
+
+    environment.Reset(Environment::SYSTEM);  // Don't change the system settings on exit
+}
+
+TEST(test_layer_manager, load_requested_layers) {
+    const QString path = QDir::currentPath() + "/test_layer_manager_requested";
+    QDir(path).removeRecursively();
+    ASSERT_TRUE(QDir().mkpath(path));
+    ASSERT_TRUE(QFile::copy(":/VK_LAYER_LUNARG_test_00.json", path + "/VK_LAYER_LUNARG_test_00.json"));
+    ASSERT_TRUE(QFile::copy(":/VK_LAYER_LUNARG_test_01.json", path + "/VK_LAYER_LUNARG_test_01.json"));
+
+    PathManager paths("");
+    Environment environment(paths);
+    environment.Reset(Environment::DEFAULT);
+    environment.SetPerConfigUserDefinedLayersPaths(std::vector<std::string>(1, path.toStdString()));
+
+    const std::vector<std::string> layer_names{"VK_LAYER_LUNARG_test_01", "VK_LAYER_LUNARG_missing", "VK_LAYER_LUNARG_test_01"};
+
+    LayerManager layer_manager(environment);
+    layer_manager.LoadLayers(layer_names);
+
+    ASSERT_EQ(1, layer_manager.available_layers.size());
+    EXPECT_STREQ("VK_LAYER_LUNARG_test_01", layer_manager.available_layers[0].key.c_str());
+
+    QDir(path).removeRecursively();
+
+    environment.Reset(Environment::SYSTEM);  // Don't change the system settings on exit
+}
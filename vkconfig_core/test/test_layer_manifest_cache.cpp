@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "../layer_manifest_cache.h"
+#include "../layer.h"
+#include "../../vku/vk_manifest_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <QFile>
+
+static bool CopyManifest(const char* source, const std::string& destination) {
+    QFile::remove(destination.c_str());
+    if (!QFile::copy(source, destination.c_str())) return false;
+
+    // Files copied from the resources are read-only
+    return QFile::setPermissions(destination.c_str(), QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+}
+
+TEST(test_layer_manifest_cache, resource_not_cached) {
+    LayerManifestCache cache;
+    cache.Record(":/VK_LAYER_LUNARG_test_00.json", true, "");
+
+    bool is_valid = false;
+    std::string message;
+    EXPECT_FALSE(cache.Find(":/VK_LAYER_LUNARG_test_00.json", is_valid, message));
+    EXPECT_EQ(0, cache.Size());
+}
+
+TEST(test_layer_manifest_cache, save_load) {
+    const std::string MANIFEST("./test_layer_manifest_cache_save_load.json");
+    const std::string CACHE("./test_layer_manifest_cache_save_load_cache.json");
+    ASSERT_TRUE(CopyManifest(":/VK_LAYER_LUNARG_test_00.json", MANIFEST));
+
+    LayerManifestCache cache_saved;
+    cache_saved.Record(MANIFEST, false, "Invalid manifest");
+    EXPECT_TRUE(cache_saved.Save(CACHE));
+
+    LayerManifestCache cache_loaded;
+    EXPECT_TRUE(cache_loaded.Load(CACHE));
+    EXPECT_EQ(1, cache_loaded.Size());
+
+    bool is_valid = true;
+    std::string message;
+    EXPECT_TRUE(cache_loaded.Find(MANIFEST, is_valid, message));
+    EXPECT_FALSE(is_valid);
+    EXPECT_STREQ("Invalid manifest", message.c_str());
+
+    QFile::remove(MANIFEST.c_str());
+    QFile::remove(CACHE.c_str());
+}
+
+TEST(test_layer_manifest_cache, changed_manifest) {
+    const std::string MANIFEST("./test_layer_manifest_cache_changed_manifest.json");
+    ASSERT_TRUE(CopyManifest(":/VK_LAYER_LUNARG_test_00.json", MANIFEST));
+
+    LayerManifestCache cache;
+    cache.Record(MANIFEST, true, "");
+
+    bool is_valid = false;
+    std::string message;
+    EXPECT_TRUE(cache.Find(MANIFEST, is_valid, message));
+    EXPECT_TRUE(is_valid);
+
+    // A manifest of a different size is validated again
+    ASSERT_TRUE(CopyManifest(":/VK_LAYER_LUNARG_test_01.json", MANIFEST));
+    EXPECT_FALSE(cache.Find(MANIFEST, is_valid, message));
+
+    QFile::remove(MANIFEST.c_str());
+}
+
+TEST(test_layer_manifest_cache, unused_entries_pruned) {
+    const std::string MANIFEST("./test_layer_manifest_cache_unused_entries_pruned.json");
+    const std::string CACHE("./test_layer_manifest_cache_unused_entries_pruned_cache.json");
+    ASSERT_TRUE(CopyManifest(":/VK_LAYER_LUNARG_test_00.json", MANIFEST));
+
+    LayerManifestCache cache_saved;
+    cache_saved.Record(MANIFEST, true, "");
+    EXPECT_TRUE(cache_saved.Save(CACHE));
+
+    // The manifest isn't found by the next search, so it is forgotten
+    LayerManifestCache cache_loaded;
+    EXPECT_TRUE(cache_loaded.Load(CACHE));
+    EXPECT_TRUE(cache_loaded.Save(CACHE));
+    EXPECT_EQ(0, cache_loaded.Size());
+
+    QFile::remove(MANIFEST.c_str());
+    QFile::remove(CACHE.c_str());
+}
+
+TEST(test_layer_manifest_cache, layer_load) {
+    const std::string MANIFEST("./test_layer_manifest_cache_layer_load.json");
+    ASSERT_TRUE(CopyManifest(":/VK_LAYER_LUNARG_reference_1_2_1.json", MANIFEST));
+
+    LayerManifestCache cache;
+
+    std::string message_validated;
+    Layer layer_validated;
+    const bool load_validated =
+        layer_validated.Load(std::vector<Layer>(), MANIFEST, LAYER_TYPE_EXPLICIT, &message_validated, &cache);
+    EXPECT_EQ(1, cache.Size());
+
+    // The second load reuses the validation result of the first one
+    std::string message_cached;
+    Layer layer_cached;
+    const bool load_cached = layer_cached.Load(std::vector<Layer>(), MANIFEST, LAYER_TYPE_EXPLICIT, &message_cached, &cache);
+    EXPECT_EQ(load_validated, load_cached);
+    EXPECT_STREQ(message_validated.c_str(), message_cached.c_str());
+    EXPECT_EQ(layer_validated.key, layer_cached.key);
+    EXPECT_EQ(layer_validated.settings.size(), layer_cached.settings.size());
+
+    QFile::remove(MANIFEST.c_str());
+}
+
+TEST(test_layer_manifest_cache, shared_summaries_save_load) {
+    const std::string MANIFEST("./test_layer_manifest_cache_shared_summaries.json");
+    const std::string CACHE("./test_layer_manifest_cache_shared_summaries.txt");
+    ASSERT_TRUE(CopyManifest(":/VK_LAYER_LUNARG_test_00.json", MANIFEST));
+
+    vku::ManifestSummary summary;
+    summary.type = vku::MANIFEST_TYPE_IMPLICIT_LAYER;
+    summary.name = "VK_LAYER_LUNARG_test_00";
+    summary.library_path = ".\\VkLayer_test.dll";
+    summary.api_version = "1.2.170";
+
+    vku::ManifestCache cache_saved;
+    cache_saved.Record(MANIFEST, summary);
+    cache_saved.Record("./test_layer_manifest_cache_missing.json", summary);
+    EXPECT_EQ(1, cache_saved.Size());
+    EXPECT_TRUE(cache_saved.Save(CACHE));
+
+    vku::ManifestCache cache_loaded;
+    EXPECT_TRUE(cache_loaded.Load(CACHE));
+
+    vku::ManifestSummary summary_loaded;
+    EXPECT_TRUE(cache_loaded.Find(MANIFEST, summary_loaded));
+    EXPECT_EQ(vku::MANIFEST_TYPE_IMPLICIT_LAYER, summary_loaded.type);
+    EXPECT_EQ(vku::MANIFEST_STATUS_VALID, summary_loaded.status);
+    EXPECT_STREQ(summary.name.c_str(), summary_loaded.name.c_str());
+    EXPECT_STREQ(summary.library_path.c_str(), summary_loaded.library_path.c_str());
+    EXPECT_STREQ(summary.api_version.c_str(), summary_loaded.api_version.c_str());
+
+    // The summary is outdated once the manifest changes
+    {
+        QFile file(MANIFEST.c_str());
+        ASSERT_TRUE(file.open(QIODevice::Append | QIODevice::Text));
+        file.write("\n");
+    }
+    EXPECT_FALSE(cache_loaded.Find(MANIFEST, summary_loaded));
+
+    QFile::remove(MANIFEST.c_str());
+    QFile::remove(CACHE.c_str());
+}
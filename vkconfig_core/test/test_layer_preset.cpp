@@ -76,3 +76,59 @@ TEST(test_layer_preset, has_preset) {
     preset_settings.push_back(presetC);
     EXPECT_EQ(false, HasPreset(layer_settings, preset_settings));
 }
+
+TEST(test_layer_preset, tracker) {
+    Layer layer;
+
+    SettingMetaString* metaA = InstantiateString(layer, "KeyA");
+    SettingMetaString* metaB = InstantiateString(layer, "KeyB");
+
+    SettingDataString* layerA = Instantiate<SettingDataString>(metaA);
+    layerA->value = "ValueA";
+    SettingDataString* layerB = Instantiate<SettingDataString>(metaB);
+    layerB->value = "ValueB";
+
+    SettingDataSet layer_settings;
+    layer_settings.push_back(layerA);
+    layer_settings.push_back(layerB);
+
+    LayerPreset preset_empty;
+    preset_empty.label = "Empty";
+
+    LayerPreset preset_a;
+    preset_a.label = "A";
+    SettingDataString* presetA = Instantiate<SettingDataString>(metaA);
+    presetA->value = "ValueA";
+    preset_a.settings.push_back(presetA);
+
+    LayerPreset preset_b;
+    preset_b.label = "B";
+    SettingDataString* presetB = Instantiate<SettingDataString>(metaB);
+    presetB->value = "ValueC";
+    preset_b.settings.push_back(presetB);
+
+    std::vector<LayerPreset> presets;
+    presets.push_back(preset_empty);
+    presets.push_back(preset_b);
+    presets.push_back(preset_a);
+
+    LayerPresetTracker tracker(presets, layer_settings);
+    ASSERT_TRUE(tracker.FindPreset() != nullptr);
+    EXPECT_STREQ("A", tracker.FindPreset()->label.c_str());
+
+    layerB->value = "ValueC";
+    tracker.Update("KeyB");
+    ASSERT_TRUE(tracker.FindPreset() != nullptr);
+    EXPECT_STREQ("B", tracker.FindPreset()->label.c_str());
+
+    layerA->value = "ValueB";
+    layerB->value = "ValueB";
+    tracker.UpdateAll();
+    EXPECT_EQ(nullptr, tracker.FindPreset());
+
+    layerA->value = "ValueA";
+    tracker.Update("KeyC");
+    EXPECT_EQ(nullptr, tracker.FindPreset());
+    tracker.Update("KeyA");
+    EXPECT_STREQ("A", tracker.FindPreset()->label.c_str());
+}
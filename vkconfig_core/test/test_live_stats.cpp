@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "../live_stats.h"
+
+#include <gtest/gtest.h>
+
+#include <new>
+
+static const std::size_t TELEMETRY_BLOCK_SIZE = LIVE_TELEMETRY_HEADER_SIZE + LIVE_TELEMETRY_SLOT_SIZE * LIVE_TELEMETRY_SLOTS;
+
+static LiveTelemetryHeader* InitTelemetryBlock(std::vector<uint64_t>& storage) {
+    storage.assign(TELEMETRY_BLOCK_SIZE / sizeof(uint64_t), 0);
+    uint8_t* block = reinterpret_cast<uint8_t*>(&storage[0]);
+
+    LiveTelemetryHeader* header = new (block) LiveTelemetryHeader;
+    header->version = LIVE_TELEMETRY_VERSION;
+    header->slot_count = LIVE_TELEMETRY_SLOTS;
+    header->slot_size = LIVE_TELEMETRY_SLOT_SIZE;
+    header->updates.store(1);
+    for (int i = 0; i < LIVE_TELEMETRY_SLOTS; ++i) {
+        LiveTelemetrySlot* slot = new (block + LIVE_TELEMETRY_HEADER_SIZE + LIVE_TELEMETRY_SLOT_SIZE * i) LiveTelemetrySlot;
+        slot->sequence.store(0);
+    }
+    header->magic = LIVE_TELEMETRY_MAGIC;
+    return header;
+}
+
+static LiveTelemetrySlot* GetTelemetrySlot(std::vector<uint64_t>& storage, int index) {
+    uint8_t* block = reinterpret_cast<uint8_t*>(&storage[0]);
+    return reinterpret_cast<LiveTelemetrySlot*>(block + LIVE_TELEMETRY_HEADER_SIZE + LIVE_TELEMETRY_SLOT_SIZE * index);
+}
+
+TEST(test_live_stats, read_telemetry) {
+    std::vector<uint64_t> storage;
+    LiveTelemetryHeader* header = InitTelemetryBlock(storage);
+
+    LiveTelemetrySlot* slot_a = GetTelemetrySlot(storage, 0);
+    slot_a->swapchain = 1;
+    slot_a->frames = 10;
+    slot_a->fps = 30.0f;
+    slot_a->median_ms = 33.0f;
+    slot_a->sequence.store(2);
+
+    LiveTelemetrySlot* slot_b = GetTelemetrySlot(storage, 3);
+    slot_b->swapchain = 2;
+    slot_b->frames = 100;
+    slot_b->fps = 60.0f;
+    slot_b->median_ms = 16.0f;
+    slot_b->memory_usage_mb = 512.0f;
+    slot_b->memory_budget_mb = 4096.0f;
+    slot_b->sequence.store(2);
+
+    // Being written
+    LiveTelemetrySlot* slot_c = GetTelemetrySlot(storage, 5);
+    slot_c->swapchain = 3;
+    slot_c->frames = 1000;
+    slot_c->sequence.store(3);
+
+    LiveStats stats;
+    EXPECT_TRUE(ReadTelemetryBlock(&storage[0], TELEMETRY_BLOCK_SIZE, stats));
+    EXPECT_TRUE(stats.telemetry);
+    EXPECT_EQ(100, stats.frames);
+    EXPECT_FLOAT_EQ(60.0f, stats.fps);
+    EXPECT_FLOAT_EQ(4096.0f, stats.memory_budget_mb);
+    ASSERT_EQ(1, stats.frame_times_ms.size());
+
+    // The history only grows with the updates of the layer
+    EXPECT_TRUE(ReadTelemetryBlock(&storage[0], TELEMETRY_BLOCK_SIZE, stats));
+    EXPECT_EQ(1, stats.frame_times_ms.size());
+
+    header->updates.store(2);
+    EXPECT_TRUE(ReadTelemetryBlock(&storage[0], TELEMETRY_BLOCK_SIZE, stats));
+    EXPECT_EQ(2, stats.frame_times_ms.size());
+}
+
+TEST(test_live_stats, read_telemetry_unpublished) {
+    std::vector<uint64_t> storage;
+    LiveTelemetryHeader* header = InitTelemetryBlock(storage);
+    header->magic = 0;
+
+    LiveStats stats;
+    EXPECT_FALSE(ReadTelemetryBlock(&storage[0], TELEMETRY_BLOCK_SIZE, stats));
+    EXPECT_FALSE(ReadTelemetryBlock(nullptr, 0, stats));
+    EXPECT_FALSE(stats.telemetry);
+}
+
+TEST(test_live_stats, read_api_dump_reports) {
+    std::string text =
+        "[\n"
+        "{\n"
+        "    \"firstFrame\" : 1,\n"
+        "    \"lastFrame\" : 1,\n"
+        "    \"functions\" :\n"
+        "    [\n"
+        "        { \"name\" : \"vkQueueSubmit\", \"calls\" : 2, \"totalNs\" : 2000000, \"maxNs\" : 0, \"histogram\" : [] },\n"
+        "        { \"name\" : \"vkAcquireNextImageKHR\", \"calls\" : 1, \"totalNs\" : 5000000, \"maxNs\" : 0, \"histogram\" : [] }\n"
+        "    ]\n"
+        "},\n"
+        "{\n"
+        "    \"firstFrame\" : 2,\n"
+        "    \"lastFrame\" : 2,\n"
+        "    \"functions\" :\n"
+        "    [\n"
+        "        { \"name\" : \"vkQueueSubmit\", \"calls\" : 4, \"totalNs\" : 6000000, \"maxNs\" : 0, \"histogram\" : [] }\n"
+        "    ]\n"
+        "},\n"
+        "{\n"
+        "    \"firstFrame\" : 3,\n";
+
+    LiveStats stats;
+    EXPECT_TRUE(ReadApiDumpStatsReports(text, stats));
+    EXPECT_TRUE(stats.api_stats);
+    EXPECT_DOUBLE_EQ(3.0, stats.submits_per_frame);
+    ASSERT_EQ(2, stats.top_calls.size());
+    EXPECT_STREQ("vkQueueSubmit", stats.top_calls[0].name.c_str());
+    EXPECT_EQ(6, stats.top_calls[0].calls);
+    EXPECT_DOUBLE_EQ(8.0, stats.top_calls[0].total_ms);
+
+    // The incomplete report is kept for the next read
+    EXPECT_EQ(0, text.find("{\n    \"firstFrame\" : 3,"));
+    EXPECT_FALSE(ReadApiDumpStatsReports(text, stats));
+
+    text += "    \"lastFrame\" : 3,\n    \"functions\" :\n    [\n    ]\n}\n]\n";
+    EXPECT_TRUE(ReadApiDumpStatsReports(text, stats));
+    EXPECT_DOUBLE_EQ(0.0, stats.submits_per_frame);
+    EXPECT_TRUE(stats.top_calls.empty());
+}
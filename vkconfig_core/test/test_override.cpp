@@ -27,6 +27,9 @@
 #include <gtest/gtest.h>
 
 #include <QtGlobal>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
 
 #include <cstdlib>
 
@@ -98,6 +101,54 @@ TEST(test_override, write_erase_2_2_2) {
     env.Reset(Environment::SYSTEM);  // Don't change the system settings on exit
 }
 
+TEST(test_override, write_unchanged) {
+    const std::string LAYERS("./override_layers_unchanged.json");
+    const std::string SETTINGS("./override_settings_unchanged.txt");
+
+    PathManager paths("");
+    Environment env(paths, Version(1, 2, 170));
+    env.Reset(Environment::DEFAULT);
+
+    LayerManager layer_manager(env);
+    layer_manager.LoadLayersFromPath(":/");
+
+    Configuration configuration;
+    const bool load = configuration.Load(layer_manager.available_layers, ":/Configuration 2.2.2.json");
+    EXPECT_TRUE(load);
+
+    EXPECT_EQ(true, WriteLayersOverride(env, layer_manager.available_layers, configuration, LAYERS));
+    EXPECT_EQ(true, WriteSettingsOverride(layer_manager.available_layers, configuration, SETTINGS));
+
+    // Date the files in the past, to detect whether they are written again
+    const QDateTime past = QDateTime::currentDateTime().addDays(-1);
+    {
+        QFile file_layers(LAYERS.c_str());
+        ASSERT_TRUE(file_layers.open(QIODevice::ReadWrite));
+        ASSERT_TRUE(file_layers.setFileTime(past, QFileDevice::FileModificationTime));
+        QFile file_settings(SETTINGS.c_str());
+        ASSERT_TRUE(file_settings.open(QIODevice::ReadWrite));
+        ASSERT_TRUE(file_settings.setFileTime(past, QFileDevice::FileModificationTime));
+    }
+
+    EXPECT_EQ(true, WriteLayersOverride(env, layer_manager.available_layers, configuration, LAYERS));
+    EXPECT_EQ(true, WriteSettingsOverride(layer_manager.available_layers, configuration, SETTINGS));
+
+    EXPECT_TRUE(QFileInfo(LAYERS.c_str()).lastModified() < QDateTime::currentDateTime().addSecs(-3600));
+    EXPECT_TRUE(QFileInfo(SETTINGS.c_str()).lastModified() < QDateTime::currentDateTime().addSecs(-3600));
+
+    // A changed configuration is written
+    configuration.parameters[0].state =
+        configuration.parameters[0].state == LAYER_STATE_OVERRIDDEN ? LAYER_STATE_EXCLUDED : LAYER_STATE_OVERRIDDEN;
+    EXPECT_EQ(true, WriteLayersOverride(env, layer_manager.available_layers, configuration, LAYERS));
+
+    EXPECT_TRUE(QFileInfo(LAYERS.c_str()).lastModified() > QDateTime::currentDateTime().addSecs(-3600));
+
+    EXPECT_EQ(true, EraseLayersOverride(LAYERS));
+    EXPECT_EQ(true, EraseSettingsOverride(SETTINGS));
+
+    env.Reset(Environment::SYSTEM);  // Don't change the system settings on exit
+}
+
 TEST(test_override, vk_layer_settings_txt) {
     const char* LAYER = "VK_LAYER_LUNARG_reference_1_2_1";
 
@@ -238,3 +289,35 @@ TEST(test_override, env_var) {
 
     env.Reset(Environment::SYSTEM);  // Don't change the system settings on exit
 }
+
+#if defined(VK_EXT_layer_settings)
+TEST(test_override, layer_settings_create_info) {
+    const char* LAYER = "VK_LAYER_LUNARG_reference_1_2_1";
+
+    qputenv("VK_LUNARG_REFERENCE_1_2_1_CHAINED_BOOL", "true");
+
+    const VkBool32 chained_bool = VK_FALSE;
+    const int32_t chained_int = 76;
+    const char* chained_strings[] = {"flag0", "flag2"};
+    const VkLayerSettingEXT settings[] = {
+        {LAYER, "chained_bool", VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, &chained_bool},
+        {LAYER, "chained_int", VK_LAYER_SETTING_TYPE_INT32_EXT, 1, &chained_int},
+        {LAYER, "chained_strings", VK_LAYER_SETTING_TYPE_STRING_EXT, 2, chained_strings},
+        {"VK_LAYER_LUNARG_other", "chained_int", VK_LAYER_SETTING_TYPE_INT32_EXT, 1, &chained_int}};
+    VkLayerSettingsCreateInfoEXT create_info = {VK_STRUCTURE_TYPE_LAYER_SETTINGS_CREATE_INFO_EXT, nullptr, 4, settings};
+
+    const vku::LayerSettingDeclaration declarations[] = {{"chained_bool", vku::LAYER_SETTING_TYPE_BOOL},
+                                                          {"chained_int", vku::LAYER_SETTING_TYPE_INT},
+                                                          {"chained_strings", vku::LAYER_SETTING_TYPE_STRINGS},
+                                                          {"not_chained", vku::LAYER_SETTING_TYPE_INT}};
+    vku::LayerSettingRegistry registry(LAYER, declarations, 4, &create_info);
+
+    // The chained settings take precedence over the environment
+    EXPECT_EQ(true, registry.IsSet(0));
+    EXPECT_EQ(false, registry.GetBool(0));
+    EXPECT_EQ(76, registry.GetInt(1));
+    EXPECT_EQ(2, registry.GetStrings(2).size());
+    EXPECT_STREQ("flag2", registry.GetStrings(2)[1].c_str());
+    EXPECT_EQ(false, registry.IsSet(3));
+}
+#endif
@@ -25,6 +25,8 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+
 inline SettingMetaString* InstantiateString(Layer& layer, const std::string& key) {
     return static_cast<SettingMetaString*>(layer.Instantiate(layer.settings, key, SETTING_STRING));
 }
@@ -268,6 +270,34 @@ TEST(test_parameter, apply_settings) {
     EXPECT_STREQ("setting value", static_cast<SettingDataString*>(FindSetting(parameter.settings, "B"))->value.c_str());
 }
 
+TEST(test_parameter, detach_settings) {
+    std::vector<Layer> layers;
+    layers.push_back(Layer());
+    layers[0].key = "Layer";
+
+    SettingMetaString* metaA = InstantiateString(layers[0], "A");
+    metaA->default_value = "default value";
+
+    Parameter parameter("Layer", LAYER_STATE_OVERRIDDEN);
+    CollectDefaultSettingData(layers[0].settings, parameter.settings);
+    EXPECT_FALSE(parameter.HasSharedSettings());
+
+    Parameter copy = parameter;
+    EXPECT_TRUE(parameter.HasSharedSettings());
+    EXPECT_TRUE(copy.HasSharedSettings());
+    EXPECT_EQ(parameter.settings[0], copy.settings[0]);
+
+    copy.DetachSettings(layers);
+    EXPECT_FALSE(parameter.HasSharedSettings());
+    EXPECT_FALSE(copy.HasSharedSettings());
+    EXPECT_NE(parameter.settings[0], copy.settings[0]);
+
+    static_cast<SettingDataString*>(FindSetting(copy.settings, "A"))->value = "copy value";
+
+    EXPECT_STREQ("default value", static_cast<SettingDataString*>(FindSetting(parameter.settings, "A"))->value.c_str());
+    EXPECT_STREQ("copy value", static_cast<SettingDataString*>(FindSetting(copy.settings, "A"))->value.c_str());
+}
+
 TEST(test_parameter, gather_parameters_exist) {
     std::vector<Parameter> parameters = GatherParameters(GenerateTestParametersExist(), GenerateTestLayers());
 
@@ -428,3 +458,45 @@ TEST(test_parameter, compute_min_api_version_missing_all) {
     Version min_version_A = ComputeMinApiVersion(Version(1, 2, 170), parameters, layers);
     EXPECT_EQ(Version(1, 2, 170), min_version_A);
 }
+
+TEST(test_parameter, benchmark_500_layers) {
+    typedef std::chrono::high_resolution_clock Clock;
+
+    const int LAYER_COUNT = 500;
+
+    std::vector<Layer> layers;
+    for (int i = 0; i < LAYER_COUNT; ++i) {
+        const LayerType type = i % 3 == 0 ? LAYER_TYPE_IMPLICIT : LAYER_TYPE_EXPLICIT;
+        layers.push_back(Layer(format("VK_LAYER_TEST_%03d", i), type, Version(1, 0, 0), Version(1, 2, 148), "1", "layer.json"));
+    }
+
+    // Every other layer has a parameter, and there are as many parameters of missing layers
+    std::vector<Parameter> parameters;
+    for (int i = 0; i < LAYER_COUNT; i += 2) {
+        const LayerState state = i % 4 == 0 ? LAYER_STATE_OVERRIDDEN : LAYER_STATE_EXCLUDED;
+        parameters.push_back(Parameter(format("VK_LAYER_TEST_%03d", i), state));
+        parameters.push_back(Parameter(format("VK_LAYER_MISSING_%03d", i), LAYER_STATE_OVERRIDDEN));
+    }
+
+    const Clock::time_point start = Clock::now();
+
+    const std::vector<Parameter>& gathered_parameters = GatherParameters(parameters, layers);
+    const std::size_t excluded_count = CountExcludedLayers(gathered_parameters, layers);
+    std::string missing_layer;
+    const bool has_missing_layer = HasMissingLayer(gathered_parameters, layers, missing_layer);
+
+    const Clock::time_point end = Clock::now();
+    RecordProperty("duration_us",
+                   static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()));
+
+    EXPECT_EQ(LAYER_COUNT + LAYER_COUNT / 2, gathered_parameters.size());
+    EXPECT_EQ(LAYER_COUNT / 4, excluded_count);
+    EXPECT_TRUE(has_missing_layer);
+
+    // The parameters of the missing layers are first
+    EXPECT_EQ(PARAMETER_RANK_MISSING, GetParameterOrdering(layers, gathered_parameters.front()));
+    EXPECT_EQ(PARAMETER_RANK_EXPLICIT_AVAILABLE, GetParameterOrdering(layers, gathered_parameters.back()));
+    for (std::size_t i = 1, n = gathered_parameters.size(); i < n; ++i) {
+        EXPECT_LE(GetParameterOrdering(layers, gathered_parameters[i - 1]), GetParameterOrdering(layers, gathered_parameters[i]));
+    }
+}
@@ -173,3 +173,30 @@ TEST(test_path, get_path_vulkan_content) {
     EXPECT_TRUE(value.startsWith(::GetPath(BUILTIN_PATH_VULKAN_SDK).c_str()));
     EXPECT_TRUE(value.toLower().endsWith("config"));
 }
+
+TEST(test_path, check_directory_exists) {
+    const std::string path = ConvertNativeSeparators(QDir::currentPath().toStdString() + "/test_path_check_directory_exists");
+    QDir().rmdir(path.c_str());
+
+    InvalidatePathCache();
+    EXPECT_FALSE(CheckDirectoryExists(path));
+
+    // The result is remembered until the cache is invalidated
+    QDir().mkdir(path.c_str());
+    EXPECT_FALSE(CheckDirectoryExists(path));
+
+    InvalidatePathCache();
+    EXPECT_TRUE(CheckDirectoryExists(path));
+
+    QDir().rmdir(path.c_str());
+    InvalidatePathCache();
+}
+
+TEST(test_path, get_path_environment_changed) {
+    qputenv("VULKAN_SDK", "~/VulkanSDK_A");
+    EXPECT_STREQ(ConvertNativeSeparators("~/VulkanSDK_A").c_str(), ::GetPath(BUILTIN_PATH_VULKAN_SDK).c_str());
+
+    qputenv("VULKAN_SDK", "~/VulkanSDK_B");
+    EXPECT_STREQ(ConvertNativeSeparators("~/VulkanSDK_B").c_str(), ::GetPath(BUILTIN_PATH_VULKAN_SDK).c_str());
+    EXPECT_TRUE(::GetPath(BUILTIN_PATH_VULKAN_CONTENT).find(ConvertNativeSeparators("~/VulkanSDK_B")) == 0);
+}
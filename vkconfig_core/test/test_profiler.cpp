@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "../profiler.h"
+
+#include <gtest/gtest.h>
+
+TEST(test_profiler, disabled) {
+    ResetProfiler();
+    EnableProfiler(false);
+
+    {
+        ScopedTimer timer("Disabled");
+    }
+
+    EXPECT_TRUE(GetProfilerReport().empty());
+}
+
+TEST(test_profiler, nested_scopes) {
+    ResetProfiler();
+    EnableProfiler(true);
+
+    for (int i = 0; i < 2; ++i) {
+        ScopedTimer timer_parent("Parent");
+        {
+            ScopedTimer timer_child("Child");
+        }
+    }
+
+    EnableProfiler(false);
+
+    const std::string report = GetProfilerReport();
+    EXPECT_EQ(0, report.find("Parent: "));
+    EXPECT_NE(std::string::npos, report.find("\n  Child: "));
+    EXPECT_NE(std::string::npos, report.find("(2 calls)"));
+
+    ResetProfiler();
+    EXPECT_TRUE(GetProfilerReport().empty());
+}
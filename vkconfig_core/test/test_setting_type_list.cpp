@@ -23,6 +23,8 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 inline SettingMetaList* InstantiateList(Layer& layer, const std::string& key) {
     return static_cast<SettingMetaList*>(layer.Instantiate(layer.settings, key, SETTING_LIST));
 }
@@ -101,3 +103,11 @@ TEST(test_setting_type_list, validation_list) {
 
     EXPECT_TRUE(!list.empty());
 }
+
+TEST(test_setting_type_list, validation_list_shared) {
+    const std::vector<NumberOrString>& vuids = GetVUIDs();
+
+    EXPECT_TRUE(!vuids.empty());
+    EXPECT_TRUE(std::is_sorted(vuids.begin(), vuids.end()));
+    EXPECT_EQ(&vuids, &GetVUIDs());
+}
@@ -213,6 +213,34 @@ TEST(test_util, format_find) {
     EXPECT_EQ(false, IsFound(container, "D"));
 }
 
+TEST(test_util, key_index_find) {
+    struct Element {
+        std::string key;
+        int value;
+    };
+
+    std::vector<Element> container;
+    EXPECT_EQ(nullptr, KeyIndex<Element>(container).Find("A"));
+
+    Element elementA0 = {"A", 0};
+    Element elementB = {"B", 1};
+    Element elementA1 = {"A", 2};
+
+    container.push_back(elementA0);
+    container.push_back(elementB);
+    container.push_back(elementA1);
+
+    const KeyIndex<Element> index(container);
+
+    EXPECT_EQ(FindByKey(container, "A"), index.Find("A"));
+    EXPECT_EQ(0, index.Find("A")->value);  // The first element of a key is found, like FindByKey
+    EXPECT_EQ(FindByKey(container, "B"), index.Find("B"));
+    EXPECT_EQ(nullptr, index.Find("C"));
+
+    EXPECT_EQ(true, index.IsFound("B"));
+    EXPECT_EQ(false, index.IsFound("C"));
+}
+
 TEST(test_util, to_lower_case) {
     EXPECT_STREQ("string", ToLowerCase("string").c_str());
     EXPECT_STREQ(" string", ToLowerCase(" string").c_str());
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2020-2023 Valve Corporation
+ * Copyright (c) 2020-2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+
+#include "../vuid_database.h"
+#include "../setting_list.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+static void PushUInt32(std::vector<unsigned char>& data, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        data.push_back(static_cast<unsigned char>(value >> (i * 8)));
+    }
+}
+
+static std::vector<unsigned char> BuildDatabase(const std::vector<const char*>& vuids) {
+    std::vector<unsigned char> data;
+    PushUInt32(data, 0x44495556);
+    PushUInt32(data, 1);
+    PushUInt32(data, static_cast<uint32_t>(vuids.size()));
+    data.insert(data.end(), VUIDDatabase::HASH_SIZE, 0);
+
+    uint32_t offset = 0;
+    for (std::size_t i = 0, n = vuids.size(); i < n; ++i) {
+        PushUInt32(data, offset);
+        offset += static_cast<uint32_t>(std::strlen(vuids[i]) + 1);
+    }
+    for (std::size_t i = 0, n = vuids.size(); i < n; ++i) {
+        data.insert(data.end(), vuids[i], vuids[i] + std::strlen(vuids[i]) + 1);
+    }
+
+    return data;
+}
+
+TEST(test_vuid_database, init) {
+    const std::vector<unsigned char>& data = BuildDatabase(std::vector<const char*>{"VUID-A", "VUID-B", "VUID-C"});
+
+    VUIDDatabase database;
+    EXPECT_TRUE(database.Init(&data[0], data.size()));
+    EXPECT_EQ(3, database.Size());
+    EXPECT_STREQ("VUID-A", database.Get(0));
+    EXPECT_STREQ("VUID-C", database.Get(2));
+    EXPECT_EQ(nullptr, database.Get(3));
+}
+
+TEST(test_vuid_database, init_invalid) {
+    std::vector<unsigned char> data = BuildDatabase(std::vector<const char*>{"VUID-A", "VUID-B"});
+
+    VUIDDatabase database;
+    EXPECT_FALSE(database.Init(nullptr, 0));
+    EXPECT_FALSE(database.Init(&data[0], data.size() - 1));  // Last VUID not terminated
+    EXPECT_EQ(0, database.Size());
+
+    data[0] = 0;  // Wrong magic
+    EXPECT_FALSE(database.Init(&data[0], data.size()));
+}
+
+TEST(test_vuid_database, find) {
+    const std::vector<unsigned char>& data = BuildDatabase(std::vector<const char*>{"VUID-A", "VUID-B", "VUID-C", "VUID-D"});
+
+    VUIDDatabase database;
+    ASSERT_TRUE(database.Init(&data[0], data.size()));
+    EXPECT_TRUE(database.Find("VUID-A"));
+    EXPECT_TRUE(database.Find("VUID-C"));
+    EXPECT_TRUE(database.Find("VUID-D"));
+    EXPECT_FALSE(database.Find("VUID-0"));
+    EXPECT_FALSE(database.Find("VUID-BB"));
+    EXPECT_FALSE(database.Find("VUID-E"));
+}
+
+TEST(test_vuid_database, builtin) {
+    const VUIDDatabase& database = GetBuiltinVUIDDatabase();
+    if (database.Size() == 0) return;  // The build didn't generate the database
+
+    for (std::size_t i = 1, n = database.Size(); i < n; ++i) {
+        EXPECT_LT(std::strcmp(database.Get(i - 1), database.Get(i)), 0);
+    }
+
+    EXPECT_TRUE(database.Find("VUID-vkGetInstanceProcAddr-instance-parameter"));
+    EXPECT_EQ(database.Size(), GetVUIDs().size());
+}
@@ -35,6 +35,7 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <unordered_map>
 
 // Based on https://www.g-truc.net/post-0708.html#menu
 template <typename T, std::size_t N>
@@ -90,6 +91,31 @@ bool IsFound(const std::vector<T>& container, const char* key) {
     return FindByKey(container, key) != nullptr;
 }
 
+// Hash index of the elements of a container by key, for the functions looking up many keys.
+// Like FindByKey, the first element of a key is found. The index is invalidated when the container is modified.
+template <typename T>
+class KeyIndex {
+   public:
+    explicit KeyIndex(const std::vector<T>& container) {
+        index.reserve(container.size());
+        for (std::size_t i = 0, n = container.size(); i < n; ++i) {
+            index.insert(std::make_pair(container[i].key, &container[i]));
+        }
+    }
+
+    const T* Find(const std::string& key) const {
+        assert(!key.empty());
+
+        auto it = index.find(key);
+        return it == index.end() ? nullptr : it->second;
+    }
+
+    bool IsFound(const std::string& key) const { return Find(key) != nullptr; }
+
+   private:
+    std::unordered_map<std::string, const T*> index;
+};
+
 // Remove a value if it's present
 void RemoveString(std::vector<std::string>& list, const std::string& value);
 
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2020-2023 Valve Corporation
+ * Copyright (c) 2020-2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "vuid_database.h"
+
+#include <cstring>
+
+static const uint32_t VUID_DATABASE_MAGIC = 0x44495556;  // 'VUID'
+static const uint32_t VUID_DATABASE_VERSION = 1;
+
+static uint32_t ReadUInt32(const unsigned char* data) {
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) | (static_cast<uint32_t>(data[2]) << 16) |
+           (static_cast<uint32_t>(data[3]) << 24);
+}
+
+VUIDDatabase::VUIDDatabase() : hash(nullptr), offsets(nullptr), pool(nullptr), pool_size(0), count(0) {}
+
+bool VUIDDatabase::Init(const unsigned char* data, std::size_t size) {
+    *this = VUIDDatabase();
+
+    const std::size_t header_size = sizeof(uint32_t) * 3 + HASH_SIZE;
+    if (data == nullptr || size < header_size) return false;
+
+    if (ReadUInt32(data) != VUID_DATABASE_MAGIC) return false;
+    if (ReadUInt32(data + 4) != VUID_DATABASE_VERSION) return false;
+
+    const std::size_t vuid_count = ReadUInt32(data + 8);
+    if ((size - header_size) / sizeof(uint32_t) < vuid_count) return false;
+
+    const std::size_t pool_offset = header_size + vuid_count * sizeof(uint32_t);
+
+    // The last VUID has to be terminated for all the VUIDs to be
+    if (vuid_count > 0 && (size == pool_offset || data[size - 1] != '\0')) return false;
+
+    for (std::size_t i = 0; i < vuid_count; ++i) {
+        if (ReadUInt32(data + header_size + i * sizeof(uint32_t)) >= size - pool_offset) return false;
+    }
+
+    this->hash = data + 12;
+    this->offsets = data + header_size;
+    this->pool = reinterpret_cast<const char*>(data + pool_offset);
+    this->pool_size = size - pool_offset;
+    this->count = vuid_count;
+    return true;
+}
+
+const char* VUIDDatabase::Get(std::size_t index) const {
+    if (index >= count) return nullptr;
+
+    return pool + ReadUInt32(offsets + index * sizeof(uint32_t));
+}
+
+bool VUIDDatabase::Find(const char* vuid) const {
+    std::size_t first = 0;
+    std::size_t last = count;
+
+    while (first < last) {
+        const std::size_t middle = first + (last - first) / 2;
+        const int result = std::strcmp(Get(middle), vuid);
+        if (result == 0) return true;
+        if (result < 0) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+
+    return false;
+}
+
+const VUIDDatabase& GetBuiltinVUIDDatabase() {
+    static const VUIDDatabase database = []() {
+        VUIDDatabase result;
+#ifdef VKCONFIG_VUID_DATABASE
+        result.Init(VUID_DATABASE, VUID_DATABASE_SIZE);
+#endif
+        return result;
+    }();
+
+    return database;
+}
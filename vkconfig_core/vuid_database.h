@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2020-2023 Valve Corporation
+ * Copyright (c) 2020-2023 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// The VUID database is validusage.json converted by scripts/vuid_database_generator.py into a sorted string pool:
+//   uint32_t magic, version, count
+//   uint8_t  sha1[20]       SHA-1 of the validusage.json it was generated from
+//   uint32_t offsets[count] Offsets of the VUIDs in the pool, in sorted order
+//   char     pool[]         Null terminated VUIDs
+// All the integers are little endian.
+class VUIDDatabase {
+   public:
+    enum { HASH_SIZE = 20 };
+
+    VUIDDatabase();
+
+    bool Init(const unsigned char* data, std::size_t size);
+
+    std::size_t Size() const { return count; }
+    const char* Get(std::size_t index) const;
+    const unsigned char* GetSourceHash() const { return hash; }
+
+    // Binary search of a VUID
+    bool Find(const char* vuid) const;
+
+   private:
+    const unsigned char* hash;
+    const unsigned char* offsets;
+    const char* pool;
+    std::size_t pool_size;
+    std::size_t count;
+};
+
+// The database of the validusage.json bundled with Vulkan Configurator, generated by the build.
+// It lives in the read-only data of the executable, it's empty when the build didn't generate it.
+const VUIDDatabase& GetBuiltinVUIDDatabase();
+
+#ifdef VKCONFIG_VUID_DATABASE
+extern const unsigned char VUID_DATABASE[];
+extern const std::size_t VUID_DATABASE_SIZE;
+#endif
@@ -25,16 +25,22 @@
 
 #include "vk_layer_settings.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
 #include <cassert>
 #include <cstring>
 #include <cctype>
+#include <cerrno>
 #include <cstdarg>
-#include <fstream>
 #include <array>
+#include <chrono>
 #include <map>
-#include <sstream>
+#include <memory>
+#include <mutex>
 #include <regex>
+#include <thread>
 #include <sys/stat.h>
 
 #if defined(_WIN32)
@@ -42,10 +48,27 @@
 #include <direct.h>
 #define GetCurrentDir _getcwd
 #else
+#include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #define GetCurrentDir getcwd
 #endif
 
+#if defined(__linux__)
+#include <sys/inotify.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#include <sys/event.h>
+#define VKU_USE_KQUEUE
+#endif
+
+#if defined(__APPLE__)
+#include <crt_externs.h>
+#define GetEnviron() (*_NSGetEnviron())
+#elif !defined(_WIN32)
+extern char **environ;
+#define GetEnviron() environ
+#endif
+
 namespace vku {
 
 static std::string format(const char *message, ...) {
@@ -96,53 +119,246 @@ struct SettingsFileInfo {
     Source source;
 };
 
+// The location of the settings file, found once per process however many times the settings are loaded, by the first thread
+// querying a setting. Setting VK_LAYER_SETTINGS_DEBUG logs where it was found and how long it took.
+struct SettingsLocation {
+    std::string filename;
+    SettingsFileInfo info;
+};
+
+static const SettingsLocation &GetSettingsLocation();
+
+// The name of a setting, built on the stack with its hash so that looking a setting up allocates nothing
+struct SettingName {
+    static const std::size_t MAX_SIZE = 256;
+
+    SettingName() : size(0), hash(0) { text[0] = '\0'; }
+
+    char text[MAX_SIZE];
+    std::size_t size;
+    uint64_t hash;
+};
+
+enum Case {
+    CASE_KEEP,
+    CASE_LOWER,
+    CASE_UPPER,
+};
+
+// Append size characters of text to a setting name, returning false if they don't fit
+static bool Append(SettingName &name, const char *text, std::size_t size, Case text_case = CASE_KEEP) {
+    if (name.size + size >= SettingName::MAX_SIZE) return false;
+
+    for (std::size_t i = 0; i < size; ++i) {
+        char c = text[i];
+        if (text_case == CASE_LOWER) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        } else if (text_case == CASE_UPPER) {
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        name.text[name.size++] = c;
+    }
+    name.text[name.size] = '\0';
+    return true;
+}
+
+static bool Append(SettingName &name, const char *text, Case text_case = CASE_KEEP) {
+    return Append(name, text, std::strlen(text), text_case);
+}
+
+// 64-bit FNV-1a
+static uint64_t HashSettingName(const char *text, std::size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(text[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// The settings of a source, immutable once built and sorted by the hash of their names. The keys and values are all stored in a
+// single block of text, which for a settings file is the file itself, read in one go and parsed in place, so that large files,
+// like those of long lists of message filters, don't cost an allocation per setting. The entries refer to the text by offsets,
+// so tables can be copied.
+class SettingsTable {
+   public:
+    void Build(const std::map<std::string, std::string> &settings) {
+        text_.clear();
+        entries_.clear();
+        entries_.reserve(settings.size());
+        for (auto it = settings.begin(), end = settings.end(); it != end; ++it) {
+            Entry entry;
+            entry.key_offset = text_.size();
+            entry.key_size = it->first.size();
+            text_.insert(text_.end(), it->first.begin(), it->first.end());
+            text_.push_back('\0');
+            entry.value_offset = text_.size();
+            text_.insert(text_.end(), it->second.begin(), it->second.end());
+            text_.push_back('\0');
+            entries_.push_back(entry);
+        }
+        Sort();
+    }
+
+    // Build from the "key = value" lines of a settings file, where '#' starts a comment. The values are terminated in place.
+    void BuildFromFile(std::vector<char> &&text) {
+        text_ = std::move(text);
+        text_.push_back('\0');
+        entries_.clear();
+
+        char *const data = text_.data();
+        const std::size_t size = text_.size() - 1;
+        for (std::size_t line = 0, line_end; line < size; line = line_end + 1) {
+            line_end = line;
+            while (line_end < size && data[line_end] != '\n') ++line_end;
+
+            std::size_t content_end = line;
+            while (content_end < line_end && data[content_end] != '#') ++content_end;
+
+            std::size_t separator = line;
+            while (separator < content_end && data[separator] != '=') ++separator;
+            if (separator == content_end) continue;
+
+            Entry entry;
+            std::size_t key_end = separator;
+            entry.key_offset = Trim(data, line, key_end);
+            entry.key_size = key_end - entry.key_offset;
+
+            std::size_t value_end = content_end;
+            entry.value_offset = Trim(data, separator + 1, value_end);
+            data[value_end] = '\0';
+
+            entries_.push_back(entry);
+        }
+        Sort();
+    }
+
+    // The value of a setting, or nullptr if the source doesn't set it
+    const char *Find(const SettingName &name) const {
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), name.hash,
+                                   [](const Entry &entry, uint64_t hash) { return entry.hash < hash; });
+
+        // A setting set several times has the last value
+        const char *value = nullptr;
+        for (auto end = entries_.end(); it != end && it->hash == name.hash; ++it) {
+            if (it->key_size == name.size && std::memcmp(&text_[it->key_offset], name.text, name.size) == 0) {
+                value = &text_[it->value_offset];
+            }
+        }
+        return value;
+    }
+
+   private:
+    struct Entry {
+        uint64_t hash;
+        std::size_t key_offset;
+        std::size_t key_size;
+        std::size_t value_offset;
+    };
+
+    // Trim the whitespace around the text from begin to end, returning the new begin and updating end
+    static std::size_t Trim(const char *data, std::size_t begin, std::size_t &end) {
+        static const char *whitespace = " \t\f\v\n\r";
+
+        while (begin < end && std::strchr(whitespace, data[begin]) != nullptr) ++begin;
+        while (end > begin && std::strchr(whitespace, data[end - 1]) != nullptr) --end;
+        return begin;
+    }
+
+    void Sort() {
+        for (std::size_t i = 0, n = entries_.size(); i < n; ++i) {
+            entries_[i].hash = HashSettingName(&text_[entries_[i].key_offset], entries_[i].key_size);
+        }
+        std::stable_sort(entries_.begin(), entries_.end(), [](const Entry &a, const Entry &b) { return a.hash < b.hash; });
+    }
+
+    std::vector<char> text_;
+    std::vector<Entry> entries_;
+};
+
+// Waits for changes to a file, by watching its directory so that files replaced by renaming another one over them are seen
+class SettingsFileWatcher {
+   public:
+    SettingsFileWatcher();
+    ~SettingsFileWatcher();
+
+    bool Start(const std::string &filename);
+
+    // Wait for the file to change, returning false once the watcher is stopped
+    bool Wait();
+
+    // Make Wait() return false, from any thread
+    void Stop();
+
+   private:
+    std::string directory_;
+    std::string name_;
+#if defined(_WIN32)
+    HANDLE directory_handle_;
+    HANDLE changed_event_;
+    HANDLE stop_event_;
+#else
+    int watch_fd_;
+    int stop_pipe_[2];
+#if defined(VKU_USE_KQUEUE)
+    int directory_fd_;
+    int file_fd_;
+    void WatchFile();
+#endif
+#endif
+};
+
+// The settings of all the sources at one time
+struct SettingsSnapshot {
+    SettingsTable file_settings;
+    SettingsTable environment_settings;
+};
+
+// The settings of vk_layer_settings.txt and of the environment, read once when a setting is first queried. The file is the one
+// found from the registry or the XDG data directory set by Vulkan Configurator, VK_LAYER_SETTINGS_PATH or the working directory.
+// When the file is watched, it is read again into a new snapshot of the settings each time it changes, which replaces the
+// current one with an atomic store. The settings are then read without any lock, so the replaced snapshots are kept until the
+// layer is unloaded, as readers may still use them: the file only changes when a user edits it.
 class LayerSettings {
    public:
     LayerSettings();
-    ~LayerSettings(){};
+    ~LayerSettings() { StopWatching(); }
 
     void SetCallback(LAYER_SETTING_LOG_CALLBACK callback) { this->callback_ = callback; }
     void Log(const std::string &setting_key, const std::string &message);
 
-    bool Is(const std::string &setting_key);
-    const char *Get(const std::string &setting_key);
-    void Set(const std::string &setting_key, const std::string &setting_value);
+    const SettingsSnapshot *GetSnapshot();
+
+    bool Watch(LAYER_SETTINGS_CHANGED_CALLBACK callback, void *user_data);
+    void StopWatching();
 
-    std::string vk_layer_disables_env_var;
     SettingsFileInfo settings_info;
 
    private:
-    bool file_is_parsed_;
-    std::map<std::string, std::string> value_map_;
+    std::once_flag loaded_;
+    std::string settings_file_;
+    std::atomic<const SettingsSnapshot *> snapshot_;
+    std::mutex snapshots_mutex_;
+    std::vector<std::unique_ptr<SettingsSnapshot>> snapshots_;  // The current snapshot and all those it replaced
+
+    std::mutex watch_mutex_;
+    std::vector<std::pair<LAYER_SETTINGS_CHANGED_CALLBACK, void *>> changed_callbacks_;
+    std::unique_ptr<SettingsFileWatcher> watcher_;
+    std::thread watch_thread_;
 
     std::string last_log_setting;
     std::string last_log_message;
 
-    std::string FindSettings();
-    void ParseFile(const char *filename);
+    void Load();
+    void Reload();
+    void Publish(std::unique_ptr<SettingsSnapshot> snapshot);
+    void RunWatcher();
+    void ParseFile(const char *filename, SettingsTable &settings);
     LAYER_SETTING_LOG_CALLBACK callback_;
 };
 
 static LayerSettings vk_layer_settings;
 
-static bool IsEnvironment(const char *variable) {
-#if _WIN32
-    return GetEnvironmentVariable(variable, NULL, 0) != 0;
-#elif defined(__ANDROID__)
-    std::string command = "getprop " + std::string(variable);
-    FILE *pPipe = popen(command.c_str(), "r");
-    if (pPipe != nullptr) {
-        pclose(pPipe);
-
-        return true;
-    } else {
-        return false;
-    }
-#else
-    return std::getenv(variable) != NULL;
-#endif
-}
-
 static std::string GetEnvironment(const char *variable) {
 #if _WIN32
     int size = GetEnvironmentVariable(variable, NULL, 0);
@@ -185,38 +401,80 @@ static std::string string_tolower(const std::string &s) {
     return result;
 }
 
-static std::string string_toupper(const std::string &s) {
-    std::string result = s;
-    for (auto &c : result) {
-        c = std::toupper(c);
+// Read the environment variables that may hold settings, those starting with VK_, or on Android the system properties starting
+// with debug.vulkan.
+static void ReadEnvironment(std::map<std::string, std::string> &variables) {
+#if defined(_WIN32)
+    char *strings = GetEnvironmentStringsA();
+    if (strings == nullptr) return;
+
+    for (const char *entry = strings; *entry != '\0'; entry += std::strlen(entry) + 1) {
+        // Skip the first character, which is '=' for the hidden variables of the current directories
+        const char *separator = std::strchr(entry + 1, '=');
+        if (separator == nullptr) continue;
+
+        // The names of the variables ignore case
+        std::string name(entry, separator - entry);
+        for (auto &c : name) {
+            c = std::toupper(c);
+        }
+        if (name.compare(0, 3, "VK_") == 0) variables[name] = separator + 1;
     }
-    return result;
-}
 
-static std::string TrimPrefix(const std::string &layer_key) {
-    assert(layer_key.find("VK_LAYER_") == 0);
-    std::size_t prefix = std::strlen("VK_LAYER_");
-    return layer_key.substr(prefix, layer_key.size() - prefix);
+    FreeEnvironmentStringsA(strings);
+#elif defined(__ANDROID__)
+    FILE *pPipe = popen("getprop", "r");
+    if (pPipe == nullptr) return;
+
+    // Each property is listed as "[name]: [value]"
+    char line[1024];
+    while (fgets(line, sizeof(line), pPipe) != nullptr) {
+        const char *name_end = std::strstr(line, "]: [");
+        if (line[0] != '[' || name_end == nullptr) continue;
+
+        const std::string name(line + 1, name_end - line - 1);
+        if (name.compare(0, 13, "debug.vulkan.") != 0) continue;
+
+        const char *value = name_end + 4;
+        const char *value_end = std::strrchr(value, ']');
+        if (value_end != nullptr) variables[name] = std::string(value, value_end - value);
+    }
+
+    pclose(pPipe);
+#else
+    for (char **entry = GetEnviron(); *entry != nullptr; ++entry) {
+        if (std::strncmp(*entry, "VK_", 3) != 0) continue;
+
+        const char *separator = std::strchr(*entry, '=');
+        if (separator != nullptr) variables[std::string(*entry, separator - *entry)] = separator + 1;
+    }
+#endif
 }
 
-static std::string GetSettingKey(const char *layer_key, const char *setting_key) {
-    std::stringstream result;
-    result << string_tolower(TrimPrefix(layer_key)) << "." << setting_key;
-    return result.str();
+// The layer key without VK_LAYER_, the vendor and the name of the layer, like LUNARG_monitor
+static const char *TrimPrefix(const char *layer_key) {
+    static const char *prefix = "VK_LAYER_";
+
+    assert(std::strncmp(layer_key, prefix, std::strlen(prefix)) == 0);
+    return layer_key + std::strlen(prefix);
 }
 
-static inline std::string TrimVendor(const std::string &layer_key) {
-    static const char *separator = "_";
+// The layer key without VK_LAYER_ and the vendor, like monitor
+static const char *TrimVendor(const char *layer_key) {
+    const char *namespace_key = TrimPrefix(layer_key);
 
-    const std::string &namespace_key = TrimPrefix(layer_key);
+    const char *separator = std::strchr(namespace_key, '_');
+    if (separator == nullptr || separator[1] == '\0') return namespace_key;
 
-    const auto trimmed_beg = namespace_key.find_first_of(separator);
-    if (trimmed_beg == std::string::npos) return namespace_key;
+    return separator + 1;
+}
 
-    assert(namespace_key.find_last_not_of(separator) != std::string::npos &&
-           trimmed_beg <= namespace_key.find_last_not_of(separator));
+static bool GetSettingKey(SettingName &name, const char *layer_key, const char *setting_key) {
+    const bool fits = Append(name, TrimPrefix(layer_key), CASE_LOWER) && Append(name, ".") && Append(name, setting_key);
+    assert(fits);
 
-    return namespace_key.substr(trimmed_beg + 1, namespace_key.size());
+    name.hash = HashSettingName(name.text, name.size);
+    return fits;
 }
 
 enum TrimMode {
@@ -228,22 +486,24 @@ enum TrimMode {
     TRIM_LAST = TRIM_NAMESPACE,
 };
 
-static std::string GetEnvVarKey(const char *layer_key, const char *setting_key, TrimMode trim_mode) {
-    std::stringstream result;
+static bool GetEnvVarKey(SettingName &name, const char *layer_key, const char *setting_key, TrimMode trim_mode) {
+    bool fits = false;
 
 #if defined(__ANDROID__)
     switch (trim_mode) {
         default:
         case TRIM_NONE: {
-            result << "debug.vulkan." << GetSettingKey(layer_key, setting_key);
+            fits = Append(name, "debug.vulkan.") && Append(name, TrimPrefix(layer_key), CASE_LOWER) && Append(name, ".") &&
+                   Append(name, setting_key);
             break;
         }
         case TRIM_VENDOR: {
-            result << "debug.vulkan." << GetSettingKey(TrimVendor(layer_key).c_str(), setting_key);
+            fits = Append(name, "debug.vulkan.") && Append(name, TrimVendor(layer_key), CASE_LOWER) && Append(name, ".") &&
+                   Append(name, setting_key);
             break;
         }
         case TRIM_NAMESPACE: {
-            result << "debug.vulkan." << setting_key;
+            fits = Append(name, "debug.vulkan.") && Append(name, setting_key);
             break;
         }
     }
@@ -251,21 +511,26 @@ static std::string GetEnvVarKey(const char *layer_key, const char *setting_key,
     switch (trim_mode) {
         default:
         case TRIM_NONE: {
-            result << "VK_" << string_toupper(TrimPrefix(layer_key)) << "_" << string_toupper(setting_key);
+            fits = Append(name, "VK_") && Append(name, TrimPrefix(layer_key), CASE_UPPER) && Append(name, "_") &&
+                   Append(name, setting_key, CASE_UPPER);
             break;
         }
         case TRIM_VENDOR: {
-            result << "VK_" << string_toupper(TrimVendor(layer_key)) << "_" << string_toupper(setting_key);
+            fits = Append(name, "VK_") && Append(name, TrimVendor(layer_key), CASE_UPPER) && Append(name, "_") &&
+                   Append(name, setting_key, CASE_UPPER);
             break;
         }
         case TRIM_NAMESPACE: {
-            result << "VK_" << string_toupper(setting_key);
+            fits = Append(name, "VK_") && Append(name, setting_key, CASE_UPPER);
             break;
         }
     }
 
 #endif
-    return result.str();
+    assert(fits);
+
+    name.hash = HashSettingName(name.text, name.size);
+    return fits;
 }
 
 void InitLayerSettingsLogCallback(LAYER_SETTING_LOG_CALLBACK callback) {
@@ -273,36 +538,151 @@ void InitLayerSettingsLogCallback(LAYER_SETTING_LOG_CALLBACK callback) {
     return;
 }
 
-bool IsLayerSetting(const char *layer_key, const char *setting_key) {
-    assert(layer_key);
-    assert(!std::string(layer_key).empty());
-    assert(setting_key);
-    assert(!std::string(setting_key).empty());
+bool WatchLayerSettings(LAYER_SETTINGS_CHANGED_CALLBACK callback, void *user_data) {
+    assert(callback);
+
+    return vk_layer_settings.Watch(callback, user_data);
+}
+
+void StopWatchingLayerSettings() { vk_layer_settings.StopWatching(); }
 
+static bool IsLayerSetting(const SettingsSnapshot *snapshot, const char *layer_key, const char *setting_key) {
     for (int i = TRIM_FIRST, n = TRIM_LAST; i <= n; ++i) {
-        if (IsEnvironment(GetEnvVarKey(layer_key, setting_key, static_cast<TrimMode>(i)).c_str())) return true;
+        SettingName name;
+        if (!GetEnvVarKey(name, layer_key, setting_key, static_cast<TrimMode>(i))) continue;
+        if (snapshot->environment_settings.Find(name) != nullptr) return true;
     }
 
-    return vk_layer_settings.Is(GetSettingKey(layer_key, setting_key).c_str());
+    SettingName name;
+    return GetSettingKey(name, layer_key, setting_key) && snapshot->file_settings.Find(name) != nullptr;
 }
 
-static std::string GetLayerSettingData(const char *layer_key, const char *setting_key) {
+static const char *GetLayerSettingData(const SettingsSnapshot *snapshot, const char *layer_key, const char *setting_key) {
     // First search in the environment variables
     for (int i = TRIM_FIRST, n = TRIM_LAST; i <= n; ++i) {
-        std::string setting = GetEnvironment(GetEnvVarKey(layer_key, setting_key, static_cast<TrimMode>(i)).c_str());
-        if (!setting.empty()) return setting;
+        SettingName name;
+        if (!GetEnvVarKey(name, layer_key, setting_key, static_cast<TrimMode>(i))) continue;
+        const char *setting = snapshot->environment_settings.Find(name);
+        if (setting != nullptr && *setting != '\0') return setting;
     }
 
     // Second search in vk_layer_settings.txt
-    return vk_layer_settings.Get(GetSettingKey(layer_key, setting_key).c_str());
+    SettingName name;
+    if (!GetSettingKey(name, layer_key, setting_key)) return "";
+    const char *setting = snapshot->file_settings.Find(name);
+    return setting == nullptr ? "" : setting;
 }
 
-bool GetLayerSettingBool(const char *layer_key, const char *setting_key) {
-    assert(IsLayerSetting(layer_key, setting_key));
+static const char *GetLayerSettingData(const char *layer_key, const char *setting_key) {
+    return GetLayerSettingData(vk_layer_settings.GetSnapshot(), layer_key, setting_key);
+}
+
+bool IsLayerSetting(const char *layer_key, const char *setting_key) {
+    assert(layer_key);
+    assert(*layer_key != '\0');
+    assert(setting_key);
+    assert(*setting_key != '\0');
+
+    return IsLayerSetting(vk_layer_settings.GetSnapshot(), layer_key, setting_key);
+}
+
+#if !defined(VK_EXT_layer_settings)
+// VK_EXT_layer_settings is newer than the Vulkan headers vku may be built with, while the application creating the instance may
+// chain its structure anyway, so it is declared here as the extension defines it.
+enum VkLayerSettingTypeEXT {
+    VK_LAYER_SETTING_TYPE_BOOL32_EXT = 0,
+    VK_LAYER_SETTING_TYPE_INT32_EXT = 1,
+    VK_LAYER_SETTING_TYPE_INT64_EXT = 2,
+    VK_LAYER_SETTING_TYPE_UINT32_EXT = 3,
+    VK_LAYER_SETTING_TYPE_UINT64_EXT = 4,
+    VK_LAYER_SETTING_TYPE_FLOAT32_EXT = 5,
+    VK_LAYER_SETTING_TYPE_FLOAT64_EXT = 6,
+    VK_LAYER_SETTING_TYPE_STRING_EXT = 7,
+};
+
+struct VkLayerSettingEXT {
+    const char *pLayerName;
+    const char *pSettingName;
+    VkLayerSettingTypeEXT type;
+    uint32_t valueCount;
+    const void *pValues;
+};
+
+struct VkLayerSettingsCreateInfoEXT {
+    VkStructureType sType;
+    const void *pNext;
+    uint32_t settingCount;
+    const VkLayerSettingEXT *pSettings;
+};
 
+static const VkStructureType VK_STRUCTURE_TYPE_LAYER_SETTINGS_CREATE_INFO_EXT = static_cast<VkStructureType>(1000496000);
+#endif
+
+// The values of a setting of VkLayerSettingsCreateInfoEXT, written like in vk_layer_settings.txt so that they are parsed and
+// validated like the settings of the other sources
+static std::string FormatLayerSetting(const VkLayerSettingEXT &setting) {
+    std::string data;
+    for (uint32_t i = 0; i < setting.valueCount; ++i) {
+        if (i > 0) data += ",";
+        switch (setting.type) {
+            case VK_LAYER_SETTING_TYPE_BOOL32_EXT:
+                data += static_cast<const VkBool32 *>(setting.pValues)[i] ? "true" : "false";
+                break;
+            case VK_LAYER_SETTING_TYPE_INT32_EXT:
+                data += std::to_string(static_cast<const int32_t *>(setting.pValues)[i]);
+                break;
+            case VK_LAYER_SETTING_TYPE_INT64_EXT:
+                data += std::to_string(static_cast<const int64_t *>(setting.pValues)[i]);
+                break;
+            case VK_LAYER_SETTING_TYPE_UINT32_EXT:
+                data += std::to_string(static_cast<const uint32_t *>(setting.pValues)[i]);
+                break;
+            case VK_LAYER_SETTING_TYPE_UINT64_EXT:
+                data += std::to_string(static_cast<const uint64_t *>(setting.pValues)[i]);
+                break;
+            case VK_LAYER_SETTING_TYPE_FLOAT32_EXT:
+                data += format("%.9f", static_cast<const float *>(setting.pValues)[i]);
+                break;
+            case VK_LAYER_SETTING_TYPE_FLOAT64_EXT:
+                data += format("%.17f", static_cast<const double *>(setting.pValues)[i]);
+                break;
+            case VK_LAYER_SETTING_TYPE_STRING_EXT:
+                data += static_cast<const char *const *>(setting.pValues)[i];
+                break;
+            default:
+                vk_layer_settings.Log(setting.pSettingName, format("The setting type (%d) is unknown.", setting.type));
+                break;
+        }
+    }
+    return data;
+}
+
+// Search the pNext chain of VkInstanceCreateInfo for a setting of the layer, the last one given winning like a later line of
+// vk_layer_settings.txt does
+static bool GetCreateInfoSetting(const void *create_info_next, const char *layer_key, const char *setting_key, std::string &data) {
+    const VkLayerSettingEXT *found = nullptr;
+    for (const VkBaseInStructure *next = static_cast<const VkBaseInStructure *>(create_info_next); next != nullptr;
+         next = next->pNext) {
+        if (next->sType != VK_STRUCTURE_TYPE_LAYER_SETTINGS_CREATE_INFO_EXT) continue;
+
+        const VkLayerSettingsCreateInfoEXT *create_info = reinterpret_cast<const VkLayerSettingsCreateInfoEXT *>(next);
+        for (uint32_t i = 0; i < create_info->settingCount; ++i) {
+            const VkLayerSettingEXT &setting = create_info->pSettings[i];
+            if (setting.pLayerName == nullptr || setting.pSettingName == nullptr) continue;
+            if (std::strcmp(setting.pLayerName, layer_key) != 0 || std::strcmp(setting.pSettingName, setting_key) != 0) continue;
+            found = &setting;
+        }
+    }
+
+    if (found == nullptr) return false;
+    data = FormatLayerSetting(*found);
+    return true;
+}
+
+static bool ParseBool(const char *setting_key, const std::string &data) {
     bool result = false;  // default value
 
-    std::string setting = string_tolower(GetLayerSettingData(layer_key, setting_key));
+    std::string setting = string_tolower(data);
     if (setting.empty()) {
         vk_layer_settings.Log(setting_key,
                               "The setting is used but the value is empty which is invalid for a boolean setting type.");
@@ -318,12 +698,9 @@ bool GetLayerSettingBool(const char *layer_key, const char *setting_key) {
     return result;
 }
 
-int GetLayerSettingInt(const char *layer_key, const char *setting_key) {
-    assert(IsLayerSetting(layer_key, setting_key));
-
+static int ParseInt(const char *setting_key, const std::string &setting) {
     int result = 0;  // default value
 
-    std::string setting = GetLayerSettingData(layer_key, setting_key);
     if (setting.empty()) {
         std::string message = "The setting is used but the value is empty which is invalid for a integer setting type.";
         vk_layer_settings.Log(setting_key, message);
@@ -337,12 +714,9 @@ int GetLayerSettingInt(const char *layer_key, const char *setting_key) {
     return result;
 }
 
-double GetLayerSettingFloat(const char *layer_key, const char *setting_key) {
-    assert(IsLayerSetting(layer_key, setting_key));
-
+static double ParseFloat(const char *setting_key, const std::string &setting) {
     double result = 0.0;  // default value
 
-    std::string setting = GetLayerSettingData(layer_key, setting_key);
     if (setting.empty()) {
         std::string message = "The setting is used but the value is empty which is invalid for a floating-point setting type.";
         vk_layer_settings.Log(setting_key, message);
@@ -356,10 +730,7 @@ double GetLayerSettingFloat(const char *layer_key, const char *setting_key) {
     return result;
 }
 
-std::string GetLayerSettingString(const char *layer_key, const char *setting_key) {
-    assert(IsLayerSetting(layer_key, setting_key));
-
-    std::string setting = GetLayerSettingData(layer_key, setting_key);
+static std::string ParseString(const char *setting_key, const std::string &setting) {
     if (setting.empty()) {
         std::string message = "The setting is used but the value is empty which is invalid for a string setting type.";
         vk_layer_settings.Log(setting_key, message);
@@ -368,10 +739,7 @@ std::string GetLayerSettingString(const char *layer_key, const char *setting_key
     return setting;
 }
 
-std::string GetLayerSettingFrames(const char *layer_key, const char *setting_key) {
-    assert(IsLayerSetting(layer_key, setting_key));
-
-    std::string setting = GetLayerSettingData(layer_key, setting_key);
+static std::string ParseFrames(const char *setting_key, const std::string &setting) {
     if (!setting.empty() && !IsFrames(setting)) {
         std::string message = format("The data provided (%s) is not a frames value.", setting.c_str());
         vk_layer_settings.Log(setting_key, message);
@@ -401,10 +769,7 @@ static inline std::vector<std::string> Split(const std::string &value, const std
     return result;
 }
 
-Strings GetLayerSettingStrings(const char *layer_key, const char *setting_key) {
-    assert(IsLayerSetting(layer_key, setting_key));
-
-    std::string setting = GetLayerSettingData(layer_key, setting_key);
+static Strings ParseStrings(const std::string &setting) {
     if (setting.find_first_of(",") != std::string::npos) {
         return Split(setting, ",");
     } else {
@@ -417,10 +782,8 @@ Strings GetLayerSettingStrings(const char *layer_key, const char *setting_key) {
     }
 }
 
-List GetLayerSettingList(const char *layer_key, const char *setting_key) {
-    assert(IsLayerSetting(layer_key, setting_key));
-
-    std::vector<std::string> inputs = GetLayerSettingStrings(layer_key, setting_key);
+static List ParseList(const std::string &setting) {
+    std::vector<std::string> inputs = ParseStrings(setting);
 
     List result;
     for (std::size_t i = 0, n = inputs.size(); i < n; ++i) {
@@ -435,9 +798,158 @@ List GetLayerSettingList(const char *layer_key, const char *setting_key) {
     return result;
 }
 
+bool GetLayerSettingBool(const char *layer_key, const char *setting_key) {
+    assert(IsLayerSetting(layer_key, setting_key));
+
+    return ParseBool(setting_key, GetLayerSettingData(layer_key, setting_key));
+}
+
+int GetLayerSettingInt(const char *layer_key, const char *setting_key) {
+    assert(IsLayerSetting(layer_key, setting_key));
+
+    return ParseInt(setting_key, GetLayerSettingData(layer_key, setting_key));
+}
+
+double GetLayerSettingFloat(const char *layer_key, const char *setting_key) {
+    assert(IsLayerSetting(layer_key, setting_key));
+
+    return ParseFloat(setting_key, GetLayerSettingData(layer_key, setting_key));
+}
+
+std::string GetLayerSettingString(const char *layer_key, const char *setting_key) {
+    assert(IsLayerSetting(layer_key, setting_key));
+
+    return ParseString(setting_key, GetLayerSettingData(layer_key, setting_key));
+}
+
+std::string GetLayerSettingFrames(const char *layer_key, const char *setting_key) {
+    assert(IsLayerSetting(layer_key, setting_key));
+
+    return ParseFrames(setting_key, GetLayerSettingData(layer_key, setting_key));
+}
+
+Strings GetLayerSettingStrings(const char *layer_key, const char *setting_key) {
+    assert(IsLayerSetting(layer_key, setting_key));
+
+    return ParseStrings(GetLayerSettingData(layer_key, setting_key));
+}
+
+List GetLayerSettingList(const char *layer_key, const char *setting_key) {
+    assert(IsLayerSetting(layer_key, setting_key));
+
+    return ParseList(GetLayerSettingData(layer_key, setting_key));
+}
+
+// Read the bindings, from the settings chained to VkInstanceCreateInfo first, then from the snapshot of the environment and
+// vk_layer_settings.txt, which is only loaded when a setting is not chained. Writes whether each setting is set to is_set.
+static void GetLayerSettings(const char *layer_key, const void *create_info_next, const LayerSettingBinding *bindings,
+                             std::size_t binding_count, bool *is_set) {
+    assert(layer_key);
+    assert(bindings != nullptr || binding_count == 0);
+
+    // All the settings are read from the same snapshot, even if the settings file is reloaded meanwhile
+    const SettingsSnapshot *snapshot = nullptr;
+
+    for (std::size_t i = 0; i < binding_count; ++i) {
+        const LayerSettingBinding &binding = bindings[i];
+        assert(binding.setting_key);
+        assert(binding.value);
+
+        std::string setting;
+        is_set[i] = GetCreateInfoSetting(create_info_next, layer_key, binding.setting_key, setting);
+        if (!is_set[i]) {
+            if (snapshot == nullptr) snapshot = vk_layer_settings.GetSnapshot();
+            is_set[i] = IsLayerSetting(snapshot, layer_key, binding.setting_key);
+
+            // The default values are the layer's own, so they are not validated
+            if (!is_set[i] && binding.default_value == nullptr) continue;
+            setting = is_set[i] ? GetLayerSettingData(snapshot, layer_key, binding.setting_key) : binding.default_value;
+        }
+
+        switch (binding.type) {
+            case LAYER_SETTING_TYPE_BOOL:
+                *static_cast<bool *>(binding.value) = ParseBool(binding.setting_key, setting);
+                break;
+            case LAYER_SETTING_TYPE_INT:
+                *static_cast<int *>(binding.value) = ParseInt(binding.setting_key, setting);
+                break;
+            case LAYER_SETTING_TYPE_FLOAT:
+                *static_cast<double *>(binding.value) = ParseFloat(binding.setting_key, setting);
+                break;
+            case LAYER_SETTING_TYPE_FRAMES:
+                *static_cast<std::string *>(binding.value) = is_set[i] ? ParseFrames(binding.setting_key, setting) : setting;
+                break;
+            case LAYER_SETTING_TYPE_STRING:
+                *static_cast<std::string *>(binding.value) = is_set[i] ? ParseString(binding.setting_key, setting) : setting;
+                break;
+            case LAYER_SETTING_TYPE_STRINGS:
+                *static_cast<Strings *>(binding.value) = ParseStrings(setting);
+                break;
+            case LAYER_SETTING_TYPE_LIST:
+                *static_cast<List *>(binding.value) = ParseList(setting);
+                break;
+        }
+    }
+}
+
+void GetLayerSettings(const char *layer_key, const LayerSettingBinding *bindings, std::size_t binding_count) {
+    GetLayerSettings(layer_key, nullptr, bindings, binding_count);
+}
+
+void GetLayerSettings(const char *layer_key, const void *create_info_next, const LayerSettingBinding *bindings,
+                      std::size_t binding_count) {
+    std::unique_ptr<bool[]> is_set(new bool[binding_count]);
+    GetLayerSettings(layer_key, create_info_next, bindings, binding_count, is_set.get());
+}
+
+LayerSettingRegistry::LayerSettingRegistry(const char *layer_key, const LayerSettingDeclaration *declarations,
+                                           std::size_t declaration_count, const void *create_info_next)
+    : values_(declaration_count) {
+    std::vector<LayerSettingBinding> bindings(declaration_count);
+
+    for (std::size_t i = 0; i < declaration_count; ++i) {
+        Value &value = values_[i];
+        value.type = declarations[i].type;
+        value.is_set = false;
+        value.bool_value = false;
+        value.int_value = 0;
+        value.float_value = 0.0;
+
+        LayerSettingBinding &binding = bindings[i];
+        binding.setting_key = declarations[i].setting_key;
+        binding.type = declarations[i].type;
+        binding.default_value = nullptr;
+        switch (value.type) {
+            case LAYER_SETTING_TYPE_BOOL:
+                binding.value = &value.bool_value;
+                break;
+            case LAYER_SETTING_TYPE_INT:
+                binding.value = &value.int_value;
+                break;
+            case LAYER_SETTING_TYPE_FLOAT:
+                binding.value = &value.float_value;
+                break;
+            case LAYER_SETTING_TYPE_FRAMES:
+            case LAYER_SETTING_TYPE_STRING:
+                binding.value = &value.string_value;
+                break;
+            case LAYER_SETTING_TYPE_STRINGS:
+                binding.value = &value.strings_value;
+                break;
+            case LAYER_SETTING_TYPE_LIST:
+                binding.value = &value.list_value;
+                break;
+        }
+    }
+
+    std::unique_ptr<bool[]> is_set(new bool[declaration_count]);
+    GetLayerSettings(layer_key, create_info_next, bindings.data(), bindings.size(), is_set.get());
+    for (std::size_t i = 0; i < declaration_count; ++i) values_[i].is_set = is_set[i];
+}
+
 // Constructor for ConfigFile. Initialize layers to log error messages to stdout by default. If a vk_layer_settings file is present,
 // its settings will override the defaults.
-LayerSettings::LayerSettings() : file_is_parsed_(false), callback_(nullptr) {}
+LayerSettings::LayerSettings() : snapshot_(nullptr), callback_(nullptr) {}
 
 void LayerSettings::Log(const std::string &setting_key, const std::string &message) {
     this->last_log_setting = setting_key;
@@ -450,39 +962,316 @@ void LayerSettings::Log(const std::string &setting_key, const std::string &messa
     }
 }
 
-bool LayerSettings::Is(const std::string &setting_key) {
-    std::map<std::string, std::string>::const_iterator it;
-    if (!file_is_parsed_) {
-        std::string settings_file = FindSettings();
-        ParseFile(settings_file.c_str());
+const SettingsSnapshot *LayerSettings::GetSnapshot() {
+    std::call_once(loaded_, &LayerSettings::Load, this);
+
+    return snapshot_.load(std::memory_order_acquire);
+}
+
+void LayerSettings::Load() {
+    std::unique_ptr<SettingsSnapshot> snapshot(new SettingsSnapshot);
+    std::map<std::string, std::string> settings;
+
+    const SettingsLocation &location = GetSettingsLocation();
+    settings_info = location.info;
+    settings_file_ = location.filename;
+    ParseFile(settings_file_.c_str(), snapshot->file_settings);
+
+    ReadEnvironment(settings);
+    snapshot->environment_settings.Build(settings);
+
+    Publish(std::move(snapshot));
+}
+
+// Read the settings file again, keeping the environment variables, which can't change from outside the process
+void LayerSettings::Reload() {
+    std::unique_ptr<SettingsSnapshot> snapshot(new SettingsSnapshot);
+
+    ParseFile(settings_file_.c_str(), snapshot->file_settings);
+    snapshot->environment_settings = snapshot_.load(std::memory_order_acquire)->environment_settings;
+
+    Publish(std::move(snapshot));
+}
+
+void LayerSettings::Publish(std::unique_ptr<SettingsSnapshot> snapshot) {
+    std::lock_guard<std::mutex> lock(snapshots_mutex_);
+
+    snapshot_.store(snapshot.get(), std::memory_order_release);
+    snapshots_.push_back(std::move(snapshot));
+}
+
+bool LayerSettings::Watch(LAYER_SETTINGS_CHANGED_CALLBACK callback, void *user_data) {
+    std::call_once(loaded_, &LayerSettings::Load, this);
+
+    std::lock_guard<std::mutex> lock(watch_mutex_);
+
+    if (!watcher_) {
+        std::unique_ptr<SettingsFileWatcher> watcher(new SettingsFileWatcher);
+        if (!watcher->Start(settings_file_)) {
+            Log("", format("Failed to watch the settings file %s for changes.", settings_file_.c_str()));
+            return false;
+        }
+
+        watcher_ = std::move(watcher);
+        watch_thread_ = std::thread(&LayerSettings::RunWatcher, this);
     }
 
-    return value_map_.find(setting_key) != value_map_.end();
+    changed_callbacks_.push_back(std::make_pair(callback, user_data));
+    return true;
+}
+
+void LayerSettings::StopWatching() {
+    std::unique_lock<std::mutex> lock(watch_mutex_);
+    if (!watcher_) return;
+
+    watcher_->Stop();
+    changed_callbacks_.clear();
+
+    // The thread may be calling the callbacks, which may query settings but not watch them
+    lock.unlock();
+    watch_thread_.join();
+    lock.lock();
+
+    watcher_.reset();
 }
 
-const char *LayerSettings::Get(const std::string &setting_key) {
-    std::map<std::string, std::string>::const_iterator it;
-    if (!file_is_parsed_) {
-        std::string settings_file = FindSettings();
-        ParseFile(settings_file.c_str());
+void LayerSettings::RunWatcher() {
+    SettingsFileWatcher *watcher = watcher_.get();
+
+    while (watcher->Wait()) {
+        Reload();
+
+        std::vector<std::pair<LAYER_SETTINGS_CHANGED_CALLBACK, void *>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(watch_mutex_);
+            callbacks = changed_callbacks_;
+        }
+
+        for (std::size_t i = 0, n = callbacks.size(); i < n; ++i) {
+            callbacks[i].first(callbacks[i].second);
+        }
     }
+}
 
-    if ((it = value_map_.find(setting_key)) == value_map_.end()) {
-        return "";
+static void SplitPath(const std::string &filename, std::string &directory, std::string &name) {
+#if defined(_WIN32)
+    const std::size_t separator = filename.find_last_of("/\\");
+#else
+    const std::size_t separator = filename.find_last_of('/');
+#endif
+    if (separator == std::string::npos) {
+        directory = ".";
+        name = filename;
     } else {
-        return it->second.c_str();
+        directory = separator == 0 ? filename.substr(0, 1) : filename.substr(0, separator);
+        name = filename.substr(separator + 1);
     }
 }
 
-void LayerSettings::Set(const std::string &setting_key, const std::string &value) {
-    if (!file_is_parsed_) {
-        std::string settings_file = FindSettings();
-        ParseFile(settings_file.c_str());
+#if defined(_WIN32)
+
+SettingsFileWatcher::SettingsFileWatcher()
+    : directory_handle_(INVALID_HANDLE_VALUE), changed_event_(nullptr), stop_event_(nullptr) {}
+
+SettingsFileWatcher::~SettingsFileWatcher() {
+    if (directory_handle_ != INVALID_HANDLE_VALUE) CloseHandle(directory_handle_);
+    if (changed_event_ != nullptr) CloseHandle(changed_event_);
+    if (stop_event_ != nullptr) CloseHandle(stop_event_);
+}
+
+bool SettingsFileWatcher::Start(const std::string &filename) {
+    SplitPath(filename, directory_, name_);
+
+    directory_handle_ = CreateFileA(directory_.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                    nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    changed_event_ = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    stop_event_ = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+    return directory_handle_ != INVALID_HANDLE_VALUE && changed_event_ != nullptr && stop_event_ != nullptr;
+}
+
+bool SettingsFileWatcher::Wait() {
+    DWORD buffer[1024];
+
+    for (;;) {
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = changed_event_;
+        if (!ReadDirectoryChangesW(directory_handle_, buffer, sizeof(buffer), FALSE,
+                                   FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE, nullptr, &overlapped, nullptr)) {
+            return false;
+        }
+
+        const HANDLE events[] = {changed_event_, stop_event_};
+        DWORD bytes = 0;
+        if (WaitForMultipleObjects(2, events, FALSE, INFINITE) != WAIT_OBJECT_0) {
+            CancelIo(directory_handle_);
+            GetOverlappedResult(directory_handle_, &overlapped, &bytes, TRUE);
+            return false;
+        }
+        if (!GetOverlappedResult(directory_handle_, &overlapped, &bytes, FALSE)) return false;
+
+        // No bytes means that there were too many changes to list
+        if (bytes == 0) return true;
+
+        const uint8_t *entry = reinterpret_cast<const uint8_t *>(buffer);
+        for (;;) {
+            const FILE_NOTIFY_INFORMATION *information = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(entry);
+
+            char name[MAX_PATH];
+            const int size = WideCharToMultiByte(CP_ACP, 0, information->FileName,
+                                                 static_cast<int>(information->FileNameLength / sizeof(WCHAR)), name,
+                                                 sizeof(name) - 1, nullptr, nullptr);
+            name[size] = '\0';
+            if (_stricmp(name, name_.c_str()) == 0) return true;
+
+            if (information->NextEntryOffset == 0) break;
+            entry += information->NextEntryOffset;
+        }
+    }
+}
+
+void SettingsFileWatcher::Stop() { SetEvent(stop_event_); }
+
+#else
+
+SettingsFileWatcher::SettingsFileWatcher()
+    : watch_fd_(-1)
+#if defined(VKU_USE_KQUEUE)
+      ,
+      directory_fd_(-1),
+      file_fd_(-1)
+#endif
+{
+    stop_pipe_[0] = -1;
+    stop_pipe_[1] = -1;
+}
+
+SettingsFileWatcher::~SettingsFileWatcher() {
+    if (watch_fd_ != -1) close(watch_fd_);
+    if (stop_pipe_[0] != -1) close(stop_pipe_[0]);
+    if (stop_pipe_[1] != -1) close(stop_pipe_[1]);
+#if defined(VKU_USE_KQUEUE)
+    if (directory_fd_ != -1) close(directory_fd_);
+    if (file_fd_ != -1) close(file_fd_);
+#endif
+}
+
+#if defined(__linux__)
+
+bool SettingsFileWatcher::Start(const std::string &filename) {
+    SplitPath(filename, directory_, name_);
+
+    if (pipe(stop_pipe_) != 0) return false;
+
+    watch_fd_ = inotify_init1(IN_CLOEXEC);
+    if (watch_fd_ == -1) return false;
+
+    // Files are written in place, moved over the settings file or deleted
+    return inotify_add_watch(watch_fd_, directory_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE) != -1;
+}
+
+bool SettingsFileWatcher::Wait() {
+    alignas(struct inotify_event) char buffer[4096];
+
+    for (;;) {
+        struct pollfd fds[] = {{watch_fd_, POLLIN, 0}, {stop_pipe_[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (fds[1].revents != 0) return false;
+
+        const ssize_t size = read(watch_fd_, buffer, sizeof(buffer));
+        if (size <= 0) {
+            if (size < 0 && errno == EINTR) continue;
+            return false;
+        }
+
+        bool changed = false;
+        for (ssize_t offset = 0; offset < size;) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+            if (event->len > 0 && name_ == event->name) changed = true;
+            offset += sizeof(struct inotify_event) + event->len;
+        }
+        if (changed) return true;
     }
+}
+
+#elif defined(VKU_USE_KQUEUE)
+
+// Watch the settings file itself, which must be opened again each time it is replaced
+void SettingsFileWatcher::WatchFile() {
+    if (file_fd_ != -1) close(file_fd_);
+
+    const std::string filename = directory_ + "/" + name_;
+    file_fd_ = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file_fd_ == -1) return;
+
+    struct kevent change;
+    EV_SET(&change, file_fd_, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE | NOTE_EXTEND | NOTE_DELETE | NOTE_RENAME, 0, nullptr);
+    kevent(watch_fd_, &change, 1, nullptr, 0, nullptr);
+}
+
+bool SettingsFileWatcher::Start(const std::string &filename) {
+    SplitPath(filename, directory_, name_);
 
-    value_map_[setting_key] = value;
+    if (pipe(stop_pipe_) != 0) return false;
+
+    watch_fd_ = kqueue();
+    if (watch_fd_ == -1) return false;
+
+    // The directory is written when files are created, moved or deleted in it
+    directory_fd_ = open(directory_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (directory_fd_ == -1) return false;
+
+    struct kevent changes[2];
+    EV_SET(&changes[0], directory_fd_, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE, 0, nullptr);
+    EV_SET(&changes[1], stop_pipe_[0], EVFILT_READ, EV_ADD, 0, 0, nullptr);
+    if (kevent(watch_fd_, changes, 2, nullptr, 0, nullptr) == -1) return false;
+
+    WatchFile();
+    return true;
 }
 
+bool SettingsFileWatcher::Wait() {
+    for (;;) {
+        struct kevent event;
+        const int count = kevent(watch_fd_, nullptr, 0, &event, 1, nullptr);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (count == 0) continue;
+        if (event.filter == EVFILT_READ) return false;
+
+        // A change of the directory may be another file, so only a new settings file counts
+        if (static_cast<int>(event.ident) == directory_fd_) {
+            const int previous_fd = file_fd_;
+            struct stat previous_info;
+            const bool had_file = previous_fd != -1 && fstat(previous_fd, &previous_info) == 0;
+            WatchFile();
+
+            struct stat info;
+            const bool has_file = file_fd_ != -1 && fstat(file_fd_, &info) == 0;
+            if (had_file != has_file || (has_file && previous_info.st_ino != info.st_ino)) return true;
+            continue;
+        }
+
+        if (event.fflags & (NOTE_DELETE | NOTE_RENAME)) WatchFile();
+        return true;
+    }
+}
+
+#endif
+
+void SettingsFileWatcher::Stop() {
+    const char stop = 0;
+    while (write(stop_pipe_[1], &stop, 1) < 0 && errno == EINTR) {
+    }
+}
+
+#endif
+
 #if defined(WIN32)
 // Check for admin rights
 static inline bool IsHighIntegrity() {
@@ -508,7 +1297,7 @@ static inline bool IsHighIntegrity() {
 }
 #endif
 
-std::string LayerSettings::FindSettings() {
+static std::string FindSettings(SettingsFileInfo &settings_info) {
     struct stat info;
 
 #if defined(WIN32)
@@ -593,38 +1382,60 @@ std::string LayerSettings::FindSettings() {
     return "vk_layer_settings.txt";
 }
 
-static inline std::string TrimWhitespace(const std::string &s) {
-    const char *whitespace = " \t\f\v\n\r";
+static const char *GetSourceName(Source source) {
+    switch (source) {
+        case SOURCE_VKCONFIG:
+            return "Vulkan Configurator";
+        case SOURCE_ENV_VAR:
+            return "VK_LAYER_SETTINGS_PATH";
+        default:
+        case SOURCE_LOCAL:
+            return "working directory";
+    }
+}
+
+static const SettingsLocation &GetSettingsLocation() {
+    static const SettingsLocation location = [] {
+        const auto start = std::chrono::steady_clock::now();
 
-    const auto trimmed_beg = s.find_first_not_of(whitespace);
-    if (trimmed_beg == std::string::npos) return "";
+        SettingsLocation result;
+        result.filename = FindSettings(result.info);
 
-    const auto trimmed_end = s.find_last_not_of(whitespace);
-    assert(trimmed_end != std::string::npos && trimmed_beg <= trimmed_end);
+        const std::string debug = GetEnvironment("VK_LAYER_SETTINGS_DEBUG");
+        if (!debug.empty() && debug != "0") {
+            const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            fprintf(stderr, "LAYER SETTINGS: Found %s from the %s in %.3f ms\n", result.filename.c_str(),
+                    GetSourceName(result.info.source), milliseconds);
+        }
 
-    return s.substr(trimmed_beg, trimmed_end - trimmed_beg + 1);
+        return result;
+    }();
+
+    return location;
 }
 
-void LayerSettings::ParseFile(const char *filename) {
-    file_is_parsed_ = true;
+void LayerSettings::ParseFile(const char *filename, SettingsTable &settings) {
+    std::vector<char> text;
 
-    // Extract option = value pairs from a file
-    std::ifstream file(filename);
-    if (file.good()) {
+    FILE *file = fopen(filename, "rb");
+    if (file != nullptr) {
         settings_info.file_found = true;
-        for (std::string line; std::getline(file, line);) {
-            // discard comments, which start with '#'
-            const auto comments_pos = line.find_first_of('#');
-            if (comments_pos != std::string::npos) line.erase(comments_pos);
-
-            const auto value_pos = line.find_first_of('=');
-            if (value_pos != std::string::npos) {
-                const std::string setting_key = TrimWhitespace(line.substr(0, value_pos));
-                const std::string setting_value = TrimWhitespace(line.substr(value_pos + 1));
-                value_map_[setting_key] = setting_value;
-            }
+
+        // Read the whole file at once when its size is known
+        if (fseek(file, 0, SEEK_END) == 0) {
+            const long size = ftell(file);
+            if (size > 0) text.reserve(static_cast<std::size_t>(size) + 1);
+            fseek(file, 0, SEEK_SET);
+        }
+
+        char buffer[65536];
+        for (std::size_t size; (size = fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+            text.insert(text.end(), buffer, buffer + size);
         }
+        fclose(file);
     }
+
+    settings.BuildFromFile(std::move(text));
 }
 
 }  // namespace vku
@@ -21,6 +21,8 @@
 
 #pragma once
 
+#include <cassert>
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -32,12 +34,22 @@ namespace vku {
 typedef std::vector<std::string> Strings;
 typedef std::vector<std::pair<std::string, int>> List;
 typedef void *(*LAYER_SETTING_LOG_CALLBACK)(const char *setting_key, const char *message);
+typedef void (*LAYER_SETTINGS_CHANGED_CALLBACK)(void *user_data);
 
 // Initialize the callback function to get error messages. By default the error messages are outputed to stderr. Use nullptr to
 // return to the default behavior.
 void InitLayerSettingsLogCallback(LAYER_SETTING_LOG_CALLBACK callback);
 
-// Check whether a setting was set either from vk_layer_settings.txt or an environment variable
+// Watch vk_layer_settings.txt, for example for Vulkan Configurator to change the settings of a running application. The file is
+// read again each time it changes, then the callback is called, from a thread of the watcher, for the layer to query again the
+// settings it uses. Querying settings costs the same whether they are watched or not. Returns false if the file can't be watched.
+bool WatchLayerSettings(LAYER_SETTINGS_CHANGED_CALLBACK callback, void *user_data);
+
+// Stop watching vk_layer_settings.txt, which a layer watching it must do before it is unloaded.
+void StopWatchingLayerSettings();
+
+// Check whether a setting was set either from vk_layer_settings.txt or an environment variable. Both are read once, when the first
+// setting is queried, so later changes to them are not seen unless the file is watched.
 bool IsLayerSetting(const char *layer_key, const char *setting_key);
 
 // Query setting data for BOOL setting type in the layer manifest
@@ -60,4 +72,78 @@ Strings GetLayerSettingStrings(const char *layer_key, const char *setting_key);
 
 // Query setting data for LIST setting type in the layer manifest
 List GetLayerSettingList(const char *layer_key, const char *setting_key);
+
+enum LayerSettingType {
+    LAYER_SETTING_TYPE_BOOL,
+    LAYER_SETTING_TYPE_INT,
+    LAYER_SETTING_TYPE_FLOAT,
+    LAYER_SETTING_TYPE_FRAMES,
+    LAYER_SETTING_TYPE_STRING,
+    LAYER_SETTING_TYPE_STRINGS,
+    LAYER_SETTING_TYPE_LIST,
+};
+
+struct LayerSettingDeclaration {
+    const char *setting_key;
+    LayerSettingType type;
+};
+
+struct LayerSettingBinding {
+    const char *setting_key;
+    LayerSettingType type;
+    const char *default_value;  // Written like in vk_layer_settings.txt, or nullptr to leave the value unchanged when not set
+    void *value;                // A bool, int, double, std::string, Strings or List, following the type
+};
+
+// Query a table of settings in one pass over the settings, writing each to its value, or its default value when it is not set
+void GetLayerSettings(const char *layer_key, const LayerSettingBinding *bindings, std::size_t binding_count);
+
+// Query a table of settings like above, where the settings of the layer given with VkLayerSettingsCreateInfoEXT in the pNext
+// chain of VkInstanceCreateInfo take precedence over the environment and vk_layer_settings.txt. When the chain sets every
+// setting of the table, vk_layer_settings.txt is neither searched for nor read, so each instance may set its own settings.
+void GetLayerSettings(const char *layer_key, const void *create_info_next, const LayerSettingBinding *bindings,
+                      std::size_t binding_count);
+
+// The settings of a layer, declared once with their types, then parsed and validated together when the registry is created. The
+// settings are read by their index in the declarations, with no string processing and no copy. A setting that is not set has
+// the default value of its type: false, 0, 0.0 or empty. The settings chained to VkInstanceCreateInfo with
+// VkLayerSettingsCreateInfoEXT, if its pNext is given, take precedence over the other sources.
+class LayerSettingRegistry {
+   public:
+    LayerSettingRegistry(const char *layer_key, const LayerSettingDeclaration *declarations, std::size_t declaration_count,
+                         const void *create_info_next = nullptr);
+
+    std::size_t Size() const { return values_.size(); }
+
+    bool IsSet(std::size_t index) const { return values_[index].is_set; }
+
+    bool GetBool(std::size_t index) const { return Get(index, LAYER_SETTING_TYPE_BOOL).bool_value; }
+    int GetInt(std::size_t index) const { return Get(index, LAYER_SETTING_TYPE_INT).int_value; }
+    double GetFloat(std::size_t index) const { return Get(index, LAYER_SETTING_TYPE_FLOAT).float_value; }
+    const std::string &GetFrames(std::size_t index) const { return Get(index, LAYER_SETTING_TYPE_FRAMES).string_value; }
+    const std::string &GetString(std::size_t index) const { return Get(index, LAYER_SETTING_TYPE_STRING).string_value; }
+    const Strings &GetStrings(std::size_t index) const { return Get(index, LAYER_SETTING_TYPE_STRINGS).strings_value; }
+    const List &GetList(std::size_t index) const { return Get(index, LAYER_SETTING_TYPE_LIST).list_value; }
+
+   private:
+    struct Value {
+        LayerSettingType type;
+        bool is_set;
+        bool bool_value;
+        int int_value;
+        double float_value;
+        std::string string_value;
+        Strings strings_value;
+        List list_value;
+    };
+
+    const Value &Get(std::size_t index, LayerSettingType type) const {
+        assert(index < values_.size());
+        assert(values_[index].type == type);
+        (void)type;
+        return values_[index];
+    }
+
+    std::vector<Value> values_;
+};
 }  // namespace vku
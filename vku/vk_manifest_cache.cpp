@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#include "vk_manifest_cache.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace vku {
+
+static const char *CACHE_HEADER = "vulkan_manifest_cache";
+static const int CACHE_VERSION = 1;
+
+// The fields are separated by tabs, so the tabs, line breaks and backslashes of the strings are escaped
+static std::string Escape(const std::string &text) {
+    std::string result;
+    result.reserve(text.size());
+
+    for (std::size_t i = 0, n = text.size(); i < n; ++i) {
+        switch (text[i]) {
+            case '\\':
+                result += "\\\\";
+                break;
+            case '\t':
+                result += "\\t";
+                break;
+            case '\n':
+                result += "\\n";
+                break;
+            case '\r':
+                result += "\\r";
+                break;
+            default:
+                result += text[i];
+                break;
+        }
+    }
+
+    return result;
+}
+
+static std::string Unescape(const std::string &text) {
+    std::string result;
+    result.reserve(text.size());
+
+    for (std::size_t i = 0, n = text.size(); i < n; ++i) {
+        if (text[i] != '\\' || i + 1 == n) {
+            result += text[i];
+            continue;
+        }
+
+        switch (text[++i]) {
+            case 't':
+                result += '\t';
+                break;
+            case 'n':
+                result += '\n';
+                break;
+            case 'r':
+                result += '\r';
+                break;
+            default:
+                result += text[i];
+                break;
+        }
+    }
+
+    return result;
+}
+
+static std::vector<std::string> SplitFields(const std::string &line) {
+    std::vector<std::string> fields;
+
+    std::size_t begin = 0;
+    for (;;) {
+        const std::size_t end = line.find('\t', begin);
+        fields.push_back(line.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+        if (end == std::string::npos) break;
+        begin = end + 1;
+    }
+
+    return fields;
+}
+
+static bool ParseInt(const std::string &text, int64_t &value) {
+    if (text.empty()) return false;
+
+    char *end = nullptr;
+    value = std::strtoll(text.c_str(), &end, 10);
+    return *end == '\0';
+}
+
+ManifestCache::ManifestCache() : changed(false) {}
+
+bool ManifestCache::Load(const std::string &cache_path) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    entries.clear();
+    changed = false;
+
+    std::ifstream file(cache_path.c_str());
+    if (!file) return false;
+
+    std::string line;
+    if (!std::getline(file, line)) return false;
+
+    const std::vector<std::string> &header = SplitFields(line);
+    int64_t version = 0;
+    if (header.size() != 2 || header[0] != CACHE_HEADER || !ParseInt(header[1], version) || version != CACHE_VERSION) return false;
+
+    // path, size, modified, type, status, name, library path, API version
+    while (std::getline(file, line)) {
+        const std::vector<std::string> &fields = SplitFields(line);
+        if (fields.size() != 8) continue;
+
+        Entry entry;
+        int64_t type = 0;
+        int64_t status = 0;
+        if (!ParseInt(fields[1], entry.size) || !ParseInt(fields[2], entry.modified)) continue;
+        if (!ParseInt(fields[3], type) || type < MANIFEST_TYPE_EXPLICIT_LAYER || type > MANIFEST_TYPE_DRIVER) continue;
+        if (!ParseInt(fields[4], status) || status < MANIFEST_STATUS_VALID || status > MANIFEST_STATUS_INVALID) continue;
+
+        entry.summary.type = static_cast<ManifestType>(type);
+        entry.summary.status = static_cast<ManifestStatus>(status);
+        entry.summary.name = Unescape(fields[5]);
+        entry.summary.library_path = Unescape(fields[6]);
+        entry.summary.api_version = Unescape(fields[7]);
+        entries[Unescape(fields[0])] = entry;
+    }
+
+    return true;
+}
+
+bool ManifestCache::Save(const std::string &cache_path) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto it = entries.begin(); it != entries.end();) {
+        int64_t size = 0;
+        int64_t modified = 0;
+        if (GetManifestStamp(it->first, size, modified)) {
+            ++it;
+        } else {
+            it = entries.erase(it);
+            changed = true;
+        }
+    }
+
+    if (!changed) return true;
+
+    std::ostringstream stream;
+    stream << CACHE_HEADER << '\t' << CACHE_VERSION << '\n';
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        const ManifestSummary &summary = it->second.summary;
+        stream << Escape(it->first) << '\t' << it->second.size << '\t' << it->second.modified << '\t' << summary.type << '\t'
+               << summary.status << '\t' << Escape(summary.name) << '\t' << Escape(summary.library_path) << '\t'
+               << Escape(summary.api_version) << '\n';
+    }
+
+    std::ofstream file(cache_path.c_str(), std::ios::out | std::ios::trunc);
+    if (!file) return false;
+
+    file << stream.str();
+    if (!file) return false;
+
+    changed = false;
+    return true;
+}
+
+bool ManifestCache::Find(const std::string &manifest_path, ManifestSummary &summary) {
+    int64_t size = 0;
+    int64_t modified = 0;
+    if (!GetManifestStamp(manifest_path, size, modified)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = entries.find(manifest_path);
+    if (it == entries.end()) return false;
+
+    // The manifest changed since it was recorded
+    if (it->second.size != size || it->second.modified != modified) return false;
+
+    summary = it->second.summary;
+    return true;
+}
+
+void ManifestCache::Record(const std::string &manifest_path, const ManifestSummary &summary) {
+    Entry entry;
+    if (!GetManifestStamp(manifest_path, entry.size, entry.modified)) return;
+    entry.summary = summary;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = entries.find(manifest_path);
+    if (it != entries.end() && it->second.size == entry.size && it->second.modified == entry.modified &&
+        it->second.summary.type == summary.type && it->second.summary.status == summary.status &&
+        it->second.summary.name == summary.name && it->second.summary.library_path == summary.library_path &&
+        it->second.summary.api_version == summary.api_version) {
+        return;
+    }
+
+    entries[manifest_path] = entry;
+    changed = true;
+}
+
+std::size_t ManifestCache::Size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return entries.size();
+}
+
+std::string GetManifestCachePath() {
+#if defined(_WIN32)
+    const char *home = std::getenv("LOCALAPPDATA");
+    if (home == nullptr) return "";
+    return std::string(home) + "\\vulkan_manifest_cache.txt";
+#else
+    const char *home = std::getenv("HOME");
+    if (home == nullptr) return "";
+    return std::string(home) + "/.vulkan_manifest_cache.txt";
+#endif
+}
+
+bool GetManifestStamp(const std::string &manifest_path, int64_t &size, int64_t &modified) {
+#if defined(_WIN32)
+    struct _stat64 info;
+    if (_stat64(manifest_path.c_str(), &info) != 0) return false;
+#else
+    struct stat info;
+    if (stat(manifest_path.c_str(), &info) != 0) return false;
+#endif
+    if ((info.st_mode & S_IFMT) != S_IFREG) return false;
+
+    size = static_cast<int64_t>(info.st_size);
+    modified = static_cast<int64_t>(info.st_mtime);
+    return true;
+}
+
+}  // namespace vku
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2020-2022 Valve Corporation
+ * Copyright (c) 2020-2022 LunarG, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Authors:
+ * - Christophe Riccio <christophe@lunarg.com>
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace vku {
+
+enum ManifestType { MANIFEST_TYPE_EXPLICIT_LAYER = 0, MANIFEST_TYPE_IMPLICIT_LAYER, MANIFEST_TYPE_DRIVER };
+
+enum ManifestStatus { MANIFEST_STATUS_VALID = 0, MANIFEST_STATUS_INVALID };
+
+// What Vulkan Configurator and VIA need to know of a layer or driver manifest, without parsing it again
+struct ManifestSummary {
+    ManifestSummary() : type(MANIFEST_TYPE_EXPLICIT_LAYER), status(MANIFEST_STATUS_VALID) {}
+
+    ManifestType type;
+    std::string name;  // The layer name, empty for a driver
+    std::string library_path;
+    std::string api_version;
+    ManifestStatus status;  // Whether the manifest could be parsed
+};
+
+// Summaries of the layer and driver manifests, shared by the tools scanning the same search paths: whichever runs first records
+// the manifests it parsed, the other only parses the manifests that changed since. A summary is found as long as the manifest
+// size and modification time don't change. The cache file is a text file with a line per manifest, so that the tools read it
+// with or without their JSON library. Find and Record may be called from several threads.
+class ManifestCache {
+   public:
+    ManifestCache();
+
+    bool Load(const std::string &cache_path);
+
+    // The manifests that don't exist anymore are forgotten. The manifests recorded by another tool since Load are lost.
+    bool Save(const std::string &cache_path);
+
+    // Returns whether the summary of the manifest is known and the manifest didn't change since
+    bool Find(const std::string &manifest_path, ManifestSummary &summary);
+    void Record(const std::string &manifest_path, const ManifestSummary &summary);
+
+    std::size_t Size() const;
+
+   private:
+    ManifestCache(const ManifestCache &) = delete;
+    ManifestCache &operator=(const ManifestCache &) = delete;
+
+    struct Entry {
+        int64_t size;
+        int64_t modified;
+        ManifestSummary summary;
+    };
+
+    mutable std::mutex mutex;
+    std::map<std::string, Entry> entries;
+    bool changed;
+};
+
+// The cache file shared by the tools, in the user home directory. Empty when the home directory is unknown.
+std::string GetManifestCachePath();
+
+// The size and modification time of a manifest, returns false when it doesn't exist
+bool GetManifestStamp(const std::string &manifest_path, int64_t &size, int64_t &modified);
+
+}  // namespace vku